@@ -17,6 +17,7 @@
 #include <stdio.h>
 
 #include "device.h"
+#include "device_network.h"
 
 #include "util_args.h"
 #include "util_foreach.h"
@@ -36,6 +37,7 @@ int main(int argc, const char **argv)
 	string devicename = "cpu";
 	bool list = false;
 	int threads = 0;
+	int port = SERVER_PORT;
 
 	vector<DeviceType>& types = Device::available_types();
 
@@ -53,6 +55,7 @@ int main(int argc, const char **argv)
 		"--device %s", &devicename, ("Devices to use: " + devicelist).c_str(),
 		"--list-devices", &list, "List information about all available devices",
 		"--threads %d", &threads, "Number of threads to use for CPU device",
+		"--port %d", &port, string_printf("Port to accept connections on, to run multiple servers on one machine (default %d)", SERVER_PORT).c_str(),
 		NULL);
 
 	if(ap.parse(argc, argv) < 0) {
@@ -92,7 +95,7 @@ int main(int argc, const char **argv)
 		Stats stats;
 		Device *device = Device::create(device_info, stats, true);
 		printf("Cycles Server with device: %s\n", device->info.description.c_str());
-		device->server_run();
+		device->server_run(port);
 		delete device;
 	}
 
@@ -139,6 +139,10 @@ static void scene_init()
 static void session_exit()
 {
 	if(options.session) {
+#ifdef WITH_CYCLES_DEBUG
+		if(!options.quiet)
+			printf("%s", options.session->kernel_stats_report().c_str());
+#endif
 		delete options.session;
 		options.session = NULL;
 	}
@@ -42,7 +42,7 @@ def create(engine, data, scene, region=0, v3d=0, rv3d=0, preview_osl=False):
     if rv3d:
         rv3d = rv3d.as_pointer()
 
-    engine.session = _cycles.create(engine.as_pointer(), userpref, data, scene, region, v3d, rv3d, preview_osl)
+    engine.session = _cycles.create(engine.as_pointer(), userpref, data, scene, region, v3d, rv3d, preview_osl, bpy.app.debug_cycles)
 
 
 def free(engine):
@@ -113,6 +113,12 @@ enum_volume_homogeneous_sampling = (
     ('EQUI_ANGULAR', "Equi-angular", "Use Equi-angular Sampling"),
     )
 
+enum_volume_heterogeneous_sampling = (
+    ('RAY_MARCHING', "Ray Marching", "Step through the volume with a fixed step size, biased"),
+    ('DELTA_TRACKING', "Delta Tracking", "Sample collisions using an upper bound of the density, unbiased but usually slower for the same noise level, "
+                                        "useful when ray marching misses thin detail"),
+    )
+
 
 class CyclesRenderSettings(bpy.types.PropertyGroup):
     @classmethod
@@ -153,6 +159,13 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 default='DISTANCE',
                 )
 
+        cls.volume_heterogeneous_sampling = EnumProperty(
+                name="Heterogeneous Sampling",
+                description="Sampling method to use for heterogeneous volumes",
+                items=enum_volume_heterogeneous_sampling,
+                default='RAY_MARCHING',
+                )
+
         cls.use_square_samples = BoolProperty(
                 name="Square Samples",
                 description="Square sampling values for easier artist control",
@@ -246,6 +259,35 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 default='SOBOL',
                 )
 
+        cls.use_adaptive_sampling = BoolProperty(
+                name="Adaptive Sampling",
+                description="Stop sampling pixels once their noise is below the threshold, "
+                            "giving more render time to the noisy parts of the image",
+                default=False,
+                )
+        cls.adaptive_threshold = FloatProperty(
+                name="Noise Threshold",
+                description="Pixels stop being sampled when the estimated error of their value "
+                            "is below this fraction, lower values give less noise",
+                min=0.0001, max=1.0,
+                default=0.01,
+                precision=4,
+                )
+        cls.adaptive_min_samples = IntProperty(
+                name="Min Samples",
+                description="Number of samples to take in every pixel before estimating its noise",
+                min=1, max=4096,
+                default=16,
+                )
+
+        cls.use_light_tree = BoolProperty(
+                name="Light Tree",
+                description="Pick lights by their estimated contribution to the shading point "
+                            "instead of by area only, less noise in scenes with many lights "
+                            "(Path integrator only)",
+                default=False,
+                )
+
         cls.use_layer_samples = EnumProperty(
                 name="Layer Samples",
                 description="How to use per render layer sample settings",
@@ -337,8 +379,9 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
 
         cls.volume_max_steps = IntProperty(
                 name="Max Steps",
-                description="Maximum number of steps through the volume before giving up, "
-                            "to avoid extremely long render times with big objects or small step sizes",
+                description="Maximum number of steps or delta tracking collisions through the volume before giving up, "
+                            "to avoid extremely long render times with big objects or small step sizes "
+                            "(volumes needing more are rendered too transparent and too dark)",
                 default=1024,
                 min=2, max=65536
                 )
@@ -438,11 +481,29 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 description="Use BVH spatial splits: longer builder time, faster render",
                 default=False,
                 )
+        cls.debug_use_shader_optimization = BoolProperty(
+                name="Optimize Shaders",
+                description="Evaluate constant nodes and merge identical nodes when compiling SVM shaders",
+                default=True,
+                )
         cls.use_cache = BoolProperty(
                 name="Cache BVH",
                 description="Cache last built BVH to disk for faster re-render if no geometry changed",
                 default=False,
                 )
+        cls.use_texture_cache = BoolProperty(
+                name="Use Texture Cache",
+                description="Read image textures from disk on demand, at the resolution needed, "
+                            "instead of loading them fully into memory (CPU only, "
+                            "tiled and mipmapped files load fastest)",
+                default=False,
+                )
+        cls.texture_cache_size = IntProperty(
+                name="Cache Size",
+                description="Maximum memory used by the texture cache, in megabytes",
+                min=64, max=1048576,
+                default=4096,
+                )
         cls.tile_order = EnumProperty(
                 name="Tile Order",
                 description="Tile order for rendering",
@@ -148,6 +148,16 @@ class CyclesRender_PT_sampling(CyclesButtonsPanel, Panel):
         if cscene.feature_set == 'EXPERIMENTAL' and (device_type == 'NONE' or cscene.device == 'CPU'):
             layout.row().prop(cscene, "sampling_pattern", text="Pattern")
 
+        row = layout.row()
+        row.prop(cscene, "use_adaptive_sampling")
+        sub = row.row(align=True)
+        sub.active = cscene.use_adaptive_sampling
+        sub.prop(cscene, "adaptive_threshold", text="Threshold")
+        sub.prop(cscene, "adaptive_min_samples", text="Min")
+
+        if cscene.progressive == 'PATH':
+            layout.row().prop(cscene, "use_light_tree")
+
         for rl in scene.render.layers:
             if rl.samples > 0:
                 layout.separator()
@@ -170,9 +180,12 @@ class CyclesRender_PT_volume_sampling(CyclesButtonsPanel, Panel):
         layout.prop(cscene, "volume_homogeneous_sampling", text="Homogeneous")
 
         layout.label("Heterogeneous:")
+        layout.prop(cscene, "volume_heterogeneous_sampling", text="")
 
         split = layout.split()
-        split.prop(cscene, "volume_step_size")
+        sub = split.row()
+        sub.active = cscene.volume_heterogeneous_sampling == 'RAY_MARCHING'
+        sub.prop(cscene, "volume_step_size")
         split.prop(cscene, "volume_max_steps")
 
 
@@ -306,13 +319,26 @@ class CyclesRender_PT_performance(CyclesButtonsPanel, Panel):
 
         col.label(text="Final Render:")
         col.prop(cscene, "use_cache")
-        col.prop(rd, "use_persistent_data", text="Persistent Images")
+        col.prop(rd, "use_persistent_data", text="Persistent Data")
 
         col.separator()
 
         col.label(text="Acceleration structure:")
         col.prop(cscene, "debug_use_spatial_splits")
 
+        col.separator()
+
+        col.label(text="Shaders:")
+        col.prop(cscene, "debug_use_shader_optimization")
+
+        col.separator()
+
+        col.label(text="Textures:")
+        col.prop(cscene, "use_texture_cache")
+        sub = col.column(align=True)
+        sub.active = cscene.use_texture_cache
+        sub.prop(cscene, "texture_cache_size")
+
 
 class CyclesRender_PT_opengl(CyclesButtonsPanel, Panel):
     bl_label = "OpenGL Render"
@@ -394,6 +420,7 @@ class CyclesRender_PT_layer_passes(CyclesButtonsPanel, Panel):
         col.prop(rl, "use_pass_uv")
         col.prop(rl, "use_pass_object_index")
         col.prop(rl, "use_pass_material_index")
+        col.prop(rl, "use_pass_sample_count")
         col.separator()
         col.prop(rl, "use_pass_shadow")
         col.prop(rl, "use_pass_ambient_occlusion")
@@ -577,6 +577,8 @@ BufferParams BlenderSync::get_buffer_params(BL::RenderSettings b_render, BL::Sce
 		params.height = height;
 	}
 
+	add_adaptive_sampling_passes(b_scene, params.passes);
+
 	return params;
 }
 
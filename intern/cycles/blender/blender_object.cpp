@@ -243,14 +243,14 @@ Object *BlenderSync::sync_object(BL::Object b_parent, int persistent_id[OBJECT_P
 		object = object_map.find(key);
 
 		if(object) {
-			if(tfm != object->tfm) {
-				if(motion == -1)
-					object->motion.pre = tfm;
-				else
-					object->motion.post = tfm;
+			/* always set, with persistent data the motion of the previous
+			 * frame is still there when the object did not move */
+			if(motion == -1)
+				object->motion.pre = tfm;
+			else
+				object->motion.post = tfm;
 
-				object->use_motion = true;
-			}
+			object->use_motion = (object->motion.pre != object->tfm || object->motion.post != object->tfm);
 
 			/* mesh deformation blur not supported yet */
 			if(!scene->integrator->motion_blur)
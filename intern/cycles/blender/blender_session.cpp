@@ -48,6 +48,7 @@ BlenderSession::BlenderSession(BL::RenderEngine b_engine_, BL::UserPreferences b
 	height = render_resolution_y(b_render);
 
 	background = true;
+	debug = false;
 	last_redraw_time = 0.0;
 	start_resize_time = 0.0;
 }
@@ -63,6 +64,7 @@ BlenderSession::BlenderSession(BL::RenderEngine b_engine_, BL::UserPreferences b
 	width = width_;
 	height = height_;
 	background = false;
+	debug = false;
 	last_redraw_time = 0.0;
 	start_resize_time = 0.0;
 }
@@ -148,6 +150,11 @@ void BlenderSession::reset_session(BL::BlendData b_data_, BL::Scene b_scene_)
 		 * them rather than trying to distinguish which settings need to be updated
 		 */
 
+		if(sync) {
+			delete sync;
+			sync = NULL;
+		}
+
 		delete session;
 
 		create_session();
@@ -156,7 +163,6 @@ void BlenderSession::reset_session(BL::BlendData b_data_, BL::Scene b_scene_)
 	}
 
 	session->progress.reset();
-	scene->reset();
 
 	session->tile_manager.set_tile_order(session_params.tile_order);
 
@@ -165,8 +171,15 @@ void BlenderSession::reset_session(BL::BlendData b_data_, BL::Scene b_scene_)
 	 */
 	session->stats.mem_peak = session->stats.mem_used;
 
-	/* sync object should be re-created */
-	sync = new BlenderSync(b_engine, b_data, b_scene, scene, !background, session->progress, session_params.device.type == DEVICE_CPU);
+	if(sync) {
+		/* keep synced data from the previous frame, only data that may have
+		 * changed is exported again */
+		sync->reset(b_data, b_scene);
+	}
+	else {
+		scene->reset();
+		sync = new BlenderSync(b_engine, b_data, b_scene, scene, !background, session->progress, session_params.device.type == DEVICE_CPU);
+	}
 
 	/* for final render we will do full data sync per render layer, only
 	 * do some basic syncing here, no objects or materials for speed */
@@ -247,6 +260,8 @@ static PassType get_pass_type(BL::RenderPass b_pass)
 			return PASS_AO;
 		case BL::RenderPass::type_SHADOW:
 			return PASS_SHADOW;
+		case BL::RenderPass::type_SAMPLE_COUNT:
+			return PASS_SAMPLE_COUNT;
 
 		case BL::RenderPass::type_DIFFUSE:
 		case BL::RenderPass::type_COLOR:
@@ -381,6 +396,8 @@ void BlenderSession::render()
 			}
 		}
 
+		BlenderSync::add_adaptive_sampling_passes(b_scene, passes);
+
 		/* free result without merging */
 		end_render_result(b_engine, b_rr, true, false);
 
@@ -391,9 +408,13 @@ void BlenderSession::render()
 		scene->integrator->tag_update(scene);
 
 		/* update scene */
+		double sync_start_time = time_dt();
+
 		sync->sync_camera(b_render, b_engine.camera_override(), width, height);
 		sync->sync_data(b_v3d, b_engine.camera_override(), &python_thread_state, b_rlay_name.c_str());
 
+		double sync_time = time_dt() - sync_start_time;
+
 		/* update number of samples per layer */
 		int samples = sync->get_layer_samples();
 		bool bound_samples = sync->get_layer_bound_samples();
@@ -409,6 +430,25 @@ void BlenderSession::render()
 
 		if(session->progress.get_cancel())
 			break;
+
+		if(debug) {
+			/* report time spent on exporting and updating the scene, to see what
+			 * is saved with persistent data */
+			printf("Fra:%d | Cycles | %s | Synced in %.2fs, scene updated in %.2fs\n",
+			       b_scene.frame_current(), b_rlay_name.c_str(), sync_time, session->scene_update_time);
+
+			/* compare with debug_use_shader_optimization disabled to see the
+			 * effect of the shader graph optimizations */
+			if(!scene->shader_manager->use_osl())
+				printf("Fra:%d | Cycles | %s | Shaders compiled to %d SVM nodes\n",
+				       b_scene.frame_current(), b_rlay_name.c_str(), (int)scene->shader_manager->svm_program_size);
+
+#ifdef WITH_CYCLES_DEBUG
+			printf("%s", session->kernel_stats_report().c_str());
+#endif
+		}
+
+		fflush(stdout);
 	}
 
 	/* clear callback */
@@ -421,8 +461,11 @@ void BlenderSession::render()
 
 	session->device_free();
 
-	delete sync;
-	sync = NULL;
+	/* with persistent data, the synced scene is kept for the next frame */
+	if(!scene->params.persistent_data) {
+		delete sync;
+		sync = NULL;
+	}
 }
 
 void BlenderSession::do_write_update_render_result(BL::RenderResult b_rr, BL::RenderLayer b_rlay, RenderTile& rtile, bool do_update_only)
@@ -666,6 +709,12 @@ void BlenderSession::update_status_progress()
 	
 	timestatus += string_printf("Mem:%.2fM, Peak:%.2fM", mem_used, mem_peak);
 
+#ifdef WITH_CYCLES_DEBUG
+	string kernel_stats = session->kernel_stats_summary();
+	if(kernel_stats.size() > 0)
+		timestatus += " | " + kernel_stats;
+#endif
+
 	if(status.size() > 0)
 		status = " | " + status;
 	if(substatus.size() > 0)
@@ -72,6 +72,8 @@ public:
 	void update_status_progress();
 
 	bool background;
+	/* print sync and update times, set with --debug-cycles */
+	bool debug;
 	Session *session;
 	Scene *scene;
 	BlenderSync *sync;
@@ -135,6 +135,52 @@ bool BlenderSync::sync_recalc()
 	return recalc;
 }
 
+void BlenderSync::reset(BL::BlendData b_data_, BL::Scene b_scene_)
+{
+	/* with persistent data the synced scene is kept for the next frame. the
+	 * recalc flags are already cleared after the frame change, so we tag all
+	 * data that may be animated. meshes without modifiers can't change over
+	 * time and are kept along with their BVH. objects are tagged too, so
+	 * their motion from the previous frame is cleared in sync_object */
+	b_data = b_data_;
+	b_scene = b_scene_;
+
+	BL::BlendData::materials_iterator b_mat;
+
+	for(b_data.materials.begin(b_mat); b_mat != b_data.materials.end(); ++b_mat)
+		shader_map.set_recalc(*b_mat);
+
+	BL::BlendData::lamps_iterator b_lamp;
+
+	for(b_data.lamps.begin(b_lamp); b_lamp != b_data.lamps.end(); ++b_lamp)
+		shader_map.set_recalc(*b_lamp);
+
+	BL::BlendData::objects_iterator b_ob;
+
+	for(b_data.objects.begin(b_ob); b_ob != b_data.objects.end(); ++b_ob) {
+		object_map.set_recalc(*b_ob);
+
+		if(object_is_mesh(*b_ob)) {
+			/* curves, surfaces and text are converted with their evaluated
+			 * settings, which may be animated too */
+			bool is_modified = BKE_object_is_modified(*b_ob);
+
+			if(is_modified || b_ob->type() != BL::Object::type_MESH) {
+				BL::ID key = (is_modified)? *b_ob: b_ob->data();
+				mesh_map.set_recalc(key);
+			}
+		}
+		else if(object_is_light(*b_ob))
+			light_map.set_recalc(*b_ob);
+
+		BL::Object::particle_systems_iterator b_psys;
+		for(b_ob->particle_systems.begin(b_psys); b_psys != b_ob->particle_systems.end(); ++b_psys)
+			particle_system_map.set_recalc(*b_ob);
+	}
+
+	world_recalc = true;
+}
+
 void BlenderSync::sync_data(BL::SpaceView3D b_v3d, BL::Object b_override, void **python_thread_state, const char *layer)
 {
 	sync_render_layers(b_v3d, layer);
@@ -173,6 +219,7 @@ void BlenderSync::sync_integrator()
 	integrator->transparent_shadows = get_boolean(cscene, "use_transparent_shadows");
 
 	integrator->volume_homogeneous_sampling = RNA_enum_get(&cscene, "volume_homogeneous_sampling");
+	integrator->volume_heterogeneous_sampling = RNA_enum_get(&cscene, "volume_heterogeneous_sampling");
 	integrator->volume_max_steps = get_int(cscene, "volume_max_steps");
 	integrator->volume_step_size = get_float(cscene, "volume_step_size");
 
@@ -229,6 +276,12 @@ void BlenderSync::sync_integrator()
 	if(experimental)
 		integrator->sampling_pattern = (SamplingPattern)RNA_enum_get(&cscene, "sampling_pattern");
 
+	integrator->use_adaptive_sampling = get_boolean(cscene, "use_adaptive_sampling");
+	integrator->adaptive_threshold = get_float(cscene, "adaptive_threshold");
+	integrator->adaptive_min_samples = get_int(cscene, "adaptive_min_samples");
+
+	integrator->use_light_tree = get_boolean(cscene, "use_light_tree");
+
 	if(integrator->modified(previntegrator))
 		integrator->tag_update(scene);
 }
@@ -269,6 +322,17 @@ void BlenderSync::sync_film()
 		}
 	}
 
+	/* final render sets passes per render layer, viewport only needs
+	 * combined and the passes adaptive sampling works with */
+	if(preview) {
+		vector<Pass> passes;
+		Pass::add(PASS_COMBINED, passes);
+		add_adaptive_sampling_passes(b_scene, passes);
+
+		if(!Pass::equals(passes, film->passes))
+			film->tag_passes_update(scene, passes);
+	}
+
 	if(film->modified(prevfilm))
 		film->tag_update(scene);
 }
@@ -344,6 +408,18 @@ void BlenderSync::sync_render_layers(BL::SpaceView3D b_v3d, const char *layer)
 	}
 }
 
+/* Adaptive Sampling Passes */
+
+void BlenderSync::add_adaptive_sampling_passes(BL::Scene b_scene, vector<Pass>& passes)
+{
+	PointerRNA cscene = RNA_pointer_get(&b_scene.ptr, "cycles");
+
+	if(get_boolean(cscene, "use_adaptive_sampling")) {
+		Pass::add(PASS_SAMPLE_COUNT, passes);
+		Pass::add(PASS_SAMPLE_MOMENT, passes);
+	}
+}
+
 /* Scene Parameters */
 
 SceneParams BlenderSync::get_scene_params(BL::Scene b_scene, bool background)
@@ -358,18 +434,26 @@ SceneParams BlenderSync::get_scene_params(BL::Scene b_scene, bool background)
 	else if(shadingsystem == 1)
 		params.shadingsystem = SceneParams::OSL;
 	
-	if(background)
+	if(background && params.shadingsystem != SceneParams::OSL)
+		params.persistent_data = r.use_persistent_data();
+	else
+		params.persistent_data = false;
+
+	/* with persistent data, object transforms are not applied to meshes, so
+	 * that mesh BVHs can be reused for the next frame when objects move */
+	if(background && !params.persistent_data)
 		params.bvh_type = SceneParams::BVH_STATIC;
+	else if(background)
+		params.bvh_type = SceneParams::BVH_DYNAMIC;
 	else
 		params.bvh_type = (SceneParams::BVHType)RNA_enum_get(&cscene, "debug_bvh_type");
 
 	params.use_bvh_spatial_split = RNA_boolean_get(&cscene, "debug_use_spatial_splits");
+	params.use_shader_optimization = RNA_boolean_get(&cscene, "debug_use_shader_optimization");
 	params.use_bvh_cache = (background)? RNA_boolean_get(&cscene, "use_cache"): false;
 
-	if(background && params.shadingsystem != SceneParams::OSL)
-		params.persistent_data = r.use_persistent_data();
-	else
-		params.persistent_data = false;
+	params.use_texture_cache = get_boolean(cscene, "use_texture_cache");
+	params.texture_cache_size = get_int(cscene, "texture_cache_size");
 
 	return params;
 }
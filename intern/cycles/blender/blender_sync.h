@@ -53,6 +53,7 @@ public:
 
 	/* sync */
 	bool sync_recalc();
+	void reset(BL::BlendData b_data, BL::Scene b_scene);
 	void sync_data(BL::SpaceView3D b_v3d, BL::Object b_override, void **python_thread_state, const char *layer = 0);
 	void sync_render_layers(BL::SpaceView3D b_v3d, const char *layer);
 	void sync_integrator();
@@ -66,6 +67,7 @@ public:
 	static SessionParams get_session_params(BL::RenderEngine b_engine, BL::UserPreferences b_userpref, BL::Scene b_scene, bool background);
 	static bool get_session_pause(BL::Scene b_scene, bool background);
 	static BufferParams get_buffer_params(BL::RenderSettings b_render, BL::Scene b_scene, BL::SpaceView3D b_v3d, BL::RegionView3D b_rv3d, Camera *cam, int width, int height);
+	static void add_adaptive_sampling_passes(BL::Scene b_scene, vector<Pass>& passes);
 
 private:
 	/* sync */
@@ -22,6 +22,7 @@
 
 #include "bvh.h"
 #include "bvh_build.h"
+#include "bvh_motion.h"
 #include "bvh_node.h"
 #include "bvh_params.h"
 
@@ -30,7 +31,9 @@
 #include "util_foreach.h"
 #include "util_map.h"
 #include "util_progress.h"
+#include "util_string.h"
 #include "util_system.h"
+#include "util_time.h"
 #include "util_types.h"
 #include "util_math.h"
 
@@ -63,7 +66,9 @@ BVH::BVH(const BVHParams& params_, const vector<Object*>& objects_)
 
 BVH *BVH::create(const BVHParams& params, const vector<Object*>& objects)
 {
-	if(params.use_qbvh)
+	if(params.use_obvh)
+		return new OBVH(params, objects);
+	else if(params.use_qbvh)
 		return new QBVH(params, objects);
 	else
 		return new RegularBVH(params, objects);
@@ -84,6 +89,11 @@ bool BVH::cache_read(CacheData& key)
 		key.add(&ob->bounds, sizeof(ob->bounds));
 		key.add(&ob->visibility, sizeof(ob->visibility));
 		key.add(&ob->mesh->transform_applied, sizeof(bool));
+
+		if(params.use_motion_nodes) {
+			key.add(&ob->use_motion, sizeof(ob->use_motion));
+			key.add(&ob->motion, sizeof(ob->motion));
+		}
 	}
 
 	CacheData value;
@@ -95,6 +105,7 @@ bool BVH::cache_read(CacheData& key)
 		value.read(pack.SAH);
 
 		value.read(pack.nodes);
+		value.read(pack.motion_nodes);
 		value.read(pack.object_node);
 		value.read(pack.tri_woop);
 		value.read(pack.prim_segment);
@@ -117,6 +128,7 @@ void BVH::cache_write(CacheData& key)
 	value.add(pack.SAH);
 
 	value.add(pack.nodes);
+	value.add(pack.motion_nodes);
 	value.add(pack.object_node);
 	value.add(pack.tri_woop);
 	value.add(pack.prim_segment);
@@ -169,9 +181,13 @@ void BVH::build(Progress& progress)
 	vector<int> prim_index;
 	vector<int> prim_object;
 
+	double build_start_time = time_dt();
+
 	BVHBuild bvh_build(objects, prim_segment, prim_index, prim_object, params, progress);
 	BVHNode *root = bvh_build.run();
 
+	double build_time = time_dt() - build_start_time;
+
 	if(progress.get_cancel()) {
 		if(root) root->deleteSubtree();
 		return;
@@ -183,9 +199,15 @@ void BVH::build(Progress& progress)
 	pack.prim_object = prim_object;
 
 	/* compute SAH */
-	if(!params.top_level)
+	if(!params.top_level) {
 		pack.SAH = root->computeSubtreeSAHCost(params);
 
+		/* build statistics, to compare build settings */
+		progress.set_substatus(string_printf("Built BVH in %.2f seconds, %d primitives, SAH cost %.2f%s",
+		                                     build_time, (int)prim_index.size(), pack.SAH,
+		                                     params.use_spatial_split ? " (spatial splits)" : ""));
+	}
+
 	if(progress.get_cancel()) {
 		root->deleteSubtree();
 		return;
@@ -210,6 +232,14 @@ void BVH::build(Progress& progress)
 
 	if(progress.get_cancel()) return;
 
+	/* pack node bounds per motion step */
+	if(params.top_level && params.use_motion_nodes) {
+		progress.set_substatus("Packing BVH motion nodes");
+		pack_motion_nodes();
+
+		if(progress.get_cancel()) return;
+	}
+
 	/* cache write */
 	if(params.use_cache) {
 		progress.set_substatus("Writing BVH cache");
@@ -223,6 +253,87 @@ void BVH::build(Progress& progress)
 
 /* Refitting */
 
+void BVH::refit_primitives(int start, int end, BoundBox& bbox, uint& visibility)
+{
+	for(int prim = start; prim < end; prim++) {
+		int pidx = pack.prim_index[prim];
+		int tob = pack.prim_object[prim];
+		Object *ob = objects[tob];
+
+		if(pidx == -1) {
+			/* object instance */
+			bbox.grow(ob->bounds);
+		}
+		else {
+			/* primitives */
+			const Mesh *mesh = ob->mesh;
+
+			if(pack.prim_segment[prim] != ~0) {
+				/* curves */
+				int str_offset = (params.top_level)? mesh->curve_offset: 0;
+				int k0 = mesh->curves[pidx - str_offset].first_key + pack.prim_segment[prim]; // XXX!
+				int k1 = k0 + 1;
+
+				float3 p[4];
+				p[0] = mesh->curve_keys[max(k0 - 1,mesh->curves[pidx - str_offset].first_key)].co;
+				p[1] = mesh->curve_keys[k0].co;
+				p[2] = mesh->curve_keys[k1].co;
+				p[3] = mesh->curve_keys[min(k1 + 1,mesh->curves[pidx - str_offset].first_key + mesh->curves[pidx - str_offset].num_keys - 1)].co;
+				float3 lower;
+				float3 upper;
+				curvebounds(&lower.x, &upper.x, p, 0);
+				curvebounds(&lower.y, &upper.y, p, 1);
+				curvebounds(&lower.z, &upper.z, p, 2);
+				float mr = max(mesh->curve_keys[k0].radius,mesh->curve_keys[k1].radius);
+				bbox.grow(lower, mr);
+				bbox.grow(upper, mr);
+
+				visibility |= PATH_RAY_CURVE;
+			}
+			else {
+				/* triangles */
+				int tri_offset = (params.top_level)? mesh->tri_offset: 0;
+				const int *vidx = mesh->triangles[pidx - tri_offset].v;
+				const float3 *vpos = &mesh->verts[0];
+
+				bbox.grow(vpos[vidx[0]]);
+				bbox.grow(vpos[vidx[1]]);
+				bbox.grow(vpos[vidx[2]]);
+			}
+		}
+
+		visibility |= ob->visibility;
+	}
+}
+
+/* Motion Nodes */
+
+void BVH::motion_bounds_primitives(int start, int end, BoundBox *bounds)
+{
+	for(int prim = start; prim < end; prim++) {
+		Object *ob = objects[pack.prim_object[prim]];
+
+		if(pack.prim_index[prim] == -1) {
+			/* object instance */
+			BoundBox step_bounds[BVH_MOTION_STEPS];
+			ob->compute_motion_bounds(params.motion_shuttertime, BVH_MOTION_STEPS, step_bounds);
+
+			for(int step = 0; step < BVH_MOTION_STEPS; step++)
+				bounds[step].grow(step_bounds[step]);
+		}
+		else {
+			/* primitives with transform applied, these don't move */
+			BoundBox bbox = BoundBox::empty;
+			uint visibility = 0;
+
+			refit_primitives(prim, prim+1, bbox, visibility);
+
+			for(int step = 0; step < BVH_MOTION_STEPS; step++)
+				bounds[step].grow(bbox);
+		}
+	}
+}
+
 void BVH::refit(Progress& progress)
 {
 	progress.set_substatus("Packing BVH primitives");
@@ -353,7 +464,8 @@ void BVH::pack_instances(size_t nodes_size)
 	 * BVH's are stored in global arrays. This function merges them into the
 	 * top level BVH, adjusting indexes and offsets where appropriate. */
 	bool use_qbvh = params.use_qbvh;
-	size_t nsize = (use_qbvh)? BVH_QNODE_SIZE: BVH_NODE_SIZE;
+	bool use_obvh = params.use_obvh;
+	size_t nsize = (use_obvh)? BVH_ONODE_SIZE: (use_qbvh)? BVH_QNODE_SIZE: BVH_NODE_SIZE;
 
 	/* adjust primitive index to point to the triangle in the global array, for
 	 * meshes with transform applied and already in the top level BVH */
@@ -485,6 +597,29 @@ void BVH::pack_instances(size_t nodes_size)
 			int *bvh_is_leaf = (bvh->pack.is_leaf.size() != 0) ? &bvh->pack.is_leaf[0] : NULL;
 
 			for(size_t i = 0, j = 0; i < bvh_nodes_size; i+=nsize, j++) {
+				if(use_obvh) {
+					/* child indexes are in the last two rows, leaf data in the last */
+					memcpy(pack_nodes + pack_nodes_offset, bvh_nodes + i, nsize*sizeof(int4));
+
+					int4 *data = pack_nodes + pack_nodes_offset + nsize - 2;
+
+					if(bvh_is_leaf && bvh_is_leaf[j]) {
+						data[1].x += prim_offset;
+						data[1].y += prim_offset;
+					}
+					else {
+						int *child = &data[0].x;
+
+						/* 0 marks an empty child */
+						for(int k = 0; k < 8; k++)
+							if(child[k] != 0)
+								child[k] += (child[k] < 0)? -noffset: noffset;
+					}
+
+					pack_nodes_offset += nsize;
+					continue;
+				}
+
 				memcpy(pack_nodes + pack_nodes_offset, bvh_nodes + i, nsize_bbox*sizeof(int4));
 
 				/* modify offsets into arrays */
@@ -598,6 +733,29 @@ void RegularBVH::pack_nodes(const array<int>& prims, const BVHNode *root)
 	pack.root_index = (pack.is_leaf[0])? -1: 0;
 }
 
+void RegularBVH::pack_motion_nodes()
+{
+	pack.motion_nodes.clear();
+
+	/* single leaf has no node bounds to interpolate */
+	if(pack.is_leaf.size() == 0 || pack.is_leaf[0])
+		return;
+
+	/* top level nodes are packed first, instance nodes are not included */
+	pack.motion_nodes.resize(pack.is_leaf.size()*BVH_NODE_MOTION_SIZE);
+	memset(&pack.motion_nodes[0], 0, sizeof(float4)*pack.motion_nodes.size());
+
+	BoundBox bounds[BVH_MOTION_STEPS];
+	MotionLeafBounds leaf_bounds = {this};
+
+	bvh_pack_motion_node(&pack.nodes[0], &pack.motion_nodes[0], 0, false, bounds, leaf_bounds);
+}
+
+void RegularBVH::MotionLeafBounds::operator()(int start, int end, BoundBox *bounds) const
+{
+	bvh->motion_bounds_primitives(start, end, bounds);
+}
+
 void RegularBVH::refit_nodes()
 {
 	assert(!params.top_level);
@@ -616,55 +774,7 @@ void RegularBVH::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility
 
 	if(leaf) {
 		/* refit leaf node */
-		for(int prim = c0; prim < c1; prim++) {
-			int pidx = pack.prim_index[prim];
-			int tob = pack.prim_object[prim];
-			Object *ob = objects[tob];
-
-			if(pidx == -1) {
-				/* object instance */
-				bbox.grow(ob->bounds);
-			}
-			else {
-				/* primitives */
-				const Mesh *mesh = ob->mesh;
-
-				if(pack.prim_segment[prim] != ~0) {
-					/* curves */
-					int str_offset = (params.top_level)? mesh->curve_offset: 0;
-					int k0 = mesh->curves[pidx - str_offset].first_key + pack.prim_segment[prim]; // XXX!
-					int k1 = k0 + 1;
-
-					float3 p[4];
-					p[0] = mesh->curve_keys[max(k0 - 1,mesh->curves[pidx - str_offset].first_key)].co;
-					p[1] = mesh->curve_keys[k0].co;
-					p[2] = mesh->curve_keys[k1].co;
-					p[3] = mesh->curve_keys[min(k1 + 1,mesh->curves[pidx - str_offset].first_key + mesh->curves[pidx - str_offset].num_keys - 1)].co;
-					float3 lower;
-					float3 upper;
-					curvebounds(&lower.x, &upper.x, p, 0);
-					curvebounds(&lower.y, &upper.y, p, 1);
-					curvebounds(&lower.z, &upper.z, p, 2);
-					float mr = max(mesh->curve_keys[k0].radius,mesh->curve_keys[k1].radius);
-					bbox.grow(lower, mr);
-					bbox.grow(upper, mr);
-
-					visibility |= PATH_RAY_CURVE;
-				}
-				else {
-					/* triangles */
-					int tri_offset = (params.top_level)? mesh->tri_offset: 0;
-					const int *vidx = mesh->triangles[pidx - tri_offset].v;
-					const float3 *vpos = &mesh->verts[0];
-
-					bbox.grow(vpos[vidx[0]]);
-					bbox.grow(vpos[vidx[1]]);
-					bbox.grow(vpos[vidx[2]]);
-				}
-			}
-
-			visibility |= ob->visibility;
-		}
+		refit_primitives(c0, c1, bbox, visibility);
 
 		pack_node(idx, bbox, bbox, c0, c1, visibility, visibility);
 	}
@@ -827,5 +937,302 @@ void QBVH::refit_nodes()
 	assert(0); /* todo */
 }
 
+/* OBVH */
+
+OBVH::OBVH(const BVHParams& params_, const vector<Object*>& objects_)
+: BVH(params_, objects_)
+{
+	params.use_obvh = true;
+}
+
+int OBVH::collect_children(const BVHNode *node, const BVHNode *children[8])
+{
+	int num = 0;
+
+	children[num++] = node->get_child(0);
+	children[num++] = node->get_child(1);
+
+	/* open up the inner child with the largest surface area until the node
+	 * is full, as it is the most likely to be hit by a ray */
+	while(num < 8) {
+		int best = -1;
+		float best_area = -FLT_MAX;
+
+		for(int i = 0; i < num; i++) {
+			if(!children[i]->is_leaf()) {
+				float area = children[i]->m_bounds.safe_area();
+
+				if(area > best_area) {
+					best = i;
+					best_area = area;
+				}
+			}
+		}
+
+		if(best == -1)
+			break;
+
+		const BVHNode *child = children[best];
+		children[best] = child->get_child(0);
+		children[num++] = child->get_child(1);
+	}
+
+	return num;
+}
+
+void OBVH::pack_node(int idx, const BoundBox *bounds, const int *child, const uint *visibility, int num)
+{
+	/* rows of eight floats, one per child */
+	float data[BVH_ONODE_SIZE*4];
+
+	for(int i = 0; i < 8; i++) {
+		if(i < num) {
+			data[0*8 + i] = bounds[i].min.x;
+			data[1*8 + i] = bounds[i].max.x;
+			data[2*8 + i] = bounds[i].min.y;
+			data[3*8 + i] = bounds[i].max.y;
+			data[4*8 + i] = bounds[i].min.z;
+			data[5*8 + i] = bounds[i].max.z;
+			data[6*8 + i] = __uint_as_float(visibility[i]);
+			data[7*8 + i] = __int_as_float(child[i]);
+		}
+		else {
+			/* empty child, the inverted bounds and visibility make sure it's
+			 * never traversed, and index 0 marks it for refitting since the
+			 * root can't be a child */
+			data[0*8 + i] = FLT_MAX;
+			data[1*8 + i] = -FLT_MAX;
+			data[2*8 + i] = FLT_MAX;
+			data[3*8 + i] = -FLT_MAX;
+			data[4*8 + i] = FLT_MAX;
+			data[5*8 + i] = -FLT_MAX;
+			data[6*8 + i] = __uint_as_float(0);
+			data[7*8 + i] = __int_as_float(0);
+		}
+	}
+
+	memcpy(&pack.nodes[idx * BVH_ONODE_SIZE], data, sizeof(float4)*BVH_ONODE_SIZE);
+}
+
+void OBVH::pack_leaf(const BVHStackEntry& e, const LeafNode *leaf)
+{
+	float4 data[BVH_ONODE_SIZE];
+
+	memset(data, 0, sizeof(data));
+
+	/* leaf data goes in the last row, like for regular BVH nodes */
+	if(leaf->num_triangles() == 1 && pack.prim_index[leaf->m_lo] == -1) {
+		/* object */
+		data[BVH_ONODE_SIZE-1].x = __int_as_float(~(leaf->m_lo));
+		data[BVH_ONODE_SIZE-1].y = __int_as_float(0);
+	}
+	else {
+		/* triangle */
+		data[BVH_ONODE_SIZE-1].x = __int_as_float(leaf->m_lo);
+		data[BVH_ONODE_SIZE-1].y = __int_as_float(leaf->m_hi);
+	}
+
+	memcpy(&pack.nodes[e.idx * BVH_ONODE_SIZE], data, sizeof(float4)*BVH_ONODE_SIZE);
+}
+
+void OBVH::pack_inner(const BVHStackEntry& e, const BVHStackEntry *en, int num)
+{
+	BoundBox bounds[8];
+	int child[8];
+	uint visibility[8];
+
+	for(int i = 0; i < num; i++) {
+		bounds[i] = en[i].node->m_bounds;
+		child[i] = en[i].encodeIdx();
+		visibility[i] = en[i].node->m_visibility;
+	}
+
+	pack_node(e.idx, bounds, child, visibility, num);
+}
+
+/* Octo SIMD Nodes */
+
+void OBVH::pack_nodes(const array<int>& prims, const BVHNode *root)
+{
+	/* count nodes after collapsing */
+	size_t node_size = 0;
+
+	vector<const BVHNode*> count_stack;
+	count_stack.push_back(root);
+
+	while(count_stack.size()) {
+		const BVHNode *node = count_stack.back();
+		count_stack.pop_back();
+
+		node_size++;
+
+		if(!node->is_leaf()) {
+			const BVHNode *children[8];
+			int num = collect_children(node, children);
+
+			for(int i = 0; i < num; i++)
+				count_stack.push_back(children[i]);
+		}
+	}
+
+	/* resize arrays */
+	pack.nodes.clear();
+	pack.is_leaf.clear();
+	pack.is_leaf.resize(node_size);
+
+	/* for top level BVH, first merge existing BVH's so we know the offsets */
+	if(params.top_level)
+		pack_instances(node_size*BVH_ONODE_SIZE);
+	else
+		pack.nodes.resize(node_size*BVH_ONODE_SIZE);
+
+	int nextNodeIdx = 0;
+
+	vector<BVHStackEntry> stack;
+	stack.reserve(BVHParams::MAX_DEPTH*8);
+	stack.push_back(BVHStackEntry(root, nextNodeIdx++));
+
+	while(stack.size()) {
+		BVHStackEntry e = stack.back();
+		stack.pop_back();
+
+		pack.is_leaf[e.idx] = e.node->is_leaf();
+
+		if(e.node->is_leaf()) {
+			/* leaf node */
+			const LeafNode* leaf = reinterpret_cast<const LeafNode*>(e.node);
+			pack_leaf(e, leaf);
+		}
+		else {
+			/* inner node */
+			const BVHNode *children[8];
+			int num = collect_children(e.node, children);
+
+			/* push entries on the stack */
+			for(int i = 0; i < num; i++)
+				stack.push_back(BVHStackEntry(children[i], nextNodeIdx++));
+
+			/* set node */
+			pack_inner(e, &stack[stack.size()-num], num);
+		}
+	}
+
+	/* root index to start traversal at, to handle case of single leaf node */
+	pack.root_index = (pack.is_leaf[0])? -1: 0;
+}
+
+void OBVH::pack_motion_nodes()
+{
+	pack.motion_nodes.clear();
+
+	/* single leaf has no node bounds to interpolate */
+	if(pack.is_leaf.size() == 0 || pack.is_leaf[0])
+		return;
+
+	/* top level nodes are packed first, instance nodes are not included */
+	pack.motion_nodes.resize(pack.is_leaf.size()*BVH_ONODE_MOTION_SIZE);
+	memset(&pack.motion_nodes[0], 0, sizeof(float4)*pack.motion_nodes.size());
+
+	BoundBox bounds[BVH_MOTION_STEPS];
+	pack_motion_node(0, false, bounds);
+}
+
+void OBVH::pack_motion_node(int idx, bool leaf, BoundBox *bounds)
+{
+	const int4 *data = &pack.nodes[idx*BVH_ONODE_SIZE];
+
+	for(int step = 0; step < BVH_MOTION_STEPS; step++)
+		bounds[step] = BoundBox::empty;
+
+	if(leaf) {
+		int lo = data[BVH_ONODE_SIZE-1].x;
+		int hi = data[BVH_ONODE_SIZE-1].y;
+
+		/* object instances are stored as a single inverted primitive index */
+		if(lo < 0)
+			motion_bounds_primitives(~lo, ~lo + 1, bounds);
+		else
+			motion_bounds_primitives(lo, hi, bounds);
+	}
+	else {
+		/* inner node, six rows of eight child bounds per step */
+		const int *rows = (const int*)data;
+		float *mdata = (float*)&pack.motion_nodes[idx*BVH_ONODE_MOTION_SIZE];
+
+		for(int i = 0; i < 8; i++) {
+			int c = rows[7*8 + i];
+			BoundBox child_bounds[BVH_MOTION_STEPS];
+
+			/* empty children get inverted bounds, like in pack_node() */
+			if(c == 0) {
+				for(int step = 0; step < BVH_MOTION_STEPS; step++)
+					child_bounds[step] = BoundBox::empty;
+			}
+			else
+				pack_motion_node((c < 0)? -c-1: c, (c < 0), child_bounds);
+
+			for(int step = 0; step < BVH_MOTION_STEPS; step++) {
+				const BoundBox& b = child_bounds[step];
+				float *srows = mdata + step*6*8;
+
+				srows[0*8 + i] = b.min.x;
+				srows[1*8 + i] = b.max.x;
+				srows[2*8 + i] = b.min.y;
+				srows[3*8 + i] = b.max.y;
+				srows[4*8 + i] = b.min.z;
+				srows[5*8 + i] = b.max.z;
+
+				bounds[step].grow(b);
+			}
+		}
+	}
+}
+
+void OBVH::refit_nodes()
+{
+	assert(!params.top_level);
+
+	BoundBox bbox = BoundBox::empty;
+	uint visibility = 0;
+	refit_node(0, (pack.is_leaf[0])? true: false, bbox, visibility);
+}
+
+void OBVH::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility)
+{
+	int4 *data = &pack.nodes[idx*BVH_ONODE_SIZE];
+
+	if(leaf) {
+		/* refit leaf node, bounds are stored in the parent */
+		refit_primitives(data[BVH_ONODE_SIZE-1].x, data[BVH_ONODE_SIZE-1].y, bbox, visibility);
+	}
+	else {
+		/* refit inner node, set bounds from children */
+		const int *rows = (const int*)data;
+		BoundBox child_bounds[8];
+		int child[8];
+		uint child_visibility[8];
+		int num = 0;
+
+		for(int i = 0; i < 8; i++) {
+			int c = rows[7*8 + i];
+
+			if(c == 0)
+				break;
+
+			child_bounds[num] = BoundBox::empty;
+			child_visibility[num] = 0;
+			child[num] = c;
+
+			refit_node((c < 0)? -c-1: c, (c < 0), child_bounds[num], child_visibility[num]);
+
+			bbox.grow(child_bounds[num]);
+			visibility |= child_visibility[num];
+			num++;
+		}
+
+		pack_node(idx, child_bounds, child, child_visibility, num);
+	}
+}
+
 CCL_NAMESPACE_END
 
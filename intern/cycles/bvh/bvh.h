@@ -37,6 +37,10 @@ class Progress;
 
 #define BVH_NODE_SIZE	4
 #define BVH_QNODE_SIZE	8
+#define BVH_ONODE_SIZE	16
+#define BVH_MOTION_STEPS	3
+#define BVH_NODE_MOTION_SIZE	(3*BVH_MOTION_STEPS)
+#define BVH_ONODE_MOTION_SIZE	(12*BVH_MOTION_STEPS)
 #define BVH_ALIGN		4096
 #define TRI_NODE_SIZE	3
 
@@ -48,6 +52,9 @@ struct PackedBVH {
 	/* BVH nodes storage, one node is 4x int4, and contains two bounding boxes,
 	 * and child, triangle or object indexes depending on the node type */
 	array<int4> nodes; 
+	/* bounds of the top level nodes at each motion step, in the same layout
+	 * as the node bounds. only filled in for object motion blur */
+	array<float4> motion_nodes;
 	/* object index to BVH node index mapping for instances */
 	array<int> object_node; 
 	/* precomputed triangle intersection data, one triangle is 4x float4 */
@@ -111,8 +118,15 @@ protected:
 	/* merge instance BVH's */
 	void pack_instances(size_t nodes_size);
 
+	/* refit bounds and visibility of a range of primitives */
+	void refit_primitives(int start, int end, BoundBox& bbox, uint& visibility);
+
+	/* bounds per motion step of a range of primitives */
+	void motion_bounds_primitives(int start, int end, BoundBox *bounds);
+
 	/* for subclasses to implement */
 	virtual void pack_nodes(const array<int>& prims, const BVHNode *root) = 0;
+	virtual void pack_motion_nodes() {}
 	virtual void refit_nodes() = 0;
 };
 
@@ -132,6 +146,14 @@ protected:
 	void pack_inner(const BVHStackEntry& e, const BVHStackEntry& e0, const BVHStackEntry& e1);
 	void pack_node(int idx, const BoundBox& b0, const BoundBox& b1, int c0, int c1, uint visibility0, uint visibility1);
 
+	/* motion */
+	struct MotionLeafBounds {
+		RegularBVH *bvh;
+		void operator()(int start, int end, BoundBox *bounds) const;
+	};
+
+	void pack_motion_nodes();
+
 	/* refit */
 	void refit_nodes();
 	void refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility);
@@ -156,6 +178,37 @@ protected:
 	void refit_nodes();
 };
 
+/* OBVH
+ *
+ * Octo BVH, with each node having up to eight children, to use with AVX
+ * instructions. Built by collapsing the binary BVH, each node stores the
+ * bounds of its children per axis in rows of eight floats, followed by the
+ * child visibility and child indexes. */
+
+class OBVH : public BVH {
+protected:
+	/* constructor */
+	friend class BVH;
+	OBVH(const BVHParams& params, const vector<Object*>& objects);
+
+	/* collapse */
+	int collect_children(const BVHNode *node, const BVHNode *children[8]);
+
+	/* pack */
+	void pack_nodes(const array<int>& prims, const BVHNode *root);
+	void pack_leaf(const BVHStackEntry& e, const LeafNode *leaf);
+	void pack_inner(const BVHStackEntry& e, const BVHStackEntry *en, int num);
+	void pack_node(int idx, const BoundBox *bounds, const int *child, const uint *visibility, int num);
+
+	/* motion */
+	void pack_motion_nodes();
+	void pack_motion_node(int idx, bool leaf, BoundBox *bounds);
+
+	/* refit */
+	void refit_nodes();
+	void refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility);
+};
+
 CCL_NAMESPACE_END
 
 #endif /* __BVH_H__ */
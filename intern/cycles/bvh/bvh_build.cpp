@@ -46,6 +46,23 @@ public:
 	BVHObjectBinning range;
 };
 
+/* Spatial split tasks get their own copy of the references, since splits
+ * insert duplicated references which would shift the ranges of other tasks. */
+
+class BVHSpatialSplitBuildTask : public Task {
+public:
+	BVHSpatialSplitBuildTask(BVHBuild *build, InnerNode *node, int child, const BVHRange& range_,
+	                         const vector<BVHReference>& references_, int level)
+	: range(range_.bounds(), 0, range_.size()),
+	  references(references_.begin() + range_.start(), references_.begin() + range_.end())
+	{
+		run = function_bind(&BVHBuild::thread_build_spatial_split_node, build, node, child, &range, &references, level);
+	}
+
+	BVHRange range;
+	vector<BVHReference> references;
+};
+
 /* Constructor / Destructor */
 
 BVHBuild::BVHBuild(const vector<Object*>& objects_,
@@ -198,8 +215,6 @@ BVHNode* BVHBuild::run()
 		params.use_spatial_split = false;
 
 	spatial_min_overlap = root.bounds().safe_area() * params.spatial_split_alpha;
-	spatial_right_bounds.clear();
-	spatial_right_bounds.resize(max(root.size(), (int)BVHParams::NUM_SPATIAL_BINS) - 1);
 
 	/* init progress updates */
 	progress_start_time = time_dt();
@@ -215,8 +230,34 @@ BVHNode* BVHBuild::run()
 	BVHNode *rootnode;
 
 	if(params.use_spatial_split) {
-		/* singlethreaded spatial split build */
-		rootnode = build_node(root, 0);
+		/* multithreaded spatial split build */
+		BVHSpatialStorage storage;
+		vector<BVHReference> leaf_references;
+
+		rootnode = build_node(root, &references, &leaf_references, &storage, 0);
+
+		{
+			thread_scoped_lock lock(build_mutex);
+			progress_total += references.size() - progress_original_total;
+		}
+
+		task_pool.wait_work();
+
+		/* leaves created before the build was split into tasks */
+		if(rootnode && leaf_references.size())
+			spatial_leaf_references[rootnode].swap(leaf_references);
+
+		/* leaves get their primitives in depth first order, so the result is
+		 * the same no matter in which order the tasks finished */
+		if(rootnode && !progress.get_cancel()) {
+			prim_segment.clear();
+			prim_index.clear();
+			prim_object.clear();
+
+			gather_spatial_split_leaves(rootnode, NULL);
+		}
+
+		spatial_leaf_references.clear();
 	}
 	else {
 		/* multithreaded binning build */
@@ -231,7 +272,7 @@ BVHNode* BVHBuild::run()
 			rootnode->deleteSubtree();
 			rootnode = NULL;
 		}
-		else if(!params.use_spatial_split) {
+		else {
 			/*rotate(rootnode, 4, 5);*/
 			rootnode->update_visibility();
 		}
@@ -317,48 +358,111 @@ BVHNode* BVHBuild::build_node(const BVHObjectBinning& range, int level)
 	return inner;
 }
 
-/* single threaded spatial split builder */
-BVHNode* BVHBuild::build_node(const BVHRange& range, int level)
+void BVHBuild::thread_build_spatial_split_node(InnerNode *inner, int child, BVHRange *range,
+                                               vector<BVHReference> *references, int level)
 {
-	/* progress update */
+	if(progress.get_cancel())
+		return;
+
+	/* build nodes */
+	BVHSpatialStorage storage;
+	vector<BVHReference> leaf_references;
+	size_t num_references = references->size();
+
+	BVHNode *node = build_node(*range, references, &leaf_references, &storage, level);
+
+	/* set child in inner node */
+	inner->children[child] = node;
+
+	thread_scoped_lock lock(build_mutex);
+
+	/* update progress, counting duplicated references */
+	progress_total += references->size() - num_references;
+	progress_count += leaf_references.size();
 	progress_update();
+
+	/* keep leaf primitives until all tasks are done */
+	if(node && leaf_references.size())
+		spatial_leaf_references[node].swap(leaf_references);
+}
+
+/* multithreaded spatial split builder */
+BVHNode* BVHBuild::build_node(const BVHRange& range, vector<BVHReference> *references,
+                              vector<BVHReference> *leaf_references, BVHSpatialStorage *storage, int level)
+{
 	if(progress.get_cancel())
 		return NULL;
 
 	/* small enough or too deep => create leaf. */
 	if(!(range.size() > 0 && params.top_level && level == 0)) {
-		if(params.small_enough_for_leaf(range.size(), level)) {
-			progress_count += range.size();
-			return create_leaf_node(range);
-		}
+		if(params.small_enough_for_leaf(range.size(), level))
+			return create_leaf_node(range, *references, leaf_references);
 	}
 
 	/* splitting test */
-	BVHMixedSplit split(this, range, level);
+	BVHMixedSplit split(this, storage, *references, range, level);
 
 	if(!(range.size() > 0 && params.top_level && level == 0)) {
-		if(split.no_split) {
-			progress_count += range.size();
-			return create_leaf_node(range);
-		}
+		if(split.no_split)
+			return create_leaf_node(range, *references, leaf_references);
 	}
 	
 	/* do split */
 	BVHRange left, right;
-	split.split(this, left, right, range);
+	split.split(this, *references, left, right, range);
+
+	if(range.size() < THREAD_TASK_SIZE) {
+		/* local build */
+		size_t num_references = references->size();
+
+		/* left node */
+		BVHNode *leftnode = build_node(left, references, leaf_references, storage, level + 1);
 
-	progress_total += left.size() + right.size() - range.size();
-	size_t total = progress_total;
+		/* right node (modify start for references duplicated in the left node) */
+		right.set_start(right.start() + (int)(references->size() - num_references));
+		BVHNode *rightnode = build_node(right, references, leaf_references, storage, level + 1);
+
+		/* inner node */
+		return new InnerNode(range.bounds(), leftnode, rightnode);
+	}
+	else {
+		/* threaded build */
+		InnerNode *inner = new InnerNode(range.bounds());
 
-	/* leaft node */
-	BVHNode *leftnode = build_node(left, level + 1);
+		task_pool.push(new BVHSpatialSplitBuildTask(this, inner, 0, left, *references, level + 1), true);
+		task_pool.push(new BVHSpatialSplitBuildTask(this, inner, 1, right, *references, level + 1), true);
 
-	/* right node (modify start for splits) */
-	right.set_start(right.start() + progress_total - total);
-	BVHNode *rightnode = build_node(right, level + 1);
+		return inner;
+	}
+}
 
-	/* inner node */
-	return new InnerNode(range.bounds(), leftnode, rightnode);
+void BVHBuild::gather_spatial_split_leaves(BVHNode *node, const vector<BVHReference> *leaf_references)
+{
+	map<BVHNode*, vector<BVHReference> >::const_iterator it = spatial_leaf_references.find(node);
+
+	/* entering the subtree of another task */
+	if(it != spatial_leaf_references.end())
+		leaf_references = &it->second;
+
+	if(node->is_leaf()) {
+		LeafNode *leaf = (LeafNode*)node;
+		int start = prim_index.size();
+
+		for(int i = leaf->m_lo; i < leaf->m_hi; i++) {
+			const BVHReference& ref = (*leaf_references)[i];
+
+			prim_segment.push_back(ref.prim_segment());
+			prim_index.push_back(ref.prim_index());
+			prim_object.push_back(ref.prim_object());
+		}
+
+		leaf->m_hi = start + leaf->num_triangles();
+		leaf->m_lo = start;
+	}
+	else {
+		for(int i = 0; i < node->num_children(); i++)
+			gather_spatial_split_leaves(node->get_child(i), leaf_references);
+	}
 }
 
 /* Create Nodes */
@@ -370,18 +474,9 @@ BVHNode *BVHBuild::create_object_leaf_nodes(const BVHReference *ref, int start,
 		return new LeafNode(bounds, 0, 0, 0);
 	}
 	else if(num == 1) {
-		if(start == prim_index.size()) {
-			assert(params.use_spatial_split);
-
-			prim_segment.push_back(ref->prim_segment());
-			prim_index.push_back(ref->prim_index());
-			prim_object.push_back(ref->prim_object());
-		}
-		else {
-			prim_segment[start] = ref->prim_segment();
-			prim_index[start] = ref->prim_index();
-			prim_object[start] = ref->prim_object();
-		}
+		prim_segment[start] = ref->prim_segment();
+		prim_index[start] = ref->prim_index();
+		prim_object[start] = ref->prim_object();
 
 		uint visibility = objects[ref->prim_object()]->visibility;
 		return new LeafNode(ref->bounds(), visibility, start, start+1);
@@ -412,18 +507,9 @@ BVHNode* BVHBuild::create_leaf_node(const BVHRange& range)
 		BVHReference& ref = references[range.start() + i];
 
 		if(ref.prim_index() != -1) {
-			if(range.start() + num == prim_index.size()) {
-				assert(params.use_spatial_split);
-
-				p_segment.push_back(ref.prim_segment());
-				p_index.push_back(ref.prim_index());
-				p_object.push_back(ref.prim_object());
-			}
-			else {
-				p_segment[range.start() + num] = ref.prim_segment();
-				p_index[range.start() + num] = ref.prim_index();
-				p_object[range.start() + num] = ref.prim_object();
-			}
+			p_segment[range.start() + num] = ref.prim_segment();
+			p_index[range.start() + num] = ref.prim_index();
+			p_object[range.start() + num] = ref.prim_object();
 
 			bounds.grow(ref.bounds());
 			visibility |= objects[ref.prim_object()]->visibility;
@@ -456,6 +542,29 @@ BVHNode* BVHBuild::create_leaf_node(const BVHRange& range)
 		return oleaf;
 }
 
+/* Leaf for the spatial split builder, primitives are appended to the leaf
+ * references of the task and copied to the output once all tasks are done. */
+BVHNode* BVHBuild::create_leaf_node(const BVHRange& range, const vector<BVHReference>& references,
+                                    vector<BVHReference> *leaf_references)
+{
+	BoundBox bounds = BoundBox::empty;
+	uint visibility = 0;
+	int start = leaf_references->size();
+
+	for(int i = range.start(); i < range.end(); i++) {
+		const BVHReference& ref = references[i];
+
+		/* object references only exist in the top level, which has no spatial splits */
+		assert(ref.prim_index() != -1);
+
+		bounds.grow(ref.bounds());
+		visibility |= objects[ref.prim_object()]->visibility;
+		leaf_references->push_back(ref);
+	}
+
+	return new LeafNode(bounds, visibility, start, start + range.size());
+}
+
 /* Tree Rotations */
 
 void BVHBuild::rotate(BVHNode *node, int max_depth, int iterations)
@@ -24,12 +24,14 @@
 #include "bvh_binning.h"
 
 #include "util_boundbox.h"
+#include "util_map.h"
 #include "util_task.h"
 #include "util_vector.h"
 
 CCL_NAMESPACE_BEGIN
 
 class BVHBuildTask;
+class BVHSpatialSplitBuildTask;
 class BVHParams;
 class InnerNode;
 class Mesh;
@@ -58,6 +60,7 @@ protected:
 	friend class BVHObjectSplit;
 	friend class BVHSpatialSplit;
 	friend class BVHBuildTask;
+	friend class BVHSpatialSplitBuildTask;
 
 	/* adding references */
 	void add_reference_mesh(BoundBox& root, BoundBox& center, Mesh *mesh, int i);
@@ -65,16 +68,24 @@ protected:
 	void add_references(BVHRange& root);
 
 	/* building */
-	BVHNode *build_node(const BVHRange& range, int level);
+	BVHNode *build_node(const BVHRange& range, vector<BVHReference> *references,
+	                    vector<BVHReference> *leaf_references, BVHSpatialStorage *storage, int level);
 	BVHNode *build_node(const BVHObjectBinning& range, int level);
 	BVHNode *create_leaf_node(const BVHRange& range);
+	BVHNode *create_leaf_node(const BVHRange& range, const vector<BVHReference>& references,
+	                          vector<BVHReference> *leaf_references);
 	BVHNode *create_object_leaf_nodes(const BVHReference *ref, int start, int num);
 
 	/* threads */
 	enum { THREAD_TASK_SIZE = 4096 };
 	void thread_build_node(InnerNode *node, int child, BVHObjectBinning *range, int level);
+	void thread_build_spatial_split_node(InnerNode *node, int child, BVHRange *range,
+	                                     vector<BVHReference> *references, int level);
 	thread_mutex build_mutex;
 
+	/* spatial split leaves */
+	void gather_spatial_split_leaves(BVHNode *node, const vector<BVHReference> *leaf_references);
+
 	/* progress */
 	void progress_update();
 
@@ -104,8 +115,10 @@ protected:
 
 	/* spatial splitting */
 	float spatial_min_overlap;
-	vector<BoundBox> spatial_right_bounds;
-	BVHSpatialBin spatial_bins[3][BVHParams::NUM_SPATIAL_BINS];
+
+	/* primitives of the leaves built by each spatial split task, indexed by
+	 * the root node of the task, leaves index into these until gathered */
+	map<BVHNode*, vector<BVHReference> > spatial_leaf_references;
 
 	/* threads */
 	TaskPool task_pool;
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2011-2014 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+#ifndef __BVH_MOTION_H__
+#define __BVH_MOTION_H__
+
+#include "bvh.h"
+
+#include "util_boundbox.h"
+#include "util_transform.h"
+#include "util_types.h"
+#include "util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Motion Nodes
+ *
+ * With object motion blur, top level nodes also store the bounds of their
+ * children at BVH_MOTION_STEPS steps over the shutter, which traversal
+ * interpolates at the ray time.
+ *
+ * Kept in a header so the motion BVH benchmark in test/benchmark uses the
+ * same code. */
+
+/* Bounds at evenly spaced steps over the shutter of mbounds transformed by
+ * the decomposed motion, expanded so that linear interpolation between two
+ * steps contains the bounds at any time between them */
+static inline void bvh_motion_step_bounds(BoundBox mbounds, const DecompMotionTransform *decomp,
+                                          float shuttertime, int num_steps, BoundBox *step_bounds)
+{
+	float start_t = 0.5f - shuttertime*0.25f;
+	float step_length = shuttertime*0.5f/(num_steps - 1);
+
+	for(int step = 0; step < num_steps; step++) {
+		Transform ttfm;
+
+		transform_motion_interpolate(&ttfm, decomp, start_t + step*step_length);
+		step_bounds[step] = mbounds.transformed(&ttfm);
+	}
+
+	/* find how much the interpolated bounds fall short of bounds sampled
+	 * between steps, rotation is not linear. both steps of an interval are
+	 * expanded by the same amount, and steps shared by two intervals by the
+	 * maximum of both */
+	const int num_samples = 64;
+	vector<float3> expand_min(num_steps, make_float3(0.0f, 0.0f, 0.0f));
+	vector<float3> expand_max(num_steps, make_float3(0.0f, 0.0f, 0.0f));
+
+	for(int step = 0; step < num_steps - 1; step++) {
+		const BoundBox& b0 = step_bounds[step];
+		const BoundBox& b1 = step_bounds[step + 1];
+
+		for(int i = 1; i < num_samples; i++) {
+			float u = i/(float)num_samples;
+			Transform ttfm;
+
+			transform_motion_interpolate(&ttfm, decomp, start_t + (step + u)*step_length);
+			BoundBox b = mbounds.transformed(&ttfm);
+
+			float3 dmin = max(interp(b0.min, b1.min, u) - b.min, make_float3(0.0f, 0.0f, 0.0f));
+			float3 dmax = max(b.max - interp(b0.max, b1.max, u), make_float3(0.0f, 0.0f, 0.0f));
+
+			expand_min[step] = max(expand_min[step], dmin);
+			expand_min[step + 1] = max(expand_min[step + 1], dmin);
+			expand_max[step] = max(expand_max[step], dmax);
+			expand_max[step + 1] = max(expand_max[step + 1], dmax);
+		}
+	}
+
+	for(int step = 0; step < num_steps; step++) {
+		step_bounds[step].min = step_bounds[step].min - expand_min[step];
+		step_bounds[step].max = step_bounds[step].max + expand_max[step];
+	}
+}
+
+/* Pack the bounds per step of the children of regular BVH node idx and of
+ * all nodes below it into motion_nodes, and return the bounds per step of
+ * the node itself. leaf_bounds(start, end, bounds) grows the bounds per step
+ * by the primitives of a leaf */
+template<typename LeafBounds>
+static void bvh_pack_motion_node(const int4 *nodes, float4 *motion_nodes, int idx, bool leaf,
+                                 BoundBox *bounds, const LeafBounds& leaf_bounds)
+{
+	const int4 *data = &nodes[idx*BVH_NODE_SIZE];
+
+	int c0 = data[3].x;
+	int c1 = data[3].y;
+
+	for(int step = 0; step < BVH_MOTION_STEPS; step++)
+		bounds[step] = BoundBox::empty;
+
+	if(leaf) {
+		/* object instances are stored as a single inverted primitive index */
+		if(c0 < 0)
+			leaf_bounds(~c0, ~c0 + 1, bounds);
+		else
+			leaf_bounds(c0, c1, bounds);
+	}
+	else {
+		/* inner node, store child bounds per step in node layout */
+		BoundBox bounds0[BVH_MOTION_STEPS], bounds1[BVH_MOTION_STEPS];
+
+		bvh_pack_motion_node(nodes, motion_nodes, (c0 < 0)? -c0-1: c0, (c0 < 0), bounds0, leaf_bounds);
+		bvh_pack_motion_node(nodes, motion_nodes, (c1 < 0)? -c1-1: c1, (c1 < 0), bounds1, leaf_bounds);
+
+		float4 *mdata = &motion_nodes[idx*BVH_NODE_MOTION_SIZE];
+
+		for(int step = 0; step < BVH_MOTION_STEPS; step++) {
+			const BoundBox& b0 = bounds0[step];
+			const BoundBox& b1 = bounds1[step];
+
+			mdata[step*3 + 0] = make_float4(b0.min.x, b1.min.x, b0.max.x, b1.max.x);
+			mdata[step*3 + 1] = make_float4(b0.min.y, b1.min.y, b0.max.y, b1.max.y);
+			mdata[step*3 + 2] = make_float4(b0.min.z, b1.min.z, b0.max.z, b1.max.z);
+
+			bounds[step].grow(b0);
+			bounds[step].grow(b1);
+		}
+	}
+}
+
+CCL_NAMESPACE_END
+
+#endif /* __BVH_MOTION_H__ */
+
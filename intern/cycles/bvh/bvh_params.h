@@ -19,6 +19,7 @@
 #define __BVH_PARAMS_H__
 
 #include "util_boundbox.h"
+#include "util_vector.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -48,7 +49,12 @@ public:
 	/* QBVH */
 	int use_qbvh;
 
-	int pad;
+	/* OBVH, eight children per node for AVX traversal */
+	int use_obvh;
+
+	/* top level node bounds per motion step, for object motion blur */
+	int use_motion_nodes;
+	float motion_shuttertime;
 
 	/* fixed parameters */
 	enum {
@@ -71,7 +77,9 @@ public:
 		top_level = false;
 		use_cache = false;
 		use_qbvh = false;
-		pad = false;
+		use_obvh = false;
+		use_motion_nodes = false;
+		motion_shuttertime = 0.0f;
 	}
 
 	/* SAH costs */
@@ -171,6 +179,19 @@ struct BVHSpatialBin
 	}
 };
 
+/* BVH Spatial Storage
+ *
+ * Scratch space for evaluating object and spatial splits. Every spatial split
+ * build task has its own, so splits can be evaluated in parallel. */
+
+struct BVHSpatialStorage
+{
+	/* right to left sweep bounds, resized on demand to the range size */
+	vector<BoundBox> right_bounds;
+
+	BVHSpatialBin bins[3][BVHParams::NUM_SPATIAL_BINS];
+};
+
 CCL_NAMESPACE_END
 
 #endif /* __BVH_PARAMS_H__ */
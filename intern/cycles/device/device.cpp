@@ -145,7 +145,8 @@ Device *Device::create(DeviceInfo& info, Stats &stats, bool background)
 #endif
 #ifdef WITH_NETWORK
 		case DEVICE_NETWORK:
-			device = device_network_create(info, stats, "127.0.0.1");
+			/* multi device with all servers that can be found */
+			device = device_multi_create(info, stats, background);
 			break;
 #endif
 #ifdef WITH_OPENCL
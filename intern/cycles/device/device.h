@@ -54,6 +54,7 @@ public:
 	bool display_device;
 	bool advanced_shading;
 	bool pack_images;
+	bool use_obvh;
 	vector<DeviceInfo> multi_devices;
 
 	DeviceInfo()
@@ -64,6 +65,7 @@ public:
 		display_device = false;
 		advanced_shading = true;
 		pack_images = false;
+		use_obvh = false;
 	}
 };
 
@@ -111,6 +113,9 @@ public:
 	/* open shading language, only for CPU device */
 	virtual void *osl_memory() { return NULL; }
 
+	/* image texture cache, only for CPU device */
+	virtual void *texture_cache_memory() { return NULL; }
+
 	/* load/compile kernels, must be called before adding tasks */ 
 	virtual bool load_kernels(bool experimental) { return true; }
 
@@ -125,7 +130,7 @@ public:
 
 #ifdef WITH_NETWORK
 	/* networking */
-	void server_run();
+	void server_run(int port);
 #endif
 
 	/* multi device */
@@ -24,6 +24,7 @@
 #include "kernel_compat_cpu.h"
 #include "kernel_types.h"
 #include "kernel_globals.h"
+#include "kernel_texture_cache.h"
 
 #include "osl_shader.h"
 #include "osl_globals.h"
@@ -49,6 +50,8 @@ public:
 #ifdef WITH_OSL
 	OSLGlobals osl_globals;
 #endif
+
+	TextureCacheGlobals texture_cache_globals;
 	
 	CPUDevice(DeviceInfo& info, Stats &stats, bool background)
 	: Device(info, stats, background)
@@ -56,6 +59,8 @@ public:
 #ifdef WITH_OSL
 		kernel_globals.osl = &osl_globals;
 #endif
+		kernel_globals.tex_cache = NULL;
+		kernel_globals.tex_cache_tdata = NULL;
 
 		/* do now to avoid thread issues */
 		system_cpu_support_sse2();
@@ -127,6 +132,11 @@ public:
 #endif
 	}
 
+	void *texture_cache_memory()
+	{
+		return &texture_cache_globals;
+	}
+
 	void thread_run(DeviceTask *task)
 	{
 		if(task->type == DeviceTask::PATH_TRACE)
@@ -158,6 +168,10 @@ public:
 #ifdef WITH_OSL
 		OSLShader::thread_init(&kg, &kernel_globals, &osl_globals);
 #endif
+		TextureCache::thread_init(&kg, &texture_cache_globals);
+#ifdef __KERNEL_STATS__
+		kg.stats.reset();
+#endif
 
 		RenderTile tile;
 		
@@ -175,16 +189,17 @@ public:
 							break;
 					}
 
-					for(int y = tile.y; y < tile.y + tile.h; y++) {
-						for(int x = tile.x; x < tile.x + tile.w; x++) {
-							kernel_cpu_avx_path_trace(&kg, render_buffer, rng_state,
-								sample, x, y, tile.offset, tile.stride);
-						}
-					}
+					bool converged = !kernel_cpu_avx_path_trace(&kg, render_buffer, rng_state,
+						sample, tile.x, tile.y, tile.w, tile.h, tile.offset, tile.stride);
 
 					tile.sample = sample + 1;
 
 					task.update_progress(tile);
+
+					if(converged) {
+						tile.converged = true;
+						break;
+					}
 				}
 			}
 			else
@@ -197,16 +212,17 @@ public:
 							break;
 					}
 
-					for(int y = tile.y; y < tile.y + tile.h; y++) {
-						for(int x = tile.x; x < tile.x + tile.w; x++) {
-							kernel_cpu_sse41_path_trace(&kg, render_buffer, rng_state,
-								sample, x, y, tile.offset, tile.stride);
-						}
-					}
+					bool converged = !kernel_cpu_sse41_path_trace(&kg, render_buffer, rng_state,
+						sample, tile.x, tile.y, tile.w, tile.h, tile.offset, tile.stride);
 
 					tile.sample = sample + 1;
 
 					task.update_progress(tile);
+
+					if(converged) {
+						tile.converged = true;
+						break;
+					}
 				}
 			}
 			else
@@ -219,16 +235,17 @@ public:
 							break;
 					}
 
-					for(int y = tile.y; y < tile.y + tile.h; y++) {
-						for(int x = tile.x; x < tile.x + tile.w; x++) {
-							kernel_cpu_sse3_path_trace(&kg, render_buffer, rng_state,
-								sample, x, y, tile.offset, tile.stride);
-						}
-					}
+					bool converged = !kernel_cpu_sse3_path_trace(&kg, render_buffer, rng_state,
+						sample, tile.x, tile.y, tile.w, tile.h, tile.offset, tile.stride);
 
 					tile.sample = sample + 1;
 
 					task.update_progress(tile);
+
+					if(converged) {
+						tile.converged = true;
+						break;
+					}
 				}
 			}
 			else
@@ -241,16 +258,17 @@ public:
 							break;
 					}
 
-					for(int y = tile.y; y < tile.y + tile.h; y++) {
-						for(int x = tile.x; x < tile.x + tile.w; x++) {
-							kernel_cpu_sse2_path_trace(&kg, render_buffer, rng_state,
-								sample, x, y, tile.offset, tile.stride);
-						}
-					}
+					bool converged = !kernel_cpu_sse2_path_trace(&kg, render_buffer, rng_state,
+						sample, tile.x, tile.y, tile.w, tile.h, tile.offset, tile.stride);
 
 					tile.sample = sample + 1;
 
 					task.update_progress(tile);
+
+					if(converged) {
+						tile.converged = true;
+						break;
+					}
 				}
 			}
 			else
@@ -262,21 +280,36 @@ public:
 							break;
 					}
 
-					for(int y = tile.y; y < tile.y + tile.h; y++) {
-						for(int x = tile.x; x < tile.x + tile.w; x++) {
-							kernel_cpu_path_trace(&kg, render_buffer, rng_state,
-								sample, x, y, tile.offset, tile.stride);
-						}
-					}
+					bool converged = !kernel_cpu_path_trace(&kg, render_buffer, rng_state,
+						sample, tile.x, tile.y, tile.w, tile.h, tile.offset, tile.stride);
 
 					tile.sample = sample + 1;
 
 					task.update_progress(tile);
+
+					if(converged) {
+						tile.converged = true;
+						break;
+					}
 				}
 			}
 
+			if(tile.converged) {
+				/* adaptive sampling skipped all pixels, count the remaining
+				 * samples as done and let this thread move on to another tile */
+				for(; tile.sample < end_sample; tile.sample++)
+					if(task.update_progress_sample)
+						task.update_progress_sample();
+			}
+
 			task.release_tile(tile);
 
+#ifdef __KERNEL_STATS__
+			/* accumulate per tile so statistics are available during render */
+			stats.kernel_add(kg.stats);
+			kg.stats.reset();
+#endif
+
 			if(task_pool.canceled()) {
 				if(task.need_finish_queue == false)
 					break;
@@ -286,6 +319,7 @@ public:
 #ifdef WITH_OSL
 		OSLShader::thread_free(&kg);
 #endif
+		TextureCache::thread_free(&kg);
 	}
 
 	void thread_film_convert(DeviceTask& task)
@@ -389,6 +423,7 @@ public:
 #ifdef WITH_OSL
 		OSLShader::thread_init(&kg, &kernel_globals, &osl_globals);
 #endif
+		TextureCache::thread_init(&kg, &texture_cache_globals);
 
 #ifdef WITH_CYCLES_OPTIMIZED_KERNEL_AVX
 		if(system_cpu_support_avx()) {
@@ -446,6 +481,7 @@ public:
 #ifdef WITH_OSL
 		OSLShader::thread_free(&kg);
 #endif
+		TextureCache::thread_free(&kg);
 	}
 
 	void task_add(DeviceTask& task)
@@ -485,6 +521,11 @@ void device_cpu_info(vector<DeviceInfo>& devices)
 	info.advanced_shading = true;
 	info.pack_images = false;
 
+	/* 8-wide BVH is only traversed by the AVX kernel */
+#ifdef WITH_CYCLES_OPTIMIZED_KERNEL_AVX
+	info.use_obvh = system_cpu_support_avx();
+#endif
+
 	devices.insert(devices.begin(), info);
 }
 
@@ -56,10 +56,11 @@ public:
 
 #ifdef WITH_NETWORK
 		/* try to add network devices */
-		ServerDiscovery discovery(true);
-		time_sleep(1.0);
+		vector<string> servers = device_network_servers();
 
-		vector<string> servers = discovery.get_server_list();
+		/* network device without servers found, try the local machine */
+		if(servers.empty() && info.type == DEVICE_NETWORK)
+			servers.push_back("127.0.0.1");
 
 		foreach(string& server, servers) {
 			device = device_network_create(info, stats, server.c_str());
@@ -19,6 +19,9 @@
 #include "device_network.h"
 
 #include "util_foreach.h"
+#include "util_set.h"
+#include "util_thread.h"
+#include "util_time.h"
 
 #if defined(WITH_NETWORK)
 
@@ -48,17 +51,55 @@ public:
 	device_ptr mem_counter;
 	DeviceTask the_task; /* todo: handle multiple tasks */
 
+	/* held while sending a message, and for calls until the reply is read */
 	thread_mutex rpc_lock;
 
+	/* thread receiving all messages from the server. replies to calls are
+	 * handed to the waiting call, tile requests are queued for task_run */
+	thread *reader_thread;
+	bool reader_stopped;
+
+	thread_mutex reply_mutex;
+	thread_condition_variable reply_cond;
+	RPCReceive *reply;
+
+	/* thread answering tile requests of the server while a task runs */
+	thread *task_thread;
+
+	struct TaskRequest {
+		string name;
+		RenderTile tile;
+		bool stream;
+	};
+
+	thread_mutex task_mutex;
+	thread_condition_variable task_cond;
+	list<TaskRequest> task_requests;
+
+	/* tiles acquired by the server, the reader thread looks them up to
+	 * receive streamed tile buffers */
+	thread_mutex tiles_mutex;
+	TileList the_tiles;
+
+	/* tile buffers of which the server sent the contents along with the
+	 * finished tile, so mem_copy_from doesn't need to request them again */
+	set<device_ptr> streamed_mem;
+
 	NetworkDevice(DeviceInfo& info, Stats &stats, const char *address)
-	: Device(info, stats, true), socket(io_service)
+	: Device(info, stats, true), socket(io_service), reader_thread(NULL), reader_stopped(true),
+	  reply(NULL), task_thread(NULL)
 	{
 		error_func = NetworkError();
+
+		string host;
+		int port;
+		network_address_split(address, host, port);
+
 		stringstream portstr;
-		portstr << SERVER_PORT;
+		portstr << port;
 
 		tcp::resolver resolver(io_service);
-		tcp::resolver::query query(address, portstr.str());
+		tcp::resolver::query query(host, portstr.str());
 		tcp::resolver::iterator endpoint_iterator = resolver.resolve(query);
 		tcp::resolver::iterator end;
 
@@ -73,12 +114,28 @@ public:
 			error_func.network_error(error.message());
 
 		mem_counter = 0;
+
+		if(!error) {
+			reader_stopped = false;
+			reader_thread = new thread(function_bind(&NetworkDevice::reader_run, this));
+		}
 	}
 
 	~NetworkDevice()
 	{
-		RPCSend snd(socket, &error_func, "stop");
-		snd.write();
+		task_wait();
+
+		{
+			thread_scoped_lock lock(rpc_lock);
+			RPCSend snd(socket, &error_func, "stop");
+			snd.write();
+		}
+
+		/* the server closes the connection, which ends the reader thread */
+		if(reader_thread) {
+			reader_thread->join();
+			delete reader_thread;
+		}
 	}
 
 	void mem_alloc(device_memory& mem, MemoryType type)
@@ -98,6 +155,8 @@ public:
 	{
 		thread_scoped_lock lock(rpc_lock);
 
+		streamed_mem.erase(mem.device_pointer);
+
 		RPCSend snd(socket, &error_func, "mem_copy_to");
 
 		snd.add(mem);
@@ -109,6 +168,10 @@ public:
 	{
 		thread_scoped_lock lock(rpc_lock);
 
+		/* already received along with the finished tile */
+		if(streamed_mem.erase(mem.device_pointer))
+			return;
+
 		size_t data_size = mem.memory_size();
 
 		RPCSend snd(socket, &error_func, "mem_copy_from");
@@ -120,14 +183,20 @@ public:
 		snd.add(elem);
 		snd.write();
 
-		RPCReceive rcv(socket, &error_func);
-		rcv.read_buffer((void*)mem.data_pointer, data_size);
+		RPCReceive *rcv = reply_wait("mem_copy_from");
+
+		if(rcv) {
+			rcv->read_buffer((void*)mem.data_pointer, data_size);
+			reply_done();
+		}
 	}
 
 	void mem_zero(device_memory& mem)
 	{
 		thread_scoped_lock lock(rpc_lock);
 
+		streamed_mem.erase(mem.device_pointer);
+
 		RPCSend snd(socket, &error_func, "mem_zero");
 
 		snd.add(mem);
@@ -139,6 +208,8 @@ public:
 		if(mem.device_pointer) {
 			thread_scoped_lock lock(rpc_lock);
 
+			streamed_mem.erase(mem.device_pointer);
+
 			RPCSend snd(socket, &error_func, "mem_free");
 
 			snd.add(mem);
@@ -168,16 +239,44 @@ public:
 
 		mem.device_pointer = ++mem_counter;
 
-		RPCSend snd(socket, &error_func, "tex_alloc");
-
 		string name_string(name);
+		size_t data_size = mem.memory_size();
+
+		/* large textures are identified by a hash of their contents, the
+		 * server may still have them from rendering the previous frame */
+		uint64_t hash = 0;
+
+		if(data_size >= NETWORK_CACHE_MIN_SIZE) {
+			uint64_t name_hash = network_data_hash(name_string.c_str(), name_string.size());
+			hash = network_data_hash((void*)mem.data_pointer, data_size, name_hash);
+
+			/* zero means no hash */
+			if(hash == 0)
+				hash = 1;
+		}
+
+		RPCSend snd(socket, &error_func, "tex_alloc");
 
 		snd.add(name_string);
 		snd.add(mem);
 		snd.add(interpolation);
 		snd.add(periodic);
+		snd.add(hash);
 		snd.write();
-		snd.write_buffer((void*)mem.data_pointer, mem.memory_size());
+
+		bool cached = false;
+
+		if(hash) {
+			RPCReceive *rcv = reply_wait("tex_alloc");
+
+			if(rcv) {
+				rcv->read(cached);
+				reply_done();
+			}
+		}
+
+		if(!cached)
+			snd.write_buffer((void*)mem.data_pointer, data_size);
 	}
 
 	void tex_free(device_memory& mem)
@@ -205,90 +304,116 @@ public:
 		snd.add(experimental);
 		snd.write();
 
-		bool result;
-		RPCReceive rcv(socket, &error_func);
-		rcv.read(result);
+		bool result = false;
+		RPCReceive *rcv = reply_wait("load_kernels");
+
+		if(rcv) {
+			rcv->read(result);
+			reply_done();
+		}
 
 		return result;
 	}
 
 	void task_add(DeviceTask& task)
 	{
+		/* one task at a time, see the_task */
+		task_wait();
+
 		thread_scoped_lock lock(rpc_lock);
 
 		the_task = task;
+		streamed_mem.clear();
+
+		{
+			thread_scoped_lock tiles_lock(tiles_mutex);
+			the_tiles.clear();
+		}
 
 		RPCSend snd(socket, &error_func, "task_add");
 		snd.add(task);
 		snd.write();
+
+		RPCSend wait_snd(socket, &error_func, "task_wait");
+		wait_snd.write();
+
+		/* answer tile requests in a thread, so that with multiple servers
+		 * in a multi device they all render at the same time */
+		task_thread = new thread(function_bind(&NetworkDevice::task_run, this));
 	}
 
 	void task_wait()
 	{
-		thread_scoped_lock lock(rpc_lock);
-
-		RPCSend snd(socket, &error_func, "task_wait");
-		snd.write();
+		if(task_thread) {
+			task_thread->join();
+			delete task_thread;
+			task_thread = NULL;
+		}
+	}
 
-		lock.unlock();
+	void task_run()
+	{
+		for(;;) {
+			TaskRequest request;
 
-		TileList the_tiles;
+			{
+				thread_scoped_lock lock(task_mutex);
 
-		/* todo: run this threaded for connecting to multiple clients */
-		for(;;) {
-			if(error_func.have_error())
-				break;
+				while(task_requests.empty() && !reader_stopped)
+					task_cond.wait(lock);
 
-			RenderTile tile;
+				/* connection lost */
+				if(task_requests.empty())
+					break;
 
-			lock.lock();
-			RPCReceive rcv(socket, &error_func);
+				request = task_requests.front();
+				task_requests.pop_front();
+			}
 
-			if(rcv.name == "acquire_tile") {
-				lock.unlock();
+			if(request.name == "acquire_tile") {
+				RenderTile tile;
 
 				/* todo: watch out for recursive calls! */
 				if(the_task.acquire_tile(this, tile)) { /* write return as bool */
-					the_tiles.push_back(tile);
-
-					lock.lock();
+					{
+						thread_scoped_lock tiles_lock(tiles_mutex);
+						the_tiles.push_back(tile);
+					}
+
+					/* have the server send the tile buffer with the finished
+					 * tile when the buffer contains only this tile */
+					bool stream = (tile.buffers &&
+					               tile.buffers->buffer.device_pointer == tile.buffer &&
+					               tile.buffers->params.width == tile.w &&
+					               tile.buffers->params.height == tile.h);
+
+					thread_scoped_lock lock(rpc_lock);
 					RPCSend snd(socket, &error_func, "acquire_tile");
 					snd.add(tile);
+					snd.add(stream);
 					snd.write();
-					lock.unlock();
 				}
 				else {
-					lock.lock();
+					thread_scoped_lock lock(rpc_lock);
 					RPCSend snd(socket, &error_func, "acquire_tile_none");
 					snd.write();
-					lock.unlock();
 				}
 			}
-			else if(rcv.name == "release_tile") {
-				rcv.read(tile);
-				lock.unlock();
-
-				TileList::iterator it = tile_list_find(the_tiles, tile);
-				if (it != the_tiles.end()) {
-					tile.buffers = it->buffers;
-					the_tiles.erase(it);
+			else if(request.name == "release_tile") {
+				if(request.stream) {
+					thread_scoped_lock lock(rpc_lock);
+					streamed_mem.insert(request.tile.buffers->buffer.device_pointer);
 				}
 
-				assert(tile.buffers != NULL);
-
-				the_task.release_tile(tile);
+				the_task.release_tile(request.tile);
 
-				lock.lock();
+				thread_scoped_lock lock(rpc_lock);
 				RPCSend snd(socket, &error_func, "release_tile");
 				snd.write();
-				lock.unlock();
 			}
-			else if(rcv.name == "task_wait_done") {
-				lock.unlock();
+			else if(request.name == "task_wait_done") {
 				break;
 			}
-			else
-				lock.unlock();
 		}
 	}
 
@@ -299,6 +424,109 @@ public:
 		snd.write();
 	}
 
+protected:
+	/* wait for the reader thread to receive the reply to a call, with
+	 * rpc_lock held. the reader thread waits until reply_done(), so the
+	 * caller can read buffers that follow the reply. returns NULL when the
+	 * connection is lost */
+	RPCReceive *reply_wait(const string& name)
+	{
+		thread_scoped_lock lock(reply_mutex);
+
+		while(!reply && !reader_stopped)
+			reply_cond.wait(lock);
+
+		if(reply && reply->name != name) {
+			error_func.network_error("Network receive error: unexpected reply \"" + reply->name + "\"");
+			reply = NULL;
+			reply_cond.notify_all();
+		}
+
+		return reply;
+	}
+
+	void reply_done()
+	{
+		thread_scoped_lock lock(reply_mutex);
+
+		reply = NULL;
+		reply_cond.notify_all();
+	}
+
+	/* only this thread reads from the socket, so replies and tile requests
+	 * of the server can't be taken by the wrong thread */
+	void reader_run()
+	{
+		for(;;) {
+			RPCReceive rcv(socket, &error_func);
+
+			if(error_func.have_error())
+				break;
+
+			if(rcv.name == "acquire_tile" || rcv.name == "task_wait_done") {
+				TaskRequest request;
+				request.name = rcv.name;
+				request.stream = false;
+
+				task_request_push(request);
+			}
+			else if(rcv.name == "release_tile") {
+				TaskRequest request;
+				request.name = rcv.name;
+
+				rcv.read(request.tile);
+				rcv.read(request.stream);
+
+				{
+					thread_scoped_lock tiles_lock(tiles_mutex);
+					TileList::iterator it = tile_list_find(the_tiles, request.tile);
+
+					if(it != the_tiles.end()) {
+						request.tile.buffers = it->buffers;
+						the_tiles.erase(it);
+					}
+				}
+
+				assert(request.tile.buffers != NULL);
+
+				/* the tile is not in use by the server or the session until
+				 * it is released, so the buffer can be read into directly */
+				if(request.stream) {
+					device_vector<float>& buffer = request.tile.buffers->buffer;
+					rcv.read_buffer((void*)buffer.data_pointer, buffer.memory_size());
+				}
+
+				task_request_push(request);
+			}
+			else {
+				/* reply to a call, hand over and wait until it's read */
+				thread_scoped_lock lock(reply_mutex);
+
+				reply = &rcv;
+				reply_cond.notify_all();
+
+				while(reply)
+					reply_cond.wait(lock);
+			}
+		}
+
+		/* connection closed, wake up calls and the task thread */
+		thread_scoped_lock reply_lock(reply_mutex);
+		thread_scoped_lock task_lock(task_mutex);
+
+		reader_stopped = true;
+		reply_cond.notify_all();
+		task_cond.notify_all();
+	}
+
+	void task_request_push(const TaskRequest& request)
+	{
+		thread_scoped_lock lock(task_mutex);
+
+		task_requests.push_back(request);
+		task_cond.notify_all();
+	}
+
 private:
 	NetworkError error_func;
 };
@@ -308,6 +536,27 @@ Device *device_network_create(DeviceInfo& info, Stats &stats, const char *addres
 	return new NetworkDevice(info, stats, address);
 }
 
+vector<string> device_network_servers()
+{
+	vector<string> servers;
+
+	/* explicit list of servers, for example to test with multiple servers
+	 * on the same machine: "127.0.0.1:5120,127.0.0.1:5122" */
+	const char *servers_env = getenv("CYCLES_NETWORK_SERVERS");
+
+	if(servers_env) {
+		string_split(servers, servers_env, ", ");
+	}
+	else {
+		ServerDiscovery discovery(true);
+		time_sleep(1.0);
+
+		servers = discovery.get_server_list();
+	}
+
+	return servers;
+}
+
 void device_network_info(vector<DeviceInfo>& devices)
 {
 	DeviceInfo info;
@@ -322,6 +571,39 @@ void device_network_info(vector<DeviceInfo>& devices)
 	devices.push_back(info);
 }
 
+/* Server side cache of textures freed by the previous client session, so
+ * that rendering the next frame of an animation only sends changed data. */
+
+class DeviceServerCache {
+public:
+	struct Entry {
+		DataVector data;
+		int session;
+	};
+
+	typedef map<uint64_t, Entry> EntryMap;
+
+	DeviceServerCache() : session(0) {}
+
+	/* drop textures that were cached before this session and not reused */
+	void session_end()
+	{
+		EntryMap::iterator it = entries.begin();
+
+		while(it != entries.end()) {
+			if(it->second.session < session)
+				entries.erase(it++);
+			else
+				++it;
+		}
+
+		session++;
+	}
+
+	EntryMap entries;
+	int session;
+};
+
 class DeviceServer {
 public:
 	thread_mutex rpc_lock;
@@ -332,8 +614,8 @@ public:
 
 	bool have_error() { return error_func.have_error(); }
 
-	DeviceServer(Device *device_, tcp::socket& socket_)
-	: device(device_), socket(socket_), stop(false), blocked_waiting(false)
+	DeviceServer(Device *device_, tcp::socket& socket_, DeviceServerCache& cache_)
+	: device(device_), socket(socket_), cache(cache_), stop(false), blocked_waiting(false)
 	{
 		error_func = NetworkError();
 	}
@@ -344,16 +626,20 @@ public:
 		for(;;) {
 			listen_step();
 
-			if(stop)
+			if(stop || have_error())
 				break;
 		}
 	}
 
 protected:
+	/* messages are read without holding rpc_lock, so render threads can send
+	 * tile requests while waiting for the next message. only one thread reads
+	 * at a time: the listen thread, or while it is blocked in task_wait, the
+	 * render thread holding acquire_mutex */
 	void listen_step()
 	{
-		thread_scoped_lock lock(rpc_lock);
 		RPCReceive rcv(socket, &error_func);
+		thread_scoped_lock lock(rpc_lock);
 
 		if(rcv.name == "stop")
 			stop = true;
@@ -561,26 +847,51 @@ protected:
 			string name;
 			bool interpolation;
 			bool periodic;
+			uint64_t hash;
 			device_ptr client_pointer;
 
 			rcv.read(name);
 			rcv.read(mem);
 			rcv.read(interpolation);
 			rcv.read(periodic);
-			lock.unlock();
+			rcv.read(hash);
 
 			client_pointer = mem.device_pointer;
 
 			size_t data_size = mem.memory_size();
 
-			DataVector &data_v = data_vector_insert(client_pointer, data_size);
+			DataVector &data_v = data_vector_insert(client_pointer, 0);
+			bool cached = false;
+
+			if(hash) {
+				/* reuse the data if we still have it from the previous session */
+				DeviceServerCache::EntryMap::iterator it = cache.entries.find(hash);
+
+				if(it != cache.entries.end() && it->second.data.size() == data_size) {
+					data_v.swap(it->second.data);
+					cache.entries.erase(it);
+					cached = true;
+				}
+
+				mem_hash[client_pointer] = hash;
+
+				RPCSend snd(socket, &error_func, "tex_alloc");
+				snd.add(cached);
+				snd.write();
+			}
+
+			lock.unlock();
+
+			if(!cached)
+				data_v.resize(data_size);
 
 			if(data_size)
 				mem.data_pointer = (device_ptr)&(data_v[0]);
 			else
 				mem.data_pointer = 0;
 
-			rcv.read_buffer((uint8_t*)mem.data_pointer, data_size);
+			if(!cached)
+				rcv.read_buffer((uint8_t*)mem.data_pointer, data_size);
 
 			device->tex_alloc(name.c_str(), mem, interpolation, periodic);
 
@@ -595,6 +906,18 @@ protected:
 
 			client_pointer = mem.device_pointer;
 
+			/* keep the data around for the next session */
+			map<device_ptr, uint64_t>::iterator it = mem_hash.find(client_pointer);
+
+			if(it != mem_hash.end()) {
+				DeviceServerCache::Entry& entry = cache.entries[it->second];
+
+				entry.data.swap(data_vector_find(client_pointer));
+				entry.session = cache.session;
+
+				mem_hash.erase(it);
+			}
+
 			mem.device_pointer = device_ptr_from_client_pointer_erase(client_pointer);
 
 			device->tex_free(mem);
@@ -660,6 +983,7 @@ protected:
 			AcquireEntry entry;
 			entry.name = rcv.name;
 			rcv.read(entry.tile);
+			rcv.read(entry.stream);
 			acquire_queue.push_back(entry);
 			lock.unlock();
 		}
@@ -687,8 +1011,11 @@ protected:
 
 		bool result = false;
 
-		RPCSend snd(socket, &error_func, "acquire_tile");
-		snd.write();
+		{
+			thread_scoped_lock lock(rpc_lock);
+			RPCSend snd(socket, &error_func, "acquire_tile");
+			snd.write();
+		}
 
 		do {
 			if(blocked_waiting)
@@ -704,6 +1031,9 @@ protected:
 				if(entry.name == "acquire_tile") {
 					tile = entry.tile;
 
+					if(entry.stream)
+						stream_mem.insert(tile.buffer);
+
 					if(tile.buffer) tile.buffer = ptr_map[tile.buffer];
 					if(tile.rng_state) tile.rng_state = ptr_map[tile.rng_state];
 
@@ -736,14 +1066,38 @@ protected:
 	{
 		thread_scoped_lock acquire_lock(acquire_mutex);
 
+		device_ptr buffer = tile.buffer;
+
 		if(tile.buffer) tile.buffer = ptr_imap[tile.buffer];
 		if(tile.rng_state) tile.rng_state = ptr_imap[tile.rng_state];
 
+		/* send the tile buffer right away if the client asked for it */
+		bool stream = stream_mem.erase(tile.buffer) > 0;
+
 		{
 			thread_scoped_lock lock(rpc_lock);
 			RPCSend snd(socket, &error_func, "release_tile");
 			snd.add(tile);
+			snd.add(stream);
 			snd.write();
+
+			if(stream) {
+				DataVector &data_v = data_vector_find(tile.buffer);
+				network_device_memory mem;
+
+				mem.data_type = TYPE_UCHAR;
+				mem.data_elements = 1;
+				mem.data_size = data_v.size();
+				mem.data_width = data_v.size();
+				mem.data_height = 0;
+				mem.data_pointer = (device_ptr)&data_v[0];
+				mem.device_pointer = buffer;
+
+				device->mem_copy_from(mem, 0, mem.data_size, 1, 1);
+
+				snd.write_buffer(&data_v[0], data_v.size());
+			}
+
 			lock.unlock();
 		}
 
@@ -784,10 +1138,20 @@ protected:
 	DataMap mem_data;
 
 	struct AcquireEntry {
+		AcquireEntry() : stream(false) {}
+
 		string name;
 		RenderTile tile;
+		bool stream;
 	};
 
+	/* tile buffers to send to the client when the tile is finished */
+	set<device_ptr> stream_mem;
+
+	/* textures that can be kept in the cache when freed */
+	DeviceServerCache& cache;
+	map<device_ptr, uint64_t> mem_hash;
+
 	thread_mutex acquire_mutex;
 	list<AcquireEntry> acquire_queue;
 
@@ -800,16 +1164,19 @@ private:
 
 };
 
-void Device::server_run()
+void Device::server_run(int port)
 {
 	try {
 		/* starts thread that responds to discovery requests */
-		ServerDiscovery discovery;
+		ServerDiscovery discovery(false, port);
+
+		/* textures kept between sessions */
+		DeviceServerCache cache;
 
 		for(;;) {
 			/* accept connection */
 			boost::asio::io_service io_service;
-			tcp::acceptor acceptor(io_service, tcp::endpoint(tcp::v4(), SERVER_PORT));
+			tcp::acceptor acceptor(io_service, tcp::endpoint(tcp::v4(), port));
 
 			tcp::socket socket(io_service);
 			acceptor.accept(socket);
@@ -817,9 +1184,11 @@ void Device::server_run()
 			string remote_address = socket.remote_endpoint().address().to_string();
 			printf("Connected to remote client at: %s\n", remote_address.c_str());
 
-			DeviceServer server(this, socket);
+			DeviceServer server(this, socket, cache);
 			server.listen();
 
+			cache.session_end();
+
 			printf("Disconnected.\n");
 		}
 	}
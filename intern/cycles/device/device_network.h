@@ -33,12 +33,15 @@
 #include <sstream>
 #include <deque>
 
+#include <zlib.h>
+
 #include "buffers.h"
 
 #include "util_foreach.h"
 #include "util_list.h"
 #include "util_map.h"
 #include "util_string.h"
+#include "util_types.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -55,6 +58,11 @@ static const int DISCOVER_PORT = 5121;
 static const string DISCOVER_REQUEST_MSG = "REQUEST_RENDER_SERVER_IP";
 static const string DISCOVER_REPLY_MSG = "REPLY_RENDER_SERVER_IP";
 
+/* buffers smaller than this are sent uncompressed, and are not looked up
+ * in the server side cache */
+static const size_t NETWORK_COMPRESS_MIN_SIZE = 1024;
+static const size_t NETWORK_CACHE_MIN_SIZE = 64*1024;
+
 #if 0
 typedef boost::archive::text_oarchive o_archive;
 typedef boost::archive::text_iarchive i_archive;
@@ -63,6 +71,55 @@ typedef boost::archive::binary_oarchive o_archive;
 typedef boost::archive::binary_iarchive i_archive;
 #endif
 
+/* Server addresses are "host" or "host:port", so that multiple servers can
+ * run on the same machine */
+
+static inline void network_address_split(const string& server, string& host, int& port)
+{
+	size_t pos = server.rfind(':');
+
+	if(pos == string::npos) {
+		host = server;
+		port = SERVER_PORT;
+	}
+	else {
+		host = server.substr(0, pos);
+		port = atoi(server.substr(pos + 1).c_str());
+	}
+}
+
+/* Hash of buffer contents, to find scene data that the server still has
+ * from a previous session */
+
+static inline uint64_t network_data_hash(const void *data, size_t size, uint64_t seed = 0)
+{
+	const uint64_t m = 0xc6a4a7935bd1e995ULL;
+	const uint8_t *bytes = (const uint8_t*)data;
+	uint64_t h = seed ^ (size*m);
+	size_t i;
+
+	for(i = 0; i + 8 <= size; i += 8) {
+		uint64_t k;
+		memcpy(&k, bytes + i, sizeof(k));
+
+		k *= m;
+		k ^= k >> 47;
+		k *= m;
+
+		h ^= k;
+		h *= m;
+	}
+
+	for(; i < size; i++)
+		h = (h ^ bytes[i])*m;
+
+	h ^= h >> 47;
+	h *= m;
+	h ^= h >> 47;
+
+	return h;
+}
+
 /* Serialization of device memory */
 
 class network_device_memory : public device_memory
@@ -175,13 +232,44 @@ public:
 		sent = true;
 	}
 
+	/* buffers are compressed with zlib, the header contains the compressed
+	 * size, or zero if the data follows uncompressed */
 	void write_buffer(void *buffer, size_t size)
 	{
 		boost::system::error_code error;
+		vector<Bytef> compressed;
+		uLongf compressed_size = 0;
+
+		if(size >= NETWORK_COMPRESS_MIN_SIZE && size < 0xffffffffUL) {
+			compressed_size = compressBound(size);
+			compressed.resize(compressed_size);
+
+			if(compress2(&compressed[0], &compressed_size, (const Bytef*)buffer, size, Z_BEST_SPEED) != Z_OK ||
+			   compressed_size >= size)
+				compressed_size = 0;
+		}
+
+		ostringstream header_stream;
+		header_stream << setw(8) << hex << (size_t)compressed_size;
+		string header_str = header_stream.str();
 
 		boost::asio::write(socket,
-			boost::asio::buffer(buffer, size),
+			boost::asio::buffer(header_str),
 			boost::asio::transfer_all(), error);
+
+		if(error.value())
+			error_func->network_error(error.message());
+
+		if(compressed_size) {
+			boost::asio::write(socket,
+				boost::asio::buffer(&compressed[0], compressed_size),
+				boost::asio::transfer_all(), error);
+		}
+		else {
+			boost::asio::write(socket,
+				boost::asio::buffer(buffer, size),
+				boost::asio::transfer_all(), error);
+		}
 		
 		if(error.value())
 			error_func->network_error(error.message());
@@ -274,14 +362,50 @@ public:
 	void read_buffer(void *buffer, size_t size)
 	{
 		boost::system::error_code error;
-		size_t len = boost::asio::read(socket, boost::asio::buffer(buffer, size), error);
 
-		if(error.value()){
-			error_func->network_error(error.message());
+		/* read header with compressed size */
+		vector<char> header(8);
+		size_t len = boost::asio::read(socket, boost::asio::buffer(header), error);
+
+		if(error.value() || len != header.size()) {
+			error_func->network_error("Network receive error: invalid buffer header");
+			return;
+		}
+
+		string header_str(&header[0], header.size());
+		istringstream header_stream(header_str);
+		size_t compressed_size;
+
+		if(!(header_stream >> hex >> compressed_size)) {
+			error_func->network_error("Network receive error: can't decode buffer size from header");
+			return;
 		}
 
-		if(len != size)
-			cout << "Network receive error: buffer size doesn't match expected size\n";
+		if(compressed_size == 0) {
+			len = boost::asio::read(socket, boost::asio::buffer(buffer, size), error);
+
+			if(error.value())
+				error_func->network_error(error.message());
+
+			if(len != size)
+				cout << "Network receive error: buffer size doesn't match expected size\n";
+		}
+		else {
+			vector<Bytef> compressed(compressed_size);
+			len = boost::asio::read(socket, boost::asio::buffer(compressed), error);
+
+			if(error.value())
+				error_func->network_error(error.message());
+
+			uLongf uncompressed_size = size;
+
+			if(len != compressed_size ||
+			   uncompress((Bytef*)buffer, &uncompressed_size, &compressed[0], compressed_size) != Z_OK ||
+			   uncompressed_size != size)
+			{
+				error_func->network_error("Network receive error: can't uncompress buffer");
+			}
+		}
 	}
 
 	void read(DeviceTask& task)
@@ -322,8 +446,8 @@ protected:
 
 class ServerDiscovery {
 public:
-	ServerDiscovery(bool discover = false)
-	: listen_socket(io_service), collect_servers(false)
+	ServerDiscovery(bool discover = false, int server_port_ = SERVER_PORT)
+	: listen_socket(io_service), collect_servers(false), server_port(server_port_)
 	{
 		/* setup listen socket */
 		listen_endpoint.address(boost::asio::ip::address_v4::any());
@@ -384,8 +508,13 @@ private:
 
 			/* handle incoming message */
 			if(collect_servers) {
-				if(msg == DISCOVER_REPLY_MSG) {
+				if(msg.compare(0, DISCOVER_REPLY_MSG.size(), DISCOVER_REPLY_MSG) == 0) {
+					/* reply contains the port, in case servers don't use the default */
 					string address = receive_endpoint.address().to_string();
+					int port = atoi(msg.substr(DISCOVER_REPLY_MSG.size()).c_str());
+
+					if(port > 0 && port != SERVER_PORT)
+						address += string_printf(":%d", port);
 
 					mutex.lock();
 
@@ -402,7 +531,7 @@ private:
 			else {
 				/* reply to request */
 				if(msg == DISCOVER_REQUEST_MSG)
-					broadcast_message(DISCOVER_REPLY_MSG);
+					broadcast_message(string_printf("%s %d", DISCOVER_REPLY_MSG.c_str(), server_port));
 			}
 		}
 
@@ -462,6 +591,9 @@ private:
 	/* collection of server addresses in list */
 	bool collect_servers;
 	vector<string> servers;
+
+	/* port that this server accepts connections on */
+	int server_port;
 };
 
 CCL_NAMESPACE_END
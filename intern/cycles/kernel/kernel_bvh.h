@@ -28,11 +28,22 @@ CCL_NAMESPACE_BEGIN
 /* bottom-most stack entry, indicating the end of traversal */
 #define ENTRYPOINT_SENTINEL 0x76543210
 
+#ifdef __KERNEL_AVX__
+/* 8-wide nodes push up to 7 children each, for 64 deep object and mesh BVH */
+#define BVH_STACK_SIZE 1024
+#else
 /* 64 object BVH + 64 mesh BVH + 64 object node splitting */
 #define BVH_STACK_SIZE 192
+#endif
 #define BVH_NODE_SIZE 4
+#define BVH_ONODE_SIZE 16
 #define TRI_NODE_SIZE 3
 
+/* top level node bounds per motion step, for regular and 8-wide nodes */
+#define BVH_MOTION_STEPS 3
+#define BVH_NODE_MOTION_SIZE (3*BVH_MOTION_STEPS)
+#define BVH_ONODE_MOTION_SIZE (12*BVH_MOTION_STEPS)
+
 /* silly workaround for float extended precision that happens when compiling
  * without sse support on x86, it results in different results for float ops
  * that you would otherwise expect to compare correctly */
@@ -112,6 +123,55 @@ ccl_device_inline void bvh_instance_motion_pop(KernelGlobals *kg, int object, co
 }
 #endif
 
+#ifdef __OBJECT_MOTION__
+/* Motion Nodes
+ *
+ * With object motion blur, the bounds of top level nodes contain the objects
+ * over the whole shutter, which for fast motion makes most rays visit most
+ * nodes. These nodes also store their bounds at each motion step, expanded so
+ * that linear interpolation between steps contains the objects at any time
+ * in between. Rays test against the bounds interpolated at the ray time. */
+
+ccl_device_inline int bvh_motion_nodes(KernelGlobals *kg, float time)
+{
+	/* rays without time use the bounds over the whole shutter */
+	return (time == TIME_INVALID)? 0: kernel_data.bvh.num_motion_nodes;
+}
+
+ccl_device_inline void bvh_motion_step(KernelGlobals *kg, float time, int *step, float *t)
+{
+	float x = (time - kernel_data.bvh.motion_time_start)*kernel_data.bvh.motion_time_scale;
+	x = clamp(x, 0.0f, (float)(BVH_MOTION_STEPS-1));
+
+	int s = min((int)x, BVH_MOTION_STEPS-2);
+
+	*step = s;
+	*t = x - (float)s;
+}
+
+/* bounds of a regular node at the ray time, in the same layout as the first
+ * three float4 of the node */
+ccl_device_inline float4 bvh_motion_node_row(KernelGlobals *kg, int nodeAddr, int row, int step, float t)
+{
+	int offset = nodeAddr*BVH_NODE_MOTION_SIZE + step*3 + row;
+	float4 a = kernel_tex_fetch(__bvh_motion_nodes, offset);
+	float4 b = kernel_tex_fetch(__bvh_motion_nodes, offset + 3);
+
+	return a + (b - a)*t;
+}
+
+#ifdef __KERNEL_SSE2__
+ccl_device_inline void bvh_motion_node_bounds_sse(KernelGlobals *kg, int nodeAddr, int step, const __m128 &t, __m128 bounds[3])
+{
+	const __m128 *data = (__m128*)kg->__bvh_motion_nodes.data + nodeAddr*BVH_NODE_MOTION_SIZE + step*3;
+
+	bounds[0] = _mm_add_ps(data[0], _mm_mul_ps(_mm_sub_ps(data[3], data[0]), t));
+	bounds[1] = _mm_add_ps(data[1], _mm_mul_ps(_mm_sub_ps(data[4], data[1]), t));
+	bounds[2] = _mm_add_ps(data[2], _mm_mul_ps(_mm_sub_ps(data[5], data[2]), t));
+}
+#endif
+#endif
+
 /* Sven Woop's algorithm */
 ccl_device_inline bool bvh_triangle_intersect(KernelGlobals *kg, Intersection *isect,
 	float3 P, float3 idir, uint visibility, int object, int triAddr)
@@ -815,6 +875,169 @@ ccl_device_inline void bvh_triangle_intersect_subsurface(KernelGlobals *kg, Inte
 }
 #endif
 
+#ifdef __KERNEL_AVX__
+/* 8-wide BVH node intersection
+ *
+ * Nodes store eight floats per row for the eight children: min x, max x,
+ * min y, max y, min z, max z, visibility and child index. The near and far
+ * rows are picked by the sign of the ray direction, so all children can be
+ * tested with one AVX operation per plane. Empty children have inverted
+ * bounds and are never hit. */
+
+typedef struct OBVHRay {
+	__m256 P[3];
+	__m256 idir[3];
+	/* float offset of near and far rows per axis */
+	int near_row[3];
+	int far_row[3];
+	/* nodes with bounds per motion step, and interpolation at ray time */
+	int motion_nodes;
+	int motion_step;
+	__m256 motion_t;
+} OBVHRay;
+
+ccl_device_inline void obvh_ray_setup(OBVHRay *oray, float3 P, float3 idir)
+{
+	oray->P[0] = _mm256_set1_ps(P.x);
+	oray->P[1] = _mm256_set1_ps(P.y);
+	oray->P[2] = _mm256_set1_ps(P.z);
+
+	oray->idir[0] = _mm256_set1_ps(idir.x);
+	oray->idir[1] = _mm256_set1_ps(idir.y);
+	oray->idir[2] = _mm256_set1_ps(idir.z);
+
+	oray->near_row[0] = (idir.x >= 0.0f)? 0*8: 1*8;
+	oray->near_row[1] = (idir.y >= 0.0f)? 2*8: 3*8;
+	oray->near_row[2] = (idir.z >= 0.0f)? 4*8: 5*8;
+
+	oray->far_row[0] = (idir.x >= 0.0f)? 1*8: 0*8;
+	oray->far_row[1] = (idir.y >= 0.0f)? 3*8: 2*8;
+	oray->far_row[2] = (idir.z >= 0.0f)? 5*8: 4*8;
+}
+
+/* setup once per ray, unlike obvh_ray_setup this does not change for instances */
+ccl_device_inline void obvh_ray_motion_setup(OBVHRay *oray, int motion_nodes, int motion_step, float motion_t)
+{
+	oray->motion_nodes = motion_nodes;
+	oray->motion_step = motion_step;
+	oray->motion_t = _mm256_set1_ps(motion_t);
+}
+
+/* row of child bounds, interpolated at the ray time for motion nodes */
+ccl_device_inline __m256 obvh_node_row(const float *data, const float *motion_data, int row, const OBVHRay *oray)
+{
+	if(motion_data) {
+		const __m256 a = _mm256_loadu_ps(motion_data + row);
+		const __m256 b = _mm256_loadu_ps(motion_data + 6*8 + row);
+
+		return _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), oray->motion_t));
+	}
+
+	return _mm256_loadu_ps(data + row);
+}
+
+/* Intersect ray with the eight child bounding boxes of an inner node, returns
+ * a bit mask of children that are hit, and their entry and exit distances */
+ccl_device_inline int obvh_node_children_intersect(KernelGlobals *kg, int nodeAddr, const OBVHRay *oray,
+	float t, float *cnear, float *cfar)
+{
+	const float *data = (const float*)(kg->__bvh_nodes.data + nodeAddr*BVH_ONODE_SIZE);
+	const float *motion_data = NULL;
+
+	/* six rows of bounds per motion step */
+	if(nodeAddr < oray->motion_nodes)
+		motion_data = (const float*)(kg->__bvh_motion_nodes.data + nodeAddr*BVH_ONODE_MOTION_SIZE) + oray->motion_step*6*8;
+
+	/* intersect ray against child nodes */
+	__m256 tnear = _mm256_set1_ps(0.0f);
+	__m256 tfar = _mm256_set1_ps(t);
+
+	for(int axis = 0; axis < 3; axis++) {
+		const __m256 near_plane = obvh_node_row(data, motion_data, oray->near_row[axis], oray);
+		const __m256 far_plane = obvh_node_row(data, motion_data, oray->far_row[axis], oray);
+
+		tnear = _mm256_max_ps(tnear, _mm256_mul_ps(_mm256_sub_ps(near_plane, oray->P[axis]), oray->idir[axis]));
+		tfar = _mm256_min_ps(tfar, _mm256_mul_ps(_mm256_sub_ps(far_plane, oray->P[axis]), oray->idir[axis]));
+	}
+
+	_mm256_storeu_ps(cnear, tnear);
+	_mm256_storeu_ps(cfar, tfar);
+
+	return _mm256_movemask_ps(_mm256_cmp_ps(tnear, tfar, _CMP_LE_OQ));
+}
+
+/* Intersect ray with the children of an inner node. Children that are hit
+ * are pushed on the stack, farthest first, and the nearest is returned. If
+ * no child is hit the next node is popped from the stack. */
+ccl_device_inline int obvh_node_intersect(KernelGlobals *kg, int nodeAddr, const OBVHRay *oray,
+	float t, uint visibility, float difl, float extmax, int *traversalStack, int *stackPtr)
+{
+	const float *data = (const float*)(kg->__bvh_nodes.data + nodeAddr*BVH_ONODE_SIZE);
+	const uint *cvisibility = (const uint*)(data + 6*8);
+	const int *cnodes = (const int*)(data + 7*8);
+
+	float cnear[8], cfar[8];
+	int mask = obvh_node_children_intersect(kg, nodeAddr, oray, t, cnear, cfar);
+
+	if(difl != 0.0f) {
+		/* expand bounds of children containing curves */
+		float hdiff = 1.0f + difl;
+		float ldiff = 1.0f - difl;
+
+		for(int i = 0; i < 8; i++) {
+			if(cvisibility[i] & PATH_RAY_CURVE) {
+				cnear[i] = max(ldiff * cnear[i], cnear[i] - extmax);
+				cfar[i] = min(hdiff * cfar[i], cfar[i] + extmax);
+
+				if(cfar[i] >= cnear[i])
+					mask |= (1 << i);
+			}
+		}
+	}
+
+	/* sort intersected children by distance */
+	int hit_node[8];
+	float hit_dist[8];
+	int num_hits = 0;
+
+	for(int i = 0; i < 8; i++) {
+		if(!(mask & (1 << i)))
+			continue;
+
+#ifdef __VISIBILITY_FLAG__
+		if(!(cvisibility[i] & visibility))
+			continue;
+#endif
+
+		int j = num_hits++;
+
+		while(j > 0 && hit_dist[j-1] > cnear[i]) {
+			hit_node[j] = hit_node[j-1];
+			hit_dist[j] = hit_dist[j-1];
+			j--;
+		}
+
+		hit_node[j] = cnodes[i];
+		hit_dist[j] = cnear[i];
+	}
+
+	if(num_hits == 0) {
+		/* no child was intersected */
+		int next = traversalStack[*stackPtr];
+		--(*stackPtr);
+		return next;
+	}
+
+	/* push the farther children, traverse the nearest one */
+	for(int i = num_hits-1; i > 0; i--) {
+		++(*stackPtr);
+		traversalStack[*stackPtr] = hit_node[i];
+	}
+
+	return hit_node[0];
+}
+#endif
+
 /* BVH intersection function variations */
 
 #define BVH_INSTANCING			1
@@ -892,6 +1115,8 @@ bool scene_intersect(KernelGlobals *kg, const Ray *ray, const uint visibility, I
 bool scene_intersect(KernelGlobals *kg, const Ray *ray, const uint visibility, Intersection *isect)
 #endif
 {
+	KERNEL_STATS_STAGE(kg, STATS_STAGE_INTERSECT);
+
 #ifdef __OBJECT_MOTION__
 	if(kernel_data.bvh.have_motion) {
 #ifdef __HAIR__
@@ -936,6 +1161,9 @@ ccl_device_noinline
 #endif
 uint scene_intersect_subsurface(KernelGlobals *kg, const Ray *ray, Intersection *isect, int subsurface_object, uint *lcg_state, int max_hits)
 {
+	KERNEL_STATS_STAGE(kg, STATS_STAGE_INTERSECT);
+	KERNEL_STATS_RAY(kg, STATS_RAY_SUBSURFACE);
+
 #ifdef __OBJECT_MOTION__
 	if(kernel_data.bvh.have_motion) {
 #ifdef __HAIR__
@@ -972,6 +1200,10 @@ uint scene_intersect_subsurface(KernelGlobals *kg, const Ray *ray, Intersection
 }
 #endif
 
+#ifdef __RAY_STREAM__
+#include "kernel_bvh_stream.h"
+#endif
+
 /* Ray offset to avoid self intersection */
 
 ccl_device_inline float3 ray_offset(float3 P, float3 Ng)
@@ -0,0 +1,297 @@
+/*
+ * Copyright 2011-2014 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Ray Stream Traversal
+ *
+ * Coherent rays, like the camera rays of a tile row, are traversed through
+ * the BVH together, so each node is fetched once for all rays that reach it
+ * instead of once per ray. Every stack entry holds a node and a mask of the
+ * rays that still need to visit it, and child bounding boxes are tested
+ * against four rays at a time with SSE.
+ *
+ * Hair, motion blur and 8-wide BVH are not supported, in that case rays are
+ * traced one by one, see scene_intersect_stream_supported(). */
+
+#define BVH_STREAM_SIZE 64
+/* camera rays are gathered from square blocks of pixels */
+#define BVH_STREAM_BLOCK_SIZE 8
+
+typedef uint64_t RayMask;
+
+#define RAY_MASK_BIT(i) (((RayMask)1) << (i))
+
+/* rays in struct of arrays layout, padded to a multiple of four */
+typedef struct RayStream {
+	ccl_align(16) float P[3][BVH_STREAM_SIZE];
+	ccl_align(16) float idir[3][BVH_STREAM_SIZE];
+	ccl_align(16) float t[BVH_STREAM_SIZE];
+} RayStream;
+
+ccl_device_inline bool scene_intersect_stream_supported(KernelGlobals *kg)
+{
+	return !(kernel_data.bvh.have_curves || kernel_data.bvh.have_motion || kernel_data.bvh.use_obvh);
+}
+
+ccl_device_inline int ray_mask_first(RayMask mask)
+{
+#ifdef __GNUC__
+	return __builtin_ctzll(mask);
+#else
+	int i = 0;
+	while(!(mask & RAY_MASK_BIT(i)))
+		i++;
+	return i;
+#endif
+}
+
+ccl_device_inline void ray_stream_set(RayStream *stream, int i, float3 P, float3 idir, float t)
+{
+	stream->P[0][i] = P.x;
+	stream->P[1][i] = P.y;
+	stream->P[2][i] = P.z;
+	stream->idir[0][i] = idir.x;
+	stream->idir[1][i] = idir.y;
+	stream->idir[2][i] = idir.z;
+	stream->t[i] = t;
+}
+
+ccl_device_inline float3 ray_stream_P(const RayStream *stream, int i)
+{
+	return make_float3(stream->P[0][i], stream->P[1][i], stream->P[2][i]);
+}
+
+ccl_device_inline float3 ray_stream_idir(const RayStream *stream, int i)
+{
+	return make_float3(stream->idir[0][i], stream->idir[1][i], stream->idir[2][i]);
+}
+
+/* Intersect the rays in mask with the two children of a regular node. Returns
+ * the masks of rays hitting each child, and the nearest entry distance of any
+ * ray into each child to decide traversal order. */
+ccl_device_inline void bvh_stream_node_intersect(KernelGlobals *kg, int nodeAddr, const RayStream *stream,
+	RayMask mask, RayMask child_mask[2], float child_dist[2])
+{
+	const float4 node0 = kernel_tex_fetch(__bvh_nodes, nodeAddr*BVH_NODE_SIZE+0);
+	const float4 node1 = kernel_tex_fetch(__bvh_nodes, nodeAddr*BVH_NODE_SIZE+1);
+	const float4 node2 = kernel_tex_fetch(__bvh_nodes, nodeAddr*BVH_NODE_SIZE+2);
+
+	/* child bounds as { lo, hi } per axis */
+	const __m128 bounds[2][3][2] = {
+		{{_mm_set_ps1(node0.x), _mm_set_ps1(node0.z)},
+		 {_mm_set_ps1(node1.x), _mm_set_ps1(node1.z)},
+		 {_mm_set_ps1(node2.x), _mm_set_ps1(node2.z)}},
+		{{_mm_set_ps1(node0.y), _mm_set_ps1(node0.w)},
+		 {_mm_set_ps1(node1.y), _mm_set_ps1(node1.w)},
+		 {_mm_set_ps1(node2.y), _mm_set_ps1(node2.w)}}};
+
+	const __m128 flt_max = _mm_set_ps1(FLT_MAX);
+	__m128 dist[2] = {flt_max, flt_max};
+
+	child_mask[0] = child_mask[1] = 0;
+
+	/* loop over groups of four rays with any ray in mask */
+	for(RayMask remaining = mask; remaining; ) {
+		int i = ray_mask_first(remaining) & ~3;
+		int group = (int)((mask >> i) & 0xF);
+
+		remaining &= ~(((RayMask)0xF) << i);
+
+		const __m128 P[3] = {_mm_load_ps(&stream->P[0][i]), _mm_load_ps(&stream->P[1][i]), _mm_load_ps(&stream->P[2][i])};
+		const __m128 idir[3] = {_mm_load_ps(&stream->idir[0][i]), _mm_load_ps(&stream->idir[1][i]), _mm_load_ps(&stream->idir[2][i])};
+		const __m128 t = _mm_load_ps(&stream->t[i]);
+
+		for(int c = 0; c < 2; c++) {
+			__m128 tnear = _mm_setzero_ps();
+			__m128 tfar = t;
+
+			for(int axis = 0; axis < 3; axis++) {
+				const __m128 lo = _mm_mul_ps(_mm_sub_ps(bounds[c][axis][0], P[axis]), idir[axis]);
+				const __m128 hi = _mm_mul_ps(_mm_sub_ps(bounds[c][axis][1], P[axis]), idir[axis]);
+
+				tnear = _mm_max_ps(tnear, _mm_min_ps(lo, hi));
+				tfar = _mm_min_ps(tfar, _mm_max_ps(lo, hi));
+			}
+
+			const __m128 hitmask = _mm_cmple_ps(tnear, tfar);
+			int hit = _mm_movemask_ps(hitmask) & group;
+
+			if(hit) {
+				child_mask[c] |= ((RayMask)hit) << i;
+
+				/* nearest entry distance, only used for traversal order */
+				dist[c] = _mm_min_ps(dist[c], _mm_or_ps(_mm_and_ps(hitmask, tnear), _mm_andnot_ps(hitmask, flt_max)));
+			}
+		}
+	}
+
+	for(int c = 0; c < 2; c++) {
+		union { __m128 m128; float v[4]; } udist;
+		udist.m128 = dist[c];
+		child_dist[c] = min(min(udist.v[0], udist.v[1]), min(udist.v[2], udist.v[3]));
+	}
+}
+
+/* Intersect a stream of rays with the scene. Only rays in mask are traced,
+ * the other intersections are left untouched. All rays share the same
+ * visibility, for opaque shadow rays traversal stops at the first hit. */
+ccl_device void scene_intersect_stream(KernelGlobals *kg, const Ray *rays, Intersection *isects,
+	RayMask mask, const uint visibility)
+{
+	KERNEL_STATS_STAGE(kg, STATS_STAGE_INTERSECT);
+
+	/* traversal stack of nodes and the rays that still need to visit them */
+	int traversalStack[BVH_STACK_SIZE];
+	RayMask traversalMask[BVH_STACK_SIZE];
+	int stackPtr = 0;
+
+	RayStream stream;
+	RayMask active = mask;
+	int object = ~0;
+
+	for(int i = 0; i < BVH_STREAM_SIZE; i++) {
+		if(mask & RAY_MASK_BIT(i)) {
+			Intersection *isect = &isects[i];
+
+			isect->t = rays[i].t;
+			isect->object = ~0;
+			isect->prim = ~0;
+			isect->u = 0.0f;
+			isect->v = 0.0f;
+
+			ray_stream_set(&stream, i, rays[i].P, bvh_inverse_direction(rays[i].D), isect->t);
+		}
+		else {
+			/* padding, never hits anything */
+			ray_stream_set(&stream, i, make_float3(0.0f, 0.0f, 0.0f), make_float3(1.0f, 1.0f, 1.0f), -1.0f);
+		}
+	}
+
+	traversalStack[0] = kernel_data.bvh.root;
+	traversalMask[0] = mask;
+
+	while(stackPtr >= 0) {
+		int nodeAddr = traversalStack[stackPtr];
+		RayMask nodeMask = traversalMask[stackPtr];
+		--stackPtr;
+
+		if(nodeAddr == ENTRYPOINT_SENTINEL) {
+			/* instance pop, also for rays that terminated inside the instance */
+			for(RayMask remaining = nodeMask; remaining; remaining &= remaining - 1) {
+				int i = ray_mask_first(remaining);
+				float3 P = ray_stream_P(&stream, i);
+				float3 idir = ray_stream_idir(&stream, i);
+
+				bvh_instance_pop(kg, object, &rays[i], &P, &idir, &isects[i].t, rays[i].t);
+				ray_stream_set(&stream, i, P, idir, isects[i].t);
+			}
+
+			object = ~0;
+			continue;
+		}
+
+		/* skip rays that terminated */
+		nodeMask &= active;
+
+		if(nodeMask == 0)
+			continue;
+
+		if(nodeAddr >= 0) {
+			/* inner node, intersect two child bounding boxes four rays at a time */
+			float4 cnodes = kernel_tex_fetch(__bvh_nodes, nodeAddr*BVH_NODE_SIZE+3);
+			RayMask child_mask[2];
+			float child_dist[2];
+
+			KERNEL_STATS_COUNT(kg, bvh_nodes);
+
+			bvh_stream_node_intersect(kg, nodeAddr, &stream, nodeMask, child_mask, child_dist);
+
+#ifdef __VISIBILITY_FLAG__
+			if(!(__float_as_uint(cnodes.z) & visibility))
+				child_mask[0] = 0;
+			if(!(__float_as_uint(cnodes.w) & visibility))
+				child_mask[1] = 0;
+#endif
+
+			/* push the farther child first */
+			int first = (child_dist[1] < child_dist[0])? 1: 0;
+
+			if(child_mask[1 - first]) {
+				++stackPtr;
+				traversalStack[stackPtr] = __float_as_int((first == 0)? cnodes.y: cnodes.x);
+				traversalMask[stackPtr] = child_mask[1 - first];
+			}
+
+			if(child_mask[first]) {
+				++stackPtr;
+				traversalStack[stackPtr] = __float_as_int((first == 0)? cnodes.x: cnodes.y);
+				traversalMask[stackPtr] = child_mask[first];
+			}
+		}
+		else {
+			/* leaf node, fetch triangle list */
+			float4 leaf = kernel_tex_fetch(__bvh_nodes, (-nodeAddr-1)*BVH_NODE_SIZE+(BVH_NODE_SIZE-1));
+			int primAddr = __float_as_int(leaf.x);
+
+			if(primAddr >= 0) {
+				int primAddr2 = __float_as_int(leaf.y);
+
+				/* primitive intersection, per ray */
+				for(RayMask remaining = nodeMask; remaining; remaining &= remaining - 1) {
+					int i = ray_mask_first(remaining);
+
+					float3 P = ray_stream_P(&stream, i);
+					float3 idir = ray_stream_idir(&stream, i);
+					Intersection *isect = &isects[i];
+
+					for(int prim = primAddr; prim < primAddr2; prim++) {
+						KERNEL_STATS_COUNT(kg, bvh_primitives);
+
+						if(bvh_triangle_intersect(kg, isect, P, idir, visibility, object, prim)) {
+							stream.t[i] = isect->t;
+
+							/* shadow ray early termination */
+							if(visibility == PATH_RAY_SHADOW_OPAQUE) {
+								active &= ~RAY_MASK_BIT(i);
+								break;
+							}
+						}
+					}
+				}
+			}
+			else {
+				/* instance push, all rays use the same object transform since
+				 * motion blur is not supported */
+				object = kernel_tex_fetch(__prim_object, -primAddr-1);
+
+				for(RayMask remaining = nodeMask; remaining; remaining &= remaining - 1) {
+					int i = ray_mask_first(remaining);
+					float3 P, idir;
+
+					bvh_instance_push(kg, object, &rays[i], &P, &idir, &isects[i].t, rays[i].t);
+					ray_stream_set(&stream, i, P, idir, isects[i].t);
+				}
+
+				++stackPtr;
+				traversalStack[stackPtr] = ENTRYPOINT_SENTINEL;
+				traversalMask[stackPtr] = nodeMask;
+
+				++stackPtr;
+				traversalStack[stackPtr] = kernel_tex_fetch(__object_node, object);
+				traversalMask[stackPtr] = nodeMask;
+			}
+		}
+	}
+}
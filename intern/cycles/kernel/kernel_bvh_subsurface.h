@@ -59,6 +59,13 @@ ccl_device uint BVH_FUNCTION_NAME(KernelGlobals *kg, const Ray *ray, Intersectio
 
 #if FEATURE(BVH_MOTION)
 	Transform ob_tfm;
+
+	/* top level nodes with bounds at the ray time */
+	const int motion_nodes = bvh_motion_nodes(kg, ray->time);
+	int motion_step;
+	float motion_t;
+
+	bvh_motion_step(kg, ray->time, &motion_step, &motion_t);
 #endif
 
 #if defined(__KERNEL_SSE2__)
@@ -76,6 +83,20 @@ ccl_device uint BVH_FUNCTION_NAME(KernelGlobals *kg, const Ray *ray, Intersectio
 	__m128 tsplat = _mm_set_ps(-isect_t, -isect_t, 0.0f, 0.0f);
 
 	gen_idirsplat_swap(pn, shuf_identity, shuf_swap, idir, idirsplat, shufflexyz);
+
+#if FEATURE(BVH_MOTION)
+	const __m128 motion_tsplat = _mm_set_ps1(motion_t);
+#endif
+#endif
+
+#if defined(__KERNEL_AVX__)
+	OBVHRay oray;
+	obvh_ray_setup(&oray, P, idir);
+#if FEATURE(BVH_MOTION)
+	obvh_ray_motion_setup(&oray, motion_nodes, motion_step, motion_t);
+#else
+	obvh_ray_motion_setup(&oray, 0, 0, 0.0f);
+#endif
 #endif
 
 	/* traversal loop */
@@ -85,6 +106,16 @@ ccl_device uint BVH_FUNCTION_NAME(KernelGlobals *kg, const Ray *ray, Intersectio
 			/* traverse internal nodes */
 			while(nodeAddr >= 0 && nodeAddr != ENTRYPOINT_SENTINEL)
 			{
+				KERNEL_STATS_COUNT(kg, bvh_nodes);
+
+#if defined(__KERNEL_AVX__)
+				if(kernel_data.bvh.use_obvh) {
+					/* intersect eight child bounding boxes, AVX version */
+					nodeAddr = obvh_node_intersect(kg, nodeAddr, &oray, isect_t, visibility, 0.0f, 0.0f, traversalStack, &stackPtr);
+					continue;
+				}
+#endif
+
 				bool traverseChild0, traverseChild1;
 				int nodeAddrChild1;
 
@@ -98,6 +129,15 @@ ccl_device uint BVH_FUNCTION_NAME(KernelGlobals *kg, const Ray *ray, Intersectio
 				float4 node2 = kernel_tex_fetch(__bvh_nodes, nodeAddr*BVH_NODE_SIZE+2);
 				float4 cnodes = kernel_tex_fetch(__bvh_nodes, nodeAddr*BVH_NODE_SIZE+3);
 
+#if FEATURE(BVH_MOTION)
+				if(nodeAddr < motion_nodes) {
+					/* child bounds at ray time */
+					node0 = bvh_motion_node_row(kg, nodeAddr, 0, motion_step, motion_t);
+					node1 = bvh_motion_node_row(kg, nodeAddr, 1, motion_step, motion_t);
+					node2 = bvh_motion_node_row(kg, nodeAddr, 2, motion_step, motion_t);
+				}
+#endif
+
 				/* intersect ray against child nodes */
 				NO_EXTENDED_PRECISION float c0lox = (node0.x - P.x) * idir.x;
 				NO_EXTENDED_PRECISION float c0hix = (node0.z - P.x) * idir.x;
@@ -134,6 +174,16 @@ ccl_device uint BVH_FUNCTION_NAME(KernelGlobals *kg, const Ray *ray, Intersectio
 				const __m128 *bvh_nodes = (__m128*)kg->__bvh_nodes.data + nodeAddr*BVH_NODE_SIZE;
 				const float4 cnodes = ((float4*)bvh_nodes)[3];
 
+#if FEATURE(BVH_MOTION)
+				__m128 motion_bounds[3];
+
+				if(nodeAddr < motion_nodes) {
+					/* child bounds at ray time */
+					bvh_motion_node_bounds_sse(kg, nodeAddr, motion_step, motion_tsplat, motion_bounds);
+					bvh_nodes = motion_bounds;
+				}
+#endif
+
 				/* intersect ray against child nodes */
 				const __m128 tminmaxx = _mm_mul_ps(_mm_sub_ps(shuffle_swap(bvh_nodes[0], shufflexyz[0]), Psplat[0]), idirsplat[0]);
 				const __m128 tminmaxy = _mm_mul_ps(_mm_sub_ps(shuffle_swap(bvh_nodes[1], shufflexyz[1]), Psplat[1]), idirsplat[1]);
@@ -190,7 +240,12 @@ ccl_device uint BVH_FUNCTION_NAME(KernelGlobals *kg, const Ray *ray, Intersectio
 
 			/* if node is leaf, fetch triangle list */
 			if(nodeAddr < 0) {
-				float4 leaf = kernel_tex_fetch(__bvh_nodes, (-nodeAddr-1)*BVH_NODE_SIZE+(BVH_NODE_SIZE-1));
+#if defined(__KERNEL_AVX__)
+				const int nodeSize = (kernel_data.bvh.use_obvh)? BVH_ONODE_SIZE: BVH_NODE_SIZE;
+#else
+				const int nodeSize = BVH_NODE_SIZE;
+#endif
+				float4 leaf = kernel_tex_fetch(__bvh_nodes, (-nodeAddr-1)*nodeSize+(nodeSize-1));
 				int primAddr = __float_as_int(leaf.x);
 
 #if FEATURE(BVH_INSTANCING)
@@ -214,6 +269,7 @@ ccl_device uint BVH_FUNCTION_NAME(KernelGlobals *kg, const Ray *ray, Intersectio
 						uint tri_object = (object == ~0)? kernel_tex_fetch(__prim_object, primAddr): object;
 
 						if(tri_object == subsurface_object) {
+							KERNEL_STATS_COUNT(kg, bvh_primitives);
 
 							/* intersect ray against primitive */
 							bvh_triangle_intersect_subsurface(kg, isect_array, P, idir, object, primAddr, isect_t, &num_hits, lcg_state, max_hits);
@@ -242,6 +298,10 @@ ccl_device uint BVH_FUNCTION_NAME(KernelGlobals *kg, const Ray *ray, Intersectio
 						gen_idirsplat_swap(pn, shuf_identity, shuf_swap, idir, idirsplat, shufflexyz);
 #endif
 
+#if defined(__KERNEL_AVX__)
+						obvh_ray_setup(&oray, P, idir);
+#endif
+
 						++stackPtr;
 						traversalStack[stackPtr] = ENTRYPOINT_SENTINEL;
 
@@ -278,6 +338,10 @@ ccl_device uint BVH_FUNCTION_NAME(KernelGlobals *kg, const Ray *ray, Intersectio
 			gen_idirsplat_swap(pn, shuf_identity, shuf_swap, idir, idirsplat, shufflexyz);
 #endif
 
+#if defined(__KERNEL_AVX__)
+			obvh_ray_setup(&oray, P, idir);
+#endif
+
 			object = ~0;
 			nodeAddr = traversalStack[stackPtr];
 			--stackPtr;
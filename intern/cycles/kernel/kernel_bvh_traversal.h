@@ -61,6 +61,13 @@ ccl_device bool BVH_FUNCTION_NAME
 
 #if FEATURE(BVH_MOTION)
 	Transform ob_tfm;
+
+	/* top level nodes with bounds at the ray time */
+	const int motion_nodes = bvh_motion_nodes(kg, ray->time);
+	int motion_step;
+	float motion_t;
+
+	bvh_motion_step(kg, ray->time, &motion_step, &motion_t);
 #endif
 
 	isect->t = tmax;
@@ -84,6 +91,20 @@ ccl_device bool BVH_FUNCTION_NAME
 	__m128 tsplat = _mm_set_ps(-isect->t, -isect->t, 0.0f, 0.0f);
 
 	gen_idirsplat_swap(pn, shuf_identity, shuf_swap, idir, idirsplat, shufflexyz);
+
+#if FEATURE(BVH_MOTION)
+	const __m128 motion_tsplat = _mm_set_ps1(motion_t);
+#endif
+#endif
+
+#if defined(__KERNEL_AVX__)
+	OBVHRay oray;
+	obvh_ray_setup(&oray, P, idir);
+#if FEATURE(BVH_MOTION)
+	obvh_ray_motion_setup(&oray, motion_nodes, motion_step, motion_t);
+#else
+	obvh_ray_motion_setup(&oray, 0, 0, 0.0f);
+#endif
 #endif
 
 	/* traversal loop */
@@ -93,6 +114,20 @@ ccl_device bool BVH_FUNCTION_NAME
 			/* traverse internal nodes */
 			while(nodeAddr >= 0 && nodeAddr != ENTRYPOINT_SENTINEL)
 			{
+				KERNEL_STATS_COUNT(kg, bvh_nodes);
+
+#if defined(__KERNEL_AVX__)
+				if(kernel_data.bvh.use_obvh) {
+					/* intersect eight child bounding boxes, AVX version */
+#if FEATURE(BVH_HAIR_MINIMUM_WIDTH)
+					nodeAddr = obvh_node_intersect(kg, nodeAddr, &oray, isect->t, visibility, difl, extmax, traversalStack, &stackPtr);
+#else
+					nodeAddr = obvh_node_intersect(kg, nodeAddr, &oray, isect->t, visibility, 0.0f, 0.0f, traversalStack, &stackPtr);
+#endif
+					continue;
+				}
+#endif
+
 				bool traverseChild0, traverseChild1;
 				int nodeAddrChild1;
 
@@ -106,6 +141,15 @@ ccl_device bool BVH_FUNCTION_NAME
 				float4 node2 = kernel_tex_fetch(__bvh_nodes, nodeAddr*BVH_NODE_SIZE+2);
 				float4 cnodes = kernel_tex_fetch(__bvh_nodes, nodeAddr*BVH_NODE_SIZE+3);
 
+#if FEATURE(BVH_MOTION)
+				if(nodeAddr < motion_nodes) {
+					/* child bounds at ray time */
+					node0 = bvh_motion_node_row(kg, nodeAddr, 0, motion_step, motion_t);
+					node1 = bvh_motion_node_row(kg, nodeAddr, 1, motion_step, motion_t);
+					node2 = bvh_motion_node_row(kg, nodeAddr, 2, motion_step, motion_t);
+				}
+#endif
+
 				/* intersect ray against child nodes */
 				NO_EXTENDED_PRECISION float c0lox = (node0.x - P.x) * idir.x;
 				NO_EXTENDED_PRECISION float c0hix = (node0.z - P.x) * idir.x;
@@ -157,6 +201,16 @@ ccl_device bool BVH_FUNCTION_NAME
 				const __m128 *bvh_nodes = (__m128*)kg->__bvh_nodes.data + nodeAddr*BVH_NODE_SIZE;
 				const float4 cnodes = ((float4*)bvh_nodes)[3];
 
+#if FEATURE(BVH_MOTION)
+				__m128 motion_bounds[3];
+
+				if(nodeAddr < motion_nodes) {
+					/* child bounds at ray time */
+					bvh_motion_node_bounds_sse(kg, nodeAddr, motion_step, motion_tsplat, motion_bounds);
+					bvh_nodes = motion_bounds;
+				}
+#endif
+
 				/* intersect ray against child nodes */
 				const __m128 tminmaxx = _mm_mul_ps(_mm_sub_ps(shuffle_swap(bvh_nodes[0], shufflexyz[0]), Psplat[0]), idirsplat[0]);
 				const __m128 tminmaxy = _mm_mul_ps(_mm_sub_ps(shuffle_swap(bvh_nodes[1], shufflexyz[1]), Psplat[1]), idirsplat[1]);
@@ -235,7 +289,12 @@ ccl_device bool BVH_FUNCTION_NAME
 
 			/* if node is leaf, fetch triangle list */
 			if(nodeAddr < 0) {
-				float4 leaf = kernel_tex_fetch(__bvh_nodes, (-nodeAddr-1)*BVH_NODE_SIZE+(BVH_NODE_SIZE-1));
+#if defined(__KERNEL_AVX__)
+				const int nodeSize = (kernel_data.bvh.use_obvh)? BVH_ONODE_SIZE: BVH_NODE_SIZE;
+#else
+				const int nodeSize = BVH_NODE_SIZE;
+#endif
+				float4 leaf = kernel_tex_fetch(__bvh_nodes, (-nodeAddr-1)*nodeSize+(nodeSize-1));
 				int primAddr = __float_as_int(leaf.x);
 
 #if FEATURE(BVH_INSTANCING)
@@ -251,6 +310,8 @@ ccl_device bool BVH_FUNCTION_NAME
 					while(primAddr < primAddr2) {
 						bool hit;
 
+						KERNEL_STATS_COUNT(kg, bvh_primitives);
+
 						/* intersect ray against primitive */
 #if FEATURE(BVH_HAIR)
 						uint segment = kernel_tex_fetch(__prim_segment, primAddr);
@@ -308,6 +369,10 @@ ccl_device bool BVH_FUNCTION_NAME
 					gen_idirsplat_swap(pn, shuf_identity, shuf_swap, idir, idirsplat, shufflexyz);
 #endif
 
+#if defined(__KERNEL_AVX__)
+					obvh_ray_setup(&oray, P, idir);
+#endif
+
 					++stackPtr;
 					traversalStack[stackPtr] = ENTRYPOINT_SENTINEL;
 
@@ -338,6 +403,10 @@ ccl_device bool BVH_FUNCTION_NAME
 			gen_idirsplat_swap(pn, shuf_identity, shuf_swap, idir, idirsplat, shufflexyz);
 #endif
 
+#if defined(__KERNEL_AVX__)
+			obvh_ray_setup(&oray, P, idir);
+#endif
+
 			object = ~0;
 			nodeAddr = traversalStack[stackPtr];
 			--stackPtr;
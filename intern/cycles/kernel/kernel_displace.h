@@ -19,10 +19,12 @@ CCL_NAMESPACE_BEGIN
 ccl_device void kernel_shader_evaluate(KernelGlobals *kg, ccl_global uint4 *input, ccl_global float4 *output, ShaderEvalType type, int i)
 {
 	ShaderData sd;
-	uint4 in = input[i];
 	float3 out;
+	float out_w = 0.0f;
 
 	if(type == SHADER_EVAL_DISPLACE) {
+		uint4 in = input[i];
+
 		/* setup shader data */
 		int object = in.x;
 		int prim = in.y;
@@ -36,7 +38,72 @@ ccl_device void kernel_shader_evaluate(KernelGlobals *kg, ccl_global uint4 *inpu
 		shader_eval_displacement(kg, &sd, SHADER_CONTEXT_MAIN);
 		out = sd.P - P;
 	}
+#ifdef __VOLUME__
+	else if(type == SHADER_EVAL_VOLUME) {
+		/* two input elements per evaluation, the position and the
+		 * object and shader of the volume */
+		uint4 in_P = input[i*2];
+		uint4 in_shader = input[i*2 + 1];
+
+		/* setup ray */
+		Ray ray;
+
+		ray.P = make_float3(__uint_as_float(in_P.x), __uint_as_float(in_P.y), __uint_as_float(in_P.z));
+		ray.D = make_float3(0.0f, 0.0f, 1.0f);
+		ray.t = 0.0f;
+#ifdef __CAMERA_MOTION__
+		ray.time = 0.5f;
+#endif
+
+#ifdef __RAY_DIFFERENTIALS__
+		ray.dD = differential3_zero();
+		ray.dP = differential3_zero();
+#endif
+
+		/* setup shader data */
+		VolumeStack stack[2];
+
+		stack[0].object = in_shader.x;
+		stack[0].shader = in_shader.y;
+		stack[1].shader = SHADER_NO_ID;
+
+		shader_setup_from_volume(kg, &sd, &ray, 0);
+
+		/* evaluate extinction */
+		shader_eval_volume(kg, &sd, stack, PATH_RAY_SHADOW, SHADER_CONTEXT_SHADOW);
+
+		out = make_float3(0.0f, 0.0f, 0.0f);
+
+		if(sd.flag & (SD_ABSORPTION|SD_SCATTER)) {
+			for(int j = 0; j < sd.num_closure; j++) {
+				const ShaderClosure *sc = &sd.closure[j];
+
+				if(CLOSURE_IS_VOLUME(sc->type))
+					out += sc->weight;
+			}
+		}
+
+		/* evaluate emission as seen by camera rays, delta tracking needs to
+		 * know where it must sample collisions to find emission */
+		shader_eval_volume(kg, &sd, stack, PATH_RAY_CAMERA, SHADER_CONTEXT_VOLUME);
+
+		if(sd.flag & SD_EMISSION) {
+			float3 emission = make_float3(0.0f, 0.0f, 0.0f);
+
+			for(int j = 0; j < sd.num_closure; j++) {
+				const ShaderClosure *sc = &sd.closure[j];
+
+				if(CLOSURE_IS_EMISSION(sc->type))
+					emission += sc->weight;
+			}
+
+			out_w = max(max(fabsf(emission.x), fabsf(emission.y)), fabsf(emission.z));
+		}
+	}
+#endif
 	else { // SHADER_EVAL_BACKGROUND
+		uint4 in = input[i];
+
 		/* setup ray */
 		Ray ray;
 		float u = __uint_as_float(in.x);
@@ -63,7 +130,7 @@ ccl_device void kernel_shader_evaluate(KernelGlobals *kg, ccl_global uint4 *inpu
 	}
 	
 	/* write output */
-	output[i] = make_float4(out.x, out.y, out.z, 0.0f);
+	output[i] = make_float4(out.x, out.y, out.z, out_w);
 }
 
 CCL_NAMESPACE_END
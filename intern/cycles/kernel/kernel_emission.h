@@ -74,6 +74,8 @@ ccl_device_noinline bool direct_emission(KernelGlobals *kg, ShaderData *sd, int
 	float randt, float rando, float randu, float randv, Ray *ray, BsdfEval *eval,
 	bool *is_lamp, int bounce)
 {
+	KERNEL_STATS_STAGE(kg, STATS_STAGE_LIGHT);
+
 	LightSample ls;
 
 #ifdef __BRANCHED_PATH__
@@ -179,7 +181,8 @@ ccl_device_noinline float3 indirect_primitive_emission(KernelGlobals *kg, Shader
 #endif
 		/* multiple importance sampling, get triangle light pdf,
 		 * and compute weight with respect to BSDF pdf */
-		float pdf = triangle_light_pdf(kg, sd->Ng, sd->I, t);
+		float3 ray_P = sd->P + sd->I*t;
+		float pdf = triangle_light_pdf(kg, triangle_light_area_pdf(kg, sd->object, ray_P), sd->Ng, sd->I, t);
 		float mis_weight = power_heuristic(bsdf_pdf, pdf);
 
 		return L*mis_weight;
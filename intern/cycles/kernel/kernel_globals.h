@@ -16,6 +16,12 @@
 
 /* Constant Globals */
 
+#ifdef __KERNEL_STATS__
+#include "util_stats.h"
+#endif
+
+#include "kernel_stats.h"
+
 CCL_NAMESPACE_BEGIN
 
 /* On the CPU, we pass along the struct KernelGlobals to nearly everywhere in
@@ -31,6 +37,9 @@ struct OSLThreadData;
 struct OSLShadingSystem;
 #endif
 
+struct TextureCacheGlobals;
+struct TextureCacheThreadData;
+
 #define MAX_BYTE_IMAGES   1024
 #define MAX_FLOAT_IMAGES  1024
 
@@ -52,6 +61,16 @@ typedef struct KernelGlobals {
 	OSLThreadData *osl_tdata;
 #endif
 
+	/* Images that are not loaded into memory are read through the texture
+	 * cache, NULL if no image uses it. */
+	TextureCacheGlobals *tex_cache;
+	TextureCacheThreadData *tex_cache_tdata;
+
+#ifdef __KERNEL_STATS__
+	/* per thread statistics */
+	KernelStats stats;
+#endif
+
 } KernelGlobals;
 
 #endif
@@ -426,6 +426,78 @@ ccl_device bool lamp_light_eval(KernelGlobals *kg, int lamp, float3 P, float3 D,
 	return true;
 }
 
+/* Light Tree
+ *
+ * Each node is LIGHT_TREE_NODE_SIZE float4s: bounds min and energy, bounds max,
+ * and children or leaf data with the parent index. Leaves point to a range of
+ * the light distribution, which is one lamp or the emissive triangles of one
+ * object. Distant and background lights can't be bounded, they are stored as
+ * leaves in front of the root and picked with the same probability as in the
+ * light distribution. */
+
+#ifdef __LIGHT_TREE__
+
+ccl_device float light_tree_node_importance(KernelGlobals *kg, int node, float3 P)
+{
+	float4 bmin = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 0);
+	float4 bmax = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 1);
+
+	float3 center = 0.5f*(float4_to_float3(bmin) + float4_to_float3(bmax));
+	float3 extent = 0.5f*(float4_to_float3(bmax) - float4_to_float3(bmin));
+
+	/* energy over squared distance, the distance is clamped to the size of
+	 * the node so points inside or close to it don't prefer it too much */
+	float dist_sq = len_squared(center - P);
+	float radius_sq = len_squared(extent);
+
+	return bmin.w/max(max(dist_sq, radius_sq), 1e-8f);
+}
+
+ccl_device float light_tree_left_probability(KernelGlobals *kg, int left, int right, float3 P)
+{
+	float left_importance = light_tree_node_importance(kg, left, P);
+	float right_importance = light_tree_node_importance(kg, right, P);
+	float total = left_importance + right_importance;
+
+	return (total > 0.0f)? left_importance/total: 0.5f;
+}
+
+/* probability of picking a leaf from shading point P */
+ccl_device float light_tree_leaf_pdf(KernelGlobals *kg, int node, float3 P)
+{
+	float pdf = kernel_data.integrator.light_tree_pdf;
+	int parent = __float_as_int(kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 2).w);
+
+	while(parent != -1) {
+		float4 data = kernel_tex_fetch(__light_tree_nodes, parent*LIGHT_TREE_NODE_SIZE + 2);
+		int left = __float_as_int(data.x);
+		int right = __float_as_int(data.y);
+		float left_pdf = light_tree_left_probability(kg, left, right, P);
+
+		pdf *= (node == left)? left_pdf: 1.0f - left_pdf;
+
+		node = parent;
+		parent = __float_as_int(data.w);
+	}
+
+	return pdf;
+}
+
+/* pdf per area of sampling a point on an emissive triangle of object */
+ccl_device float light_tree_triangle_pdf(KernelGlobals *kg, int object, float3 P)
+{
+	int node = (int)kernel_tex_fetch(__light_tree_objects, object);
+
+	if(node == ~0)
+		return 0.0f;
+
+	float inv_area = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 2).z;
+
+	return light_tree_leaf_pdf(kg, node, P)*inv_area;
+}
+
+#endif
+
 /* Triangle Light */
 
 ccl_device void object_transform_light_sample(KernelGlobals *kg, LightSample *ls, int object, float time)
@@ -473,10 +545,20 @@ ccl_device void triangle_light_sample(KernelGlobals *kg, int prim, int object,
 	object_transform_light_sample(kg, ls, object, time);
 }
 
-ccl_device float triangle_light_pdf(KernelGlobals *kg,
+/* pdf per area of sampling a point on a triangle of object, from shading point P */
+ccl_device float triangle_light_area_pdf(KernelGlobals *kg, int object, float3 P)
+{
+#ifdef __LIGHT_TREE__
+	if(kernel_data.integrator.use_light_tree)
+		return light_tree_triangle_pdf(kg, object, P);
+#endif
+
+	return kernel_data.integrator.pdf_triangles;
+}
+
+ccl_device float triangle_light_pdf(KernelGlobals *kg, float pdf,
 	const float3 Ng, const float3 I, float t)
 {
-	float pdf = kernel_data.integrator.pdf_triangles;
 	float cos_pi = fabsf(dot(Ng, I));
 
 	if(cos_pi == 0.0f)
@@ -562,11 +644,11 @@ ccl_device int light_distribution_sample(KernelGlobals *kg, float randt)
 
 /* Generic Light */
 
-ccl_device void light_sample(KernelGlobals *kg, float randt, float randu, float randv, float time, float3 P, LightSample *ls)
+/* sample a position on the light at index in the distribution, triangle_pdf
+ * is the pdf per area for triangles, including the probability of picking it */
+ccl_device void light_distribution_light_sample(KernelGlobals *kg, int index, float triangle_pdf,
+	float randu, float randv, float time, float3 P, LightSample *ls)
 {
-	/* sample index */
-	int index = light_distribution_sample(kg, randt);
-
 	/* fetch light data */
 	float4 l = kernel_tex_fetch(__light_distribution, index);
 	int prim = __float_as_int(l.y);
@@ -586,7 +668,7 @@ ccl_device void light_sample(KernelGlobals *kg, float randt, float randu, float
 
 		/* compute incoming direction, distance and pdf */
 		ls->D = normalize_len(ls->P - P, &ls->t);
-		ls->pdf = triangle_light_pdf(kg, ls->Ng, -ls->D, ls->t);
+		ls->pdf = triangle_light_pdf(kg, triangle_pdf, ls->Ng, -ls->D, ls->t);
 		ls->shader |= __float_as_int(l.z) & (~SHADER_MASK);
 	}
 	else {
@@ -595,6 +677,91 @@ ccl_device void light_sample(KernelGlobals *kg, float randt, float randu, float
 	}
 }
 
+#ifdef __LIGHT_TREE__
+
+ccl_device void light_tree_sample(KernelGlobals *kg, float randt, float randu, float randv, float time, float3 P, LightSample *ls)
+{
+	int num_distant = kernel_data.integrator.light_tree_num_distant;
+	float pdf_lights = kernel_data.integrator.pdf_lights;
+	float distant_pdf = num_distant*pdf_lights;
+	int node;
+	float pdf;
+
+	if(randt < distant_pdf) {
+		/* distant lights, picked uniformly */
+		node = min(float_to_int(randt/pdf_lights), num_distant - 1);
+		pdf = pdf_lights;
+		randt = 0.0f;
+	}
+	else {
+		/* descend the tree, picking children proportional to their importance
+		 * and reusing randt for the next level */
+		node = num_distant;
+		pdf = kernel_data.integrator.light_tree_pdf;
+		randt = min((randt - distant_pdf)/pdf, 1.0f - 1e-7f);
+
+		for(;;) {
+			float4 data = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 2);
+			int left = __float_as_int(data.x);
+
+			if(left < 0)
+				break;
+
+			int right = __float_as_int(data.y);
+			float left_pdf = light_tree_left_probability(kg, left, right, P);
+
+			if(randt < left_pdf) {
+				randt = randt/left_pdf;
+				pdf *= left_pdf;
+				node = left;
+			}
+			else {
+				randt = (randt - left_pdf)/(1.0f - left_pdf);
+				pdf *= 1.0f - left_pdf;
+				node = right;
+			}
+		}
+	}
+
+	/* pick light in leaf proportional to area, as in the distribution */
+	float4 data = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 2);
+	int first = ~__float_as_int(data.x);
+	int num = __float_as_int(data.y);
+	int index = first;
+
+	if(num > 1) {
+		float cdf_first = kernel_tex_fetch(__light_distribution, first).x;
+		float cdf_last = kernel_tex_fetch(__light_distribution, first + num).x;
+
+		index = light_distribution_sample(kg, cdf_first + randt*(cdf_last - cdf_first));
+		index = clamp(index, first, first + num - 1);
+	}
+
+	light_distribution_light_sample(kg, index, pdf*data.z, randu, randv, time, P, ls);
+
+	/* lamps compensate for being picked in eval_fac rather than pdf */
+	if(ls->lamp != ~0)
+		ls->eval_fac *= pdf_lights/pdf;
+}
+
+#endif
+
+ccl_device void light_sample(KernelGlobals *kg, float randt, float randu, float randv, float time, float3 P, LightSample *ls)
+{
+#ifdef __LIGHT_TREE__
+	if(kernel_data.integrator.use_light_tree) {
+		light_tree_sample(kg, randt, randu, randv, time, P, ls);
+		return;
+	}
+#endif
+
+	/* sample index */
+	int index = light_distribution_sample(kg, randt);
+
+	light_distribution_light_sample(kg, index, kernel_data.integrator.pdf_triangles,
+		randu, randv, time, P, ls);
+}
+
 ccl_device int light_select_num_samples(KernelGlobals *kg, int index)
 {
 	float4 data3 = kernel_tex_fetch(__light_data, index*LIGHT_SIZE + 3);
@@ -172,5 +172,51 @@ ccl_device_inline void kernel_write_light_passes(KernelGlobals *kg, ccl_global f
 #endif
 }
 
-CCL_NAMESPACE_END
+#ifdef __ADAPTIVE_SAMPLING__
+
+/* Adaptive Sampling
+ *
+ * Per pixel we store the number of samples taken and the sum of squared
+ * luminance, together with the combined pass this gives the standard error
+ * of the pixel mean. Pixels stop being sampled once the error is below the
+ * threshold, relative to the square root of the mean so dark pixels are not
+ * sampled forever. Film conversion divides by the per pixel sample count. */
+
+ccl_device bool kernel_adaptive_pixel_converged(KernelGlobals *kg, ccl_global float *buffer, int sample)
+{
+	if(!kernel_data.integrator.use_adaptive_sampling || sample < kernel_data.integrator.adaptive_min_samples)
+		return false;
+
+	float num_samples = buffer[kernel_data.film.pass_sample_count];
+
+	if(num_samples < 1.0f)
+		return false;
+
+	float4 sum = *((ccl_global float4*)(buffer + kernel_data.film.pass_combined));
+	float sum_sq = buffer[kernel_data.film.pass_sample_moment];
+
+	float inv_num_samples = 1.0f/num_samples;
+	float mean = average(float4_to_float3(sum))*inv_num_samples;
+	float variance = max(sum_sq*inv_num_samples - mean*mean, 0.0f);
+	float error = sqrtf(variance*inv_num_samples);
+
+	return error <= kernel_data.integrator.adaptive_threshold*sqrtf(max(mean, 1e-4f));
+}
 
+#endif
+
+ccl_device_inline void kernel_write_sample_passes(KernelGlobals *kg, ccl_global float *buffer, int sample, float4 L)
+{
+#ifdef __ADAPTIVE_SAMPLING__
+	int flag = kernel_data.film.pass_flag;
+
+	if(flag & PASS_SAMPLE_COUNT)
+		kernel_write_pass_float(buffer + kernel_data.film.pass_sample_count, sample, 1.0f);
+	if(flag & PASS_SAMPLE_MOMENT) {
+		float value = average(float4_to_float3(L));
+		kernel_write_pass_float(buffer + kernel_data.film.pass_sample_moment, sample, value*value);
+	}
+#endif
+}
+
+CCL_NAMESPACE_END
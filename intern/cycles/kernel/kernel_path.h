@@ -141,6 +141,9 @@ ccl_device void kernel_path_indirect(KernelGlobals *kg, RNG *rng, Ray ray, ccl_g
 		/* intersect scene */
 		Intersection isect;
 		uint visibility = path_state_ray_visibility(kg, &state);
+
+		KERNEL_STATS_RAY(kg, STATS_RAY_INDIRECT);
+
 #ifdef __HAIR__
 		bool hit = scene_intersect(kg, &ray, visibility, &isect, NULL, 0.0f, 0.0f);
 #else
@@ -526,7 +529,8 @@ ccl_device_inline bool kernel_path_integrate_lighting(KernelGlobals *kg, RNG *rn
 
 #endif
 
-ccl_device float4 kernel_path_integrate(KernelGlobals *kg, RNG *rng, int sample, Ray ray, ccl_global float *buffer)
+ccl_device float4 kernel_path_integrate(KernelGlobals *kg, RNG *rng, int sample, Ray ray, ccl_global float *buffer,
+	const Intersection *camera_isect)
 {
 	/* initialize */
 	PathRadiance L;
@@ -543,26 +547,40 @@ ccl_device float4 kernel_path_integrate(KernelGlobals *kg, RNG *rng, int sample,
 		/* intersect scene */
 		Intersection isect;
 		uint visibility = path_state_ray_visibility(kg, &state);
+		bool hit;
+
+		KERNEL_STATS_RAY(kg, (state.flag & PATH_RAY_CAMERA)? STATS_RAY_CAMERA: STATS_RAY_INDIRECT);
 
+#ifdef __RAY_STREAM__
+		if(camera_isect) {
+			/* camera ray was already intersected as part of a ray stream */
+			isect = *camera_isect;
+			hit = (isect.prim != ~0);
+			camera_isect = NULL;
+		}
+		else
+#endif
+		{
 #ifdef __HAIR__
-		float difl = 0.0f, extmax = 0.0f;
-		uint lcg_state = 0;
+			float difl = 0.0f, extmax = 0.0f;
+			uint lcg_state = 0;
+
+			if(kernel_data.bvh.have_curves) {
+				if((kernel_data.cam.resolution == 1) && (state.flag & PATH_RAY_CAMERA)) {	
+					float3 pixdiff = ray.dD.dx + ray.dD.dy;
+					/*pixdiff = pixdiff - dot(pixdiff, ray.D)*ray.D;*/
+					difl = kernel_data.curve.minimum_width * len(pixdiff) * 0.5f;
+				}
 
-		if(kernel_data.bvh.have_curves) {
-			if((kernel_data.cam.resolution == 1) && (state.flag & PATH_RAY_CAMERA)) {	
-				float3 pixdiff = ray.dD.dx + ray.dD.dy;
-				/*pixdiff = pixdiff - dot(pixdiff, ray.D)*ray.D;*/
-				difl = kernel_data.curve.minimum_width * len(pixdiff) * 0.5f;
+				extmax = kernel_data.curve.maximum_width;
+				lcg_state = lcg_state_init(rng, &state, 0x51633e2d);
 			}
 
-			extmax = kernel_data.curve.maximum_width;
-			lcg_state = lcg_state_init(rng, &state, 0x51633e2d);
-		}
-
-		bool hit = scene_intersect(kg, &ray, visibility, &isect, &lcg_state, difl, extmax);
+			hit = scene_intersect(kg, &ray, visibility, &isect, &lcg_state, difl, extmax);
 #else
-		bool hit = scene_intersect(kg, &ray, visibility, &isect);
+			hit = scene_intersect(kg, &ray, visibility, &isect);
 #endif
+		}
 
 #ifdef __LAMP_MIS__
 		if(kernel_data.integrator.use_lamp_mis && !(state.flag & PATH_RAY_CAMERA)) {
@@ -1070,6 +1088,8 @@ ccl_device float4 kernel_branched_path_integrate(KernelGlobals *kg, RNG *rng, in
 		Intersection isect;
 		uint visibility = path_state_ray_visibility(kg, &state);
 
+		KERNEL_STATS_RAY(kg, (state.flag & PATH_RAY_CAMERA)? STATS_RAY_CAMERA: STATS_RAY_INDIRECT);
+
 #ifdef __HAIR__
 		float difl = 0.0f, extmax = 0.0f;
 		uint lcg_state = 0;
@@ -1354,7 +1374,7 @@ ccl_device_inline void kernel_path_trace_setup(KernelGlobals *kg, ccl_global uin
 	camera_sample(kg, x, y, filter_u, filter_v, lens_u, lens_v, time, ray);
 }
 
-ccl_device void kernel_path_trace(KernelGlobals *kg,
+ccl_device bool kernel_path_trace(KernelGlobals *kg,
 	ccl_global float *buffer, ccl_global uint *rng_state,
 	int sample, int x, int y, int offset, int stride)
 {
@@ -1365,6 +1385,13 @@ ccl_device void kernel_path_trace(KernelGlobals *kg,
 	rng_state += index;
 	buffer += index*pass_stride;
 
+#ifdef __ADAPTIVE_SAMPLING__
+	/* converged pixels are skipped, returning false lets the device stop
+	 * sampling a tile early once none of its pixels were sampled */
+	if(kernel_adaptive_pixel_converged(kg, buffer, sample))
+		return false;
+
+#endif
 	/* initialize random numbers and ray */
 	RNG rng;
 	Ray ray;
@@ -1375,18 +1402,21 @@ ccl_device void kernel_path_trace(KernelGlobals *kg,
 	float4 L;
 
 	if(ray.t != 0.0f)
-		L = kernel_path_integrate(kg, &rng, sample, ray, buffer);
+		L = kernel_path_integrate(kg, &rng, sample, ray, buffer, NULL);
 	else
 		L = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
 
 	/* accumulate result in output buffer */
 	kernel_write_pass_float4(buffer, sample, L);
+	kernel_write_sample_passes(kg, buffer, sample, L);
 
 	path_rng_end(kg, rng_state, rng);
+
+	return true;
 }
 
 #ifdef __BRANCHED_PATH__
-ccl_device void kernel_branched_path_trace(KernelGlobals *kg,
+ccl_device bool kernel_branched_path_trace(KernelGlobals *kg,
 	ccl_global float *buffer, ccl_global uint *rng_state,
 	int sample, int x, int y, int offset, int stride)
 {
@@ -1397,6 +1427,13 @@ ccl_device void kernel_branched_path_trace(KernelGlobals *kg,
 	rng_state += index;
 	buffer += index*pass_stride;
 
+#ifdef __ADAPTIVE_SAMPLING__
+	/* converged pixels are skipped, returning false lets the device stop
+	 * sampling a tile early once none of its pixels were sampled */
+	if(kernel_adaptive_pixel_converged(kg, buffer, sample))
+		return false;
+
+#endif
 	/* initialize random numbers and ray */
 	RNG rng;
 	Ray ray;
@@ -1413,8 +1450,126 @@ ccl_device void kernel_branched_path_trace(KernelGlobals *kg,
 
 	/* accumulate result in output buffer */
 	kernel_write_pass_float4(buffer, sample, L);
+	kernel_write_sample_passes(kg, buffer, sample, L);
 
 	path_rng_end(kg, rng_state, rng);
+
+	return true;
+}
+#endif
+
+#ifdef __RAY_STREAM__
+/* Path trace a block of pixels, with the camera rays intersected together as
+ * a ray stream before the paths are integrated one by one. */
+ccl_device bool kernel_path_trace_stream(KernelGlobals *kg,
+	ccl_global float *buffer, ccl_global uint *rng_state,
+	int sample, int x, int y, int w, int h, int offset, int stride)
+{
+	int pass_stride = kernel_data.film.pass_stride;
+
+	/* visibility of camera rays, see path_state_init() */
+	const uint visibility = PATH_RAY_CAMERA|PATH_RAY_SINGULAR|kernel_data.integrator.layer_flag;
+
+	RNG rng[BVH_STREAM_SIZE];
+	Ray rays[BVH_STREAM_SIZE];
+	Intersection isects[BVH_STREAM_SIZE];
+	RayMask pixel_mask = 0, ray_mask = 0;
+
+	kernel_assert(w*h <= BVH_STREAM_SIZE);
+
+	/* initialize random numbers and rays */
+	for(int i = 0; i < w*h; i++) {
+		int px = x + i % w, py = y + i / w;
+		int index = offset + px + py*stride;
+
+#ifdef __ADAPTIVE_SAMPLING__
+		if(kernel_adaptive_pixel_converged(kg, buffer + index*pass_stride, sample))
+			continue;
+#endif
+
+		kernel_path_trace_setup(kg, rng_state + index, sample, px, py, &rng[i], &rays[i]);
+
+		pixel_mask |= RAY_MASK_BIT(i);
+		if(rays[i].t != 0.0f)
+			ray_mask |= RAY_MASK_BIT(i);
+	}
+
+	if(pixel_mask == 0)
+		return false;
+
+	/* intersect camera rays */
+	if(ray_mask)
+		scene_intersect_stream(kg, rays, isects, ray_mask, visibility);
+
+	/* integrate */
+	for(int i = 0; i < w*h; i++) {
+		if(!(pixel_mask & RAY_MASK_BIT(i)))
+			continue;
+
+		int index = offset + (x + i % w) + (y + i / w)*stride;
+		ccl_global float *pixel_buffer = buffer + index*pass_stride;
+		float4 L;
+
+		if(ray_mask & RAY_MASK_BIT(i))
+			L = kernel_path_integrate(kg, &rng[i], sample, rays[i], pixel_buffer, &isects[i]);
+		else
+			L = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+
+		/* accumulate result in output buffer */
+		kernel_write_pass_float4(pixel_buffer, sample, L);
+		kernel_write_sample_passes(kg, pixel_buffer, sample, L);
+
+		path_rng_end(kg, rng_state + index, rng[i]);
+	}
+
+	return true;
+}
+#endif
+
+#ifdef __KERNEL_CPU__
+/* Path trace one sample for all pixels in a tile, returns false if all of
+ * them were already converged */
+ccl_device bool kernel_path_trace_tile(KernelGlobals *kg,
+	ccl_global float *buffer, ccl_global uint *rng_state,
+	int sample, int x, int y, int w, int h, int offset, int stride)
+{
+	bool sampled = false;
+
+	KERNEL_STATS_STAGE(kg, STATS_STAGE_INTEGRATOR);
+
+#ifdef __BRANCHED_PATH__
+	if(kernel_data.integrator.branched) {
+		for(int py = y; py < y + h; py++)
+			for(int px = x; px < x + w; px++)
+				if(kernel_branched_path_trace(kg, buffer, rng_state, sample, px, py, offset, stride))
+					sampled = true;
+
+		return sampled;
+	}
+#endif
+
+#ifdef __RAY_STREAM__
+	if(scene_intersect_stream_supported(kg)) {
+		for(int by = y; by < y + h; by += BVH_STREAM_BLOCK_SIZE) {
+			for(int bx = x; bx < x + w; bx += BVH_STREAM_BLOCK_SIZE) {
+				int bw = min(BVH_STREAM_BLOCK_SIZE, x + w - bx);
+				int bh = min(BVH_STREAM_BLOCK_SIZE, y + h - by);
+
+				if(kernel_path_trace_stream(kg, buffer, rng_state, sample, bx, by, bw, bh, offset, stride))
+					sampled = true;
+			}
+		}
+
+		return sampled;
+	}
+#endif
+
+	for(int py = y; py < y + h; py++)
+		for(int px = x; px < x + w; px++)
+			if(kernel_path_trace(kg, buffer, rng_state, sample, px, py, offset, stride))
+				sampled = true;
+
+	return sampled;
 }
 #endif
 
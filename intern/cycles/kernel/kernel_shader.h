@@ -885,6 +885,9 @@ ccl_device float3 shader_holdout_eval(KernelGlobals *kg, ShaderData *sd)
 ccl_device void shader_eval_surface(KernelGlobals *kg, ShaderData *sd,
 	float randb, int path_flag, ShaderContext ctx)
 {
+	KERNEL_STATS_STAGE(kg, STATS_STAGE_SHADING);
+	KERNEL_STATS_COUNT(kg, shader_evals);
+
 #ifdef __MULTI_CLOSURE__
 	sd->num_closure = 0;
 	sd->randb_closure = randb;
@@ -912,6 +915,9 @@ ccl_device void shader_eval_surface(KernelGlobals *kg, ShaderData *sd,
 
 ccl_device float3 shader_eval_background(KernelGlobals *kg, ShaderData *sd, int path_flag, ShaderContext ctx)
 {
+	KERNEL_STATS_STAGE(kg, STATS_STAGE_SHADING);
+	KERNEL_STATS_COUNT(kg, shader_evals);
+
 #ifdef __MULTI_CLOSURE__
 	sd->num_closure = 0;
 	sd->randb_closure = 0.0f;
@@ -1094,6 +1100,8 @@ ccl_device void shader_eval_volume(KernelGlobals *kg, ShaderData *sd,
 		}
 
 		/* evaluate shader */
+		KERNEL_STATS_COUNT(kg, shader_evals);
+
 #ifdef __SVM__
 #ifdef __OSL__
 		if(kg->osl) {
@@ -1118,6 +1126,8 @@ ccl_device void shader_eval_volume(KernelGlobals *kg, ShaderData *sd,
 
 ccl_device void shader_eval_displacement(KernelGlobals *kg, ShaderData *sd, ShaderContext ctx)
 {
+	KERNEL_STATS_COUNT(kg, shader_evals);
+
 #ifdef __MULTI_CLOSURE__
 	sd->num_closure = 0;
 	sd->randb_closure = 0.0f;
@@ -24,6 +24,9 @@ ccl_device_inline bool shadow_blocked(KernelGlobals *kg, PathState *state, Ray *
 		return false;
 
 	Intersection isect;
+
+	KERNEL_STATS_RAY(kg, STATS_RAY_SHADOW);
+
 #ifdef __HAIR__
 	bool result = scene_intersect(kg, ray, PATH_RAY_SHADOW_OPAQUE, &isect, NULL, 0.0f, 0.0f);
 #else
@@ -65,6 +68,8 @@ ccl_device_inline bool shadow_blocked(KernelGlobals *kg, PathState *state, Ray *
 #endif
 				}
 
+				KERNEL_STATS_RAY(kg, STATS_RAY_SHADOW);
+
 #ifdef __HAIR__
 				if(!scene_intersect(kg, ray, PATH_RAY_SHADOW_TRANSPARENT, &isect, NULL, 0.0f, 0.0f)) {
 #else
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2011-2014 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+#ifndef __KERNEL_STATS_H__
+#define __KERNEL_STATS_H__
+
+/* Kernel Statistics
+ *
+ * With __KERNEL_STATS__, the CPU kernel counts rays, BVH traversal steps and
+ * shader node evaluations, and measures time per integrator stage, in the
+ * KernelStats of the thread's KernelGlobals. Without it all these macros are
+ * empty, so they can be used anywhere in the kernel at no cost.
+ *
+ * KERNEL_STATS_STAGE times the rest of the enclosing block, and can only be
+ * used once per block. */
+
+#ifdef __KERNEL_STATS__
+
+CCL_NAMESPACE_BEGIN
+
+class KernelStatsScope {
+public:
+	KernelStatsScope(KernelStats *stats_, int stage)
+	: stats(stats_)
+	{
+		stats->stage_begin(stage);
+	}
+
+	~KernelStatsScope()
+	{
+		stats->stage_end();
+	}
+
+protected:
+	KernelStats *stats;
+};
+
+CCL_NAMESPACE_END
+
+#define KERNEL_STATS_STAGE(kg, stage) KernelStatsScope kernel_stats_scope(&(kg)->stats, stage)
+#define KERNEL_STATS_RAY(kg, type) ((kg)->stats.rays[type]++)
+#define KERNEL_STATS_COUNT(kg, counter) ((kg)->stats.counter++)
+#define KERNEL_STATS_SVM_NODE(kg, type) ((kg)->stats.svm_nodes[min((int)(type), STATS_MAX_SVM_NODES - 1)]++)
+
+#else
+
+#define KERNEL_STATS_STAGE(kg, stage)
+#define KERNEL_STATS_RAY(kg, type)
+#define KERNEL_STATS_COUNT(kg, counter)
+#define KERNEL_STATS_SVM_NODE(kg, type)
+
+#endif
+
+#endif /* __KERNEL_STATS_H__ */
+
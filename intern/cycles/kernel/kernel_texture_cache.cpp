@@ -0,0 +1,86 @@
+/*
+ * Copyright 2011-2014 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+#include "kernel_compat_cpu.h"
+#include "kernel_types.h"
+#include "kernel_globals.h"
+#include "kernel_texture_cache.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Threads */
+
+void TextureCache::thread_init(KernelGlobals *kg, TextureCacheGlobals *tex_cache)
+{
+	/* no texture cache used? */
+	if(!tex_cache->ts) {
+		kg->tex_cache = NULL;
+		kg->tex_cache_tdata = NULL;
+		return;
+	}
+
+	TextureCacheThreadData *tdata = new TextureCacheThreadData();
+	tdata->thread_info = tex_cache->ts->get_perthread_info();
+
+	kg->tex_cache = tex_cache;
+	kg->tex_cache_tdata = tdata;
+}
+
+void TextureCache::thread_free(KernelGlobals *kg)
+{
+	if(!kg->tex_cache)
+		return;
+
+	delete kg->tex_cache_tdata;
+
+	kg->tex_cache = NULL;
+	kg->tex_cache_tdata = NULL;
+}
+
+/* Lookup */
+
+bool TextureCache::lookup(KernelGlobals *kg, int id, float x, float y,
+                          float2 dx, float2 dy, float4 *result)
+{
+	TextureCacheGlobals *tex_cache = kg->tex_cache;
+
+	if(id < 0 || id >= (int)tex_cache->handles.size() || !tex_cache->handles[id])
+		return false;
+
+	/* match the filtering and wrapping of images loaded into memory, alpha
+	 * is filled in for images without alpha channel */
+	OIIO::TextureOpt options;
+	options.nchannels = 4;
+	options.fill = 1.0f;
+	options.interpmode = OIIO::TextureOpt::InterpBilinear;
+	options.swrap = OIIO::TextureOpt::WrapPeriodic;
+	options.twrap = OIIO::TextureOpt::WrapPeriodic;
+
+	/* images in memory are stored bottom to top, files top to bottom */
+	float r[4];
+	bool status = tex_cache->ts->texture(tex_cache->handles[id], kg->tex_cache_tdata->thread_info,
+	                                     options, x, 1.0f - y, dx.x, -dx.y, dy.x, -dy.y, r);
+
+	if(status)
+		*result = make_float4(r[0], r[1], r[2], r[3]);
+	else
+		*result = make_float4(1.0f, 0.0f, 1.0f, 1.0f);
+
+	return true;
+}
+
+CCL_NAMESPACE_END
+
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2011-2014 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+#ifndef __KERNEL_TEXTURE_CACHE_H__
+#define __KERNEL_TEXTURE_CACHE_H__
+
+/* Texture Cache
+ *
+ * On the CPU, image textures can be read through an OpenImageIO texture system
+ * instead of being loaded into memory in full. Tiles of mipmapped images are
+ * read from disk when first needed and the least recently used tiles are
+ * evicted to stay within a memory budget. The mip level is chosen from the
+ * texture coordinate differentials.
+ *
+ * The texture handles per image slot are filled in by the ImageManager before
+ * rendering. Before/after a thread starts rendering, thread_init/thread_free
+ * must be called to set up the per thread texture system data. */
+
+#include <OpenImageIO/texture.h>
+
+#include "util_types.h"
+#include "util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+struct KernelGlobals;
+
+struct TextureCacheGlobals {
+	TextureCacheGlobals()
+	{
+		ts = NULL;
+	}
+
+	/* NULL if no image is read through the texture cache */
+	OIIO::TextureSystem *ts;
+
+	/* texture handle per image slot, NULL for images loaded into memory */
+	vector<OIIO::TextureSystem::TextureHandle*> handles;
+};
+
+struct TextureCacheThreadData {
+	OIIO::TextureSystem::Perthread *thread_info;
+};
+
+class TextureCache {
+public:
+	/* per thread data */
+	static void thread_init(KernelGlobals *kg, TextureCacheGlobals *tex_cache);
+	static void thread_free(KernelGlobals *kg);
+
+	/* filtered lookup with texture coordinate differentials, returns false
+	 * if the image is not read through the texture cache */
+	static bool lookup(KernelGlobals *kg, int id, float x, float y,
+	                   float2 dx, float2 dy, float4 *result);
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __KERNEL_TEXTURE_CACHE_H__ */
+
@@ -24,6 +24,7 @@
 
 /* bvh */
 KERNEL_TEX(float4, texture_float4, __bvh_nodes)
+KERNEL_TEX(float4, texture_float4, __bvh_motion_nodes)
 KERNEL_TEX(float4, texture_float4, __tri_woop)
 KERNEL_TEX(uint, texture_uint, __prim_segment)
 KERNEL_TEX(uint, texture_uint, __prim_visibility)
@@ -55,10 +56,16 @@ KERNEL_TEX(float4, texture_float4, __light_distribution)
 KERNEL_TEX(float4, texture_float4, __light_data)
 KERNEL_TEX(float2, texture_float2, __light_background_marginal_cdf)
 KERNEL_TEX(float2, texture_float2, __light_background_conditional_cdf)
+KERNEL_TEX(float4, texture_float4, __light_tree_nodes)
+KERNEL_TEX(uint, texture_uint, __light_tree_objects)
 
 /* particles */
 KERNEL_TEX(float4, texture_float4, __particles)
 
+/* volume majorants */
+KERNEL_TEX(float4, texture_float4, __volume_grid)
+KERNEL_TEX(float, texture_float, __volume_majorants)
+
 /* shaders */
 KERNEL_TEX(uint4, texture_uint4, __svm_nodes)
 KERNEL_TEX(uint, texture_uint, __shader_flag)
@@ -30,9 +30,11 @@ CCL_NAMESPACE_BEGIN
 #define OBJECT_SIZE 		11
 #define OBJECT_VECTOR_SIZE	6
 #define LIGHT_SIZE			4
+#define LIGHT_TREE_NODE_SIZE	3
 #define FILTER_TABLE_SIZE	256
 #define RAMP_TABLE_SIZE		256
 #define PARTICLE_SIZE 		5
+#define VOLUME_GRID_SIZE	3
 #define TIME_INVALID		FLT_MAX
 
 #define BSSRDF_MIN_RADIUS			1e-8f
@@ -61,6 +63,12 @@ CCL_NAMESPACE_BEGIN
 #define __SUBSURFACE__
 #define __CMJ__
 #define __VOLUME__
+#ifdef __KERNEL_SSE2__
+#define __RAY_STREAM__
+#endif
+#ifdef WITH_CYCLES_DEBUG
+#define __KERNEL_STATS__
+#endif
 #endif
 
 #ifdef __KERNEL_CUDA__
@@ -123,6 +131,8 @@ CCL_NAMESPACE_BEGIN
 #define __CAMERA_CLIPPING__
 #define __INTERSECTION_REFINE__
 #define __CLAMP_SAMPLE__
+#define __ADAPTIVE_SAMPLING__
+#define __LIGHT_TREE__
 
 #ifdef __KERNEL_SHADING__
 #define __SVM__
@@ -161,7 +171,8 @@ typedef uint RNG;
 
 typedef enum ShaderEvalType {
 	SHADER_EVAL_DISPLACE,
-	SHADER_EVAL_BACKGROUND
+	SHADER_EVAL_BACKGROUND,
+	SHADER_EVAL_VOLUME
 } ShaderEvalType;
 
 /* Path Tracing
@@ -282,7 +293,9 @@ typedef enum PassType {
 	PASS_MIST = 2097152,
 	PASS_SUBSURFACE_DIRECT = 4194304,
 	PASS_SUBSURFACE_INDIRECT = 8388608,
-	PASS_SUBSURFACE_COLOR = 16777216
+	PASS_SUBSURFACE_COLOR = 16777216,
+	PASS_SAMPLE_COUNT = 33554432,
+	PASS_SAMPLE_MOMENT = 67108864
 } PassType;
 
 #define PASS_ALL (~0)
@@ -771,6 +784,12 @@ typedef struct KernelFilm {
 	float mist_start;
 	float mist_inv_depth;
 	float mist_falloff;
+
+	/* adaptive sampling, number of samples and sum of squared luminance */
+	int pass_sample_count;
+	int pass_sample_moment;
+	int pass_pad3;
+	int pass_pad4;
 } KernelFilm;
 
 typedef struct KernelBackground {
@@ -843,10 +862,23 @@ typedef struct KernelIntegrator {
 
 	/* volume render */
 	int volume_homogeneous_sampling;
+	int volume_heterogeneous_sampling;
 	int use_volumes;
 	int volume_max_steps;
 	float volume_step_size;
 	int volume_samples;
+	int volume_majorants;
+
+	/* adaptive sampling */
+	int use_adaptive_sampling;
+	int adaptive_min_samples;
+	float adaptive_threshold;
+
+	/* light tree */
+	int use_light_tree;
+	int light_tree_num_distant;
+	float light_tree_pdf;
+
 	int pad1, pad2;
 } KernelIntegrator;
 
@@ -857,8 +889,15 @@ typedef struct KernelBVH {
 	int have_motion;
 	int have_curves;
 	int have_instancing;
+	int use_obvh;
 
-	int pad1, pad2, pad3;
+	/* number of top level nodes with bounds per motion step, and mapping
+	 * from ray time to motion step */
+	int num_motion_nodes;
+	float motion_time_start;
+	float motion_time_scale;
+
+	int pad2, pad3, pad4;
 } KernelBVH;
 
 typedef enum CurveFlag {
@@ -109,6 +109,106 @@ ccl_device bool volume_stack_is_heterogeneous(KernelGlobals *kg, VolumeStack *st
 	return false;
 }
 
+/* Majorant Grid
+ *
+ * For delta tracking, volume objects have a coarse grid over their bounds,
+ * with an upper bound of the extinction coefficient in each cell. Along the
+ * ray, the majorants of all objects in the volume stack are summed into a
+ * piecewise constant majorant. The world volume has no bounds, so it is
+ * never tracked this way.
+ *
+ * Emission is only picked up at tentative collisions, so objects with
+ * emission have a second grid with a minimum collision rate for cells with
+ * emission, which the integrator uses in place of smaller majorants. */
+
+ccl_device bool volume_stack_has_majorants(KernelGlobals *kg, VolumeStack *stack)
+{
+	if(!kernel_data.integrator.volume_majorants)
+		return false;
+
+	for(int i = 0; stack[i].shader != SHADER_NO_ID; i++) {
+		if(stack[i].object == ~0)
+			return false;
+
+		float4 bmin = kernel_tex_fetch(__volume_grid, stack[i].object*VOLUME_GRID_SIZE + 0);
+
+		if(__float_as_int(bmin.w) == -1)
+			return false;
+	}
+
+	return true;
+}
+
+/* get the majorant at distance t along the ray, and the distance up to
+ * which it is valid, which is the nearest exit of a grid cell. with emission,
+ * the majorant is raised to the collision rate needed to sample emission */
+ccl_device float volume_majorant_segment(KernelGlobals *kg, VolumeStack *stack, Ray *ray, float t, float *t_end, bool emission)
+{
+	float3 P = ray->P + t*ray->D;
+	float3 D = ray->D;
+	float majorant = 0.0f;
+	float t_exit = ray->t;
+
+	for(int i = 0; stack[i].shader != SHADER_NO_ID; i++) {
+		int object = stack[i].object;
+
+		/* objects with multiple volume shaders are in the stack once for
+		 * each shader, the grid already includes all of them */
+		bool duplicate = false;
+
+		for(int j = 0; j < i; j++)
+			if(stack[j].object == object)
+				duplicate = true;
+
+		if(duplicate)
+			continue;
+
+		int offset = object*VOLUME_GRID_SIZE;
+		float4 bmin = kernel_tex_fetch(__volume_grid, offset + 0);
+		float4 bmax = kernel_tex_fetch(__volume_grid, offset + 1);
+		float4 res = kernel_tex_fetch(__volume_grid, offset + 2);
+
+		float3 lower = float4_to_float3(bmin);
+		float3 cell_size = (float4_to_float3(bmax) - lower)/float4_to_float3(res);
+		float3 co = (P - lower)/cell_size;
+
+		/* on a cell boundary, pick the cell the ray is entering */
+		int x = (int)((D.x < 0.0f)? ceilf(co.x) - 1.0f: floorf(co.x));
+		int y = (int)((D.y < 0.0f)? ceilf(co.y) - 1.0f: floorf(co.y));
+		int z = (int)((D.z < 0.0f)? ceilf(co.z) - 1.0f: floorf(co.z));
+		int resx = (int)res.x;
+		int resy = (int)res.y;
+		int resz = (int)res.z;
+
+		if(x < 0 || y < 0 || z < 0 || x >= resx || y >= resy || z >= resz) {
+			/* outside the bounds due to precision issues, use the
+			 * majorant of the entire grid */
+			majorant += bmax.w;
+			continue;
+		}
+
+		int cell = x + resx*(y + resy*z);
+		float cell_majorant = kernel_tex_fetch(__volume_majorants, __float_as_int(bmin.w) + cell);
+
+		if(emission && __float_as_int(res.w) != -1)
+			cell_majorant = max(cell_majorant, kernel_tex_fetch(__volume_majorants, __float_as_int(res.w) + cell));
+
+		majorant += cell_majorant;
+
+		/* distance to the cell exit */
+		if(D.x != 0.0f)
+			t_exit = min(t_exit, t + (lower.x + ((D.x > 0.0f)? x + 1: x)*cell_size.x - P.x)/D.x);
+		if(D.y != 0.0f)
+			t_exit = min(t_exit, t + (lower.y + ((D.y > 0.0f)? y + 1: y)*cell_size.y - P.y)/D.y);
+		if(D.z != 0.0f)
+			t_exit = min(t_exit, t + (lower.z + ((D.z > 0.0f)? z + 1: z)*cell_size.z - P.z)/D.z);
+	}
+
+	*t_end = max(t_exit, t);
+
+	return majorant;
+}
+
 /* Volume Shadows
  *
  * These functions are used to attenuate shadow rays to lights. Both absorption
@@ -177,15 +277,74 @@ ccl_device void kernel_volume_shadow_heterogeneous(KernelGlobals *kg, PathState
 	*throughput = tp;
 }
 
+/* heterogeneous volume: ratio tracking through the majorant grid. at
+ * tentative collisions sampled with the majorant as extinction coefficient,
+ * the transmittance is multiplied by the probability of a null collision.
+ * this is unbiased, and for low transmittance we use russian roulette */
+ccl_device void kernel_volume_shadow_heterogeneous_tracking(KernelGlobals *kg, PathState *state, Ray *ray, ShaderData *sd, float3 *throughput)
+{
+	float3 tp = *throughput;
+	int max_steps = kernel_data.integrator.volume_max_steps;
+	float t = 0.0f;
+
+	for(int i = 0; i < max_steps; i++) {
+		/* sample tentative collision, empty space is skipped */
+		float t_end;
+		float majorant = volume_majorant_segment(kg, state->volume_stack, ray, t, &t_end, false);
+		float new_t = t_end;
+
+		if(majorant > 0.0f)
+			new_t = t - logf(1.0f - lcg_step_float(&state->rng_congruential))/majorant;
+
+		if(new_t >= t_end) {
+			/* continue in the next cell, or stop at the end of the volume */
+			t = t_end;
+			if(t >= ray->t)
+				break;
+
+			continue;
+		}
+
+		t = new_t;
+
+		float3 sigma_t;
+
+		if(!volume_shader_extinction_sample(kg, sd, state, ray->P + t*ray->D, &sigma_t))
+			continue;
+
+		tp *= make_float3(1.0f, 1.0f, 1.0f) - sigma_t/majorant;
+
+		/* russian roulette */
+		float p = max(fabsf(tp.x), max(fabsf(tp.y), fabsf(tp.z)));
+
+		if(p < 0.1f) {
+			if(lcg_step_float(&state->rng_congruential) >= p) {
+				tp = make_float3(0.0f, 0.0f, 0.0f);
+				break;
+			}
+
+			tp /= p;
+		}
+	}
+
+	*throughput = tp;
+}
+
 /* get the volume attenuation over line segment defined by ray, with the
  * assumption that there are no surfaces blocking light between the endpoints */
 ccl_device_noinline void kernel_volume_shadow(KernelGlobals *kg, PathState *state, Ray *ray, float3 *throughput)
 {
+	KERNEL_STATS_STAGE(kg, STATS_STAGE_VOLUME);
+
 	ShaderData sd;
 	shader_setup_from_volume(kg, &sd, ray, state->bounce);
 
-	if(volume_stack_is_heterogeneous(kg, state->volume_stack))
-		kernel_volume_shadow_heterogeneous(kg, state, ray, &sd, throughput);
+	if(volume_stack_is_heterogeneous(kg, state->volume_stack)) {
+		if(kernel_data.integrator.volume_heterogeneous_sampling == 1 && volume_stack_has_majorants(kg, state->volume_stack))
+			kernel_volume_shadow_heterogeneous_tracking(kg, state, ray, &sd, throughput);
+		else
+			kernel_volume_shadow_heterogeneous(kg, state, ray, &sd, throughput);
+	}
 	else
 		kernel_volume_shadow_homogeneous(kg, state, ray, &sd, throughput);
 }
@@ -530,16 +689,113 @@ ccl_device VolumeIntegrateResult kernel_volume_integrate_heterogeneous(KernelGlo
 	return VOLUME_PATH_ATTENUATED;
 }
 
+/* heterogeneous volume: spectral tracking through the majorant grid, see
+ * "Spectral and Decomposition Tracking for Rendering Heterogeneous Volumes",
+ * Kutz et al. 2017. tentative collisions are sampled with the majorant as
+ * extinction coefficient, and at each of them absorption, scattering or a
+ * null collision is picked, with probabilities proportional to the throughput
+ * weighted coefficients. unlike ray marching this is unbiased, and the cost
+ * scales with the density rather than the distance travelled */
+ccl_device VolumeIntegrateResult kernel_volume_integrate_heterogeneous_tracking(KernelGlobals *kg,
+	PathState *state, Ray *ray, ShaderData *sd, PathRadiance *L, float3 *throughput, RNG *rng)
+{
+	float3 tp = *throughput;
+	int max_steps = kernel_data.integrator.volume_max_steps;
+	float t = 0.0f;
+
+	/* the first distance uses a stratified number, the following ones
+	 * and the event selection use the lcg */
+	float xi = path_state_rng_1D(kg, rng, state, PRNG_SCATTER_DISTANCE);
+	sd->randb_closure = path_state_rng_1D(kg, rng, state, PRNG_PHASE);
+
+	/* like ray marching, stopping at max_steps tentative collisions leaves
+	 * the rest of the ray transparent and without emission, which is biased
+	 * for volumes that are both dense and long compared to the step limit */
+	for(int i = 0; i < max_steps; i++) {
+		/* sample tentative collision, empty space is skipped, emission
+		 * raises the majorant so emissive cells get collisions */
+		float t_end;
+		float majorant = volume_majorant_segment(kg, state->volume_stack, ray, t, &t_end, true);
+		float new_t = t_end;
+
+		if(majorant > 0.0f)
+			new_t = t - logf(1.0f - xi)/majorant;
+
+		xi = lcg_step_float(&state->rng_congruential);
+
+		if(new_t >= t_end) {
+			/* continue in the next cell, or stop at the end of the volume */
+			t = t_end;
+			if(t >= ray->t)
+				break;
+
+			continue;
+		}
+
+		t = new_t;
+
+		VolumeShaderCoefficients coeff;
+
+		if(!volume_shader_sample(kg, sd, state, ray->P + t*ray->D, &coeff))
+			continue;
+
+		/* emission is estimated at every tentative collision */
+		if(sd->flag & SD_EMISSION)
+			path_radiance_accum_emission(L, tp, coeff.emission/majorant, state->bounce);
+
+		/* null collision coefficient, negative if the majorant is not an
+		 * upper bound, which is still unbiased */
+		float3 sigma_n = make_float3(majorant, majorant, majorant) - (coeff.sigma_a + coeff.sigma_s);
+
+		float p_a = average(fabs(tp * coeff.sigma_a));
+		float p_s = average(fabs(tp * coeff.sigma_s));
+		float p_n = average(fabs(tp * sigma_n));
+		float p_sum = p_a + p_s + p_n;
+
+		if(p_sum == 0.0f)
+			break;
+
+		float event = lcg_step_float(&state->rng_congruential) * p_sum;
+
+		if(event < p_a) {
+			/* absorption, emission was already taken into account */
+			tp = make_float3(0.0f, 0.0f, 0.0f);
+			break;
+		}
+		else if(event < p_a + p_s) {
+			/* scattering */
+			*throughput = tp * coeff.sigma_s * (p_sum / (majorant * p_s));
+			sd->P = ray->P + t*ray->D;
+
+			return VOLUME_PATH_SCATTERED;
+		}
+		else {
+			/* null collision */
+			tp *= sigma_n * (p_sum / (majorant * p_n));
+		}
+	}
+
+	*throughput = tp;
+
+	return VOLUME_PATH_ATTENUATED;
+}
+
 /* get the volume attenuation and emission over line segment defined by
  * ray, with the assumption that there are no surfaces blocking light
  * between the endpoints */
 ccl_device_noinline VolumeIntegrateResult kernel_volume_integrate(KernelGlobals *kg,
 	PathState *state, ShaderData *sd, Ray *ray, PathRadiance *L, float3 *throughput, RNG *rng)
 {
+	KERNEL_STATS_STAGE(kg, STATS_STAGE_VOLUME);
+
 	shader_setup_from_volume(kg, sd, ray, state->bounce);
 
-	if(volume_stack_is_heterogeneous(kg, state->volume_stack))
-		return kernel_volume_integrate_heterogeneous(kg, state, ray, sd, L, throughput, rng);
+	if(volume_stack_is_heterogeneous(kg, state->volume_stack)) {
+		if(kernel_data.integrator.volume_heterogeneous_sampling == 1 && volume_stack_has_majorants(kg, state->volume_stack))
+			return kernel_volume_integrate_heterogeneous_tracking(kg, state, ray, sd, L, throughput, rng);
+		else
+			return kernel_volume_integrate_heterogeneous(kg, state, ray, sd, L, throughput, rng);
+	}
 	else
 		return kernel_volume_integrate_homogeneous(kg, state, ray, sd, L, throughput, rng);
 }
@@ -14,6 +14,10 @@
  * limitations under the License
  */
 
+#ifdef __KERNEL_CPU__
+#include "kernel_texture_cache.h"
+#endif
+
 CCL_NAMESPACE_BEGIN
 
 #ifdef __KERNEL_OPENCL__
@@ -48,7 +52,7 @@ ccl_device_inline float svm_image_texture_frac(float x, int *ix)
 	return x - (float)i;
 }
 
-ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, uint srgb, uint use_alpha)
+ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, float2 dx, float2 dy, uint srgb, uint use_alpha)
 {
 	/* first slots are used by float textures, which are not supported here */
 	if(id < TEX_NUM_FLOAT_IMAGES)
@@ -110,16 +114,20 @@ ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y,
 
 #else
 
-ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, uint srgb, uint use_alpha)
+ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, float2 dx, float2 dy, uint srgb, uint use_alpha)
 {
 #ifdef __KERNEL_CPU__
 #ifdef __KERNEL_SSE2__
 	__m128 r_m128;
 	float4 &r = (float4 &)r_m128;
-	r = kernel_tex_image_interp(id, x, y);
 #else
-	float4 r = kernel_tex_image_interp(id, x, y);
+	float4 r;
 #endif
+
+	/* images which are not in memory are read through the texture cache,
+	 * using the differentials to pick a mip map level */
+	if(!(kg->tex_cache && TextureCache::lookup(kg, id, x, y, dx, dy, &r)))
+		r = kernel_tex_image_interp(id, x, y);
 #else
 	float4 r;
 
@@ -279,16 +287,35 @@ ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y,
 
 #endif
 
+/* texture coordinate differentials, from coordinates evaluated at the
+ * shading point offset by the ray differentials */
+ccl_device void svm_image_texture_differentials(float *stack, uint dx_offset, uint dy_offset, float3 co, float3 *dx, float3 *dy)
+{
+	if(stack_valid(dx_offset) && stack_valid(dy_offset)) {
+		*dx = stack_load_float3(stack, dx_offset) - co;
+		*dy = stack_load_float3(stack, dy_offset) - co;
+	}
+	else {
+		*dx = make_float3(0.0f, 0.0f, 0.0f);
+		*dy = make_float3(0.0f, 0.0f, 0.0f);
+	}
+}
+
 ccl_device void svm_node_tex_image(KernelGlobals *kg, ShaderData *sd, float *stack, uint4 node)
 {
 	uint id = node.y;
 	uint co_offset, out_offset, alpha_offset, srgb;
+	uint dx_offset, dy_offset, unused;
 
 	decode_node_uchar4(node.z, &co_offset, &out_offset, &alpha_offset, &srgb);
+	decode_node_uchar4(node.w, &dx_offset, &dy_offset, &unused, &unused);
 
 	float3 co = stack_load_float3(stack, co_offset);
+	float3 dx, dy;
+	svm_image_texture_differentials(stack, dx_offset, dy_offset, co, &dx, &dy);
+
 	uint use_alpha = stack_valid(alpha_offset);
-	float4 f = svm_image_texture(kg, id, co.x, co.y, srgb, use_alpha);
+	float4 f = svm_image_texture(kg, id, co.x, co.y, make_float2(dx.x, dx.y), make_float2(dy.x, dy.y), srgb, use_alpha);
 
 	if(stack_valid(out_offset))
 		stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -296,8 +323,10 @@ ccl_device void svm_node_tex_image(KernelGlobals *kg, ShaderData *sd, float *sta
 		stack_store_float(stack, alpha_offset, f.w);
 }
 
-ccl_device void svm_node_tex_image_box(KernelGlobals *kg, ShaderData *sd, float *stack, uint4 node)
+ccl_device void svm_node_tex_image_box(KernelGlobals *kg, ShaderData *sd, float *stack, uint4 node, int *offset)
 {
+	uint4 node2 = read_node(kg, offset);
+
 	/* get object space normal */
 	float3 N = sd->N;
 
@@ -368,15 +397,18 @@ ccl_device void svm_node_tex_image_box(KernelGlobals *kg, ShaderData *sd, float
 	float3 co = stack_load_float3(stack, co_offset);
 	uint id = node.y;
 
+	float3 dx, dy;
+	svm_image_texture_differentials(stack, node2.x, node2.y, co, &dx, &dy);
+
 	float4 f = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
 	uint use_alpha = stack_valid(alpha_offset);
 
 	if(weight.x > 0.0f)
-		f += weight.x*svm_image_texture(kg, id, co.y, co.z, srgb, use_alpha);
+		f += weight.x*svm_image_texture(kg, id, co.y, co.z, make_float2(dx.y, dx.z), make_float2(dy.y, dy.z), srgb, use_alpha);
 	if(weight.y > 0.0f)
-		f += weight.y*svm_image_texture(kg, id, co.x, co.z, srgb, use_alpha);
+		f += weight.y*svm_image_texture(kg, id, co.x, co.z, make_float2(dx.x, dx.z), make_float2(dy.x, dy.z), srgb, use_alpha);
 	if(weight.z > 0.0f)
-		f += weight.z*svm_image_texture(kg, id, co.y, co.x, srgb, use_alpha);
+		f += weight.z*svm_image_texture(kg, id, co.y, co.x, make_float2(dx.y, dx.x), make_float2(dy.y, dy.x), srgb, use_alpha);
 
 	if(stack_valid(out_offset))
 		stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -404,7 +436,8 @@ ccl_device void svm_node_tex_environment(KernelGlobals *kg, ShaderData *sd, floa
 		uv = direction_to_mirrorball(co);
 
 	uint use_alpha = stack_valid(alpha_offset);
-	float4 f = svm_image_texture(kg, id, uv.x, uv.y, srgb, use_alpha);
+	float2 zero = make_float2(0.0f, 0.0f);
+	float4 f = svm_image_texture(kg, id, uv.x, uv.y, zero, zero, srgb, use_alpha);
 
 	if(stack_valid(out_offset))
 		stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -93,6 +93,9 @@ RenderTile::RenderTile()
 	rng_state = 0;
 
 	buffers = NULL;
+
+	index = 0;
+	converged = false;
 }
 
 /* Render Buffers */
@@ -156,9 +159,34 @@ bool RenderBuffers::copy_from_device()
 	return true;
 }
 
+/* with adaptive sampling each pixel has its own number of samples */
+static float pixel_sample_scale(float *in_count, int pixel, int pass_stride, float scale)
+{
+	if(in_count) {
+		float num_samples = in_count[pixel*pass_stride];
+
+		if(num_samples >= 1.0f)
+			return 1.0f/num_samples;
+	}
+
+	return scale;
+}
+
 bool RenderBuffers::get_pass_rect(PassType type, float exposure, int sample, int components, float *pixels)
 {
 	int pass_offset = 0;
+	float *in_count = NULL;
+
+	if(Pass::contains(params.passes, PASS_SAMPLE_COUNT)) {
+		int count_offset = 0;
+		foreach(Pass& count_pass, params.passes) {
+			if(count_pass.type == PASS_SAMPLE_COUNT)
+				break;
+			count_offset += count_pass.components;
+		}
+
+		in_count = (float*)buffer.data_pointer + count_offset;
+	}
 
 	foreach(Pass& pass, params.passes) {
 		if(pass.type != type) {
@@ -172,6 +200,9 @@ bool RenderBuffers::get_pass_rect(PassType type, float exposure, int sample, int
 		float scale = (pass.filter)? 1.0f/(float)sample: 1.0f;
 		float scale_exposure = (pass.exposure)? scale*exposure: scale;
 
+		if(!pass.filter)
+			in_count = NULL;
+
 		int size = params.width*params.height;
 
 		if(components == 1) {
@@ -187,13 +218,15 @@ bool RenderBuffers::get_pass_rect(PassType type, float exposure, int sample, int
 			else if(type == PASS_MIST) {
 				for(int i = 0; i < size; i++, in += pass_stride, pixels++) {
 					float f = *in;
-					pixels[0] = clamp(f*scale_exposure, 0.0f, 1.0f);
+					float pixel_scale = pixel_sample_scale(in_count, i, pass_stride, scale);
+					pixels[0] = clamp(f*pixel_scale, 0.0f, 1.0f);
 				}
 			}
 			else {
 				for(int i = 0; i < size; i++, in += pass_stride, pixels++) {
 					float f = *in;
-					pixels[0] = f*scale_exposure;
+					float pixel_scale = pixel_sample_scale(in_count, i, pass_stride, scale);
+					pixels[0] = f*((pass.exposure)? pixel_scale*exposure: pixel_scale);
 				}
 			}
 		}
@@ -237,10 +270,12 @@ bool RenderBuffers::get_pass_rect(PassType type, float exposure, int sample, int
 				/* RGB/vector */
 				for(int i = 0; i < size; i++, in += pass_stride, pixels += 3) {
 					float3 f = make_float3(in[0], in[1], in[2]);
+					float pixel_scale = pixel_sample_scale(in_count, i, pass_stride, scale);
+					float pixel_scale_exposure = (pass.exposure)? pixel_scale*exposure: pixel_scale;
 
-					pixels[0] = f.x*scale_exposure;
-					pixels[1] = f.y*scale_exposure;
-					pixels[2] = f.z*scale_exposure;
+					pixels[0] = f.x*pixel_scale_exposure;
+					pixels[1] = f.y*pixel_scale_exposure;
+					pixels[2] = f.z*pixel_scale_exposure;
 				}
 			}
 		}
@@ -284,13 +319,15 @@ bool RenderBuffers::get_pass_rect(PassType type, float exposure, int sample, int
 			else {
 				for(int i = 0; i < size; i++, in += pass_stride, pixels += 4) {
 					float4 f = make_float4(in[0], in[1], in[2], in[3]);
+					float pixel_scale = pixel_sample_scale(in_count, i, pass_stride, scale);
+					float pixel_scale_exposure = (pass.exposure)? pixel_scale*exposure: pixel_scale;
 
-					pixels[0] = f.x*scale_exposure;
-					pixels[1] = f.y*scale_exposure;
-					pixels[2] = f.z*scale_exposure;
+					pixels[0] = f.x*pixel_scale_exposure;
+					pixels[1] = f.y*pixel_scale_exposure;
+					pixels[2] = f.z*pixel_scale_exposure;
 
 					/* clamp since alpha might be > 1.0 due to russian roulette */
-					pixels[3] = clamp(f.w*scale, 0.0f, 1.0f);
+					pixels[3] = clamp(f.w*pixel_scale, 0.0f, 1.0f);
 				}
 			}
 		}
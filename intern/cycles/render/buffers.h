@@ -143,6 +143,11 @@ public:
 
 	RenderBuffers *buffers;
 
+	/* index of the tile in the tile manager, and whether adaptive sampling
+	 * found all pixels converged so it does not need more samples */
+	int index;
+	bool converged;
+
 	RenderTile();
 };
 
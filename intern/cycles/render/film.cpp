@@ -155,6 +155,14 @@ void Pass::add(PassType type, vector<Pass>& passes)
 			pass.components = 4;
 			pass.exposure = false;
 			break;
+		case PASS_SAMPLE_COUNT:
+			pass.components = 1;
+			pass.filter = false;
+			break;
+		case PASS_SAMPLE_MOMENT:
+			pass.components = 1;
+			pass.filter = false;
+			break;
 	}
 
 	passes.push_back(pass);
@@ -393,6 +401,12 @@ void Film::device_update(Device *device, DeviceScene *dscene, Scene *scene)
 				kfilm->pass_shadow = kfilm->pass_stride;
 				kfilm->use_light_pass = 1;
 				break;
+			case PASS_SAMPLE_COUNT:
+				kfilm->pass_sample_count = kfilm->pass_stride;
+				break;
+			case PASS_SAMPLE_MOMENT:
+				kfilm->pass_sample_moment = kfilm->pass_stride;
+				break;
 			case PASS_NONE:
 				break;
 		}
@@ -448,6 +462,9 @@ void Film::tag_passes_update(Scene *scene, const vector<Pass>& passes_)
 	else if(Pass::contains(passes, PASS_MOTION) != Pass::contains(passes_, PASS_MOTION))
 		scene->mesh_manager->tag_update(scene);
 
+	if(Pass::contains(passes, PASS_SAMPLE_MOMENT) != Pass::contains(passes_, PASS_SAMPLE_MOMENT))
+		scene->integrator->tag_update(scene);
+
 	passes = passes_;
 }
 
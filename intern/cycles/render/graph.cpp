@@ -117,6 +117,27 @@ ShaderOutput *ShaderNode::add_output(const char *name, ShaderSocketType type)
 	return output;
 }
 
+bool ShaderNode::inputs_equal(const ShaderNode *other)
+{
+	/* for merging nodes in the graph, the node type and its parameters
+	 * must be compared by the node itself */
+	if(name != other->name || bump != other->bump || inputs.size() != other->inputs.size())
+		return false;
+
+	for(size_t i = 0; i < inputs.size(); i++) {
+		ShaderInput *input = inputs[i];
+		ShaderInput *other_input = other->inputs[i];
+
+		if(input->link != other_input->link || input->default_value != other_input->default_value)
+			return false;
+
+		if(!input->link && (input->value != other_input->value || input->value_string != other_input->value_string))
+			return false;
+	}
+
+	return true;
+}
+
 void ShaderNode::attributes(Shader *shader, AttributeRequestSet *attributes)
 {
 	foreach(ShaderInput *input, inputs) {
@@ -227,7 +248,18 @@ void ShaderGraph::disconnect(ShaderInput *to)
 	from->links.erase(remove(from->links.begin(), from->links.end(), to), from->links.end());
 }
 
-void ShaderGraph::finalize(bool do_bump, bool do_osl, bool do_multi_transform)
+void ShaderGraph::relink(ShaderOutput *from, ShaderOutput *to)
+{
+	/* temp. copy of the links list, from->links is modified when we disconnect */
+	vector<ShaderInput*> links(from->links);
+
+	foreach(ShaderInput *sock, links) {
+		disconnect(sock);
+		connect(to, sock);
+	}
+}
+
+void ShaderGraph::finalize(bool do_bump, bool do_osl, bool do_multi_transform, bool do_image_differentials, bool do_optimize)
 {
 	/* before compiling, the shader graph may undergo a number of modifications.
 	 * currently we set default geometry shader inputs, and create automatic bump
@@ -235,13 +267,16 @@ void ShaderGraph::finalize(bool do_bump, bool do_osl, bool do_multi_transform)
 	 * modified afterwards. */
 
 	if(!finalized) {
-		clean();
+		clean(do_optimize);
 		default_inputs(do_osl);
 		refine_bump_nodes();
 
 		if(do_bump)
 			bump_from_displacement();
 
+		if(do_image_differentials)
+			image_differentials();
+
 		if(do_multi_transform) {
 			ShaderInput *surface_in = output()->input("Surface");
 			ShaderInput *volume_in = output()->input("Volume");
@@ -471,7 +506,102 @@ void ShaderGraph::break_cycles(ShaderNode *node, vector<bool>& visited, vector<b
 	on_stack[node->id] = false;
 }
 
-void ShaderGraph::clean()
+void ShaderGraph::dependency_order(ShaderNode *node, vector<bool>& visited, vector<ShaderNode*>& order)
+{
+	/* nodes that feed into node, followed by node itself */
+	visited[node->id] = true;
+
+	foreach(ShaderInput *input, node->inputs) {
+		if(input->link && !visited[input->link->parent->id])
+			dependency_order(input->link->parent, visited, order);
+	}
+
+	order.push_back(node);
+}
+
+void ShaderGraph::constant_fold()
+{
+	/* evaluate nodes with constant inputs at compile time, and bypass nodes
+	 * that pass on one of their inputs unchanged. nodes are visited after the
+	 * nodes they depend on, so that constants propagate through the graph. */
+	vector<bool> visited(num_node_ids, false);
+	vector<ShaderNode*> order;
+	ShaderNode *output_node = output();
+
+	dependency_order(output_node, visited, order);
+
+	foreach(ShaderNode *node, order) {
+		foreach(ShaderOutput *out, node->outputs) {
+			if(out->links.empty())
+				continue;
+
+			float3 optimized_value = make_float3(0.0f, 0.0f, 0.0f);
+
+			if(!node->constant_fold(out, &optimized_value)) {
+				ShaderInput *bypass = node->bypass_input(out);
+
+				if(!bypass)
+					continue;
+
+				if(bypass->link) {
+					relink(out, bypass->link);
+					continue;
+				}
+				else if(bypass->default_value != ShaderInput::NONE)
+					continue;
+
+				optimized_value = bypass->value;
+			}
+
+			/* assign the value to the linked inputs. inputs with a default
+			 * value like the normal would get that when unlinked, and the
+			 * output node only uses displacement when linked. */
+			vector<ShaderInput*> links(out->links);
+
+			foreach(ShaderInput *to, links) {
+				if(to->default_value != ShaderInput::NONE || to->parent == output_node)
+					continue;
+
+				disconnect(to);
+				to->value = optimized_value;
+			}
+		}
+	}
+}
+
+void ShaderGraph::deduplicate_nodes()
+{
+	/* merge identical nodes, e.g. the same image texture lookup used in
+	 * multiple places. nodes are visited after the nodes they depend on, so
+	 * their inputs are already merged when comparing them. */
+	vector<bool> visited(num_node_ids, false);
+	vector<ShaderNode*> order;
+	map<ustring, vector<ShaderNode*> > candidates;
+
+	dependency_order(output(), visited, order);
+
+	foreach(ShaderNode *node, order) {
+		vector<ShaderNode*>& same_name = candidates[node->name];
+		ShaderNode *merged = NULL;
+
+		foreach(ShaderNode *other, same_name) {
+			if(node->equals(other)) {
+				merged = other;
+				break;
+			}
+		}
+
+		if(merged) {
+			/* node becomes unused and is removed by clean() */
+			for(size_t i = 0; i < node->outputs.size(); i++)
+				relink(node->outputs[i], merged->outputs[i]);
+		}
+		else
+			same_name.push_back(node);
+	}
+}
+
+void ShaderGraph::clean(bool do_optimize)
 {
 	/* remove proxy and unnecessary mix nodes */
 	remove_unneeded_nodes();
@@ -486,6 +616,19 @@ void ShaderGraph::clean()
 	/* break cycles */
 	break_cycles(output(), visited, on_stack);
 
+	if(do_optimize) {
+		/* constant folding may turn mix closures into no-ops, which are
+		 * then removed, before merging identical nodes. this can leave more
+		 * nodes unused, so visit the graph again. */
+		constant_fold();
+		remove_unneeded_nodes();
+		deduplicate_nodes();
+
+		visited.assign(num_node_ids, false);
+		on_stack.assign(num_node_ids, false);
+		break_cycles(output(), visited, on_stack);
+	}
+
 	/* disconnect unused nodes */
 	foreach(ShaderNode *node, nodes) {
 		if(!visited[node->id]) {
@@ -625,6 +768,56 @@ void ShaderGraph::refine_bump_nodes()
 	}
 }
 
+void ShaderGraph::image_differentials()
+{
+	/* image textures read through the texture cache pick a mip map level from
+	 * the texture coordinate differentials. like for bump mapping, we copy the
+	 * sub-graph defined from the "Vector" input twice, evaluate the copies at
+	 * the shading point offset by dx and dy, and connect them to the "VectorDx"
+	 * and "VectorDy" inputs. builtin images are always loaded into memory. */
+
+	foreach(ShaderNode *node, nodes) {
+		if(node->name != ustring("image_texture"))
+			continue;
+
+		ImageTextureNode *image_node = static_cast<ImageTextureNode*>(node);
+		ShaderInput *vector_in = node->input("Vector");
+
+		if(image_node->builtin_data || !vector_in->link || node->input("VectorDx")->link)
+			continue;
+
+		set<ShaderNode*> nodes_vector;
+		map<ShaderNode*, ShaderNode*> nodes_dx;
+		map<ShaderNode*, ShaderNode*> nodes_dy;
+
+		find_dependencies(nodes_vector, vector_in);
+
+		copy_nodes(nodes_vector, nodes_dx);
+		copy_nodes(nodes_vector, nodes_dy);
+
+		/* nodes which are already shifted for bump mapping stay as they are,
+		 * the differentials are only used for filtering */
+		foreach(NodePair& pair, nodes_dx) {
+			if(pair.second->bump == SHADER_BUMP_NONE || pair.second->bump == SHADER_BUMP_CENTER)
+				pair.second->bump = SHADER_BUMP_DX;
+		}
+		foreach(NodePair& pair, nodes_dy) {
+			if(pair.second->bump == SHADER_BUMP_NONE || pair.second->bump == SHADER_BUMP_CENTER)
+				pair.second->bump = SHADER_BUMP_DY;
+		}
+
+		ShaderOutput *out = vector_in->link;
+		connect(nodes_dx[out->parent]->output(out->name), node->input("VectorDx"));
+		connect(nodes_dy[out->parent]->output(out->name), node->input("VectorDy"));
+
+		/* add generated nodes */
+		foreach(NodePair& pair, nodes_dx)
+			add(pair.second);
+		foreach(NodePair& pair, nodes_dy)
+			add(pair.second);
+	}
+}
+
 void ShaderGraph::bump_from_displacement()
 {
 	/* generate bump mapping automatically from displacement. bump mapping is
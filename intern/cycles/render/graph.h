@@ -194,6 +194,16 @@ public:
 	virtual bool has_converter_blackbody() { return false; }
 	virtual bool has_bssrdf_bump() { return false; }
 
+	/* graph optimization. constant_fold evaluates an output when its inputs
+	 * are constant, bypass_input returns an input that an output passes on
+	 * unchanged, and equals tells if the node can be merged with another node
+	 * of the same name. nodes that don't implement these are left as is. */
+	virtual bool constant_fold(ShaderOutput *socket, float3 *optimized_value) { return false; }
+	virtual ShaderInput *bypass_input(ShaderOutput *socket) { return NULL; }
+	virtual bool equals(const ShaderNode *other) { return false; }
+
+	bool inputs_equal(const ShaderNode *other);
+
 	vector<ShaderInput*> inputs;
 	vector<ShaderOutput*> outputs;
 
@@ -245,8 +255,10 @@ public:
 	void connect(ShaderOutput *from, ShaderInput *to);
 	void disconnect(ShaderInput *to);
 
+	void relink(ShaderOutput *from, ShaderOutput *to);
+
 	void remove_unneeded_nodes();
-	void finalize(bool do_bump = false, bool do_osl = false, bool do_multi_closure = false);
+	void finalize(bool do_bump, bool do_osl, bool do_multi_closure, bool do_image_differentials, bool do_optimize);
 
 protected:
 	typedef pair<ShaderNode* const, ShaderNode*> NodePair;
@@ -255,9 +267,13 @@ protected:
 	void copy_nodes(set<ShaderNode*>& nodes, map<ShaderNode*, ShaderNode*>& nnodemap);
 
 	void break_cycles(ShaderNode *node, vector<bool>& visited, vector<bool>& on_stack);
-	void clean();
+	void dependency_order(ShaderNode *node, vector<bool>& visited, vector<ShaderNode*>& order);
+	void clean(bool do_optimize);
+	void constant_fold();
+	void deduplicate_nodes();
 	void bump_from_displacement();
 	void refine_bump_nodes();
+	void image_differentials();
 	void default_inputs(bool do_osl);
 	void transform_multi_closure(ShaderNode *node, ShaderOutput *weight_out, bool volume);
 };
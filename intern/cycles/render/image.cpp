@@ -18,6 +18,8 @@
 #include "image.h"
 #include "scene.h"
 
+#include "kernel_texture_cache.h"
+
 #include "util_foreach.h"
 #include "util_image.h"
 #include "util_path.h"
@@ -34,6 +36,8 @@ ImageManager::ImageManager()
 	need_update = true;
 	pack_images = false;
 	osl_texture_system = NULL;
+	texture_cache_size = 0;
+	texture_cache_system = NULL;
 	animation_frame = 0;
 
 	tex_num_images = TEX_NUM_IMAGES;
@@ -47,6 +51,9 @@ ImageManager::~ImageManager()
 		assert(!images[slot]);
 	for(size_t slot = 0; slot < float_images.size(); slot++)
 		assert(!float_images[slot]);
+
+	if(texture_cache_system)
+		OIIO::TextureSystem::destroy((OIIO::TextureSystem*)texture_cache_system);
 }
 
 void ImageManager::set_pack_images(bool pack_images_)
@@ -66,6 +73,16 @@ void ImageManager::set_extended_image_limits(void)
 	tex_image_byte_start = TEX_EXTENDED_IMAGE_BYTE_START;
 }
 
+void ImageManager::set_texture_cache(int cache_size)
+{
+	texture_cache_size = cache_size;
+}
+
+bool ImageManager::use_texture_cache(void)
+{
+	return texture_cache_size != 0 && !osl_texture_system;
+}
+
 bool ImageManager::set_animation_frame_update(int frame)
 {
 	if(frame != animation_frame) {
@@ -452,6 +469,32 @@ bool ImageManager::file_load_float_image(Image *img, device_vector<float4>& tex_
 	return true;
 }
 
+bool ImageManager::file_load_texture_cache(Image *img, TextureCacheGlobals *tex_cache, int slot)
+{
+	/* builtin images have no file to read tiles from */
+	if(!tex_cache || img->builtin_data || img->filename == "")
+		return false;
+
+	OIIO::TextureSystem *ts = (OIIO::TextureSystem*)texture_cache_system;
+	ustring filename(img->filename);
+	int exists = 0;
+
+	/* images which can't be read are loaded into memory as usual, so they
+	 * show up as missing */
+	if(!ts->get_texture_info(filename, 0, ustring("exists"), TypeDesc::TypeInt, &exists) || !exists)
+		return false;
+
+	OIIO::TextureSystem::TextureHandle *handle = ts->get_texture_handle(filename);
+
+	if(!handle)
+		return false;
+
+	thread_scoped_lock device_lock(device_mutex);
+	tex_cache->handles[slot] = handle;
+
+	return true;
+}
+
 void ImageManager::device_load_image(Device *device, DeviceScene *dscene, int slot, Progress *progress)
 {
 	if(progress->get_cancel())
@@ -471,6 +514,15 @@ void ImageManager::device_load_image(Device *device, DeviceScene *dscene, int sl
 		is_float = true;
 	}
 
+	if(use_texture_cache()) {
+		TextureCacheGlobals *tex_cache = (TextureCacheGlobals*)device->texture_cache_memory();
+
+		if(file_load_texture_cache(img, tex_cache, slot)) {
+			img->need_load = false;
+			return;
+		}
+	}
+
 	if(is_float) {
 		string filename = path_filename(float_images[slot]->filename);
 		progress->set_status("Updating Images", "Loading " + filename);
@@ -552,6 +604,14 @@ void ImageManager::device_free_image(Device *device, DeviceScene *dscene, int sl
 	}
 
 	if(img) {
+		TextureCacheGlobals *tex_cache = (TextureCacheGlobals*)device->texture_cache_memory();
+
+		if(tex_cache && (size_t)slot < tex_cache->handles.size() && tex_cache->handles[slot]) {
+			/* release tiles of the image, it is freed from memory below */
+			((OIIO::TextureSystem*)texture_cache_system)->invalidate(ustring(img->filename));
+			tex_cache->handles[slot] = NULL;
+		}
+
 		if(osl_texture_system) {
 #ifdef WITH_OSL
 			ustring filename(images[slot]->filename);
@@ -592,6 +652,26 @@ void ImageManager::device_update(Device *device, DeviceScene *dscene, Progress&
 	if(!need_update)
 		return;
 
+	TextureCacheGlobals *tex_cache = NULL;
+
+	if(use_texture_cache())
+		tex_cache = (TextureCacheGlobals*)device->texture_cache_memory();
+
+	if(tex_cache) {
+		if(!texture_cache_system) {
+			OIIO::TextureSystem *ts = OIIO::TextureSystem::create(false);
+
+			ts->attribute("automip", 1);
+			ts->attribute("autotile", 64);
+			ts->attribute("gray_to_rgb", 1);
+			ts->attribute("max_memory_MB", (float)texture_cache_size);
+
+			texture_cache_system = ts;
+		}
+
+		tex_cache->handles.resize(tex_image_byte_start + tex_num_images, NULL);
+	}
+
 	TaskPool pool;
 
 	for(size_t slot = 0; slot < images.size(); slot++) {
@@ -622,6 +702,18 @@ void ImageManager::device_update(Device *device, DeviceScene *dscene, Progress&
 
 	pool.wait_work();
 
+	if(tex_cache) {
+		/* only do texture cache lookups in the kernel if any image uses it */
+		tex_cache->ts = NULL;
+
+		foreach(OIIO::TextureSystem::TextureHandle *handle, tex_cache->handles) {
+			if(handle) {
+				tex_cache->ts = (OIIO::TextureSystem*)texture_cache_system;
+				break;
+			}
+		}
+	}
+
 	if(pack_images)
 		device_pack_images(device, dscene, progress);
 
@@ -678,6 +770,13 @@ void ImageManager::device_free(Device *device, DeviceScene *dscene)
 	dscene->tex_image_packed.clear();
 	dscene->tex_image_packed_info.clear();
 
+	TextureCacheGlobals *tex_cache = (TextureCacheGlobals*)device->texture_cache_memory();
+
+	if(tex_cache) {
+		tex_cache->ts = NULL;
+		tex_cache->handles.clear();
+	}
+
 	images.clear();
 	float_images.clear();
 }
@@ -43,6 +43,7 @@ CCL_NAMESPACE_BEGIN
 class Device;
 class DeviceScene;
 class Progress;
+struct TextureCacheGlobals;
 
 class ImageManager {
 public:
@@ -59,6 +60,8 @@ public:
 	void set_osl_texture_system(void *texture_system);
 	void set_pack_images(bool pack_images_);
 	void set_extended_image_limits(void);
+	void set_texture_cache(int cache_size);
+	bool use_texture_cache(void);
 	bool set_animation_frame_update(int frame);
 
 	bool need_update;
@@ -87,8 +90,13 @@ private:
 	void *osl_texture_system;
 	bool pack_images;
 
+	/* in MB, images are read from disk on demand when not zero */
+	int texture_cache_size;
+	void *texture_cache_system;
+
 	bool file_load_image(Image *img, device_vector<uchar4>& tex_img);
 	bool file_load_float_image(Image *img, device_vector<float4>& tex_img);
+	bool file_load_texture_cache(Image *img, TextureCacheGlobals *tex_cache, int slot);
 
 	void device_load_image(Device *device, DeviceScene *dscene, int slot, Progress *progess);
 	void device_free_image(Device *device, DeviceScene *dscene, int slot);
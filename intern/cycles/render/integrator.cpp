@@ -42,6 +42,7 @@ Integrator::Integrator()
 	transparent_shadows = false;
 
 	volume_homogeneous_sampling = 0;
+	volume_heterogeneous_sampling = 0;
 	volume_max_steps = 1024;
 	volume_step_size = 0.1;
 
@@ -65,6 +66,12 @@ Integrator::Integrator()
 
 	sampling_pattern = SAMPLING_PATTERN_SOBOL;
 
+	use_adaptive_sampling = false;
+	adaptive_threshold = 0.01f;
+	adaptive_min_samples = 16;
+
+	use_light_tree = false;
+
 	need_update = true;
 }
 
@@ -106,6 +113,7 @@ void Integrator::device_update(Device *device, DeviceScene *dscene, Scene *scene
 	kintegrator->transparent_shadows = transparent_shadows;
 
 	kintegrator->volume_homogeneous_sampling = volume_homogeneous_sampling;
+	kintegrator->volume_heterogeneous_sampling = volume_heterogeneous_sampling;
 	kintegrator->volume_max_steps = volume_max_steps;
 	kintegrator->volume_step_size = volume_step_size;
 
@@ -133,6 +141,12 @@ void Integrator::device_update(Device *device, DeviceScene *dscene, Scene *scene
 
 	kintegrator->sampling_pattern = sampling_pattern;
 
+	kintegrator->use_adaptive_sampling = use_adaptive_sampling &&
+		(dscene->data.film.pass_flag & PASS_SAMPLE_COUNT) &&
+		(dscene->data.film.pass_flag & PASS_SAMPLE_MOMENT);
+	kintegrator->adaptive_threshold = adaptive_threshold;
+	kintegrator->adaptive_min_samples = max(adaptive_min_samples, 1);
+
 	/* sobol directions table */
 	int max_samples = 1;
 
@@ -179,6 +193,7 @@ bool Integrator::modified(const Integrator& integrator)
 		transparent_probalistic == integrator.transparent_probalistic &&
 		transparent_shadows == integrator.transparent_shadows &&
 		volume_homogeneous_sampling == integrator.volume_homogeneous_sampling &&
+		volume_heterogeneous_sampling == integrator.volume_heterogeneous_sampling &&
 		volume_max_steps == integrator.volume_max_steps &&
 		volume_step_size == integrator.volume_step_size &&
 		no_caustics == integrator.no_caustics &&
@@ -197,11 +212,19 @@ bool Integrator::modified(const Integrator& integrator)
 		subsurface_samples == integrator.subsurface_samples &&
 		volume_samples == integrator.volume_samples &&
 		motion_blur == integrator.motion_blur &&
-		sampling_pattern == integrator.sampling_pattern);
+		sampling_pattern == integrator.sampling_pattern &&
+		use_adaptive_sampling == integrator.use_adaptive_sampling &&
+		adaptive_threshold == integrator.adaptive_threshold &&
+		adaptive_min_samples == integrator.adaptive_min_samples &&
+		use_light_tree == integrator.use_light_tree);
 }
 
 void Integrator::tag_update(Scene *scene)
 {
+	/* light tree is built with the light distribution */
+	if(scene->light_manager->use_light_tree != (use_light_tree && method == PATH))
+		scene->light_manager->tag_update(scene);
+
 	need_update = true;
 }
 
@@ -42,6 +42,7 @@ public:
 	bool transparent_shadows;
 
 	int volume_homogeneous_sampling;
+	int volume_heterogeneous_sampling;
 	int volume_max_steps;
 	float volume_step_size;
 
@@ -73,6 +74,15 @@ public:
 
 	SamplingPattern sampling_pattern;
 
+	/* stop sampling pixels once their noise is below the threshold, needs
+	 * the sample count and moment passes in the film */
+	bool use_adaptive_sampling;
+	float adaptive_threshold;
+	int adaptive_min_samples;
+
+	/* pick lights with a tree built by the light manager, path method only */
+	bool use_light_tree;
+
 	bool need_update;
 
 	Integrator();
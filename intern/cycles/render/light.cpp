@@ -19,6 +19,7 @@
 #include "integrator.h"
 #include "film.h"
 #include "light.h"
+#include "light_tree.h"
 #include "mesh.h"
 #include "object.h"
 #include "scene.h"
@@ -135,6 +136,7 @@ LightManager::LightManager()
 {
 	need_update = true;
 	use_light_visibility = false;
+	use_light_tree = false;
 }
 
 LightManager::~LightManager()
@@ -145,6 +147,11 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 {
 	progress.set_status("Updating Lights", "Computing distribution");
 
+	/* branched path samples lamps and mesh lights separately, tree is only
+	 * used for picking among all lights */
+	use_light_tree = scene->integrator->use_light_tree &&
+		scene->integrator->method == Integrator::PATH;
+
 	/* count */
 	size_t num_lights = scene->lights.size();
 	size_t num_background_lights = 0;
@@ -189,6 +196,8 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 		}
 	}
 
+	LightTree light_tree;
+
 	size_t num_distribution = num_triangles + num_curve_segments;
 	num_distribution += num_lights;
 
@@ -243,6 +252,10 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 				use_light_visibility = true;
 			}
 
+			size_t object_first = offset;
+			float object_area = totarea;
+			BoundBox object_bounds = BoundBox::empty;
+
 			for(size_t i = 0; i < mesh->triangles.size(); i++) {
 				Shader *shader = scene->shaders[mesh->shader[i]];
 
@@ -265,9 +278,19 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 					}
 
 					totarea += triangle_area(p1, p2, p3);
+
+					object_bounds.grow(p1);
+					object_bounds.grow(p2);
+					object_bounds.grow(p3);
 				}
 			}
 
+			if(offset > object_first) {
+				object_area = totarea - object_area;
+				light_tree.add_emitter(object_bounds, object_area, object_area,
+					object_first, offset - object_first, j);
+			}
+
 			/* sample as light disabled for strands */
 #if 0
 			size_t i = 0;
@@ -327,6 +350,22 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 			use_lamp_mis = true;
 		if(light->type == LIGHT_BACKGROUND)
 			num_background_lights++;
+
+		if(light->type == LIGHT_DISTANT || light->type == LIGHT_BACKGROUND) {
+			light_tree.add_distant(offset);
+		}
+		else {
+			float3 extent = make_float3(light->size, light->size, light->size);
+
+			if(light->type == LIGHT_AREA) {
+				float3 axisu = light->axisu*(light->sizeu*light->size);
+				float3 axisv = light->axisv*(light->sizev*light->size);
+				extent = 0.5f*(fabs(axisu) + fabs(axisv));
+			}
+
+			light_tree.add_emitter(BoundBox(light->co - extent, light->co + extent),
+				lightarea, 0.0f, offset, 1, -1);
+		}
 	}
 
 	/* normalize cumulative distribution functions */
@@ -388,6 +427,34 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 
 		/* CDF */
 		device->tex_alloc("__light_distribution", dscene->light_distribution);
+
+		/* light tree, picking distant lights with the same probability as the
+		 * distribution so the background pdf remains valid */
+		kintegrator->use_light_tree = use_light_tree && !light_tree.empty();
+
+		if(kintegrator->use_light_tree) {
+			vector<float4> nodes;
+			vector<uint> objects(scene->objects.size(), ~0);
+
+			light_tree.build(nodes, objects);
+
+			dscene->light_tree_nodes.copy(&nodes[0], nodes.size());
+
+			kintegrator->light_tree_num_distant = light_tree.num_distant();
+			kintegrator->light_tree_pdf = max(1.0f - light_tree.num_distant()*kintegrator->pdf_lights, 0.0f);
+
+			device->tex_alloc("__light_tree_nodes", dscene->light_tree_nodes);
+
+			/* only looked up for emissive objects, a scene with only lamps has none */
+			if(objects.size()) {
+				dscene->light_tree_objects.copy(&objects[0], objects.size());
+				device->tex_alloc("__light_tree_objects", dscene->light_tree_objects);
+			}
+		}
+		else {
+			kintegrator->light_tree_num_distant = 0;
+			kintegrator->light_tree_pdf = 0.0f;
+		}
 	}
 	else {
 		dscene->light_distribution.clear();
@@ -398,6 +465,9 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 		kintegrator->pdf_lights = 0.0f;
 		kintegrator->inv_pdf_lights = 0.0f;
 		kintegrator->use_lamp_mis = false;
+		kintegrator->use_light_tree = false;
+		kintegrator->light_tree_num_distant = 0;
+		kintegrator->light_tree_pdf = 0.0f;
 		kfilm->pass_shadow_scale = 1.0f;
 	}
 }
@@ -668,11 +738,15 @@ void LightManager::device_free(Device *device, DeviceScene *dscene)
 	device->tex_free(dscene->light_data);
 	device->tex_free(dscene->light_background_marginal_cdf);
 	device->tex_free(dscene->light_background_conditional_cdf);
+	device->tex_free(dscene->light_tree_nodes);
+	device->tex_free(dscene->light_tree_objects);
 
 	dscene->light_distribution.clear();
 	dscene->light_data.clear();
 	dscene->light_background_marginal_cdf.clear();
 	dscene->light_background_conditional_cdf.clear();
+	dscene->light_tree_nodes.clear();
+	dscene->light_tree_objects.clear();
 }
 
 void LightManager::tag_update(Scene *scene)
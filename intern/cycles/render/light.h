@@ -64,6 +64,7 @@ public:
 class LightManager {
 public:
 	bool use_light_visibility;
+	bool use_light_tree;
 	bool need_update;
 
 	LightManager();
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2011-2014 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+#include "kernel_types.h"
+
+#include "light_tree.h"
+
+#include "util_algorithm.h"
+
+CCL_NAMESPACE_BEGIN
+
+struct LightTreeEmitterCompare {
+public:
+	int dim;
+
+	LightTreeEmitterCompare(int dim_)
+	{
+		dim = dim_;
+	}
+
+	bool operator()(const LightTreeEmitter& ea, const LightTreeEmitter& eb)
+	{
+		float ca = ea.bounds.min[dim] + ea.bounds.max[dim];
+		float cb = eb.bounds.min[dim] + eb.bounds.max[dim];
+
+		if(ca < cb) return true;
+		else if(ca > cb) return false;
+
+		return ea.first < eb.first;
+	}
+};
+
+LightTree::LightTree()
+{
+	num_nodes = 0;
+}
+
+void LightTree::add_emitter(const BoundBox& bounds, float energy, float area, int first, int num, int object)
+{
+	LightTreeEmitter emitter;
+
+	emitter.bounds = bounds;
+	emitter.energy = energy;
+	emitter.area = area;
+	emitter.first = first;
+	emitter.num = num;
+	emitter.object = object;
+
+	emitters.push_back(emitter);
+}
+
+void LightTree::add_distant(int index)
+{
+	distant.push_back(index);
+}
+
+void LightTree::pack_node(vector<float4>& nodes, int node, const BoundBox& bounds, float energy,
+	int x, int y, float inv_area, int parent)
+{
+	float4 *data = &nodes[node*LIGHT_TREE_NODE_SIZE];
+
+	data[0] = make_float4(bounds.min.x, bounds.min.y, bounds.min.z, energy);
+	data[1] = make_float4(bounds.max.x, bounds.max.y, bounds.max.z, 0.0f);
+	data[2] = make_float4(__int_as_float(x), __int_as_float(y), inv_area, __int_as_float(parent));
+}
+
+void LightTree::build(vector<float4>& nodes, vector<uint>& objects)
+{
+	/* distant lights first, followed by the root */
+	size_t size = distant.size() + (emitters.empty()? 0: 2*emitters.size() - 1);
+
+	nodes.clear();
+	nodes.resize(size*LIGHT_TREE_NODE_SIZE);
+
+	for(size_t i = 0; i < distant.size(); i++)
+		pack_node(nodes, i, BoundBox(make_float3(0.0f, 0.0f, 0.0f)), 0.0f, ~distant[i], 1, 0.0f, -1);
+
+	num_nodes = distant.size();
+
+	if(!emitters.empty())
+		recursive_build(nodes, objects, 0, emitters.size(), -1);
+}
+
+int LightTree::recursive_build(vector<float4>& nodes, vector<uint>& objects, int start, int end, int parent)
+{
+	int node = num_nodes++;
+	BoundBox bounds = BoundBox::empty;
+	BoundBox centroid_bounds = BoundBox::empty;
+	float energy = 0.0f;
+
+	for(int i = start; i < end; i++) {
+		bounds.grow(emitters[i].bounds);
+		centroid_bounds.grow(emitters[i].bounds.center());
+		energy += emitters[i].energy;
+	}
+
+	if(end - start == 1) {
+		LightTreeEmitter& emitter = emitters[start];
+		float inv_area = (emitter.area > 0.0f)? 1.0f/emitter.area: 0.0f;
+
+		pack_node(nodes, node, bounds, energy, ~emitter.first, emitter.num, inv_area, parent);
+
+		if(emitter.object != -1)
+			objects[emitter.object] = node;
+
+		return node;
+	}
+
+	/* split in the middle along the largest axis of the centroids */
+	float3 size = centroid_bounds.size();
+	int dim = (size.x > size.y)? ((size.x > size.z)? 0: 2): ((size.y > size.z)? 1: 2);
+	int mid = (start + end)/2;
+
+	sort(emitters.begin() + start, emitters.begin() + end, LightTreeEmitterCompare(dim));
+
+	int left = recursive_build(nodes, objects, start, mid, node);
+	int right = recursive_build(nodes, objects, mid, end, node);
+
+	pack_node(nodes, node, bounds, energy, left, right, 0.0f, parent);
+
+	return node;
+}
+
+CCL_NAMESPACE_END
+
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2011-2014 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+#ifndef __LIGHT_TREE_H__
+#define __LIGHT_TREE_H__
+
+#include "util_boundbox.h"
+#include "util_types.h"
+#include "util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Light Tree Emitter
+ *
+ * A lamp or the emissive triangles of one object, as a range of entries in
+ * the light distribution. */
+
+struct LightTreeEmitter {
+	BoundBox bounds;
+	float energy;
+	float area;
+	int first;
+	int num;
+	int object;
+};
+
+/* Light Tree
+ *
+ * Binary tree over the emitters in the light distribution, so the kernel can
+ * pick lights by their estimated contribution at the shading point instead of
+ * by area only. See kernel_light.h for the node layout. */
+
+class LightTree {
+public:
+	LightTree();
+
+	void add_emitter(const BoundBox& bounds, float energy, float area, int first, int num, int object);
+	void add_distant(int index);
+
+	bool empty() { return emitters.empty(); }
+	int num_distant() { return distant.size(); }
+
+	/* fills nodes, and the leaf node of each emissive object in objects,
+	 * which must have an entry for every object */
+	void build(vector<float4>& nodes, vector<uint>& objects);
+
+protected:
+	vector<LightTreeEmitter> emitters;
+	vector<int> distant;
+	int num_nodes;
+
+	int recursive_build(vector<float4>& nodes, vector<uint>& objects, int start, int end, int parent);
+	void pack_node(vector<float4>& nodes, int node, const BoundBox& bounds, float energy,
+		int x, int y, float inv_area, int parent);
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __LIGHT_TREE_H__ */
+
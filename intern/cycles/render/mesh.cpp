@@ -369,7 +369,7 @@ void Mesh::pack_curves(Scene *scene, float4 *curve_key_co, float4 *curve_data, s
 	}
 }
 
-void Mesh::compute_bvh(SceneParams *params, Progress *progress, int n, int total)
+void Mesh::compute_bvh(SceneParams *params, bool use_obvh, Progress *progress, int n, int total)
 {
 	if(progress->get_cancel())
 		return;
@@ -401,6 +401,7 @@ void Mesh::compute_bvh(SceneParams *params, Progress *progress, int n, int total
 			bparams.use_cache = params->use_bvh_cache;
 			bparams.use_spatial_split = params->use_bvh_spatial_split;
 			bparams.use_qbvh = params->use_qbvh;
+			bparams.use_obvh = use_obvh;
 
 			delete bvh;
 			bvh = BVH::create(bparams, objects);
@@ -436,6 +437,7 @@ MeshManager::MeshManager()
 {
 	bvh = NULL;
 	need_update = true;
+	need_update_volume = true;
 }
 
 MeshManager::~MeshManager()
@@ -832,6 +834,13 @@ void MeshManager::device_update_mesh(Device *device, DeviceScene *dscene, Scene
 	}
 }
 
+/* OSL trace() uses the kernel traversal of the OSL services, which are not
+ * compiled with AVX and can't traverse 8-wide nodes */
+static bool mesh_use_obvh(Device *device, Scene *scene)
+{
+	return device->info.use_obvh && !scene->shader_manager->use_osl();
+}
+
 void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
 {
 	/* bvh build */
@@ -840,9 +849,19 @@ void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *
 	BVHParams bparams;
 	bparams.top_level = true;
 	bparams.use_qbvh = scene->params.use_qbvh;
+	bparams.use_obvh = mesh_use_obvh(device, scene);
 	bparams.use_spatial_split = scene->params.use_bvh_spatial_split;
 	bparams.use_cache = scene->params.use_bvh_cache;
 
+	/* interpolate top level bounds at the ray time for moving objects */
+	float shuttertime = scene->camera->shuttertime;
+#ifdef __OBJECT_MOTION__
+	if(scene->need_motion(device->info.advanced_shading) == Scene::MOTION_BLUR && shuttertime > 0.0f) {
+		bparams.use_motion_nodes = true;
+		bparams.motion_shuttertime = shuttertime;
+	}
+#endif
+
 	delete bvh;
 	bvh = BVH::create(bparams, scene->objects);
 	bvh->build(progress);
@@ -858,6 +877,10 @@ void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *
 		dscene->bvh_nodes.reference((float4*)&pack.nodes[0], pack.nodes.size());
 		device->tex_alloc("__bvh_nodes", dscene->bvh_nodes);
 	}
+	if(pack.motion_nodes.size()) {
+		dscene->bvh_motion_nodes.reference(&pack.motion_nodes[0], pack.motion_nodes.size());
+		device->tex_alloc("__bvh_motion_nodes", dscene->bvh_motion_nodes);
+	}
 	if(pack.object_node.size()) {
 		dscene->object_node.reference((uint*)&pack.object_node[0], pack.object_node.size());
 		device->tex_alloc("__object_node", dscene->object_node);
@@ -884,6 +907,23 @@ void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *
 	}
 
 	dscene->data.bvh.root = pack.root_index;
+	dscene->data.bvh.use_obvh = bparams.use_obvh;
+
+	/* motion steps are evenly spaced over the shutter */
+	KernelBVH *kbvh = &dscene->data.bvh;
+
+	if(pack.motion_nodes.size()) {
+		int node_motion_size = (bparams.use_obvh)? BVH_ONODE_MOTION_SIZE: BVH_NODE_MOTION_SIZE;
+
+		kbvh->num_motion_nodes = pack.motion_nodes.size()/node_motion_size;
+		kbvh->motion_time_start = 0.5f - shuttertime*0.25f;
+		kbvh->motion_time_scale = (BVH_MOTION_STEPS - 1)/(shuttertime*0.5f);
+	}
+	else {
+		kbvh->num_motion_nodes = 0;
+		kbvh->motion_time_start = 0.0f;
+		kbvh->motion_time_scale = 0.0f;
+	}
 }
 
 void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
@@ -907,6 +947,7 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 
 	/* device update */
 	device_free(device, dscene);
+	need_update_volume = true;
 
 	device_update_mesh(device, dscene, scene, progress);
 	if(progress.get_cancel()) return;
@@ -946,7 +987,7 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 
 	foreach(Mesh *mesh, scene->meshes) {
 		if(mesh->need_update) {
-			pool.push(function_bind(&Mesh::compute_bvh, mesh, &scene->params, &progress, i, num_bvh));
+			pool.push(function_bind(&Mesh::compute_bvh, mesh, &scene->params, mesh_use_obvh(device, scene), &progress, i, num_bvh));
 			i++;
 		}
 	}
@@ -977,6 +1018,7 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 void MeshManager::device_free(Device *device, DeviceScene *dscene)
 {
 	device->tex_free(dscene->bvh_nodes);
+	device->tex_free(dscene->bvh_motion_nodes);
 	device->tex_free(dscene->object_node);
 	device->tex_free(dscene->tri_woop);
 	device->tex_free(dscene->prim_segment);
@@ -994,6 +1036,7 @@ void MeshManager::device_free(Device *device, DeviceScene *dscene)
 	device->tex_free(dscene->attributes_float3);
 
 	dscene->bvh_nodes.clear();
+	dscene->bvh_motion_nodes.clear();
 	dscene->object_node.clear();
 	dscene->tri_woop.clear();
 	dscene->prim_segment.clear();
@@ -1010,6 +1053,8 @@ void MeshManager::device_free(Device *device, DeviceScene *dscene)
 	dscene->attributes_float.clear();
 	dscene->attributes_float3.clear();
 
+	device_free_volume(device, dscene);
+
 #ifdef WITH_OSL
 	OSLGlobals *og = (OSLGlobals*)device->osl_memory();
 
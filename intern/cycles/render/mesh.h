@@ -120,7 +120,7 @@ public:
 	void pack_normals(Scene *scene, float4 *normal, float4 *vnormal);
 	void pack_verts(float4 *tri_verts, float4 *tri_vindex, size_t vert_offset);
 	void pack_curves(Scene *scene, float4 *curve_key_co, float4 *curve_data, size_t curvekey_offset);
-	void compute_bvh(SceneParams *params, Progress *progress, int n, int total);
+	void compute_bvh(SceneParams *params, bool use_obvh, Progress *progress, int n, int total);
 
 	bool need_attribute(Scene *scene, AttributeStandard std);
 	bool need_attribute(Scene *scene, ustring name);
@@ -135,12 +135,17 @@ public:
 	BVH *bvh;
 
 	bool need_update;
+	bool need_update_volume;
 
 	MeshManager();
 	~MeshManager();
 
 	bool displace(Device *device, DeviceScene *dscene, Scene *scene, Mesh *mesh, Progress& progress);
 
+	/* volume majorants */
+	void device_update_volume(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress);
+	void device_free_volume(Device *device, DeviceScene *dscene);
+
 	/* attributes */
 	void update_osl_attributes(Device *device, Scene *scene, vector<AttributeRequestSet>& mesh_attributes);
 	void update_svm_attributes(Device *device, DeviceScene *dscene, Scene *scene, vector<AttributeRequestSet>& mesh_attributes);
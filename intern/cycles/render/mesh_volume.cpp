@@ -0,0 +1,244 @@
+/*
+ * Copyright 2011-2014 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+#include "device.h"
+
+#include "integrator.h"
+#include "mesh.h"
+#include "mesh_volume.h"
+#include "object.h"
+#include "scene.h"
+#include "shader.h"
+
+#include "util_foreach.h"
+#include "util_progress.h"
+
+CCL_NAMESPACE_BEGIN
+
+static bool object_has_volume(Scene *scene, Object *object)
+{
+	foreach(uint sindex, object->mesh->used_shaders)
+		if(scene->shaders[sindex]->has_volume)
+			return true;
+
+	return false;
+}
+
+static bool volume_majorant_grid(Device *device, Scene *scene, int object_index, const BoundBox& bounds,
+                                 int3 res, vector<float>& majorants, vector<float>& emission_rates,
+                                 Progress& progress)
+{
+	Object *object = scene->objects[object_index];
+	float3 cell_size = bounds.size()/make_float3((float)res.x, (float)res.y, (float)res.z);
+
+	/* setup input for device task, the position followed by object and
+	 * shader for each lattice point and volume shader */
+	int3 lres = make_int3(res.x*2 + 1, res.y*2 + 1, res.z*2 + 1);
+	size_t num_points = (size_t)lres.x*lres.y*lres.z;
+
+	vector<uint> shaders;
+
+	foreach(uint sindex, object->mesh->used_shaders)
+		if(scene->shaders[sindex]->has_volume)
+			shaders.push_back(sindex);
+
+	device_vector<uint4> d_input;
+	uint4 *d_input_data = d_input.resize(num_points*shaders.size()*2);
+	size_t d_input_size = 0;
+
+	for(int z = 0; z < lres.z; z++) {
+		for(int y = 0; y < lres.y; y++) {
+			for(int x = 0; x < lres.x; x++) {
+				float3 P = bounds.min + make_float3(x*0.5f, y*0.5f, z*0.5f)*cell_size;
+
+				foreach(uint sindex, shaders) {
+					d_input_data[d_input_size++] = make_uint4(__float_as_uint(P.x), __float_as_uint(P.y), __float_as_uint(P.z), 0);
+					d_input_data[d_input_size++] = make_uint4(object_index, sindex, 0, 0);
+				}
+			}
+		}
+	}
+
+	/* run device task */
+	device_vector<float4> d_output;
+	d_output.resize(d_input_size/2);
+
+	device->mem_alloc(d_input, MEM_READ_ONLY);
+	device->mem_copy_to(d_input);
+	device->mem_alloc(d_output, MEM_WRITE_ONLY);
+
+	DeviceTask task(DeviceTask::SHADER);
+	task.shader_input = d_input.device_pointer;
+	task.shader_output = d_output.device_pointer;
+	task.shader_eval_type = SHADER_EVAL_VOLUME;
+	task.shader_x = 0;
+	task.shader_w = d_output.size();
+
+	device->task_add(task);
+	device->task_wait();
+
+	device->mem_copy_from(d_output, 0, 1, d_output.size(), sizeof(float4));
+	device->mem_free(d_input);
+	device->mem_free(d_output);
+
+	if(progress.get_cancel())
+		return false;
+
+	/* extinction and emission at lattice points, summed over shaders and
+	 * maximum over color channels */
+	float4 *output = (float4*)d_output.data_pointer;
+	vector<float> sigma_t(num_points, 0.0f);
+	vector<float> emission(num_points, 0.0f);
+
+	for(size_t i = 0; i < num_points; i++) {
+		for(size_t j = 0; j < shaders.size(); j++) {
+			float4 out = output[i*shaders.size() + j];
+			sigma_t[i] += max(max(out.x, out.y), out.z);
+			emission[i] += out.w;
+		}
+	}
+
+	volume_majorants_from_lattice(res, cell_size, sigma_t, emission, majorants, emission_rates);
+
+	return true;
+}
+
+void MeshManager::device_update_volume(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
+{
+	if(!need_update_volume)
+		return;
+
+	device_free_volume(device, dscene);
+
+	KernelIntegrator *kintegrator = &dscene->data.integrator;
+	kintegrator->volume_majorants = 0;
+
+	/* only needed for delta tracking */
+	if(scene->integrator->volume_heterogeneous_sampling != 1) {
+		need_update_volume = false;
+		return;
+	}
+
+	bool motion_blur = (scene->need_motion() == Scene::MOTION_BLUR);
+	size_t num_volume_objects = 0;
+
+	foreach(Object *object, scene->objects) {
+		/* majorants are computed at the center of the shutter */
+		if(motion_blur && object->use_motion)
+			continue;
+
+		if(object_has_volume(scene, object) && object->bounds.valid())
+			num_volume_objects++;
+	}
+
+	if(num_volume_objects == 0) {
+		need_update_volume = false;
+		return;
+	}
+
+	/* needs to be up to date for attribute access */
+	device->const_copy_to("__data", &dscene->data, sizeof(dscene->data));
+
+	float4 *grid = dscene->volume_grid.resize(scene->objects.size()*VOLUME_GRID_SIZE);
+	vector<float> majorants;
+	size_t n = 0;
+
+	for(size_t i = 0; i < scene->objects.size(); i++) {
+		Object *object = scene->objects[i];
+		float4 *info = &grid[i*VOLUME_GRID_SIZE];
+
+		info[0] = make_float4(0.0f, 0.0f, 0.0f, __int_as_float(-1));
+		info[1] = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+		info[2] = make_float4(0.0f, 0.0f, 0.0f, __int_as_float(-1));
+
+		if(motion_blur && object->use_motion)
+			continue;
+		if(!object_has_volume(scene, object) || !object->bounds.valid())
+			continue;
+
+		string msg = string_printf("Computing Volume Majorants %u/%u", (uint)(n+1), (uint)num_volume_objects);
+		progress.set_status("Updating Volumes", msg);
+		n++;
+
+		/* resolution proportional to the bounds, padded so that flat
+		 * objects have a non-zero size */
+		BoundBox bounds = object->bounds;
+		float3 size = bounds.size();
+		float max_size = max(max(size.x, size.y), size.z);
+
+		if(max_size <= 0.0f)
+			continue;
+
+		float3 pad = make_float3(1e-4f*max_size, 1e-4f*max_size, 1e-4f*max_size);
+
+		bounds.min = bounds.min - pad;
+		bounds.max = bounds.max + pad;
+		size = bounds.size();
+
+		int3 res = make_int3(
+			clamp((int)ceilf(VOLUME_GRID_RESOLUTION*size.x/max_size), 1, VOLUME_GRID_RESOLUTION),
+			clamp((int)ceilf(VOLUME_GRID_RESOLUTION*size.y/max_size), 1, VOLUME_GRID_RESOLUTION),
+			clamp((int)ceilf(VOLUME_GRID_RESOLUTION*size.z/max_size), 1, VOLUME_GRID_RESOLUTION));
+
+		size_t offset = majorants.size();
+		vector<float> emission_rates;
+
+		if(!volume_majorant_grid(device, scene, i, bounds, res, majorants, emission_rates, progress))
+			return;
+
+		/* emission rates follow the majorants of the object */
+		int emission_offset = (emission_rates.size())? (int)majorants.size(): -1;
+		majorants.insert(majorants.end(), emission_rates.begin(), emission_rates.end());
+
+		float max_majorant = 0.0f;
+
+		for(size_t j = offset; j < majorants.size(); j++)
+			max_majorant = max(max_majorant, majorants[j]);
+
+		info[0] = make_float4(bounds.min.x, bounds.min.y, bounds.min.z, __int_as_float((int)offset));
+		info[1] = make_float4(bounds.max.x, bounds.max.y, bounds.max.z, max_majorant);
+		info[2] = make_float4((float)res.x, (float)res.y, (float)res.z, __int_as_float(emission_offset));
+	}
+
+	if(majorants.size() == 0) {
+		dscene->volume_grid.clear();
+		need_update_volume = false;
+		return;
+	}
+
+	/* copy to device */
+	float *dmajorants = dscene->volume_majorants.resize(majorants.size());
+	memcpy(dmajorants, &majorants[0], majorants.size()*sizeof(float));
+
+	device->tex_alloc("__volume_grid", dscene->volume_grid);
+	device->tex_alloc("__volume_majorants", dscene->volume_majorants);
+
+	kintegrator->volume_majorants = 1;
+
+	need_update_volume = false;
+}
+
+void MeshManager::device_free_volume(Device *device, DeviceScene *dscene)
+{
+	device->tex_free(dscene->volume_grid);
+	device->tex_free(dscene->volume_majorants);
+
+	dscene->volume_grid.clear();
+	dscene->volume_majorants.clear();
+}
+
+CCL_NAMESPACE_END
+
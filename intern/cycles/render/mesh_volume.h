@@ -0,0 +1,114 @@
+/*
+ * Copyright 2011-2014 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+#ifndef __MESH_VOLUME_H__
+#define __MESH_VOLUME_H__
+
+#include "util_math.h"
+#include "util_types.h"
+#include "util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Volume Majorants
+ *
+ * The volume shaders of an object are evaluated on a lattice over its
+ * bounds, with two lattice intervals per cell along each axis. Each cell gets
+ * the maximum of the lattice points of the cell and its neighbors, to be
+ * conservative for detail between the lattice points.
+ *
+ * Kept separate from mesh_volume.cpp so the benchmark in test/benchmark can
+ * build the same grid. */
+
+/* number of cells along the longest axis of the object bounds */
+#define VOLUME_GRID_RESOLUTION 32
+
+/* minimum number of tentative collisions per cell width in cells with
+ * emission, tracking only picks up emission at collisions */
+#define VOLUME_EMISSION_COLLISIONS 4.0f
+
+/* maximum over the lattice points of each cell and its neighbors, appended
+ * to cells */
+static inline void volume_lattice_to_cells(int3 res, const vector<float>& lattice, vector<float>& cells)
+{
+	int3 lres = make_int3(res.x*2 + 1, res.y*2 + 1, res.z*2 + 1);
+
+	/* maximum of lattice points per cell */
+	vector<float> cell_max((size_t)res.x*res.y*res.z, 0.0f);
+
+	for(int z = 0; z < res.z; z++) {
+		for(int y = 0; y < res.y; y++) {
+			for(int x = 0; x < res.x; x++) {
+				float m = 0.0f;
+
+				for(int k = 0; k < 3; k++)
+					for(int j = 0; j < 3; j++)
+						for(int i = 0; i < 3; i++)
+							m = max(m, lattice[(x*2 + i) + lres.x*((y*2 + j) + lres.y*(z*2 + k))]);
+
+				cell_max[x + res.x*(y + res.y*z)] = m;
+			}
+		}
+	}
+
+	/* dilate to neighbor cells */
+	for(int z = 0; z < res.z; z++) {
+		for(int y = 0; y < res.y; y++) {
+			for(int x = 0; x < res.x; x++) {
+				float m = 0.0f;
+
+				for(int k = max(z - 1, 0); k <= min(z + 1, res.z - 1); k++)
+					for(int j = max(y - 1, 0); j <= min(y + 1, res.y - 1); j++)
+						for(int i = max(x - 1, 0); i <= min(x + 1, res.x - 1); i++)
+							m = max(m, cell_max[i + res.x*(j + res.y*k)]);
+
+				cells.push_back(m);
+			}
+		}
+	}
+}
+
+/* majorants of the extinction coefficient per cell from the extinction at
+ * the lattice points, and the collision rate per cell needed to sample the
+ * emission. emission_rates stays empty without emission */
+static inline void volume_majorants_from_lattice(int3 res, float3 cell_size,
+                                                 const vector<float>& sigma_t, const vector<float>& emission,
+                                                 vector<float>& majorants, vector<float>& emission_rates)
+{
+	volume_lattice_to_cells(res, sigma_t, majorants);
+
+	bool has_emission = false;
+
+	for(size_t i = 0; i < emission.size() && !has_emission; i++)
+		if(emission[i] > 0.0f)
+			has_emission = true;
+
+	if(!has_emission)
+		return;
+
+	vector<float> emission_cells;
+	volume_lattice_to_cells(res, emission, emission_cells);
+
+	float rate = VOLUME_EMISSION_COLLISIONS/min(min(cell_size.x, cell_size.y), cell_size.z);
+
+	for(size_t i = 0; i < emission_cells.size(); i++)
+		emission_rates.push_back((emission_cells[i] > 0.0f)? rate: 0.0f);
+}
+
+CCL_NAMESPACE_END
+
+#endif /* __MESH_VOLUME_H__ */
+
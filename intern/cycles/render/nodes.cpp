@@ -20,9 +20,12 @@
 #include "osl.h"
 #include "sky_model.h"
 
+#include "util_color.h"
 #include "util_foreach.h"
 #include "util_transform.h"
 
+#include "svm_math_util.h"
+
 CCL_NAMESPACE_BEGIN
 
 /* Texture Mapping */
@@ -122,6 +125,21 @@ bool TextureMapping::skip()
 	return true;
 }
 
+bool TextureMapping::equals(const TextureMapping& other)
+{
+	return translation == other.translation &&
+	       rotation == other.rotation &&
+	       scale == other.scale &&
+	       min == other.min &&
+	       max == other.max &&
+	       use_minmax == other.use_minmax &&
+	       type == other.type &&
+	       x_mapping == other.x_mapping &&
+	       y_mapping == other.y_mapping &&
+	       z_mapping == other.z_mapping &&
+	       projection == other.projection;
+}
+
 void TextureMapping::compile(SVMCompiler& compiler, int offset_in, int offset_out)
 {
 	if(offset_in == SVM_STACK_INVALID || offset_out == SVM_STACK_INVALID)
@@ -197,6 +215,12 @@ ImageTextureNode::ImageTextureNode()
 	animated = false;
 
 	add_input("Vector", SHADER_SOCKET_POINT, ShaderInput::TEXTURE_UV);
+
+	/* connected by the graph when the image is read through the texture cache,
+	 * texture coordinates offset by the ray differentials to pick a mip map */
+	add_input("VectorDx", SHADER_SOCKET_POINT, 0.0f, ShaderInput::USE_SVM);
+	add_input("VectorDy", SHADER_SOCKET_POINT, 0.0f, ShaderInput::USE_SVM);
+
 	add_output("Color", SHADER_SOCKET_COLOR);
 	add_output("Alpha", SHADER_SOCKET_FLOAT);
 }
@@ -235,6 +259,8 @@ void ImageTextureNode::attributes(Shader *shader, AttributeRequestSet *attribute
 void ImageTextureNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *vector_in = input("Vector");
+	ShaderInput *vector_dx_in = input("VectorDx");
+	ShaderInput *vector_dy_in = input("VectorDy");
 	ShaderOutput *color_out = output("Color");
 	ShaderOutput *alpha_out = output("Alpha");
 
@@ -255,12 +281,29 @@ void ImageTextureNode::compile(SVMCompiler& compiler)
 
 		int srgb = (is_linear || color_space != "Color")? 0: 1;
 		int vector_offset = vector_in->stack_offset;
+		int vector_dx_offset = SVM_STACK_INVALID;
+		int vector_dy_offset = SVM_STACK_INVALID;
 
 		if(!tex_mapping.skip()) {
 			vector_offset = compiler.stack_find_offset(SHADER_SOCKET_VECTOR);
 			tex_mapping.compile(compiler, vector_in->stack_offset, vector_offset);
 		}
 
+		if(vector_dx_in->link && vector_dy_in->link) {
+			compiler.stack_assign(vector_dx_in);
+			compiler.stack_assign(vector_dy_in);
+
+			vector_dx_offset = vector_dx_in->stack_offset;
+			vector_dy_offset = vector_dy_in->stack_offset;
+
+			if(!tex_mapping.skip()) {
+				vector_dx_offset = compiler.stack_find_offset(SHADER_SOCKET_VECTOR);
+				tex_mapping.compile(compiler, vector_dx_in->stack_offset, vector_dx_offset);
+				vector_dy_offset = compiler.stack_find_offset(SHADER_SOCKET_VECTOR);
+				tex_mapping.compile(compiler, vector_dy_in->stack_offset, vector_dy_offset);
+			}
+		}
+
 		if(projection == "Flat") {
 			compiler.add_node(NODE_TEX_IMAGE,
 				slot,
@@ -268,7 +311,10 @@ void ImageTextureNode::compile(SVMCompiler& compiler)
 					vector_offset,
 					color_out->stack_offset,
 					alpha_out->stack_offset,
-					srgb));
+					srgb),
+				compiler.encode_uchar4(
+					vector_dx_offset,
+					vector_dy_offset));
 		}
 		else {
 			compiler.add_node(NODE_TEX_IMAGE_BOX,
@@ -279,10 +325,15 @@ void ImageTextureNode::compile(SVMCompiler& compiler)
 					alpha_out->stack_offset,
 					srgb),
 				__float_as_int(projection_blend));
+			compiler.add_node(vector_dx_offset, vector_dy_offset);
 		}
 	
 		if(vector_offset != vector_in->stack_offset)
 			compiler.stack_clear_offset(vector_in->type, vector_offset);
+		if(vector_dx_in->link && vector_dx_offset != vector_dx_in->stack_offset)
+			compiler.stack_clear_offset(vector_dx_in->type, vector_dx_offset);
+		if(vector_dy_in->link && vector_dy_offset != vector_dy_in->stack_offset)
+			compiler.stack_clear_offset(vector_dy_in->type, vector_dy_offset);
 	}
 	else {
 		/* image not found */
@@ -318,6 +369,20 @@ void ImageTextureNode::compile(OSLCompiler& compiler)
 	compiler.add(this, "node_image_texture");
 }
 
+bool ImageTextureNode::equals(const ShaderNode *other)
+{
+	const ImageTextureNode *image_node = (const ImageTextureNode*)other;
+
+	return inputs_equal(other) &&
+	       tex_mapping.equals(image_node->tex_mapping) &&
+	       filename == image_node->filename &&
+	       builtin_data == image_node->builtin_data &&
+	       color_space == image_node->color_space &&
+	       projection == image_node->projection &&
+	       projection_blend == image_node->projection_blend &&
+	       animated == image_node->animated;
+}
+
 /* Environment Texture */
 
 static ShaderEnum env_projection_init()
@@ -454,6 +519,19 @@ void EnvironmentTextureNode::compile(OSLCompiler& compiler)
 	compiler.add(this, "node_environment_texture");
 }
 
+bool EnvironmentTextureNode::equals(const ShaderNode *other)
+{
+	const EnvironmentTextureNode *env_node = (const EnvironmentTextureNode*)other;
+
+	return inputs_equal(other) &&
+	       tex_mapping.equals(env_node->tex_mapping) &&
+	       filename == env_node->filename &&
+	       builtin_data == env_node->builtin_data &&
+	       color_space == env_node->color_space &&
+	       projection == env_node->projection &&
+	       animated == env_node->animated;
+}
+
 /* Sky Texture */
 
 static float2 sky_spherical_coordinates(float3 dir)
@@ -724,6 +802,15 @@ void GradientTextureNode::compile(OSLCompiler& compiler)
 	compiler.add(this, "node_gradient_texture");
 }
 
+bool GradientTextureNode::equals(const ShaderNode *other)
+{
+	const GradientTextureNode *gradient_node = (const GradientTextureNode*)other;
+
+	return inputs_equal(other) &&
+	       tex_mapping.equals(gradient_node->tex_mapping) &&
+	       type == gradient_node->type;
+}
+
 /* Noise Texture */
 
 NoiseTextureNode::NoiseTextureNode()
@@ -783,6 +870,14 @@ void NoiseTextureNode::compile(OSLCompiler& compiler)
 	compiler.add(this, "node_noise_texture");
 }
 
+bool NoiseTextureNode::equals(const ShaderNode *other)
+{
+	const NoiseTextureNode *noise_node = (const NoiseTextureNode*)other;
+
+	return inputs_equal(other) &&
+	       tex_mapping.equals(noise_node->tex_mapping);
+}
+
 /* Voronoi Texture */
 
 static ShaderEnum voronoi_coloring_init()
@@ -846,6 +941,15 @@ void VoronoiTextureNode::compile(OSLCompiler& compiler)
 	compiler.add(this, "node_voronoi_texture");
 }
 
+bool VoronoiTextureNode::equals(const ShaderNode *other)
+{
+	const VoronoiTextureNode *voronoi_node = (const VoronoiTextureNode*)other;
+
+	return inputs_equal(other) &&
+	       tex_mapping.equals(voronoi_node->tex_mapping) &&
+	       coloring == voronoi_node->coloring;
+}
+
 /* Musgrave Texture */
 
 static ShaderEnum musgrave_type_init()
@@ -936,6 +1040,15 @@ void MusgraveTextureNode::compile(OSLCompiler& compiler)
 	compiler.add(this, "node_musgrave_texture");
 }
 
+bool MusgraveTextureNode::equals(const ShaderNode *other)
+{
+	const MusgraveTextureNode *musgrave_node = (const MusgraveTextureNode*)other;
+
+	return inputs_equal(other) &&
+	       tex_mapping.equals(musgrave_node->tex_mapping) &&
+	       type == musgrave_node->type;
+}
+
 /* Wave Texture */
 
 static ShaderEnum wave_type_init()
@@ -1016,6 +1129,15 @@ void WaveTextureNode::compile(OSLCompiler& compiler)
 	compiler.add(this, "node_wave_texture");
 }
 
+bool WaveTextureNode::equals(const ShaderNode *other)
+{
+	const WaveTextureNode *wave_node = (const WaveTextureNode*)other;
+
+	return inputs_equal(other) &&
+	       tex_mapping.equals(wave_node->tex_mapping) &&
+	       type == wave_node->type;
+}
+
 /* Magic Texture */
 
 MagicTextureNode::MagicTextureNode()
@@ -1074,6 +1196,15 @@ void MagicTextureNode::compile(OSLCompiler& compiler)
 	compiler.add(this, "node_magic_texture");
 }
 
+bool MagicTextureNode::equals(const ShaderNode *other)
+{
+	const MagicTextureNode *magic_node = (const MagicTextureNode*)other;
+
+	return inputs_equal(other) &&
+	       tex_mapping.equals(magic_node->tex_mapping) &&
+	       depth == magic_node->depth;
+}
+
 /* Checker Texture */
 
 CheckerTextureNode::CheckerTextureNode()
@@ -1131,6 +1262,14 @@ void CheckerTextureNode::compile(OSLCompiler& compiler)
 	compiler.add(this, "node_checker_texture");
 }
 
+bool CheckerTextureNode::equals(const ShaderNode *other)
+{
+	const CheckerTextureNode *checker_node = (const CheckerTextureNode*)other;
+
+	return inputs_equal(other) &&
+	       tex_mapping.equals(checker_node->tex_mapping);
+}
+
 /* Brick Texture */
 
 BrickTextureNode::BrickTextureNode()
@@ -1225,6 +1364,18 @@ void BrickTextureNode::compile(OSLCompiler& compiler)
 	compiler.add(this, "node_brick_texture");
 }
 
+bool BrickTextureNode::equals(const ShaderNode *other)
+{
+	const BrickTextureNode *brick_node = (const BrickTextureNode*)other;
+
+	return inputs_equal(other) &&
+	       tex_mapping.equals(brick_node->tex_mapping) &&
+	       offset == brick_node->offset &&
+	       squash == brick_node->squash &&
+	       offset_frequency == brick_node->offset_frequency &&
+	       squash_frequency == brick_node->squash_frequency;
+}
+
 /* Normal */
 
 NormalNode::NormalNode()
@@ -1291,6 +1442,14 @@ void MappingNode::compile(OSLCompiler& compiler)
 	compiler.add(this, "node_mapping");
 }
 
+bool MappingNode::equals(const ShaderNode *other)
+{
+	const MappingNode *mapping_node = (const MappingNode*)other;
+
+	return inputs_equal(other) &&
+	       tex_mapping.equals(mapping_node->tex_mapping);
+}
+
 /* Convert */
 
 ConvertNode::ConvertNode(ShaderSocketType from_, ShaderSocketType to_, bool autoconvert)
@@ -1423,6 +1582,36 @@ void ConvertNode::compile(OSLCompiler& compiler)
 		assert(0);
 }
 
+bool ConvertNode::equals(const ShaderNode *other)
+{
+	const ConvertNode *convert_node = (const ConvertNode*)other;
+
+	return inputs_equal(other) && from == convert_node->from && to == convert_node->to;
+}
+
+bool ConvertNode::constant_fold(ShaderOutput *socket, float3 *optimized_value)
+{
+	ShaderInput *in = inputs[0];
+
+	/* int and string conversions are left to the kernel */
+	if(in->link || from == SHADER_SOCKET_INT || to == SHADER_SOCKET_INT ||
+	   from == SHADER_SOCKET_STRING || to == SHADER_SOCKET_STRING)
+		return false;
+
+	float3 value = in->value;
+
+	if(from == SHADER_SOCKET_FLOAT)
+		*optimized_value = make_float3(value.x, value.x, value.x);
+	else if(to == SHADER_SOCKET_FLOAT && from == SHADER_SOCKET_COLOR)
+		*optimized_value = make_float3(linear_rgb_to_gray(value), 0.0f, 0.0f);
+	else if(to == SHADER_SOCKET_FLOAT)
+		*optimized_value = make_float3((value.x + value.y + value.z)*(1.0f/3.0f), 0.0f, 0.0f);
+	else
+		*optimized_value = value;
+
+	return true;
+}
+
 /* Proxy */
 
 ProxyNode::ProxyNode(ShaderSocketType type_)
@@ -2162,6 +2351,11 @@ void GeometryNode::compile(OSLCompiler& compiler)
 	compiler.add(this, "node_geometry");
 }
 
+bool GeometryNode::equals(const ShaderNode *other)
+{
+	return inputs_equal(other);
+}
+
 /* TextureCoordinate */
 
 TextureCoordinateNode::TextureCoordinateNode()
@@ -2310,6 +2504,13 @@ void TextureCoordinateNode::compile(OSLCompiler& compiler)
 	compiler.add(this, "node_texture_coordinate");
 }
 
+bool TextureCoordinateNode::equals(const ShaderNode *other)
+{
+	const TextureCoordinateNode *texco_node = (const TextureCoordinateNode*)other;
+
+	return inputs_equal(other) && from_dupli == texco_node->from_dupli;
+}
+
 /* Light Path */
 
 LightPathNode::LightPathNode()
@@ -2682,6 +2883,12 @@ void ValueNode::compile(OSLCompiler& compiler)
 	compiler.add(this, "node_value");
 }
 
+bool ValueNode::constant_fold(ShaderOutput *socket, float3 *optimized_value)
+{
+	*optimized_value = make_float3(value, 0.0f, 0.0f);
+	return true;
+}
+
 /* Color */
 
 ColorNode::ColorNode()
@@ -2710,6 +2917,12 @@ void ColorNode::compile(OSLCompiler& compiler)
 	compiler.add(this, "node_value");
 }
 
+bool ColorNode::constant_fold(ShaderOutput *socket, float3 *optimized_value)
+{
+	*optimized_value = value;
+	return true;
+}
+
 /* Add Closure */
 
 AddClosureNode::AddClosureNode()
@@ -2814,6 +3027,36 @@ void InvertNode::compile(OSLCompiler& compiler)
 	compiler.add(this, "node_invert");
 }
 
+bool InvertNode::constant_fold(ShaderOutput *socket, float3 *optimized_value)
+{
+	ShaderInput *fac_in = input("Fac");
+	ShaderInput *color_in = input("Color");
+
+	if(fac_in->link || color_in->link)
+		return false;
+
+	float fac = fac_in->value.x;
+	float3 color = color_in->value;
+
+	*optimized_value = fac*(make_float3(1.0f, 1.0f, 1.0f) - color) + (1.0f - fac)*color;
+	return true;
+}
+
+ShaderInput *InvertNode::bypass_input(ShaderOutput *socket)
+{
+	ShaderInput *fac_in = input("Fac");
+
+	if(!fac_in->link && fac_in->value.x == 0.0f)
+		return input("Color");
+
+	return NULL;
+}
+
+bool InvertNode::equals(const ShaderNode *other)
+{
+	return inputs_equal(other);
+}
+
 /* Mix */
 
 MixNode::MixNode()
@@ -2885,6 +3128,62 @@ void MixNode::compile(OSLCompiler& compiler)
 	compiler.add(this, "node_mix");
 }
 
+bool MixNode::constant_fold(ShaderOutput *socket, float3 *optimized_value)
+{
+	ShaderInput *fac_in = input("Fac");
+	ShaderInput *color1_in = input("Color1");
+	ShaderInput *color2_in = input("Color2");
+
+	if(fac_in->link || color1_in->link || color2_in->link)
+		return false;
+
+	float3 color = svm_mix((NodeMix)type_enum[type], fac_in->value.x, color1_in->value, color2_in->value);
+
+	if(use_clamp)
+		color = svm_mix_clamp(color);
+
+	*optimized_value = color;
+	return true;
+}
+
+ShaderInput *MixNode::bypass_input(ShaderOutput *socket)
+{
+	ShaderInput *fac_in = input("Fac");
+	ShaderInput *color1_in = input("Color1");
+	ShaderInput *color2_in = input("Color2");
+	NodeMix mix_type = (NodeMix)type_enum[type];
+
+	if(use_clamp)
+		return NULL;
+
+	/* mixing a color with itself */
+	if(mix_type == NODE_MIX_BLEND && color1_in->link && color1_in->link == color2_in->link)
+		return color1_in;
+
+	if(fac_in->link)
+		return NULL;
+
+	/* factor 0.0 leaves the first color as is for these types */
+	if(fac_in->value.x <= 0.0f) {
+		if(mix_type == NODE_MIX_BLEND || mix_type == NODE_MIX_ADD ||
+		   mix_type == NODE_MIX_MUL || mix_type == NODE_MIX_SUB)
+			return color1_in;
+	}
+	else if(fac_in->value.x >= 1.0f) {
+		if(mix_type == NODE_MIX_BLEND)
+			return color2_in;
+	}
+
+	return NULL;
+}
+
+bool MixNode::equals(const ShaderNode *other)
+{
+	const MixNode *mix_node = (const MixNode*)other;
+
+	return inputs_equal(other) && type == mix_node->type && use_clamp == mix_node->use_clamp;
+}
+
 /* Combine RGB */
 CombineRGBNode::CombineRGBNode()
 : ShaderNode("combine_rgb")
@@ -2919,6 +3218,24 @@ void CombineRGBNode::compile(OSLCompiler& compiler)
 	compiler.add(this, "node_combine_rgb");
 }
 
+bool CombineRGBNode::constant_fold(ShaderOutput *socket, float3 *optimized_value)
+{
+	ShaderInput *red_in = input("R");
+	ShaderInput *green_in = input("G");
+	ShaderInput *blue_in = input("B");
+
+	if(red_in->link || green_in->link || blue_in->link)
+		return false;
+
+	*optimized_value = make_float3(red_in->value.x, green_in->value.x, blue_in->value.x);
+	return true;
+}
+
+bool CombineRGBNode::equals(const ShaderNode *other)
+{
+	return inputs_equal(other);
+}
+
 /* Combine HSV */
 CombineHSVNode::CombineHSVNode()
 : ShaderNode("combine_hsv")
@@ -3043,6 +3360,30 @@ void SeparateRGBNode::compile(OSLCompiler& compiler)
 	compiler.add(this, "node_separate_rgb");
 }
 
+bool SeparateRGBNode::constant_fold(ShaderOutput *socket, float3 *optimized_value)
+{
+	ShaderInput *color_in = input("Image");
+
+	if(color_in->link)
+		return false;
+
+	float3 color = color_in->value;
+
+	if(socket == output("R"))
+		*optimized_value = make_float3(color.x, 0.0f, 0.0f);
+	else if(socket == output("G"))
+		*optimized_value = make_float3(color.y, 0.0f, 0.0f);
+	else
+		*optimized_value = make_float3(color.z, 0.0f, 0.0f);
+
+	return true;
+}
+
+bool SeparateRGBNode::equals(const ShaderNode *other)
+{
+	return inputs_equal(other);
+}
+
 /* Separate HSV */
 SeparateHSVNode::SeparateHSVNode()
 : ShaderNode("separate_hsv")
@@ -3184,6 +3525,13 @@ void AttributeNode::compile(OSLCompiler& compiler)
 	compiler.add(this, "node_attribute");
 }
 
+bool AttributeNode::equals(const ShaderNode *other)
+{
+	const AttributeNode *attr_node = (const AttributeNode*)other;
+
+	return inputs_equal(other) && attribute == attr_node->attribute;
+}
+
 /* Camera */
 
 CameraNode::CameraNode()
@@ -3460,6 +3808,68 @@ void MathNode::compile(OSLCompiler& compiler)
 	compiler.add(this, "node_math");
 }
 
+bool MathNode::constant_fold(ShaderOutput *socket, float3 *optimized_value)
+{
+	ShaderInput *value1_in = input("Value1");
+	ShaderInput *value2_in = input("Value2");
+	NodeMath math_type = (NodeMath)type_enum[type];
+
+	/* the second value is not used by unary operations */
+	bool unary = (math_type == NODE_MATH_SINE || math_type == NODE_MATH_COSINE ||
+	              math_type == NODE_MATH_TANGENT || math_type == NODE_MATH_ARCSINE ||
+	              math_type == NODE_MATH_ARCCOSINE || math_type == NODE_MATH_ARCTANGENT ||
+	              math_type == NODE_MATH_ROUND);
+
+	if(value1_in->link || (value2_in->link && !unary))
+		return false;
+
+	float value = svm_math(math_type, value1_in->value.x, value2_in->value.x);
+
+	if(use_clamp)
+		value = clamp(value, 0.0f, 1.0f);
+
+	*optimized_value = make_float3(value, 0.0f, 0.0f);
+	return true;
+}
+
+ShaderInput *MathNode::bypass_input(ShaderOutput *socket)
+{
+	ShaderInput *value1_in = input("Value1");
+	ShaderInput *value2_in = input("Value2");
+	NodeMath math_type = (NodeMath)type_enum[type];
+
+	if(use_clamp)
+		return NULL;
+
+	/* adding zero, or multiplying by one */
+	float identity;
+
+	if(math_type == NODE_MATH_ADD || math_type == NODE_MATH_SUBTRACT)
+		identity = 0.0f;
+	else if(math_type == NODE_MATH_MULTIPLY || math_type == NODE_MATH_DIVIDE)
+		identity = 1.0f;
+	else
+		return NULL;
+
+	if(!value2_in->link && value2_in->value.x == identity)
+		return value1_in;
+
+	/* commutative operations */
+	if(math_type == NODE_MATH_ADD || math_type == NODE_MATH_MULTIPLY) {
+		if(!value1_in->link && value1_in->value.x == identity)
+			return value2_in;
+	}
+
+	return NULL;
+}
+
+bool MathNode::equals(const ShaderNode *other)
+{
+	const MathNode *math_node = (const MathNode*)other;
+
+	return inputs_equal(other) && type == math_node->type && use_clamp == math_node->use_clamp;
+}
+
 /* VectorMath */
 
 VectorMathNode::VectorMathNode()
@@ -3511,6 +3921,34 @@ void VectorMathNode::compile(OSLCompiler& compiler)
 	compiler.add(this, "node_vector_math");
 }
 
+bool VectorMathNode::constant_fold(ShaderOutput *socket, float3 *optimized_value)
+{
+	ShaderInput *vector1_in = input("Vector1");
+	ShaderInput *vector2_in = input("Vector2");
+
+	if(vector1_in->link || vector2_in->link)
+		return false;
+
+	float value;
+	float3 vector;
+
+	svm_vector_math(&value, &vector, (NodeVectorMath)type_enum[type], vector1_in->value, vector2_in->value);
+
+	if(socket == output("Value"))
+		*optimized_value = make_float3(value, 0.0f, 0.0f);
+	else
+		*optimized_value = vector;
+
+	return true;
+}
+
+bool VectorMathNode::equals(const ShaderNode *other)
+{
+	const VectorMathNode *math_node = (const VectorMathNode*)other;
+
+	return inputs_equal(other) && type == math_node->type;
+}
+
 /* VectorTransform */
 
 VectorTransformNode::VectorTransformNode()
@@ -33,6 +33,7 @@ public:
 	TextureMapping();
 	Transform compute_transform();
 	bool skip();
+	bool equals(const TextureMapping& other);
 	void compile(SVMCompiler& compiler, int offset_in, int offset_out);
 	void compile(OSLCompiler &compiler);
 
@@ -67,6 +68,7 @@ public:
 	~ImageTextureNode();
 	ShaderNode *clone() const;
 	void attributes(Shader *shader, AttributeRequestSet *attributes);
+	bool equals(const ShaderNode *other);
 
 	ImageManager *image_manager;
 	int slot;
@@ -89,6 +91,7 @@ public:
 	~EnvironmentTextureNode();
 	ShaderNode *clone() const;
 	void attributes(Shader *shader, AttributeRequestSet *attributes);
+	bool equals(const ShaderNode *other);
 
 	ImageManager *image_manager;
 	int slot;
@@ -124,6 +127,7 @@ public:
 class GradientTextureNode : public TextureNode {
 public:
 	SHADER_NODE_CLASS(GradientTextureNode)
+	bool equals(const ShaderNode *other);
 
 	ustring type;
 	static ShaderEnum type_enum;
@@ -132,11 +136,13 @@ public:
 class NoiseTextureNode : public TextureNode {
 public:
 	SHADER_NODE_CLASS(NoiseTextureNode)
+	bool equals(const ShaderNode *other);
 };
 
 class VoronoiTextureNode : public TextureNode {
 public:
 	SHADER_NODE_CLASS(VoronoiTextureNode)
+	bool equals(const ShaderNode *other);
 
 	ustring coloring;
 
@@ -146,6 +152,7 @@ public:
 class MusgraveTextureNode : public TextureNode {
 public:
 	SHADER_NODE_CLASS(MusgraveTextureNode)
+	bool equals(const ShaderNode *other);
 
 	ustring type;
 
@@ -155,6 +162,7 @@ public:
 class WaveTextureNode : public TextureNode {
 public:
 	SHADER_NODE_CLASS(WaveTextureNode)
+	bool equals(const ShaderNode *other);
 
 	ustring type;
 	static ShaderEnum type_enum;
@@ -163,6 +171,7 @@ public:
 class MagicTextureNode : public TextureNode {
 public:
 	SHADER_NODE_CLASS(MagicTextureNode)
+	bool equals(const ShaderNode *other);
 
 	int depth;
 };
@@ -170,11 +179,13 @@ public:
 class CheckerTextureNode : public TextureNode {
 public:
 	SHADER_NODE_CLASS(CheckerTextureNode)
+	bool equals(const ShaderNode *other);
 };
 
 class BrickTextureNode : public TextureNode {
 public:
 	SHADER_NODE_CLASS(BrickTextureNode)
+	bool equals(const ShaderNode *other);
 	
 	float offset, squash;
 	int offset_frequency, squash_frequency;
@@ -183,6 +194,7 @@ public:
 class MappingNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(MappingNode)
+	bool equals(const ShaderNode *other);
 
 	TextureMapping tex_mapping;
 };
@@ -191,6 +203,8 @@ class ConvertNode : public ShaderNode {
 public:
 	ConvertNode(ShaderSocketType from, ShaderSocketType to, bool autoconvert = false);
 	SHADER_NODE_BASE_CLASS(ConvertNode)
+	bool equals(const ShaderNode *other);
+	bool constant_fold(ShaderOutput *socket, float3 *optimized_value);
 
 	ShaderSocketType from, to;
 };
@@ -339,12 +353,14 @@ class GeometryNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(GeometryNode)
 	void attributes(Shader *shader, AttributeRequestSet *attributes);
+	bool equals(const ShaderNode *other);
 };
 
 class TextureCoordinateNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(TextureCoordinateNode)
 	void attributes(Shader *shader, AttributeRequestSet *attributes);
+	bool equals(const ShaderNode *other);
 	
 	bool from_dupli;
 };
@@ -380,6 +396,7 @@ public:
 class ValueNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(ValueNode)
+	bool constant_fold(ShaderOutput *socket, float3 *optimized_value);
 
 	float value;
 };
@@ -387,6 +404,7 @@ public:
 class ColorNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(ColorNode)
+	bool constant_fold(ShaderOutput *socket, float3 *optimized_value);
 
 	float3 value;
 };
@@ -409,11 +427,17 @@ public:
 class InvertNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(InvertNode)
+	bool constant_fold(ShaderOutput *socket, float3 *optimized_value);
+	ShaderInput *bypass_input(ShaderOutput *socket);
+	bool equals(const ShaderNode *other);
 };
 
 class MixNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(MixNode)
+	bool constant_fold(ShaderOutput *socket, float3 *optimized_value);
+	ShaderInput *bypass_input(ShaderOutput *socket);
+	bool equals(const ShaderNode *other);
 
 	bool use_clamp;
 
@@ -424,6 +448,8 @@ public:
 class CombineRGBNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(CombineRGBNode)
+	bool constant_fold(ShaderOutput *socket, float3 *optimized_value);
+	bool equals(const ShaderNode *other);
 };
 
 class CombineHSVNode : public ShaderNode {
@@ -444,6 +470,8 @@ public:
 class SeparateRGBNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(SeparateRGBNode)
+	bool constant_fold(ShaderOutput *socket, float3 *optimized_value);
+	bool equals(const ShaderNode *other);
 };
 
 class SeparateHSVNode : public ShaderNode {
@@ -460,6 +488,7 @@ class AttributeNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(AttributeNode)
 	void attributes(Shader *shader, AttributeRequestSet *attributes);
+	bool equals(const ShaderNode *other);
 
 	ustring attribute;
 };
@@ -501,6 +530,9 @@ public:
 class MathNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(MathNode)
+	bool constant_fold(ShaderOutput *socket, float3 *optimized_value);
+	ShaderInput *bypass_input(ShaderOutput *socket);
+	bool equals(const ShaderNode *other);
 
 	bool use_clamp;
 
@@ -518,6 +550,8 @@ public:
 class VectorMathNode : public ShaderNode {
 public:
 	SHADER_NODE_CLASS(VectorMathNode)
+	bool constant_fold(ShaderOutput *socket, float3 *optimized_value);
+	bool equals(const ShaderNode *other);
 
 	ustring type;
 	static ShaderEnum type_enum;
@@ -14,6 +14,7 @@
  * limitations under the License
  */
 
+#include "bvh_motion.h"
 #include "device.h"
 #include "light.h"
 #include "mesh.h"
@@ -82,6 +83,24 @@ void Object::compute_bounds(bool motion_blur, float shuttertime)
 		bounds = mbounds.transformed(&tfm);
 }
 
+/* Bounds at evenly spaced steps over the shutter, expanded so that linear
+ * interpolation between two steps contains the object at any time between
+ * them. Used for the top level BVH nodes with motion blur. */
+void Object::compute_motion_bounds(float shuttertime, int num_steps, BoundBox *step_bounds)
+{
+	if(!use_motion) {
+		for(int step = 0; step < num_steps; step++)
+			step_bounds[step] = bounds;
+
+		return;
+	}
+
+	DecompMotionTransform decomp;
+	transform_motion_decompose(&decomp, &motion, &tfm);
+
+	bvh_motion_step_bounds(mesh->bounds, &decomp, shuttertime, num_steps, step_bounds);
+}
+
 void Object::apply_transform()
 {
 	if(!mesh || tfm == transform_identity())
@@ -60,6 +60,7 @@ public:
 	void tag_update(Scene *scene);
 
 	void compute_bounds(bool motion_blur, float shuttertime);
+	void compute_motion_bounds(float shuttertime, int num_steps, BoundBox *step_bounds);
 	void apply_transform();
 };
 
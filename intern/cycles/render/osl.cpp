@@ -97,6 +97,7 @@ void OSLShaderManager::device_update(Device *device, DeviceScene *dscene, Scene
 
 		OSLCompiler compiler((void*)this, (void*)ss, scene->image_manager);
 		compiler.background = (shader == scene->shaders[scene->default_background]);
+		compiler.optimize = scene->params.use_shader_optimization;
 		compiler.compile(og, shader);
 
 		if(shader->use_mis && shader->has_surface_emission)
@@ -381,6 +382,7 @@ OSLCompiler::OSLCompiler(void *manager_, void *shadingsys_, ImageManager *image_
 	current_type = SHADER_TYPE_SURFACE;
 	current_shader = NULL;
 	background = false;
+	optimize = true;
 }
 
 string OSLCompiler::id(ShaderNode *node)
@@ -785,9 +787,9 @@ void OSLCompiler::compile(OSLGlobals *og, Shader *shader)
 				shader->graph_bump = shader->graph->copy();
 
 		/* finalize */
-		shader->graph->finalize(false, true);
+		shader->graph->finalize(false, true, false, false, optimize);
 		if(shader->graph_bump)
-			shader->graph_bump->finalize(true, true);
+			shader->graph_bump->finalize(true, true, false, false, optimize);
 
 		current_shader = shader;
 
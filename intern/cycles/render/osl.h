@@ -139,6 +139,7 @@ public:
 	ShaderType output_type() { return current_type; }
 
 	bool background;
+	bool optimize;
 	ImageManager *image_manager;
 
 private:
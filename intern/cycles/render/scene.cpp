@@ -61,8 +61,13 @@ Scene::Scene(const SceneParams& params_, const DeviceInfo& device_info_)
 	else
 		shader_manager = ShaderManager::create(this, SceneParams::SVM);
 
-	if (device_info_.type == DEVICE_CPU)
+	if (device_info_.type == DEVICE_CPU) {
 		image_manager->set_extended_image_limits();
+
+		/* the texture cache only works on the CPU */
+		if(params.use_texture_cache)
+			image_manager->set_texture_cache(params.texture_cache_size);
+	}
 }
 
 Scene::~Scene()
@@ -141,6 +146,10 @@ void Scene::device_update(Device *device_, Progress& progress)
 	
 	image_manager->set_pack_images(device->info.pack_images);
 
+	/* volume majorants depend on the volume shaders and the images they use */
+	if(shader_manager->need_update || image_manager->need_update || integrator->need_update)
+		mesh_manager->need_update_volume = true;
+
 	progress.set_status("Updating Shaders");
 	shader_manager->device_update(device, &dscene, this, progress);
 
@@ -186,6 +195,11 @@ void Scene::device_update(Device *device_, Progress& progress)
 
 	if(progress.get_cancel()) return;
 
+	progress.set_status("Updating Volumes");
+	mesh_manager->device_update_volume(device, &dscene, this, progress);
+
+	if(progress.get_cancel()) return;
+
 	progress.set_status("Updating Lights");
 	light_manager->device_update(device, &dscene, this, progress);
 
@@ -266,7 +280,10 @@ void Scene::reset()
 
 void Scene::device_free()
 {
-	free_memory(false);
+	/* with persistent data the scene is kept for rendering the next frame,
+	 * it is freed along with the session */
+	if(!params.persistent_data)
+		free_memory(false);
 }
 
 CCL_NAMESPACE_END
@@ -58,6 +58,7 @@ class DeviceScene {
 public:
 	/* BVH */
 	device_vector<float4> bvh_nodes;
+	device_vector<float4> bvh_motion_nodes;
 	device_vector<uint> object_node;
 	device_vector<float4> tri_woop;
 	device_vector<uint> prim_segment;
@@ -88,10 +89,16 @@ public:
 	device_vector<float4> light_data;
 	device_vector<float2> light_background_marginal_cdf;
 	device_vector<float2> light_background_conditional_cdf;
+	device_vector<float4> light_tree_nodes;
+	device_vector<uint> light_tree_objects;
 
 	/* particles */
 	device_vector<float4> particles;
 
+	/* volume majorants */
+	device_vector<float4> volume_grid;
+	device_vector<float> volume_majorants;
+
 	/* shaders */
 	device_vector<uint4> svm_nodes;
 	device_vector<uint> shader_flag;
@@ -124,6 +131,9 @@ public:
 	bool use_bvh_spatial_split;
 	bool use_qbvh;
 	bool persistent_data;
+	bool use_texture_cache;
+	int texture_cache_size;
+	bool use_shader_optimization;
 
 	SceneParams()
 	{
@@ -137,6 +147,9 @@ public:
 		use_qbvh = false;
 #endif
 		persistent_data = false;
+		use_texture_cache = false;
+		texture_cache_size = 4096;
+		use_shader_optimization = true;
 	}
 
 	bool modified(const SceneParams& params)
@@ -145,7 +158,10 @@ public:
 		&& use_bvh_cache == params.use_bvh_cache
 		&& use_bvh_spatial_split == params.use_bvh_spatial_split
 		&& use_qbvh == params.use_qbvh
-		&& persistent_data == params.persistent_data); }
+		&& persistent_data == params.persistent_data
+		&& use_texture_cache == params.use_texture_cache
+		&& texture_cache_size == params.texture_cache_size
+		&& use_shader_optimization == params.use_shader_optimization); }
 };
 
 /* Scene */
@@ -23,6 +23,7 @@
 #include "integrator.h"
 #include "scene.h"
 #include "session.h"
+#include "svm.h"
 
 #include "util_foreach.h"
 #include "util_function.h"
@@ -67,6 +68,7 @@ Session::Session(const SessionParams& params_)
 	preview_time = 0.0;
 	paused_time = 0.0;
 	last_update_time = 0.0;
+	scene_update_time = 0.0;
 
 	delayed_reset.do_reset = false;
 	delayed_reset.samples = 0;
@@ -115,6 +117,7 @@ Session::~Session()
 
 void Session::start()
 {
+	scene_update_time = 0.0;
 	session_thread = new thread(function_bind(&Session::run, this));
 }
 
@@ -362,6 +365,8 @@ bool Session::acquire_tile(Device *tile_device, RenderTile& rtile)
 	rtile.start_sample = tile_manager.state.sample;
 	rtile.num_samples = tile_manager.state.num_samples;
 	rtile.resolution = tile_manager.state.resolution_divider;
+	rtile.index = tile.index;
+	rtile.converged = false;
 
 	tile_lock.unlock();
 
@@ -445,6 +450,9 @@ void Session::release_tile(RenderTile& rtile)
 {
 	thread_scoped_lock tile_lock(tile_mutex);
 
+	if(rtile.converged)
+		tile_manager.tile_converged(rtile.index);
+
 	if(write_render_tile_cb) {
 		if(params.progressive_refine == false) {
 			/* todo: optimize this by making it thread safe and removing lock */
@@ -644,6 +652,11 @@ void Session::reset_(BufferParams& buffer_params, int samples)
 
 	tile_manager.reset(buffer_params, samples);
 
+	{
+		thread_scoped_lock stats_lock(stats.kernel_mutex);
+		stats.kernel.reset();
+	}
+
 	start_time = time_dt();
 	preview_time = 0.0;
 	paused_time = 0.0;
@@ -741,7 +754,10 @@ void Session::update_scene()
 	/* update scene */
 	if(scene->need_update()) {
 		progress.set_status("Updating Scene");
+
+		double update_start_time = time_dt();
 		scene->device_update(device, progress);
+		scene_update_time += time_dt() - update_start_time;
 	}
 }
 
@@ -818,6 +834,70 @@ void Session::update_progress_sample()
 	progress.increment_sample();
 }
 
+string Session::kernel_stats_summary()
+{
+	thread_scoped_lock stats_lock(stats.kernel_mutex);
+	KernelStats& ks = stats.kernel;
+
+	if(ks.num_rays() == 0)
+		return "";
+
+	return string_printf("Rays %.2fM, BVH Nodes/Ray %.1f",
+		ks.num_rays()*1e-6, (double)ks.bvh_nodes/(double)ks.num_rays());
+}
+
+string Session::kernel_stats_report()
+{
+	thread_scoped_lock stats_lock(stats.kernel_mutex);
+	KernelStats& ks = stats.kernel;
+
+	static const char *ray_names[STATS_NUM_RAY_TYPES] = {
+		"Camera", "Indirect", "Shadow", "Subsurface"};
+	static const char *stage_names[STATS_NUM_STAGES] = {
+		"Integrator", "Intersect", "Shading", "Volume", "Light"};
+
+	uint64_t num_rays = ks.num_rays();
+	string report = "Kernel Statistics:\n";
+
+	report += string_printf("  Rays: %llu\n", (unsigned long long)num_rays);
+	for(int i = 0; i < STATS_NUM_RAY_TYPES; i++)
+		report += string_printf("    %-12s %llu\n", ray_names[i], (unsigned long long)ks.rays[i]);
+
+	double rays_inv = (num_rays)? 1.0/(double)num_rays: 0.0;
+
+	report += string_printf("  BVH Nodes: %llu (%.1f per ray)\n",
+		(unsigned long long)ks.bvh_nodes, ks.bvh_nodes*rays_inv);
+	report += string_printf("  BVH Primitives: %llu (%.1f per ray)\n",
+		(unsigned long long)ks.bvh_primitives, ks.bvh_primitives*rays_inv);
+	report += string_printf("  Shader Evaluations: %llu\n", (unsigned long long)ks.shader_evals);
+
+	report += "  SVM Nodes:\n";
+	for(int i = 0; i < STATS_MAX_SVM_NODES; i++)
+		if(ks.svm_nodes[i])
+			report += string_printf("    %-26s %llu\n", svm_node_type_name(i), (unsigned long long)ks.svm_nodes[i]);
+
+	double total_time = 0.0;
+	for(int i = 0; i < STATS_NUM_STAGES; i++)
+		total_time += ks.stage_time[i];
+
+	report += "  Stage Time (summed over threads):\n";
+	for(int i = 0; i < STATS_NUM_STAGES; i++)
+		report += string_printf("    %-12s %.2fs (%.1f%%)\n", stage_names[i], ks.stage_time[i],
+			(total_time > 0.0)? 100.0*ks.stage_time[i]/total_time: 0.0);
+
+	/* each camera ray is one pixel sample, this is the number to compare
+	 * with and without shader optimization */
+	uint64_t num_samples = ks.rays[STATS_RAY_CAMERA];
+	double shading_time = ks.stage_time[STATS_STAGE_SHADING];
+
+	if(num_samples && ks.shader_evals) {
+		report += string_printf("  Shading Time: %.3fus per sample, %.3fus per evaluation\n",
+			shading_time*1e6/(double)num_samples, shading_time*1e6/(double)ks.shader_evals);
+	}
+
+	return report;
+}
+
 void Session::path_trace()
 {
 	/* add path trace task */
@@ -121,6 +121,9 @@ public:
 	TileManager tile_manager;
 	Stats stats;
 
+	/* time spent on scene updates since start(), for reporting */
+	double scene_update_time;
+
 	boost::function<void(RenderTile&)> write_render_tile_cb;
 	boost::function<void(RenderTile&)> update_render_tile_cb;
 
@@ -137,6 +140,10 @@ public:
 	void set_pause(bool pause);
 
 	void device_free();
+
+	/* kernel statistics, only collected with WITH_CYCLES_DEBUG */
+	string kernel_stats_summary();
+	string kernel_stats_report();
 protected:
 	struct DelayedReset {
 		thread_mutex mutex;
@@ -136,6 +136,7 @@ ShaderManager::ShaderManager()
 {
 	need_update = true;
 	blackbody_table_offset = TABLE_OFFSET_INVALID;
+	svm_program_size = 0;
 }
 
 ShaderManager::~ShaderManager()
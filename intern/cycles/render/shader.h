@@ -135,6 +135,9 @@ public:
 	 * have any shader assigned explicitly */
 	static void add_default(Scene *scene);
 
+	/* number of SVM nodes in the compiled program, for statistics */
+	size_t svm_program_size;
+
 protected:
 	ShaderManager();
 
@@ -78,9 +78,12 @@ void SVMShaderManager::device_update(Device *device, DeviceScene *dscene, Scene
 		SVMCompiler compiler(scene->shader_manager, scene->image_manager,
 			use_multi_closure);
 		compiler.background = ((int)i == scene->default_background);
+		compiler.optimize = scene->params.use_shader_optimization;
 		compiler.compile(shader, svm_nodes, i);
 	}
 
+	svm_program_size = svm_nodes.size();
+
 	dscene->svm_nodes.copy((uint4*)&svm_nodes[0], svm_nodes.size());
 	device->tex_alloc("__svm_nodes", dscene->svm_nodes);
 
@@ -113,6 +116,7 @@ SVMCompiler::SVMCompiler(ShaderManager *shader_manager_, ImageManager *image_man
 	current_shader = NULL;
 	current_graph = NULL;
 	background = false;
+	optimize = true;
 	mix_weight_offset = SVM_STACK_INVALID;
 	use_multi_closure = use_multi_closure_;
 	compile_failed = false;
@@ -676,9 +680,11 @@ void SVMCompiler::compile(Shader *shader, vector<int4>& global_svm_nodes, int in
 			shader->graph_bump = shader->graph->copy();
 
 	/* finalize */
-	shader->graph->finalize(false, false, use_multi_closure);
+	bool use_texture_cache = image_manager->use_texture_cache();
+
+	shader->graph->finalize(false, false, use_multi_closure, use_texture_cache, optimize);
 	if(shader->graph_bump)
-		shader->graph_bump->finalize(true, false, use_multi_closure);
+		shader->graph_bump->finalize(true, false, use_multi_closure, use_texture_cache, optimize);
 
 	current_shader = shader;
 
@@ -716,5 +722,34 @@ void SVMCompiler::compile(Shader *shader, vector<int4>& global_svm_nodes, int in
 	global_svm_nodes.insert(global_svm_nodes.end(), svm_nodes.begin(), svm_nodes.end());
 }
 
+/* Node Names
+ *
+ * For kernel statistics, in the same order as NodeType in svm_types.h. */
+
+const char *svm_node_type_name(int type)
+{
+	static const char *names[] = {
+		"end", "closure_bsdf", "closure_emission", "closure_background", "closure_set_weight",
+		"closure_weight", "mix_closure", "jump", "tex_image", "tex_image_box", "tex_sky",
+		"geometry", "geometry_dupli", "light_path", "value_f", "value_v", "mix", "attr",
+		"convert", "fresnel", "wireframe", "wavelength", "blackbody", "emission_weight",
+		"tex_gradient", "tex_voronoi", "tex_musgrave", "tex_wave", "tex_magic", "tex_noise",
+		"shader_jump", "set_displacement", "geometry_bump_dx", "geometry_bump_dy", "set_bump",
+		"math", "vector_math", "vector_transform", "mapping", "tex_coord", "tex_coord_bump_dx",
+		"tex_coord_bump_dy", "add_closure", "emission_set_weight_total", "attr_bump_dx",
+		"attr_bump_dy", "tex_environment", "closure_holdout", "layer_weight", "closure_volume",
+		"separate_rgb", "combine_rgb", "separate_hsv", "combine_hsv", "hsv", "camera",
+		"invert", "normal", "gamma", "tex_checker", "brightcontrast", "rgb_ramp", "rgb_curves",
+		"vector_curves", "min_max", "light_falloff", "object_info", "particle_info",
+		"tex_brick", "closure_set_normal", "closure_ambient_occlusion", "tangent",
+		"normal_map", "hair_info"};
+	int num_names = sizeof(names)/sizeof(*names);
+
+	if(type < 0 || type >= num_names)
+		return "unknown";
+
+	return names[type];
+}
+
 CCL_NAMESPACE_END
 
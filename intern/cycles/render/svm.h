@@ -48,6 +48,10 @@ public:
 	void device_free(Device *device, DeviceScene *dscene, Scene *scene);
 };
 
+/* Name of an SVM node type, for statistics */
+
+const char *svm_node_type_name(int type);
+
 /* Graph Compiler */
 
 class SVMCompiler {
@@ -77,6 +81,7 @@ public:
 	ImageManager *image_manager;
 	ShaderManager *shader_manager;
 	bool background;
+	bool optimize;
 
 protected:
 	/* stack */
@@ -65,6 +65,7 @@ void TileManager::reset(BufferParams& params_, int num_samples_)
 	state.num_samples = 0;
 	state.resolution_divider = divider;
 	state.tiles.clear();
+	state.tiles_converged.clear();
 }
 
 void TileManager::set_samples(int num_samples_)
@@ -155,6 +156,11 @@ void TileManager::set_tiles()
 
 	state.num_tiles = state.tiles.size();
 
+	/* convergence is only tracked at full resolution, where tiles stay the
+	 * same from one pass to the next */
+	if(resolution != 1 || state.tiles_converged.size() != (size_t)state.num_tiles)
+		state.tiles_converged.assign(state.num_tiles, false);
+
 	state.buffer.width = image_w;
 	state.buffer.height = image_h;
 
@@ -234,20 +240,32 @@ bool TileManager::next_tile(Tile& tile, int device)
 {
 	list<Tile>::iterator tile_it;
 	
-	if (background)
-		tile_it = next_background_tile(device, tile_order);
-	else
-		tile_it = next_viewport_tile(device);
+	while(true) {
+		if (background)
+			tile_it = next_background_tile(device, tile_order);
+		else
+			tile_it = next_viewport_tile(device);
+
+		if(tile_it == state.tiles.end())
+			return false;
 
-	if(tile_it != state.tiles.end()) {
 		tile_it->rendering = true;
-		tile = *tile_it;
 		state.num_rendered_tiles++;
 
-		return true;
+		/* converged tiles need no more samples, count them as rendered */
+		if(!state.tiles_converged[tile_it->index])
+			break;
 	}
 
-	return false;
+	tile = *tile_it;
+
+	return true;
+}
+
+void TileManager::tile_converged(int index)
+{
+	if(state.resolution_divider == 1 && index < (int)state.tiles_converged.size())
+		state.tiles_converged[index] = true;
 }
 
 bool TileManager::done()
@@ -21,6 +21,7 @@
 
 #include "buffers.h"
 #include "util_list.h"
+#include "util_vector.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -65,6 +66,9 @@ public:
 		int num_tiles;
 		int num_rendered_tiles;
 		list<Tile> tiles;
+		/* tiles in which adaptive sampling found all pixels converged, these
+		 * are skipped in following passes so threads go to noisy tiles */
+		vector<bool> tiles_converged;
 	} state;
 
 	int num_samples;
@@ -77,6 +81,7 @@ public:
 	void set_samples(int num_samples);
 	bool next();
 	bool next_tile(Tile& tile, int device = 0);
+	void tile_converged(int index);
 	bool done();
 	
 	void set_tile_order(TileOrder tile_order_) { tile_order = tile_order_; }
@@ -0,0 +1,307 @@
+/*
+ * Copyright 2011-2014 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+/* Compare picking one of many point lamps with the flat light distribution
+ * and with the light tree, for the direct light of a diffuse plane.
+ *
+ * The distribution and lamps are filled like in light.cpp, the tree is built
+ * with the LightTree class and lights are sampled with the kernel's
+ * light_sample. Reports the relative variance of the one sample irradiance
+ * estimate, time per sample and their product, which is the time needed for
+ * the same noise level.
+ *
+ * Also verifies both are unbiased, leaf pdfs sum to one and the pdf used for
+ * MIS (light_tree_leaf_pdf) matches the pdf lights were sampled with.
+ */
+
+/* To compile run (from this directory):
+ * g++ -O2 -msse4.1 -I<OpenImageIO include> -I../../kernel -I../../kernel/svm -I../../kernel/osl -I../../util \
+ *     -I../../render "-DCCL_NAMESPACE_BEGIN=namespace ccl {" "-DCCL_NAMESPACE_END=}" \
+ *     lightbench.cpp ../../render/light_tree.cpp ../../util/util_time.cpp -lpthread -o lightbench
+ *
+ * Usage: lightbench [num_lamps] [num_clusters]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "kernel_compat_cpu.h"
+#include "kernel_math.h"
+#include "kernel_types.h"
+#include "kernel_globals.h"
+#include "kernel_film.h"
+#include "kernel_path.h"
+
+#include "light_tree.h"
+
+#include "util_time.h"
+
+using namespace ccl;
+
+#define SCENE_SIZE 100.0f
+#define NUM_POINTS 200
+#define NUM_SAMPLES 20000
+
+static int num_lamps = 1024;
+static int num_clusters = 0;
+
+static float frand()
+{
+	return rand()/(float)RAND_MAX;
+}
+
+/* Lights, as in LightManager::device_update_distribution and device_update_points */
+
+struct LightScene {
+	vector<float3> lamps;
+	vector<float4> distribution;
+	vector<float4> light_data;
+	vector<float4> nodes;
+	vector<int> leaf;
+};
+
+/* lamps above the plane, uniform or in clusters like street lights or
+ * windows of buildings */
+static void lamps_create(LightScene& scene)
+{
+	vector<float3> centers;
+
+	srand(1);
+
+	for(int i = 0; i < num_clusters; i++)
+		centers.push_back(make_float3(frand(), frand(), 0.0f)*SCENE_SIZE);
+
+	for(int i = 0; i < num_lamps; i++) {
+		float3 co = make_float3(frand()*SCENE_SIZE, frand()*SCENE_SIZE, 0.5f + frand());
+
+		if(num_clusters > 0) {
+			float3 offset = make_float3(frand() - 0.5f, frand() - 0.5f, 0.0f)*(0.05f*SCENE_SIZE);
+			co = centers[i % num_clusters] + offset + make_float3(0.0f, 0.0f, co.z);
+		}
+
+		scene.lamps.push_back(co);
+	}
+}
+
+static void scene_build(LightScene& scene, KernelGlobals& kg, bool use_light_tree)
+{
+	int num = scene.lamps.size();
+	LightTree light_tree;
+	float totarea = 0.0f;
+	float lightarea = 1.0f;
+
+	scene.distribution.resize(num + 1);
+	scene.light_data.resize(num*LIGHT_SIZE);
+
+	for(int i = 0; i < num; i++) {
+		float3 co = scene.lamps[i];
+
+		scene.distribution[i] = make_float4(totarea, __int_as_float(~i), 1.0f, 0.0f);
+		totarea += lightarea;
+
+		light_tree.add_emitter(BoundBox(co), lightarea, 0.0f, i, 1, -1);
+
+		scene.light_data[i*LIGHT_SIZE + 0] = make_float4(__int_as_float(LIGHT_POINT), co.x, co.y, co.z);
+		scene.light_data[i*LIGHT_SIZE + 1] = make_float4(__int_as_float(0), 0.0f, 1.0f, 0.0f);
+		scene.light_data[i*LIGHT_SIZE + 2] = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+		scene.light_data[i*LIGHT_SIZE + 3] = make_float4(__int_as_float(1), 0.0f, 0.0f, 0.0f);
+	}
+
+	for(int i = 0; i < num; i++)
+		scene.distribution[i].x /= totarea;
+	scene.distribution[num] = make_float4(1.0f, 0.0f, 0.0f, 0.0f);
+
+	vector<uint> objects;
+	light_tree.build(scene.nodes, objects);
+
+	/* leaf node of each lamp */
+	scene.leaf.resize(num);
+	for(int n = 0; n < (int)scene.nodes.size()/LIGHT_TREE_NODE_SIZE; n++) {
+		int x = __float_as_int(scene.nodes[n*LIGHT_TREE_NODE_SIZE + 2].x);
+
+		if(x < 0)
+			scene.leaf[~x] = n;
+	}
+
+	memset(&kg.__data, 0, sizeof(kg.__data));
+	kg.__light_distribution.data = &scene.distribution[0];
+	kg.__light_distribution.width = scene.distribution.size();
+	kg.__light_data.data = &scene.light_data[0];
+	kg.__light_data.width = scene.light_data.size();
+	kg.__light_tree_nodes.data = &scene.nodes[0];
+	kg.__light_tree_nodes.width = scene.nodes.size();
+
+	KernelIntegrator *kintegrator = &kg.__data.integrator;
+	kintegrator->use_direct_light = 1;
+	kintegrator->num_distribution = num;
+	kintegrator->num_all_lights = num;
+	kintegrator->pdf_lights = 1.0f/num;
+	kintegrator->inv_pdf_lights = (float)num;
+	kintegrator->use_light_tree = use_light_tree;
+	kintegrator->light_tree_num_distant = 0;
+	kintegrator->light_tree_pdf = 1.0f;
+}
+
+/* Irradiance Estimators */
+
+static double irradiance_reference(LightScene& scene, float3 P)
+{
+	double E = 0.0;
+
+	for(size_t i = 0; i < scene.lamps.size(); i++) {
+		float3 D = scene.lamps[i] - P;
+		float t = len(D);
+
+		E += (0.25f*M_1_PI_F)*(D.z/t)/(t*t);
+	}
+
+	return E;
+}
+
+/* one light sample, weighted like direct_emission does */
+static float irradiance_sample(KernelGlobals *kg, float3 P, uint *rng, int *r_lamp, float *r_pick_pdf)
+{
+	LightSample ls;
+	float randt = lcg_step_float(rng);
+
+	light_sample(kg, randt, 0.5f, 0.5f, 0.0f, P, &ls);
+
+	*r_lamp = ls.lamp;
+	*r_pick_pdf = (0.25f*M_1_PI_F)/ls.eval_fac;
+
+	if(ls.pdf == 0.0f)
+		return 0.0f;
+
+	return ls.eval_fac*max(ls.D.z, 0.0f)/ls.pdf;
+}
+
+static bool bench_distribution(KernelGlobals *kg, LightScene& scene, vector<float3>& points,
+	vector<double>& reference, bool use_light_tree, double *r_rel_variance, double *r_cost)
+{
+	double sum_rel_variance = 0.0, max_rel_error = 0.0, max_pdf_error = 0.0, max_pdf_sum_error = 0.0;
+	bool unbiased = true;
+	uint rng = lcg_init(1);
+	double time = 0.0;
+
+	for(size_t p = 0; p < points.size(); p++) {
+		double sum = 0.0, sum_sq = 0.0;
+		int lamp;
+		float pick_pdf;
+
+		double t = time_dt();
+
+		for(int s = 0; s < NUM_SAMPLES; s++) {
+			double f = irradiance_sample(kg, points[p], &rng, &lamp, &pick_pdf);
+			sum += f;
+			sum_sq += f*f;
+		}
+
+		time += time_dt() - t;
+
+		double E = reference[p];
+		double mean = sum/NUM_SAMPLES;
+		double variance = sum_sq/NUM_SAMPLES - mean*mean;
+
+		sum_rel_variance += variance/(E*E);
+		max_rel_error = max(max_rel_error, fabs(mean - E)/E);
+
+		if(fabs(mean - E) > 5.0*sqrt(variance/NUM_SAMPLES) + 1e-5*E)
+			unbiased = false;
+
+		if(use_light_tree) {
+			/* pdf for MIS of the last sample, and of all leaves */
+			double leaf_pdf = light_tree_leaf_pdf(kg, scene.leaf[lamp], points[p]);
+			double pdf_sum = 0.0;
+
+			max_pdf_error = max(max_pdf_error, fabs(leaf_pdf - pick_pdf)/pick_pdf);
+
+			for(size_t i = 0; i < scene.leaf.size(); i++)
+				pdf_sum += light_tree_leaf_pdf(kg, scene.leaf[i], points[p]);
+
+			max_pdf_sum_error = max(max_pdf_sum_error, fabs(pdf_sum - 1.0));
+		}
+	}
+
+	int num = points.size()*NUM_SAMPLES;
+	double rel_variance = sum_rel_variance/points.size();
+	double us_per_sample = time/num*1e6;
+
+	printf("  %-10s relative variance %8.3f, max relative error of mean %.4f, %.3f us per sample, variance x time %8.3f\n",
+		(use_light_tree)? "light tree": "flat", rel_variance, max_rel_error, us_per_sample,
+		rel_variance*us_per_sample);
+
+	*r_rel_variance = rel_variance;
+	*r_cost = rel_variance*us_per_sample;
+
+	if(!unbiased) {
+		fprintf(stderr, "|--* %s estimate is biased\n", (use_light_tree)? "Light tree": "Flat");
+		return false;
+	}
+
+	if(use_light_tree) {
+		printf("  %-10s max leaf pdf sum error %g, max MIS pdf error %g\n", "", max_pdf_sum_error, max_pdf_error);
+
+		if(max_pdf_sum_error > 1e-4 || max_pdf_error > 1e-4) {
+			fprintf(stderr, "|--* Light tree pdfs are inconsistent\n");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, const char **argv)
+{
+	if(argc > 1)
+		num_lamps = atoi(argv[1]);
+	if(argc > 2)
+		num_clusters = atoi(argv[2]);
+
+	LightScene scene;
+	lamps_create(scene);
+
+	/* shading points on the plane below the lamps */
+	vector<float3> points(NUM_POINTS);
+	vector<double> reference(NUM_POINTS);
+
+	srand(2);
+	for(int i = 0; i < NUM_POINTS; i++) {
+		points[i] = make_float3(frand()*SCENE_SIZE, frand()*SCENE_SIZE, 0.0f);
+		reference[i] = irradiance_reference(scene, points[i]);
+	}
+
+	printf("%d point lamps, %d clusters, %d shading points, %d samples:\n",
+		num_lamps, num_clusters, NUM_POINTS, NUM_SAMPLES);
+
+	int error_status = 0;
+	double rel_variance[2], cost[2];
+
+	for(int use_light_tree = 0; use_light_tree < 2; use_light_tree++) {
+		KernelGlobals kg;
+		scene_build(scene, kg, use_light_tree != 0);
+
+		if(!bench_distribution(&kg, scene, points, reference, use_light_tree != 0,
+		                       &rel_variance[use_light_tree], &cost[use_light_tree]))
+			error_status = 1;
+	}
+
+	printf("  light tree: %.2fx lower variance, %.2fx less time for equal noise\n",
+		rel_variance[0]/rel_variance[1], cost[0]/cost[1]);
+
+	return error_status;
+}
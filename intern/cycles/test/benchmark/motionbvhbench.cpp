@@ -0,0 +1,519 @@
+/*
+ * Copyright 2011-2014 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+/* Compare traversal of a top level BVH over fast moving objects with bounds
+ * over the whole shutter, and with bounds per motion step interpolated at
+ * the ray time.
+ *
+ * The scene has many instances of a mesh, each with random translation and
+ * rotation over the shutter. Object bounds per step and the motion nodes are
+ * computed with bvh_motion.h, the same code as Object::compute_motion_bounds
+ * and RegularBVH::pack_motion_nodes use.
+ *
+ * Also verifies both find the same hits, and that the interpolated bounds
+ * contain the objects at densely sampled times.
+ *
+ * Build with -DWITH_CYCLES_DEBUG to also count BVH nodes visited per ray,
+ * timings are then less reliable.
+ */
+
+/* To compile run (from this directory):
+ * g++ -O2 -msse4.1 -I<OpenImageIO include> -I../../kernel -I../../kernel/svm -I../../kernel/osl -I../../util \
+ *     -I../../bvh "-DCCL_NAMESPACE_BEGIN=namespace ccl {" "-DCCL_NAMESPACE_END=}" \
+ *     motionbvhbench.cpp ../../util/util_time.cpp ../../util/util_transform.cpp -lpthread -o motionbvhbench
+ *
+ * Usage: motionbvhbench [motion_scale]
+ */
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "kernel_compat_cpu.h"
+#include "kernel_math.h"
+#include "kernel_types.h"
+#include "kernel_globals.h"
+#include "kernel_film.h"
+#include "kernel_path.h"
+
+#include "bvh_motion.h"
+
+#include "util_boundbox.h"
+#include "util_time.h"
+#include "util_transform.h"
+
+using namespace ccl;
+
+#define NUM_OBJECTS 1000
+#define NUM_RAYS (256*1024)
+#define NUM_RUNS 5
+#define SHUTTER_TIME 1.0f
+
+static float motion_scale = 1.0f;
+
+static float frand()
+{
+	return rand()/(float)RAND_MAX;
+}
+
+/* Generic BVH, median split on centroids, leaves with one to four items */
+
+struct BuildNode {
+	BoundBox bounds;
+	int child[2];
+	int lo, hi;
+	bool leaf;
+};
+
+struct BuildItem {
+	BoundBox bounds;
+	int index;
+};
+
+struct CentroidLess {
+	int axis;
+
+	bool operator()(const BuildItem& a, const BuildItem& b) const
+	{
+		float3 ca = a.bounds.center2(), cb = b.bounds.center2();
+		return (axis == 0)? ca.x < cb.x: (axis == 1)? ca.y < cb.y: ca.z < cb.z;
+	}
+};
+
+static int bvh_build(vector<BuildNode>& nodes, vector<BuildItem>& items, int lo, int hi, int max_leaf_size)
+{
+	int index = nodes.size();
+	nodes.push_back(BuildNode());
+
+	BoundBox bounds = BoundBox::empty;
+	for(int i = lo; i < hi; i++)
+		bounds.grow(items[i].bounds);
+	nodes[index].bounds = bounds;
+
+	if(hi - lo <= max_leaf_size) {
+		nodes[index].leaf = true;
+		nodes[index].lo = lo;
+		nodes[index].hi = hi;
+		return index;
+	}
+
+	float3 size = bounds.size();
+	CentroidLess less;
+	less.axis = (size.x > size.y && size.x > size.z)? 0: (size.y > size.z)? 1: 2;
+
+	int mid = (lo + hi)/2;
+	std::nth_element(items.begin() + lo, items.begin() + mid, items.begin() + hi, less);
+
+	nodes[index].leaf = false;
+	int c0 = bvh_build(nodes, items, lo, mid, max_leaf_size);
+	int c1 = bvh_build(nodes, items, mid, hi, max_leaf_size);
+	nodes[index].child[0] = c0;
+	nodes[index].child[1] = c1;
+
+	return index;
+}
+
+/* Scene */
+
+struct BenchObject {
+	Transform tfm;
+	MotionTransform motion;
+	DecompMotionTransform decomp;
+	BoundBox bounds;
+	BoundBox step_bounds[BVH_MOTION_STEPS];
+};
+
+struct BenchScene {
+	vector<float3> verts;
+	BoundBox mesh_bounds;
+	vector<BenchObject> objects;
+
+	vector<float4> bvh_nodes;
+	vector<float4> bvh_motion_nodes;
+	vector<float4> tri_woop;
+	vector<uint> prim_visibility;
+	vector<uint> prim_object;
+	vector<float4> kobjects;
+	vector<uint> object_flag;
+	vector<uint> object_node;
+	int num_top_nodes;
+};
+
+/* low resolution sphere */
+static void mesh_create(BenchScene& scene)
+{
+	const int res = 16;
+
+	for(int j = 0; j < res; j++) {
+		for(int i = 0; i < res*2; i++) {
+			float3 p[4];
+
+			for(int k = 0; k < 4; k++) {
+				float u = (i + (k & 1))*M_PI_F/res;
+				float v = (j + (k >> 1))*M_PI_F/res;
+				p[k] = make_float3(sinf(v)*cosf(u), sinf(v)*sinf(u), cosf(v));
+			}
+
+			scene.verts.push_back(p[0]); scene.verts.push_back(p[1]); scene.verts.push_back(p[2]);
+			scene.verts.push_back(p[1]); scene.verts.push_back(p[3]); scene.verts.push_back(p[2]);
+		}
+	}
+
+	scene.mesh_bounds = BoundBox::empty;
+	for(size_t i = 0; i < scene.verts.size(); i++)
+		scene.mesh_bounds.grow(scene.verts[i]);
+}
+
+static void object_transform_at(const BenchObject& ob, float time, Transform *tfm)
+{
+	transform_motion_interpolate(tfm, &ob.decomp, time);
+}
+
+/* as Object::compute_bounds */
+static void object_compute_bounds(BenchObject& ob, BoundBox mbounds)
+{
+	float start_t = 0.5f - SHUTTER_TIME*0.25f;
+	float end_t = 0.5f + SHUTTER_TIME*0.25f;
+
+	ob.bounds = BoundBox::empty;
+
+	for(float t = start_t; t < end_t; t += (1.0f/128.0f)*SHUTTER_TIME) {
+		Transform ttfm;
+
+		object_transform_at(ob, t, &ttfm);
+		ob.bounds.grow(mbounds.transformed(&ttfm));
+	}
+}
+
+static void objects_create(BenchScene& scene)
+{
+	srand(1);
+
+	for(int i = 0; i < NUM_OBJECTS; i++) {
+		BenchObject ob;
+		float3 axis0 = normalize(make_float3(frand() - 0.5f, frand() - 0.5f, frand() - 0.5f) + make_float3(1e-3f, 0.0f, 0.0f));
+		float3 axis1 = normalize(make_float3(frand() - 0.5f, frand() - 0.5f, frand() - 0.5f) + make_float3(1e-3f, 0.0f, 0.0f));
+		float3 move = motion_scale*make_float3(frand() - 0.5f, frand() - 0.5f, frand() - 0.5f)*8.0f;
+
+		ob.tfm = transform_translate(make_float3(frand(), frand(), frand())*40.0f) *
+		         transform_rotate(frand()*M_2PI_F, axis0) *
+		         transform_scale(make_float3(0.5f, 0.5f, 0.5f) + make_float3(frand(), frand(), frand()));
+		ob.motion.pre = transform_translate(-move) * ob.tfm * transform_rotate(-motion_scale*frand()*1.5f, axis1);
+		ob.motion.mid = ob.tfm;
+		ob.motion.post = transform_translate(move) * ob.tfm * transform_rotate(motion_scale*frand()*1.5f, axis1);
+
+		transform_motion_decompose(&ob.decomp, &ob.motion, &ob.tfm);
+		object_compute_bounds(ob, scene.mesh_bounds);
+		bvh_motion_step_bounds(scene.mesh_bounds, &ob.decomp, SHUTTER_TIME, BVH_MOTION_STEPS, ob.step_bounds);
+
+		scene.objects.push_back(ob);
+	}
+}
+
+/* Kernel Data */
+
+static void pack_node(float4 *d, const BoundBox& b0, const BoundBox& b1, int c0, int c1)
+{
+	d[0] = make_float4(b0.min.x, b1.min.x, b0.max.x, b1.max.x);
+	d[1] = make_float4(b0.min.y, b1.min.y, b0.max.y, b1.max.y);
+	d[2] = make_float4(b0.min.z, b1.min.z, b0.max.z, b1.max.z);
+	d[3] = make_float4(__int_as_float(c0), __int_as_float(c1), __uint_as_float(~0u), __uint_as_float(~0u));
+}
+
+static void pack_leaf(float4 *d, int lo, int hi)
+{
+	d[3] = make_float4(__int_as_float(lo), __int_as_float(hi), 0.0f, 0.0f);
+}
+
+/* child index in the node layout, leaves are inverted */
+static int pack_child(const vector<BuildNode>& nodes, int child, int offset)
+{
+	return (nodes[child].leaf)? ~(child + offset): child + offset;
+}
+
+/* bounds per motion step of object instance leaves, as
+ * BVH::motion_bounds_primitives */
+struct BenchLeafBounds {
+	BenchScene *scene;
+	int num_triangles;
+
+	void operator()(int start, int end, BoundBox *bounds) const
+	{
+		for(int prim = start; prim < end; prim++)
+			for(int step = 0; step < BVH_MOTION_STEPS; step++)
+				bounds[step].grow(scene->objects[prim - num_triangles].step_bounds[step]);
+	}
+};
+
+static void scene_pack(BenchScene& scene, KernelGlobals& kg)
+{
+	/* mesh BVH */
+	int num_triangles = scene.verts.size()/3;
+	vector<BuildItem> tri_items;
+
+	for(int i = 0; i < num_triangles; i++) {
+		BuildItem item;
+		item.bounds = BoundBox::empty;
+		for(int k = 0; k < 3; k++)
+			item.bounds.grow(scene.verts[i*3 + k]);
+		item.index = i;
+		tri_items.push_back(item);
+	}
+
+	vector<BuildNode> mesh_nodes;
+	bvh_build(mesh_nodes, tri_items, 0, num_triangles, 4);
+
+	/* top level BVH, one object per leaf, with bounds over the whole shutter */
+	vector<BuildItem> ob_items;
+
+	for(int i = 0; i < NUM_OBJECTS; i++) {
+		BuildItem item;
+		item.bounds = scene.objects[i].bounds;
+		item.index = i;
+		ob_items.push_back(item);
+	}
+
+	vector<BuildNode> top_nodes;
+	bvh_build(top_nodes, ob_items, 0, NUM_OBJECTS, 1);
+
+	/* top level nodes are packed first, motion nodes only cover these */
+	int num_top = top_nodes.size();
+	int num_mesh = mesh_nodes.size();
+	scene.num_top_nodes = num_top;
+	scene.bvh_nodes.resize((num_top + num_mesh)*BVH_NODE_SIZE);
+
+	for(int i = 0; i < num_top; i++) {
+		const BuildNode& node = top_nodes[i];
+		float4 *d = &scene.bvh_nodes[i*BVH_NODE_SIZE];
+
+		if(node.leaf) {
+			/* object instance, stored as a single inverted primitive index */
+			pack_leaf(d, ~(num_triangles + ob_items[node.lo].index), 0);
+		}
+		else {
+			pack_node(d, top_nodes[node.child[0]].bounds, top_nodes[node.child[1]].bounds,
+				pack_child(top_nodes, node.child[0], 0), pack_child(top_nodes, node.child[1], 0));
+		}
+	}
+
+	for(int i = 0; i < num_mesh; i++) {
+		const BuildNode& node = mesh_nodes[i];
+		float4 *d = &scene.bvh_nodes[(num_top + i)*BVH_NODE_SIZE];
+
+		if(node.leaf) {
+			pack_leaf(d, node.lo, node.hi);
+		}
+		else {
+			pack_node(d, mesh_nodes[node.child[0]].bounds, mesh_nodes[node.child[1]].bounds,
+				pack_child(mesh_nodes, node.child[0], num_top), pack_child(mesh_nodes, node.child[1], num_top));
+		}
+	}
+
+	/* node data is reinterpreted as int4 like on the device */
+	scene.bvh_motion_nodes.resize(num_top*BVH_NODE_MOTION_SIZE);
+	BoundBox bounds[BVH_MOTION_STEPS];
+	BenchLeafBounds leaf_bounds = {&scene, num_triangles};
+
+	bvh_pack_motion_node((const int4*)&scene.bvh_nodes[0], &scene.bvh_motion_nodes[0], 0, false, bounds, leaf_bounds);
+
+	/* triangles in leaf order */
+	for(int i = 0; i < num_triangles; i++) {
+		int tri = tri_items[i].index;
+		float3 v0 = scene.verts[tri*3], v1 = scene.verts[tri*3 + 1], v2 = scene.verts[tri*3 + 2];
+		float3 r0 = v0 - v2, r1 = v1 - v2, r2 = cross(r0, r1);
+		Transform tfm = make_transform(
+			r0.x, r1.x, r2.x, v2.x,
+			r0.y, r1.y, r2.y, v2.y,
+			r0.z, r1.z, r2.z, v2.z,
+			0.0f, 0.0f, 0.0f, 1.0f);
+		tfm = transform_inverse(tfm);
+
+		scene.tri_woop.push_back(make_float4(tfm.z.x, tfm.z.y, tfm.z.z, -tfm.z.w));
+		scene.tri_woop.push_back(make_float4(tfm.x.x, tfm.x.y, tfm.x.z, tfm.x.w));
+		scene.tri_woop.push_back(make_float4(tfm.y.x, tfm.y.y, tfm.y.z, tfm.y.w));
+		scene.prim_visibility.push_back(~0u);
+		scene.prim_object.push_back(0);
+	}
+
+	/* object primitives, with decomposed motion as in ObjectManager */
+	scene.kobjects.resize(NUM_OBJECTS*OBJECT_SIZE);
+
+	for(int o = 0; o < NUM_OBJECTS; o++) {
+		scene.tri_woop.resize(scene.tri_woop.size() + 3);
+		scene.prim_visibility.push_back(~0u);
+		scene.prim_object.push_back(o);
+
+		memcpy(&scene.kobjects[o*OBJECT_SIZE], &scene.objects[o].decomp, sizeof(float4)*8);
+		scene.object_flag.push_back(SD_OBJECT_MOTION);
+		scene.object_node.push_back(num_top);
+	}
+
+	memset(&kg.__data, 0, sizeof(kg.__data));
+	kg.__bvh_nodes.data = &scene.bvh_nodes[0];
+	kg.__bvh_nodes.width = scene.bvh_nodes.size();
+	kg.__bvh_motion_nodes.data = &scene.bvh_motion_nodes[0];
+	kg.__bvh_motion_nodes.width = scene.bvh_motion_nodes.size();
+	kg.__tri_woop.data = &scene.tri_woop[0];
+	kg.__tri_woop.width = scene.tri_woop.size();
+	kg.__prim_visibility.data = &scene.prim_visibility[0];
+	kg.__prim_visibility.width = scene.prim_visibility.size();
+	kg.__prim_object.data = &scene.prim_object[0];
+	kg.__prim_object.width = scene.prim_object.size();
+	kg.__objects.data = &scene.kobjects[0];
+	kg.__objects.width = scene.kobjects.size();
+	kg.__object_flag.data = &scene.object_flag[0];
+	kg.__object_flag.width = scene.object_flag.size();
+	kg.__object_node.data = &scene.object_node[0];
+	kg.__object_node.width = scene.object_node.size();
+
+	/* as in MeshManager::device_update_bvh */
+	kg.__data.bvh.root = 0;
+	kg.__data.bvh.have_instancing = 1;
+	kg.__data.bvh.have_motion = 1;
+	kg.__data.bvh.motion_time_start = 0.5f - SHUTTER_TIME*0.25f;
+	kg.__data.bvh.motion_time_scale = (BVH_MOTION_STEPS - 1)/(SHUTTER_TIME*0.5f);
+}
+
+/* interpolated step bounds must contain the object at any time in the shutter */
+static float test_motion_bounds(BenchScene& scene)
+{
+	BoundBox mbounds = scene.mesh_bounds;
+	float start_t = 0.5f - SHUTTER_TIME*0.25f;
+	float worst = 0.0f;
+
+	for(int o = 0; o < NUM_OBJECTS; o++) {
+		const BenchObject& ob = scene.objects[o];
+
+		for(int k = 0; k <= 1000; k++) {
+			float x = k/1000.0f*(BVH_MOTION_STEPS - 1);
+			int s = min((int)x, BVH_MOTION_STEPS - 2);
+			float u = x - s;
+			Transform ttfm;
+
+			object_transform_at(ob, start_t + x/(BVH_MOTION_STEPS - 1)*SHUTTER_TIME*0.5f, &ttfm);
+			BoundBox b = mbounds.transformed(&ttfm);
+
+			float3 dmin = interp(ob.step_bounds[s].min, ob.step_bounds[s + 1].min, u) - b.min;
+			float3 dmax = b.max - interp(ob.step_bounds[s].max, ob.step_bounds[s + 1].max, u);
+
+			worst = max(worst, max(max(max(dmin.x, dmin.y), dmin.z), max(max(dmax.x, dmax.y), dmax.z)));
+		}
+	}
+
+	return worst;
+}
+
+static void rays_create(vector<Ray>& rays)
+{
+	srand(2);
+
+	for(int i = 0; i < NUM_RAYS; i++) {
+		Ray& ray = rays[i];
+		int x = i % 512, y = i / 512;
+
+		memset(&ray, 0, sizeof(ray));
+		ray.P = make_float3(20.0f, 20.0f, -30.0f);
+		ray.D = normalize(make_float3(-0.7f + x/365.0f, -0.7f + y/365.0f, 1.0f));
+		ray.t = FLT_MAX;
+		ray.time = 0.5f - SHUTTER_TIME*0.25f + frand()*SHUTTER_TIME*0.5f;
+	}
+}
+
+static double bench_rays(KernelGlobals *kg, vector<Ray>& rays, vector<Intersection>& isects, int *hits)
+{
+	double best = FLT_MAX;
+
+	for(int run = 0; run < NUM_RUNS; run++) {
+		double t = time_dt();
+
+		*hits = 0;
+		for(int i = 0; i < NUM_RAYS; i++)
+			*hits += scene_intersect(kg, &rays[i], PATH_RAY_CAMERA, &isects[i], NULL, 0.0f, 0.0f);
+
+		best = min(best, time_dt() - t);
+	}
+
+	return best;
+}
+
+int main(int argc, const char **argv)
+{
+	if(argc > 1)
+		motion_scale = (float)atof(argv[1]);
+
+	BenchScene scene;
+	KernelGlobals kg;
+
+	mesh_create(scene);
+	objects_create(scene);
+	scene_pack(scene, kg);
+
+	vector<Ray> rays(NUM_RAYS);
+	vector<Intersection> isects_shutter(NUM_RAYS), isects_steps(NUM_RAYS);
+	rays_create(rays);
+
+	printf("motion scale %g, %d objects, %d top level nodes, %d rays:\n",
+		motion_scale, NUM_OBJECTS, scene.num_top_nodes, NUM_RAYS);
+
+	int error_status = 0;
+
+	float worst = test_motion_bounds(scene);
+	printf("  largest miss of interpolated bounds %g\n", worst);
+
+	if(worst > 1e-2f) {
+		fprintf(stderr, "|--* Interpolated motion bounds do not contain the object\n");
+		error_status = 1;
+	}
+
+	const char *names[2] = {"shutter bounds", "step bounds"};
+	vector<Intersection> *isects[2] = {&isects_shutter, &isects_steps};
+
+	for(int mode = 0; mode < 2; mode++) {
+		int hits;
+
+		kg.__data.bvh.num_motion_nodes = (mode == 0)? 0: scene.num_top_nodes;
+#ifdef __KERNEL_STATS__
+		kg.stats.reset();
+#endif
+		double t = bench_rays(&kg, rays, *isects[mode], &hits);
+
+		printf("  %-14s %6d hits, %.2f Mrays/s", names[mode], hits, NUM_RAYS/t*1e-6);
+#ifdef __KERNEL_STATS__
+		printf(", %.1f nodes per ray", kg.stats.bvh_nodes/(double)(NUM_RAYS*NUM_RUNS));
+#endif
+		printf("\n");
+	}
+
+	int mismatches = 0;
+	for(int i = 0; i < NUM_RAYS; i++) {
+		const Intersection& a = isects_shutter[i];
+		const Intersection& b = isects_steps[i];
+
+		/* distance is scaled in and out of instances, so traversal order
+		 * can change the last bits */
+		if(a.prim != b.prim || a.object != b.object || fabsf(a.t - b.t) > 1e-5f*a.t)
+			mismatches++;
+	}
+
+	if(mismatches) {
+		fprintf(stderr, "|--* Step bounds miss %d hits\n", mismatches);
+		error_status = 1;
+	}
+
+	return error_status;
+}
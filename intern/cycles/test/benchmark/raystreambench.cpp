@@ -0,0 +1,415 @@
+/*
+ * Copyright 2011-2014 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+/* Compare single ray traversal (scene_intersect) with ray stream traversal
+ * (scene_intersect_stream) for camera rays, opaque shadow rays towards one
+ * light and incoherent rays, in a scene with two instances of a mesh.
+ *
+ * Also verifies both traversals find the same hits. Ties on edges shared
+ * by two triangles may be resolved differently.
+ *
+ * The mesh BVH is a simple median split binary BVH packed in the kernel
+ * layout, so only the kernel headers are needed.
+ */
+
+/* To compile run (from this directory):
+ * g++ -O2 -msse4.1 -I<OpenImageIO include> -I../../kernel -I../../kernel/svm -I../../kernel/osl -I../../util \
+ *     "-DCCL_NAMESPACE_BEGIN=namespace ccl {" "-DCCL_NAMESPACE_END=}" \
+ *     raystreambench.cpp ../../util/util_time.cpp ../../util/util_transform.cpp -lpthread -o raystreambench
+ *
+ * Usage: raystreambench [grid|soup]
+ */
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "kernel_compat_cpu.h"
+#include "kernel_math.h"
+#include "kernel_types.h"
+#include "kernel_globals.h"
+#include "kernel_film.h"
+#include "kernel_path.h"
+
+#include "util_boundbox.h"
+#include "util_time.h"
+#include "util_transform.h"
+
+using namespace ccl;
+
+/* rays per stream, like a 8x8 block of camera rays in the kernel */
+#define STREAM_SIZE 64
+#define NUM_RAYS (STREAM_SIZE * 4096)
+#define NUM_RUNS 7
+
+/* Mesh BVH */
+
+struct BuildNode {
+	float3 bmin, bmax;
+	int child[2];
+	int lo, hi;
+	bool leaf;
+};
+
+struct Mesh {
+	vector<float3> verts;      /* 3 per triangle */
+	vector<int> tri_order;     /* triangles in BVH leaf order */
+	vector<BuildNode> nodes;
+};
+
+static void mesh_bounds(const Mesh& mesh, int lo, int hi, float3& bmin, float3& bmax)
+{
+	bmin = make_float3(FLT_MAX, FLT_MAX, FLT_MAX);
+	bmax = -bmin;
+
+	for(int i = lo; i < hi; i++) {
+		for(int k = 0; k < 3; k++) {
+			float3 v = mesh.verts[mesh.tri_order[i]*3 + k];
+			bmin = min(bmin, v);
+			bmax = max(bmax, v);
+		}
+	}
+}
+
+struct CentroidLess {
+	const Mesh *mesh;
+	int axis;
+
+	float centroid(int tri) const
+	{
+		float c = 0.0f;
+		for(int k = 0; k < 3; k++)
+			c += get_float3_component(mesh->verts[tri*3 + k], axis);
+		return c;
+	}
+
+	bool operator()(int a, int b) const
+	{
+		return centroid(a) < centroid(b);
+	}
+
+	static float get_float3_component(const float3& v, int axis)
+	{
+		return (axis == 0)? v.x: (axis == 1)? v.y: v.z;
+	}
+};
+
+static int mesh_build(Mesh& mesh, int lo, int hi)
+{
+	int index = mesh.nodes.size();
+	mesh.nodes.push_back(BuildNode());
+
+	float3 bmin, bmax;
+	mesh_bounds(mesh, lo, hi, bmin, bmax);
+	mesh.nodes[index].bmin = bmin;
+	mesh.nodes[index].bmax = bmax;
+
+	if(hi - lo <= 4) {
+		mesh.nodes[index].leaf = true;
+		mesh.nodes[index].lo = lo;
+		mesh.nodes[index].hi = hi;
+		return index;
+	}
+
+	/* median split along the largest axis */
+	float3 extent = bmax - bmin;
+	CentroidLess less;
+	less.mesh = &mesh;
+	less.axis = (extent.x > extent.y && extent.x > extent.z)? 0: (extent.y > extent.z)? 1: 2;
+
+	int mid = (lo + hi)/2;
+	std::nth_element(mesh.tri_order.begin() + lo, mesh.tri_order.begin() + mid, mesh.tri_order.begin() + hi, less);
+
+	mesh.nodes[index].leaf = false;
+	int c0 = mesh_build(mesh, lo, mid);
+	int c1 = mesh_build(mesh, mid, hi);
+	mesh.nodes[index].child[0] = c0;
+	mesh.nodes[index].child[1] = c1;
+
+	return index;
+}
+
+/* displaced grid, coherent surface like most production meshes */
+static void mesh_create_grid(Mesh& mesh)
+{
+	const int res = 250;
+
+	for(int y = 0; y < res; y++) {
+		for(int x = 0; x < res; x++) {
+			float3 p[4];
+
+			for(int k = 0; k < 4; k++) {
+				float fx = (x + (k & 1))*10.0f/res;
+				float fy = (y + (k >> 1))*10.0f/res;
+				p[k] = make_float3(fx, fy, sinf(fx*2.0f)*cosf(fy*1.5f) + 1.0f);
+			}
+
+			mesh.verts.push_back(p[0]); mesh.verts.push_back(p[1]); mesh.verts.push_back(p[2]);
+			mesh.verts.push_back(p[1]); mesh.verts.push_back(p[3]); mesh.verts.push_back(p[2]);
+		}
+	}
+}
+
+/* small random triangles, like foliage or particles */
+static void mesh_create_soup(Mesh& mesh)
+{
+	const int num_triangles = 100000;
+
+	srand(1);
+	for(int i = 0; i < num_triangles; i++) {
+		float3 c = make_float3(rand()%1000*0.01f, rand()%1000*0.01f, rand()%1000*0.01f*0.2f);
+
+		for(int k = 0; k < 3; k++)
+			mesh.verts.push_back(c + make_float3(rand()%100*0.002f, rand()%100*0.002f, rand()%100*0.002f));
+	}
+}
+
+/* Kernel Data */
+
+struct BenchScene {
+	vector<float4> bvh_nodes;
+	vector<float4> tri_woop;
+	vector<uint> prim_visibility;
+	vector<uint> prim_object;
+	vector<float4> objects;
+	vector<uint> object_node;
+};
+
+static void pack_node(float4 *d, const BoundBox& b0, const BoundBox& b1, int c0, int c1)
+{
+	d[0] = make_float4(b0.min.x, b1.min.x, b0.max.x, b1.max.x);
+	d[1] = make_float4(b0.min.y, b1.min.y, b0.max.y, b1.max.y);
+	d[2] = make_float4(b0.min.z, b1.min.z, b0.max.z, b1.max.z);
+	d[3] = make_float4(__int_as_float(c0), __int_as_float(c1), __uint_as_float(~0u), __uint_as_float(~0u));
+}
+
+static void scene_pack(const Mesh& mesh, BenchScene& scene, KernelGlobals& kg)
+{
+	int num_triangles = mesh.tri_order.size();
+
+	/* triangles, in the precomputed form used by the kernel intersection */
+	for(int i = 0; i < num_triangles; i++) {
+		int tri = mesh.tri_order[i];
+		float3 v0 = mesh.verts[tri*3], v1 = mesh.verts[tri*3 + 1], v2 = mesh.verts[tri*3 + 2];
+		float3 r0 = v0 - v2, r1 = v1 - v2, r2 = cross(r0, r1);
+		Transform tfm = make_transform(
+			r0.x, r1.x, r2.x, v2.x,
+			r0.y, r1.y, r2.y, v2.y,
+			r0.z, r1.z, r2.z, v2.z,
+			0.0f, 0.0f, 0.0f, 1.0f);
+		tfm = transform_inverse(tfm);
+
+		scene.tri_woop.push_back(make_float4(tfm.z.x, tfm.z.y, tfm.z.z, -tfm.z.w));
+		scene.tri_woop.push_back(make_float4(tfm.x.x, tfm.x.y, tfm.x.z, tfm.x.w));
+		scene.tri_woop.push_back(make_float4(tfm.y.x, tfm.y.y, tfm.y.z, tfm.y.w));
+		scene.prim_visibility.push_back(~0u);
+		scene.prim_object.push_back(0);
+	}
+
+	/* mesh nodes */
+	int num_nodes = mesh.nodes.size();
+	scene.bvh_nodes.resize((num_nodes + 3)*BVH_NODE_SIZE);
+
+	for(int i = 0; i < num_nodes; i++) {
+		const BuildNode& node = mesh.nodes[i];
+		float4 *d = &scene.bvh_nodes[i*BVH_NODE_SIZE];
+
+		if(node.leaf) {
+			d[3] = make_float4(__int_as_float(node.lo), __int_as_float(node.hi), 0.0f, 0.0f);
+		}
+		else {
+			const BuildNode& a = mesh.nodes[node.child[0]];
+			const BuildNode& b = mesh.nodes[node.child[1]];
+
+			pack_node(d, BoundBox(a.bmin, a.bmax), BoundBox(b.bmin, b.bmax),
+				a.leaf? ~node.child[0]: node.child[0],
+				b.leaf? ~node.child[1]: node.child[1]);
+		}
+	}
+
+	/* top level with two instances of the mesh, the second one moved and scaled */
+	Transform tfm[2] = {
+		transform_identity(),
+		transform_translate(make_float3(3.0f, 0.0f, 2.5f)) * transform_scale(make_float3(0.5f, 0.5f, 0.5f))};
+	BoundBox bounds(mesh.nodes[0].bmin, mesh.nodes[0].bmax);
+	int top = num_nodes, leaf0 = num_nodes + 1, leaf1 = num_nodes + 2;
+
+	pack_node(&scene.bvh_nodes[top*BVH_NODE_SIZE],
+		bounds.transformed(&tfm[0]), bounds.transformed(&tfm[1]), ~leaf0, ~leaf1);
+	scene.bvh_nodes[leaf0*BVH_NODE_SIZE + 3] = make_float4(__int_as_float(~num_triangles), 0.0f, 0.0f, 0.0f);
+	scene.bvh_nodes[leaf1*BVH_NODE_SIZE + 3] = make_float4(__int_as_float(~(num_triangles + 1)), 0.0f, 0.0f, 0.0f);
+
+	/* object leaves are primitives too */
+	for(int o = 0; o < 2; o++) {
+		scene.tri_woop.resize(scene.tri_woop.size() + 3);
+		scene.prim_visibility.push_back(~0u);
+		scene.prim_object.push_back(o);
+	}
+
+	scene.objects.resize(2*OBJECT_SIZE);
+	for(int o = 0; o < 2; o++) {
+		Transform itfm = transform_inverse(tfm[o]);
+		memcpy(&scene.objects[o*OBJECT_SIZE + OBJECT_TRANSFORM], &tfm[o], sizeof(float4)*3);
+		memcpy(&scene.objects[o*OBJECT_SIZE + OBJECT_INVERSE_TRANSFORM], &itfm, sizeof(float4)*3);
+	}
+	scene.object_node.resize(2, 0);
+
+	memset(&kg.__data, 0, sizeof(kg.__data));
+	kg.__bvh_nodes.data = &scene.bvh_nodes[0];
+	kg.__bvh_nodes.width = scene.bvh_nodes.size();
+	kg.__tri_woop.data = &scene.tri_woop[0];
+	kg.__tri_woop.width = scene.tri_woop.size();
+	kg.__prim_visibility.data = &scene.prim_visibility[0];
+	kg.__prim_visibility.width = scene.prim_visibility.size();
+	kg.__prim_object.data = &scene.prim_object[0];
+	kg.__prim_object.width = scene.prim_object.size();
+	kg.__objects.data = &scene.objects[0];
+	kg.__objects.width = scene.objects.size();
+	kg.__object_node.data = &scene.object_node[0];
+	kg.__object_node.width = scene.object_node.size();
+	kg.__data.bvh.root = top;
+	kg.__data.bvh.have_instancing = 1;
+	kg.__data.bvh.use_obvh = 0;
+}
+
+/* Rays */
+
+enum RayType {
+	RAYS_CAMERA = 0,
+	RAYS_SHADOW,
+	RAYS_INCOHERENT,
+	NUM_RAY_TYPES
+};
+
+static const char *ray_type_names[NUM_RAY_TYPES] = {"camera", "shadow", "incoherent"};
+
+static void rays_create(vector<Ray>& rays, RayType type)
+{
+	srand(2);
+
+	for(int i = 0; i < NUM_RAYS; i++) {
+		Ray& ray = rays[i];
+		memset(&ray, 0, sizeof(ray));
+
+		/* streams are 8x8 pixel blocks, like in the kernel */
+		int block = i / STREAM_SIZE, j = i % STREAM_SIZE;
+		int x = (block % 64)*8 + j % 8;
+		int y = (block / 64)*8 + j / 8;
+
+		if(type == RAYS_CAMERA) {
+			ray.P = make_float3(5.0f, 5.0f, 20.0f);
+			ray.D = normalize(make_float3(-0.5f + x/512.0f, -0.5f + y/512.0f, -1.0f));
+			ray.t = FLT_MAX;
+		}
+		else if(type == RAYS_SHADOW) {
+			float3 light = make_float3(5.0f, 5.0f, 30.0f);
+			ray.P = make_float3(x/512.0f*10.0f, y/512.0f*10.0f, -1.0f);
+			ray.D = normalize(light - ray.P);
+			ray.t = len(light - ray.P);
+		}
+		else {
+			ray.P = make_float3(rand()%1000*0.01f, rand()%1000*0.01f, rand()%1000*0.003f);
+			ray.D = normalize(make_float3(rand()%200 - 100, rand()%200 - 100, rand()%200 - 100) + make_float3(0.001f, 0.0f, 0.0f));
+			ray.t = FLT_MAX;
+		}
+	}
+}
+
+static bool bench_rays(KernelGlobals *kg, RayType type)
+{
+	vector<Ray> rays(NUM_RAYS);
+	vector<Intersection> single(NUM_RAYS), stream(NUM_RAYS);
+	uint visibility = (type == RAYS_SHADOW)? PATH_RAY_SHADOW_OPAQUE: PATH_RAY_CAMERA;
+	double best_single = FLT_MAX, best_stream = FLT_MAX;
+	int hits = 0, mismatches = 0;
+
+	rays_create(rays, type);
+
+	/* best of several runs, to reduce noise */
+	for(int run = 0; run < NUM_RUNS; run++) {
+		double t = time_dt();
+		hits = 0;
+		for(int i = 0; i < NUM_RAYS; i++)
+			hits += scene_intersect(kg, &rays[i], visibility, &single[i], NULL, 0.0f, 0.0f);
+		best_single = min(best_single, time_dt() - t);
+
+		t = time_dt();
+		for(int i = 0; i < NUM_RAYS; i += STREAM_SIZE)
+			scene_intersect_stream(kg, &rays[i], &stream[i], ~(RayMask)0, visibility);
+		best_stream = min(best_stream, time_dt() - t);
+	}
+
+	for(int i = 0; i < NUM_RAYS; i++) {
+		const Intersection& a = single[i];
+		const Intersection& b = stream[i];
+
+		/* shadow rays may stop at any hit */
+		if(type == RAYS_SHADOW) {
+			if((a.prim != ~0) != (b.prim != ~0))
+				mismatches++;
+		}
+		else if(a.prim != b.prim || a.object != b.object || fabsf(a.t - b.t) > 1e-5f*a.t) {
+			mismatches++;
+		}
+	}
+
+	printf("  %-10s %6d hits, %4d mismatches, single %.2f Mrays/s, stream %.2f Mrays/s\n",
+		ray_type_names[type], hits, mismatches, NUM_RAYS/best_single*1e-6, NUM_RAYS/best_stream*1e-6);
+
+	/* allow a few ties on shared edges */
+	return mismatches <= NUM_RAYS/1000;
+}
+
+int main(int argc, const char **argv)
+{
+	const char *mesh_type = (argc > 1)? argv[1]: "grid";
+	Mesh mesh;
+
+	if(strcmp(mesh_type, "grid") == 0) {
+		mesh_create_grid(mesh);
+	}
+	else if(strcmp(mesh_type, "soup") == 0) {
+		mesh_create_soup(mesh);
+	}
+	else {
+		fprintf(stderr, "Unknown mesh type '%s'\n", mesh_type);
+		return 1;
+	}
+
+	int num_triangles = mesh.verts.size()/3;
+	for(int i = 0; i < num_triangles; i++)
+		mesh.tri_order.push_back(i);
+	mesh_build(mesh, 0, num_triangles);
+
+	BenchScene scene;
+	KernelGlobals kg;
+	scene_pack(mesh, scene, kg);
+
+	printf("%s, %d triangles, 2 instances, %d rays:\n", mesh_type, num_triangles, NUM_RAYS);
+
+	bool ok = true;
+	for(int type = 0; type < NUM_RAY_TYPES; type++)
+		ok = bench_rays(&kg, (RayType)type) && ok;
+
+	if(!ok) {
+		fprintf(stderr, "|--* Stream traversal hits differ from single ray traversal\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,376 @@
+/*
+ * Copyright 2011-2014 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+/* Read an image through the texture cache with TextureCache::lookup, under a
+ * memory budget smaller than the image.
+ *
+ * A tiled, mipmapped image with noise in every texel is written to a
+ * temporary file, with the mip levels box filtered here so the expected
+ * result of every level is known. The texture system is set up like
+ * ImageManager::device_update does.
+ *
+ * Verifies that:
+ * - lookups with small differentials return the full resolution texels,
+ * - tiles are evicted and the cache stays within the budget,
+ * - the mip level read follows the texture coordinate differentials.
+ *
+ * Reports lookups per second for full resolution and minified lookups.
+ */
+
+/* To compile run (from this directory):
+ * g++ -O2 -msse4.1 -I<OpenImageIO include> -I../../kernel -I../../kernel/svm -I../../kernel/osl -I../../util \
+ *     "-DCCL_NAMESPACE_BEGIN=namespace ccl {" "-DCCL_NAMESPACE_END=}" \
+ *     texcachebench.cpp ../../kernel/kernel_texture_cache.cpp ../../util/util_time.cpp \
+ *     -L<OpenImageIO lib> -lOpenImageIO -lpthread -o texcachebench
+ *
+ * Usage: texcachebench [image_size] [budget_MB]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <OpenImageIO/imageio.h>
+#include <OpenImageIO/texture.h>
+
+#include "kernel_compat_cpu.h"
+#include "kernel_types.h"
+#include "kernel_globals.h"
+#include "kernel_texture_cache.h"
+
+#include "util_time.h"
+
+OIIO_NAMESPACE_USING
+
+using namespace ccl;
+
+#define TILE_SIZE 64
+#define NUM_LEVELS 6
+#define NUM_LOOKUPS 200000
+
+static int image_size = 4096;
+static float budget_MB = 4.0f;
+
+/* Mip Levels, box filtered like maketx does for power of two sizes */
+
+typedef vector<uchar> Level;
+
+static uchar texel_noise(int x, int y, int c)
+{
+	uint h = (uint)x*73856093u ^ (uint)y*19349663u ^ (uint)c*83492791u;
+
+	h ^= h >> 13;
+	h *= 0x5bd1e995u;
+	h ^= h >> 15;
+
+	return (uchar)(h & 255);
+}
+
+static void levels_create(vector<Level>& levels)
+{
+	int size = image_size;
+
+	levels.resize(NUM_LEVELS);
+	levels[0].resize(size*size*4);
+
+	for(int y = 0; y < size; y++)
+		for(int x = 0; x < size; x++)
+			for(int c = 0; c < 4; c++)
+				levels[0][(y*size + x)*4 + c] = texel_noise(x, y, c);
+
+	for(int l = 1; l < NUM_LEVELS; l++) {
+		Level& prev = levels[l - 1];
+		int prev_size = size;
+
+		size /= 2;
+		levels[l].resize(size*size*4);
+
+		for(int y = 0; y < size; y++) {
+			for(int x = 0; x < size; x++) {
+				for(int c = 0; c < 4; c++) {
+					int sum = prev[((2*y)*prev_size + 2*x)*4 + c] +
+					          prev[((2*y)*prev_size + 2*x + 1)*4 + c] +
+					          prev[((2*y + 1)*prev_size + 2*x)*4 + c] +
+					          prev[((2*y + 1)*prev_size + 2*x + 1)*4 + c];
+
+					levels[l][(y*size + x)*4 + c] = (uchar)((sum + 2)/4);
+				}
+			}
+		}
+	}
+}
+
+static bool levels_write(vector<Level>& levels, const char *filename)
+{
+	ImageOutput *out = ImageOutput::create(filename);
+
+	if(!out)
+		return false;
+
+	if(!out->supports("tiles") || !out->supports("mipmap")) {
+		delete out;
+		return false;
+	}
+
+	ImageSpec spec(image_size, image_size, 4, TypeDesc::UINT8);
+	spec.tile_width = TILE_SIZE;
+	spec.tile_height = TILE_SIZE;
+
+	bool ok = true;
+
+	for(int l = 0; l < NUM_LEVELS && ok; l++) {
+		if(l > 0) {
+			spec.width = spec.full_width = spec.width/2;
+			spec.height = spec.full_height = spec.height/2;
+		}
+
+		ok = out->open(filename, spec, (l == 0)? ImageOutput::Create: ImageOutput::AppendMIPLevel) &&
+		     out->write_image(TypeDesc::UINT8, &levels[l][0]);
+	}
+
+	ok = out->close() && ok;
+	delete out;
+
+	return ok;
+}
+
+/* Texture System, set up as in ImageManager::device_update and
+ * ImageManager::file_load_texture_cache */
+
+static TextureSystem *texture_system_create(TextureCacheGlobals *tex_cache, const char *filename)
+{
+	TextureSystem *ts = TextureSystem::create(false);
+
+	ts->attribute("automip", 1);
+	ts->attribute("autotile", TILE_SIZE);
+	ts->attribute("gray_to_rgb", 1);
+	ts->attribute("max_memory_MB", budget_MB);
+
+	tex_cache->ts = ts;
+	tex_cache->handles.push_back(ts->get_texture_handle(ustring(filename)));
+
+	return ts;
+}
+
+static long long texture_system_stat(TextureSystem *ts, const char *name)
+{
+	long long value = 0;
+
+	if(strcmp(name, "stat:cache_memory_used") == 0) {
+		ts->getattribute(name, TypeDesc::INT64, &value);
+	}
+	else {
+		int ivalue = 0;
+		ts->getattribute(name, TypeDesc::INT, &ivalue);
+		value = ivalue;
+	}
+
+	return value;
+}
+
+/* Lookups */
+
+/* texel of a level at texel center x, y as texture coordinates of the kernel,
+ * which are bottom to top */
+static float4 level_texel(vector<Level>& levels, int l, int x, int y)
+{
+	int size = image_size >> l;
+	const uchar *texel = &levels[l][(y*size + x)*4];
+
+	return make_float4(texel[0], texel[1], texel[2], texel[3])*(1.0f/255.0f);
+}
+
+static bool level_lookup(KernelGlobals *kg, int l, int x, int y, float width, float4 *result)
+{
+	int size = image_size >> l;
+	float u = (x + 0.5f)/size;
+	float v = 1.0f - (y + 0.5f)/size;
+	float2 dx = make_float2(width/image_size, 0.0f);
+	float2 dy = make_float2(0.0f, width/image_size);
+
+	return TextureCache::lookup(kg, 0, u, v, dx, dy, result);
+}
+
+static float max_diff(float4 a, float4 b)
+{
+	return max(max(fabsf(a.x - b.x), fabsf(a.y - b.y)), max(fabsf(a.z - b.z), fabsf(a.w - b.w)));
+}
+
+/* full resolution lookups over the whole image, more tiles than fit in the
+ * budget are touched */
+static bool test_full_resolution(KernelGlobals *kg, vector<Level>& levels)
+{
+	float max_error = 0.0f;
+	int stride = max(image_size/1024, 1);
+	int num = 0;
+
+	double t = time_dt();
+
+	for(int y = 0; y < image_size; y += stride) {
+		for(int x = (y*7) % stride; x < image_size; x += stride) {
+			float4 result;
+
+			if(!level_lookup(kg, 0, x, y, 0.25f, &result)) {
+				fprintf(stderr, "|--* Image not read through the texture cache\n");
+				return false;
+			}
+
+			max_error = max(max_error, max_diff(result, level_texel(levels, 0, x, y)));
+			num++;
+		}
+	}
+
+	t = time_dt() - t;
+
+	printf("  mip 0: max error %g, %.2f M lookups per second\n", max_error, num/t*1e-6);
+
+	if(max_error > 1e-3f) {
+		fprintf(stderr, "|--* Full resolution lookups don't match the image\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_eviction(TextureSystem *ts)
+{
+	long long created = texture_system_stat(ts, "stat:tiles_created");
+	long long current = texture_system_stat(ts, "stat:tiles_current");
+	long long peak = texture_system_stat(ts, "stat:tiles_peak");
+	long long memory = texture_system_stat(ts, "stat:cache_memory_used");
+	long long budget = (long long)(budget_MB*1024*1024);
+	long long tile_bytes = TILE_SIZE*TILE_SIZE*4;
+
+	printf("  cache: %lld tiles read, %lld current, %lld peak, %.2f of %.2f MB\n",
+		created, current, peak, memory/(1024.0*1024.0), budget/(1024.0*1024.0));
+
+	if(current >= created) {
+		fprintf(stderr, "|--* No tiles evicted\n");
+		return false;
+	}
+
+	/* the cache may overshoot by the tiles of one lookup before evicting */
+	if(memory > budget + 4*tile_bytes) {
+		fprintf(stderr, "|--* Cache exceeds memory budget\n");
+		return false;
+	}
+
+	return true;
+}
+
+/* minified lookups at texel centers of each level, the closest level must be
+ * the one matching the differentials */
+static bool test_levels(KernelGlobals *kg, vector<Level>& levels)
+{
+	bool ok = true;
+
+	srand(1);
+
+	for(int l = 0; l < NUM_LEVELS; l++) {
+		int size = image_size >> l;
+		int wrong_level = 0;
+		float max_error = 0.0f;
+
+		double t = time_dt();
+
+		for(int i = 0; i < NUM_LOOKUPS/NUM_LEVELS; i++) {
+			int x = rand() % size;
+			int y = rand() % size;
+			float4 result;
+
+			level_lookup(kg, l, x, y, (float)(1 << l), &result);
+
+			/* level with the closest texel */
+			int closest = 0;
+			float closest_error = FLT_MAX;
+
+			for(int k = 0; k < NUM_LEVELS; k++) {
+				int kx = (x << l) >> k;
+				int ky = (y << l) >> k;
+				float error = max_diff(result, level_texel(levels, k, kx, ky));
+
+				if(error < closest_error) {
+					closest = k;
+					closest_error = error;
+				}
+			}
+
+			if(closest != l)
+				wrong_level++;
+
+			max_error = max(max_error, max_diff(result, level_texel(levels, l, x, y)));
+		}
+
+		t = time_dt() - t;
+
+		printf("  footprint %2d texels: other level closest in %d lookups, max error %g, %.2f M lookups per second\n",
+			1 << l, wrong_level, max_error, (NUM_LOOKUPS/NUM_LEVELS)/t*1e-6);
+
+		/* trilinear blending with a neighbor level is allowed to win
+		 * occasionally, but the level must follow the footprint */
+		if(wrong_level > (NUM_LOOKUPS/NUM_LEVELS)/100)
+			ok = false;
+	}
+
+	if(!ok)
+		fprintf(stderr, "|--* Mip level does not follow the differentials\n");
+
+	return ok;
+}
+
+int main(int argc, const char **argv)
+{
+	if(argc > 1)
+		image_size = atoi(argv[1]);
+	if(argc > 2)
+		budget_MB = (float)atof(argv[2]);
+
+	const char *filename = "texcachebench_tmp.tif";
+	vector<Level> levels;
+
+	levels_create(levels);
+
+	if(!levels_write(levels, filename)) {
+		fprintf(stderr, "|--* Failed to write %s\n", filename);
+		return 1;
+	}
+
+	printf("%dx%d image, %d levels, %dx%d tiles, %.1f MB level 0, %.1f MB budget:\n",
+		image_size, image_size, NUM_LEVELS, TILE_SIZE, TILE_SIZE,
+		image_size*image_size*4/(1024.0*1024.0), budget_MB);
+
+	TextureCacheGlobals tex_cache;
+	TextureSystem *ts = texture_system_create(&tex_cache, filename);
+	KernelGlobals kg;
+	int error_status = 0;
+
+	TextureCache::thread_init(&kg, &tex_cache);
+
+	if(!test_full_resolution(&kg, levels))
+		error_status = 1;
+	else if(!test_eviction(ts))
+		error_status = 1;
+	else if(!test_levels(&kg, levels))
+		error_status = 1;
+
+	TextureCache::thread_free(&kg);
+	TextureSystem::destroy(ts);
+
+	remove(filename);
+
+	return error_status;
+}
@@ -0,0 +1,616 @@
+/*
+ * Copyright 2011-2014 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+/* Compare ray marching with delta tracking through the majorant grid in a
+ * heterogeneous volume.
+ *
+ * Shadow transmittance: ratio tracking against ray marching, like
+ * kernel_volume_shadow_heterogeneous and
+ * kernel_volume_shadow_heterogeneous_tracking do. The volume shader is
+ * replaced by an analytic density in a unit cube.
+ *
+ * Emission: the kernel's kernel_volume_integrate_heterogeneous and
+ * kernel_volume_integrate_heterogeneous_tracking (spectral tracking) with an
+ * SVM volume shader, for an emission only volume and for emission in thin
+ * and dense absorbing volumes. The majorant grid is evaluated with
+ * kernel_shader_evaluate like mesh_volume.cpp does.
+ *
+ * Both build the majorant grid with the same code as mesh_volume.cpp. Reports
+ * bias and error against a fine quadrature, time per sample, and rmse^2 x time,
+ * which is proportional to the time needed for a given noise level.
+ *
+ * Also verifies the majorants bound the density and tracking is unbiased.
+ */
+
+/* To compile run (from this directory):
+ * g++ -O2 -msse4.1 -I<OpenImageIO include> -I../../kernel -I../../kernel/svm -I../../kernel/osl -I../../util \
+ *     -I../../render "-DCCL_NAMESPACE_BEGIN=namespace ccl {" "-DCCL_NAMESPACE_END=}" \
+ *     volumebench.cpp ../../kernel/kernel_texture_cache.cpp ../../util/util_time.cpp \
+ *     -L<OpenImageIO lib> -lOpenImageIO -lpthread -o volumebench
+ *
+ * Usage: volumebench [density_scale]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "kernel_compat_cpu.h"
+#include "kernel_math.h"
+#include "kernel_types.h"
+#include "kernel_globals.h"
+#include "kernel_film.h"
+#include "kernel_path.h"
+#include "kernel_displace.h"
+
+#include "mesh_volume.h"
+
+#include "util_time.h"
+
+using namespace ccl;
+
+#define GRID_RESOLUTION VOLUME_GRID_RESOLUTION
+#define NUM_RAYS 2000
+#define NUM_SAMPLES 100
+#define REFERENCE_STEPS 4096
+#define MAX_STEPS 1024
+
+static float density_scale = 20.0f;
+static long num_evaluations = 0;
+
+/* smoke like density, with sharp features and empty space */
+static float density(float3 P)
+{
+	float s = 0.5f + 0.5f*sinf(9.0f*P.x)*cosf(7.0f*P.y)*sinf(5.0f*P.z + 1.0f);
+	float falloff = (len(P - make_float3(0.5f, 0.5f, 0.5f)) < 0.45f)? 1.0f: 0.0f;
+
+	num_evaluations++;
+
+	return density_scale*s*s*s*s*falloff;
+}
+
+/* Majorant Grid, as built in mesh_volume.cpp */
+
+struct VolumeGrid {
+	vector<float4> grid;
+	vector<float> majorants;
+};
+
+static void grid_build(VolumeGrid& vgrid, KernelGlobals& kg)
+{
+	const int res = GRID_RESOLUTION;
+	const int lres = res*2 + 1;
+	float3 lower = make_float3(0.0f, 0.0f, 0.0f);
+	float3 upper = make_float3(1.0f, 1.0f, 1.0f);
+	float cell_size = 1.0f/res;
+
+	/* density at lattice points */
+	vector<float> sigma_t(lres*lres*lres);
+
+	for(int z = 0; z < lres; z++)
+		for(int y = 0; y < lres; y++)
+			for(int x = 0; x < lres; x++)
+				sigma_t[x + lres*(y + lres*z)] = density(make_float3(x*0.5f, y*0.5f, z*0.5f)*cell_size);
+
+	vector<float> emission;
+	vector<float> emission_rates;
+
+	volume_majorants_from_lattice(make_int3(res, res, res), make_float3(cell_size, cell_size, cell_size),
+		sigma_t, emission, vgrid.majorants, emission_rates);
+
+	float max_majorant = 0.0f;
+
+	for(size_t i = 0; i < vgrid.majorants.size(); i++)
+		max_majorant = max(max_majorant, vgrid.majorants[i]);
+
+	vgrid.grid.push_back(make_float4(lower.x, lower.y, lower.z, __int_as_float(0)));
+	vgrid.grid.push_back(make_float4(upper.x, upper.y, upper.z, max_majorant));
+	vgrid.grid.push_back(make_float4((float)res, (float)res, (float)res, __int_as_float(-1)));
+
+	memset(&kg.__data, 0, sizeof(kg.__data));
+	kg.__volume_grid.data = &vgrid.grid[0];
+	kg.__volume_grid.width = vgrid.grid.size();
+	kg.__volume_majorants.data = &vgrid.majorants[0];
+	kg.__volume_majorants.width = vgrid.majorants.size();
+	kg.__data.integrator.volume_majorants = 1;
+}
+
+/* majorants must be an upper bound for the density, or tracking is biased */
+static int grid_test_bounds(VolumeGrid& vgrid)
+{
+	int violations = 0;
+
+	srand(3);
+	for(int i = 0; i < 1000000; i++) {
+		float3 P = make_float3(rand()/(float)RAND_MAX, rand()/(float)RAND_MAX, rand()/(float)RAND_MAX);
+		int x = min((int)(P.x*GRID_RESOLUTION), GRID_RESOLUTION - 1);
+		int y = min((int)(P.y*GRID_RESOLUTION), GRID_RESOLUTION - 1);
+		int z = min((int)(P.z*GRID_RESOLUTION), GRID_RESOLUTION - 1);
+
+		if(density(P) > vgrid.majorants[x + GRID_RESOLUTION*(y + GRID_RESOLUTION*z)])
+			violations++;
+	}
+
+	return violations;
+}
+
+/* Transmittance Estimators */
+
+static float transmittance_reference(Ray *ray)
+{
+	float tau = 0.0f;
+	float dt = ray->t/REFERENCE_STEPS;
+
+	for(int i = 0; i < REFERENCE_STEPS; i++)
+		tau += density(ray->P + ((i + 0.5f)*dt)*ray->D)*dt;
+
+	return expf(-tau);
+}
+
+/* as kernel_volume_shadow_heterogeneous */
+static float transmittance_march(Ray *ray, uint *rng, float step)
+{
+	float random_jitter_offset = lcg_step_float(rng)*step;
+	float tp = 1.0f;
+	float t = 0.0f;
+	float sigma_t = density(ray->P);
+
+	for(int i = 0; i < MAX_STEPS; i++) {
+		float new_t = min(ray->t, t + random_jitter_offset + i*step);
+		float new_sigma_t = density(ray->P + new_t*ray->D);
+
+		tp *= expf(-0.5f*(sigma_t + new_sigma_t)*(new_t - t));
+		sigma_t = new_sigma_t;
+
+		t = new_t;
+		if(t == ray->t)
+			break;
+	}
+
+	return tp;
+}
+
+/* as kernel_volume_shadow_heterogeneous_tracking */
+static float transmittance_ratio_tracking(KernelGlobals *kg, VolumeStack *stack, Ray *ray, uint *rng)
+{
+	float tp = 1.0f;
+	float t = 0.0f;
+
+	for(int i = 0; i < MAX_STEPS; i++) {
+		float t_end;
+		float majorant = volume_majorant_segment(kg, stack, ray, t, &t_end, false);
+		float new_t = t_end;
+
+		if(majorant > 0.0f)
+			new_t = t - logf(1.0f - lcg_step_float(rng))/majorant;
+
+		if(new_t >= t_end) {
+			t = t_end;
+			if(t >= ray->t)
+				break;
+
+			continue;
+		}
+
+		t = new_t;
+		tp *= 1.0f - density(ray->P + t*ray->D)/majorant;
+
+		/* russian roulette */
+		if(fabsf(tp) < 0.1f) {
+			if(lcg_step_float(rng) >= fabsf(tp))
+				return 0.0f;
+
+			tp /= fabsf(tp);
+		}
+	}
+
+	return tp;
+}
+
+/* random rays through the unit cube, clipped to its bounds */
+static void rays_create(vector<Ray>& rays)
+{
+	srand(2);
+
+	for(int i = 0; i < NUM_RAYS; i++) {
+		Ray& ray = rays[i];
+		float3 a = make_float3(rand()/(float)RAND_MAX, rand()/(float)RAND_MAX, 0.0f);
+		float3 b = make_float3(rand()/(float)RAND_MAX, rand()/(float)RAND_MAX, 1.0f);
+
+		memset(&ray, 0, sizeof(ray));
+		ray.P = a;
+		ray.D = normalize(b - a);
+		ray.t = len(b - a);
+	}
+}
+
+enum Estimator {
+	ESTIMATOR_MARCH_DEFAULT = 0,
+	ESTIMATOR_MARCH_FINE,
+	ESTIMATOR_RATIO_TRACKING,
+	NUM_ESTIMATORS
+};
+
+static const char *estimator_names[NUM_ESTIMATORS] = {"march 0.1", "march 0.02", "ratio tracking"};
+
+static bool bench_estimator(KernelGlobals *kg, vector<Ray>& rays, vector<float>& reference, Estimator estimator)
+{
+	VolumeStack stack[2] = {{0, 0}, {~0, SHADER_NO_ID}};
+	double sum_error = 0.0, sum_sq_error = 0.0, sum_sq_ray_error = 0.0;
+	uint rng = lcg_init(1);
+
+	num_evaluations = 0;
+	double t = time_dt();
+
+	for(int i = 0; i < NUM_RAYS; i++) {
+		double ray_sum = 0.0;
+
+		for(int s = 0; s < NUM_SAMPLES; s++) {
+			float tp;
+
+			if(estimator == ESTIMATOR_MARCH_DEFAULT)
+				tp = transmittance_march(&rays[i], &rng, 0.1f);
+			else if(estimator == ESTIMATOR_MARCH_FINE)
+				tp = transmittance_march(&rays[i], &rng, 0.02f);
+			else
+				tp = transmittance_ratio_tracking(kg, stack, &rays[i], &rng);
+
+			double error = tp - reference[i];
+			sum_error += error;
+			sum_sq_error += error*error;
+			ray_sum += error;
+		}
+
+		sum_sq_ray_error += (ray_sum/NUM_SAMPLES)*(ray_sum/NUM_SAMPLES);
+	}
+
+	t = time_dt() - t;
+
+	int num = NUM_RAYS*NUM_SAMPLES;
+	double bias = sum_error/num;
+	double rmse = sqrt(sum_sq_error/num);
+	double variance = sum_sq_error/num - bias*bias;
+	double us_per_sample = t/num*1e6;
+
+	printf("  %-17s bias %+.5f, rmse per sample %.4f, rmse per ray %.4f, %.1f evaluations, %.3f us per sample, rmse^2 x time %.5f\n",
+		estimator_names[estimator], bias, rmse, sqrt(sum_sq_ray_error/NUM_RAYS),
+		(double)num_evaluations/num, us_per_sample, rmse*rmse*us_per_sample);
+
+	/* tracking must be unbiased up to noise */
+	if(estimator == ESTIMATOR_RATIO_TRACKING)
+		return fabs(bias) < 4.0*sqrt(variance/num) + 1e-4;
+
+	return true;
+}
+
+/* Emission
+ *
+ * SVM volume shader with emission and absorption proportional to a quadratic
+ * sphere gradient, fac = max(1 - |P|, 0)^2, in the bounds -1..1. The grid is
+ * built from kernel_shader_evaluate like in mesh_volume.cpp. */
+
+#define EMISSION_SHADER 0
+#define EMISSION_OBJECT 0
+
+struct EmissionScene {
+	vector<uint4> nodes;
+	vector<uint> shader_flag;
+	vector<uint> object_flag;
+	vector<float4> objects;
+	VolumeGrid vgrid;
+	float emission;
+	float absorption;
+};
+
+static uint encode_uchar4(uint x, uint y, uint z, uint w)
+{
+	return x | (y << 8) | (z << 16) | (w << 24);
+}
+
+static void emission_shader_build(EmissionScene& scene)
+{
+	vector<uint4>& nodes = scene.nodes;
+
+	nodes.push_back(make_uint4(NODE_SHADER_JUMP, 0, 1, 0));
+	nodes.push_back(make_uint4(NODE_GEOMETRY, NODE_GEOM_P, 0, 0));
+	nodes.push_back(make_uint4(NODE_TEX_GRADIENT, encode_uchar4(NODE_BLEND_QUADRATIC_SPHERE, 0, 3, SVM_STACK_INVALID), 0, 0));
+
+	if(scene.emission > 0.0f) {
+		uint e = __float_as_uint(scene.emission);
+		nodes.push_back(make_uint4(NODE_CLOSURE_SET_WEIGHT, e, e, e));
+		nodes.push_back(make_uint4(NODE_CLOSURE_EMISSION, 3, 0, 0));
+	}
+
+	if(scene.absorption > 0.0f) {
+		/* the absorption closure weight is the color, absorbing 1 - color */
+		uint a = __float_as_uint(1.0f - scene.absorption);
+		nodes.push_back(make_uint4(NODE_CLOSURE_SET_WEIGHT, a, a, a));
+		nodes.push_back(make_uint4(NODE_CLOSURE_VOLUME,
+			encode_uchar4(CLOSURE_VOLUME_ABSORPTION_ID, 3, SVM_STACK_INVALID, SVM_STACK_INVALID), 0, 0));
+	}
+
+	nodes.push_back(make_uint4(NODE_END, 0, 0, 0));
+}
+
+static void emission_scene_build(EmissionScene& scene, KernelGlobals& kg)
+{
+	emission_shader_build(scene);
+
+	scene.shader_flag.push_back(SD_HAS_VOLUME|SD_HETEROGENEOUS_VOLUME);
+	scene.shader_flag.push_back(0);
+	scene.object_flag.push_back(0);
+	scene.objects.resize(OBJECT_SIZE, make_float4(0.0f, 0.0f, 0.0f, 0.0f));
+
+	memset(&kg.__data, 0, sizeof(kg.__data));
+	kg.__svm_nodes.data = &scene.nodes[0];
+	kg.__svm_nodes.width = scene.nodes.size();
+	kg.__shader_flag.data = &scene.shader_flag[0];
+	kg.__shader_flag.width = scene.shader_flag.size();
+	kg.__object_flag.data = &scene.object_flag[0];
+	kg.__object_flag.width = scene.object_flag.size();
+	kg.__objects.data = &scene.objects[0];
+	kg.__objects.width = scene.objects.size();
+
+	kg.__data.integrator.sampling_pattern = SAMPLING_PATTERN_CMJ;
+	kg.__data.integrator.volume_max_steps = MAX_STEPS;
+
+	/* shader evaluation at lattice points */
+	const int res = GRID_RESOLUTION;
+	const int lres = res*2 + 1;
+	float3 lower = make_float3(-1.0f, -1.0f, -1.0f);
+	float3 upper = make_float3(1.0f, 1.0f, 1.0f);
+	float cell_size = 2.0f/res;
+	size_t num_points = lres*lres*lres;
+
+	vector<uint4> input(num_points*2);
+	vector<float4> output(num_points);
+
+	for(int z = 0; z < lres; z++) {
+		for(int y = 0; y < lres; y++) {
+			for(int x = 0; x < lres; x++) {
+				float3 P = lower + make_float3(x*0.5f, y*0.5f, z*0.5f)*cell_size;
+				size_t i = x + lres*(y + lres*z);
+
+				input[i*2] = make_uint4(__float_as_uint(P.x), __float_as_uint(P.y), __float_as_uint(P.z), 0);
+				input[i*2 + 1] = make_uint4(EMISSION_OBJECT, EMISSION_SHADER, 0, 0);
+			}
+		}
+	}
+
+	for(size_t i = 0; i < num_points; i++)
+		kernel_shader_evaluate(&kg, &input[0], &output[0], SHADER_EVAL_VOLUME, i);
+
+	vector<float> sigma_t(num_points);
+	vector<float> emission(num_points);
+
+	for(size_t i = 0; i < num_points; i++) {
+		sigma_t[i] = max(max(output[i].x, output[i].y), output[i].z);
+		emission[i] = output[i].w;
+	}
+
+	/* pack like MeshManager::device_update_volume */
+	VolumeGrid& vgrid = scene.vgrid;
+	vector<float> emission_rates;
+
+	volume_majorants_from_lattice(make_int3(res, res, res), make_float3(cell_size, cell_size, cell_size),
+		sigma_t, emission, vgrid.majorants, emission_rates);
+
+	int emission_offset = (emission_rates.size())? (int)vgrid.majorants.size(): -1;
+	vgrid.majorants.insert(vgrid.majorants.end(), emission_rates.begin(), emission_rates.end());
+
+	float max_majorant = 0.0f;
+
+	for(size_t i = 0; i < vgrid.majorants.size(); i++)
+		max_majorant = max(max_majorant, vgrid.majorants[i]);
+
+	vgrid.grid.push_back(make_float4(lower.x, lower.y, lower.z, __int_as_float(0)));
+	vgrid.grid.push_back(make_float4(upper.x, upper.y, upper.z, max_majorant));
+	vgrid.grid.push_back(make_float4((float)res, (float)res, (float)res, __int_as_float(emission_offset)));
+
+	kg.__volume_grid.data = &vgrid.grid[0];
+	kg.__volume_grid.width = vgrid.grid.size();
+	kg.__volume_majorants.data = &vgrid.majorants[0];
+	kg.__volume_majorants.width = vgrid.majorants.size();
+	kg.__data.integrator.volume_majorants = 1;
+}
+
+/* emission reaching the ray origin, with the shader in closed form */
+static float emission_reference(EmissionScene& scene, Ray *ray)
+{
+	float L = 0.0f;
+	float tau = 0.0f;
+	float dt = ray->t/REFERENCE_STEPS;
+
+	for(int i = 0; i < REFERENCE_STEPS; i++) {
+		float fac = svm_gradient(ray->P + ((i + 0.5f)*dt)*ray->D, NODE_BLEND_QUADRATIC_SPHERE);
+		float step_tau = scene.absorption*fac*dt;
+
+		/* emission over the step, attenuated by absorption up to the step
+		 * and within it */
+		L += scene.emission*fac*expf(-tau)*((step_tau > 0.0f)? (1.0f - expf(-step_tau))/(scene.absorption*fac): dt);
+		tau += step_tau;
+	}
+
+	return L;
+}
+
+/* random rays through the bounds -1..1 */
+static void emission_rays_create(vector<Ray>& rays)
+{
+	srand(4);
+
+	for(int i = 0; i < NUM_RAYS; i++) {
+		Ray& ray = rays[i];
+		float3 a = make_float3(2.0f*rand()/(float)RAND_MAX - 1.0f, 2.0f*rand()/(float)RAND_MAX - 1.0f, -1.0f);
+		float3 b = make_float3(2.0f*rand()/(float)RAND_MAX - 1.0f, 2.0f*rand()/(float)RAND_MAX - 1.0f, 1.0f);
+
+		memset(&ray, 0, sizeof(ray));
+		ray.P = a;
+		ray.D = normalize(b - a);
+		ray.t = len(b - a);
+		ray.time = 0.5f;
+	}
+}
+
+enum EmissionEstimator {
+	EMISSION_MARCH_DEFAULT = 0,
+	EMISSION_MARCH_FINE,
+	EMISSION_SPECTRAL_TRACKING,
+	NUM_EMISSION_ESTIMATORS
+};
+
+static const char *emission_estimator_names[NUM_EMISSION_ESTIMATORS] = {"march 0.2", "march 0.04", "spectral tracking"};
+
+static bool bench_emission(KernelGlobals *kg, vector<Ray>& rays, vector<float>& reference, EmissionEstimator estimator)
+{
+	double sum_error = 0.0, sum_sq_error = 0.0;
+
+	/* same step size relative to the volume size as the shadow rays */
+	kg->__data.integrator.volume_step_size = (estimator == EMISSION_MARCH_FINE)? 0.04f: 0.2f;
+
+	double t = time_dt();
+
+	for(int i = 0; i < NUM_RAYS; i++) {
+		for(int s = 0; s < NUM_SAMPLES; s++) {
+			PathState state;
+			memset(&state, 0, sizeof(state));
+			state.flag = PATH_RAY_CAMERA;
+			state.sample = s;
+			state.num_samples = NUM_SAMPLES;
+			state.rng_offset = PRNG_BASE_NUM;
+			state.rng_congruential = lcg_init(i*NUM_SAMPLES + s);
+			state.volume_stack[0].object = EMISSION_OBJECT;
+			state.volume_stack[0].shader = EMISSION_SHADER;
+			state.volume_stack[1].shader = SHADER_NO_ID;
+
+			RNG rng = i*NUM_SAMPLES + s;
+			ShaderData sd;
+			PathRadiance L;
+			float3 throughput = make_float3(1.0f, 1.0f, 1.0f);
+
+			shader_setup_from_volume(kg, &sd, &rays[i], 0);
+			path_radiance_init(&L, false);
+
+			if(estimator == EMISSION_SPECTRAL_TRACKING)
+				kernel_volume_integrate_heterogeneous_tracking(kg, &state, &rays[i], &sd, &L, &throughput, &rng);
+			else
+				kernel_volume_integrate_heterogeneous(kg, &state, &rays[i], &sd, &L, &throughput, &rng);
+
+			double error = average(L.emission) - reference[i];
+			sum_error += error;
+			sum_sq_error += error*error;
+		}
+	}
+
+	t = time_dt() - t;
+
+	int num = NUM_RAYS*NUM_SAMPLES;
+	double bias = sum_error/num;
+	double rmse = sqrt(sum_sq_error/num);
+	double variance = sum_sq_error/num - bias*bias;
+	double us_per_sample = t/num*1e6;
+
+	printf("  %-17s bias %+.5f, rmse per sample %.4f, %.3f us per sample, rmse^2 x time %.6f\n",
+		emission_estimator_names[estimator], bias, rmse, us_per_sample, rmse*rmse*us_per_sample);
+
+	/* tracking must be unbiased up to noise */
+	if(estimator == EMISSION_SPECTRAL_TRACKING)
+		return fabs(bias) < 4.0*sqrt(variance/num) + 1e-4;
+
+	return true;
+}
+
+static bool bench_emission_scene(float emission, float absorption)
+{
+	EmissionScene scene;
+	KernelGlobals kg;
+
+	scene.emission = emission;
+	scene.absorption = absorption;
+	emission_scene_build(scene, kg);
+
+	vector<Ray> rays(NUM_RAYS);
+	vector<float> reference(NUM_RAYS);
+	double mean_reference = 0.0;
+
+	emission_rays_create(rays);
+	for(int i = 0; i < NUM_RAYS; i++) {
+		reference[i] = emission_reference(scene, &rays[i]);
+		mean_reference += reference[i]/NUM_RAYS;
+	}
+
+	printf("emission %g, absorption %g, mean radiance %.4f:\n", emission, absorption, mean_reference);
+
+	bool ok = true;
+
+	for(int estimator = 0; estimator < NUM_EMISSION_ESTIMATORS; estimator++) {
+		if(!bench_emission(&kg, rays, reference, (EmissionEstimator)estimator)) {
+			fprintf(stderr, "|--* Spectral tracking emission is biased\n");
+			ok = false;
+		}
+	}
+
+	return ok;
+}
+
+int main(int argc, const char **argv)
+{
+	if(argc > 1)
+		density_scale = (float)atof(argv[1]);
+
+	VolumeGrid vgrid;
+	KernelGlobals kg;
+	grid_build(vgrid, kg);
+
+	vector<Ray> rays(NUM_RAYS);
+	vector<float> reference(NUM_RAYS);
+	double mean_reference = 0.0;
+
+	rays_create(rays);
+	for(int i = 0; i < NUM_RAYS; i++) {
+		reference[i] = transmittance_reference(&rays[i]);
+		mean_reference += reference[i]/NUM_RAYS;
+	}
+
+	printf("density scale %g, %d^3 majorant grid, %d rays, %d samples, mean transmittance %.4f:\n",
+		density_scale, GRID_RESOLUTION, NUM_RAYS, NUM_SAMPLES, mean_reference);
+
+	int error_status = 0;
+
+	int violations = grid_test_bounds(vgrid);
+	if(violations > 0) {
+		/* the lattice can miss features smaller than a cell, dilation makes this rare */
+		printf("  majorant below density at %d of 1000000 points\n", violations);
+	}
+
+	for(int estimator = 0; estimator < NUM_ESTIMATORS; estimator++) {
+		if(!bench_estimator(&kg, rays, reference, (Estimator)estimator)) {
+			fprintf(stderr, "|--* Ratio tracking is biased\n");
+			error_status = 1;
+		}
+	}
+
+	/* emission only, emission in thin and in dense smoke */
+	if(!bench_emission_scene(1.0f, 0.0f))
+		error_status = 1;
+	if(!bench_emission_scene(1.0f, 0.5f))
+		error_status = 1;
+	if(!bench_emission_scene(1.0f, 10.0f))
+		error_status = 1;
+
+	return error_status;
+}
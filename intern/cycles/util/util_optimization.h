@@ -23,7 +23,8 @@
 #if defined(__KERNEL_SSE2__)  || \
 	defined(__KERNEL_SSE3__)  || \
 	defined(__KERNEL_SSSE3__) || \
-	defined(__KERNEL_SSE41__)
+	defined(__KERNEL_SSE41__) || \
+	defined(__KERNEL_AVX__)
 	/* do nothing */
 #endif
 
@@ -118,6 +119,10 @@
 #include <smmintrin.h> /* SSE 4.1 */
 #endif
 
+#ifdef __KERNEL_AVX__
+#include <immintrin.h> /* AVX */
+#endif
+
 #else
 
 /* MinGW64 has conflicting declarations for these SSE headers in <windows.h>.
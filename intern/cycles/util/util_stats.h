@@ -17,8 +17,124 @@
 #ifndef __UTIL_STATS_H__
 #define __UTIL_STATS_H__
 
+#include <string.h>
+
+#include "util_thread.h"
+#include "util_time.h"
+#include "util_types.h"
+
 CCL_NAMESPACE_BEGIN
 
+/* Kernel Statistics
+ *
+ * Counters for the CPU kernel, only filled in when built with
+ * WITH_CYCLES_DEBUG. Each render thread counts into its own copy, which is
+ * added to the session statistics when the thread is done. */
+
+typedef enum StatsRayType {
+	STATS_RAY_CAMERA = 0,
+	STATS_RAY_INDIRECT,
+	STATS_RAY_SHADOW,
+	STATS_RAY_SUBSURFACE,
+	STATS_NUM_RAY_TYPES
+} StatsRayType;
+
+/* time in nested stages is not included in the outer stage */
+typedef enum StatsStage {
+	STATS_STAGE_INTEGRATOR = 0,
+	STATS_STAGE_INTERSECT,
+	STATS_STAGE_SHADING,
+	STATS_STAGE_VOLUME,
+	STATS_STAGE_LIGHT,
+	STATS_NUM_STAGES
+} StatsStage;
+
+#define STATS_MAX_SVM_NODES 128
+#define STATS_MAX_STAGE_DEPTH 16
+
+class KernelStats {
+public:
+	KernelStats()
+	{
+		reset();
+	}
+
+	void reset()
+	{
+		memset(rays, 0, sizeof(rays));
+		memset(svm_nodes, 0, sizeof(svm_nodes));
+		memset(stage_time, 0, sizeof(stage_time));
+
+		bvh_nodes = 0;
+		bvh_primitives = 0;
+		shader_evals = 0;
+
+		stage_depth = 0;
+		stage_start = 0.0;
+	}
+
+	void add(const KernelStats& other)
+	{
+		for(int i = 0; i < STATS_NUM_RAY_TYPES; i++)
+			rays[i] += other.rays[i];
+		for(int i = 0; i < STATS_MAX_SVM_NODES; i++)
+			svm_nodes[i] += other.svm_nodes[i];
+		for(int i = 0; i < STATS_NUM_STAGES; i++)
+			stage_time[i] += other.stage_time[i];
+
+		bvh_nodes += other.bvh_nodes;
+		bvh_primitives += other.bvh_primitives;
+		shader_evals += other.shader_evals;
+	}
+
+	uint64_t num_rays() const
+	{
+		uint64_t num = 0;
+		for(int i = 0; i < STATS_NUM_RAY_TYPES; i++)
+			num += rays[i];
+		return num;
+	}
+
+	/* stage timing, time since the last stage change goes to the current stage */
+	void stage_begin(int stage)
+	{
+		double t = time_dt();
+
+		if(stage_depth > 0 && stage_depth <= STATS_MAX_STAGE_DEPTH)
+			stage_time[stage_stack[stage_depth - 1]] += t - stage_start;
+
+		if(stage_depth < STATS_MAX_STAGE_DEPTH)
+			stage_stack[stage_depth] = stage;
+
+		stage_depth++;
+		stage_start = t;
+	}
+
+	void stage_end()
+	{
+		double t = time_dt();
+
+		stage_depth--;
+
+		if(stage_depth < STATS_MAX_STAGE_DEPTH)
+			stage_time[stage_stack[stage_depth]] += t - stage_start;
+
+		stage_start = t;
+	}
+
+	uint64_t rays[STATS_NUM_RAY_TYPES];
+	uint64_t bvh_nodes;
+	uint64_t bvh_primitives;
+	uint64_t shader_evals;
+	uint64_t svm_nodes[STATS_MAX_SVM_NODES];
+	double stage_time[STATS_NUM_STAGES];
+
+protected:
+	int stage_stack[STATS_MAX_STAGE_DEPTH];
+	int stage_depth;
+	double stage_start;
+};
+
 class Stats {
 public:
 	Stats() : mem_used(0), mem_peak(0) {}
@@ -33,8 +149,17 @@ public:
 		mem_used -= size;
 	}
 
+	/* add kernel statistics of a render thread */
+	void kernel_add(const KernelStats& stats) {
+		thread_scoped_lock lock(kernel_mutex);
+		kernel.add(stats);
+	}
+
 	size_t mem_used;
 	size_t mem_peak;
+
+	KernelStats kernel;
+	thread_mutex kernel_mutex;
 };
 
 CCL_NAMESPACE_END
@@ -0,0 +1,786 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file guardedalloc/intern/mallocn_cached_impl.c
+ *  \ingroup MEM
+ *
+ * Memory allocation which keeps track on allocated memory counters, and
+ * serves small blocks from per-thread caches of size classes.
+ *
+ * Small blocks are rounded up to a size class. Freed blocks go to a free
+ * list of the freeing thread, so most allocations don't touch any lock or
+ * the system allocator. When a thread holds too many free blocks of a class,
+ * a batch of them is returned to a global pool the other threads can refill
+ * from. New memory is requested from the system in aligned slabs. The global
+ * pool keeps its free blocks per slab, so a slab of which all blocks are back
+ * in the pool is given back to the system, except for one spare slab per size
+ * class to avoid allocating and freeing a slab over and over.
+ *
+ * Memory counters only include the requested lengths, so they match the
+ * other allocators exactly. Blocks which are too big for any size class are
+ * passed on to the system allocator, same as the lock-free allocator does.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h> /* memcpy */
+#include <stdarg.h>
+#include <sys/types.h>
+#include <pthread.h>
+
+#include "MEM_guardedalloc.h"
+
+/* to ensure strict conversions */
+#include "../../source/blender/blenlib/BLI_strict_flags.h"
+
+#include "atomic_ops.h"
+#include "mallocn_intern.h"
+
+#if defined(_MSC_VER)
+#  define MEM_THREAD_LOCAL __declspec(thread)
+#else
+#  define MEM_THREAD_LOCAL __thread
+#endif
+
+#if defined(WIN32)
+#  include <malloc.h> /* _aligned_malloc */
+#endif
+
+typedef struct MemHead {
+	/* Length of allocated memory block. */
+	size_t len;
+} MemHead;
+
+/* Size classes, in bytes including the MemHead:
+ * steps of 16 up to 256, steps of 64 up to 1024, steps of 256 up to 4096. */
+#define SIZE_CLASS_MAX 4096
+#define SIZE_CLASS_NUM (16 + 12 + 12)
+
+/* number of blocks moved between thread caches and the global pool at once */
+#define CACHE_BATCH_BYTES (32 * 1024)
+#define CACHE_BATCH_MIN 8
+/* thread caches keep at most this many batches of free blocks per class */
+#define CACHE_BATCH_MAX_LOCAL 2
+
+/* Slabs are aligned to their size, so the slab of a block is found by
+ * masking its address. The slab header is padded to keep blocks aligned. */
+#define SLAB_SIZE (64 * 1024)
+#define SLAB_HEADER_SIZE 64
+#define SLAB_FROM_BLOCK(block) ((Slab *)((uintptr_t)(block) & ~((uintptr_t)SLAB_SIZE - 1)))
+
+typedef struct FreeBlock {
+	struct FreeBlock *next;
+} FreeBlock;
+
+typedef struct ThreadCache {
+	FreeBlock *free[SIZE_CLASS_NUM];
+	unsigned int num_free[SIZE_CLASS_NUM];
+} ThreadCache;
+
+typedef struct Slab {
+	/* in the list of slabs with free blocks of the global pool */
+	struct Slab *next, *prev;
+	/* blocks of this slab which are in the global pool */
+	FreeBlock *free;
+	unsigned int num_free;
+	unsigned int num_blocks;
+} Slab;
+
+typedef struct GlobalPool {
+	pthread_mutex_t mutex;
+	/* slabs with free blocks, none of them completely free */
+	Slab *slabs;
+	/* a completely free slab which is kept instead of given back */
+	Slab *spare;
+	unsigned int num_free;
+} GlobalPool;
+
+static unsigned int totblock = 0;
+static size_t mem_in_use = 0, mmap_in_use = 0, peak_mem = 0;
+static size_t mem_reserved = 0;
+static bool malloc_debug_memset = false;
+
+static void (*error_callback)(const char *) = NULL;
+static void (*thread_lock_callback)(void) = NULL;
+static void (*thread_unlock_callback)(void) = NULL;
+
+static GlobalPool global_pools[SIZE_CLASS_NUM];
+static pthread_once_t cache_init_once = PTHREAD_ONCE_INIT;
+static pthread_key_t cache_key;
+static MEM_THREAD_LOCAL ThreadCache *thread_cache = NULL;
+
+#define MEMHEAD_FROM_PTR(ptr) (((MemHead*) vmemh) - 1)
+#define PTR_FROM_MEMHEAD(memhead) (memhead + 1)
+#define MEMHEAD_IS_MMAP(memhead) ((memhead)->len & (size_t) 1)
+
+#ifdef __GNUC__
+__attribute__ ((format(printf, 1, 2)))
+#endif
+static void print_error(const char *str, ...)
+{
+	char buf[512];
+	va_list ap;
+
+	va_start(ap, str);
+	vsnprintf(buf, sizeof(buf), str, ap);
+	va_end(ap);
+	buf[sizeof(buf) - 1] = '\0';
+
+	if (error_callback) {
+		error_callback(buf);
+	}
+}
+
+#if defined(WIN32)
+static void mem_lock_thread(void)
+{
+	if (thread_lock_callback)
+		thread_lock_callback();
+}
+
+static void mem_unlock_thread(void)
+{
+	if (thread_unlock_callback)
+		thread_unlock_callback();
+}
+#endif
+
+static void update_peak_memory(void)
+{
+	/* TODO(sergey): Not strictly speaking thread-safe. */
+	peak_mem = mem_in_use > peak_mem ? mem_in_use : peak_mem;
+}
+
+/* -------------------------------------------------------------------- */
+/* Size classes and caches */
+
+/* size class of a block of given size (MemHead included), -1 if too big */
+static int size_class_index(size_t size)
+{
+	if (size <= 256) {
+		return (int)((size + 15) / 16) - 1;
+	}
+	else if (size <= 1024) {
+		return 16 + (int)((size - 256 + 63) / 64) - 1;
+	}
+	else if (size <= SIZE_CLASS_MAX) {
+		return 28 + (int)((size - 1024 + 255) / 256) - 1;
+	}
+	return -1;
+}
+
+static size_t size_class_size(int index)
+{
+	if (index < 16) {
+		return (size_t)(index + 1) * 16;
+	}
+	else if (index < 28) {
+		return 256 + (size_t)(index - 16 + 1) * 64;
+	}
+	return 1024 + (size_t)(index - 28 + 1) * 256;
+}
+
+static unsigned int size_class_batch(int index)
+{
+	size_t batch = CACHE_BATCH_BYTES / size_class_size(index);
+	return (unsigned int)(batch < CACHE_BATCH_MIN ? CACHE_BATCH_MIN : batch);
+}
+
+static void *slab_alloc(void)
+{
+#if defined(WIN32)
+	return _aligned_malloc(SLAB_SIZE, SLAB_SIZE);
+#else
+	void *slab;
+	return (posix_memalign(&slab, SLAB_SIZE, SLAB_SIZE) == 0) ? slab : NULL;
+#endif
+}
+
+static void slab_free(Slab *slab)
+{
+#if defined(WIN32)
+	_aligned_free(slab);
+#else
+	free(slab);
+#endif
+	atomic_sub_z(&mem_reserved, SLAB_SIZE);
+}
+
+static void pool_slab_link(GlobalPool *pool, Slab *slab)
+{
+	slab->prev = NULL;
+	slab->next = pool->slabs;
+	if (pool->slabs) {
+		pool->slabs->prev = slab;
+	}
+	pool->slabs = slab;
+}
+
+static void pool_slab_unlink(GlobalPool *pool, Slab *slab)
+{
+	if (slab->prev) {
+		slab->prev->next = slab->next;
+	}
+	else {
+		pool->slabs = slab->next;
+	}
+	if (slab->next) {
+		slab->next->prev = slab->prev;
+	}
+}
+
+/* give a free block back to its slab, the slab is given back to the system
+ * when all its blocks are free. Must be called with the pool locked */
+static void pool_put(GlobalPool *pool, FreeBlock *block)
+{
+	Slab *slab = SLAB_FROM_BLOCK(block);
+
+	if (slab->num_free == 0) {
+		pool_slab_link(pool, slab);
+	}
+
+	block->next = slab->free;
+	slab->free = block;
+	slab->num_free++;
+	pool->num_free++;
+
+	if (slab->num_free == slab->num_blocks) {
+		pool_slab_unlink(pool, slab);
+		pool->num_free -= slab->num_blocks;
+
+		if (pool->spare == NULL) {
+			pool->spare = slab;
+		}
+		else {
+			slab_free(slab);
+		}
+	}
+}
+
+static void pool_put_list(GlobalPool *pool, FreeBlock *block)
+{
+	pthread_mutex_lock(&pool->mutex);
+	while (block) {
+		FreeBlock *next = block->next;
+		pool_put(pool, block);
+		block = next;
+	}
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+/* new slab with all blocks free, NULL when out of memory */
+static Slab *slab_create(int index)
+{
+	const size_t size = size_class_size(index);
+	Slab *slab = slab_alloc();
+	char *blocks;
+	unsigned int num;
+
+	if (slab == NULL) {
+		return NULL;
+	}
+
+	atomic_add_z(&mem_reserved, SLAB_SIZE);
+
+	slab->num_blocks = (unsigned int)((SLAB_SIZE - SLAB_HEADER_SIZE) / size);
+	slab->num_free = slab->num_blocks;
+	slab->free = NULL;
+
+	/* first block at the head of the list, neighboring allocations are close */
+	blocks = (char *)slab + SLAB_HEADER_SIZE;
+	for (num = slab->num_blocks; num > 0; num--) {
+		FreeBlock *block = (FreeBlock *)(blocks + size * (num - 1));
+		block->next = slab->free;
+		slab->free = block;
+	}
+
+	return slab;
+}
+
+static void thread_cache_flush(ThreadCache *cache)
+{
+	int i;
+
+	for (i = 0; i < SIZE_CLASS_NUM; i++) {
+		if (cache->free[i]) {
+			pool_put_list(&global_pools[i], cache->free[i]);
+
+			cache->free[i] = NULL;
+			cache->num_free[i] = 0;
+		}
+	}
+}
+
+/* called when a thread exits, give its free blocks to the other threads */
+static void thread_cache_free(void *cache_v)
+{
+	ThreadCache *cache = cache_v;
+
+	thread_cache_flush(cache);
+	free(cache);
+
+	/* allocations from other destructors will create a new cache */
+	thread_cache = NULL;
+}
+
+static void cache_init(void)
+{
+	int i;
+
+	for (i = 0; i < SIZE_CLASS_NUM; i++) {
+		pthread_mutex_init(&global_pools[i].mutex, NULL);
+	}
+
+	pthread_key_create(&cache_key, thread_cache_free);
+}
+
+static ThreadCache *thread_cache_get(void)
+{
+	ThreadCache *cache = thread_cache;
+
+	if (cache == NULL) {
+		pthread_once(&cache_init_once, cache_init);
+
+		cache = calloc(1, sizeof(ThreadCache));
+		if (cache == NULL) {
+			return NULL;
+		}
+
+		pthread_setspecific(cache_key, cache);
+		thread_cache = cache;
+	}
+
+	return cache;
+}
+
+/* refill the thread cache from the global pool, a new slab is added to the
+ * pool when it has no free blocks */
+static bool thread_cache_refill(ThreadCache *cache, int index)
+{
+	GlobalPool *pool = &global_pools[index];
+	const unsigned int batch = size_class_batch(index);
+	FreeBlock *first = NULL;
+	unsigned int num = 0;
+
+	pthread_mutex_lock(&pool->mutex);
+
+	if (pool->slabs == NULL) {
+		Slab *slab = pool->spare;
+
+		if (slab) {
+			pool->spare = NULL;
+		}
+		else if ((slab = slab_create(index)) == NULL) {
+			pthread_mutex_unlock(&pool->mutex);
+			return false;
+		}
+
+		pool_slab_link(pool, slab);
+		pool->num_free += slab->num_free;
+	}
+
+	while (num < batch && pool->slabs) {
+		Slab *slab = pool->slabs;
+		FreeBlock *block = slab->free;
+
+		slab->free = block->next;
+		block->next = first;
+		first = block;
+		num++;
+
+		if (--slab->num_free == 0) {
+			pool_slab_unlink(pool, slab);
+		}
+	}
+
+	pool->num_free -= num;
+
+	pthread_mutex_unlock(&pool->mutex);
+
+	cache->free[index] = first;
+	cache->num_free[index] = num;
+
+	return true;
+}
+
+/* give one batch of free blocks back to the global pool */
+static void thread_cache_release(ThreadCache *cache, int index)
+{
+	const unsigned int batch = size_class_batch(index);
+	FreeBlock *first = cache->free[index], *last = first;
+	unsigned int num = 1;
+
+	while (num < batch) {
+		last = last->next;
+		num++;
+	}
+
+	cache->free[index] = last->next;
+	cache->num_free[index] -= num;
+
+	last->next = NULL;
+	pool_put_list(&global_pools[index], first);
+}
+
+static MemHead *cached_block_alloc(size_t len)
+{
+	const int index = size_class_index(len + sizeof(MemHead));
+	ThreadCache *cache;
+	FreeBlock *block;
+
+	if (index == -1 || (cache = thread_cache_get()) == NULL) {
+		return malloc(len + sizeof(MemHead));
+	}
+
+	if (cache->free[index] == NULL) {
+		if (!thread_cache_refill(cache, index)) {
+			return NULL;
+		}
+	}
+
+	block = cache->free[index];
+	cache->free[index] = block->next;
+	cache->num_free[index]--;
+
+	return (MemHead *)block;
+}
+
+static void cached_block_free(MemHead *memh, size_t len)
+{
+	const int index = size_class_index(len + sizeof(MemHead));
+	ThreadCache *cache;
+	FreeBlock *block;
+
+	if (index == -1 || (cache = thread_cache_get()) == NULL) {
+		free(memh);
+		return;
+	}
+
+	block = (FreeBlock *)memh;
+	block->next = cache->free[index];
+	cache->free[index] = block;
+	cache->num_free[index]++;
+
+	if (cache->num_free[index] > CACHE_BATCH_MAX_LOCAL * size_class_batch(index)) {
+		thread_cache_release(cache, index);
+	}
+}
+
+/* -------------------------------------------------------------------- */
+/* Allocator API */
+
+size_t MEM_cached_allocN_len(const void *vmemh)
+{
+	if (vmemh) {
+		return MEMHEAD_FROM_PTR(vmemh)->len & ~((size_t) 1);
+	}
+	else {
+		return 0;
+	}
+}
+
+void MEM_cached_freeN(void *vmemh)
+{
+	MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+	size_t len = MEM_cached_allocN_len(vmemh);
+
+	atomic_sub_u(&totblock, 1);
+	atomic_sub_z(&mem_in_use, len);
+
+	if (MEMHEAD_IS_MMAP(memh)) {
+		atomic_sub_z(&mmap_in_use, len);
+#if defined(WIN32)
+		/* our windows mmap implementation is not thread safe */
+		mem_lock_thread();
+#endif
+		if (munmap(memh, len + sizeof(MemHead)))
+			printf("Couldn't unmap memory\n");
+#if defined(WIN32)
+		mem_unlock_thread();
+#endif
+	}
+	else {
+		if (malloc_debug_memset && len) {
+			memset(memh + 1, 255, len);
+		}
+		cached_block_free(memh, len);
+	}
+}
+
+void *MEM_cached_dupallocN(const void *vmemh)
+{
+	void *newp = NULL;
+	if (vmemh) {
+		MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+		const size_t prev_size = MEM_allocN_len(vmemh);
+		if (MEMHEAD_IS_MMAP(memh)) {
+			newp = MEM_cached_mapallocN(prev_size, "dupli_mapalloc");
+		}
+		else {
+			newp = MEM_cached_mallocN(prev_size, "dupli_malloc");
+		}
+		memcpy(newp, vmemh, prev_size);
+	}
+	return newp;
+}
+
+void *MEM_cached_reallocN_id(void *vmemh, size_t len, const char *str)
+{
+	void *newp = NULL;
+
+	if (vmemh) {
+		size_t old_len = MEM_allocN_len(vmemh);
+
+		newp = MEM_cached_mallocN(len, "realloc");
+		if (newp) {
+			if (len < old_len) {
+				/* shrink */
+				memcpy(newp, vmemh, len);
+			}
+			else {
+				/* grow (or remain same size) */
+				memcpy(newp, vmemh, old_len);
+			}
+		}
+
+		MEM_cached_freeN(vmemh);
+	}
+	else {
+		newp = MEM_cached_mallocN(len, str);
+	}
+
+	return newp;
+}
+
+void *MEM_cached_recallocN_id(void *vmemh, size_t len, const char *str)
+{
+	void *newp = NULL;
+
+	if (vmemh) {
+		size_t old_len = MEM_allocN_len(vmemh);
+
+		newp = MEM_cached_mallocN(len, "recalloc");
+		if (newp) {
+			if (len < old_len) {
+				/* shrink */
+				memcpy(newp, vmemh, len);
+			}
+			else {
+				memcpy(newp, vmemh, old_len);
+
+				if (len > old_len) {
+					/* grow */
+					/* zero new bytes */
+					memset(((char *)newp) + old_len, 0, len - old_len);
+				}
+			}
+		}
+
+		MEM_cached_freeN(vmemh);
+	}
+	else {
+		newp = MEM_cached_callocN(len, str);
+	}
+
+	return newp;
+}
+
+void *MEM_cached_callocN(size_t len, const char *str)
+{
+	MemHead *memh;
+
+	len = SIZET_ALIGN_4(len);
+
+	if (size_class_index(len + sizeof(MemHead)) == -1) {
+		/* let the system hand out zeroed pages for big blocks */
+		memh = (MemHead *)calloc(1, len + sizeof(MemHead));
+	}
+	else {
+		memh = cached_block_alloc(len);
+		if (memh) {
+			memset(memh + 1, 0, len);
+		}
+	}
+
+	if (memh) {
+		memh->len = len;
+		atomic_add_u(&totblock, 1);
+		atomic_add_z(&mem_in_use, len);
+		update_peak_memory();
+
+		return PTR_FROM_MEMHEAD(memh);
+	}
+	print_error("Calloc returns null: len=" SIZET_FORMAT " in %s, total %u\n",
+	            SIZET_ARG(len), str, (unsigned int) mem_in_use);
+	return NULL;
+}
+
+void *MEM_cached_mallocN(size_t len, const char *str)
+{
+	MemHead *memh;
+
+	len = SIZET_ALIGN_4(len);
+
+	memh = cached_block_alloc(len);
+
+	if (memh) {
+		if (malloc_debug_memset && len) {
+			memset(memh + 1, 255, len);
+		}
+
+		memh->len = len;
+		atomic_add_u(&totblock, 1);
+		atomic_add_z(&mem_in_use, len);
+		update_peak_memory();
+
+		return PTR_FROM_MEMHEAD(memh);
+	}
+	print_error("Malloc returns null: len=" SIZET_FORMAT " in %s, total %u\n",
+	            SIZET_ARG(len), str, (unsigned int) mem_in_use);
+	return NULL;
+}
+
+void *MEM_cached_mapallocN(size_t len, const char *str)
+{
+	MemHead *memh;
+
+	/* on 64 bit, simply use calloc instead, as mmap does not support
+	 * allocating > 4 GB on Windows. the only reason mapalloc exists
+	 * is to get around address space limitations in 32 bit OSes. */
+	if(sizeof(void*) >= 8)
+		return MEM_cached_callocN(len, str);
+
+	len = SIZET_ALIGN_4(len);
+
+#if defined(WIN32)
+	/* our windows mmap implementation is not thread safe */
+	mem_lock_thread();
+#endif
+	memh = mmap(NULL, len + sizeof(MemHead),
+	            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0);
+#if defined(WIN32)
+	mem_unlock_thread();
+#endif
+
+	if (memh != (MemHead *)-1) {
+		memh->len = len | (size_t) 1;
+		atomic_add_u(&totblock, 1);
+		atomic_add_z(&mem_in_use, len);
+		atomic_add_z(&mmap_in_use, len);
+
+		update_peak_memory();
+		peak_mem = mmap_in_use > peak_mem ? mmap_in_use : peak_mem;
+
+		return PTR_FROM_MEMHEAD(memh);
+	}
+	print_error("Mapalloc returns null, fallback to regular malloc: "
+	            "len=" SIZET_FORMAT " in %s, total %u\n",
+	            SIZET_ARG(len), str, (unsigned int) mmap_in_use);
+	return MEM_cached_callocN(len, str);
+}
+
+void MEM_cached_printmemlist_pydict(void)
+{
+}
+
+void MEM_cached_printmemlist(void)
+{
+}
+
+/* unused */
+void MEM_cached_callbackmemlist(void (*func)(void *))
+{
+	(void) func;  /* Ignored. */
+}
+
+void MEM_cached_printmemlist_stats(void)
+{
+	printf("\ntotal memory len: %.3f MB\n",
+	       (double)mem_in_use / (double)(1024 * 1024));
+	printf("peak memory len: %.3f MB\n",
+	       (double)peak_mem / (double)(1024 * 1024));
+	printf("small block cache reserved: %.3f MB\n",
+	       (double)mem_reserved / (double)(1024 * 1024));
+	printf("\nFor more detailed per-block statistics run Blender with memory debugging command line argument.\n");
+
+#ifdef HAVE_MALLOC_STATS
+	printf("System Statistics:\n");
+	malloc_stats();
+#endif
+}
+
+void MEM_cached_set_error_callback(void (*func)(const char *))
+{
+	error_callback = func;
+}
+
+bool MEM_cached_check_memory_integrity(void)
+{
+	return true;
+}
+
+void MEM_cached_set_lock_callback(void (*lock)(void), void (*unlock)(void))
+{
+	thread_lock_callback = lock;
+	thread_unlock_callback = unlock;
+}
+
+void MEM_cached_set_memory_debug(void)
+{
+	malloc_debug_memset = true;
+}
+
+uintptr_t MEM_cached_get_memory_in_use(void)
+{
+	return mem_in_use;
+}
+
+uintptr_t MEM_cached_get_mapped_memory_in_use(void)
+{
+	return mmap_in_use;
+}
+
+unsigned int MEM_cached_get_memory_blocks_in_use(void)
+{
+	return totblock;
+}
+
+/* dummy */
+void MEM_cached_reset_peak_memory(void)
+{
+	peak_mem = 0;
+}
+
+uintptr_t MEM_cached_get_peak_memory(void)
+{
+	return peak_mem;
+}
+
+#ifndef NDEBUG
+const char *MEM_cached_name_ptr(void *vmemh)
+{
+	if (vmemh) {
+		return "unknown block name ptr";
+	}
+	else {
+		return "MEM_cached_name_ptr(NULL)";
+	}
+}
+#endif  /* NDEBUG */
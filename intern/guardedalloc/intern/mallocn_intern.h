@@ -129,4 +129,30 @@ uintptr_t MEM_guarded_get_peak_memory(void) ATTR_WARN_UNUSED_RESULT;
 const char *MEM_guarded_name_ptr(void *vmemh);
 #endif
 
+/* Prototypes for thread-cached allocator functions */
+size_t MEM_cached_allocN_len(const void *vmemh) ATTR_WARN_UNUSED_RESULT;
+void MEM_cached_freeN(void *vmemh);
+void *MEM_cached_dupallocN(const void *vmemh) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+void *MEM_cached_reallocN_id(void *vmemh, size_t len, const char *UNUSED(str)) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_ALLOC_SIZE(2);
+void *MEM_cached_recallocN_id(void *vmemh, size_t len, const char *UNUSED(str)) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_ALLOC_SIZE(2);
+void *MEM_cached_callocN(size_t len, const char *UNUSED(str)) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_ALLOC_SIZE(1) ATTR_NONNULL(2);
+void *MEM_cached_mallocN(size_t len, const char *UNUSED(str)) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_ALLOC_SIZE(1) ATTR_NONNULL(2);
+void *MEM_cached_mapallocN(size_t len, const char *UNUSED(str)) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_ALLOC_SIZE(1) ATTR_NONNULL(2);
+void MEM_cached_printmemlist_pydict(void);
+void MEM_cached_printmemlist(void);
+void MEM_cached_callbackmemlist(void (*func)(void *));
+void MEM_cached_printmemlist_stats(void);
+void MEM_cached_set_error_callback(void (*func)(const char *));
+bool MEM_cached_check_memory_integrity(void);
+void MEM_cached_set_lock_callback(void (*lock)(void), void (*unlock)(void));
+void MEM_cached_set_memory_debug(void);
+uintptr_t MEM_cached_get_memory_in_use(void);
+uintptr_t MEM_cached_get_mapped_memory_in_use(void);
+unsigned int MEM_cached_get_memory_blocks_in_use(void);
+void MEM_cached_reset_peak_memory(void);
+uintptr_t MEM_cached_get_peak_memory(void) ATTR_WARN_UNUSED_RESULT;
+#ifndef NDEBUG
+const char *MEM_cached_name_ptr(void *vmemh);
+#endif
+
 #endif  /* __MALLOCN_INTERN_H__ */
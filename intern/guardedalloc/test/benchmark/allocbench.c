@@ -0,0 +1,253 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/**
+ * Compare allocator backends on allocation patterns similar to loading a
+ * big .blend file (many long living blocks of mixed sizes, allocated from
+ * one thread) and evaluating a modifier stack (many threads allocating and
+ * freeing short living blocks, some freed from another thread).
+ *
+ * Also verifies memory counters go back to zero with every backend, and
+ * reports how much memory the system allocator still hands out to the
+ * backend after all blocks of the file load are freed (glibc only).
+ */
+
+/* To compile run:
+ * gcc -O2 -I../../ -I../../../atomic/ allocbench.c ../../intern/mallocn*.c -lpthread -o allocbench
+ *
+ * Usage: allocbench [lockfree|cached|guarded] [num_threads]
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sys/time.h>
+#ifdef __GLIBC__
+#  include <malloc.h>
+#endif
+
+#include "MEM_guardedalloc.h"
+
+/* blocks kept alive by the file loading test */
+#define NUM_FILE_BLOCKS (2 * 1000 * 1000)
+/* allocations per thread in the modifier stack test */
+#define NUM_EVAL_ITERATIONS (4 * 1000 * 1000)
+#define NUM_EVAL_LIVE 256
+
+static double time_now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (double)tv.tv_sec + (double)tv.tv_usec * 1e-6;
+}
+
+/* bytes the system allocator has handed out and not got back, -1 if unknown */
+static double system_memory_in_use(void)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+	struct mallinfo2 info = mallinfo2();
+	return (double)(info.uordblks + info.hblkhd);
+#elif defined(__GLIBC__)
+	struct mallinfo info = mallinfo();
+	return (double)(unsigned int)info.uordblks + (double)(unsigned int)info.hblkhd;
+#else
+	return -1.0;
+#endif
+}
+
+/* small fast random numbers, different sequence for each thread */
+static unsigned int rand_next(unsigned int *state)
+{
+	*state = *state * 1103515245u + 12345u;
+	return *state >> 8;
+}
+
+/* mostly small blocks, like DNA structs, listbase links and custom data
+ * layers of small meshes, with an occasional big one */
+static size_t rand_size(unsigned int *state)
+{
+	unsigned int r = rand_next(state);
+
+	if (r % 64 == 0) {
+		return 4096 + r % (64 * 1024);
+	}
+	else if (r % 8 == 0) {
+		return 256 + r % 2048;
+	}
+	return 8 + r % 248;
+}
+
+/* returns false when most of the freed memory is still held by the backend */
+static int bench_file_load(void)
+{
+	double system_before = system_memory_in_use();
+	void **blocks = malloc(sizeof(void *) * NUM_FILE_BLOCKS);
+	unsigned int state = 1;
+	double t, loaded, kept;
+	int i;
+
+	t = time_now();
+	for (i = 0; i < NUM_FILE_BLOCKS; i++) {
+		blocks[i] = MEM_mallocN(rand_size(&state), "file block");
+	}
+	loaded = (double)MEM_get_memory_in_use();
+	printf("  file load: alloc %.3fs, %.2f MB in use, ", time_now() - t, loaded / (1024.0 * 1024.0));
+
+	t = time_now();
+	for (i = 0; i < NUM_FILE_BLOCKS; i++) {
+		MEM_freeN(blocks[i]);
+	}
+	printf("free %.3fs\n", time_now() - t);
+
+	free(blocks);
+
+	/* freed blocks kept in caches and pools of the backend */
+	if (system_before < 0.0) {
+		return 1;
+	}
+	kept = system_memory_in_use() - system_before;
+	printf("  file load: %.2f MB still allocated from the system after freeing\n", kept / (1024.0 * 1024.0));
+
+	return kept < loaded * 0.1;
+}
+
+typedef struct EvalThread {
+	pthread_t thread;
+	int id;
+	/* blocks handed over to the next thread, to be freed there */
+	void **handover;
+} EvalThread;
+
+static void *bench_eval_thread(void *data)
+{
+	EvalThread *thread = data;
+	void *live[NUM_EVAL_LIVE];
+	unsigned int state = (unsigned int)thread->id * 7919u + 1u;
+	int i;
+
+	memset(live, 0, sizeof(live));
+
+	for (i = 0; i < NUM_EVAL_ITERATIONS; i++) {
+		int slot = (int)(rand_next(&state) % NUM_EVAL_LIVE);
+
+		if (live[slot]) {
+			MEM_freeN(live[slot]);
+		}
+		live[slot] = MEM_mallocN(rand_size(&state), "eval block");
+	}
+
+	/* leave half of the blocks to be freed by another thread */
+	for (i = 0; i < NUM_EVAL_LIVE; i++) {
+		if (i % 2) {
+			thread->handover[i] = live[i];
+		}
+		else {
+			MEM_freeN(live[i]);
+		}
+	}
+
+	return NULL;
+}
+
+static void bench_modifier_stack(int num_threads)
+{
+	EvalThread *threads = calloc((size_t)num_threads, sizeof(EvalThread));
+	double t;
+	int i, j;
+
+	for (i = 0; i < num_threads; i++) {
+		threads[i].id = i;
+		threads[i].handover = calloc(NUM_EVAL_LIVE, sizeof(void *));
+	}
+
+	t = time_now();
+	for (i = 0; i < num_threads; i++) {
+		pthread_create(&threads[i].thread, NULL, bench_eval_thread, &threads[i]);
+	}
+	for (i = 0; i < num_threads; i++) {
+		pthread_join(threads[i].thread, NULL);
+	}
+	for (i = 0; i < num_threads; i++) {
+		for (j = 0; j < NUM_EVAL_LIVE; j++) {
+			if (threads[i].handover[j]) {
+				MEM_freeN(threads[i].handover[j]);
+			}
+		}
+		free(threads[i].handover);
+	}
+	t = time_now() - t;
+
+	printf("  modifier stack: %d threads, %.3fs, %.2f M allocations/s\n",
+	       num_threads, t, (double)num_threads * NUM_EVAL_ITERATIONS / t * 1e-6);
+
+	free(threads);
+}
+
+/* the guarded allocator is only thread safe with a lock, like
+ * BLI_begin_threaded_malloc sets */
+static pthread_mutex_t malloc_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void lock_malloc(void)
+{
+	pthread_mutex_lock(&malloc_mutex);
+}
+
+static void unlock_malloc(void)
+{
+	pthread_mutex_unlock(&malloc_mutex);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *backend = (argc > 1) ? argv[1] : "lockfree";
+	int num_threads = (argc > 2) ? atoi(argv[2]) : 4;
+	int error_status = 0;
+
+	if (strcmp(backend, "cached") == 0) {
+		MEM_use_cached_allocator();
+	}
+	else if (strcmp(backend, "guarded") == 0) {
+		MEM_use_guarded_allocator();
+		MEM_set_lock_callback(lock_malloc, unlock_malloc);
+	}
+	else if (strcmp(backend, "lockfree") != 0) {
+		fprintf(stderr, "Unknown allocator '%s'\n", backend);
+		return 1;
+	}
+
+	printf("%s allocator:\n", backend);
+
+	if (!bench_file_load()) {
+		fprintf(stderr, "|--* Memory of freed blocks not given back to the system\n");
+		error_status = 1;
+	}
+	bench_modifier_stack(1);
+	if (num_threads > 1) {
+		bench_modifier_stack(num_threads);
+	}
+
+	if (MEM_get_memory_in_use() != 0 || MEM_get_memory_blocks_in_use() != 0) {
+		fprintf(stderr, "|--* Memory counters not zero after freeing all blocks\n");
+		error_status = 1;
+	}
+
+	return error_status;
+}
@@ -141,7 +141,16 @@ void DAG_editors_update_cb(void (*id_func)(struct Main *bmain, struct ID *id),
 
 /* ** Threaded update ** */
 
-/* Initialize the DAG for threaded update. */
+/* Each object is updated in separate components, so dependencies on only
+ * the transform of an object don't need to wait for its geometry or pose. */
+typedef enum eDagComponentType {
+	DAG_COMPONENT_TRANSFORM = 0,  /* object matrix, OB_RECALC_OB */
+	DAG_COMPONENT_GEOMETRY  = 1,  /* object data, OB_RECALC_DATA */
+	DAG_COMPONENT_POSE      = 2,  /* object data of armatures, OB_RECALC_DATA */
+} eDagComponentType;
+
+/* Initialize the DAG for threaded update, func is called for every component
+ * which is ready to be updated. */
 void DAG_threaded_update_begin(struct Scene *scene,
                                void (*func)(void *node, void *user_data),
                                void *user_data);
@@ -158,6 +167,9 @@ void DAG_print_dependencies(struct Main *bmain, struct Scene *scene, struct Obje
 
 struct Object *DAG_get_node_object(void *node_v);
 const char *DAG_get_node_name(void *node_v);
+void *DAG_get_component_node(void *component_v);
+eDagComponentType DAG_get_component_type(void *component_v);
+const char *DAG_get_component_type_name(eDagComponentType type);
 short DAG_get_eval_flags_for_object(struct Scene *scene, void *object);
 bool DAG_is_acyclic(struct Scene *scene);
 
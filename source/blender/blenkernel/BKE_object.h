@@ -164,6 +164,10 @@ void BKE_object_tfm_protected_restore(struct Object *ob,
                                       const ObjectTfmProtectedChannels *obtfm,
                                       const short protectflag);
 
+void BKE_object_handle_update_transform(struct Scene *scene, struct Object *ob,
+                                        struct RigidBodyWorld *rbw);
+void BKE_object_handle_update_data(struct EvaluationContext *eval_ctx,
+                                   struct Scene *scene, struct Object *ob);
 void BKE_object_handle_update(struct EvaluationContext *eval_ctx, struct Scene *scene, struct Object *ob);
 void BKE_object_handle_update_ex(struct EvaluationContext *eval_ctx,
                                  struct Scene *scene, struct Object *ob,
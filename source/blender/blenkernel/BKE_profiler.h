@@ -0,0 +1,96 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+#ifndef __BKE_PROFILER_H__
+#define __BKE_PROFILER_H__
+
+/** \file BKE_profiler.h
+ *  \ingroup bke
+ *  \brief Records timing of scene updates.
+ *
+ * When enabled, every #BKE_scene_update_for_newframe records one event per
+ * evaluated object component and modifier, with the thread it ran on and how
+ * long it waited in the task queue after its dependencies were done. Point
+ * cache reads are recorded as hits or misses.
+ *
+ * Events are kept until cleared, and can be written out in the Chrome trace
+ * format (load in chrome://tracing) or read from Python (bpy.app.profiler).
+ */
+
+#include "BLI_sys_types.h" /* for bool */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum eProfileEventType {
+	PROFILE_EVENT_FRAME             = 0,
+	PROFILE_EVENT_OBJECT_TRANSFORM  = 1,
+	PROFILE_EVENT_OBJECT_GEOMETRY   = 2,
+	PROFILE_EVENT_OBJECT_POSE       = 3,
+	PROFILE_EVENT_MODIFIER          = 4,
+	PROFILE_EVENT_CACHE_HIT         = 5,
+	PROFILE_EVENT_CACHE_MISS        = 6,
+} eProfileEventType;
+
+#define PROFILE_EVENT_NAME_MAX 128
+
+typedef struct ProfileEvent {
+	/* object name, "object/modifier" for modifiers */
+	char name[PROFILE_EVENT_NAME_MAX];
+	short type;
+	int frame;
+	int thread_id;
+	/* seconds, relative to the moment the profiler was enabled */
+	double start_time;
+	double duration;
+	/* time spent waiting for a thread after all dependencies were evaluated */
+	double wait_time;
+} ProfileEvent;
+
+void BKE_profiler_exit(void);
+
+void BKE_profiler_enable(bool enable);
+bool BKE_profiler_is_enabled(void);
+void BKE_profiler_clear(void);
+
+/* current time in the profiler's time base, 0.0 when disabled */
+double BKE_profiler_time(void);
+
+void BKE_profiler_frame_begin(int frame);
+void BKE_profiler_frame_end(void);
+
+/* add an event which started at start_time and ends now, thread safe */
+void BKE_profiler_event_add(eProfileEventType type, const char *name, const char *subname,
+                            double start_time, double wait_time);
+void BKE_profiler_cache_access(const char *name, bool hit);
+
+/* copy of the events, events are added from other threads while a render job
+ * updates the scene. Free with MEM_freeN, NULL when there are no events */
+ProfileEvent *BKE_profiler_events_copy(int *r_totevent);
+const char *BKE_profiler_event_type_name(eProfileEventType type);
+
+bool BKE_profiler_write_trace(const char *filepath);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __BKE_PROFILER_H__ */
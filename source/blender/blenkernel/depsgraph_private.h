@@ -58,6 +58,23 @@
 
 #define DAGQUEUEALLOC 50
 
+/* Components of a node for threaded update:
+ * the object transform is evaluated first, then its data. */
+#define DAG_NODE_COMPONENT_TRANSFORM  0
+#define DAG_NODE_COMPONENT_DATA       1
+#define DAG_NUM_NODE_COMPONENTS       2
+
+typedef struct DagNodeComponent {
+	struct DagNode *node;
+	short type;                    /* eDagComponentType */
+	uint32_t num_pending_parents;  /* number of parent components which are not updated yet
+	                                * this component has got.
+	                                * Used by threaded update for faster detect whether component could be
+	                                * updated aready.
+	                                */
+	bool scheduled;
+} DagNodeComponent;
+
 enum {
 	DAG_WHITE = 0,
 	DAG_GRAY = 1,
@@ -93,13 +110,9 @@ typedef struct DagNode {
 	struct DagAdjList *parent;
 	struct DagNode *next;
 
-	/* Threaded evaluation routines */
-	uint32_t num_pending_parents;  /* number of parents which are not updated yet
-	                                * this node has got.
-	                                * Used by threaded update for faster detect whether node could be
-	                                * updated aready.
-	                                */
-	bool scheduled;
+	/* Threaded evaluation routines, node is evaluated in separate components
+	 * (transform, then geometry or pose) each having its own dependencies. */
+	struct DagNodeComponent components[DAG_NUM_NODE_COMPONENTS];
 
 	/* Runtime flags mainly used to determine which extra data is to be evaluated
 	 * during object_handle_update(). Such an extra data is what depends on the
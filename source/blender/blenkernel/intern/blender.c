@@ -77,6 +77,7 @@
 #include "BKE_library.h"
 #include "BKE_main.h"
 #include "BKE_node.h"
+#include "BKE_profiler.h"
 #include "BKE_report.h"
 #include "BKE_scene.h"
 #include "BKE_screen.h"
@@ -121,6 +122,7 @@ void free_blender(void)
 	IMB_exit();
 	BKE_images_exit();
 	DAG_exit();
+	BKE_profiler_exit();
 
 	BKE_brush_system_exit();
 
@@ -309,11 +309,14 @@ DagForest *dag_init(void)
 }
 
 /* isdata = object data... */
+/* istransform = drivers are evaluated together with the object transform (the object's own AnimData),
+ * so the transform has to wait for the targets in threaded update, even when the driven property is data */
 /* XXX this needs to be extended to be more flexible (so that not only objects are evaluated via depsgraph)... */
-static void dag_add_driver_relation(AnimData *adt, DagForest *dag, DagNode *node, int isdata)
+static void dag_add_driver_relation(AnimData *adt, DagForest *dag, DagNode *node, int isdata, int istransform)
 {
 	FCurve *fcu;
 	DagNode *node1;
+	short rel;
 	
 	for (fcu = adt->drivers.first; fcu; fcu = fcu->next) {
 		ChannelDriver *driver = fcu->driver;
@@ -338,14 +341,20 @@ static void dag_add_driver_relation(AnimData *adt, DagForest *dag, DagNode *node
 						    ( ((dtar->rna_path) && strstr(dtar->rna_path, "pose.bones[")) ||
 						      ((dtar->flag & DTAR_FLAG_STRUCT_REF) && (dtar->pchan_name[0])) ))
 						{
-							dag_add_relation(dag, node1, node, isdata_fcu ? DAG_RL_DATA_DATA : DAG_RL_DATA_OB, "Driver");
+							rel = isdata_fcu ? DAG_RL_DATA_DATA : DAG_RL_DATA_OB;
 						}
 						/* check if ob data */
 						else if (dtar->rna_path && strstr(dtar->rna_path, "data."))
-							dag_add_relation(dag, node1, node, isdata_fcu ? DAG_RL_DATA_DATA : DAG_RL_DATA_OB, "Driver");
+							rel = isdata_fcu ? DAG_RL_DATA_DATA : DAG_RL_DATA_OB;
 						/* normal */
 						else
-							dag_add_relation(dag, node1, node, isdata_fcu ? DAG_RL_OB_DATA : DAG_RL_OB_OB, "Driver");
+							rel = isdata_fcu ? DAG_RL_OB_DATA : DAG_RL_OB_OB;
+
+						if (istransform) {
+							rel |= (rel & (DAG_RL_DATA_DATA | DAG_RL_DATA_OB)) ? DAG_RL_DATA_OB : DAG_RL_OB_OB;
+						}
+
+						dag_add_relation(dag, node1, node, rel, "Driver");
 					}
 				}
 			}
@@ -364,7 +373,7 @@ static void dag_add_shader_nodetree_driver_relations(DagForest *dag, DagNode *no
 
 	/* nodetree itself */
 	if (ntree->adt) {
-		dag_add_driver_relation(ntree->adt, dag, node, 1);
+		dag_add_driver_relation(ntree->adt, dag, node, 1, 0);
 	}
 	
 	/* nodetree's nodes... */
@@ -394,7 +403,7 @@ static void dag_add_material_driver_relations(DagForest *dag, DagNode *node, Mat
 	
 	/* material itself */
 	if (ma->adt)
-		dag_add_driver_relation(ma->adt, dag, node, 1);
+		dag_add_driver_relation(ma->adt, dag, node, 1, 0);
 
 	/* textures */
 	// TODO...
@@ -421,7 +430,7 @@ static void dag_add_lamp_driver_relations(DagForest *dag, DagNode *node, Lamp *l
 	
 	/* lamp itself */
 	if (la->adt)
-		dag_add_driver_relation(la->adt, dag, node, 1);
+		dag_add_driver_relation(la->adt, dag, node, 1, 0);
 
 	/* textures */
 	// TODO...
@@ -559,11 +568,11 @@ static void build_dag_object(DagForest *dag, DagNode *scenenode, Scene *scene, O
 	}
 #endif // XXX old animation system
 	if (ob->adt)
-		dag_add_driver_relation(ob->adt, dag, node, (ob->type == OB_ARMATURE));  // XXX isdata arg here doesn't give an accurate picture of situation
+		dag_add_driver_relation(ob->adt, dag, node, (ob->type == OB_ARMATURE), 1);  // XXX isdata arg here doesn't give an accurate picture of situation
 		
 	key = BKE_key_from_object(ob);
 	if (key && key->adt)
-		dag_add_driver_relation(key->adt, dag, node, 1);
+		dag_add_driver_relation(key->adt, dag, node, 1, 0);
 
 	if (ob->modifiers.first) {
 		ModifierData *md;
@@ -649,7 +658,7 @@ static void build_dag_object(DagForest *dag, DagNode *scenenode, Scene *scene, O
 	if (ob->data) {
 		AnimData *adt = BKE_animdata_from_id((ID *)ob->data);
 		if (adt)
-			dag_add_driver_relation(adt, dag, node, 1);
+			dag_add_driver_relation(adt, dag, node, 1, 0);
 	}
 	
 	/* object type/data relationships */
@@ -2969,78 +2978,168 @@ void DAG_pose_sort(Object *ob)
 
 /* ************************  DAG FOR THREADED UPDATE  ********************* */
 
+/* Get the components of child_node which depend on the given component of node,
+ * according to the type of the relation between both nodes.
+ *
+ * Relations between objects map to component dependencies, so an object which only
+ * needs the transform of another object doesn't wait for its geometry or pose to
+ * be evaluated. Other relations make the whole child node depend on the whole parent node.
+ *
+ * Returns the number of components written to r_child_components.
+ */
+static int dag_threaded_update_child_components(DagNode *node, int component, DagAdjList *itA,
+                                                int r_child_components[DAG_NUM_NODE_COMPONENTS])
+{
+	const short ob_relations = DAG_RL_OB_OB | DAG_RL_OB_DATA | DAG_RL_DATA_OB | DAG_RL_DATA_DATA;
+	int totchild = 0;
+
+	/* proxies update their library object from their own data update, so keep them on whole node level */
+	if (node->type == ID_OB && itA->node->type == ID_OB &&
+	    ((Object *)node->ob)->proxy == NULL &&
+	    itA->type != 0 && (itA->type & ~ob_relations) == 0)
+	{
+		if (component == DAG_NODE_COMPONENT_TRANSFORM) {
+			if (itA->type & DAG_RL_OB_OB)
+				r_child_components[totchild++] = DAG_NODE_COMPONENT_TRANSFORM;
+			if (itA->type & DAG_RL_OB_DATA)
+				r_child_components[totchild++] = DAG_NODE_COMPONENT_DATA;
+		}
+		else {
+			if (itA->type & DAG_RL_DATA_OB)
+				r_child_components[totchild++] = DAG_NODE_COMPONENT_TRANSFORM;
+			if (itA->type & DAG_RL_DATA_DATA)
+				r_child_components[totchild++] = DAG_NODE_COMPONENT_DATA;
+		}
+	}
+	else if (component == DAG_NODE_COMPONENT_DATA) {
+		/* data is the last component evaluated of a node */
+		r_child_components[totchild++] = DAG_NODE_COMPONENT_TRANSFORM;
+	}
+
+	return totchild;
+}
+
+/* Call func for a component if it's not scheduled yet. */
+static void dag_threaded_update_schedule(DagNodeComponent *component,
+                                         void (*func)(void *node, void *user_data),
+                                         void *user_data)
+{
+	bool need_schedule;
+
+	BLI_spin_lock(&threaded_update_lock);
+	need_schedule = component->scheduled == false;
+	component->scheduled = true;
+	BLI_spin_unlock(&threaded_update_lock);
+
+	if (need_schedule) {
+		func(component, user_data);
+	}
+}
+
 /* Initialize run-time data in the graph needed for traversing it
  * from multiple threads and start threaded tree traversal by adding
- * the root node to the queue.
+ * the root components to the queue.
  *
- * This will mark DAG nodes as object/non-object and will calculate
- * num_pending_parents of nodes (which is how many non-updated parents node
- * have, which helps a lot checking whether node could be scheduled
- * already or not).
+ * This will calculate num_pending_parents of node components (which is how
+ * many non-updated parent components a component have, which helps a lot
+ * checking whether component could be scheduled already or not).
  */
 void DAG_threaded_update_begin(Scene *scene,
                                void (*func)(void *node, void *user_data),
                                void *user_data)
 {
 	DagNode *node;
+	int i;
 
-	/* We reset num_pending_parents to zero first and tag node as not scheduled yet... */
+	/* We reset num_pending_parents to zero first and tag components as not scheduled yet... */
 	for (node = scene->theDag->DagNode.first; node; node = node->next) {
-		node->num_pending_parents = 0;
-		node->scheduled = false;
+		for (i = 0; i < DAG_NUM_NODE_COMPONENTS; i++) {
+			DagNodeComponent *component = &node->components[i];
+
+			component->node = node;
+			component->num_pending_parents = 0;
+			component->scheduled = false;
+		}
+
+		node->components[DAG_NODE_COMPONENT_TRANSFORM].type = DAG_COMPONENT_TRANSFORM;
+		node->components[DAG_NODE_COMPONENT_DATA].type =
+		        (node->type == ID_OB && ((Object *)node->ob)->type == OB_ARMATURE) ?
+		        DAG_COMPONENT_POSE : DAG_COMPONENT_GEOMETRY;
+
+		/* data of the node is always evaluated after its transform */
+		node->components[DAG_NODE_COMPONENT_DATA].num_pending_parents++;
 	}
 
 	/* ... and then iterate over all the nodes and
-	 * increase num_pending_parents for node childs.
+	 * increase num_pending_parents for node childs components.
 	 */
 	for (node = scene->theDag->DagNode.first; node; node = node->next) {
 		DagAdjList *itA;
 
 		for (itA = node->child; itA; itA = itA->next) {
 			if (itA->node != node) {
-				itA->node->num_pending_parents++;
+				for (i = 0; i < DAG_NUM_NODE_COMPONENTS; i++) {
+					int child_components[DAG_NUM_NODE_COMPONENTS];
+					int j, totchild = dag_threaded_update_child_components(node, i, itA, child_components);
+
+					for (j = 0; j < totchild; j++) {
+						itA->node->components[child_components[j]].num_pending_parents++;
+					}
+				}
 			}
 		}
 	}
 
-	/* Add root nodes to the queue. */
+	/* Add root components to the queue. */
 	BLI_spin_lock(&threaded_update_lock);
 	for (node = scene->theDag->DagNode.first; node; node = node->next) {
-		if (node->num_pending_parents == 0) {
-			node->scheduled = true;
-			func(node, user_data);
+		for (i = 0; i < DAG_NUM_NODE_COMPONENTS; i++) {
+			DagNodeComponent *component = &node->components[i];
+
+			if (component->num_pending_parents == 0) {
+				component->scheduled = true;
+				func(component, user_data);
+			}
 		}
 	}
 	BLI_spin_unlock(&threaded_update_lock);
 }
 
-/* This function is called when handling node is done.
+/* This function is called when handling node component is done.
  *
- * This function updates num_pending_parents for all childs and
- * schedules them if they're ready.
+ * This function updates num_pending_parents for all dependent components
+ * and schedules them if they're ready.
  */
 void DAG_threaded_update_handle_node_updated(void *node_v,
                                              void (*func)(void *node, void *user_data),
                                              void *user_data)
 {
-	DagNode *node = node_v;
+	DagNodeComponent *component = node_v;
+	DagNode *node = component->node;
+	const int component_index = (int)(component - node->components);
 	DagAdjList *itA;
 
+	if (component_index == DAG_NODE_COMPONENT_TRANSFORM) {
+		DagNodeComponent *data_component = &node->components[DAG_NODE_COMPONENT_DATA];
+
+		atomic_sub_uint32(&data_component->num_pending_parents, 1);
+		if (data_component->num_pending_parents == 0) {
+			dag_threaded_update_schedule(data_component, func, user_data);
+		}
+	}
+
 	for (itA = node->child; itA; itA = itA->next) {
 		DagNode *child_node = itA->node;
 		if (child_node != node) {
-			atomic_sub_uint32(&child_node->num_pending_parents, 1);
+			int child_components[DAG_NUM_NODE_COMPONENTS];
+			int j, totchild = dag_threaded_update_child_components(node, component_index, itA, child_components);
 
-			if (child_node->num_pending_parents == 0) {
-				bool need_schedule;
+			for (j = 0; j < totchild; j++) {
+				DagNodeComponent *child_component = &child_node->components[child_components[j]];
 
-				BLI_spin_lock(&threaded_update_lock);
-				need_schedule = child_node->scheduled == false;
-				child_node->scheduled = true;
-				BLI_spin_unlock(&threaded_update_lock);
-
-				if (need_schedule) {
-					func(child_node, user_data);
+				atomic_sub_uint32(&child_component->num_pending_parents, 1);
+				if (child_component->num_pending_parents == 0) {
+					dag_threaded_update_schedule(child_component, func, user_data);
 				}
 			}
 		}
@@ -3082,6 +3181,32 @@ Object *DAG_get_node_object(void *node_v)
 	return NULL;
 }
 
+/* Returns the node a component passed to threaded update callbacks belongs to. */
+void *DAG_get_component_node(void *component_v)
+{
+	DagNodeComponent *component = component_v;
+
+	return component->node;
+}
+
+eDagComponentType DAG_get_component_type(void *component_v)
+{
+	DagNodeComponent *component = component_v;
+
+	return (eDagComponentType)component->type;
+}
+
+/* Returns component type name, used for debug output only, atm. */
+const char *DAG_get_component_type_name(eDagComponentType type)
+{
+	switch (type) {
+		case DAG_COMPONENT_TRANSFORM: return "transform";
+		case DAG_COMPONENT_GEOMETRY:  return "geometry";
+		case DAG_COMPONENT_POSE:      return "pose";
+	}
+	return "unknown";
+}
+
 /* Returns node name, used for debug output only, atm. */
 const char *DAG_get_node_name(void *node_v)
 {
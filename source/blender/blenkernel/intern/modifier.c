@@ -61,6 +61,7 @@
 #include "BKE_key.h"
 #include "BKE_multires.h"
 #include "BKE_DerivedMesh.h"
+#include "BKE_profiler.h"
 
 /* may move these, only for modifier_path_relbase */
 #include "BKE_global.h" /* ugh, G.main->name only */
@@ -723,7 +724,13 @@ void modifier_path_init(char *path, int path_maxlen, const char *name)
 }
 
 
-/* wrapper around ModifierTypeInfo.applyModifier that ensures valid normals */
+/* wrapper around ModifierTypeInfo.applyModifier that ensures valid normals,
+ * and records the evaluation time when profiling */
+
+static void modwrap_profile_end(ModifierData *md, Object *ob, double start_time)
+{
+	BKE_profiler_event_add(PROFILE_EVENT_MODIFIER, ob->id.name + 2, md->name, start_time, 0.0);
+}
 
 struct DerivedMesh *modwrap_applyModifier(
         ModifierData *md, Object *ob,
@@ -731,12 +738,18 @@ struct DerivedMesh *modwrap_applyModifier(
         ModifierApplyFlag flag)
 {
 	ModifierTypeInfo *mti = modifierType_getInfo(md->type);
+	DerivedMesh *result;
+	double start_time;
 	BLI_assert(CustomData_has_layer(&dm->polyData, CD_NORMAL) == false);
 
 	if (mti->dependsOnNormals && mti->dependsOnNormals(md)) {
 		DM_ensure_normals(dm);
 	}
-	return mti->applyModifier(md, ob, dm, flag);
+	start_time = BKE_profiler_time();
+	result = mti->applyModifier(md, ob, dm, flag);
+	modwrap_profile_end(md, ob, start_time);
+
+	return result;
 }
 
 struct DerivedMesh *modwrap_applyModifierEM(
@@ -746,12 +759,18 @@ struct DerivedMesh *modwrap_applyModifierEM(
         ModifierApplyFlag flag)
 {
 	ModifierTypeInfo *mti = modifierType_getInfo(md->type);
+	DerivedMesh *result;
+	double start_time;
 	BLI_assert(CustomData_has_layer(&dm->polyData, CD_NORMAL) == false);
 
 	if (mti->dependsOnNormals && mti->dependsOnNormals(md)) {
 		DM_ensure_normals(dm);
 	}
-	return mti->applyModifierEM(md, ob, em, dm, flag);
+	start_time = BKE_profiler_time();
+	result = mti->applyModifierEM(md, ob, em, dm, flag);
+	modwrap_profile_end(md, ob, start_time);
+
+	return result;
 }
 
 void modwrap_deformVerts(
@@ -761,12 +780,15 @@ void modwrap_deformVerts(
         ModifierApplyFlag flag)
 {
 	ModifierTypeInfo *mti = modifierType_getInfo(md->type);
+	double start_time;
 	BLI_assert(!dm || CustomData_has_layer(&dm->polyData, CD_NORMAL) == false);
 
 	if (dm && mti->dependsOnNormals && mti->dependsOnNormals(md)) {
 		DM_ensure_normals(dm);
 	}
+	start_time = BKE_profiler_time();
 	mti->deformVerts(md, ob, dm, vertexCos, numVerts, flag);
+	modwrap_profile_end(md, ob, start_time);
 }
 
 void modwrap_deformVertsEM(
@@ -775,11 +797,14 @@ void modwrap_deformVertsEM(
         float (*vertexCos)[3], int numVerts)
 {
 	ModifierTypeInfo *mti = modifierType_getInfo(md->type);
+	double start_time;
 	BLI_assert(!dm || CustomData_has_layer(&dm->polyData, CD_NORMAL) == false);
 
 	if (dm && mti->dependsOnNormals && mti->dependsOnNormals(md)) {
 		DM_ensure_normals(dm);
 	}
+	start_time = BKE_profiler_time();
 	mti->deformVertsEM(md, ob, em, dm, vertexCos, numVerts);
+	modwrap_profile_end(md, ob, start_time);
 }
 /* end modifier callback wrappers */
@@ -2839,12 +2839,10 @@ bool BKE_object_parent_loop_check(const Object *par, const Object *ob)
 
 /* function below is polluted with proxy exceptions, cleanup will follow! */
 
-/* the main object update call, for object matrix, constraints, keys and displist (modifiers) */
+/* first part of object update, for object matrix and constraints */
 /* requires flags to be set! */
 /* Ideally we shouldn't have to pass the rigid body world, but need bigger restructuring to avoid id */
-void BKE_object_handle_update_ex(EvaluationContext *eval_ctx,
-                                 Scene *scene, Object *ob,
-                                 RigidBodyWorld *rbw)
+void BKE_object_handle_update_transform(Scene *scene, Object *ob, RigidBodyWorld *rbw)
 {
 	if (ob->recalc & OB_RECALC_ALL) {
 		/* speed optimization for animation lookups */
@@ -2887,7 +2885,14 @@ void BKE_object_handle_update_ex(EvaluationContext *eval_ctx,
 			else
 				BKE_object_where_is_calc_ex(scene, rbw, ob, NULL);
 		}
-		
+	}
+}
+
+/* second part of object update, for keys and displist (modifiers), clears the recalc flags */
+/* requires flags to be set, and BKE_object_handle_update_transform to be called first! */
+void BKE_object_handle_update_data(EvaluationContext *eval_ctx, Scene *scene, Object *ob)
+{
+	if (ob->recalc & OB_RECALC_ALL) {
 		if (ob->recalc & OB_RECALC_DATA) {
 			ID *data_id = (ID *)ob->data;
 			AnimData *adt = BKE_animdata_from_id(data_id);
@@ -3042,6 +3047,18 @@ void BKE_object_handle_update_ex(EvaluationContext *eval_ctx,
 		}
 	}
 }
+
+/* the main object update call, for object matrix, constraints, keys and displist (modifiers) */
+/* requires flags to be set! */
+/* Ideally we shouldn't have to pass the rigid body world, but need bigger restructuring to avoid id */
+void BKE_object_handle_update_ex(EvaluationContext *eval_ctx,
+                                 Scene *scene, Object *ob,
+                                 RigidBodyWorld *rbw)
+{
+	BKE_object_handle_update_transform(scene, ob, rbw);
+	BKE_object_handle_update_data(eval_ctx, scene, ob);
+}
+
 /* WARNING: "scene" here may not be the scene object actually resides in. 
  * When dealing with background-sets, "scene" is actually the active scene.
  * e.g. "scene" <-- set 1 <-- set 2 ("ob" lives here) <-- set 3 <-- ... <-- set n
@@ -70,6 +70,7 @@
 #include "BKE_object.h"
 #include "BKE_particle.h"
 #include "BKE_pointcache.h"
+#include "BKE_profiler.h"
 #include "BKE_scene.h"
 #include "BKE_smoke.h"
 #include "BKE_softbody.h"
@@ -2264,7 +2265,7 @@ static int ptcache_interpolate(PTCacheID *pid, float cfra, int cfra1, int cfra2)
 }
 /* reads cache from disk or memory */
 /* possible to get old or interpolated result */
-int BKE_ptcache_read(PTCacheID *pid, float cfra)
+static int ptcache_read_frame(PTCacheID *pid, float cfra)
 {
 	int cfrai = (int)floor(cfra), cfra1=0, cfra2=0;
 	int ret = 0;
@@ -2340,6 +2341,18 @@ int BKE_ptcache_read(PTCacheID *pid, float cfra)
 
 	return ret;
 }
+
+int BKE_ptcache_read(PTCacheID *pid, float cfra)
+{
+	int ret = ptcache_read_frame(pid, cfra);
+
+	if (BKE_profiler_is_enabled() && pid->ob) {
+		BKE_profiler_cache_access(pid->ob->id.name + 2, ret != 0);
+	}
+
+	return ret;
+}
+
 static int ptcache_write_stream(PTCacheID *pid, int cfra, int totpoint)
 {
 	PTCacheFile *pf = NULL;
@@ -0,0 +1,257 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file blender/blenkernel/intern/profiler.c
+ *  \ingroup bke
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_fileops.h"
+#include "BLI_string.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "BKE_profiler.h"
+
+#include "PIL_time.h"
+
+/* don't let a forgotten profiler eat all memory, ~170MB of events */
+#define PROFILE_MAX_EVENTS (1 << 20)
+#define PROFILE_EVENTS_INIT 1024
+
+static struct {
+	/* read without locking, so disabled profiler costs one check per event */
+	bool enabled;
+
+	/* statically initialized, so exit works when init never ran (blenderplayer) */
+	ThreadMutex lock;
+	ProfileEvent *events;
+	int totevent, maxevent;
+
+	double base_time;
+	double frame_start_time;
+	int frame;
+} profiler = {false, BLI_MUTEX_INITIALIZER};
+
+void BKE_profiler_exit(void)
+{
+	BKE_profiler_enable(false);
+	BKE_profiler_clear();
+}
+
+void BKE_profiler_enable(bool enable)
+{
+	if (enable && !profiler.enabled) {
+		if (profiler.totevent == 0) {
+			profiler.base_time = PIL_check_seconds_timer();
+		}
+	}
+	profiler.enabled = enable;
+}
+
+bool BKE_profiler_is_enabled(void)
+{
+	return profiler.enabled;
+}
+
+void BKE_profiler_clear(void)
+{
+	BLI_mutex_lock(&profiler.lock);
+	MEM_SAFE_FREE(profiler.events);
+	profiler.totevent = profiler.maxevent = 0;
+	profiler.base_time = PIL_check_seconds_timer();
+	BLI_mutex_unlock(&profiler.lock);
+}
+
+double BKE_profiler_time(void)
+{
+	if (!profiler.enabled) {
+		return 0.0;
+	}
+	return PIL_check_seconds_timer() - profiler.base_time;
+}
+
+static void profiler_event_add_ex(eProfileEventType type, const char *name, const char *subname,
+                                  double start_time, double duration, double wait_time)
+{
+	ProfileEvent *event;
+	int thread_id = BLI_task_scheduler_thread_id(BLI_task_scheduler_get());
+
+	BLI_mutex_lock(&profiler.lock);
+
+	if (profiler.totevent == profiler.maxevent) {
+		if (profiler.maxevent == PROFILE_MAX_EVENTS) {
+			BLI_mutex_unlock(&profiler.lock);
+			return;
+		}
+		profiler.maxevent = profiler.maxevent ? profiler.maxevent * 2 : PROFILE_EVENTS_INIT;
+		profiler.events = MEM_reallocN_id(profiler.events, sizeof(ProfileEvent) * (size_t)profiler.maxevent,
+		                                  "profiler events");
+	}
+
+	event = &profiler.events[profiler.totevent++];
+
+	if (subname) {
+		BLI_snprintf(event->name, sizeof(event->name), "%s/%s", name, subname);
+	}
+	else {
+		BLI_strncpy(event->name, name, sizeof(event->name));
+	}
+	event->type = (short)type;
+	event->frame = profiler.frame;
+	event->thread_id = thread_id;
+	event->start_time = start_time;
+	event->duration = duration;
+	event->wait_time = wait_time;
+
+	BLI_mutex_unlock(&profiler.lock);
+}
+
+void BKE_profiler_event_add(eProfileEventType type, const char *name, const char *subname,
+                            double start_time, double wait_time)
+{
+	if (profiler.enabled) {
+		double duration = BKE_profiler_time() - start_time;
+		profiler_event_add_ex(type, name, subname, start_time, duration, wait_time);
+	}
+}
+
+void BKE_profiler_cache_access(const char *name, bool hit)
+{
+	if (profiler.enabled) {
+		profiler_event_add_ex(hit ? PROFILE_EVENT_CACHE_HIT : PROFILE_EVENT_CACHE_MISS,
+		                      name, NULL, BKE_profiler_time(), 0.0, 0.0);
+	}
+}
+
+void BKE_profiler_frame_begin(int frame)
+{
+	profiler.frame = frame;
+	profiler.frame_start_time = BKE_profiler_time();
+}
+
+void BKE_profiler_frame_end(void)
+{
+	if (profiler.enabled) {
+		char name[32];
+
+		BLI_snprintf(name, sizeof(name), "Frame %d", profiler.frame);
+		BKE_profiler_event_add(PROFILE_EVENT_FRAME, name, NULL, profiler.frame_start_time, 0.0);
+	}
+}
+
+ProfileEvent *BKE_profiler_events_copy(int *r_totevent)
+{
+	ProfileEvent *events = NULL;
+
+	BLI_mutex_lock(&profiler.lock);
+
+	*r_totevent = profiler.totevent;
+	if (profiler.totevent) {
+		events = MEM_mallocN(sizeof(ProfileEvent) * (size_t)profiler.totevent, "profiler events copy");
+		memcpy(events, profiler.events, sizeof(ProfileEvent) * (size_t)profiler.totevent);
+	}
+
+	BLI_mutex_unlock(&profiler.lock);
+
+	return events;
+}
+
+const char *BKE_profiler_event_type_name(eProfileEventType type)
+{
+	switch (type) {
+		case PROFILE_EVENT_FRAME: return "FRAME";
+		case PROFILE_EVENT_OBJECT_TRANSFORM: return "TRANSFORM";
+		case PROFILE_EVENT_OBJECT_GEOMETRY: return "GEOMETRY";
+		case PROFILE_EVENT_OBJECT_POSE: return "POSE";
+		case PROFILE_EVENT_MODIFIER: return "MODIFIER";
+		case PROFILE_EVENT_CACHE_HIT: return "CACHE_HIT";
+		case PROFILE_EVENT_CACHE_MISS: return "CACHE_MISS";
+	}
+	return "UNKNOWN";
+}
+
+/* ************************************************************************** */
+/* Chrome trace export */
+
+static void profiler_write_json_string(FILE *fp, const char *str)
+{
+	fputc('"', fp);
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\') {
+			fputc('\\', fp);
+			fputc(*str, fp);
+		}
+		else if ((unsigned char)*str < 0x20) {
+			fprintf(fp, "\\u%04x", (unsigned int)(unsigned char)*str);
+		}
+		else {
+			fputc(*str, fp);
+		}
+	}
+	fputc('"', fp);
+}
+
+/* Writes events in the Trace Event Format: complete ('X') events for timed
+ * events and instant ('i') events for cache accesses, times in microseconds. */
+bool BKE_profiler_write_trace(const char *filepath)
+{
+	FILE *fp = BLI_fopen(filepath, "w");
+	int i;
+
+	if (fp == NULL) {
+		return false;
+	}
+
+	BLI_mutex_lock(&profiler.lock);
+
+	fputs("{\"traceEvents\":[\n", fp);
+
+	for (i = 0; i < profiler.totevent; i++) {
+		const ProfileEvent *event = &profiler.events[i];
+		const bool is_instant = ELEM(event->type, PROFILE_EVENT_CACHE_HIT, PROFILE_EVENT_CACHE_MISS);
+
+		fputs("{\"name\":", fp);
+		profiler_write_json_string(fp, event->name);
+		fprintf(fp, ",\"cat\":\"%s\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,",
+		        BKE_profiler_event_type_name((eProfileEventType)event->type), event->thread_id, event->start_time * 1e6);
+		if (is_instant) {
+			fputs("\"ph\":\"i\",\"s\":\"t\",", fp);
+		}
+		else {
+			fprintf(fp, "\"ph\":\"X\",\"dur\":%.3f,", event->duration * 1e6);
+		}
+		fprintf(fp, "\"args\":{\"frame\":%d,\"wait_us\":%.3f}}%s\n",
+		        event->frame, event->wait_time * 1e6, (i + 1 < profiler.totevent) ? "," : "");
+	}
+
+	fputs("]}\n", fp);
+
+	BLI_mutex_unlock(&profiler.lock);
+
+	fclose(fp);
+
+	return true;
+}
@@ -81,6 +81,7 @@
 #include "BKE_object.h"
 #include "BKE_paint.h"
 #include "BKE_pointcache.h"
+#include "BKE_profiler.h"
 #include "BKE_rigidbody.h"
 #include "BKE_scene.h"
 #include "BKE_sequencer.h"
@@ -1220,12 +1221,6 @@ static void scene_do_rb_simulation_recursive(Scene *scene, float ctime)
 		BKE_rigidbody_do_simulation(scene, ctime);
 }
 
-/* Used to visualize CPU threads activity during threaded object update,
- * would pollute STDERR with whole bunch of timing information which then
- * could be parsed and nicely visualized.
- */
-#undef DETAILED_ANALYSIS_OUTPUT
-
 /* Mballs evaluation uses BKE_scene_base_iter_next which calls
  * duplilist for all objects in the scene. This leads to conflict
  * accessing and writing same data from multiple threads.
@@ -1239,7 +1234,7 @@ static void scene_do_rb_simulation_recursive(Scene *scene, float ctime)
 typedef struct StatisicsEntry {
 	struct StatisicsEntry *next, *prev;
 	Object *object;
-	double start_time;
+	eDagComponentType component;
 	double duration;
 } StatisicsEntry;
 
@@ -1248,7 +1243,6 @@ typedef struct ThreadedObjectUpdateState {
 	EvaluationContext *eval_ctx;
 	Scene *scene;
 	Scene *scene_parent;
-	double base_time;
 
 	/* Execution statistics */
 	ListBase statistics[BLENDER_MAX_THREADS];
@@ -1259,17 +1253,40 @@ typedef struct ThreadedObjectUpdateState {
 #endif
 } ThreadedObjectUpdateState;
 
+typedef struct ThreadedObjectUpdateTask {
+	void *component;
+	/* profiler time at which all dependencies of the component were updated */
+	double ready_time;
+} ThreadedObjectUpdateTask;
+
 static void scene_update_object_add_task(void *node, void *user_data);
 
+static eProfileEventType scene_update_profile_event_type(eDagComponentType component_type)
+{
+	switch (component_type) {
+		case DAG_COMPONENT_TRANSFORM: return PROFILE_EVENT_OBJECT_TRANSFORM;
+		case DAG_COMPONENT_GEOMETRY: return PROFILE_EVENT_OBJECT_GEOMETRY;
+		case DAG_COMPONENT_POSE: return PROFILE_EVENT_OBJECT_POSE;
+	}
+	return PROFILE_EVENT_OBJECT_GEOMETRY;
+}
+
 static void scene_update_all_bases(EvaluationContext *eval_ctx, Scene *scene, Scene *scene_parent)
 {
 	Base *base;
 
 	for (base = scene->base.first; base; base = base->next) {
 		Object *object = base->object;
+		bool do_profile = BKE_profiler_is_enabled() && (object->recalc & OB_RECALC_ALL);
+		double profile_start_time = BKE_profiler_time();
 
 		BKE_object_handle_update_ex(eval_ctx, scene_parent, object, scene->rigidbody_world);
 
+		if (do_profile) {
+			BKE_profiler_event_add(PROFILE_EVENT_OBJECT_GEOMETRY, object->id.name + 2, NULL,
+			                       profile_start_time, 0.0);
+		}
+
 		if (object->dup_group && (object->transflag & OB_DUPLIGROUP))
 			BKE_group_handle_recalc_and_update(eval_ctx, scene_parent, object, object->dup_group);
 
@@ -1286,7 +1303,10 @@ static void scene_update_object_func(TaskPool *pool, void *taskdata, int threadi
 #define PRINT if (false) printf
 
 	ThreadedObjectUpdateState *state = (ThreadedObjectUpdateState *) BLI_task_pool_userdata(pool);
-	void *node = taskdata;
+	ThreadedObjectUpdateTask *task = taskdata;
+	void *component = task->component;
+	void *node = DAG_get_component_node(component);
+	eDagComponentType component_type = DAG_get_component_type(component);
 	Object *object = DAG_get_node_object(node);
 	EvaluationContext *eval_ctx = state->eval_ctx;
 	Scene *scene = state->scene;
@@ -1300,9 +1320,13 @@ static void scene_update_object_func(TaskPool *pool, void *taskdata, int threadi
 #endif
 	if (object) {
 		double start_time = 0.0;
+		double profile_start_time = BKE_profiler_time();
+		/* recalc flags are cleared by the update */
+		bool do_profile = BKE_profiler_is_enabled() && (object->recalc & OB_RECALC_ALL);
 		bool add_to_stats = false;
 
-		PRINT("Thread %d: update object %s\n", threadid, object->id.name);
+		PRINT("Thread %d: update object %s %s\n", threadid, object->id.name,
+		      DAG_get_component_type_name(component_type));
 
 		if (G.debug & G_DEBUG_DEPSGRAPH) {
 			start_time = PIL_check_seconds_timer();
@@ -1316,8 +1340,22 @@ static void scene_update_object_func(TaskPool *pool, void *taskdata, int threadi
 		/* We only update object itself here, dupli-group will be updated
 		 * separately from main thread because of we've got no idea about
 		 * dependencies inside the group.
+		 *
+		 * Transform and data are separate tasks, so objects depending only on the
+		 * transform of this object don't need to wait for its geometry or pose.
 		 */
-		BKE_object_handle_update_ex(eval_ctx, scene_parent, object, scene->rigidbody_world);
+		if (component_type == DAG_COMPONENT_TRANSFORM) {
+			BKE_object_handle_update_transform(scene_parent, object, scene->rigidbody_world);
+		}
+		else {
+			BKE_object_handle_update_data(eval_ctx, scene_parent, object);
+		}
+
+		if (do_profile) {
+			BKE_profiler_event_add(scene_update_profile_event_type(component_type),
+			                       object->id.name + 2, NULL, profile_start_time,
+			                       profile_start_time - task->ready_time);
+		}
 
 		/* Calculate statistics. */
 		if (add_to_stats) {
@@ -1325,7 +1363,7 @@ static void scene_update_object_func(TaskPool *pool, void *taskdata, int threadi
 
 			entry = MEM_mallocN(sizeof(StatisicsEntry), "update thread statistics");
 			entry->object = object;
-			entry->start_time = start_time;
+			entry->component = component_type;
 			entry->duration = PIL_check_seconds_timer() - start_time;
 
 			BLI_addtail(&state->statistics[threadid], entry);
@@ -1337,7 +1375,7 @@ static void scene_update_object_func(TaskPool *pool, void *taskdata, int threadi
 	}
 
 	/* Update will decrease child's valency and schedule child with zero valency. */
-	DAG_threaded_update_handle_node_updated(node, scene_update_object_add_task, pool);
+	DAG_threaded_update_handle_node_updated(component, scene_update_object_add_task, pool);
 
 #undef PRINT
 }
@@ -1345,8 +1383,12 @@ static void scene_update_object_func(TaskPool *pool, void *taskdata, int threadi
 static void scene_update_object_add_task(void *node, void *user_data)
 {
 	TaskPool *task_pool = user_data;
+	ThreadedObjectUpdateTask *task = MEM_mallocN(sizeof(ThreadedObjectUpdateTask), "scene update task");
+
+	task->component = node;
+	task->ready_time = BKE_profiler_time();
 
-	BLI_task_pool_push(task_pool, scene_update_object_func, node, false, TASK_PRIORITY_LOW);
+	BLI_task_pool_push(task_pool, scene_update_object_func, task, true, TASK_PRIORITY_LOW);
 }
 
 static void print_threads_statistics(ThreadedObjectUpdateState *state)
@@ -1357,26 +1399,6 @@ static void print_threads_statistics(ThreadedObjectUpdateState *state)
 		return;
 	}
 
-#ifdef DETAILED_ANALYSIS_OUTPUT
-	if (state->has_updated_objects) {
-		tot_thread = BLI_system_thread_count();
-
-		fprintf(stderr, "objects update base time %f\n", state->base_time);
-
-		for (i = 0; i < tot_thread; i++) {
-			StatisicsEntry *entry;
-			for (entry = state->statistics[i].first;
-			     entry;
-			     entry = entry->next)
-			{
-				fprintf(stderr, "thread %d object %s start_time %f duration %f\n",
-				        i, entry->object->id.name + 2,
-				        entry->start_time, entry->duration);
-			}
-			BLI_freelistN(&state->statistics[i]);
-		}
-	}
-#else
 	tot_thread = BLI_system_thread_count();
 
 	for (i = 0; i < tot_thread; i++) {
@@ -1394,19 +1416,19 @@ static void print_threads_statistics(ThreadedObjectUpdateState *state)
 				total_time += entry->duration;
 			}
 
-			printf("Thread %d: total %d objects in %f sec.\n", i, total_objects, total_time);
+			printf("Thread %d: total %d object components in %f sec.\n", i, total_objects, total_time);
 
 			for (entry = state->statistics[i].first;
 			     entry;
 			     entry = entry->next)
 			{
-				printf("  %s in %f sec\n", entry->object->id.name + 2, entry->duration);
+				printf("  %s %s in %f sec\n", entry->object->id.name + 2,
+				       DAG_get_component_type_name(entry->component), entry->duration);
 			}
 		}
 
 		BLI_freelistN(&state->statistics[i]);
 	}
-#endif
 }
 
 static bool scene_need_update_objects(Main *bmain)
@@ -1481,7 +1503,6 @@ static void scene_update_objects(EvaluationContext *eval_ctx, Main *bmain, Scene
 	if (G.debug & G_DEBUG_DEPSGRAPH) {
 		memset(state.statistics, 0, sizeof(state.statistics));
 		state.has_updated_objects = false;
-		state.base_time = PIL_check_seconds_timer();
 	}
 
 #ifdef MBALL_SINGLETHREAD_HACK
@@ -1620,9 +1641,8 @@ void BKE_scene_update_for_newframe_ex(EvaluationContext *eval_ctx, Main *bmain,
 {
 	float ctime = BKE_scene_frame_get(sce);
 	Scene *sce_iter;
-#ifdef DETAILED_ANALYSIS_OUTPUT
-	double start_time = PIL_check_seconds_timer();
-#endif
+
+	BKE_profiler_frame_begin(sce->r.cfra);
 
 	/* keep this first */
 	BLI_callback_exec(bmain, &sce->id, BLI_CB_EVT_FRAME_CHANGE_PRE);
@@ -1690,9 +1710,7 @@ void BKE_scene_update_for_newframe_ex(EvaluationContext *eval_ctx, Main *bmain,
 	/* clear recalc flags */
 	DAG_ids_clear_recalc(bmain);
 
-#ifdef DETAILED_ANALYSIS_OUTPUT
-	fprintf(stderr, "frame update start_time %f duration %f\n", start_time, PIL_check_seconds_timer() - start_time);
-#endif
+	BKE_profiler_frame_end();
 }
 
 /* return default layer, also used to patch old files */
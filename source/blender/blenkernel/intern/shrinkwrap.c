@@ -43,6 +43,8 @@
 #include "DNA_mesh_types.h"
 #include "DNA_scene_types.h"
 
+#include "MEM_guardedalloc.h"
+
 #include "BLI_math.h"
 #include "BLI_utildefines.h"
 
@@ -117,6 +119,31 @@ static void space_transform_invert_normal(const SpaceTransform *data, float no[3
 	normalize_v3(no); /* TODO: could we just determine de scale value from the matrix? */
 }
 
+/*
+ * Fill the queries for BLI_bvhtree_find_nearest_batch with the vertices in target space,
+ * vertices with zero weight get a zero search distance so they're skipped.
+ */
+static void shrinkwrap_nearest_batch_init(ShrinkwrapCalcData *calc, float (*tree_co)[3], BVHTreeNearest *nearest)
+{
+	int i;
+
+	for (i = 0; i < calc->numVerts; ++i) {
+		const float weight = defvert_array_find_weight_safe(calc->dvert, i, calc->vgroup);
+
+		/* Convert the vertex to tree coordinates */
+		if (calc->vert) {
+			copy_v3_v3(tree_co[i], calc->vert[i].co);
+		}
+		else {
+			copy_v3_v3(tree_co[i], calc->vertexCos[i]);
+		}
+		space_transform_apply(&calc->local2target, tree_co[i]);
+
+		nearest[i].index = -1;
+		nearest[i].dist_sq = (weight == 0.0f) ? 0.0f : FLT_MAX;
+	}
+}
+
 /*
  * Shrinkwrap to the nearest vertex
  *
@@ -128,7 +155,8 @@ static void shrinkwrap_calc_nearest_vertex(ShrinkwrapCalcData *calc)
 	int i;
 
 	BVHTreeFromMesh treeData = NULL_BVHTreeFromMesh;
-	BVHTreeNearest nearest  = NULL_BVHTreeNearest;
+	float (*tree_co)[3];
+	BVHTreeNearest *nearest;
 
 
 	TIMEIT_BENCH(bvhtree_from_mesh_verts(&treeData, calc->target, 0.0, 2, 6), bvhtree_verts);
@@ -137,121 +165,72 @@ static void shrinkwrap_calc_nearest_vertex(ShrinkwrapCalcData *calc)
 		return;
 	}
 
-	/* Setup nearest */
-	nearest.index = -1;
-	nearest.dist_sq = FLT_MAX;
-#ifndef __APPLE__
-#pragma omp parallel for default(none) private(i) firstprivate(nearest) shared(treeData, calc) schedule(static)
-#endif
+	tree_co = MEM_mallocN(sizeof(*tree_co) * (size_t)calc->numVerts, __func__);
+	nearest = MEM_mallocN(sizeof(*nearest) * (size_t)calc->numVerts, __func__);
+
+	/* Find the nearest vertex of all vertices at once,
+	 * the batch search reuses the previous hit of a vertex to reduce the search of the next one */
+	shrinkwrap_nearest_batch_init(calc, tree_co, nearest);
+	BLI_bvhtree_find_nearest_batch(treeData.tree, (const float (*)[3])tree_co, nearest, calc->numVerts,
+	                               treeData.nearest_callback, &treeData);
+
 	for (i = 0; i < calc->numVerts; ++i) {
 		float *co = calc->vertexCos[i];
 		float tmp_co[3];
-		float weight = defvert_array_find_weight_safe(calc->dvert, i, calc->vgroup);
-		if (weight == 0.0f) {
-			continue;
-		}
-
-
-		/* Convert the vertex to tree coordinates */
-		if (calc->vert) {
-			copy_v3_v3(tmp_co, calc->vert[i].co);
-		}
-		else {
-			copy_v3_v3(tmp_co, co);
-		}
-		space_transform_apply(&calc->local2target, tmp_co);
-
-		/* Use local proximity heuristics (to reduce the nearest search)
-		 *
-		 * If we already had an hit before.. we assume this vertex is going to have a close hit to that other vertex
-		 * so we can initiate the "nearest.dist" with the expected value to that last hit.
-		 * This will lead in pruning of the search tree. */
-		if (nearest.index != -1)
-			nearest.dist_sq = len_squared_v3v3(tmp_co, nearest.co);
-		else
-			nearest.dist_sq = FLT_MAX;
-
-		BLI_bvhtree_find_nearest(treeData.tree, tmp_co, &nearest, treeData.nearest_callback, &treeData);
-
+		float weight;
 
 		/* Found the nearest vertex */
-		if (nearest.index != -1) {
+		if (nearest[i].index != -1) {
+			weight = defvert_array_find_weight_safe(calc->dvert, i, calc->vgroup);
+
 			/* Adjusting the vertex weight,
 			 * so that after interpolating it keeps a certain distance from the nearest position */
-			if (nearest.dist_sq > FLT_EPSILON) {
-				const float dist = sqrtf(nearest.dist_sq);
+			if (nearest[i].dist_sq > FLT_EPSILON) {
+				const float dist = sqrtf(nearest[i].dist_sq);
 				weight *= (dist - calc->keepDist) / dist;
 			}
 
 			/* Convert the coordinates back to mesh coordinates */
-			copy_v3_v3(tmp_co, nearest.co);
+			copy_v3_v3(tmp_co, nearest[i].co);
 			space_transform_invert(&calc->local2target, tmp_co);
 
 			interp_v3_v3v3(co, co, tmp_co, weight);  /* linear interpolation */
 		}
 	}
 
+	MEM_freeN(tree_co);
+	MEM_freeN(nearest);
+
 	free_bvhtree_from_mesh(&treeData);
 }
 
 
+/* don't use this because this dist value could be incompatible
+ * this value used by the callback for comparing prev/new dist values.
+ * also, at the moment there is no need to have a corrected 'dist' value */
+// #define USE_DIST_CORRECT
+
 /*
- * This function raycast a single vertex and updates the hit if the "hit" is considered valid.
- * Returns TRUE if "hit" was updated.
- * Opts control whether an hit is valid or not
- * Supported options are:
- *	MOD_SHRINKWRAP_CULL_TARGET_FRONTFACE (front faces hits are ignored)
- *	MOD_SHRINKWRAP_CULL_TARGET_BACKFACE (back faces hits are ignored)
+ * Check the hit of a ray cast in target space and convert it back,
+ * updates the hit if the "hit" is considered valid. Returns TRUE if "hit" was updated.
  */
-int BKE_shrinkwrap_project_normal(char options, const float vert[3],
-                                  const float dir[3], const SpaceTransform *transf,
-                                  BVHTree *tree, BVHTreeRayHit *hit,
-                                  BVHTree_RayCastCallback callback, void *userdata)
+static int shrinkwrap_project_normal_hit(char options, const float vert[3], const float dir[3],
+                                         const SpaceTransform *transf,
+                                         BVHTreeRayHit *hit_tmp, BVHTreeRayHit *hit)
 {
-	/* don't use this because this dist value could be incompatible
-	 * this value used by the callback for comparing prev/new dist values.
-	 * also, at the moment there is no need to have a corrected 'dist' value */
-// #define USE_DIST_CORRECT
-
-	float tmp_co[3], tmp_no[3];
-	const float *co, *no;
-	BVHTreeRayHit hit_tmp;
-
-	/* Copy from hit (we need to convert hit rays from one space coordinates to the other */
-	memcpy(&hit_tmp, hit, sizeof(hit_tmp));
-
-	/* Apply space transform (TODO readjust dist) */
-	if (transf) {
-		copy_v3_v3(tmp_co, vert);
-		space_transform_apply(transf, tmp_co);
-		co = tmp_co;
-
-		copy_v3_v3(tmp_no, dir);
-		space_transform_apply_normal(transf, tmp_no);
-		no = tmp_no;
-
-#ifdef USE_DIST_CORRECT
-		hit_tmp.dist *= mat4_to_scale(((SpaceTransform *)transf)->local2target);
+#ifndef USE_DIST_CORRECT
+	(void)vert;
 #endif
-	}
-	else {
-		co = vert;
-		no = dir;
-	}
-
-	hit_tmp.index = -1;
 
-	BLI_bvhtree_ray_cast(tree, co, no, 0.0f, &hit_tmp, callback, userdata);
-
-	if (hit_tmp.index != -1) {
+	if (hit_tmp->index != -1) {
 		/* invert the normal first so face culling works on rotated objects */
 		if (transf) {
-			space_transform_invert_normal(transf, hit_tmp.no);
+			space_transform_invert_normal(transf, hit_tmp->no);
 		}
 
 		if (options & (MOD_SHRINKWRAP_CULL_TARGET_FRONTFACE | MOD_SHRINKWRAP_CULL_TARGET_BACKFACE)) {
 			/* apply backface */
-			const float dot = dot_v3v3(dir, hit_tmp.no);
+			const float dot = dot_v3v3(dir, hit_tmp->no);
 			if (((options & MOD_SHRINKWRAP_CULL_TARGET_FRONTFACE) && dot <= 0.0f) ||
 			    ((options & MOD_SHRINKWRAP_CULL_TARGET_BACKFACE)  && dot >= 0.0f))
 			{
@@ -261,20 +240,106 @@ int BKE_shrinkwrap_project_normal(char options, const float vert[3],
 
 		if (transf) {
 			/* Inverting space transform (TODO make coeherent with the initial dist readjust) */
-			space_transform_invert(transf, hit_tmp.co);
+			space_transform_invert(transf, hit_tmp->co);
 #ifdef USE_DIST_CORRECT
-			hit_tmp.dist = len_v3v3(vert, hit_tmp.co);
+			hit_tmp->dist = len_v3v3(vert, hit_tmp->co);
 #endif
 		}
 
-		BLI_assert(hit_tmp.dist <= hit->dist);
+		BLI_assert(hit_tmp->dist <= hit->dist);
 
-		memcpy(hit, &hit_tmp, sizeof(hit_tmp));
+		memcpy(hit, hit_tmp, sizeof(*hit_tmp));
 		return TRUE;
 	}
 	return FALSE;
 }
 
+/* convert the ray to target space, for BKE_shrinkwrap_project_normal and the batch version */
+static void shrinkwrap_project_normal_ray(const float vert[3], const float dir[3], const SpaceTransform *transf,
+                                          BVHTreeRay *ray, BVHTreeRayHit *hit_tmp)
+{
+	copy_v3_v3(ray->origin, vert);
+	copy_v3_v3(ray->direction, dir);
+	ray->radius = 0.0f;
+
+	/* Apply space transform (TODO readjust dist) */
+	if (transf) {
+		space_transform_apply(transf, ray->origin);
+		space_transform_apply_normal(transf, ray->direction);
+
+#ifdef USE_DIST_CORRECT
+		hit_tmp->dist *= mat4_to_scale(((SpaceTransform *)transf)->local2target);
+#endif
+	}
+
+	hit_tmp->index = -1;
+}
+
+/*
+ * This function raycast a single vertex and updates the hit if the "hit" is considered valid.
+ * Returns TRUE if "hit" was updated.
+ * Opts control whether an hit is valid or not
+ * Supported options are:
+ *	MOD_SHRINKWRAP_CULL_TARGET_FRONTFACE (front faces hits are ignored)
+ *	MOD_SHRINKWRAP_CULL_TARGET_BACKFACE (back faces hits are ignored)
+ */
+int BKE_shrinkwrap_project_normal(char options, const float vert[3],
+                                  const float dir[3], const SpaceTransform *transf,
+                                  BVHTree *tree, BVHTreeRayHit *hit,
+                                  BVHTree_RayCastCallback callback, void *userdata)
+{
+	BVHTreeRay ray;
+	BVHTreeRayHit hit_tmp;
+
+	/* Copy from hit (we need to convert hit rays from one space coordinates to the other */
+	memcpy(&hit_tmp, hit, sizeof(hit_tmp));
+
+	shrinkwrap_project_normal_ray(vert, dir, transf, &ray, &hit_tmp);
+
+	BLI_bvhtree_ray_cast(tree, ray.origin, ray.direction, 0.0f, &hit_tmp, callback, userdata);
+
+	return shrinkwrap_project_normal_hit(options, vert, dir, transf, &hit_tmp, hit);
+}
+
+/*
+ * Same as BKE_shrinkwrap_project_normal for all vertices at once, using BLI_bvhtree_ray_cast_batch.
+ * Vertices with a zero hit distance are skipped. When negate is set the directions are inverted.
+ * rays and hits_tmp are scratch arrays of numverts items.
+ */
+static void shrinkwrap_project_normal_batch(char options, const float (*vert)[3], const float (*dir)[3], bool negate,
+                                            const SpaceTransform *transf, BVHTree *tree, BVHTreeRayHit *hits, int numverts,
+                                            BVHTreeRay *rays, BVHTreeRayHit *hits_tmp,
+                                            BVHTree_RayCastCallback callback, void *userdata)
+{
+	float no[3];
+	int i;
+
+	for (i = 0; i < numverts; i++) {
+		if (negate) {
+			negate_v3_v3(no, dir[i]);
+		}
+		else {
+			copy_v3_v3(no, dir[i]);
+		}
+
+		memcpy(&hits_tmp[i], &hits[i], sizeof(hits_tmp[i]));
+		shrinkwrap_project_normal_ray(vert[i], no, transf, &rays[i], &hits_tmp[i]);
+	}
+
+	BLI_bvhtree_ray_cast_batch(tree, rays, hits_tmp, numverts, callback, userdata);
+
+	for (i = 0; i < numverts; i++) {
+		if (negate) {
+			negate_v3_v3(no, dir[i]);
+		}
+		else {
+			copy_v3_v3(no, dir[i]);
+		}
+
+		shrinkwrap_project_normal_hit(options, vert[i], no, transf, &hits_tmp[i], &hits[i]);
+	}
+}
+
 
 static void shrinkwrap_calc_normal_projection(ShrinkwrapCalcData *calc, bool forRender)
 {
@@ -289,7 +354,6 @@ static void shrinkwrap_calc_normal_projection(ShrinkwrapCalcData *calc, bool for
 	/** \note 'hit.dist' is kept in the targets space, this is only used
 	 * for finding the best hit, to get the real dist,
 	 * measure the len_v3v3() from the input coord to hit.co */
-	BVHTreeRayHit hit;
 	BVHTreeFromMesh treeData = NULL_BVHTreeFromMesh;
 
 	/* auxiliary target */
@@ -333,84 +397,89 @@ static void shrinkwrap_calc_normal_projection(ShrinkwrapCalcData *calc, bool for
 	if (bvhtree_from_mesh_faces(&treeData, calc->target, 0.0, 4, 6) &&
 	    (auxMesh == NULL || bvhtree_from_mesh_faces(&auxData, auxMesh, 0.0, 4, 6)))
 	{
+		const size_t numVerts = (size_t)calc->numVerts;
+		float (*ray_co)[3] = MEM_mallocN(sizeof(*ray_co) * numVerts, __func__);
+		float (*ray_no)[3] = MEM_mallocN(sizeof(*ray_no) * numVerts, __func__);
+		BVHTreeRayHit *hits = MEM_mallocN(sizeof(*hits) * numVerts, __func__);
+		BVHTreeRay *rays = MEM_mallocN(sizeof(*rays) * numVerts, __func__);
+		BVHTreeRayHit *hits_tmp = MEM_mallocN(sizeof(*hits_tmp) * numVerts, __func__);
+		int dir;
 
-#ifndef __APPLE__
-#pragma omp parallel for private(i, hit) schedule(static)
-#endif
 		for (i = 0; i < calc->numVerts; ++i) {
 			float *co = calc->vertexCos[i];
-			float tmp_co[3], tmp_no[3];
 			const float weight = defvert_array_find_weight_safe(calc->dvert, i, calc->vgroup);
 
-			if (weight == 0.0f) {
-				continue;
-			}
-
 			if (calc->vert) {
 				/* calc->vert contains verts from derivedMesh  */
 				/* this coordinated are deformed by vertexCos only for normal projection (to get correct normals) */
 				/* for other cases calc->varts contains undeformed coordinates and vertexCos should be used */
 				if (calc->smd->projAxis == MOD_SHRINKWRAP_PROJECT_OVER_NORMAL) {
-					copy_v3_v3(tmp_co, calc->vert[i].co);
-					normal_short_to_float_v3(tmp_no, calc->vert[i].no);
+					copy_v3_v3(ray_co[i], calc->vert[i].co);
+					normal_short_to_float_v3(ray_no[i], calc->vert[i].no);
 				}
 				else {
-					copy_v3_v3(tmp_co, co);
-					copy_v3_v3(tmp_no, proj_axis);
+					copy_v3_v3(ray_co[i], co);
+					copy_v3_v3(ray_no[i], proj_axis);
 				}
 			}
 			else {
-				copy_v3_v3(tmp_co, co);
-				copy_v3_v3(tmp_no, proj_axis);
+				copy_v3_v3(ray_co[i], co);
+				copy_v3_v3(ray_no[i], proj_axis);
 			}
 
+			hits[i].index = -1;
+			/* TODO: we should use FLT_MAX here, but sweepsphere code isn't prepared for that.
+			 * Vertices with zero weight get a zero distance so their rays are skipped */
+			hits[i].dist = (weight == 0.0f) ? 0.0f : 10000.0f;
+		}
 
-			hit.index = -1;
-			hit.dist = 10000.0f; /* TODO: we should use FLT_MAX here, but sweepsphere code isn't prepared for that */
-
-			/* Project over positive direction of axis */
-			if (calc->smd->shrinkOpts & MOD_SHRINKWRAP_PROJECT_ALLOW_POS_DIR) {
-
-				if (auxData.tree) {
-					BKE_shrinkwrap_project_normal(0, tmp_co, tmp_no,
-					                              &local2aux, auxData.tree, &hit,
-					                              auxData.raycast_callback, &auxData);
-				}
+		/* Project all vertices over the positive direction of the axis, then over the negative one.
+		 * The hits of each step limit the distance of the next one */
+		for (dir = 0; dir < 2; dir++) {
+			const bool negate = (dir == 1);
 
-				BKE_shrinkwrap_project_normal(calc->smd->shrinkOpts, tmp_co, tmp_no,
-				                              &calc->local2target, treeData.tree, &hit,
-				                              treeData.raycast_callback, &treeData);
+			if (!(calc->smd->shrinkOpts & (negate ? MOD_SHRINKWRAP_PROJECT_ALLOW_NEG_DIR :
+			                                        MOD_SHRINKWRAP_PROJECT_ALLOW_POS_DIR)))
+			{
+				continue;
 			}
 
-			/* Project over negative direction of axis */
-			if (calc->smd->shrinkOpts & MOD_SHRINKWRAP_PROJECT_ALLOW_NEG_DIR) {
-				float inv_no[3];
-				negate_v3_v3(inv_no, tmp_no);
+			if (auxData.tree) {
+				shrinkwrap_project_normal_batch(0, (const float (*)[3])ray_co, (const float (*)[3])ray_no, negate,
+				                                &local2aux, auxData.tree, hits, calc->numVerts, rays, hits_tmp,
+				                                auxData.raycast_callback, &auxData);
+			}
 
-				if (auxData.tree) {
-					BKE_shrinkwrap_project_normal(0, tmp_co, inv_no,
-					                              &local2aux, auxData.tree, &hit,
-					                              auxData.raycast_callback, &auxData);
-				}
+			shrinkwrap_project_normal_batch(calc->smd->shrinkOpts, (const float (*)[3])ray_co, (const float (*)[3])ray_no,
+			                                negate, &calc->local2target, treeData.tree, hits, calc->numVerts,
+			                                rays, hits_tmp, treeData.raycast_callback, &treeData);
+		}
 
-				BKE_shrinkwrap_project_normal(calc->smd->shrinkOpts, tmp_co, inv_no,
-				                              &calc->local2target, treeData.tree, &hit,
-				                              treeData.raycast_callback, &treeData);
-			}
+		for (i = 0; i < calc->numVerts; ++i) {
+			float *co = calc->vertexCos[i];
+			BVHTreeRayHit *hit = &hits[i];
 
 			/* don't set the initial dist (which is more efficient),
 			 * because its calculated in the targets space, we want the dist in our own space */
-			if (proj_limit_squared != 0.0f) {
-				if (len_squared_v3v3(hit.co, co) > proj_limit_squared) {
-					hit.index = -1;
+			if (proj_limit_squared != 0.0f && hit->index != -1) {
+				if (len_squared_v3v3(hit->co, co) > proj_limit_squared) {
+					hit->index = -1;
 				}
 			}
 
-			if (hit.index != -1) {
-				madd_v3_v3v3fl(hit.co, hit.co, tmp_no, calc->keepDist);
-				interp_v3_v3v3(co, co, hit.co, weight);
+			if (hit->index != -1) {
+				const float weight = defvert_array_find_weight_safe(calc->dvert, i, calc->vgroup);
+
+				madd_v3_v3v3fl(hit->co, hit->co, ray_no[i], calc->keepDist);
+				interp_v3_v3v3(co, co, hit->co, weight);
 			}
 		}
+
+		MEM_freeN(ray_co);
+		MEM_freeN(ray_no);
+		MEM_freeN(hits);
+		MEM_freeN(rays);
+		MEM_freeN(hits_tmp);
 	}
 
 	/* free data structures */
@@ -429,7 +498,8 @@ static void shrinkwrap_calc_nearest_surface_point(ShrinkwrapCalcData *calc)
 	int i;
 
 	BVHTreeFromMesh treeData = NULL_BVHTreeFromMesh;
-	BVHTreeNearest nearest  = NULL_BVHTreeNearest;
+	float (*tree_co)[3];
+	BVHTreeNearest *nearest;
 
 	/* Create a bvh-tree of the given target */
 	bvhtree_from_mesh_faces(&treeData, calc->target, 0.0, 2, 6);
@@ -438,58 +508,37 @@ static void shrinkwrap_calc_nearest_surface_point(ShrinkwrapCalcData *calc)
 		return;
 	}
 
-	/* Setup nearest */
-	nearest.index = -1;
-	nearest.dist_sq = FLT_MAX;
+	tree_co = MEM_mallocN(sizeof(*tree_co) * (size_t)calc->numVerts, __func__);
+	nearest = MEM_mallocN(sizeof(*nearest) * (size_t)calc->numVerts, __func__);
 
+	/* Find the nearest surface point of all vertices at once */
+	shrinkwrap_nearest_batch_init(calc, tree_co, nearest);
+	BLI_bvhtree_find_nearest_batch(treeData.tree, (const float (*)[3])tree_co, nearest, calc->numVerts,
+	                               treeData.nearest_callback, &treeData);
 
-	/* Find the nearest vertex */
-#ifndef __APPLE__
-#pragma omp parallel for default(none) private(i) firstprivate(nearest) shared(calc, treeData) schedule(static)
-#endif
 	for (i = 0; i < calc->numVerts; ++i) {
 		float *co = calc->vertexCos[i];
-		float tmp_co[3];
-		float weight = defvert_array_find_weight_safe(calc->dvert, i, calc->vgroup);
-		if (weight == 0.0f) continue;
-
-		/* Convert the vertex to tree coordinates */
-		if (calc->vert) {
-			copy_v3_v3(tmp_co, calc->vert[i].co);
-		}
-		else {
-			copy_v3_v3(tmp_co, co);
-		}
-		space_transform_apply(&calc->local2target, tmp_co);
-
-		/* Use local proximity heuristics (to reduce the nearest search)
-		 *
-		 * If we already had an hit before.. we assume this vertex is going to have a close hit to that other vertex
-		 * so we can initiate the "nearest.dist" with the expected value to that last hit.
-		 * This will lead in pruning of the search tree. */
-		if (nearest.index != -1)
-			nearest.dist_sq = len_squared_v3v3(tmp_co, nearest.co);
-		else
-			nearest.dist_sq = FLT_MAX;
-
-		BLI_bvhtree_find_nearest(treeData.tree, tmp_co, &nearest, treeData.nearest_callback, &treeData);
+		float *tmp_co = tree_co[i];
+		float weight;
 
 		/* Found the nearest vertex */
-		if (nearest.index != -1) {
+		if (nearest[i].index != -1) {
+			weight = defvert_array_find_weight_safe(calc->dvert, i, calc->vgroup);
+
 			if (calc->smd->shrinkOpts & MOD_SHRINKWRAP_KEEP_ABOVE_SURFACE) {
 				/* Make the vertex stay on the front side of the face */
-				madd_v3_v3v3fl(tmp_co, nearest.co, nearest.no, calc->keepDist);
+				madd_v3_v3v3fl(tmp_co, nearest[i].co, nearest[i].no, calc->keepDist);
 			}
 			else {
 				/* Adjusting the vertex weight,
 				 * so that after interpolating it keeps a certain distance from the nearest position */
-				const float dist = sasqrt(nearest.dist_sq);
+				const float dist = sasqrt(nearest[i].dist_sq);
 				if (dist > FLT_EPSILON) {
 					/* linear interpolation */
-					interp_v3_v3v3(tmp_co, tmp_co, nearest.co, (dist - calc->keepDist) / dist);
+					interp_v3_v3v3(tmp_co, tmp_co, nearest[i].co, (dist - calc->keepDist) / dist);
 				}
 				else {
-					copy_v3_v3(tmp_co, nearest.co);
+					copy_v3_v3(tmp_co, nearest[i].co);
 				}
 			}
 
@@ -499,6 +548,9 @@ static void shrinkwrap_calc_nearest_surface_point(ShrinkwrapCalcData *calc)
 		}
 	}
 
+	MEM_freeN(tree_co);
+	MEM_freeN(nearest);
+
 	free_bvhtree_from_mesh(&treeData);
 }
 
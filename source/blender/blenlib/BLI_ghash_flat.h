@@ -0,0 +1,105 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+#ifndef __BLI_GHASH_FLAT_H__
+#define __BLI_GHASH_FLAT_H__
+
+/** \file BLI_ghash_flat.h
+ *  \ingroup bli
+ *  \brief A (pointer -> pointer) hash table ADT using open addressing.
+ *
+ * Same callbacks and semantics as #GHash, but entries are stored inline in
+ * one array instead of being allocated and chained per bucket, so lookups
+ * don't need to chase pointers. Use it for big tables with many lookups.
+ *
+ * \note Unlike #GHash, pointers returned by #BLI_ghashflat_lookup_p are only
+ * valid until the next insertion, since the table may be resized.
+ */
+
+#include "BLI_sys_types.h" /* for bool */
+#include "BLI_compiler_attrs.h"
+#include "BLI_ghash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct GHashFlat GHashFlat;
+
+typedef struct GHashFlatIterator {
+	GHashFlat *gh;
+	unsigned int curIndex;
+} GHashFlatIterator;
+
+enum {
+	GHASHFLAT_FLAG_ALLOW_DUPES = (1 << 0),  /* only checked for in debug mode */
+};
+
+/* *** */
+
+GHashFlat *BLI_ghashflat_new_ex(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info,
+                                const unsigned int nentries_reserve) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+GHashFlat *BLI_ghashflat_new(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+void   BLI_ghashflat_free(GHashFlat *gh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+void   BLI_ghashflat_insert(GHashFlat *gh, void *key, void *val);
+bool   BLI_ghashflat_reinsert(GHashFlat *gh, void *key, void *val, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+void  *BLI_ghashflat_lookup(GHashFlat *gh, const void *key) ATTR_WARN_UNUSED_RESULT;
+void **BLI_ghashflat_lookup_p(GHashFlat *gh, const void *key) ATTR_WARN_UNUSED_RESULT;
+bool   BLI_ghashflat_remove(GHashFlat *gh, void *key, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+void   BLI_ghashflat_clear(GHashFlat *gh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+void   BLI_ghashflat_clear_ex(GHashFlat *gh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp,
+                              const unsigned int nentries_reserve);
+void  *BLI_ghashflat_popkey(GHashFlat *gh, void *key, GHashKeyFreeFP keyfreefp) ATTR_WARN_UNUSED_RESULT;
+bool   BLI_ghashflat_haskey(GHashFlat *gh, const void *key) ATTR_WARN_UNUSED_RESULT;
+int    BLI_ghashflat_size(GHashFlat *gh) ATTR_WARN_UNUSED_RESULT;
+void   BLI_ghashflat_flag_set(GHashFlat *gh, unsigned int flag);
+void   BLI_ghashflat_flag_clear(GHashFlat *gh, unsigned int flag);
+
+/* *** */
+
+void   BLI_ghashflatIterator_init(GHashFlatIterator *ghi, GHashFlat *gh);
+void  *BLI_ghashflatIterator_getKey(GHashFlatIterator *ghi) ATTR_WARN_UNUSED_RESULT;
+void  *BLI_ghashflatIterator_getValue(GHashFlatIterator *ghi) ATTR_WARN_UNUSED_RESULT;
+void **BLI_ghashflatIterator_getValue_p(GHashFlatIterator *ghi) ATTR_WARN_UNUSED_RESULT;
+void   BLI_ghashflatIterator_step(GHashFlatIterator *ghi);
+bool   BLI_ghashflatIterator_done(GHashFlatIterator *ghi) ATTR_WARN_UNUSED_RESULT;
+
+#define GHASHFLAT_ITER(gh_iter_, ghash_)                                      \
+	for (BLI_ghashflatIterator_init(&gh_iter_, ghash_);                       \
+	     BLI_ghashflatIterator_done(&gh_iter_) == false;                      \
+	     BLI_ghashflatIterator_step(&gh_iter_))
+
+/* *** */
+
+GHashFlat *BLI_ghashflat_ptr_new_ex(const char *info,
+                                    const unsigned int nentries_reserve) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+GHashFlat *BLI_ghashflat_ptr_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+GHashFlat *BLI_ghashflat_str_new_ex(const char *info,
+                                    const unsigned int nentries_reserve) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+GHashFlat *BLI_ghashflat_str_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+GHashFlat *BLI_ghashflat_int_new_ex(const char *info,
+                                    const unsigned int nentries_reserve) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+GHashFlat *BLI_ghashflat_int_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BLI_GHASH_FLAT_H__ */
@@ -105,6 +105,13 @@ int BLI_bvhtree_find_nearest(BVHTree *tree, const float co[3], BVHTreeNearest *n
 int BLI_bvhtree_ray_cast(BVHTree *tree, const float co[3], const float dir[3], float radius, BVHTreeRayHit *hit,
                          BVHTree_RayCastCallback callback, void *userdata);
 
+/* batch queries: same as above for many points or rays at once, split over multiple threads,
+ * callbacks must be thread safe */
+void BLI_bvhtree_find_nearest_batch(BVHTree *tree, const float (*co)[3], BVHTreeNearest *nearest, int numco,
+                                    BVHTree_NearestPointCallback callback, void *userdata);
+void BLI_bvhtree_ray_cast_batch(BVHTree *tree, const BVHTreeRay *rays, BVHTreeRayHit *hits, int numrays,
+                                BVHTree_RayCastCallback callback, void *userdata);
+
 float BLI_bvhtree_bb_raycast(const float bv[6], const float light_start[3], const float light_end[3], float pos[3]);
 
 /* range query */
@@ -57,4 +57,12 @@ int BLI_kdtree_range_search(KDTree *tree, const float co[3], const float nor[3],
                             KDTreeNearest **r_nearest,
                             float range) ATTR_NONNULL(1, 2, 4) ATTR_WARN_UNUSED_RESULT;
 
+/* batch queries, run multithreaded */
+void BLI_kdtree_find_nearest_n_batch(KDTree *tree, const float (*co)[3], const float (*nor)[3], unsigned int totco,
+                                     KDTreeNearest *r_nearest, int *r_found,
+                                     unsigned int n) ATTR_NONNULL(1, 2, 5);
+KDTreeNearest *BLI_kdtree_range_search_batch(KDTree *tree, const float (*co)[3], const float (*nor)[3],
+                                             unsigned int totco, float range,
+                                             unsigned int *r_offsets) ATTR_NONNULL(1, 2, 6) ATTR_WARN_UNUSED_RESULT;
+
 #endif  /* __BLI_KDTREE_H__ */
@@ -34,8 +34,11 @@ extern "C" {
 
 /* Task Scheduler
  * 
- * Central scheduler that holds running threads ready to execute tasks. A single
- * queue holds the task from all pools.
+ * Central scheduler that holds running threads ready to execute tasks. Every
+ * thread has its own queue holding tasks from all pools, threads that run out
+ * of work steal tasks from the queues of other threads. Tasks pushed with high
+ * priority go to a queue shared by all threads, they are executed before any
+ * queued low priority task.
  *
  * Init/exit must be called before/after any task pools are created/freed, and
  * must be called from the main threads. All other scheduler and pool functions
@@ -52,6 +55,8 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads);
 void BLI_task_scheduler_free(TaskScheduler *scheduler);
 
 int BLI_task_scheduler_num_threads(TaskScheduler *scheduler);
+/* id of the calling thread, 0 for threads not owned by the scheduler */
+int BLI_task_scheduler_thread_id(TaskScheduler *scheduler);
 
 /* Task Pool
  *
@@ -100,6 +105,56 @@ ThreadMutex *BLI_task_pool_user_mutex(TaskPool *pool);
 /* number of tasks done, for stats, don't use this to make decisions */
 size_t BLI_task_pool_tasks_done(TaskPool *pool);
 
+/* Parallel for routines
+ *
+ * Run func for each item of a range or a ListBase, using the global task
+ * scheduler. Small ranges are executed serially on the calling thread.
+ *
+ * userdata_chunk is optional per-task data of userdata_chunk_size bytes: every
+ * task works on its own copy of it (initialized from the given chunk), which
+ * allows reductions without locking. Once all iterations are done, func_finalize
+ * is called from the calling thread for each of the copies, in order, so they
+ * can be accumulated into userdata.
+ */
+
+/* default number of iterations below which ranges are not threaded */
+#define TASK_PARALLEL_RANGE_THRESHOLD 64
+
+typedef void (*TaskParallelRangeFunc)(void *userdata, void *userdata_chunk, int iter);
+typedef void (*TaskParallelRangeFuncFinalize)(void *userdata, void *userdata_chunk);
+
+void BLI_task_parallel_range_ex(
+        int start, int stop,
+        void *userdata,
+        void *userdata_chunk,
+        const size_t userdata_chunk_size,
+        TaskParallelRangeFunc func,
+        TaskParallelRangeFuncFinalize func_finalize,
+        const int range_threshold,
+        const bool use_dynamic_scheduling);
+void BLI_task_parallel_range(
+        int start, int stop,
+        void *userdata,
+        TaskParallelRangeFunc func);
+void BLI_task_parallel_reduce(
+        int start, int stop,
+        void *userdata,
+        void *userdata_chunk,
+        const size_t userdata_chunk_size,
+        TaskParallelRangeFunc func,
+        TaskParallelRangeFuncFinalize func_finalize);
+
+struct ListBase;
+struct Link;
+
+typedef void (*TaskParallelListbaseFunc)(void *userdata, struct Link *iter, int index);
+
+void BLI_task_parallel_listbase(
+        struct ListBase *listbase,
+        void *userdata,
+        TaskParallelListbaseFunc func,
+        const bool use_threading);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,709 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file blender/blenlib/intern/BLI_ghash_flat.c
+ *  \ingroup bli
+ *
+ * A (pointer -> pointer) hash table ADT using open addressing.
+ *
+ * Slots are organized in groups of #GROUP_SIZE. Next to the entries there is
+ * one control byte per slot, which is either empty, deleted, or holds 7 bits
+ * of the hash of the key in the slot. Lookups compare all control bytes of a
+ * group at once (using SSE2 when available), and only call the comparison
+ * callback for slots with a matching hash fragment. Groups are probed
+ * quadratically, a lookup ends at the first group with an empty slot.
+ *
+ * \note Keep the API in sync with BLI_ghash.c.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define USE_SSE2
+#endif
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_sys_types.h"  /* for intptr_t support */
+#include "BLI_utildefines.h"
+#include "BLI_ghash_flat.h"
+#include "BLI_strict_flags.h"
+
+#define GROUP_SIZE 16
+
+#define CTRL_EMPTY   ((unsigned char)0x80)
+#define CTRL_DELETED ((unsigned char)0xFE)
+/* full slots have the high bit cleared */
+#define CTRL_IS_FULL(c) (((c) & 0x80) == 0)
+
+typedef struct FlatEntry {
+	void *key, *val;
+} FlatEntry;
+
+struct GHashFlat {
+	GHashHashFP hashfp;
+	GHashCmpFP cmpfp;
+
+	unsigned char *ctrl;
+	FlatEntry *entries;
+	unsigned int nslots;  /* power of two, at least GROUP_SIZE */
+	unsigned int nentries;
+	unsigned int ndeleted;
+	unsigned int flag;
+};
+
+#define SLOT_NONE UINT_MAX
+
+
+/* -------------------------------------------------------------------- */
+/* GHashFlat API */
+
+/** \name Internal Utility API
+ * \{ */
+
+BLI_INLINE unsigned int ghashflat_keyhash(GHashFlat *gh, const void *key)
+{
+	return gh->hashfp(key);
+}
+
+/**
+ * Hash fragment stored in the control bytes, taken from the high bits of a
+ * multiplicative hash so it's independent from the group index.
+ */
+BLI_INLINE unsigned char ghashflat_hash_ctrl(const unsigned int hash)
+{
+	return (unsigned char)((hash * 2654435769u) >> 25);
+}
+
+/**
+ * First group to probe. Low bits of the hash are used mostly unchanged, so
+ * keys with nearby hashes (like pointers allocated in sequence) end up in
+ * nearby groups, which keeps access patterns cache friendly.
+ */
+BLI_INLINE unsigned int ghashflat_hash_group(GHashFlat *gh, const unsigned int hash)
+{
+	return (hash ^ (hash >> 16)) & (gh->nslots / GROUP_SIZE - 1);
+}
+
+BLI_INLINE unsigned int bitscan_forward(unsigned int mask)
+{
+	BLI_assert(mask != 0);
+#if defined(__GNUC__)
+	return (unsigned int)__builtin_ctz(mask);
+#else
+	{
+		unsigned int i = 0;
+		while ((mask & 1) == 0) {
+			mask >>= 1;
+			i++;
+		}
+		return i;
+	}
+#endif
+}
+
+/**
+ * \return a bit mask of the slots in the group which have control byte \a c.
+ */
+BLI_INLINE unsigned int group_match(const unsigned char *ctrl, const unsigned char c)
+{
+#ifdef USE_SSE2
+	const __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+	return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)c)));
+#else
+	unsigned int mask = 0, i;
+	for (i = 0; i < GROUP_SIZE; i++) {
+		if (ctrl[i] == c) {
+			mask |= 1u << i;
+		}
+	}
+	return mask;
+#endif
+}
+
+/**
+ * \return a bit mask of the slots in the group which are empty or deleted.
+ */
+BLI_INLINE unsigned int group_match_free(const unsigned char *ctrl)
+{
+#ifdef USE_SSE2
+	const __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+	return (unsigned int)_mm_movemask_epi8(group);
+#else
+	unsigned int mask = 0, i;
+	for (i = 0; i < GROUP_SIZE; i++) {
+		if (!CTRL_IS_FULL(ctrl[i])) {
+			mask |= 1u << i;
+		}
+	}
+	return mask;
+#endif
+}
+
+/**
+ * Number of slots needed to store \a nentries without resizing,
+ * the table is kept at most 7/8th full.
+ */
+static unsigned int ghashflat_nslots_for_entries(const unsigned int nentries)
+{
+	unsigned int nslots = GROUP_SIZE;
+
+	while (nslots - nslots / 8 <= nentries) {
+		nslots *= 2;
+	}
+
+	return nslots;
+}
+
+static void ghashflat_slots_alloc(GHashFlat *gh, const unsigned int nslots)
+{
+	gh->nslots = nslots;
+	gh->ctrl = MEM_mallocN(sizeof(*gh->ctrl) * nslots, "GHashFlat ctrl");
+	gh->entries = MEM_mallocN(sizeof(*gh->entries) * nslots, "GHashFlat entries");
+	memset(gh->ctrl, CTRL_EMPTY, sizeof(*gh->ctrl) * nslots);
+	gh->ndeleted = 0;
+}
+
+/**
+ * Find a free slot for a key with this hash, the key is not checked for.
+ */
+BLI_INLINE unsigned int ghashflat_find_free_slot(GHashFlat *gh, const unsigned int hash)
+{
+	const unsigned int group_mask = gh->nslots / GROUP_SIZE - 1;
+	unsigned int group = ghashflat_hash_group(gh, hash);
+	unsigned int step = 0;
+
+	while (true) {
+		const unsigned int mask = group_match_free(gh->ctrl + group * GROUP_SIZE);
+
+		if (mask) {
+			return group * GROUP_SIZE + bitscan_forward(mask);
+		}
+
+		/* triangular numbers visit every group when their count is a power of two */
+		step++;
+		group = (group + step) & group_mask;
+	}
+}
+
+/**
+ * Internal lookup function.
+ * Takes a hash argument to avoid calling #ghashflat_keyhash multiple times.
+ *
+ * \return the slot index of \a key or #SLOT_NONE.
+ */
+BLI_INLINE unsigned int ghashflat_lookup_slot_ex(GHashFlat *gh, const void *key,
+                                                 const unsigned int hash)
+{
+	const unsigned int group_mask = gh->nslots / GROUP_SIZE - 1;
+	const unsigned char c = ghashflat_hash_ctrl(hash);
+	unsigned int group = ghashflat_hash_group(gh, hash);
+	unsigned int step = 0;
+
+	while (true) {
+		const unsigned char *ctrl = gh->ctrl + group * GROUP_SIZE;
+		unsigned int mask = group_match(ctrl, c);
+
+		while (mask) {
+			const unsigned int slot = group * GROUP_SIZE + bitscan_forward(mask);
+			if (LIKELY(gh->cmpfp(key, gh->entries[slot].key) == 0)) {
+				return slot;
+			}
+			mask &= mask - 1;
+		}
+
+		/* an empty slot means the key was never inserted further on */
+		if (group_match(ctrl, CTRL_EMPTY)) {
+			return SLOT_NONE;
+		}
+
+		step++;
+		group = (group + step) & group_mask;
+	}
+}
+
+BLI_INLINE unsigned int ghashflat_lookup_slot(GHashFlat *gh, const void *key)
+{
+	const unsigned int hash = ghashflat_keyhash(gh, key);
+	return ghashflat_lookup_slot_ex(gh, key, hash);
+}
+
+/**
+ * Re-insert all entries in a table of \a nslots slots,
+ * this also gets rid of deleted slots.
+ */
+static void ghashflat_resize(GHashFlat *gh, const unsigned int nslots)
+{
+	unsigned char *ctrl_old = gh->ctrl;
+	FlatEntry *entries_old = gh->entries;
+	const unsigned int nslots_old = gh->nslots;
+	unsigned int i;
+
+	ghashflat_slots_alloc(gh, nslots);
+
+	for (i = 0; i < nslots_old; i++) {
+		if (CTRL_IS_FULL(ctrl_old[i])) {
+			const unsigned int hash = ghashflat_keyhash(gh, entries_old[i].key);
+			const unsigned int slot = ghashflat_find_free_slot(gh, hash);
+
+			gh->ctrl[slot] = ghashflat_hash_ctrl(hash);
+			gh->entries[slot] = entries_old[i];
+		}
+	}
+
+	MEM_freeN(ctrl_old);
+	MEM_freeN(entries_old);
+}
+
+/**
+ * Make room for one more entry.
+ */
+BLI_INLINE void ghashflat_ensure_free_slot(GHashFlat *gh)
+{
+	if (UNLIKELY(gh->nentries + gh->ndeleted + 1 > gh->nslots - gh->nslots / 8)) {
+		/* only grow when the table is really full, not just when there are
+		 * many deleted slots from removing entries */
+		ghashflat_resize(gh, ghashflat_nslots_for_entries(gh->nentries + 1));
+	}
+}
+
+/**
+ * Internal insert function.
+ * Takes a hash argument to avoid calling #ghashflat_keyhash multiple times.
+ */
+BLI_INLINE void ghashflat_insert_ex(GHashFlat *gh, void *key, void *val,
+                                    const unsigned int hash)
+{
+	unsigned int slot;
+
+	BLI_assert((gh->flag & GHASHFLAT_FLAG_ALLOW_DUPES) || (BLI_ghashflat_haskey(gh, key) == 0));
+
+	ghashflat_ensure_free_slot(gh);
+
+	slot = ghashflat_find_free_slot(gh, hash);
+	if (gh->ctrl[slot] == CTRL_DELETED) {
+		gh->ndeleted--;
+	}
+
+	gh->ctrl[slot] = ghashflat_hash_ctrl(hash);
+	gh->entries[slot].key = key;
+	gh->entries[slot].val = val;
+	gh->nentries++;
+}
+
+/**
+ * Remove the entry in \a slot.
+ */
+static void ghashflat_remove_slot(GHashFlat *gh, const unsigned int slot)
+{
+	const unsigned char *ctrl_group = gh->ctrl + (slot & ~(unsigned int)(GROUP_SIZE - 1));
+
+	/* when the group still has an empty slot, lookups never probed past it,
+	 * so the slot can be made empty again instead of leaving a tombstone */
+	if (group_match(ctrl_group, CTRL_EMPTY)) {
+		gh->ctrl[slot] = CTRL_EMPTY;
+	}
+	else {
+		gh->ctrl[slot] = CTRL_DELETED;
+		gh->ndeleted++;
+	}
+
+	gh->nentries--;
+}
+
+/**
+ * Run free callbacks for freeing entries.
+ */
+static void ghashflat_free_cb(GHashFlat *gh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	unsigned int i;
+
+	BLI_assert(keyfreefp || valfreefp);
+
+	for (i = 0; i < gh->nslots; i++) {
+		if (CTRL_IS_FULL(gh->ctrl[i])) {
+			if (keyfreefp) keyfreefp(gh->entries[i].key);
+			if (valfreefp) valfreefp(gh->entries[i].val);
+		}
+	}
+}
+/** \} */
+
+
+/** \name Public API
+ * \{ */
+
+/**
+ * Creates a new, empty GHashFlat.
+ *
+ * \param hashfp  Hash callback.
+ * \param cmpfp  Comparison callback.
+ * \param info  Identifier string for the GHashFlat.
+ * \param nentries_reserve  Optionally reserve the number of members that the hash will hold.
+ * Use this to avoid resizing if the size is known or can be closely approximated.
+ * \return  An empty GHashFlat.
+ */
+GHashFlat *BLI_ghashflat_new_ex(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info,
+                                const unsigned int nentries_reserve)
+{
+	GHashFlat *gh = MEM_mallocN(sizeof(*gh), info);
+
+	gh->hashfp = hashfp;
+	gh->cmpfp = cmpfp;
+
+	gh->nentries = 0;
+	gh->flag = 0;
+
+	ghashflat_slots_alloc(gh, ghashflat_nslots_for_entries(nentries_reserve));
+
+	return gh;
+}
+
+/**
+ * Wraps #BLI_ghashflat_new_ex with zero entries reserved.
+ */
+GHashFlat *BLI_ghashflat_new(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info)
+{
+	return BLI_ghashflat_new_ex(hashfp, cmpfp, info, 0);
+}
+
+/**
+ * \return size of the GHashFlat.
+ */
+int BLI_ghashflat_size(GHashFlat *gh)
+{
+	return (int)gh->nentries;
+}
+
+/**
+ * Insert a key/value pair into the \a gh.
+ *
+ * \note Duplicates are not checked,
+ * the caller is expected to ensure elements are unique unless
+ * GHASHFLAT_FLAG_ALLOW_DUPES flag is set.
+ */
+void BLI_ghashflat_insert(GHashFlat *gh, void *key, void *val)
+{
+	const unsigned int hash = ghashflat_keyhash(gh, key);
+	ghashflat_insert_ex(gh, key, val, hash);
+}
+
+/**
+ * Inserts a new value to a key that may already be in ghash.
+ *
+ * Avoids #BLI_ghashflat_remove, #BLI_ghashflat_insert calls (double lookups)
+ *
+ * \returns true if a new key has been added.
+ */
+bool BLI_ghashflat_reinsert(GHashFlat *gh, void *key, void *val, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	const unsigned int hash = ghashflat_keyhash(gh, key);
+	const unsigned int slot = ghashflat_lookup_slot_ex(gh, key, hash);
+	if (slot != SLOT_NONE) {
+		FlatEntry *e = &gh->entries[slot];
+		if (keyfreefp) keyfreefp(e->key);
+		if (valfreefp) valfreefp(e->val);
+		e->key = key;
+		e->val = val;
+		return false;
+	}
+	else {
+		ghashflat_insert_ex(gh, key, val, hash);
+		return true;
+	}
+}
+
+/**
+ * Lookup the value of \a key in \a gh.
+ *
+ * \param key  The key to lookup.
+ * \returns the value for \a key or NULL.
+ */
+void *BLI_ghashflat_lookup(GHashFlat *gh, const void *key)
+{
+	const unsigned int slot = ghashflat_lookup_slot(gh, key);
+	return (slot != SLOT_NONE) ? gh->entries[slot].val : NULL;
+}
+
+/**
+ * Lookup a pointer to the value of \a key in \a gh.
+ *
+ * \param key  The key to lookup.
+ * \returns the pointer to value for \a key or NULL.
+ *
+ * \note The pointer is only valid until the next insertion.
+ */
+void **BLI_ghashflat_lookup_p(GHashFlat *gh, const void *key)
+{
+	const unsigned int slot = ghashflat_lookup_slot(gh, key);
+	return (slot != SLOT_NONE) ? &gh->entries[slot].val : NULL;
+}
+
+/**
+ * Remove \a key from \a gh, or return false if the key wasn't found.
+ *
+ * \param key  The key to remove.
+ * \param keyfreefp  Optional callback to free the key.
+ * \param valfreefp  Optional callback to free the value.
+ * \return true if \a key was removed from \a gh.
+ */
+bool BLI_ghashflat_remove(GHashFlat *gh, void *key, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	const unsigned int slot = ghashflat_lookup_slot(gh, key);
+	if (slot != SLOT_NONE) {
+		FlatEntry *e = &gh->entries[slot];
+		if (keyfreefp) keyfreefp(e->key);
+		if (valfreefp) valfreefp(e->val);
+		ghashflat_remove_slot(gh, slot);
+		return true;
+	}
+	else {
+		return false;
+	}
+}
+
+/**
+ * Remove \a key from \a gh, returning the value or NULL if the key wasn't found.
+ *
+ * \param key  The key to remove.
+ * \param keyfreefp  Optional callback to free the key.
+ * \return the value of \a key int \a gh or NULL.
+ */
+void *BLI_ghashflat_popkey(GHashFlat *gh, void *key, GHashKeyFreeFP keyfreefp)
+{
+	const unsigned int slot = ghashflat_lookup_slot(gh, key);
+	if (slot != SLOT_NONE) {
+		FlatEntry *e = &gh->entries[slot];
+		void *val = e->val;
+		if (keyfreefp) keyfreefp(e->key);
+		ghashflat_remove_slot(gh, slot);
+		return val;
+	}
+	else {
+		return NULL;
+	}
+}
+
+/**
+ * \return true if the \a key is in \a gh.
+ */
+bool BLI_ghashflat_haskey(GHashFlat *gh, const void *key)
+{
+	return (ghashflat_lookup_slot(gh, key) != SLOT_NONE);
+}
+
+/**
+ * Reset \a gh clearing all entries.
+ *
+ * \param keyfreefp  Optional callback to free the key.
+ * \param valfreefp  Optional callback to free the value.
+ * \param nentries_reserve  Optionally reserve the number of members that the hash will hold.
+ */
+void BLI_ghashflat_clear_ex(GHashFlat *gh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp,
+                            const unsigned int nentries_reserve)
+{
+	if (keyfreefp || valfreefp)
+		ghashflat_free_cb(gh, keyfreefp, valfreefp);
+
+	MEM_freeN(gh->ctrl);
+	MEM_freeN(gh->entries);
+
+	gh->nentries = 0;
+	ghashflat_slots_alloc(gh, ghashflat_nslots_for_entries(nentries_reserve));
+}
+
+/**
+ * Wraps #BLI_ghashflat_clear_ex with zero entries reserved.
+ */
+void BLI_ghashflat_clear(GHashFlat *gh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	BLI_ghashflat_clear_ex(gh, keyfreefp, valfreefp, 0);
+}
+
+/**
+ * Frees the GHashFlat and its members.
+ *
+ * \param gh  The GHashFlat to free.
+ * \param keyfreefp  Optional callback to free the key.
+ * \param valfreefp  Optional callback to free the value.
+ */
+void BLI_ghashflat_free(GHashFlat *gh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	if (keyfreefp || valfreefp)
+		ghashflat_free_cb(gh, keyfreefp, valfreefp);
+
+	MEM_freeN(gh->ctrl);
+	MEM_freeN(gh->entries);
+	MEM_freeN(gh);
+}
+
+/**
+ * Sets a GHashFlat flag.
+ */
+void BLI_ghashflat_flag_set(GHashFlat *gh, unsigned int flag)
+{
+	gh->flag |= flag;
+}
+
+/**
+ * Clear a GHashFlat flag.
+ */
+void BLI_ghashflat_flag_clear(GHashFlat *gh, unsigned int flag)
+{
+	gh->flag &= ~flag;
+}
+
+/** \} */
+
+
+/* -------------------------------------------------------------------- */
+/* GHashFlat Iterator API */
+
+/** \name Iterator API
+ * \{ */
+
+BLI_INLINE void ghashflat_iterator_skip_free(GHashFlatIterator *ghi)
+{
+	const GHashFlat *gh = ghi->gh;
+
+	while (ghi->curIndex < gh->nslots && !CTRL_IS_FULL(gh->ctrl[ghi->curIndex])) {
+		ghi->curIndex++;
+	}
+}
+
+/**
+ * Init an already allocated GHashFlatIterator. The hash table must not
+ * be mutated while the iterator is in use, and the iterator will
+ * step exactly BLI_ghashflat_size(gh) times before becoming done.
+ *
+ * \param ghi The GHashFlatIterator to initialize.
+ * \param gh The GHashFlat to iterate over.
+ */
+void BLI_ghashflatIterator_init(GHashFlatIterator *ghi, GHashFlat *gh)
+{
+	ghi->gh = gh;
+	ghi->curIndex = 0;
+	ghashflat_iterator_skip_free(ghi);
+}
+
+/**
+ * Retrieve the key from an iterator.
+ *
+ * \param ghi The iterator.
+ * \return The key at the current index, or NULL if the
+ * iterator is done.
+ */
+void *BLI_ghashflatIterator_getKey(GHashFlatIterator *ghi)
+{
+	return (ghi->curIndex < ghi->gh->nslots) ? ghi->gh->entries[ghi->curIndex].key : NULL;
+}
+
+/**
+ * Retrieve the value from an iterator.
+ *
+ * \param ghi The iterator.
+ * \return The value at the current index, or NULL if the
+ * iterator is done.
+ */
+void *BLI_ghashflatIterator_getValue(GHashFlatIterator *ghi)
+{
+	return (ghi->curIndex < ghi->gh->nslots) ? ghi->gh->entries[ghi->curIndex].val : NULL;
+}
+
+/**
+ * Retrieve a pointer to the value from an iterator.
+ *
+ * \param ghi The iterator.
+ * \return The pointer to the value at the current index, or NULL if the
+ * iterator is done.
+ */
+void **BLI_ghashflatIterator_getValue_p(GHashFlatIterator *ghi)
+{
+	return (ghi->curIndex < ghi->gh->nslots) ? &ghi->gh->entries[ghi->curIndex].val : NULL;
+}
+
+/**
+ * Steps the iterator to the next index.
+ *
+ * \param ghi The iterator.
+ */
+void BLI_ghashflatIterator_step(GHashFlatIterator *ghi)
+{
+	if (ghi->curIndex < ghi->gh->nslots) {
+		ghi->curIndex++;
+		ghashflat_iterator_skip_free(ghi);
+	}
+}
+
+/**
+ * Determine if an iterator is done (has reached the end of
+ * the hash table).
+ *
+ * \param ghi The iterator.
+ * \return True if done, False otherwise.
+ */
+bool BLI_ghashflatIterator_done(GHashFlatIterator *ghi)
+{
+	return ghi->curIndex >= ghi->gh->nslots;
+}
+
+/** \} */
+
+
+/** \name Convenience GHashFlat Creation Functions
+ * \{ */
+
+GHashFlat *BLI_ghashflat_ptr_new_ex(const char *info,
+                                    const unsigned int nentries_reserve)
+{
+	return BLI_ghashflat_new_ex(BLI_ghashutil_ptrhash, BLI_ghashutil_ptrcmp, info,
+	                            nentries_reserve);
+}
+GHashFlat *BLI_ghashflat_ptr_new(const char *info)
+{
+	return BLI_ghashflat_ptr_new_ex(info, 0);
+}
+
+GHashFlat *BLI_ghashflat_str_new_ex(const char *info,
+                                    const unsigned int nentries_reserve)
+{
+	return BLI_ghashflat_new_ex(BLI_ghashutil_strhash, BLI_ghashutil_strcmp, info,
+	                            nentries_reserve);
+}
+GHashFlat *BLI_ghashflat_str_new(const char *info)
+{
+	return BLI_ghashflat_str_new_ex(info, 0);
+}
+
+GHashFlat *BLI_ghashflat_int_new_ex(const char *info,
+                                    const unsigned int nentries_reserve)
+{
+	return BLI_ghashflat_new_ex(BLI_ghashutil_inthash, BLI_ghashutil_intcmp, info,
+	                            nentries_reserve);
+}
+GHashFlat *BLI_ghashflat_int_new(const char *info)
+{
+	return BLI_ghashflat_int_new_ex(info, 0);
+}
+
+/** \} */
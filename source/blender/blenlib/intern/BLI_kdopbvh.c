@@ -30,20 +30,26 @@
  */
 
 #include <assert.h>
+#include <limits.h>
 
 #include "MEM_guardedalloc.h"
 
 #include "BLI_utildefines.h"
 #include "BLI_kdopbvh.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 #include "BLI_strict_flags.h"
 
-#ifdef _OPENMP
-#include <omp.h>
-#endif
-
 #define MAX_TREETYPE 32
 
+/* Trees with less leafs than this are built and queried from the calling thread,
+ * for smaller trees the overhead of threading is bigger than the work done. */
+#define KDOPBVH_THREAD_LEAF_THRESHOLD 1024
+
+/* Number of queries of a batch handled by a single task,
+ * consecutive queries of a task reuse the result of the previous one. */
+#define KDOPBVH_BATCH_CHUNK_SIZE 256
+
 typedef unsigned char axis_t;
 
 typedef struct BVHNode {
@@ -689,6 +695,82 @@ static void split_leafs(BVHNode **leafs_array, int *nth, int partitions, int spl
 	}
 }
 
+typedef struct BVHDivNodesData {
+	BVHTree *tree;
+	BVHNode *branches_array;
+	BVHNode **leafs_array;
+
+	int tree_type;
+	int tree_offset;
+
+	BVHBuildHelper *data;
+
+	int depth;
+	int i;
+	int first_of_next_level;
+} BVHDivNodesData;
+
+static void non_recursive_bvh_div_nodes_task_cb(void *userdata, void *UNUSED(userdata_chunk), int j)
+{
+	BVHDivNodesData *data = userdata;
+
+	int k;
+	const int parent_level_index = j - data->i;
+	BVHNode *parent = data->branches_array + j;
+	int nth_positions[MAX_TREETYPE + 1];
+	char split_axis;
+
+	int parent_leafs_begin = implicit_leafs_index(data->data, data->depth, parent_level_index);
+	int parent_leafs_end   = implicit_leafs_index(data->data, data->depth, parent_level_index + 1);
+
+	/* This calculates the bounding box of this branch
+	 * and chooses the largest axis as the axis to divide leafs */
+	refit_kdop_hull(data->tree, parent, parent_leafs_begin, parent_leafs_end);
+	split_axis = get_largest_axis(parent->bv);
+
+	/* Save split axis (this can be used on raytracing to speedup the query time) */
+	parent->main_axis = split_axis / 2;
+
+	/* Split the childs along the split_axis, note: its not needed to sort the whole leafs array
+	 * Only to assure that the elements are partitioned on a way that each child takes the elements
+	 * it would take in case the whole array was sorted.
+	 * Split_leafs takes care of that "sort" problem. */
+	nth_positions[0] = parent_leafs_begin;
+	nth_positions[data->tree_type] = parent_leafs_end;
+	for (k = 1; k < data->tree_type; k++) {
+		const int child_index = j * data->tree_type + data->tree_offset + k;
+		const int child_level_index = child_index - data->first_of_next_level; /* child level index */
+		nth_positions[k] = implicit_leafs_index(data->data, data->depth + 1, child_level_index);
+	}
+
+	split_leafs(data->leafs_array, nth_positions, data->tree_type, split_axis);
+
+
+	/* Setup children and totnode counters
+	 * Not really needed but currently most of BVH code relies on having an explicit children structure */
+	for (k = 0; k < data->tree_type; k++) {
+		const int child_index = j * data->tree_type + data->tree_offset + k;
+		const int child_level_index = child_index - data->first_of_next_level; /* child level index */
+
+		const int child_leafs_begin = implicit_leafs_index(data->data, data->depth + 1, child_level_index);
+		const int child_leafs_end   = implicit_leafs_index(data->data, data->depth + 1, child_level_index + 1);
+
+		if (child_leafs_end - child_leafs_begin > 1) {
+			parent->children[k] = data->branches_array + child_index;
+			parent->children[k]->parent = parent;
+		}
+		else if (child_leafs_end - child_leafs_begin == 1) {
+			parent->children[k] = data->leafs_array[child_leafs_begin];
+			parent->children[k]->parent = parent;
+		}
+		else {
+			break;
+		}
+
+		parent->totnode = (char)(k + 1);
+	}
+}
+
 /*
  * This functions builds an optimal implicit tree from the given leafs.
  * Where optimal stands for:
@@ -713,7 +795,12 @@ static void non_recursive_bvh_div_nodes(BVHTree *tree, BVHNode *branches_array,
 	const int tree_offset = 2 - tree->tree_type; /* this value is 0 (on binary trees) and negative on the others */
 	const int num_branches = implicit_needed_branches(tree_type, num_leafs);
 
+	/* Branches of a level are split in parallel, even when there are only a few of them,
+	 * since the top levels have the most leafs to partition */
+	const int range_threshold = (num_leafs >= KDOPBVH_THREAD_LEAF_THRESHOLD) ? 2 : INT_MAX;
+
 	BVHBuildHelper data;
+	BVHDivNodesData cb_data;
 	int depth;
 	
 	/* set parent from root node to NULL */
@@ -736,71 +823,25 @@ static void non_recursive_bvh_div_nodes(BVHTree *tree, BVHNode *branches_array,
 
 	build_implicit_tree_helper(tree, &data);
 
+	cb_data.tree = tree;
+	cb_data.branches_array = branches_array;
+	cb_data.leafs_array = leafs_array;
+	cb_data.tree_type = tree_type;
+	cb_data.tree_offset = tree_offset;
+	cb_data.data = &data;
+
 	/* Loop tree levels (log N) loops */
 	for (i = 1, depth = 1; i <= num_branches; i = i * tree_type + tree_offset, depth++) {
 		const int first_of_next_level = i * tree_type + tree_offset;
 		const int end_j = min_ii(first_of_next_level, num_branches + 1);  /* index of last branch on this level */
-		int j;
-
-		/* Loop all branches on this level */
-#pragma omp parallel for private(j) schedule(static)
-		for (j = i; j < end_j; j++) {
-			int k;
-			const int parent_level_index = j - i;
-			BVHNode *parent = branches_array + j;
-			int nth_positions[MAX_TREETYPE + 1];
-			char split_axis;
-
-			int parent_leafs_begin = implicit_leafs_index(&data, depth, parent_level_index);
-			int parent_leafs_end   = implicit_leafs_index(&data, depth, parent_level_index + 1);
-
-			/* This calculates the bounding box of this branch
-			 * and chooses the largest axis as the axis to divide leafs */
-			refit_kdop_hull(tree, parent, parent_leafs_begin, parent_leafs_end);
-			split_axis = get_largest_axis(parent->bv);
-
-			/* Save split axis (this can be used on raytracing to speedup the query time) */
-			parent->main_axis = split_axis / 2;
-
-			/* Split the childs along the split_axis, note: its not needed to sort the whole leafs array
-			 * Only to assure that the elements are partitioned on a way that each child takes the elements
-			 * it would take in case the whole array was sorted.
-			 * Split_leafs takes care of that "sort" problem. */
-			nth_positions[0] = parent_leafs_begin;
-			nth_positions[tree_type] = parent_leafs_end;
-			for (k = 1; k < tree_type; k++) {
-				int child_index = j * tree_type + tree_offset + k;
-				int child_level_index = child_index - first_of_next_level; /* child level index */
-				nth_positions[k] = implicit_leafs_index(&data, depth + 1, child_level_index);
-			}
 
-			split_leafs(leafs_array, nth_positions, tree_type, split_axis);
+		cb_data.depth = depth;
+		cb_data.i = i;
+		cb_data.first_of_next_level = first_of_next_level;
 
-
-			/* Setup children and totnode counters
-			 * Not really needed but currently most of BVH code relies on having an explicit children structure */
-			for (k = 0; k < tree_type; k++) {
-				int child_index = j * tree_type + tree_offset + k;
-				int child_level_index = child_index - first_of_next_level; /* child level index */
-
-				int child_leafs_begin = implicit_leafs_index(&data, depth + 1, child_level_index);
-				int child_leafs_end   = implicit_leafs_index(&data, depth + 1, child_level_index + 1);
-
-				if (child_leafs_end - child_leafs_begin > 1) {
-					parent->children[k] = branches_array + child_index;
-					parent->children[k]->parent = parent;
-				}
-				else if (child_leafs_end - child_leafs_begin == 1) {
-					parent->children[k] = leafs_array[child_leafs_begin];
-					parent->children[k]->parent = parent;
-				}
-				else {
-					break;
-				}
-
-				parent->totnode = (char)(k + 1);
-			}
-		}
+		/* Loop all branches on this level */
+		BLI_task_parallel_range_ex(i, end_j, &cb_data, NULL, 0, non_recursive_bvh_div_nodes_task_cb, NULL,
+		                           range_threshold, true);
 	}
 }
 
@@ -1075,56 +1116,91 @@ static void traverse(BVHOverlapData *data, BVHNode *node1, BVHNode *node2)
 	return;
 }
 
+typedef struct BVHOverlapTaskData {
+	BVHOverlapData **data;
+	BVHNode *root1, *root2;
+} BVHOverlapTaskData;
+
+/* each task traverses one pair of root children, so both trees get split across the threads */
+static void bvhtree_overlap_task_cb(void *userdata, void *UNUSED(userdata_chunk), int j)
+{
+	BVHOverlapTaskData *task_data = userdata;
+	BVHNode *root2 = task_data->root2;
+
+	traverse(task_data->data[j],
+	         task_data->root1->children[j / root2->totnode],
+	         root2->children[j % root2->totnode]);
+}
+
 BVHTreeOverlap *BLI_bvhtree_overlap(BVHTree *tree1, BVHTree *tree2, unsigned int *result)
 {
 	int j;
 	unsigned int total = 0;
 	BVHTreeOverlap *overlap = NULL, *to = NULL;
 	BVHOverlapData **data;
+	BVHOverlapTaskData task_data;
+	BVHNode *root1, *root2;
+	int num_pairs, max_overlap;
+	bool use_threading;
 	
 	/* check for compatibility of both trees (can't compare 14-DOP with 18-DOP) */
 	if ((tree1->axis != tree2->axis) && (tree1->axis == 14 || tree2->axis == 14) && (tree1->axis == 18 || tree2->axis == 18))
 		return NULL;
+
+	root1 = tree1->nodes[tree1->totleaf];
+	root2 = tree2->nodes[tree2->totleaf];
 	
 	/* fast check root nodes for collision before doing big splitting + traversal */
-	if (!tree_overlap(tree1->nodes[tree1->totleaf], tree2->nodes[tree2->totleaf],
+	if (!tree_overlap(root1, root2,
 	                  min_axis(tree1->start_axis, tree2->start_axis),
 	                  min_axis(tree1->stop_axis, tree2->stop_axis)))
 	{
 		return NULL;
 	}
 
-	data = MEM_callocN(sizeof(BVHOverlapData *) * tree1->tree_type, "BVHOverlapData_star");
+	num_pairs = root1->totnode * root2->totnode;
+	/* an empty tree has a root without children (and zero bounds, so the check above passes) */
+	if (num_pairs == 0) {
+		*result = 0;
+		return NULL;
+	}
+	/* initial size of each result array, they grow as needed */
+	max_overlap = max_ii(1, max_ii(tree1->totleaf, tree2->totleaf) / num_pairs);
+	use_threading = (tree1->totleaf + tree2->totleaf) >= KDOPBVH_THREAD_LEAF_THRESHOLD;
+
+	data = MEM_callocN(sizeof(BVHOverlapData *) * (size_t)num_pairs, "BVHOverlapData_star");
 	
-	for (j = 0; j < tree1->tree_type; j++) {
+	for (j = 0; j < num_pairs; j++) {
 		data[j] = MEM_callocN(sizeof(BVHOverlapData), "BVHOverlapData");
 		
 		/* init BVHOverlapData */
-		data[j]->overlap = malloc(sizeof(BVHTreeOverlap) * (size_t)max_ii(tree1->totleaf, tree2->totleaf));
+		data[j]->overlap = malloc(sizeof(BVHTreeOverlap) * (size_t)max_overlap);
 		data[j]->tree1 = tree1;
 		data[j]->tree2 = tree2;
-		data[j]->max_overlap = (unsigned int)max_ii(tree1->totleaf, tree2->totleaf);
+		data[j]->max_overlap = (unsigned int)max_overlap;
 		data[j]->i = 0;
 		data[j]->start_axis = min_axis(tree1->start_axis, tree2->start_axis);
 		data[j]->stop_axis  = min_axis(tree1->stop_axis,  tree2->stop_axis);
 	}
 
-#pragma omp parallel for private(j) schedule(static)
-	for (j = 0; j < MIN2(tree1->tree_type, tree1->nodes[tree1->totleaf]->totnode); j++) {
-		traverse(data[j], tree1->nodes[tree1->totleaf]->children[j], tree2->nodes[tree2->totleaf]);
-	}
+	task_data.data = data;
+	task_data.root1 = root1;
+	task_data.root2 = root2;
+
+	BLI_task_parallel_range_ex(0, num_pairs, &task_data, NULL, 0, bvhtree_overlap_task_cb, NULL,
+	                           use_threading ? 2 : INT_MAX, true);
 	
-	for (j = 0; j < tree1->tree_type; j++)
+	for (j = 0; j < num_pairs; j++)
 		total += data[j]->i;
 	
 	to = overlap = MEM_callocN(sizeof(BVHTreeOverlap) * total, "BVHTreeOverlap");
 	
-	for (j = 0; j < tree1->tree_type; j++) {
+	for (j = 0; j < num_pairs; j++) {
 		memcpy(to, data[j]->overlap, data[j]->i * sizeof(BVHTreeOverlap));
 		to += data[j]->i;
 	}
 	
-	for (j = 0; j < tree1->tree_type; j++) {
+	for (j = 0; j < num_pairs; j++) {
 		free(data[j]->overlap);
 		MEM_freeN(data[j]);
 	}
@@ -1348,6 +1424,71 @@ int BLI_bvhtree_find_nearest(BVHTree *tree, const float co[3], BVHTreeNearest *n
 	return data.nearest.index;
 }
 
+typedef struct BVHNearestBatchData {
+	BVHTree *tree;
+	const float (*co)[3];
+	BVHTreeNearest *nearest;
+	int numco;
+
+	BVHTree_NearestPointCallback callback;
+	void *userdata;
+} BVHNearestBatchData;
+
+static void bvhtree_find_nearest_batch_task_cb(void *userdata, void *UNUSED(userdata_chunk), int chunk)
+{
+	BVHNearestBatchData *data = userdata;
+	const int start = chunk * KDOPBVH_BATCH_CHUNK_SIZE;
+	const int end = min_ii(start + KDOPBVH_BATCH_CHUNK_SIZE, data->numco);
+	const BVHTreeNearest *prev = NULL;
+	int i;
+
+	for (i = start; i < end; i++) {
+		BVHTreeNearest *nearest = &data->nearest[i];
+
+		/* Use local proximity heuristics (to reduce the nearest search)
+		 *
+		 * Queries are expected to be spatially coherent, so the previous hit is likely close
+		 * to this one, its distance can be used as initial search radius. */
+		if (prev) {
+			const float dist_sq = len_squared_v3v3(data->co[i], prev->co);
+			if (dist_sq < nearest->dist_sq) {
+				*nearest = *prev;
+				nearest->dist_sq = dist_sq;
+			}
+		}
+
+		BLI_bvhtree_find_nearest(data->tree, data->co[i], nearest, data->callback, data->userdata);
+
+		if (nearest->index != -1) {
+			prev = nearest;
+		}
+	}
+}
+
+/**
+ * Find the nearest node for each of the given coordinates, using multiple threads.
+ *
+ * \param nearest: Array of \a numco items, must be initialized like for #BLI_bvhtree_find_nearest,
+ * a query with a zero dist_sq is skipped.
+ * \note The callback is called from multiple threads at once.
+ */
+void BLI_bvhtree_find_nearest_batch(BVHTree *tree, const float (*co)[3], BVHTreeNearest *nearest, int numco,
+                                    BVHTree_NearestPointCallback callback, void *userdata)
+{
+	BVHNearestBatchData data;
+	const int num_chunks = (numco + KDOPBVH_BATCH_CHUNK_SIZE - 1) / KDOPBVH_BATCH_CHUNK_SIZE;
+
+	data.tree = tree;
+	data.co = co;
+	data.nearest = nearest;
+	data.numco = numco;
+	data.callback = callback;
+	data.userdata = userdata;
+
+	BLI_task_parallel_range_ex(0, num_chunks, &data, NULL, 0, bvhtree_find_nearest_batch_task_cb, NULL,
+	                           2, true);
+}
+
 
 /*
  * Raycast - BLI_bvhtree_ray_cast
@@ -1482,10 +1623,29 @@ static void iterative_raycast(BVHRayCastData *data, BVHNode *node)
 }
 #endif
 
+static void bvhtree_ray_cast_data_precalc(BVHRayCastData *data)
+{
+	int i;
+
+	normalize_v3(data->ray.direction);
+
+	for (i = 0; i < 3; i++) {
+		data->ray_dot_axis[i] = dot_v3v3(data->ray.direction, KDOP_AXES[i]);
+		data->idot_axis[i] = 1.0f / data->ray_dot_axis[i];
+
+		if (fabsf(data->ray_dot_axis[i]) < FLT_EPSILON) {
+			data->ray_dot_axis[i] = 0.0;
+		}
+		data->index[2 * i] = data->idot_axis[i] < 0.0f ? 1 : 0;
+		data->index[2 * i + 1] = 1 - data->index[2 * i];
+		data->index[2 * i]   += 2 * i;
+		data->index[2 * i + 1] += 2 * i;
+	}
+}
+
 int BLI_bvhtree_ray_cast(BVHTree *tree, const float co[3], const float dir[3], float radius, BVHTreeRayHit *hit,
                          BVHTree_RayCastCallback callback, void *userdata)
 {
-	int i;
 	BVHRayCastData data;
 	BVHNode *root = tree->nodes[tree->totleaf];
 
@@ -1498,21 +1658,7 @@ int BLI_bvhtree_ray_cast(BVHTree *tree, const float co[3], const float dir[3], f
 	copy_v3_v3(data.ray.direction, dir);
 	data.ray.radius = radius;
 
-	normalize_v3(data.ray.direction);
-
-	for (i = 0; i < 3; i++) {
-		data.ray_dot_axis[i] = dot_v3v3(data.ray.direction, KDOP_AXES[i]);
-		data.idot_axis[i] = 1.0f / data.ray_dot_axis[i];
-
-		if (fabsf(data.ray_dot_axis[i]) < FLT_EPSILON) {
-			data.ray_dot_axis[i] = 0.0;
-		}
-		data.index[2 * i] = data.idot_axis[i] < 0.0f ? 1 : 0;
-		data.index[2 * i + 1] = 1 - data.index[2 * i];
-		data.index[2 * i]   += 2 * i;
-		data.index[2 * i + 1] += 2 * i;
-	}
-
+	bvhtree_ray_cast_data_precalc(&data);
 
 	if (hit)
 		memcpy(&data.hit, hit, sizeof(*hit));
@@ -1533,6 +1679,65 @@ int BLI_bvhtree_ray_cast(BVHTree *tree, const float co[3], const float dir[3], f
 	return data.hit.index;
 }
 
+typedef struct BVHRayCastBatchData {
+	BVHTree *tree;
+	const BVHTreeRay *rays;
+	BVHTreeRayHit *hits;
+	int numrays;
+
+	BVHTree_RayCastCallback callback;
+	void *userdata;
+} BVHRayCastBatchData;
+
+static void bvhtree_ray_cast_batch_task_cb(void *userdata, void *UNUSED(userdata_chunk), int chunk)
+{
+	BVHRayCastBatchData *batch = userdata;
+	BVHNode *root = batch->tree->nodes[batch->tree->totleaf];
+	const int start = chunk * KDOPBVH_BATCH_CHUNK_SIZE;
+	const int end = min_ii(start + KDOPBVH_BATCH_CHUNK_SIZE, batch->numrays);
+	BVHRayCastData data;
+	int i;
+
+	data.tree = batch->tree;
+	data.callback = batch->callback;
+	data.userdata = batch->userdata;
+
+	for (i = start; i < end; i++) {
+		data.ray = batch->rays[i];
+		bvhtree_ray_cast_data_precalc(&data);
+
+		data.hit = batch->hits[i];
+		if (root && data.hit.dist > 0.0f) {
+			dfs_raycast(&data, root);
+		}
+		batch->hits[i] = data.hit;
+	}
+}
+
+/**
+ * Cast each of the given rays, using multiple threads.
+ *
+ * \param hits: Array of \a numrays items, must be initialized like for #BLI_bvhtree_ray_cast,
+ * a ray with a zero hit distance is skipped.
+ * \note The callback is called from multiple threads at once.
+ */
+void BLI_bvhtree_ray_cast_batch(BVHTree *tree, const BVHTreeRay *rays, BVHTreeRayHit *hits, int numrays,
+                                BVHTree_RayCastCallback callback, void *userdata)
+{
+	BVHRayCastBatchData data;
+	const int num_chunks = (numrays + KDOPBVH_BATCH_CHUNK_SIZE - 1) / KDOPBVH_BATCH_CHUNK_SIZE;
+
+	data.tree = tree;
+	data.rays = rays;
+	data.hits = hits;
+	data.numrays = numrays;
+	data.callback = callback;
+	data.userdata = userdata;
+
+	BLI_task_parallel_range_ex(0, num_chunks, &data, NULL, 0, bvhtree_ray_cast_batch_task_cb, NULL,
+	                           2, true);
+}
+
 float BLI_bvhtree_bb_raycast(const float bv[6], const float light_start[3], const float light_end[3], float pos[3])
 {
 	BVHRayCastData data;
@@ -29,13 +29,20 @@
 
 #include "BLI_math.h"
 #include "BLI_kdtree.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 #include "BLI_strict_flags.h"
 
 
+/* Nodes are stored in a single array, sorted so that each subtree is a contiguous range
+ * with its root at the middle. Children are referenced by index in that array,
+ * which keeps nodes small and traversal cache friendly.
+ *
+ * Node normals aren't stored since only the normal of the query point is used. */
 typedef struct KDTreeNode {
-	struct KDTreeNode *left, *right;
-	float co[3], nor[3];
+	unsigned int left, right;
+	float co[3];
 	int index;
 	unsigned int d;  /* range is only (0-2) */
 } KDTreeNode;
@@ -43,7 +50,7 @@ typedef struct KDTreeNode {
 struct KDTree {
 	KDTreeNode *nodes;
 	unsigned int totnode;
-	KDTreeNode *root;
+	unsigned int root;
 #ifdef DEBUG
 	bool is_balanced;  /* ensure we call balance first */
 	unsigned int maxsize;   /* max size of the tree */
@@ -54,6 +61,14 @@ struct KDTree {
 #define KD_NEAR_ALLOC_INC 100  /* alloc increment for collecting nearest */
 #define KD_FOUND_ALLOC_INC 50  /* alloc increment for collecting nearest */
 
+#define KD_NODE_UNSET ((unsigned int)-1)
+
+/* subtrees with more nodes than this are balanced in a separate task */
+#define KD_BALANCE_THREAD_THRESHOLD 8192
+
+/* number of queries of a batch handled by a single task */
+#define KD_BATCH_CHUNK_SIZE 256u
+
 /**
  * Creates or free a kdtree
  */
@@ -64,7 +79,7 @@ KDTree *BLI_kdtree_new(unsigned int maxsize)
 	tree = MEM_mallocN(sizeof(KDTree), "KDTree");
 	tree->nodes = MEM_mallocN(sizeof(KDTreeNode) * maxsize, "KDTreeNode");
 	tree->totnode = 0;
-	tree->root = NULL;
+	tree->root = KD_NODE_UNSET;
 
 #ifdef DEBUG
 	tree->is_balanced = false;
@@ -83,9 +98,9 @@ void BLI_kdtree_free(KDTree *tree)
 }
 
 /**
- * Construction: first insert points, then call balance. Normal is optional.
+ * Construction: first insert points, then call balance. Normal is optional, and currently unused.
  */
-void BLI_kdtree_insert(KDTree *tree, int index, const float co[3], const float nor[3])
+void BLI_kdtree_insert(KDTree *tree, int index, const float co[3], const float UNUSED(nor[3]))
 {
 	KDTreeNode *node = &tree->nodes[tree->totnode++];
 
@@ -96,13 +111,8 @@ void BLI_kdtree_insert(KDTree *tree, int index, const float co[3], const float n
 	/* note, array isn't calloc'd,
 	 * need to initialize all struct members */
 
-	node->left = node->right = NULL;
+	node->left = node->right = KD_NODE_UNSET;
 	copy_v3_v3(node->co, co);
-	if (nor)
-		copy_v3_v3(node->nor, nor);
-	else
-		zero_v3(node->nor);
-
 	node->index = index;
 	node->d = 0;
 
@@ -111,17 +121,15 @@ void BLI_kdtree_insert(KDTree *tree, int index, const float co[3], const float n
 #endif
 }
 
-static KDTreeNode *kdtree_balance(KDTreeNode *nodes, unsigned int totnode, unsigned int axis)
+/**
+ * Sort \a nodes so the median along \a axis is in the middle,
+ * with smaller nodes before it and bigger nodes after it.
+ */
+static void kdtree_median_partition(KDTreeNode *nodes, unsigned int totnode, unsigned int axis)
 {
-	KDTreeNode *node;
 	float co;
 	unsigned int left, right, median, i, j;
 
-	if (totnode <= 0)
-		return NULL;
-	else if (totnode == 1)
-		return nodes;
-	
 	/* quicksort style sorting around median */
 	left = 0;
 	right = totnode - 1;
@@ -148,26 +156,110 @@ static KDTreeNode *kdtree_balance(KDTreeNode *nodes, unsigned int totnode, unsig
 		if (i <= median)
 			left = i + 1;
 	}
+}
+
+/* index of the root of the subtree starting at \a ofs, known before the subtree is balanced */
+BLI_INLINE unsigned int kdtree_subtree_root(unsigned int totnode, unsigned int ofs)
+{
+	return (totnode == 0) ? KD_NODE_UNSET : ofs + totnode / 2;
+}
+
+static unsigned int kdtree_balance(KDTreeNode *nodes, unsigned int totnode, unsigned int axis, unsigned int ofs)
+{
+	KDTreeNode *node;
+	unsigned int median;
+
+	if (totnode <= 0)
+		return KD_NODE_UNSET;
+	else if (totnode == 1)
+		return 0 + ofs;
+
+	kdtree_median_partition(nodes, totnode, axis);
 
 	/* set node and sort subnodes */
+	median = totnode / 2;
 	node = &nodes[median];
 	node->d = axis;
-	node->left = kdtree_balance(nodes, median, (axis + 1) % 3);
-	node->right = kdtree_balance(nodes + median + 1, (totnode - (median + 1)), (axis + 1) % 3);
+	axis = (axis + 1) % 3;
+	node->left = kdtree_balance(nodes, median, axis, ofs);
+	node->right = kdtree_balance(nodes + median + 1, (totnode - (median + 1)), axis, (median + 1) + ofs);
 
-	return node;
+	return median + ofs;
+}
+
+typedef struct KDTreeBalanceTask {
+	KDTreeNode *nodes;
+	unsigned int totnode;
+	unsigned int axis;
+	unsigned int ofs;
+} KDTreeBalanceTask;
+
+static void kdtree_balance_push(TaskPool *pool, KDTreeNode *nodes, unsigned int totnode,
+                                unsigned int axis, unsigned int ofs);
+
+static void kdtree_balance_task(TaskPool *pool, void *taskdata, int UNUSED(threadid))
+{
+	KDTreeBalanceTask *task = taskdata;
+	KDTreeNode *nodes = task->nodes;
+	const unsigned int totnode = task->totnode;
+	const unsigned int median = totnode / 2;
+	const unsigned int axis = (task->axis + 1) % 3;
+	KDTreeNode *node;
+
+	kdtree_median_partition(nodes, totnode, task->axis);
+
+	node = &nodes[median];
+	node->d = task->axis;
+
+	/* the children roots are known in advance, so both halves can be balanced independently */
+	node->left = kdtree_subtree_root(median, task->ofs);
+	node->right = kdtree_subtree_root(totnode - (median + 1), (median + 1) + task->ofs);
+
+	kdtree_balance_push(pool, nodes, median, axis, task->ofs);
+	kdtree_balance_push(pool, nodes + median + 1, totnode - (median + 1), axis, (median + 1) + task->ofs);
+}
+
+static void kdtree_balance_push(TaskPool *pool, KDTreeNode *nodes, unsigned int totnode,
+                                unsigned int axis, unsigned int ofs)
+{
+	if (totnode > KD_BALANCE_THREAD_THRESHOLD) {
+		KDTreeBalanceTask *task = MEM_mallocN(sizeof(*task), __func__);
+
+		task->nodes = nodes;
+		task->totnode = totnode;
+		task->axis = axis;
+		task->ofs = ofs;
+
+		BLI_task_pool_push(pool, kdtree_balance_task, task, true, TASK_PRIORITY_HIGH);
+	}
+	else {
+		kdtree_balance(nodes, totnode, axis, ofs);
+	}
 }
 
 void BLI_kdtree_balance(KDTree *tree)
 {
-	tree->root = kdtree_balance(tree->nodes, tree->totnode, 0);
+	TaskScheduler *task_scheduler = BLI_task_scheduler_get();
+
+	if (tree->totnode > KD_BALANCE_THREAD_THRESHOLD && BLI_task_scheduler_num_threads(task_scheduler) > 1) {
+		TaskPool *task_pool = BLI_task_pool_create(task_scheduler, NULL);
+
+		kdtree_balance_push(task_pool, tree->nodes, tree->totnode, 0, 0);
+		BLI_task_pool_work_and_wait(task_pool);
+		BLI_task_pool_free(task_pool);
+
+		tree->root = kdtree_subtree_root(tree->totnode, 0);
+	}
+	else {
+		tree->root = kdtree_balance(tree->nodes, tree->totnode, 0, 0);
+	}
 
 #ifdef DEBUG
 	tree->is_balanced = true;
 #endif
 }
 
-static float squared_distance(const float v2[3], const float v1[3], const float UNUSED(n1[3]), const float n2[3])
+static float squared_distance(const float v2[3], const float v1[3], const float n2[3])
 {
 	float d[3], dist;
 
@@ -187,11 +279,11 @@ static float squared_distance(const float v2[3], const float v1[3], const float
 	return dist;
 }
 
-static KDTreeNode **realloc_nodes(KDTreeNode **stack, unsigned int *totstack, const bool is_alloc)
+static unsigned int *realloc_nodes(unsigned int *stack, unsigned int *totstack, const bool is_alloc)
 {
-	KDTreeNode **stack_new = MEM_mallocN((*totstack + KD_NEAR_ALLOC_INC) * sizeof(KDTreeNode *), "KDTree.treestack");
-	memcpy(stack_new, stack, *totstack * sizeof(KDTreeNode *));
-	// memset(stack_new + *totstack, 0, sizeof(KDTreeNode *) * KD_NEAR_ALLOC_INC);
+	unsigned int *stack_new = MEM_mallocN((*totstack + KD_NEAR_ALLOC_INC) * sizeof(unsigned int), "KDTree.treestack");
+	memcpy(stack_new, stack, *totstack * sizeof(unsigned int));
+	// memset(stack_new + *totstack, 0, sizeof(unsigned int) * KD_NEAR_ALLOC_INC);
 	if (is_alloc)
 		MEM_freeN(stack);
 	*totstack += KD_NEAR_ALLOC_INC;
@@ -204,8 +296,9 @@ static KDTreeNode **realloc_nodes(KDTreeNode **stack, unsigned int *totstack, co
 int BLI_kdtree_find_nearest(KDTree *tree, const float co[3], const float nor[3],
                             KDTreeNearest *r_nearest)
 {
-	KDTreeNode *root, *node, *min_node;
-	KDTreeNode **stack, *defaultstack[KD_STACK_INIT];
+	const KDTreeNode *nodes = tree->nodes;
+	const KDTreeNode *root, *node, *min_node;
+	unsigned int *stack, defaultstack[KD_STACK_INIT];
 	float min_dist, cur_dist;
 	unsigned int totstack, cur = 0;
 
@@ -213,31 +306,31 @@ int BLI_kdtree_find_nearest(KDTree *tree, const float co[3], const float nor[3],
 	BLI_assert(tree->is_balanced == true);
 #endif
 
-	if (!tree->root)
+	if (UNLIKELY(tree->root == KD_NODE_UNSET))
 		return -1;
 
 	stack = defaultstack;
 	totstack = KD_STACK_INIT;
 
-	root = tree->root;
+	root = &nodes[tree->root];
 	min_node = root;
-	min_dist = squared_distance(root->co, co, root->nor, nor);
+	min_dist = squared_distance(root->co, co, nor);
 
 	if (co[root->d] < root->co[root->d]) {
-		if (root->right)
+		if (root->right != KD_NODE_UNSET)
 			stack[cur++] = root->right;
-		if (root->left)
+		if (root->left != KD_NODE_UNSET)
 			stack[cur++] = root->left;
 	}
 	else {
-		if (root->left)
+		if (root->left != KD_NODE_UNSET)
 			stack[cur++] = root->left;
-		if (root->right)
+		if (root->right != KD_NODE_UNSET)
 			stack[cur++] = root->right;
 	}
 	
 	while (cur--) {
-		node = stack[cur];
+		node = &nodes[stack[cur]];
 
 		cur_dist = node->co[node->d] - co[node->d];
 
@@ -245,30 +338,30 @@ int BLI_kdtree_find_nearest(KDTree *tree, const float co[3], const float nor[3],
 			cur_dist = -cur_dist * cur_dist;
 
 			if (-cur_dist < min_dist) {
-				cur_dist = squared_distance(node->co, co, node->nor, nor);
+				cur_dist = squared_distance(node->co, co, nor);
 				if (cur_dist < min_dist) {
 					min_dist = cur_dist;
 					min_node = node;
 				}
-				if (node->left)
+				if (node->left != KD_NODE_UNSET)
 					stack[cur++] = node->left;
 			}
-			if (node->right)
+			if (node->right != KD_NODE_UNSET)
 				stack[cur++] = node->right;
 		}
 		else {
 			cur_dist = cur_dist * cur_dist;
 
 			if (cur_dist < min_dist) {
-				cur_dist = squared_distance(node->co, co, node->nor, nor);
+				cur_dist = squared_distance(node->co, co, nor);
 				if (cur_dist < min_dist) {
 					min_dist = cur_dist;
 					min_node = node;
 				}
-				if (node->right)
+				if (node->right != KD_NODE_UNSET)
 					stack[cur++] = node->right;
 			}
-			if (node->left)
+			if (node->left != KD_NODE_UNSET)
 				stack[cur++] = node->left;
 		}
 		if (UNLIKELY(cur + 3 > totstack)) {
@@ -317,8 +410,9 @@ int BLI_kdtree_find_nearest_n(KDTree *tree, const float co[3], const float nor[3
                               KDTreeNearest r_nearest[],
                               unsigned int n)
 {
-	KDTreeNode *root, *node = NULL;
-	KDTreeNode **stack, *defaultstack[KD_STACK_INIT];
+	const KDTreeNode *nodes = tree->nodes;
+	const KDTreeNode *root, *node = NULL;
+	unsigned int *stack, defaultstack[KD_STACK_INIT];
 	float cur_dist;
 	unsigned int totstack, cur = 0;
 	unsigned int i, found = 0;
@@ -327,32 +421,32 @@ int BLI_kdtree_find_nearest_n(KDTree *tree, const float co[3], const float nor[3
 	BLI_assert(tree->is_balanced == true);
 #endif
 
-	if (!tree->root || n == 0)
+	if (UNLIKELY((tree->root == KD_NODE_UNSET) || n == 0))
 		return 0;
 
 	stack = defaultstack;
 	totstack = KD_STACK_INIT;
 
-	root = tree->root;
+	root = &nodes[tree->root];
 
-	cur_dist = squared_distance(root->co, co, root->nor, nor);
+	cur_dist = squared_distance(root->co, co, nor);
 	add_nearest(r_nearest, &found, n, root->index, cur_dist, root->co);
 	
 	if (co[root->d] < root->co[root->d]) {
-		if (root->right)
+		if (root->right != KD_NODE_UNSET)
 			stack[cur++] = root->right;
-		if (root->left)
+		if (root->left != KD_NODE_UNSET)
 			stack[cur++] = root->left;
 	}
 	else {
-		if (root->left)
+		if (root->left != KD_NODE_UNSET)
 			stack[cur++] = root->left;
-		if (root->right)
+		if (root->right != KD_NODE_UNSET)
 			stack[cur++] = root->right;
 	}
 
 	while (cur--) {
-		node = stack[cur];
+		node = &nodes[stack[cur]];
 
 		cur_dist = node->co[node->d] - co[node->d];
 
@@ -360,29 +454,29 @@ int BLI_kdtree_find_nearest_n(KDTree *tree, const float co[3], const float nor[3
 			cur_dist = -cur_dist * cur_dist;
 
 			if (found < n || -cur_dist < r_nearest[found - 1].dist) {
-				cur_dist = squared_distance(node->co, co, node->nor, nor);
+				cur_dist = squared_distance(node->co, co, nor);
 
 				if (found < n || cur_dist < r_nearest[found - 1].dist)
 					add_nearest(r_nearest, &found, n, node->index, cur_dist, node->co);
 
-				if (node->left)
+				if (node->left != KD_NODE_UNSET)
 					stack[cur++] = node->left;
 			}
-			if (node->right)
+			if (node->right != KD_NODE_UNSET)
 				stack[cur++] = node->right;
 		}
 		else {
 			cur_dist = cur_dist * cur_dist;
 
 			if (found < n || cur_dist < r_nearest[found - 1].dist) {
-				cur_dist = squared_distance(node->co, co, node->nor, nor);
+				cur_dist = squared_distance(node->co, co, nor);
 				if (found < n || cur_dist < r_nearest[found - 1].dist)
 					add_nearest(r_nearest, &found, n, node->index, cur_dist, node->co);
 
-				if (node->right)
+				if (node->right != KD_NODE_UNSET)
 					stack[cur++] = node->right;
 			}
-			if (node->left)
+			if (node->left != KD_NODE_UNSET)
 				stack[cur++] = node->left;
 		}
 		if (UNLIKELY(cur + 3 > totstack)) {
@@ -411,17 +505,19 @@ static int range_compare(const void *a, const void *b)
 	else
 		return 0;
 }
-static void add_in_range(KDTreeNearest **ptn, unsigned int found, unsigned int *totfoundstack, int index, float dist, float *co)
+static void add_in_range(KDTreeNearest **ptn, unsigned int found, unsigned int *totfoundstack, int index, float dist, const float *co)
 {
 	KDTreeNearest *to;
 
 	if (found >= *totfoundstack) {
-		KDTreeNearest *temp = MEM_mallocN((*totfoundstack + KD_FOUND_ALLOC_INC) * sizeof(KDTreeNode), "KDTree.treefoundstack");
+		/* grow geometrically, batch searches collect the results of many queries in one array */
+		const unsigned int totfoundstack_new = *totfoundstack + MAX2((unsigned int)KD_FOUND_ALLOC_INC, *totfoundstack);
+		KDTreeNearest *temp = MEM_mallocN(totfoundstack_new * sizeof(KDTreeNearest), "KDTree.treefoundstack");
 		memcpy(temp, *ptn, *totfoundstack * sizeof(KDTreeNearest));
 		if (*ptn)
 			MEM_freeN(*ptn);
 		*ptn = temp;
-		*totfoundstack += KD_FOUND_ALLOC_INC;
+		*totfoundstack = totfoundstack_new;
 	}
 
 	to = (*ptn) + found;
@@ -432,69 +528,70 @@ static void add_in_range(KDTreeNearest **ptn, unsigned int found, unsigned int *
 }
 
 /**
- * Range search returns number of points found, with results in nearest
- * Normal is optional, but if given will limit results to points in normal direction from co.
- * Remember to free nearest after use!
+ * Append the points in range to \a r_foundstack, starting at \a found.
+ * Returns the new number of items in \a r_foundstack.
  */
-int BLI_kdtree_range_search(KDTree *tree, const float co[3], const float nor[3],
-                            KDTreeNearest **r_nearest, float range)
+static unsigned int kdtree_range_search_append(KDTree *tree, const float co[3], const float nor[3], float range,
+                                               KDTreeNearest **r_foundstack, unsigned int *r_totfoundstack,
+                                               unsigned int found)
 {
-	KDTreeNode *root, *node = NULL;
-	KDTreeNode **stack, *defaultstack[KD_STACK_INIT];
-	KDTreeNearest *foundstack = NULL;
+	const KDTreeNode *nodes = tree->nodes;
+	const KDTreeNode *root, *node = NULL;
+	unsigned int *stack, defaultstack[KD_STACK_INIT];
+	const unsigned int found_start = found;
 	float range2 = range * range, dist2;
-	unsigned int totstack, cur = 0, found = 0, totfoundstack = 0;
+	unsigned int totstack, cur = 0;
 
 #ifdef DEBUG
 	BLI_assert(tree->is_balanced == true);
 #endif
 
-	if (!tree->root)
-		return 0;
+	if (UNLIKELY(tree->root == KD_NODE_UNSET))
+		return found;
 
 	stack = defaultstack;
 	totstack = KD_STACK_INIT;
 
-	root = tree->root;
+	root = &nodes[tree->root];
 
 	if (co[root->d] + range < root->co[root->d]) {
-		if (root->left)
+		if (root->left != KD_NODE_UNSET)
 			stack[cur++] = root->left;
 	}
 	else if (co[root->d] - range > root->co[root->d]) {
-		if (root->right)
+		if (root->right != KD_NODE_UNSET)
 			stack[cur++] = root->right;
 	}
 	else {
-		dist2 = squared_distance(root->co, co, root->nor, nor);
+		dist2 = squared_distance(root->co, co, nor);
 		if (dist2 <= range2)
-			add_in_range(&foundstack, found++, &totfoundstack, root->index, dist2, root->co);
+			add_in_range(r_foundstack, found++, r_totfoundstack, root->index, dist2, root->co);
 
-		if (root->left)
+		if (root->left != KD_NODE_UNSET)
 			stack[cur++] = root->left;
-		if (root->right)
+		if (root->right != KD_NODE_UNSET)
 			stack[cur++] = root->right;
 	}
 
 	while (cur--) {
-		node = stack[cur];
+		node = &nodes[stack[cur]];
 
 		if (co[node->d] + range < node->co[node->d]) {
-			if (node->left)
+			if (node->left != KD_NODE_UNSET)
 				stack[cur++] = node->left;
 		}
 		else if (co[node->d] - range > node->co[node->d]) {
-			if (node->right)
+			if (node->right != KD_NODE_UNSET)
 				stack[cur++] = node->right;
 		}
 		else {
-			dist2 = squared_distance(node->co, co, node->nor, nor);
+			dist2 = squared_distance(node->co, co, nor);
 			if (dist2 <= range2)
-				add_in_range(&foundstack, found++, &totfoundstack, node->index, dist2, node->co);
+				add_in_range(r_foundstack, found++, r_totfoundstack, node->index, dist2, node->co);
 
-			if (node->left)
+			if (node->left != KD_NODE_UNSET)
 				stack[cur++] = node->left;
-			if (node->right)
+			if (node->right != KD_NODE_UNSET)
 				stack[cur++] = node->right;
 		}
 
@@ -506,10 +603,188 @@ int BLI_kdtree_range_search(KDTree *tree, const float co[3], const float nor[3],
 	if (stack != defaultstack)
 		MEM_freeN(stack);
 
-	if (found)
-		qsort(foundstack, found, sizeof(KDTreeNearest), range_compare);
+	if (found - found_start > 1)
+		qsort(*r_foundstack + found_start, found - found_start, sizeof(KDTreeNearest), range_compare);
+
+	return found;
+}
+
+/**
+ * Range search returns number of points found, with results in nearest
+ * Normal is optional, but if given will limit results to points in normal direction from co.
+ * Remember to free nearest after use!
+ */
+int BLI_kdtree_range_search(KDTree *tree, const float co[3], const float nor[3],
+                            KDTreeNearest **r_nearest, float range)
+{
+	KDTreeNearest *foundstack = NULL;
+	unsigned int totfoundstack = 0;
+	unsigned int found;
+
+	found = kdtree_range_search_append(tree, co, nor, range, &foundstack, &totfoundstack, 0);
 
 	*r_nearest = foundstack;
 
 	return (int)found;
 }
+
+/* -------------------------------------------------------------------- */
+/** \name Batch Queries
+ *
+ * Run many queries on the same tree using multiple threads,
+ * writing results into flat arrays instead of allocating them per query.
+ * \{ */
+
+typedef struct KDTreeBatchData {
+	KDTree *tree;
+	const float (*co)[3];
+	const float (*nor)[3];
+	unsigned int totco;
+
+	/* nearest_n */
+	unsigned int n;
+	KDTreeNearest *r_nearest;
+	int *r_found;
+
+	/* range search */
+	float range;
+	KDTreeNearest **chunk_found;
+	unsigned int *chunk_totfound;
+	unsigned int *r_offsets;
+} KDTreeBatchData;
+
+static void kdtree_find_nearest_n_batch_task_cb(void *userdata, void *UNUSED(userdata_chunk), int chunk)
+{
+	KDTreeBatchData *data = userdata;
+	const unsigned int start = (unsigned int)chunk * KD_BATCH_CHUNK_SIZE;
+	const unsigned int end = MIN2(start + KD_BATCH_CHUNK_SIZE, data->totco);
+	unsigned int i;
+
+	for (i = start; i < end; i++) {
+		const int found = BLI_kdtree_find_nearest_n(data->tree, data->co[i], data->nor ? data->nor[i] : NULL,
+		                                            &data->r_nearest[i * data->n], data->n);
+		if (data->r_found) {
+			data->r_found[i] = found;
+		}
+	}
+}
+
+/**
+ * Find the \a n nearest points of each of the \a totco coordinates.
+ *
+ * \param nor  Optional array of \a totco normals.
+ * \param r_nearest  An array sized at least \a totco * \a n, results of query i start at i * \a n.
+ * \param r_found  Optional array of \a totco items, number of points found for each query.
+ */
+void BLI_kdtree_find_nearest_n_batch(KDTree *tree, const float (*co)[3], const float (*nor)[3], unsigned int totco,
+                                     KDTreeNearest *r_nearest, int *r_found, unsigned int n)
+{
+	KDTreeBatchData data = {NULL};
+	const int num_chunks = (int)((totco + KD_BATCH_CHUNK_SIZE - 1) / KD_BATCH_CHUNK_SIZE);
+
+	data.tree = tree;
+	data.co = co;
+	data.nor = nor;
+	data.totco = totco;
+	data.n = n;
+	data.r_nearest = r_nearest;
+	data.r_found = r_found;
+
+	BLI_task_parallel_range_ex(0, num_chunks, &data, NULL, 0, kdtree_find_nearest_n_batch_task_cb, NULL,
+	                           2, true);
+}
+
+static void kdtree_range_search_batch_task_cb(void *userdata, void *UNUSED(userdata_chunk), int chunk)
+{
+	KDTreeBatchData *data = userdata;
+	const unsigned int start = (unsigned int)chunk * KD_BATCH_CHUNK_SIZE;
+	const unsigned int end = MIN2(start + KD_BATCH_CHUNK_SIZE, data->totco);
+	KDTreeNearest *foundstack = NULL;
+	unsigned int totfoundstack = 0, found = 0;
+	unsigned int i;
+
+	/* all queries of a chunk share one growing array,
+	 * r_offsets temporarily holds the number of points found for each query */
+	for (i = start; i < end; i++) {
+		const unsigned int found_prev = found;
+		found = kdtree_range_search_append(data->tree, data->co[i], data->nor ? data->nor[i] : NULL, data->range,
+		                                   &foundstack, &totfoundstack, found);
+		data->r_offsets[i] = found - found_prev;
+	}
+
+	data->chunk_found[chunk] = foundstack;
+	data->chunk_totfound[chunk] = found;
+}
+
+/**
+ * Range search for each of the \a totco coordinates.
+ *
+ * \param nor  Optional array of \a totco normals.
+ * \param r_offsets  An array sized \a totco + 1, results of query i are in the range
+ * [r_offsets[i], r_offsets[i + 1]) of the returned array, sorted by distance.
+ * \return An array with the points found by all queries, or NULL if none was found.
+ * Remember to free it after use!
+ */
+KDTreeNearest *BLI_kdtree_range_search_batch(KDTree *tree, const float (*co)[3], const float (*nor)[3],
+                                             unsigned int totco, float range, unsigned int *r_offsets)
+{
+	KDTreeBatchData data = {NULL};
+	KDTreeNearest *nearest = NULL, *to;
+	const int num_chunks = (int)((totco + KD_BATCH_CHUNK_SIZE - 1) / KD_BATCH_CHUNK_SIZE);
+	unsigned int i, count, total = 0;
+	int chunk;
+
+	data.tree = tree;
+	data.co = co;
+	data.nor = nor;
+	data.totco = totco;
+	data.range = range;
+	data.r_offsets = r_offsets;
+
+	if (num_chunks != 0) {
+		data.chunk_found = MEM_callocN(sizeof(*data.chunk_found) * (size_t)num_chunks, __func__);
+		data.chunk_totfound = MEM_callocN(sizeof(*data.chunk_totfound) * (size_t)num_chunks, __func__);
+
+		BLI_task_parallel_range_ex(0, num_chunks, &data, NULL, 0, kdtree_range_search_batch_task_cb, NULL,
+		                           2, true);
+
+		for (chunk = 0; chunk < num_chunks; chunk++) {
+			total += data.chunk_totfound[chunk];
+		}
+	}
+
+	/* convert counts to offsets */
+	for (i = 0, count = 0; i < totco; i++) {
+		const unsigned int found = r_offsets[i];
+		r_offsets[i] = count;
+		count += found;
+	}
+	r_offsets[totco] = count;
+
+	BLI_assert(count == total);
+
+	if (total != 0) {
+		to = nearest = MEM_mallocN(sizeof(KDTreeNearest) * total, __func__);
+
+		for (chunk = 0; chunk < num_chunks; chunk++) {
+			if (data.chunk_found[chunk]) {
+				memcpy(to, data.chunk_found[chunk], sizeof(KDTreeNearest) * data.chunk_totfound[chunk]);
+				to += data.chunk_totfound[chunk];
+			}
+		}
+	}
+
+	if (num_chunks != 0) {
+		for (chunk = 0; chunk < num_chunks; chunk++) {
+			if (data.chunk_found[chunk]) {
+				MEM_freeN(data.chunk_found[chunk]);
+			}
+		}
+		MEM_freeN(data.chunk_found);
+		MEM_freeN(data.chunk_totfound);
+	}
+
+	return nearest;
+}
+
+/** \} */
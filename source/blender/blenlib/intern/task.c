@@ -25,9 +25,12 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "BLI_listbase.h"
 #include "BLI_task.h"
 #include "BLI_threads.h"
@@ -57,14 +60,43 @@ struct TaskPool {
 	volatile bool do_cancel;
 };
 
+/* Each thread owns a queue of tasks. Tasks pushed from a worker thread go to
+ * its own queue, tasks pushed from other threads are spread over all queues.
+ * Threads which run out of work steal tasks from the other queues, so there
+ * is no single lock all threads are contending for.
+ *
+ * High priority tasks go to one shared queue which every thread checks before
+ * its own queue, so they run before any low priority task that is queued,
+ * no matter which thread queued it. */
+typedef struct TaskQueue {
+	ListBase tasks;
+	ThreadMutex mutex;
+} TaskQueue;
+
 struct TaskScheduler {
 	pthread_t *threads;
 	struct TaskThread *task_threads;
 	int num_threads;
 
-	ListBase queue;
-	ThreadMutex queue_mutex;
-	ThreadCondition queue_cond;
+	/* num_threads + 1 queues, queue 0 is used by the main thread */
+	TaskQueue *queues;
+	int num_queues;
+
+	/* shared queue for high priority tasks */
+	TaskQueue high_queue;
+
+	/* total number of tasks in all queues, and number of threads sleeping
+	 * while waiting for new tasks to be pushed. Only counted when there are
+	 * worker threads, without them the atomic operations are pure overhead */
+	uint32_t num_queued;
+	uint32_t num_sleeping;
+	uint32_t push_index;
+
+	ThreadMutex wait_mutex;
+	ThreadCondition wait_cond;
+
+	/* TaskThread of the current thread, NULL for non-worker threads */
+	pthread_key_t thread_key;
 
 	volatile bool do_exit;
 };
@@ -101,25 +133,100 @@ static void task_pool_num_increase(TaskPool *pool)
 	BLI_mutex_unlock(&pool->num_mutex);
 }
 
-static bool task_scheduler_thread_wait_pop(TaskScheduler *scheduler, Task **task)
+static void task_free(Task *task)
+{
+	if (task->free_taskdata)
+		MEM_freeN(task->taskdata);
+	MEM_freeN(task);
+}
+
+/* index of the queue owned by the calling thread */
+static int task_scheduler_thread_queue(TaskScheduler *scheduler)
 {
-	BLI_mutex_lock(&scheduler->queue_mutex);
+	TaskThread *thread = pthread_getspecific(scheduler->thread_key);
+
+	return (thread) ? thread->id : 0;
+}
+
+/* Pop the first task from the queue, when pool is not NULL only tasks from
+ * that pool are taken. */
+static Task *task_queue_pop(TaskQueue *queue, TaskPool *pool)
+{
+	Task *task;
+
+	if (BLI_listbase_is_empty(&queue->tasks))
+		return NULL;
+
+	BLI_mutex_lock(&queue->mutex);
+
+	for (task = queue->tasks.first; task; task = task->next) {
+		if (pool == NULL || task->pool == pool) {
+			BLI_remlink(&queue->tasks, task);
+			break;
+		}
+	}
+
+	BLI_mutex_unlock(&queue->mutex);
+
+	return task;
+}
 
-	while (!scheduler->queue.first && !scheduler->do_exit)
-		BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+/* Pop a task from the queues, starting with the high priority queue, then the
+ * queue owned by the calling thread and stealing from the other queues when
+ * it's empty. When pool is not NULL only tasks from that pool are taken. */
+static bool task_scheduler_pop(TaskScheduler *scheduler, int queue_index, TaskPool *pool, Task **r_task)
+{
+	Task *task;
+	int i;
 
-	if (!scheduler->queue.first) {
-		BLI_mutex_unlock(&scheduler->queue_mutex);
-		BLI_assert(scheduler->do_exit);
+	/* cheap early out, avoids locking all queues when there is nothing to do.
+	 * A plain read is enough, a task pushed meanwhile is found by the next call */
+	if (scheduler->num_threads > 0 && *(volatile uint32_t *)&scheduler->num_queued == 0)
 		return false;
+
+	task = task_queue_pop(&scheduler->high_queue, pool);
+
+	for (i = 0; task == NULL && i < scheduler->num_queues; i++) {
+		int index = queue_index + i;
+		if (index >= scheduler->num_queues)
+			index -= scheduler->num_queues;
+
+		task = task_queue_pop(&scheduler->queues[index], pool);
 	}
-	
-	*task = scheduler->queue.first;
-	BLI_remlink(&scheduler->queue, *task);
 
-	BLI_mutex_unlock(&scheduler->queue_mutex);
+	if (task) {
+		if (scheduler->num_threads > 0)
+			atomic_sub_uint32(&scheduler->num_queued, 1);
+		*r_task = task;
+		return true;
+	}
 
-	return true;
+	return false;
+}
+
+static bool task_scheduler_thread_wait_pop(TaskScheduler *scheduler, int queue_index, Task **task)
+{
+	while (true) {
+		if (task_scheduler_pop(scheduler, queue_index, NULL, task))
+			return true;
+
+		if (scheduler->do_exit)
+			return false;
+
+		/* Nothing left to do, sleep until new tasks are pushed. The sleeping
+		 * counter is incremented before checking for queued tasks, so a push
+		 * that happens meanwhile is guaranteed to see it and notify us. */
+		BLI_mutex_lock(&scheduler->wait_mutex);
+
+		atomic_add_uint32(&scheduler->num_sleeping, 1);
+
+		while (*(volatile uint32_t *)&scheduler->num_queued == 0 && !scheduler->do_exit)
+			BLI_condition_wait(&scheduler->wait_cond, &scheduler->wait_mutex);
+
+		atomic_sub_uint32(&scheduler->num_sleeping, 1);
+
+		BLI_mutex_unlock(&scheduler->wait_mutex);
+	}
 }
 
 static void *task_scheduler_thread_run(void *thread_p)
@@ -129,17 +236,17 @@ static void *task_scheduler_thread_run(void *thread_p)
 	int thread_id = thread->id;
 	Task *task;
 
+	pthread_setspecific(scheduler->thread_key, thread);
+
 	/* keep popping off tasks */
-	while (task_scheduler_thread_wait_pop(scheduler, &task)) {
+	while (task_scheduler_thread_wait_pop(scheduler, thread_id, &task)) {
 		TaskPool *pool = task->pool;
 
 		/* run task */
 		task->run(pool, task->taskdata, thread_id);
 
 		/* delete task */
-		if (task->free_taskdata)
-			MEM_freeN(task->taskdata);
-		MEM_freeN(task);
+		task_free(task);
 
 		/* notify pool task was done */
 		task_pool_num_decrease(pool, 1);
@@ -151,14 +258,15 @@ static void *task_scheduler_thread_run(void *thread_p)
 TaskScheduler *BLI_task_scheduler_create(int num_threads)
 {
 	TaskScheduler *scheduler = MEM_callocN(sizeof(TaskScheduler), "TaskScheduler");
+	int i;
 
 	/* multiple places can use this task scheduler, sharing the same
 	 * threads, so we keep track of the number of users. */
 	scheduler->do_exit = false;
 
-	BLI_listbase_clear(&scheduler->queue);
-	BLI_mutex_init(&scheduler->queue_mutex);
-	BLI_condition_init(&scheduler->queue_cond);
+	BLI_mutex_init(&scheduler->wait_mutex);
+	BLI_condition_init(&scheduler->wait_cond);
+	pthread_key_create(&scheduler->thread_key, NULL);
 
 	if (num_threads == 0) {
 		/* automatic number of threads will be main thread + num cores */
@@ -168,10 +276,20 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
 	/* main thread will also work, so we count it too */
 	num_threads -= 1;
 
+	/* one queue for every worker thread and one for the main thread */
+	scheduler->num_queues = MAX2(num_threads, 0) + 1;
+	scheduler->queues = MEM_callocN(sizeof(TaskQueue) * scheduler->num_queues, "TaskScheduler queues");
+
+	for (i = 0; i < scheduler->num_queues; i++) {
+		BLI_listbase_clear(&scheduler->queues[i].tasks);
+		BLI_mutex_init(&scheduler->queues[i].mutex);
+	}
+
+	BLI_listbase_clear(&scheduler->high_queue.tasks);
+	BLI_mutex_init(&scheduler->high_queue.mutex);
+
 	/* launch threads that will be waiting for work */
 	if (num_threads > 0) {
-		int i;
-
 		scheduler->num_threads = num_threads;
 		scheduler->threads = MEM_callocN(sizeof(pthread_t) * num_threads, "TaskScheduler threads");
 		scheduler->task_threads = MEM_callocN(sizeof(TaskThread) * num_threads, "TaskScheduler task threads");
@@ -183,7 +301,6 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
 
 			if (pthread_create(&scheduler->threads[i], NULL, task_scheduler_thread_run, thread) != 0) {
 				fprintf(stderr, "TaskScheduler failed to launch thread %d/%d\n", i, num_threads);
-				MEM_freeN(thread);
 			}
 		}
 	}
@@ -191,20 +308,31 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
 	return scheduler;
 }
 
-void BLI_task_scheduler_free(TaskScheduler *scheduler)
+static void task_queue_free(TaskQueue *queue)
 {
 	Task *task;
 
+	for (task = queue->tasks.first; task; task = task->next) {
+		if (task->free_taskdata)
+			MEM_freeN(task->taskdata);
+	}
+	BLI_freelistN(&queue->tasks);
+
+	BLI_mutex_end(&queue->mutex);
+}
+
+void BLI_task_scheduler_free(TaskScheduler *scheduler)
+{
+	int i;
+
 	/* stop all waiting threads */
-	BLI_mutex_lock(&scheduler->queue_mutex);
+	BLI_mutex_lock(&scheduler->wait_mutex);
 	scheduler->do_exit = true;
-	BLI_condition_notify_all(&scheduler->queue_cond);
-	BLI_mutex_unlock(&scheduler->queue_mutex);
+	BLI_condition_notify_all(&scheduler->wait_cond);
+	BLI_mutex_unlock(&scheduler->wait_mutex);
 
 	/* delete threads */
 	if (scheduler->threads) {
-		int i;
-
 		for (i = 0; i < scheduler->num_threads; i++) {
 			if (pthread_join(scheduler->threads[i], NULL) != 0)
 				fprintf(stderr, "TaskScheduler failed to join thread %d/%d\n", i, scheduler->num_threads);
@@ -219,15 +347,17 @@ void BLI_task_scheduler_free(TaskScheduler *scheduler)
 	}
 
 	/* delete leftover tasks */
-	for (task = scheduler->queue.first; task; task = task->next) {
-		if (task->free_taskdata)
-			MEM_freeN(task->taskdata);
+	for (i = 0; i < scheduler->num_queues; i++) {
+		task_queue_free(&scheduler->queues[i]);
 	}
-	BLI_freelistN(&scheduler->queue);
+	MEM_freeN(scheduler->queues);
+
+	task_queue_free(&scheduler->high_queue);
 
 	/* delete mutex/condition */
-	BLI_mutex_end(&scheduler->queue_mutex);
-	BLI_condition_end(&scheduler->queue_cond);
+	BLI_mutex_end(&scheduler->wait_mutex);
+	BLI_condition_end(&scheduler->wait_cond);
+	pthread_key_delete(scheduler->thread_key);
 
 	MEM_freeN(scheduler);
 }
@@ -237,43 +367,95 @@ int BLI_task_scheduler_num_threads(TaskScheduler *scheduler)
 	return scheduler->num_threads + 1;
 }
 
+int BLI_task_scheduler_thread_id(TaskScheduler *scheduler)
+{
+	return task_scheduler_thread_queue(scheduler);
+}
+
 static void task_scheduler_push(TaskScheduler *scheduler, Task *task, TaskPriority priority)
 {
+	TaskQueue *queue;
+
 	task_pool_num_increase(task->pool);
 
-	/* add task to queue */
-	BLI_mutex_lock(&scheduler->queue_mutex);
+	if (priority == TASK_PRIORITY_HIGH) {
+		queue = &scheduler->high_queue;
+	}
+	else if (scheduler->num_threads == 0) {
+		/* no worker threads, everything runs from queue 0 */
+		queue = &scheduler->queues[0];
+	}
+	else {
+		/* worker threads push to their own queue, other threads spread their
+		 * tasks over all queues so workers don't need to steal them */
+		int queue_index = task_scheduler_thread_queue(scheduler);
+		if (queue_index == 0) {
+			queue_index = atomic_add_uint32(&scheduler->push_index, 1) % scheduler->num_queues;
+		}
+		queue = &scheduler->queues[queue_index];
+	}
+
+	/* count before adding, so num_queued never drops below the real number of
+	 * queued tasks when another thread pops the task right away. This is also
+	 * the barrier which makes sure a thread going to sleep either sees the task
+	 * or is seen in num_sleeping below */
+	if (scheduler->num_threads > 0)
+		atomic_add_uint32(&scheduler->num_queued, 1);
+
+	/* add task to queue, high priority tasks in front like the single queue did */
+	BLI_mutex_lock(&queue->mutex);
 
 	if (priority == TASK_PRIORITY_HIGH)
-		BLI_addhead(&scheduler->queue, task);
+		BLI_addhead(&queue->tasks, task);
 	else
-		BLI_addtail(&scheduler->queue, task);
+		BLI_addtail(&queue->tasks, task);
 
-	BLI_condition_notify_one(&scheduler->queue_cond);
-	BLI_mutex_unlock(&scheduler->queue_mutex);
+	BLI_mutex_unlock(&queue->mutex);
+
+	/* wake up a sleeping thread, if any */
+	if (*(volatile uint32_t *)&scheduler->num_sleeping != 0) {
+		BLI_mutex_lock(&scheduler->wait_mutex);
+		BLI_condition_notify_one(&scheduler->wait_cond);
+		BLI_mutex_unlock(&scheduler->wait_mutex);
+	}
 }
 
-static void task_scheduler_clear(TaskScheduler *scheduler, TaskPool *pool)
+/* free all tasks from this pool from the queue, returns the number of tasks freed */
+static size_t task_queue_clear(TaskScheduler *scheduler, TaskQueue *queue, TaskPool *pool)
 {
 	Task *task, *nexttask;
 	size_t done = 0;
 
-	BLI_mutex_lock(&scheduler->queue_mutex);
+	BLI_mutex_lock(&queue->mutex);
 
-	/* free all tasks from this pool from the queue */
-	for (task = scheduler->queue.first; task; task = nexttask) {
+	for (task = queue->tasks.first; task; task = nexttask) {
 		nexttask = task->next;
 
 		if (task->pool == pool) {
-			if (task->free_taskdata)
-				MEM_freeN(task->taskdata);
-			BLI_freelinkN(&scheduler->queue, task);
+			BLI_remlink(&queue->tasks, task);
+			task_free(task);
 
 			done++;
 		}
 	}
 
-	BLI_mutex_unlock(&scheduler->queue_mutex);
+	BLI_mutex_unlock(&queue->mutex);
+
+	if (done && scheduler->num_threads > 0)
+		atomic_sub_uint32(&scheduler->num_queued, (uint32_t)done);
+
+	return done;
+}
+
+static void task_scheduler_clear(TaskScheduler *scheduler, TaskPool *pool)
+{
+	size_t done;
+	int i;
+
+	done = task_queue_clear(scheduler, &scheduler->high_queue, pool);
+	for (i = 0; i < scheduler->num_queues; i++) {
+		done += task_queue_clear(scheduler, &scheduler->queues[i], pool);
+	}
 
 	/* notify done */
 	task_pool_num_decrease(pool, done);
@@ -336,40 +518,28 @@ void BLI_task_pool_push(TaskPool *pool, TaskRunFunction run,
 void BLI_task_pool_work_and_wait(TaskPool *pool)
 {
 	TaskScheduler *scheduler = pool->scheduler;
+	int queue_index = task_scheduler_thread_queue(scheduler);
+	int thread_id = queue_index;
 
 	BLI_mutex_lock(&pool->num_mutex);
 
 	while (pool->num != 0) {
-		Task *task, *work_task = NULL;
-		bool found_task = false;
+		Task *work_task = NULL;
+		bool found_task;
 
 		BLI_mutex_unlock(&pool->num_mutex);
 
-		BLI_mutex_lock(&scheduler->queue_mutex);
-
 		/* find task from this pool. if we get a task from another pool,
 		 * we can get into deadlock */
-
-		for (task = scheduler->queue.first; task; task = task->next) {
-			if (task->pool == pool) {
-				work_task = task;
-				found_task = true;
-				BLI_remlink(&scheduler->queue, task);
-				break;
-			}
-		}
-
-		BLI_mutex_unlock(&scheduler->queue_mutex);
+		found_task = task_scheduler_pop(scheduler, queue_index, pool, &work_task);
 
 		/* if found task, do it, otherwise wait until other tasks are done */
 		if (found_task) {
 			/* run task */
-			work_task->run(pool, work_task->taskdata, 0);
+			work_task->run(pool, work_task->taskdata, thread_id);
 
 			/* delete task */
-			if (work_task->free_taskdata)
-				MEM_freeN(work_task->taskdata);
-			MEM_freeN(work_task);
+			task_free(work_task);
 
 			/* notify pool task was done */
 			task_pool_num_decrease(pool, 1);
@@ -428,3 +598,286 @@ size_t BLI_task_pool_tasks_done(TaskPool *pool)
 	return pool->done;
 }
 
+/* Parallel range routines */
+
+typedef struct ParallelRangeState {
+	int start, stop;
+	void *userdata;
+	TaskParallelRangeFunc func;
+
+	int iter;
+	int chunk_size;
+	SpinLock lock;
+} ParallelRangeState;
+
+BLI_INLINE bool parallel_range_next_iter_get(
+        ParallelRangeState *state,
+        int *iter, int *count)
+{
+	bool result = false;
+
+	BLI_spin_lock(&state->lock);
+	if (state->iter < state->stop) {
+		*count = MIN2(state->chunk_size, state->stop - state->iter);
+		*iter = state->iter;
+		state->iter += *count;
+		result = true;
+	}
+	BLI_spin_unlock(&state->lock);
+
+	return result;
+}
+
+static void parallel_range_func(TaskPool *pool, void *userdata_chunk, int UNUSED(threadid))
+{
+	ParallelRangeState *state = BLI_task_pool_userdata(pool);
+	int iter, count;
+
+	while (parallel_range_next_iter_get(state, &iter, &count)) {
+		int i;
+
+		for (i = 0; i < count; ++i) {
+			state->func(state->userdata, userdata_chunk, iter + i);
+		}
+	}
+}
+
+/* keep per-task chunks of userdata apart, so threads don't share cache lines */
+static size_t parallel_range_chunk_stride(const size_t userdata_chunk_size)
+{
+	const size_t align = 64;
+	return (userdata_chunk_size + align - 1) & ~(align - 1);
+}
+
+void BLI_task_parallel_range_ex(
+        int start, int stop,
+        void *userdata,
+        void *userdata_chunk,
+        const size_t userdata_chunk_size,
+        TaskParallelRangeFunc func,
+        TaskParallelRangeFuncFinalize func_finalize,
+        const int range_threshold,
+        const bool use_dynamic_scheduling)
+{
+	TaskScheduler *task_scheduler;
+	TaskPool *task_pool;
+	ParallelRangeState state;
+	const bool use_userdata_chunk = (userdata_chunk != NULL) && (userdata_chunk_size != 0);
+	char *userdata_chunk_array = NULL;
+	size_t chunk_stride = 0;
+	int i, num_threads, num_tasks;
+
+	if (start >= stop) {
+		return;
+	}
+
+	BLI_assert(start < stop);
+
+	task_scheduler = BLI_task_scheduler_get();
+	num_threads = BLI_task_scheduler_num_threads(task_scheduler);
+
+	/* If it's not enough data to be crunched, don't bother with tasks at all,
+	 * do everything from the current thread.
+	 */
+	if (num_threads == 1 || stop - start < range_threshold) {
+		void *userdata_chunk_local = NULL;
+
+		if (use_userdata_chunk) {
+			userdata_chunk_local = MEM_mallocN(userdata_chunk_size, "parallel range chunk");
+			memcpy(userdata_chunk_local, userdata_chunk, userdata_chunk_size);
+		}
+
+		for (i = start; i < stop; ++i) {
+			func(userdata, userdata_chunk_local, i);
+		}
+
+		if (use_userdata_chunk) {
+			if (func_finalize) {
+				func_finalize(userdata, userdata_chunk_local);
+			}
+			MEM_freeN(userdata_chunk_local);
+		}
+
+		return;
+	}
+
+	/* Use twice as many tasks as threads, so the main thread and the workers
+	 * stay busy even when some iterations are more expensive than others.
+	 * With dynamic scheduling the range is split in smaller chunks which are
+	 * handed out on demand, otherwise every task gets one equal share. */
+	num_tasks = num_threads * 2;
+
+	state.start = start;
+	state.stop = stop;
+	state.userdata = userdata;
+	state.func = func;
+	state.iter = start;
+	if (use_dynamic_scheduling) {
+		state.chunk_size = MAX2(1, (stop - start) / (num_tasks * 4));
+	}
+	else {
+		state.chunk_size = MAX2(1, (stop - start + num_tasks - 1) / num_tasks);
+	}
+	BLI_spin_init(&state.lock);
+
+	/* no point in launching more tasks than there are chunks */
+	num_tasks = MIN2(num_tasks, (stop - start + state.chunk_size - 1) / state.chunk_size);
+
+	if (use_userdata_chunk) {
+		chunk_stride = parallel_range_chunk_stride(userdata_chunk_size);
+		userdata_chunk_array = MEM_mallocN(chunk_stride * (size_t)num_tasks, "parallel range chunks");
+	}
+
+	task_pool = BLI_task_pool_create(task_scheduler, &state);
+
+	for (i = 0; i < num_tasks; i++) {
+		void *userdata_chunk_local = NULL;
+
+		if (use_userdata_chunk) {
+			userdata_chunk_local = userdata_chunk_array + chunk_stride * (size_t)i;
+			memcpy(userdata_chunk_local, userdata_chunk, userdata_chunk_size);
+		}
+
+		BLI_task_pool_push(task_pool,
+		                   parallel_range_func,
+		                   userdata_chunk_local, false,
+		                   TASK_PRIORITY_HIGH);
+	}
+
+	BLI_task_pool_work_and_wait(task_pool);
+	BLI_task_pool_free(task_pool);
+
+	BLI_spin_end(&state.lock);
+
+	if (use_userdata_chunk) {
+		if (func_finalize) {
+			for (i = 0; i < num_tasks; i++) {
+				func_finalize(userdata, userdata_chunk_array + chunk_stride * (size_t)i);
+			}
+		}
+		MEM_freeN(userdata_chunk_array);
+	}
+}
+
+void BLI_task_parallel_range(
+        int start, int stop,
+        void *userdata,
+        TaskParallelRangeFunc func)
+{
+	BLI_task_parallel_range_ex(start, stop, userdata, NULL, 0, func, NULL,
+	                           TASK_PARALLEL_RANGE_THRESHOLD, false);
+}
+
+void BLI_task_parallel_reduce(
+        int start, int stop,
+        void *userdata,
+        void *userdata_chunk,
+        const size_t userdata_chunk_size,
+        TaskParallelRangeFunc func,
+        TaskParallelRangeFuncFinalize func_finalize)
+{
+	BLI_task_parallel_range_ex(start, stop, userdata, userdata_chunk, userdata_chunk_size,
+	                           func, func_finalize, TASK_PARALLEL_RANGE_THRESHOLD, false);
+}
+
+/* Parallel listbase routines */
+
+typedef struct ParallelListState {
+	void *userdata;
+	TaskParallelListbaseFunc func;
+
+	int chunk_size;
+	int index;
+	Link *link;
+	SpinLock lock;
+} ParallelListState;
+
+BLI_INLINE Link *parallel_listbase_next_iter_get(
+        ParallelListState *state,
+        int *index, int *count)
+{
+	int task_count = 0;
+	Link *result;
+
+	BLI_spin_lock(&state->lock);
+	result = state->link;
+	*index = state->index;
+	while (state->link != NULL && task_count < state->chunk_size) {
+		++task_count;
+		state->link = state->link->next;
+	}
+	state->index += task_count;
+	BLI_spin_unlock(&state->lock);
+
+	*count = task_count;
+	return result;
+}
+
+static void parallel_listbase_func(TaskPool *pool, void *UNUSED(taskdata), int UNUSED(threadid))
+{
+	ParallelListState *state = BLI_task_pool_userdata(pool);
+	Link *link;
+	int index, count;
+
+	while ((link = parallel_listbase_next_iter_get(state, &index, &count)) != NULL) {
+		int i;
+
+		for (i = 0; i < count; ++i) {
+			state->func(state->userdata, link, index + i);
+			link = link->next;
+		}
+	}
+}
+
+void BLI_task_parallel_listbase(
+        ListBase *listbase,
+        void *userdata,
+        TaskParallelListbaseFunc func,
+        const bool use_threading)
+{
+	TaskScheduler *task_scheduler;
+	TaskPool *task_pool;
+	ParallelListState state;
+	int i, num_threads, num_tasks;
+
+	if (BLI_listbase_is_empty(listbase)) {
+		return;
+	}
+
+	task_scheduler = BLI_task_scheduler_get();
+	num_threads = BLI_task_scheduler_num_threads(task_scheduler);
+
+	if (!use_threading || num_threads == 1) {
+		Link *link;
+		i = 0;
+		for (link = listbase->first; link != NULL; link = link->next, i++) {
+			func(userdata, link, i);
+		}
+		return;
+	}
+
+	/* the length of a list is not known without walking it, so always
+	 * hand out small chunks on demand */
+	num_tasks = num_threads * 2;
+
+	state.index = 0;
+	state.link = listbase->first;
+	state.userdata = userdata;
+	state.func = func;
+	state.chunk_size = 32;
+	BLI_spin_init(&state.lock);
+
+	task_pool = BLI_task_pool_create(task_scheduler, &state);
+
+	for (i = 0; i < num_tasks; i++) {
+		BLI_task_pool_push(task_pool,
+		                   parallel_listbase_func,
+		                   NULL, false,
+		                   TASK_PRIORITY_HIGH);
+	}
+
+	BLI_task_pool_work_and_wait(task_pool);
+	BLI_task_pool_free(task_pool);
+
+	BLI_spin_end(&state.lock);
+}
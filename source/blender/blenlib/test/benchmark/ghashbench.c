@@ -0,0 +1,244 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/**
+ * Compare GHash and GHashFlat: insert, random lookup, iteration and remove
+ * of pointer, string and integer keys. Iteration is timed on the full table
+ * and again after half of the keys are removed.
+ *
+ * Also verifies both tables hold the same entries after a mix of inserts,
+ * reinserts and removes, and that no memory is leaked.
+ */
+
+/* To compile run (from this directory):
+ * gcc -O2 -std=gnu99 -DNDEBUG -I../.. -I../../../makesdna -I../../../../../intern/guardedalloc \
+ *     -I../../../../../intern/atomic ghashbench.c ../../intern/BLI_ghash.c ../../intern/BLI_ghash_flat.c \
+ *     ../../intern/BLI_mempool.c ../../intern/listbase.c ../../intern/time.c \
+ *     ../../../../../intern/guardedalloc/intern/mallocn*.c -lpthread -lm -o ghashbench
+ *
+ * Usage: ghashbench [num_keys]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_ghash.h"
+#include "BLI_ghash_flat.h"
+
+#include "PIL_time.h"
+
+/* wrappers so both tables can be benchmarked by the same code */
+typedef struct HashOps {
+	const char *name;
+	void *(*new_ptr)(const char *info);
+	void *(*new_str)(const char *info);
+	void *(*new_int)(const char *info);
+	void  (*insert)(void *gh, void *key, void *val);
+	void *(*lookup)(void *gh, const void *key);
+	bool  (*remove)(void *gh, void *key);
+	unsigned int (*iterate)(void *gh);
+	void  (*free)(void *gh);
+} HashOps;
+
+#define HASH_OPS_DEFINE(prefix, type) \
+	static void *prefix##_new_ptr(const char *info) { return BLI_##prefix##_ptr_new(info); } \
+	static void *prefix##_new_str(const char *info) { return BLI_##prefix##_str_new(info); } \
+	static void *prefix##_new_int(const char *info) { return BLI_##prefix##_int_new(info); } \
+	static void prefix##_insert(void *gh, void *key, void *val) { BLI_##prefix##_insert((type *)gh, key, val); } \
+	static void *prefix##_lookup(void *gh, const void *key) { return BLI_##prefix##_lookup((type *)gh, key); } \
+	static bool prefix##_remove(void *gh, void *key) { return BLI_##prefix##_remove((type *)gh, key, NULL, NULL); } \
+	static void prefix##_free(void *gh) { BLI_##prefix##_free((type *)gh, NULL, NULL); } \
+	static const HashOps prefix##_ops = { \
+		#prefix, prefix##_new_ptr, prefix##_new_str, prefix##_new_int, \
+		prefix##_insert, prefix##_lookup, prefix##_remove, prefix##_iterate, prefix##_free}
+
+/* count the entries whose value is the key, so the loop reads both */
+static unsigned int ghash_iterate(void *gh)
+{
+	GHashIterator iter;
+	unsigned int num = 0;
+
+	GHASH_ITER (iter, (GHash *)gh) {
+		if (BLI_ghashIterator_getKey(&iter) == BLI_ghashIterator_getValue(&iter)) {
+			num++;
+		}
+	}
+	return num;
+}
+
+static unsigned int ghashflat_iterate(void *gh)
+{
+	GHashFlatIterator iter;
+	unsigned int num = 0;
+
+	GHASHFLAT_ITER (iter, (GHashFlat *)gh) {
+		if (BLI_ghashflatIterator_getKey(&iter) == BLI_ghashflatIterator_getValue(&iter)) {
+			num++;
+		}
+	}
+	return num;
+}
+
+HASH_OPS_DEFINE(ghash, GHash);
+HASH_OPS_DEFINE(ghashflat, GHashFlat);
+
+static void bench_keys(const HashOps *ops, void *gh, const char *keytype, void **keys, unsigned int num_keys)
+{
+	double t_insert, t_lookup, t_iter, t_remove, t_iter_removed, t;
+	unsigned int i, found = 0, iterated, iterated_removed;
+
+	t = PIL_check_seconds_timer();
+	for (i = 0; i < num_keys; i++) {
+		ops->insert(gh, keys[i], keys[i]);
+	}
+	t_insert = PIL_check_seconds_timer() - t;
+
+	/* lookups in a random order, so the order of insertion doesn't help the cache */
+	t = PIL_check_seconds_timer();
+	for (i = 0; i < num_keys; i++) {
+		void *key = keys[(i * 2654435761u) % num_keys];
+		if (ops->lookup(gh, key) == key) {
+			found++;
+		}
+	}
+	t_lookup = PIL_check_seconds_timer() - t;
+
+	t = PIL_check_seconds_timer();
+	iterated = ops->iterate(gh);
+	t_iter = PIL_check_seconds_timer() - t;
+
+	t = PIL_check_seconds_timer();
+	for (i = 0; i < num_keys; i += 2) {
+		ops->remove(gh, keys[i]);
+	}
+	t_remove = PIL_check_seconds_timer() - t;
+
+	/* removed entries leave holes the iterator has to skip */
+	t = PIL_check_seconds_timer();
+	iterated_removed = ops->iterate(gh);
+	t_iter_removed = PIL_check_seconds_timer() - t;
+
+	ops->free(gh);
+
+	printf("  %-9s %-4s keys: insert %.3fs, lookup %.3fs, iterate %.3fs, remove %.3fs, iterate half %.3fs%s\n",
+	       ops->name, keytype, t_insert, t_lookup, t_iter, t_remove, t_iter_removed,
+	       (found == num_keys && iterated == num_keys && iterated_removed == num_keys / 2) ?
+	       "" : " (lookups or iteration failed!)");
+}
+
+/* both tables must hold the same entries after the same operations */
+static int test_same_entries(void **keys, unsigned int num_keys)
+{
+	GHashFlat *flat = BLI_ghashflat_ptr_new(__func__);
+	GHash *gh = BLI_ghash_ptr_new(__func__);
+	GHashFlatIterator iter;
+	unsigned int i;
+	int ok = 1, num_iter = 0;
+
+	for (i = 0; i < num_keys; i++) {
+		BLI_ghashflat_insert(flat, keys[i], SET_UINT_IN_POINTER(i));
+		BLI_ghash_insert(gh, keys[i], SET_UINT_IN_POINTER(i));
+	}
+	for (i = 0; i < num_keys; i += 3) {
+		BLI_ghashflat_remove(flat, keys[i], NULL, NULL);
+		BLI_ghash_remove(gh, keys[i], NULL, NULL);
+	}
+	for (i = 0; i < num_keys / 2; i += 2) {
+		BLI_ghashflat_reinsert(flat, keys[i], SET_UINT_IN_POINTER(i + 1), NULL, NULL);
+		BLI_ghash_reinsert(gh, keys[i], SET_UINT_IN_POINTER(i + 1), NULL, NULL);
+	}
+
+	for (i = 0; i < num_keys; i++) {
+		void **a = BLI_ghashflat_lookup_p(flat, keys[i]);
+		void **b = BLI_ghash_lookup_p(gh, keys[i]);
+		if ((a == NULL) != (b == NULL) || (a && *a != *b)) {
+			ok = 0;
+		}
+	}
+
+	GHASHFLAT_ITER (iter, flat) {
+		if (BLI_ghash_lookup(gh, BLI_ghashflatIterator_getKey(&iter)) != BLI_ghashflatIterator_getValue(&iter)) {
+			ok = 0;
+		}
+		num_iter++;
+	}
+	if (num_iter != BLI_ghash_size(gh) || BLI_ghashflat_size(flat) != BLI_ghash_size(gh)) {
+		ok = 0;
+	}
+
+	BLI_ghashflat_free(flat, NULL, NULL);
+	BLI_ghash_free(gh, NULL, NULL);
+	return ok;
+}
+
+int main(int argc, char *argv[])
+{
+	const unsigned int num_keys = (argc > 1) ? (unsigned int)atoi(argv[1]) : 2000000;
+	const HashOps *ops[2] = {&ghash_ops, &ghashflat_ops};
+	void **keys = malloc(sizeof(void *) * num_keys);
+	char **strs = malloc(sizeof(char *) * num_keys);
+	int error_status = 0;
+	unsigned int i;
+	int j;
+
+	/* pointer keys are allocated blocks, like the ID and DNA pointers most tables use */
+	for (i = 0; i < num_keys; i++) {
+		keys[i] = MEM_mallocN(16, "key");
+		strs[i] = malloc(16);
+		sprintf(strs[i], "key%u", i * 7919u);
+	}
+
+	if (!test_same_entries(keys, num_keys / 10)) {
+		fprintf(stderr, "|--* GHashFlat and GHash have different entries\n");
+		error_status = 1;
+	}
+
+	printf("%u keys:\n", num_keys);
+
+	for (j = 0; j < 2; j++) {
+		bench_keys(ops[j], ops[j]->new_ptr(__func__), "ptr", keys, num_keys);
+	}
+	for (j = 0; j < 2; j++) {
+		bench_keys(ops[j], ops[j]->new_str(__func__), "str", (void **)strs, num_keys);
+	}
+
+	for (i = 0; i < num_keys; i++) {
+		MEM_freeN(keys[i]);
+		keys[i] = SET_UINT_IN_POINTER(i * 7919u);
+		free(strs[i]);
+	}
+
+	for (j = 0; j < 2; j++) {
+		bench_keys(ops[j], ops[j]->new_int(__func__), "int", keys, num_keys);
+	}
+
+	free(keys);
+	free(strs);
+
+	if (MEM_get_memory_blocks_in_use() != 0) {
+		fprintf(stderr, "|--* Memory blocks not freed\n");
+		error_status = 1;
+	}
+
+	return error_status;
+}
@@ -0,0 +1,279 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/**
+ * Measure the overhead of the task scheduler with many small tasks:
+ * tasks pushed from the main thread, tasks pushed from inside other tasks
+ * (nested pools, like the depsgraph and modifiers do), and a parallel range
+ * with little work per iteration.
+ *
+ * Also verifies every task runs exactly once, a high priority task runs
+ * before low priority tasks queued by other threads, cancel works and no
+ * memory is leaked.
+ */
+
+/* To compile run (from this directory):
+ * gcc -O2 -std=gnu99 -DNDEBUG -I../.. -I../../../makesdna -I../../../../../intern/guardedalloc \
+ *     -I../../../../../intern/atomic taskbench.c ../../intern/task.c ../../intern/threads.c \
+ *     ../../intern/listbase.c ../../intern/gsqueue.c ../../intern/time.c ../../../../../intern/guardedalloc/intern/mallocn*.c \
+ *     -lpthread -lm -o taskbench
+ *
+ * Usage: taskbench [max_threads]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "PIL_time.h"
+
+#define NUM_TASKS (1000 * 1000)
+#define NUM_NESTED_TASKS 1000
+#define NUM_NESTED_SUBTASKS 1000
+#define NUM_RANGE_ITERATIONS (10 * 1000 * 1000)
+
+static void task_count(TaskPool *pool, void *UNUSED(taskdata), int UNUSED(threadid))
+{
+	int *counter = BLI_task_pool_userdata(pool);
+	__sync_fetch_and_add(counter, 1);
+}
+
+static void task_nested(TaskPool *pool, void *taskdata, int UNUSED(threadid))
+{
+	int *counter = BLI_task_pool_userdata(pool);
+	TaskPool *subpool = BLI_task_pool_create((TaskScheduler *)taskdata, counter);
+	int i;
+
+	for (i = 0; i < NUM_NESTED_SUBTASKS; i++) {
+		BLI_task_pool_push(subpool, task_count, NULL, false, TASK_PRIORITY_LOW);
+	}
+	BLI_task_pool_work_and_wait(subpool);
+	BLI_task_pool_free(subpool);
+}
+
+static void range_sum(void *UNUSED(userdata), void *userdata_chunk, int iter)
+{
+	*(long long *)userdata_chunk += iter;
+}
+
+static void range_finalize(void *userdata, void *userdata_chunk)
+{
+	__sync_fetch_and_add((long long *)userdata, *(long long *)userdata_chunk);
+}
+
+static int bench_flat(TaskScheduler *scheduler)
+{
+	int counter = 0;
+	TaskPool *pool = BLI_task_pool_create(scheduler, &counter);
+	double t = PIL_check_seconds_timer();
+	int i;
+
+	for (i = 0; i < NUM_TASKS; i++) {
+		BLI_task_pool_push(pool, task_count, NULL, false, TASK_PRIORITY_LOW);
+	}
+	BLI_task_pool_work_and_wait(pool);
+	t = PIL_check_seconds_timer() - t;
+	BLI_task_pool_free(pool);
+
+	printf("  flat:   %.3fs, %.2f M tasks/s\n", t, NUM_TASKS / t * 1e-6);
+	return counter == NUM_TASKS;
+}
+
+static int bench_nested(TaskScheduler *scheduler)
+{
+	int counter = 0;
+	TaskPool *pool = BLI_task_pool_create(scheduler, &counter);
+	double t = PIL_check_seconds_timer();
+	int i;
+
+	for (i = 0; i < NUM_NESTED_TASKS; i++) {
+		BLI_task_pool_push(pool, task_nested, scheduler, false, TASK_PRIORITY_LOW);
+	}
+	BLI_task_pool_work_and_wait(pool);
+	t = PIL_check_seconds_timer() - t;
+	BLI_task_pool_free(pool);
+
+	printf("  nested: %.3fs, %.2f M tasks/s\n", t, (double)NUM_NESTED_TASKS * NUM_NESTED_SUBTASKS / t * 1e-6);
+	return counter == NUM_NESTED_TASKS * NUM_NESTED_SUBTASKS;
+}
+
+static int bench_range(void)
+{
+	long long sum = 0, chunk = 0;
+	double t = PIL_check_seconds_timer();
+
+	BLI_task_parallel_reduce(0, NUM_RANGE_ITERATIONS, &sum, &chunk, sizeof(chunk),
+	                         range_sum, range_finalize);
+	t = PIL_check_seconds_timer() - t;
+
+	printf("  range:  %.3fs, %.2f M iterations/s\n", t, NUM_RANGE_ITERATIONS / t * 1e-6);
+	return sum == (long long)NUM_RANGE_ITERATIONS * (NUM_RANGE_ITERATIONS - 1) / 2;
+}
+
+#define NUM_PRIORITY_TASKS 1000
+
+typedef struct PriorityData {
+	int num_started;
+	int num_run;
+	volatile int high_order;
+	volatile bool push_high;
+	volatile bool release;
+	int pusher;
+} PriorityData;
+
+static void task_order(TaskPool *pool, void *taskdata, int UNUSED(threadid))
+{
+	PriorityData *data = BLI_task_pool_userdata(pool);
+	int order = __sync_fetch_and_add(&data->num_run, 1);
+	if (taskdata) {
+		data->high_order = order;
+	}
+}
+
+/* keeps a worker thread busy until released. One of them pushes the high
+ * priority task from the worker thread and stays busy until it ran, so it
+ * can't pop the task from its own queue itself */
+static void task_block(TaskPool *pool, void *UNUSED(taskdata), int UNUSED(threadid))
+{
+	PriorityData *data = BLI_task_pool_userdata(pool);
+
+	__sync_fetch_and_add(&data->num_started, 1);
+	while (!data->push_high) {
+		/* pass */
+	}
+
+	if (__sync_bool_compare_and_swap(&data->pusher, 0, 1)) {
+		BLI_task_pool_push(pool, task_order, data, false, TASK_PRIORITY_HIGH);
+		data->release = true;
+		while (data->high_order < 0 && __sync_fetch_and_add(&data->num_run, 0) < NUM_PRIORITY_TASKS) {
+			/* pass */
+		}
+	}
+	else {
+		while (!data->release) {
+			/* pass */
+		}
+	}
+}
+
+static int test_priority(TaskScheduler *scheduler)
+{
+	const int num_workers = BLI_task_scheduler_num_threads(scheduler) - 1;
+	PriorityData data = {0, 0, -1, false, false, 0};
+	TaskPool *pool;
+	int i;
+
+	/* the high priority task needs to be pushed from a worker thread */
+	if (num_workers == 0) {
+		return 1;
+	}
+
+	pool = BLI_task_pool_create(scheduler, &data);
+
+	/* occupy all workers, so the low priority tasks end up in every queue
+	 * before anything runs */
+	for (i = 0; i < num_workers; i++) {
+		BLI_task_pool_push(pool, task_block, NULL, false, TASK_PRIORITY_LOW);
+	}
+	while (__sync_fetch_and_add(&data.num_started, 0) != num_workers) {
+		/* pass */
+	}
+
+	for (i = 0; i < NUM_PRIORITY_TASKS; i++) {
+		BLI_task_pool_push(pool, task_order, NULL, false, TASK_PRIORITY_LOW);
+	}
+	data.push_high = true;
+	while (!data.release) {
+		/* pass */
+	}
+
+	BLI_task_pool_work_and_wait(pool);
+	BLI_task_pool_free(pool);
+
+	/* every thread can pop a task at the same time, all of them look at the
+	 * high priority task first */
+	if (data.high_order < 0 || data.high_order > num_workers) {
+		fprintf(stderr, "|--* High priority task ran as task %d of %d\n", data.high_order, NUM_PRIORITY_TASKS + 1);
+		return 0;
+	}
+	return 1;
+}
+
+static int test_cancel(TaskScheduler *scheduler)
+{
+	int counter = 0;
+	TaskPool *pool = BLI_task_pool_create(scheduler, &counter);
+	int i;
+
+	for (i = 0; i < NUM_TASKS / 10; i++) {
+		BLI_task_pool_push(pool, task_count, NULL, false, TASK_PRIORITY_LOW);
+	}
+	BLI_task_pool_cancel(pool);
+	BLI_task_pool_free(pool);
+
+	return counter <= NUM_TASKS / 10;
+}
+
+int main(int argc, char *argv[])
+{
+	int max_threads = (argc > 1) ? atoi(argv[1]) : 8;
+	int num_threads;
+	int error_status = 0;
+
+	BLI_threadapi_init();
+
+	for (num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+		TaskScheduler *scheduler = BLI_task_scheduler_create(num_threads);
+
+		printf("%d threads:\n", num_threads);
+
+		if (!bench_flat(scheduler) || !bench_nested(scheduler) || !test_cancel(scheduler)) {
+			fprintf(stderr, "|--* Wrong number of tasks executed\n");
+			error_status = 1;
+		}
+		if (!test_priority(scheduler)) {
+			error_status = 1;
+		}
+
+		BLI_task_scheduler_free(scheduler);
+	}
+
+	/* parallel range uses the global scheduler */
+	BLI_system_num_threads_override_set(max_threads);
+	printf("%d threads:\n", BLI_system_thread_count());
+	if (!bench_range()) {
+		fprintf(stderr, "|--* Wrong parallel range result\n");
+		error_status = 1;
+	}
+
+	BLI_threadapi_exit();
+
+	if (MEM_get_memory_blocks_in_use() != 0) {
+		fprintf(stderr, "|--* Memory blocks not freed\n");
+		error_status = 1;
+	}
+
+	return error_status;
+}
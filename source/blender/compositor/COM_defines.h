@@ -107,6 +107,20 @@ typedef enum OrderOfChunks {
 
 #define COM_NUMBER_OF_CHANNELS 4
 
+/**
+ * number of channels stored per pixel in a compact MemoryBuffer of a data type.
+ * vectors keep all 4 channels as the speed pass uses the 4th component of vector sockets.
+ */
+#define COM_NUM_CHANNELS_VALUE 1
+#define COM_NUM_CHANNELS_VECTOR 4
+#define COM_NUM_CHANNELS_COLOR 4
+
+/**
+ * COM_ROW_SIZE is the maximum number of pixels that is passed to SocketReader.executeRow at once.
+ * rows of this size are kept on the stack by the operations.
+ */
+#define COM_ROW_SIZE 64
+
 #define COM_BLUR_BOKEH_PIXELS 512
 
 #endif  /* __COM_DEFINES_H__ */
@@ -186,6 +186,13 @@ public:
 	void setFastCalculation(bool fastCalculation) {this->m_fastCalculation = fastCalculation;}
 	bool isFastCalculation() {return this->m_fastCalculation;}
 	inline bool isGroupnodeBufferEnabled() {return this->getbNodeTree()->flag & NTREE_COM_GROUPNODE_BUFFER;}
+	inline bool isHalfFloatBufferEnabled() {return this->getbNodeTree()->flag & NTREE_COM_HALF_FLOAT_BUFFER;}
+
+	/**
+	 * @brief get the maximum number of bytes the intermediate buffers may use, 0 when unlimited
+	 * @see MemoryBudget
+	 */
+	size_t getMemoryBudget() { return (size_t)this->getbNodeTree()->memory_budget * 1024 * 1024; }
 };
 
 
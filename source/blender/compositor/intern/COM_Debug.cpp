@@ -38,6 +38,7 @@ extern "C" {
 #include "COM_Node.h"
 #include "COM_ExecutionSystem.h"
 #include "COM_ExecutionGroup.h"
+#include "COM_MemoryBudget.h"
 
 #include "COM_ReadBufferOperation.h"
 #include "COM_ViewerOperation.h"
@@ -48,6 +49,9 @@ int DebugInfo::m_file_index = 0;
 DebugInfo::NodeNameMap DebugInfo::m_node_names;
 std::string DebugInfo::m_current_node_name;
 DebugInfo::GroupStateMap DebugInfo::m_group_states;
+int DebugInfo::m_cache_hits = 0;
+int DebugInfo::m_cache_misses = 0;
+double DebugInfo::m_cache_time_saved = 0.0;
 
 std::string DebugInfo::node_name(NodeBase *node)
 {
@@ -67,6 +71,9 @@ void DebugInfo::execute_started(ExecutionSystem *system)
 {
 	m_file_index = 1;
 	m_group_states.clear();
+	m_cache_hits = 0;
+	m_cache_misses = 0;
+	m_cache_time_saved = 0.0;
 	for (int i = 0; i < system->getExecutionGroups().size(); ++i)
 		m_group_states[system->getExecutionGroups()[i]] = EG_WAIT;
 }
@@ -101,6 +108,67 @@ void DebugInfo::execution_group_finished(ExecutionGroup *group)
 	m_group_states[group] = EG_FINISHED;
 }
 
+static std::string group_name(ExecutionGroup *group)
+{
+	NodeOperation *operation = group->getOutputNodeOperation();
+	if (operation->isWriteBufferOperation())
+		operation = ((WriteBufferOperation *)operation)->getInput();
+	return DebugInfo::node_name(operation);
+}
+
+void DebugInfo::result_cache_hit(ExecutionGroup *group, double time_saved)
+{
+	m_group_states[group] = EG_FINISHED;
+	m_cache_hits++;
+	m_cache_time_saved += time_saved;
+	printf("Compositor cache hit: %s (%ux%u), saved %.3f sec\n",
+	       group_name(group).c_str(), group->getWidth(), group->getHeight(), time_saved);
+}
+
+void DebugInfo::result_cache_miss(ExecutionGroup *group)
+{
+	m_cache_misses++;
+	printf("Compositor cache miss: %s (%ux%u)\n",
+	       group_name(group).c_str(), group->getWidth(), group->getHeight());
+}
+
+void DebugInfo::result_cache_finished()
+{
+	printf("Compositor cache: %d hits, %d misses, saved %.3f sec\n",
+	       m_cache_hits, m_cache_misses, m_cache_time_saved);
+}
+
+void DebugInfo::memory_buffers(ExecutionSystem *system)
+{
+	const vector<NodeOperation *> &operations = system->getOperations();
+	size_t used = 0, full = 0;
+	int compact = 0, half = 0, total = 0;
+
+	for (int i = 0; i < operations.size(); ++i) {
+		if (!operations[i]->isWriteBufferOperation())
+			continue;
+		MemoryBuffer *buffer = ((WriteBufferOperation *)operations[i])->getMemoryProxy()->getBuffer();
+		if (!buffer)
+			continue;
+		total++;
+		if (buffer->isCompact())
+			compact++;
+		if (buffer->isHalfFloat())
+			half++;
+		used += buffer->getMemorySize();
+		full += (size_t)buffer->getWidth() * buffer->getHeight() * COM_NUMBER_OF_CHANNELS * sizeof(float);
+	}
+
+	printf("Compositor buffers: %d (%d compact, %d half float), %.2f MB (%.2f MB as float RGBA)\n",
+	       total, compact, half, used / (1024.0 * 1024.0), full / (1024.0 * 1024.0));
+}
+
+void DebugInfo::memory_budget(MemoryBudget *budget)
+{
+	printf("Compositor memory budget: %.2f MB written to disk, %.2f MB read from disk\n",
+	       budget->getBytesWritten() / (1024.0 * 1024.0), budget->getBytesRead() / (1024.0 * 1024.0));
+}
+
 int DebugInfo::graphviz_operation(ExecutionSystem *system, NodeOperation *operation, ExecutionGroup *group, char *str, int maxlen)
 {
 	int len = 0;
@@ -408,6 +476,11 @@ void DebugInfo::operation_added(NodeOperation * /*operation*/) {}
 void DebugInfo::operation_read_write_buffer(NodeOperation * /*operation*/) {}
 void DebugInfo::execution_group_started(ExecutionGroup * /*group*/) {}
 void DebugInfo::execution_group_finished(ExecutionGroup * /*group*/) {}
+void DebugInfo::result_cache_hit(ExecutionGroup * /*group*/, double /*time_saved*/) {}
+void DebugInfo::result_cache_miss(ExecutionGroup * /*group*/) {}
+void DebugInfo::result_cache_finished() {}
+void DebugInfo::memory_buffers(ExecutionSystem * /*system*/) {}
+void DebugInfo::memory_budget(MemoryBudget * /*budget*/) {}
 void DebugInfo::graphviz(ExecutionSystem * /*system*/) {}
 
 #endif
@@ -32,6 +32,7 @@ class Node;
 class NodeOperation;
 class ExecutionSystem;
 class ExecutionGroup;
+class MemoryBudget;
 
 class DebugInfo {
 public:
@@ -57,6 +58,13 @@ public:
 	static void execution_group_started(ExecutionGroup *group);
 	static void execution_group_finished(ExecutionGroup *group);
 	
+	static void result_cache_hit(ExecutionGroup *group, double time_saved);
+	static void result_cache_miss(ExecutionGroup *group);
+	static void result_cache_finished();
+	
+	static void memory_buffers(ExecutionSystem *system);
+	static void memory_budget(MemoryBudget *budget);
+	
 	static void graphviz(ExecutionSystem *system);
 	
 #ifdef COM_DEBUG
@@ -73,6 +81,9 @@ private:
 	static NodeNameMap m_node_names;			/**< map nodes to usable names for debug output */
 	static std::string m_current_node_name;		/**< base name for all operations added by a node */
 	static GroupStateMap m_group_states;		/**< for visualizing group states */
+	static int m_cache_hits;					/**< ResultCache statistics of the current execution */
+	static int m_cache_misses;
+	static double m_cache_time_saved;
 #endif
 };
 
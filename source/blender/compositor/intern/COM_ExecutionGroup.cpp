@@ -52,6 +52,7 @@ ExecutionGroup::ExecutionGroup()
 	this->m_isOutput = false;
 	this->m_complex = false;
 	this->m_chunkExecutionStates = NULL;
+	this->m_chunkExecutionTimes = NULL;
 	this->m_bTree = NULL;
 	this->m_height = 0;
 	this->m_width = 0;
@@ -156,15 +157,20 @@ void ExecutionGroup::initExecution()
 	if (this->m_chunkExecutionStates != NULL) {
 		MEM_freeN(this->m_chunkExecutionStates);
 	}
+	if (this->m_chunkExecutionTimes != NULL) {
+		MEM_freeN(this->m_chunkExecutionTimes);
+	}
 	unsigned int index;
 	determineNumberOfChunks();
 
 	this->m_chunkExecutionStates = NULL;
+	this->m_chunkExecutionTimes = NULL;
 	if (this->m_numberOfChunks != 0) {
 		this->m_chunkExecutionStates = (ChunkExecutionState *)MEM_mallocN(sizeof(ChunkExecutionState) * this->m_numberOfChunks, __func__);
 		for (index = 0; index < this->m_numberOfChunks; index++) {
 			this->m_chunkExecutionStates[index] = COM_ES_NOT_SCHEDULED;
 		}
+		this->m_chunkExecutionTimes = (double *)MEM_callocN(sizeof(double) * this->m_numberOfChunks, __func__);
 	}
 
 
@@ -189,6 +195,10 @@ void ExecutionGroup::deinitExecution()
 		MEM_freeN(this->m_chunkExecutionStates);
 		this->m_chunkExecutionStates = NULL;
 	}
+	if (this->m_chunkExecutionTimes != NULL) {
+		MEM_freeN(this->m_chunkExecutionTimes);
+		this->m_chunkExecutionTimes = NULL;
+	}
 	this->m_numberOfChunks = 0;
 	this->m_numberOfXChunks = 0;
 	this->m_numberOfYChunks = 0;
@@ -468,6 +478,7 @@ void ExecutionGroup::finalizeChunkExecution(int chunkNumber, MemoryBuffer **memo
 		}
 		MEM_freeN(memoryBuffers);
 	}
+	releaseMemoryProxies(true);
 	if (this->m_bTree) {
 		// status report is only performed for top level Execution Groups.
 		float progress = this->m_chunksFinished;
@@ -479,6 +490,36 @@ void ExecutionGroup::finalizeChunkExecution(int chunkNumber, MemoryBuffer **memo
 	}
 }
 
+double ExecutionGroup::getExecutionTime() const
+{
+	double time = 0.0;
+	for (unsigned int index = 0; index < this->m_numberOfChunks; index++) {
+		time += this->m_chunkExecutionTimes[index];
+	}
+	return time;
+}
+
+bool ExecutionGroup::isFullyExecuted() const
+{
+	if (this->m_numberOfChunks == 0) {
+		return false;
+	}
+	for (unsigned int index = 0; index < this->m_numberOfChunks; index++) {
+		if (this->m_chunkExecutionStates[index] != COM_ES_EXECUTED) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void ExecutionGroup::setFullyExecuted()
+{
+	for (unsigned int index = 0; index < this->m_numberOfChunks; index++) {
+		this->m_chunkExecutionStates[index] = COM_ES_EXECUTED;
+	}
+	this->m_chunksFinished = this->m_numberOfChunks;
+}
+
 inline void ExecutionGroup::determineChunkRect(rcti *rect, const unsigned int xChunk, const unsigned int yChunk) const
 {
 	const int border_width = BLI_rcti_size_x(&this->m_viewerBorder);
@@ -554,6 +595,8 @@ bool ExecutionGroup::scheduleChunk(unsigned int chunkNumber)
 {
 	if (this->m_chunkExecutionStates[chunkNumber] == COM_ES_NOT_SCHEDULED) {
 		this->m_chunkExecutionStates[chunkNumber] = COM_ES_SCHEDULED;
+		/* released in finalizeChunkExecution */
+		acquireMemoryProxies(true);
 		WorkScheduler::schedule(this, chunkNumber);
 		return true;
 	}
@@ -589,6 +632,9 @@ bool ExecutionGroup::scheduleChunkWhenPossible(ExecutionSystem *graph, int xChun
 	bool canBeExecuted = true;
 	rcti area;
 
+	/* page in the buffers that are read by determineDependingAreaOfInterest of some operations */
+	acquireMemoryProxies(false);
+
 	for (index = 0; index < this->m_cachedReadOperations.size(); index++) {
 		ReadBufferOperation *readOperation = (ReadBufferOperation *)this->m_cachedReadOperations[index];
 		BLI_rcti_init(&area, 0, 0, 0, 0);
@@ -606,6 +652,8 @@ bool ExecutionGroup::scheduleChunkWhenPossible(ExecutionSystem *graph, int xChun
 		}
 	}
 
+	releaseMemoryProxies(false);
+
 	if (canBeExecuted) {
 		scheduleChunk(chunkNumber);
 	}
@@ -613,6 +661,32 @@ bool ExecutionGroup::scheduleChunkWhenPossible(ExecutionSystem *graph, int xChun
 	return false;
 }
 
+void ExecutionGroup::acquireMemoryProxies(bool output)
+{
+	unsigned int index;
+	for (index = 0; index < this->m_cachedReadOperations.size(); index++) {
+		ReadBufferOperation *readOperation = (ReadBufferOperation *)this->m_cachedReadOperations[index];
+		readOperation->getMemoryProxy()->acquire(false);
+	}
+	if (output && this->getOutputNodeOperation()->isWriteBufferOperation()) {
+		WriteBufferOperation *writeOperation = (WriteBufferOperation *)this->getOutputNodeOperation();
+		writeOperation->getMemoryProxy()->acquire(true);
+	}
+}
+
+void ExecutionGroup::releaseMemoryProxies(bool output)
+{
+	unsigned int index;
+	for (index = 0; index < this->m_cachedReadOperations.size(); index++) {
+		ReadBufferOperation *readOperation = (ReadBufferOperation *)this->m_cachedReadOperations[index];
+		readOperation->getMemoryProxy()->release();
+	}
+	if (output && this->getOutputNodeOperation()->isWriteBufferOperation()) {
+		WriteBufferOperation *writeOperation = (WriteBufferOperation *)this->getOutputNodeOperation();
+		writeOperation->getMemoryProxy()->release();
+	}
+}
+
 void ExecutionGroup::determineDependingAreaOfInterest(rcti *input, ReadBufferOperation *readOperation, rcti *output)
 {
 	this->getOutputNodeOperation()->determineDependingAreaOfInterest(input, readOperation, output);
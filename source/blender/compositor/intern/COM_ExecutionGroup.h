@@ -150,6 +150,11 @@ private:
 	 *   - COM_ES_EXECUTED: executed
 	 */
 	ChunkExecutionState *m_chunkExecutionStates;
+
+	/**
+	 * @brief time in seconds a device spent on every chunk, used to report the time saved by the ResultCache
+	 */
+	double *m_chunkExecutionTimes;
 	
 	/**
 	 * @brief indicator when this ExecutionGroup has valid NodeOperations in its vector for Execution
@@ -231,6 +236,18 @@ private:
 	 * @param chunknumber
 	 */
 	bool scheduleChunk(unsigned int chunkNumber);
+
+	/**
+	 * @brief keep the buffers that are read by this ExecutionGroup in memory
+	 * @param output also keep the buffer this ExecutionGroup writes to in memory
+	 * @see MemoryProxy.acquire
+	 */
+	void acquireMemoryProxies(bool output);
+
+	/**
+	 * @brief release the buffers acquired by acquireMemoryProxies
+	 */
+	void releaseMemoryProxies(bool output);
 	
 	/**
 	 * @brief determine the area of interest of a certain input area
@@ -358,6 +375,29 @@ public:
 	 * @param memorybuffers
 	 */
 	void finalizeChunkExecution(int chunkNumber, MemoryBuffer **memoryBuffers);
+
+	/**
+	 * @brief store the time a device spent on executing a chunk
+	 * @param chunkNumber
+	 * @param time time in seconds
+	 */
+	void setChunkExecutionTime(unsigned int chunkNumber, double time) { this->m_chunkExecutionTimes[chunkNumber] = time; }
+
+	/**
+	 * @brief total time spent on the chunks of this ExecutionGroup during this execution
+	 */
+	double getExecutionTime() const;
+
+	/**
+	 * @brief are all chunks of this ExecutionGroup executed
+	 */
+	bool isFullyExecuted() const;
+
+	/**
+	 * @brief mark all chunks as executed, used when the result is loaded from the ResultCache
+	 * @note dependent ExecutionGroups will not be scheduled for this group anymore
+	 */
+	void setFullyExecuted();
 	
 	/**
 	 * @brief deinitExecution is called just after execution the whole graph.
@@ -419,6 +459,11 @@ public:
 
 	void setRenderBorder(float xmin, float xmax, float ymin, float ymax);
 
+	/**
+	 * @brief get the border of this ExecutionGroup in pixel space
+	 */
+	const rcti *getViewerBorder() const { return &this->m_viewerBorder; }
+
 #ifdef WITH_CXX_GUARDEDALLOC
 	MEM_CXX_CLASS_ALLOC_FUNCS("COM:ExecutionGroup")
 #endif
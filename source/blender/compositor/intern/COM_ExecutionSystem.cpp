@@ -22,6 +22,8 @@
 
 #include "COM_ExecutionSystem.h"
 
+#include <set>
+
 #include "PIL_time.h"
 #include "BLI_utildefines.h"
 extern "C" {
@@ -39,6 +41,8 @@ extern "C" {
 #include "COM_ReadBufferOperation.h"
 #include "COM_ExecutionSystemHelper.h"
 #include "COM_Debug.h"
+#include "COM_ResultCache.h"
+#include "COM_MemoryBudget.h"
 
 #include "BKE_global.h"
 
@@ -49,6 +53,10 @@ extern "C" {
 ExecutionSystem::ExecutionSystem(RenderData *rd, Scene *scene, bNodeTree *editingtree, bool rendering, bool fastcalculation,
                                  const ColorManagedViewSettings *viewSettings, const ColorManagedDisplaySettings *displaySettings)
 {
+	this->m_currentNode = NULL;
+	this->m_memoryBudget = NULL;
+	this->m_testBreak = NULL;
+	this->m_tbh = NULL;
 	this->m_context.setScene(scene);
 	this->m_context.setbNodeTree(editingtree);
 	this->m_context.setPreviewHash(editingtree->previews);
@@ -71,6 +79,7 @@ ExecutionSystem::ExecutionSystem(RenderData *rd, Scene *scene, bNodeTree *editin
 
 	this->convertToOperations();
 	this->groupOperations(); /* group operations in ExecutionGroups */
+	this->determineMemoryProxyStorage();
 	unsigned int index;
 	unsigned int resolution[2];
 
@@ -145,6 +154,27 @@ void ExecutionSystem::execute()
 	}
 	unsigned int index;
 
+	/* the buffers are only allocated when they are used, this needs to be set up before they are allocated */
+	if (this->m_context.getMemoryBudget() > 0) {
+		bNodeTree *bTree = (bNodeTree *)this->m_context.getbNodeTree();
+
+		this->m_memoryBudget = new MemoryBudget(this->m_context.getMemoryBudget());
+		for (index = 0; index < this->m_operations.size(); index++) {
+			NodeOperation *operation = this->m_operations[index];
+			if (operation->isWriteBufferOperation() &&
+			    operation->getWidth() * operation->getHeight() >= COM_MEMORY_BUDGET_MIN_PIXELS)
+			{
+				this->m_memoryBudget->addMemoryProxy(((WriteBufferOperation *)operation)->getMemoryProxy());
+			}
+		}
+
+		/* operations and groups stop like the user cancelled when the budget fails */
+		this->m_testBreak = bTree->test_break;
+		this->m_tbh = bTree->tbh;
+		bTree->test_break = testBreak;
+		bTree->tbh = this;
+	}
+
 	for (index = 0; index < this->m_operations.size(); index++) {
 		NodeOperation *operation = this->m_operations[index];
 		operation->setbNodeTree(this->m_context.getbNodeTree());
@@ -162,6 +192,19 @@ void ExecutionSystem::execute()
 		executionGroup->setChunksize(this->m_context.getChunksize());
 		executionGroup->initExecution();
 	}
+	if (this->m_memoryBudget) {
+		this->m_memoryBudget->initExecution();
+		for (index = 0; index < this->m_groups.size(); index++) {
+			ExecutionGroup *executionGroup = this->m_groups[index];
+			vector<MemoryProxy *> memoryProxies;
+			executionGroup->determineDependingMemoryProxies(&memoryProxies);
+			for (unsigned int proxyIndex = 0; proxyIndex < memoryProxies.size(); proxyIndex++) {
+				this->m_memoryBudget->addReader(memoryProxies[proxyIndex], executionGroup);
+			}
+		}
+	}
+
+	ResultCache::restoreResults(this);
 
 	WorkScheduler::start(this->m_context);
 
@@ -174,6 +217,10 @@ void ExecutionSystem::execute()
 	WorkScheduler::finish();
 	WorkScheduler::stop();
 
+	DebugInfo::memory_buffers(this);
+
+	ResultCache::storeResults(this);
+
 	for (index = 0; index < this->m_operations.size(); index++) {
 		NodeOperation *operation = this->m_operations[index];
 		operation->deinitExecution();
@@ -182,6 +229,33 @@ void ExecutionSystem::execute()
 		ExecutionGroup *executionGroup = this->m_groups[index];
 		executionGroup->deinitExecution();
 	}
+
+	/* deleted after the deinitExecution of the output operations, they don't publish their result
+	 * when the execution was cancelled */
+	if (this->m_memoryBudget) {
+		bNodeTree *bTree = (bNodeTree *)this->m_context.getbNodeTree();
+
+		DebugInfo::memory_budget(this->m_memoryBudget);
+
+		bTree->test_break = this->m_testBreak;
+		bTree->tbh = this->m_tbh;
+		if (this->m_memoryBudget->hasFailed() && bTree->stats_draw) {
+			bTree->stats_draw(bTree->sdh, (char *)this->m_memoryBudget->getErrorMessage());
+		}
+
+		delete this->m_memoryBudget;
+		this->m_memoryBudget = NULL;
+	}
+}
+
+int ExecutionSystem::testBreak(void *system_)
+{
+	ExecutionSystem *system = (ExecutionSystem *)system_;
+
+	if (system->m_memoryBudget->hasFailed()) {
+		return true;
+	}
+	return system->m_testBreak && system->m_testBreak(system->m_tbh);
 }
 
 void ExecutionSystem::executeGroups(CompositorPriority priority)
@@ -199,6 +273,9 @@ void ExecutionSystem::executeGroups(CompositorPriority priority)
 void ExecutionSystem::addOperation(NodeOperation *operation)
 {
 	ExecutionSystemHelper::addOperation(this->m_operations, operation);
+	if (this->m_currentNode && !operation->getbNode()) {
+		operation->setbNode(this->m_currentNode->getbNode());
+	}
 	DebugInfo::operation_added(operation);
 }
 
@@ -309,7 +386,9 @@ void ExecutionSystem::convertToOperations()
 	for (index = 0; index < this->m_nodes.size(); index++) {
 		Node *node = (Node *)this->m_nodes[index];
 		DebugInfo::node_to_operations(node);
+		this->m_currentNode = node;
 		node->convertToOperations(this, &this->m_context);
+		this->m_currentNode = NULL;
 
 		debug_check_node_connections(node);
 	}
@@ -376,6 +455,57 @@ void ExecutionSystem::groupOperations()
 	}
 }
 
+void ExecutionSystem::determineMemoryProxyStorage()
+{
+	const bool useHalfFloat = this->m_context.isHalfFloatBufferEnabled();
+	std::set<MemoryProxy *> directAccessProxies;
+	unsigned int index;
+
+	/* complex operations access the buffers of their inputs directly,
+	 * these buffers keep COM_NUMBER_OF_CHANNELS floats per pixel.
+	 * Most buffers are inputs of complex operations, only the outputs of complex operations
+	 * that are read pixel by pixel get smaller (see test/benchmark/memorybench.cpp) */
+	for (index = 0; index < this->m_operations.size(); index++) {
+		NodeOperation *operation = this->m_operations[index];
+		if (operation->isReadBufferOperation()) {
+			ReadBufferOperation *readOperation = (ReadBufferOperation *)operation;
+			OutputSocket *socket = readOperation->getOutputSocket();
+			for (unsigned int i = 0; i < socket->getNumberOfConnections(); i++) {
+				NodeBase *node = socket->getConnection(i)->getToNode();
+				if (node->isOperation() && ((NodeOperation *)node)->isComplex()) {
+					directAccessProxies.insert(readOperation->getMemoryProxy());
+				}
+			}
+		}
+	}
+
+	/* all other buffers are only read pixel by pixel, store them in the layout of their data type */
+	for (index = 0; index < this->m_operations.size(); index++) {
+		NodeOperation *operation = this->m_operations[index];
+		if (operation->isWriteBufferOperation()) {
+			WriteBufferOperation *writeOperation = (WriteBufferOperation *)operation;
+			MemoryProxy *memoryProxy = writeOperation->getMemoryProxy();
+			InputSocket *socket = writeOperation->getInputSocket(0);
+
+			if (!socket->isConnected() || directAccessProxies.find(memoryProxy) != directAccessProxies.end()) {
+				continue;
+			}
+
+			switch (socket->getConnection()->getFromSocket()->getDataType()) {
+				case COM_DT_VALUE:
+					memoryProxy->setStorage(COM_NUM_CHANNELS_VALUE, false);
+					break;
+				case COM_DT_VECTOR:
+					memoryProxy->setStorage(COM_NUM_CHANNELS_VECTOR, false);
+					break;
+				case COM_DT_COLOR:
+					memoryProxy->setStorage(COM_NUM_CHANNELS_COLOR, useHalfFloat);
+					break;
+			}
+		}
+	}
+}
+
 void ExecutionSystem::addSocketConnection(SocketConnection *connection)
 {
 	this->m_connections.push_back(connection);
@@ -21,6 +21,7 @@
  */
 
 class ExecutionGroup;
+class MemoryBudget;
 
 #ifndef _COM_ExecutionSystem_h
 #define _COM_ExecutionSystem_h
@@ -141,7 +142,27 @@ private:
 	 */
 	vector<SocketConnection *> m_connections;
 
+	/**
+	 * @brief the node that is currently being converted to operations
+	 * @note operations added during the conversion get a reference to its bNode, used by the ResultCache
+	 */
+	Node *m_currentNode;
+
+	/**
+	 * @brief the MemoryBudget of the current execution, NULL when all buffers stay in memory
+	 */
+	MemoryBudget *m_memoryBudget;
+
+	/**
+	 * @brief the test_break callback of the bNodeTree, replaced by testBreak during an execution
+	 * with a MemoryBudget, so a failure of the budget cancels the execution
+	 */
+	int (*m_testBreak)(void *);
+	void *m_tbh;
+
 private: //methods
+	static int testBreak(void *system);
+
 	/**
 	 * @brief add ReadBufferOperation and WriteBufferOperation around an operation
 	 * @param operation the operation to add the bufferoperations around.
@@ -249,6 +270,14 @@ private:
 	
 	void executeGroups(CompositorPriority priority);
 
+	/**
+	 * @brief determine the layout of the buffers of all MemoryProxies
+	 * buffers that are only read pixel by pixel are stored compact, using the number of channels
+	 * of their data type, and as half floats for colors when enabled in the node tree.
+	 * @see MemoryBuffer.isCompact
+	 */
+	void determineMemoryProxyStorage();
+
 #ifdef WITH_CXX_GUARDEDALLOC
 	MEM_CXX_CLASS_ALLOC_FUNCS("COM:ExecutionSystem")
 #endif
@@ -0,0 +1,301 @@
+/*
+ * Copyright 2014, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <stdlib.h>
+
+#include "COM_MemoryBudget.h"
+#include "COM_ExecutionGroup.h"
+#include "COM_MemoryProxy.h"
+#include "COM_MemoryBuffer.h"
+
+extern "C" {
+#  include "BLI_fileops.h"
+#  include "BLI_path_util.h"
+#  include "BLI_string.h"
+}
+
+/* the file name needs the process id to be unique */
+#ifndef WIN32
+#  include <unistd.h>
+#else
+#  include <process.h>
+#  include "BLI_winstuff.h"
+#endif
+
+MemoryBudget::MemoryBudget(size_t limit)
+{
+	this->m_limit = limit;
+	this->m_residentSize = 0;
+	this->m_clock = 0;
+	this->m_file = NULL;
+	this->m_filePath[0] = '\0';
+	this->m_fileSize = 0;
+	this->m_fileFailed = false;
+	this->m_bytesWritten = 0;
+	this->m_bytesRead = 0;
+	this->m_failed = false;
+	this->m_errorMessage[0] = '\0';
+	BLI_mutex_init(&this->m_mutex);
+}
+
+MemoryBudget::~MemoryBudget()
+{
+	for (EntryMap::iterator it = this->m_entries.begin(); it != this->m_entries.end(); ++it) {
+		it->first->setMemoryBudget(NULL);
+	}
+
+	if (this->m_file) {
+		fclose(this->m_file);
+		BLI_delete(this->m_filePath, false, false);
+	}
+	BLI_mutex_end(&this->m_mutex);
+}
+
+void MemoryBudget::addMemoryProxy(MemoryProxy *memoryProxy)
+{
+	MemoryBudgetEntry &entry = this->m_entries[memoryProxy];
+	entry.size = 0;
+	entry.pins = 0;
+	entry.lastUsed = 0;
+	entry.hasContent = false;
+	entry.dirty = false;
+	entry.discarded = false;
+	entry.keep = false;
+	entry.fileOffset = -1;
+	memoryProxy->setMemoryBudget(this);
+}
+
+void MemoryBudget::addReader(MemoryProxy *memoryProxy, ExecutionGroup *group)
+{
+	MemoryBudgetEntry *entry = findEntry(memoryProxy);
+	if (entry) {
+		entry->readers.push_back(group);
+	}
+}
+
+void MemoryBudget::initExecution()
+{
+	for (EntryMap::iterator it = this->m_entries.begin(); it != this->m_entries.end(); ++it) {
+		it->second.size = it->first->getBuffer()->getMemorySize();
+	}
+}
+
+MemoryBudget::MemoryBudgetEntry *MemoryBudget::findEntry(MemoryProxy *memoryProxy)
+{
+	EntryMap::iterator it = this->m_entries.find(memoryProxy);
+	return (it != this->m_entries.end()) ? &it->second : NULL;
+}
+
+bool MemoryBudget::isNeeded(MemoryBudgetEntry &entry)
+{
+	unsigned int index;
+	if (entry.keep) {
+		return true;
+	}
+	for (index = 0; index < entry.readers.size(); index++) {
+		if (!entry.readers[index]->isFullyExecuted()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool MemoryBudget::acquire(MemoryProxy *memoryProxy, bool write)
+{
+	MemoryBudgetEntry *entry = findEntry(memoryProxy);
+	MemoryBuffer *buffer = memoryProxy->getBuffer();
+	bool restored = true;
+
+	if (entry == NULL) {
+		return true;
+	}
+
+	/* pin first, so making room does not remove this buffer */
+	BLI_mutex_lock(&this->m_mutex);
+	entry->pins++;
+	BLI_mutex_unlock(&this->m_mutex);
+
+	entry->lastUsed = ++this->m_clock;
+
+	if (!buffer->isResident()) {
+		makeRoom(entry->size);
+		buffer->allocateStorage();
+		this->m_residentSize += entry->size;
+
+		if (entry->fileOffset >= 0) {
+			restored = readFromFile(memoryProxy, *entry);
+			if (!restored) {
+				/* the execution is cancelled, but chunks that are already scheduled can still
+				 * read the buffer before they notice, don't let them read random memory */
+				buffer->clear();
+				this->m_failed = true;
+			}
+			entry->dirty = false;
+		}
+	}
+
+	if (write) {
+		entry->hasContent = true;
+		entry->dirty = true;
+		entry->discarded = false;
+	}
+
+	return restored;
+}
+
+void MemoryBudget::release(MemoryProxy *memoryProxy)
+{
+	MemoryBudgetEntry *entry = findEntry(memoryProxy);
+
+	if (entry == NULL) {
+		return;
+	}
+
+	BLI_mutex_lock(&this->m_mutex);
+	BLI_assert(entry->pins > 0);
+	entry->pins--;
+	BLI_mutex_unlock(&this->m_mutex);
+}
+
+bool MemoryBudget::isDiscarded(MemoryProxy *memoryProxy)
+{
+	MemoryBudgetEntry *entry = findEntry(memoryProxy);
+	return (entry) ? entry->discarded : false;
+}
+
+void MemoryBudget::setKeepContent(MemoryProxy *memoryProxy, bool keep)
+{
+	MemoryBudgetEntry *entry = findEntry(memoryProxy);
+	if (entry) {
+		entry->keep = keep;
+	}
+}
+
+void MemoryBudget::makeRoom(size_t size)
+{
+	/* only the main thread adds pins and removes buffers from memory, a buffer that is
+	 * not pinned cannot be used by a device and can be removed without holding the lock */
+	while (this->m_residentSize + size > this->m_limit) {
+		MemoryProxy *victim = NULL;
+		MemoryBudgetEntry *victimEntry = NULL;
+		bool victimNeeded = true;
+
+		BLI_mutex_lock(&this->m_mutex);
+		for (EntryMap::iterator it = this->m_entries.begin(); it != this->m_entries.end(); ++it) {
+			MemoryBudgetEntry &entry = it->second;
+			bool needed;
+
+			if (entry.pins > 0 || !it->first->getBuffer()->isResident()) {
+				continue;
+			}
+			/* buffers that cannot be written to the file stay in memory */
+			needed = isNeeded(entry);
+			if (needed && entry.hasContent && this->m_fileFailed && (entry.dirty || entry.fileOffset < 0)) {
+				continue;
+			}
+
+			/* buffers that are not read anymore first, then the least recently used buffer */
+			if (victim == NULL ||
+			    (victimNeeded && !needed) ||
+			    (victimNeeded == needed && entry.lastUsed < victimEntry->lastUsed))
+			{
+				victim = it->first;
+				victimEntry = &entry;
+				victimNeeded = needed;
+			}
+		}
+		BLI_mutex_unlock(&this->m_mutex);
+
+		/* all buffers in memory are in use, the budget is exceeded */
+		if (victim == NULL || !evict(victim, *victimEntry)) {
+			break;
+		}
+	}
+}
+
+bool MemoryBudget::evict(MemoryProxy *memoryProxy, MemoryBudgetEntry &entry)
+{
+	if (!isNeeded(entry)) {
+		if (entry.hasContent) {
+			entry.discarded = true;
+		}
+	}
+	else if (entry.hasContent && (entry.dirty || entry.fileOffset < 0)) {
+		if (!writeToFile(memoryProxy, entry)) {
+			return false;
+		}
+	}
+
+	memoryProxy->getBuffer()->freeStorage();
+	this->m_residentSize -= entry.size;
+	return true;
+}
+
+bool MemoryBudget::writeToFile(MemoryProxy *memoryProxy, MemoryBudgetEntry &entry)
+{
+	MemoryBuffer *buffer = memoryProxy->getBuffer();
+
+	if (this->m_fileFailed) {
+		return false;
+	}
+
+	if (this->m_file == NULL) {
+		BLI_snprintf(this->m_filePath, sizeof(this->m_filePath), "%sblender_compositor_%d_%p.spill",
+		             BLI_temporary_dir(), abs(getpid()), (void *)this);
+		this->m_file = BLI_fopen(this->m_filePath, "w+b");
+		if (this->m_file == NULL) {
+			printf("Compositor: can't create temporary file %s, memory budget is exceeded\n", this->m_filePath);
+			this->m_fileFailed = true;
+			return false;
+		}
+	}
+
+	/* a buffer keeps its place in the file, all writes of the same buffer have the same size */
+	if (entry.fileOffset < 0) {
+		entry.fileOffset = this->m_fileSize;
+		this->m_fileSize += entry.size;
+	}
+
+	if (fseek(this->m_file, entry.fileOffset, SEEK_SET) != 0 ||
+	    fwrite(buffer->getStorage(), 1, entry.size, this->m_file) != entry.size)
+	{
+		printf("Compositor: can't write to temporary file %s, memory budget is exceeded\n", this->m_filePath);
+		this->m_fileFailed = true;
+		return false;
+	}
+
+	entry.dirty = false;
+	this->m_bytesWritten += entry.size;
+	return true;
+}
+
+bool MemoryBudget::readFromFile(MemoryProxy *memoryProxy, MemoryBudgetEntry &entry)
+{
+	MemoryBuffer *buffer = memoryProxy->getBuffer();
+
+	if (fseek(this->m_file, entry.fileOffset, SEEK_SET) != 0 ||
+	    fread(buffer->getStorage(), 1, entry.size, this->m_file) != entry.size)
+	{
+		BLI_snprintf(this->m_errorMessage, sizeof(this->m_errorMessage),
+		             "Compositor: can't read buffer back from temporary file %s", this->m_filePath);
+		return false;
+	}
+
+	this->m_bytesRead += entry.size;
+	return true;
+}
@@ -0,0 +1,251 @@
+/*
+ * Copyright 2014, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _COM_MemoryBudget_h
+#define _COM_MemoryBudget_h
+
+#include <map>
+#include <vector>
+#include <stdio.h>
+
+extern "C" {
+#  include "BLI_sys_types.h"
+#  include "BLI_threads.h"
+#  include "DNA_space_types.h"
+}
+
+class ExecutionGroup;
+class MemoryProxy;
+
+using std::vector;
+
+/**
+ * @brief buffers with less pixels are always kept in memory
+ */
+#define COM_MEMORY_BUDGET_MIN_PIXELS (256 * 256)
+
+/**
+ * @brief the MemoryBudget limits the memory used by the buffers of the MemoryProxies during an execution.
+ *
+ * Without a budget every MemoryProxy allocates its full buffer at the start of the execution, which
+ * does not fit in memory for very large images with many buffered nodes. With a budget the storage
+ * of a buffer is only allocated when a chunk that reads or writes it is scheduled, the buffer is kept
+ * in memory until the chunk is finished (see MemoryProxy.acquire and MemoryProxy.release).
+ *
+ * When the buffers in memory would exceed the budget, buffers that are not in use are removed from
+ * memory. Buffers that every reading ExecutionGroup has fully executed are thrown away first,
+ * otherwise the least recently used buffer is written to a temporary file. The buffer is read back
+ * from the file when it is acquired again. When that fails the budget has failed, the ExecutionSystem
+ * cancels the execution and reports the error.
+ *
+ * The budget is not a hard limit: when all buffers in memory are in use it is exceeded.
+ * Memory that operations allocate themselves is not counted, like the full image result of the
+ * FFT convolution of BokehBlurOperation and GaussianBokehBlurOperation.
+ *
+ * @ingroup Memory
+ */
+class MemoryBudget {
+private:
+	typedef struct MemoryBudgetEntry {
+		/**
+		 * @brief number of bytes of the storage of the buffer
+		 */
+		size_t size;
+
+		/**
+		 * @brief number of acquires that are not released yet, protected by m_mutex
+		 */
+		unsigned int pins;
+
+		/**
+		 * @brief value of m_clock when the buffer was acquired the last time
+		 */
+		unsigned int lastUsed;
+
+		/**
+		 * @brief has the buffer been written to
+		 */
+		bool hasContent;
+
+		/**
+		 * @brief the buffer in memory is newer than the copy in the file
+		 */
+		bool dirty;
+
+		/**
+		 * @brief the content was thrown away by the budget
+		 */
+		bool discarded;
+
+		/**
+		 * @brief the content is still needed after the readers are executed, see setKeepContent
+		 */
+		bool keep;
+
+		/**
+		 * @brief position of the copy of the buffer in the file, -1 when there is no copy
+		 */
+		int64_t fileOffset;
+
+		/**
+		 * @brief the ExecutionGroups that read the buffer
+		 */
+		vector<ExecutionGroup *> readers;
+	} MemoryBudgetEntry;
+
+	typedef std::map<MemoryProxy *, MemoryBudgetEntry> EntryMap;
+
+	/**
+	 * @brief the managed MemoryProxies
+	 */
+	EntryMap m_entries;
+
+	/**
+	 * @brief maximum number of bytes in memory
+	 */
+	size_t m_limit;
+
+	/**
+	 * @brief number of bytes of the buffers that are in memory
+	 */
+	size_t m_residentSize;
+
+	/**
+	 * @brief counter that is increased on every acquire, used to find the least recently used buffer
+	 */
+	unsigned int m_clock;
+
+	/**
+	 * @brief protects the pins of the entries, they are released from the threads of the devices
+	 */
+	ThreadMutex m_mutex;
+
+	/**
+	 * @brief the temporary file the buffers are written to, NULL until the first buffer is written
+	 */
+	FILE *m_file;
+	char m_filePath[FILE_MAX];
+	int64_t m_fileSize;
+
+	/**
+	 * @brief writing to the file failed, buffers that are not written yet will stay in memory
+	 */
+	bool m_fileFailed;
+
+	/**
+	 * @brief number of bytes written to and read from the file, for statistics
+	 */
+	size_t m_bytesWritten;
+	size_t m_bytesRead;
+
+	/**
+	 * @brief reading a buffer back from the file failed, its content is lost
+	 */
+	bool m_failed;
+	char m_errorMessage[FILE_MAX + 64];
+
+	MemoryBudgetEntry *findEntry(MemoryProxy *memoryProxy);
+
+	/**
+	 * @brief will the buffer be read again during this execution
+	 */
+	bool isNeeded(MemoryBudgetEntry &entry);
+
+	/**
+	 * @brief remove buffers that are not in use from memory until size bytes more fit in the budget
+	 */
+	void makeRoom(size_t size);
+
+	/**
+	 * @brief remove the buffer from memory, writing it to the file when it is still needed
+	 * @return false when the buffer could not be written to the file and is still in memory
+	 */
+	bool evict(MemoryProxy *memoryProxy, MemoryBudgetEntry &entry);
+
+	bool writeToFile(MemoryProxy *memoryProxy, MemoryBudgetEntry &entry);
+	bool readFromFile(MemoryProxy *memoryProxy, MemoryBudgetEntry &entry);
+
+public:
+	/**
+	 * @brief create a MemoryBudget that keeps at most limit bytes of buffers in memory
+	 */
+	MemoryBudget(size_t limit);
+
+	/**
+	 * @brief free the buffers that are in the file and remove the file
+	 * @note needs to be called after the execution, the buffers that are in memory stay valid
+	 */
+	~MemoryBudget();
+
+	/**
+	 * @brief let the budget decide when the buffer of the MemoryProxy is in memory
+	 * @note needs to be called before the buffer is allocated
+	 */
+	void addMemoryProxy(MemoryProxy *memoryProxy);
+
+	/**
+	 * @brief the ExecutionGroup reads the buffer of the MemoryProxy, the buffer is thrown away
+	 * when all readers are fully executed. MemoryProxies that are not added are ignored
+	 */
+	void addReader(MemoryProxy *memoryProxy, ExecutionGroup *group);
+
+	/**
+	 * @brief determine the size of the buffers
+	 * @note needs to be called after the buffers are allocated
+	 */
+	void initExecution();
+
+	/**
+	 * @see MemoryProxy.acquire
+	 */
+	bool acquire(MemoryProxy *memoryProxy, bool write);
+
+	/**
+	 * @see MemoryProxy.release
+	 */
+	void release(MemoryProxy *memoryProxy);
+
+	/**
+	 * @see MemoryProxy.isDiscarded
+	 */
+	bool isDiscarded(MemoryProxy *memoryProxy);
+
+	/**
+	 * @see MemoryProxy.setKeepContent
+	 */
+	void setKeepContent(MemoryProxy *memoryProxy, bool keep);
+
+	/**
+	 * @brief the content of a buffer was lost, the result of the execution is wrong
+	 */
+	bool hasFailed() const { return this->m_failed; }
+
+	/**
+	 * @brief description of the failure, for the user
+	 */
+	const char *getErrorMessage() const { return this->m_errorMessage; }
+
+	size_t getBytesWritten() const { return this->m_bytesWritten; }
+	size_t getBytesRead() const { return this->m_bytesRead; }
+
+#ifdef WITH_CXX_GUARDEDALLOC
+	MEM_CXX_CLASS_ALLOC_FUNCS("COM:MemoryBudget")
+#endif
+};
+
+#endif
@@ -24,6 +24,86 @@
 #include "MEM_guardedalloc.h"
 //#include "BKE_global.h"
 
+/* ******** Half Float Conversion ******** */
+
+typedef union FloatBits {
+	float f;
+	unsigned int i;
+} FloatBits;
+
+/* IEEE half float, rounds to nearest even */
+static unsigned short half_from_float(const float value)
+{
+	FloatBits bits;
+	bits.f = value;
+	const unsigned short sign = (bits.i >> 16) & 0x8000;
+	const unsigned int absolute = bits.i & 0x7fffffff;
+
+	if (absolute >= 0x7f800000) {
+		/* infinity stays infinity, NaN stays NaN */
+		return sign | 0x7c00 | ((absolute > 0x7f800000) ? 0x0200 : 0);
+	}
+	else if (absolute >= 0x477ff000) {
+		/* too large, becomes infinity */
+		return sign | 0x7c00;
+	}
+	else if (absolute >= 0x38800000) {
+		/* normalized half, rebias exponent and round the mantissa */
+		unsigned int result = (absolute - 0x38000000) >> 13;
+		const unsigned int remainder = absolute & 0x1fff;
+		if (remainder > 0x1000 || (remainder == 0x1000 && (result & 1))) {
+			result++;
+		}
+		return sign | result;
+	}
+	else if (absolute > 0x33000000) {
+		/* denormalized half */
+		const unsigned int shift = 126 - (absolute >> 23);
+		const unsigned int mantissa = (absolute & 0x7fffff) | 0x800000;
+		const unsigned int remainder = mantissa & ((1u << shift) - 1);
+		const unsigned int halfway = 1u << (shift - 1);
+		unsigned int result = mantissa >> shift;
+		if (remainder > halfway || (remainder == halfway && (result & 1))) {
+			result++;
+		}
+		return sign | result;
+	}
+	else {
+		/* too small, becomes zero */
+		return sign;
+	}
+}
+
+static float half_to_float(const unsigned short value)
+{
+	FloatBits bits;
+	const unsigned int sign = (unsigned int)(value & 0x8000) << 16;
+	unsigned int exponent = (value >> 10) & 0x1f;
+	unsigned int mantissa = value & 0x3ff;
+
+	if (exponent == 0x1f) {
+		bits.i = sign | 0x7f800000 | (mantissa << 13);
+	}
+	else if (exponent != 0) {
+		bits.i = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	}
+	else if (mantissa == 0) {
+		bits.i = sign;
+	}
+	else {
+		/* denormalized half, normalize it */
+		exponent = 113;
+		while (!(mantissa & 0x400)) {
+			mantissa <<= 1;
+			exponent--;
+		}
+		bits.i = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+	}
+	return bits.f;
+}
+
+/* ******** Memory Buffer ******** */
+
 unsigned int MemoryBuffer::determineBufferSize()
 {
 	return getWidth() * getHeight();
@@ -38,12 +118,57 @@ int MemoryBuffer::getHeight() const
 	return this->m_rect.ymax - this->m_rect.ymin;
 }
 
-MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, unsigned int chunkNumber, rcti *rect)
+void MemoryBuffer::allocateStorage(unsigned int numberOfChannels, bool useHalfFloat)
+{
+	const unsigned int size = determineBufferSize() * numberOfChannels;
+
+	BLI_assert(numberOfChannels >= 1 && numberOfChannels <= COM_NUMBER_OF_CHANNELS);
+
+	this->m_numberOfChannels = numberOfChannels;
+	this->m_isHalfFloat = useHalfFloat;
+	if (useHalfFloat) {
+		this->m_buffer = NULL;
+		this->m_halfBuffer = (unsigned short *)MEM_mallocN(sizeof(unsigned short) * size, "COM_MemoryBuffer half");
+	}
+	else {
+		this->m_buffer = (float *)MEM_mallocN(sizeof(float) * size, "COM_MemoryBuffer");
+		this->m_halfBuffer = NULL;
+	}
+}
+
+void MemoryBuffer::allocateStorage()
+{
+	BLI_assert(!isResident());
+	allocateStorage(this->m_numberOfChannels, this->m_isHalfFloat);
+}
+
+void MemoryBuffer::freeStorage()
+{
+	if (this->m_buffer) {
+		MEM_freeN(this->m_buffer);
+		this->m_buffer = NULL;
+	}
+	if (this->m_halfBuffer) {
+		MEM_freeN(this->m_halfBuffer);
+		this->m_halfBuffer = NULL;
+	}
+}
+
+MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, unsigned int chunkNumber, rcti *rect,
+                           unsigned int numberOfChannels, bool useHalfFloat, bool resident)
 {
 	BLI_rcti_init(&this->m_rect, rect->xmin, rect->xmax, rect->ymin, rect->ymax);
 	this->m_memoryProxy = memoryProxy;
 	this->m_chunkNumber = chunkNumber;
-	this->m_buffer = (float *)MEM_mallocN(sizeof(float) * determineBufferSize() * COM_NUMBER_OF_CHANNELS, "COM_MemoryBuffer");
+	if (resident) {
+		allocateStorage(numberOfChannels, useHalfFloat);
+	}
+	else {
+		this->m_numberOfChannels = numberOfChannels;
+		this->m_isHalfFloat = useHalfFloat;
+		this->m_buffer = NULL;
+		this->m_halfBuffer = NULL;
+	}
 	this->m_state = COM_MB_ALLOCATED;
 	this->m_datatype = COM_DT_COLOR;
 	this->m_chunkWidth = this->m_rect.xmax - this->m_rect.xmin;
@@ -54,7 +179,7 @@ MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, rcti *rect)
 	BLI_rcti_init(&this->m_rect, rect->xmin, rect->xmax, rect->ymin, rect->ymax);
 	this->m_memoryProxy = memoryProxy;
 	this->m_chunkNumber = -1;
-	this->m_buffer = (float *)MEM_mallocN(sizeof(float) * determineBufferSize() * COM_NUMBER_OF_CHANNELS, "COM_MemoryBuffer");
+	allocateStorage(COM_NUMBER_OF_CHANNELS, false);
 	this->m_state = COM_MB_TEMPORARILY;
 	this->m_datatype = COM_DT_COLOR;
 	this->m_chunkWidth = this->m_rect.xmax - this->m_rect.xmin;
@@ -62,12 +187,91 @@ MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, rcti *rect)
 MemoryBuffer *MemoryBuffer::duplicate()
 {
 	MemoryBuffer *result = new MemoryBuffer(this->m_memoryProxy, &this->m_rect);
-	memcpy(result->m_buffer, this->m_buffer, this->determineBufferSize() * COM_NUMBER_OF_CHANNELS * sizeof(float));
+	if (isCompact()) {
+		result->copyContentFrom(this);
+	}
+	else {
+		memcpy(result->m_buffer, this->m_buffer, this->determineBufferSize() * COM_NUMBER_OF_CHANNELS * sizeof(float));
+	}
 	return result;
 }
 void MemoryBuffer::clear()
 {
-	memset(this->m_buffer, 0, this->determineBufferSize() * COM_NUMBER_OF_CHANNELS * sizeof(float));
+	if (this->m_halfBuffer) {
+		/* half float zero has all bits cleared as well */
+		memset(this->m_halfBuffer, 0, this->determineBufferSize() * this->m_numberOfChannels * sizeof(unsigned short));
+	}
+	else {
+		memset(this->m_buffer, 0, this->determineBufferSize() * this->m_numberOfChannels * sizeof(float));
+	}
+}
+
+size_t MemoryBuffer::getMemorySize()
+{
+	const size_t elementSize = (this->m_isHalfFloat) ? sizeof(unsigned short) : sizeof(float);
+	return (size_t)this->determineBufferSize() * this->m_numberOfChannels * elementSize;
+}
+
+void MemoryBuffer::readCompactPixel(float result[4], unsigned int index) const
+{
+	const unsigned int offset = index * this->m_numberOfChannels;
+	unsigned int channel;
+
+	if (this->m_halfBuffer) {
+		for (channel = 0; channel < this->m_numberOfChannels; channel++) {
+			result[channel] = half_to_float(this->m_halfBuffer[offset + channel]);
+		}
+	}
+	else {
+		for (channel = 0; channel < this->m_numberOfChannels; channel++) {
+			result[channel] = this->m_buffer[offset + channel];
+		}
+	}
+	for (; channel < COM_NUMBER_OF_CHANNELS; channel++) {
+		result[channel] = 0.0f;
+	}
+}
+
+void MemoryBuffer::writeCompactPixel(unsigned int index, const float color[4])
+{
+	const unsigned int offset = index * this->m_numberOfChannels;
+	unsigned int channel;
+
+	if (this->m_halfBuffer) {
+		for (channel = 0; channel < this->m_numberOfChannels; channel++) {
+			this->m_halfBuffer[offset + channel] = half_from_float(color[channel]);
+		}
+	}
+	else {
+		for (channel = 0; channel < this->m_numberOfChannels; channel++) {
+			this->m_buffer[offset + channel] = color[channel];
+		}
+	}
+}
+
+void MemoryBuffer::writeRow(const float *row, int x, int y, int num)
+{
+	if (y < this->m_rect.ymin || y >= this->m_rect.ymax) {
+		return;
+	}
+
+	const int x1 = max_ii(x, this->m_rect.xmin);
+	const int x2 = min_ii(x + num, this->m_rect.xmax);
+	const int index = this->m_chunkWidth * (y - this->m_rect.ymin) + (x1 - this->m_rect.xmin);
+
+	if (x1 >= x2) {
+		return;
+	}
+
+	if (!isCompact()) {
+		memcpy(&this->m_buffer[index * COM_NUMBER_OF_CHANNELS], &row[(x1 - x) * COM_NUMBER_OF_CHANNELS],
+		       sizeof(float) * COM_NUMBER_OF_CHANNELS * (x2 - x1));
+	}
+	else {
+		for (int i = 0; i < x2 - x1; i++) {
+			writeCompactPixel(index + i, &row[(x1 - x + i) * COM_NUMBER_OF_CHANNELS]);
+		}
+	}
 }
 
 float *MemoryBuffer::convertToValueBuffer()
@@ -77,6 +281,15 @@ float *MemoryBuffer::convertToValueBuffer()
 
 	float *result = (float *)MEM_mallocN(sizeof(float) * size, __func__);
 
+	if (isCompact()) {
+		for (i = 0; i < size; i++) {
+			float color[4];
+			readCompactPixel(color, i);
+			result[i] = color[0];
+		}
+		return result;
+	}
+
 	const float *fp_src = this->m_buffer;
 	float       *fp_dst = result;
 
@@ -89,16 +302,17 @@ float *MemoryBuffer::convertToValueBuffer()
 
 float MemoryBuffer::getMaximumValue()
 {
-	float result = this->m_buffer[0];
 	const unsigned int size = this->determineBufferSize();
 	unsigned int i;
+	float color[4];
 
-	const float *fp_src = this->m_buffer;
+	readStorage(color, 0);
+	float result = color[0];
 
-	for (i = 0; i < size; i++, fp_src += COM_NUMBER_OF_CHANNELS) {
-		float value = *fp_src;
-		if (value > result) {
-			result = value;
+	for (i = 0; i < size; i++) {
+		readStorage(color, i);
+		if (color[0] > result) {
+			result = color[0];
 		}
 	}
 
@@ -127,10 +341,7 @@ float MemoryBuffer::getMaximumValue(rcti *rect)
 
 MemoryBuffer::~MemoryBuffer()
 {
-	if (this->m_buffer) {
-		MEM_freeN(this->m_buffer);
-		this->m_buffer = NULL;
-	}
+	freeStorage();
 }
 
 void MemoryBuffer::copyContentFrom(MemoryBuffer *otherBuffer)
@@ -149,9 +360,20 @@ void MemoryBuffer::copyContentFrom(MemoryBuffer *otherBuffer)
 
 
 	for (otherY = minY; otherY < maxY; otherY++) {
-		otherOffset = ((otherY - otherBuffer->m_rect.ymin) * otherBuffer->m_chunkWidth + minX - otherBuffer->m_rect.xmin) * COM_NUMBER_OF_CHANNELS;
-		offset = ((otherY - this->m_rect.ymin) * this->m_chunkWidth + minX - this->m_rect.xmin) * COM_NUMBER_OF_CHANNELS;
-		memcpy(&this->m_buffer[offset], &otherBuffer->m_buffer[otherOffset], (maxX - minX) * COM_NUMBER_OF_CHANNELS * sizeof(float));
+		otherOffset = (otherY - otherBuffer->m_rect.ymin) * otherBuffer->m_chunkWidth + minX - otherBuffer->m_rect.xmin;
+		offset = (otherY - this->m_rect.ymin) * this->m_chunkWidth + minX - this->m_rect.xmin;
+		if (!this->isCompact() && !otherBuffer->isCompact()) {
+			memcpy(&this->m_buffer[offset * COM_NUMBER_OF_CHANNELS], &otherBuffer->m_buffer[otherOffset * COM_NUMBER_OF_CHANNELS],
+			       (maxX - minX) * COM_NUMBER_OF_CHANNELS * sizeof(float));
+		}
+		else {
+			/* convert between the layouts of the buffers */
+			for (unsigned int x = 0; x < maxX - minX; x++) {
+				float color[4];
+				otherBuffer->readStorage(color, otherOffset + x);
+				this->writeStorage(offset + x, color);
+			}
+		}
 	}
 }
 
@@ -160,8 +382,8 @@ void MemoryBuffer::writePixel(int x, int y, const float color[4])
 	if (x >= this->m_rect.xmin && x < this->m_rect.xmax &&
 	    y >= this->m_rect.ymin && y < this->m_rect.ymax)
 	{
-		const int offset = (this->m_chunkWidth * (y - this->m_rect.ymin) + x - this->m_rect.xmin) * COM_NUMBER_OF_CHANNELS;
-		copy_v4_v4(&this->m_buffer[offset], color);
+		const int index = this->m_chunkWidth * (y - this->m_rect.ymin) + x - this->m_rect.xmin;
+		writeStorage(index, color);
 	}
 }
 
@@ -170,8 +392,16 @@ void MemoryBuffer::addPixel(int x, int y, const float color[4])
 	if (x >= this->m_rect.xmin && x < this->m_rect.xmax &&
 	    y >= this->m_rect.ymin && y < this->m_rect.ymax)
 	{
-		const int offset = (this->m_chunkWidth * (y - this->m_rect.ymin) + x - this->m_rect.xmin) * COM_NUMBER_OF_CHANNELS;
-		add_v4_v4(&this->m_buffer[offset], color);
+		const int index = this->m_chunkWidth * (y - this->m_rect.ymin) + x - this->m_rect.xmin;
+		if (isCompact()) {
+			float sum[4];
+			readCompactPixel(sum, index);
+			add_v4_v4(sum, color);
+			writeCompactPixel(index, sum);
+		}
+		else {
+			add_v4_v4(&this->m_buffer[index * COM_NUMBER_OF_CHANNELS], color);
+		}
 	}
 }
 
@@ -28,6 +28,8 @@ class MemoryBuffer;
 #include "COM_ExecutionGroup.h"
 #include "COM_MemoryProxy.h"
 
+#include <string.h>
+
 extern "C" {
 #  include "BLI_math.h"
 #  include "BLI_rect.h"
@@ -92,15 +94,75 @@ private:
 	MemoryBufferState m_state;
 	
 	/**
-	 * @brief the actual float buffer/data
+	 * @brief number of channels stored per pixel
+	 * @see COM_NUM_CHANNELS_VALUE, COM_NUM_CHANNELS_VECTOR, COM_NUM_CHANNELS_COLOR
+	 */
+	unsigned int m_numberOfChannels;
+
+	/**
+	 * @brief the actual float buffer/data, NULL when the data is stored as half floats
 	 */
 	float *m_buffer;
 
+	/**
+	 * @brief the actual half float buffer/data, NULL when the data is stored as floats
+	 */
+	unsigned short *m_halfBuffer;
+
+	/**
+	 * @brief the channels are stored as half floats, also known when the storage is not resident
+	 */
+	bool m_isHalfFloat;
+
+	/**
+	 * @brief convert the pixel at index of a compact buffer to a float[4]
+	 * channels that are not stored are zero
+	 */
+	void readCompactPixel(float result[4], unsigned int index) const;
+
+	/**
+	 * @brief store the float[4] color in the pixel at index of a compact buffer
+	 */
+	void writeCompactPixel(unsigned int index, const float color[4]);
+
+	/**
+	 * @brief read the pixel at index of the storage as a float[4]
+	 */
+	inline void readStorage(float result[4], unsigned int index) const
+	{
+		if (!isCompact()) {
+			copy_v4_v4(result, &this->m_buffer[index * COM_NUMBER_OF_CHANNELS]);
+		}
+		else {
+			readCompactPixel(result, index);
+		}
+	}
+
+	/**
+	 * @brief write a float[4] to the pixel at index of the storage
+	 */
+	inline void writeStorage(unsigned int index, const float color[4])
+	{
+		if (!isCompact()) {
+			copy_v4_v4(&this->m_buffer[index * COM_NUMBER_OF_CHANNELS], color);
+		}
+		else {
+			writeCompactPixel(index, color);
+		}
+	}
+
+	void allocateStorage(unsigned int numberOfChannels, bool useHalfFloat);
+
 public:
 	/**
 	 * @brief construct new MemoryBuffer for a chunk
+	 * @param numberOfChannels number of channels stored per pixel
+	 * @param useHalfFloat store the channels as half floats
+	 * @param resident allocate the storage now, otherwise allocateStorage has to be called before use
 	 */
-	MemoryBuffer(MemoryProxy *memoryProxy, unsigned int chunkNumber, rcti *rect);
+	MemoryBuffer(MemoryProxy *memoryProxy, unsigned int chunkNumber, rcti *rect,
+	             unsigned int numberOfChannels = COM_NUMBER_OF_CHANNELS, bool useHalfFloat = false,
+	             bool resident = true);
 	
 	/**
 	 * @brief construct new temporarily MemoryBuffer for an area
@@ -120,8 +182,62 @@ public:
 	/**
 	 * @brief get the data of this MemoryBuffer
 	 * @note buffer should already be available in memory
+	 * @note only valid for buffers that are not compact, the data is COM_NUMBER_OF_CHANNELS floats per pixel
+	 */
+	float *getBuffer()
+	{
+		BLI_assert(!isCompact());
+		return this->m_buffer;
+	}
+
+	/**
+	 * @brief is the data stored in another layout than COM_NUMBER_OF_CHANNELS floats per pixel
+	 * compact buffers can only be accessed with the read and write methods, which convert on the fly
 	 */
-	float *getBuffer() { return this->m_buffer; }
+	inline bool isCompact() const
+	{
+		return this->m_isHalfFloat || (this->m_numberOfChannels != COM_NUMBER_OF_CHANNELS);
+	}
+
+	/**
+	 * @brief get the number of channels that are stored per pixel
+	 */
+	unsigned int getNumberOfChannels() const { return this->m_numberOfChannels; }
+
+	/**
+	 * @brief are the channels stored as half floats
+	 */
+	bool isHalfFloat() const { return this->m_isHalfFloat; }
+
+	/**
+	 * @brief is the storage of this MemoryBuffer allocated
+	 * @see MemoryBudget
+	 */
+	bool isResident() const { return (this->m_buffer != NULL) || (this->m_halfBuffer != NULL); }
+
+	/**
+	 * @brief allocate the storage of a MemoryBuffer that is not resident, the content is undefined
+	 */
+	void allocateStorage();
+
+	/**
+	 * @brief free the storage, the MemoryBuffer itself stays valid and can be made resident again
+	 */
+	void freeStorage();
+
+	/**
+	 * @brief get the raw storage, getMemorySize bytes in the layout of the buffer
+	 * @note used to write the buffer to and read it from disk
+	 */
+	void *getStorage()
+	{
+		return (this->m_isHalfFloat) ? (void *)this->m_halfBuffer : (void *)this->m_buffer;
+	}
+
+	/**
+	 * @brief get the number of bytes used by the data of this MemoryBuffer
+	 */
+	size_t getMemorySize();
 	
 	/**
 	 * @brief after execution the state will be set to available by calling this method
@@ -175,20 +291,64 @@ public:
 		}
 		else {
 			wrap_pixel(x, y, extend_x, extend_y);
-			const int offset = (this->m_chunkWidth * y + x) * COM_NUMBER_OF_CHANNELS;
-			copy_v4_v4(result, &this->m_buffer[offset]);
+			readStorage(result, this->m_chunkWidth * y + x);
+		}
+	}
+
+	/**
+	 * @brief read a row of num pixels starting at x, y
+	 * pixels outside the rect are zero, same as read with COM_MB_CLIP
+	 * @param result is a float[num * 4] array to store the result
+	 */
+	inline void readRow(float *result, int x, int y, int num)
+	{
+		if (y < m_rect.ymin || y >= m_rect.ymax) {
+			memset(result, 0, sizeof(float) * COM_NUMBER_OF_CHANNELS * num);
+			return;
+		}
+
+		int x1 = max_ii(x, m_rect.xmin);
+		int x2 = min_ii(x + num, m_rect.xmax);
+
+		if (x1 >= x2) {
+			memset(result, 0, sizeof(float) * COM_NUMBER_OF_CHANNELS * num);
+			return;
+		}
+		if (x1 > x) {
+			memset(result, 0, sizeof(float) * COM_NUMBER_OF_CHANNELS * (x1 - x));
+		}
+		if (x2 < x + num) {
+			memset(&result[(x2 - x) * COM_NUMBER_OF_CHANNELS], 0, sizeof(float) * COM_NUMBER_OF_CHANNELS * (x + num - x2));
+		}
+
+		const int index = this->m_chunkWidth * (y - m_rect.ymin) + (x1 - m_rect.xmin);
+		if (!isCompact()) {
+			memcpy(&result[(x1 - x) * COM_NUMBER_OF_CHANNELS], &this->m_buffer[index * COM_NUMBER_OF_CHANNELS],
+			       sizeof(float) * COM_NUMBER_OF_CHANNELS * (x2 - x1));
+		}
+		else {
+			for (int i = 0; i < x2 - x1; i++) {
+				readCompactPixel(&result[(x1 - x + i) * COM_NUMBER_OF_CHANNELS], index + i);
+			}
 		}
 	}
 
+	/**
+	 * @brief write a row of num pixels starting at x, y
+	 * pixels outside the rect are ignored
+	 * @param row is a float[num * 4] array with the colors to store
+	 */
+	void writeRow(const float *row, int x, int y, int num);
+
 	inline void readNoCheck(float result[4], int x, int y,
 	                        MemoryBufferExtend extend_x = COM_MB_CLIP,
 	                        MemoryBufferExtend extend_y = COM_MB_CLIP)
 	{
 		wrap_pixel(x, y, extend_x, extend_y);
-		const int offset = (this->m_chunkWidth * y + x) * COM_NUMBER_OF_CHANNELS;
+		const int index = this->m_chunkWidth * y + x;
 
-		BLI_assert(offset >= 0);
-		BLI_assert(offset < this->determineBufferSize() * COM_NUMBER_OF_CHANNELS);
+		BLI_assert(index >= 0);
+		BLI_assert(index < this->determineBufferSize());
 		BLI_assert(!(extend_x == COM_MB_CLIP && (x < m_rect.xmin || x >= m_rect.xmax)) &&
 		           !(extend_y == COM_MB_CLIP && (y < m_rect.ymin || y >= m_rect.ymax)));
 
@@ -198,7 +358,7 @@ public:
 		           (int)(this->determineBufferSize() * COM_NUMBER_OF_CHANNELS));
 #endif
 
-		copy_v4_v4(result, &this->m_buffer[offset]);
+		readStorage(result, index);
 	}
 	
 	void writePixel(int x, int y, const float color[4]);
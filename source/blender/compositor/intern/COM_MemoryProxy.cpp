@@ -21,12 +21,17 @@
  */
 
 #include "COM_MemoryProxy.h"
+#include "COM_MemoryBudget.h"
 
 
 MemoryProxy::MemoryProxy()
 {
 	this->m_writeBufferOperation = NULL;
 	this->m_executor = NULL;
+	this->m_buffer = NULL;
+	this->m_numberOfChannels = COM_NUMBER_OF_CHANNELS;
+	this->m_useHalfFloat = false;
+	this->m_memoryBudget = NULL;
 }
 
 void MemoryProxy::allocate(unsigned int width, unsigned int height)
@@ -37,7 +42,9 @@ void MemoryProxy::allocate(unsigned int width, unsigned int height)
 	result.ymin = 0;
 	result.ymax = height;
 
-	this->m_buffer = new MemoryBuffer(this, 1, &result);
+	/* the MemoryBudget allocates the storage when the buffer is acquired */
+	this->m_buffer = new MemoryBuffer(this, 1, &result, this->m_numberOfChannels, this->m_useHalfFloat,
+	                                  this->m_memoryBudget == NULL);
 }
 
 void MemoryProxy::free()
@@ -48,3 +55,30 @@ void MemoryProxy::free()
 	}
 }
 
+
+bool MemoryProxy::acquire(bool write)
+{
+	if (this->m_memoryBudget) {
+		return this->m_memoryBudget->acquire(this, write);
+	}
+	return true;
+}
+
+void MemoryProxy::release()
+{
+	if (this->m_memoryBudget) {
+		this->m_memoryBudget->release(this);
+	}
+}
+
+bool MemoryProxy::isDiscarded()
+{
+	return (this->m_memoryBudget) ? this->m_memoryBudget->isDiscarded(this) : false;
+}
+
+void MemoryProxy::setKeepContent(bool keep)
+{
+	if (this->m_memoryBudget) {
+		this->m_memoryBudget->setKeepContent(this, keep);
+	}
+}
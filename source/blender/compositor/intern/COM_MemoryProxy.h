@@ -28,6 +28,7 @@ class MemoryProxy;
 #include "COM_ExecutionGroup.h"
 
 class ExecutionGroup;
+class MemoryBudget;
 
 /**
  * @brief A MemoryProxy is a unique identifier for a memory buffer.
@@ -48,9 +49,14 @@ private:
 	ExecutionGroup *m_executor;
 	
 	/**
-	 * @brief datatype of this MemoryProxy
+	 * @brief number of channels stored per pixel in the buffer
 	 */
-	/* DataType m_datatype; */ /* UNUSED */
+	unsigned int m_numberOfChannels;
+
+	/**
+	 * @brief store the buffer as half floats
+	 */
+	bool m_useHalfFloat;
 	
 	/**
 	 * @brief channel information of this buffer
@@ -62,6 +68,11 @@ private:
 	 */
 	MemoryBuffer *m_buffer;
 
+	/**
+	 * @brief the MemoryBudget that decides when the buffer is in memory, NULL when it is always in memory
+	 */
+	MemoryBudget *m_memoryBudget;
+
 public:
 	MemoryProxy();
 	
@@ -91,6 +102,16 @@ public:
 	/**
 	 * @brief allocate memory of size width x height
 	 */
+	/**
+	 * @brief set the layout of the buffer that will be allocated
+	 * @see MemoryBuffer.isCompact
+	 */
+	void setStorage(unsigned int numberOfChannels, bool useHalfFloat)
+	{
+		this->m_numberOfChannels = numberOfChannels;
+		this->m_useHalfFloat = useHalfFloat;
+	}
+
 	void allocate(unsigned int width, unsigned int height);
 
 	/**
@@ -103,6 +124,36 @@ public:
 	 */
 	inline MemoryBuffer *getBuffer() { return this->m_buffer; }
 
+	/**
+	 * @brief set the MemoryBudget, needs to be set before allocate
+	 * the buffer is only kept in memory while it is acquired
+	 */
+	void setMemoryBudget(MemoryBudget *memoryBudget) { this->m_memoryBudget = memoryBudget; }
+
+	/**
+	 * @brief make sure the buffer is in memory and keep it there until release is called
+	 * @param write the buffer will be written to
+	 * @return false when the content of the buffer could not be restored, release still needs to be called
+	 * @note does nothing when no MemoryBudget is set, may only be called from the main thread
+	 */
+	bool acquire(bool write);
+
+	/**
+	 * @brief the buffer is not used anymore by the caller of acquire
+	 */
+	void release();
+
+	/**
+	 * @brief has the MemoryBudget thrown away the content of the buffer because nothing would read it anymore
+	 */
+	bool isDiscarded();
+
+	/**
+	 * @brief keep the content of the buffer after all readers are executed, it will be spilled
+	 * to disk instead of thrown away. Used by the ResultCache to store the buffer after the execution
+	 */
+	void setKeepContent(bool keep);
+
 #ifdef WITH_CXX_GUARDEDALLOC
 	MEM_CXX_CLASS_ALLOC_FUNCS("COM:MemoryProxy")
 #endif
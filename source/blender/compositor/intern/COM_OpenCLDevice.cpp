@@ -23,6 +23,8 @@
 #include "COM_OpenCLDevice.h"
 #include "COM_WorkScheduler.h"
 
+#include "PIL_time.h"
+
 typedef enum COM_VendorID  {NVIDIA = 0x10DE, AMD = 0x1002} COM_VendorID;
 
 OpenCLDevice::OpenCLDevice(cl_context context, cl_device_id device, cl_program program, cl_int vendorId)
@@ -52,6 +54,7 @@ void OpenCLDevice::execute(WorkPackage *work)
 {
 	const unsigned int chunkNumber = work->getChunkNumber();
 	ExecutionGroup *executionGroup = work->getExecutionGroup();
+	const double start = PIL_check_seconds_timer();
 	rcti rect;
 
 	executionGroup->determineChunkRect(&rect, chunkNumber);
@@ -62,6 +65,8 @@ void OpenCLDevice::execute(WorkPackage *work)
 	                                                              chunkNumber, inputBuffers, outputBuffer);
 
 	delete outputBuffer;
+
+	executionGroup->setChunkExecutionTime(chunkNumber, PIL_check_seconds_timer() - start);
 	
 	executionGroup->finalizeChunkExecution(chunkNumber, inputBuffers);
 }
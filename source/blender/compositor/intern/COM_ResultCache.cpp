@@ -0,0 +1,812 @@
+/*
+ * Copyright 2014, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <map>
+#include <set>
+#include <string.h>
+#include <typeinfo>
+
+#include "COM_ResultCache.h"
+#include "COM_ExecutionSystem.h"
+#include "COM_ExecutionGroup.h"
+#include "COM_MemoryProxy.h"
+#include "COM_MemoryBuffer.h"
+#include "COM_SocketConnection.h"
+#include "COM_ReadBufferOperation.h"
+#include "COM_WriteBufferOperation.h"
+#include "COM_SetValueOperation.h"
+#include "COM_SetColorOperation.h"
+#include "COM_SetVectorOperation.h"
+#include "COM_Debug.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#  include "BLI_listbase.h"
+#  include "BLI_sys_types.h"
+#  include "DNA_camera_types.h"
+#  include "DNA_color_types.h"
+#  include "DNA_image_types.h"
+#  include "DNA_node_types.h"
+#  include "DNA_object_types.h"
+#  include "DNA_scene_types.h"
+#  include "BKE_image.h"
+#  include "BKE_node.h"
+#  include "IMB_imbuf.h"
+#  include "IMB_imbuf_types.h"
+#  include "IMB_moviecache.h"
+#  include "RE_pipeline.h"
+}
+
+/**
+ * @brief results of ExecutionGroups that were calculated faster than this (in seconds)
+ * are not stored, copying the buffer would not be much faster.
+ */
+#define COM_RESULT_CACHE_MIN_TIME 0.005
+
+typedef struct ResultCacheKey {
+	uint64_t hash;
+	int width, height;
+} ResultCacheKey;
+
+typedef struct ResultCacheEntry {
+	bool valid;
+	uint64_t hash;
+	bool restored;
+	double time; /* calculation time of a restored result */
+} ResultCacheEntry;
+
+typedef struct ResultCacheStored {
+	int width, height;
+	double time; /* time it took to calculate the result, including depending ExecutionGroups */
+} ResultCacheStored;
+
+typedef std::map<ExecutionGroup *, ResultCacheEntry> GroupEntryMap;
+typedef std::map<void *, ResultCacheEntry> HashMap;
+typedef std::map<uint64_t, ResultCacheStored> StoredMap;
+
+static struct MovieCache *g_cache = NULL;
+static StoredMap g_stored;
+
+/* hashes of the current execution */
+static GroupEntryMap g_groups;
+static HashMap g_operations;
+static HashMap g_nodes;
+
+/* ******** Hashing ******** */
+
+#define HASH_SEED ((uint64_t)0x84222325cbf29ce4ull)
+#define HASH_MUL ((uint64_t)0xc6a4a7935bd1e995ull)
+
+static uint64_t hash_uint64(uint64_t hash, uint64_t value)
+{
+	value *= HASH_MUL;
+	value ^= value >> 47;
+	value *= HASH_MUL;
+
+	hash ^= value;
+	hash *= HASH_MUL;
+	return hash;
+}
+
+static uint64_t hash_data(uint64_t hash, const void *data, size_t len)
+{
+	const unsigned char *bytes = (const unsigned char *)data;
+	uint64_t value;
+
+	hash = hash_uint64(hash, len);
+	while (len >= sizeof(value)) {
+		memcpy(&value, bytes, sizeof(value));
+		hash = hash_uint64(hash, value);
+		bytes += sizeof(value);
+		len -= sizeof(value);
+	}
+	if (len) {
+		value = 0;
+		memcpy(&value, bytes, len);
+		hash = hash_uint64(hash, value);
+	}
+	return hash;
+}
+
+static uint64_t hash_int(uint64_t hash, int value)
+{
+	return hash_uint64(hash, (uint64_t)(unsigned int)value);
+}
+
+static uint64_t hash_float(uint64_t hash, float value)
+{
+	return hash_data(hash, &value, sizeof(value));
+}
+
+static uint64_t hash_pointer(uint64_t hash, const void *pointer)
+{
+	return hash_uint64(hash, (uint64_t)(intptr_t)pointer);
+}
+
+static uint64_t hash_string(uint64_t hash, const char *str)
+{
+	return hash_data(hash, str, strlen(str));
+}
+
+/* the alloc'ed data of a node, sockets default values etc. */
+static uint64_t hash_memory(uint64_t hash, const void *mem)
+{
+	if (mem == NULL) {
+		return hash_uint64(hash, 0);
+	}
+	return hash_data(hash, mem, MEM_allocN_len(mem));
+}
+
+static uint64_t hash_curvemapping(uint64_t hash, const CurveMapping *cumap)
+{
+	if (cumap == NULL) {
+		return hash_uint64(hash, 0);
+	}
+
+	/* the curves are stored behind pointers, which differ for every copy of the tree */
+	hash = hash_int(hash, cumap->flag);
+	hash = hash_int(hash, cumap->preset);
+	hash = hash_data(hash, &cumap->clipr, sizeof(cumap->clipr));
+	hash = hash_data(hash, cumap->black, sizeof(cumap->black));
+	hash = hash_data(hash, cumap->white, sizeof(cumap->white));
+	for (int index = 0; index < 4; index++) {
+		const CurveMap *cuma = &cumap->cm[index];
+		hash = hash_int(hash, cuma->flag);
+		hash = hash_data(hash, cuma->ext_in, sizeof(cuma->ext_in));
+		hash = hash_data(hash, cuma->ext_out, sizeof(cuma->ext_out));
+		hash = hash_int(hash, cuma->totpoint);
+		if (cuma->curve) {
+			hash = hash_data(hash, cuma->curve, sizeof(CurveMapPoint) * cuma->totpoint);
+		}
+	}
+	return hash;
+}
+
+static uint64_t hash_renderlayer(uint64_t hash, const RenderLayer *rl)
+{
+	const RenderPass *rpass;
+
+	hash = hash_int(hash, rl->rectx);
+	hash = hash_int(hash, rl->recty);
+	if (rl->rectf) {
+		hash = hash_data(hash, rl->rectf, sizeof(float) * 4 * rl->rectx * rl->recty);
+	}
+	for (rpass = (RenderPass *)rl->passes.first; rpass; rpass = rpass->next) {
+		hash = hash_int(hash, rpass->passtype);
+		hash = hash_int(hash, rpass->channels);
+		if (rpass->rect) {
+			hash = hash_data(hash, rpass->rect, sizeof(float) * rpass->channels * rpass->rectx * rpass->recty);
+		}
+	}
+	return hash;
+}
+
+/* pixels of the render layer used by a render layers node */
+static uint64_t hash_render_layers_node(uint64_t hash, bNode *node)
+{
+	Scene *scene = (Scene *)node->id;
+	Render *re = (scene) ? RE_GetRender(scene->id.name) : NULL;
+	RenderResult *rr = NULL;
+
+	if (re)
+		rr = RE_AcquireResultRead(re);
+
+	if (rr) {
+		SceneRenderLayer *srl = (SceneRenderLayer *)BLI_findlink(&scene->r.layers, node->custom1);
+		if (srl) {
+			RenderLayer *rl = RE_GetRenderLayer(rr, srl->name);
+			if (rl) {
+				hash = hash_renderlayer(hash, rl);
+			}
+		}
+	}
+	if (re) {
+		RE_ReleaseResult(re);
+	}
+	return hash;
+}
+
+/* pixels of the image used by an image node */
+static uint64_t hash_image_node(uint64_t hash, bNode *node)
+{
+	Image *image = (Image *)node->id;
+	ImageUser *imageuser = (ImageUser *)node->storage;
+	ImBuf *ibuf;
+
+	if (image == NULL) {
+		return hash;
+	}
+
+	hash = hash_string(hash, image->colorspace_settings.name);
+	hash = hash_int(hash, image->alpha_mode);
+
+	ibuf = BKE_image_acquire_ibuf(image, imageuser, NULL);
+	if (image->type == IMA_TYPE_MULTILAYER) {
+		if (image->rr) {
+			RenderLayer *rl = (RenderLayer *)BLI_findlink(&image->rr->layers, imageuser->layer);
+			if (rl) {
+				hash = hash_renderlayer(hash, rl);
+			}
+		}
+	}
+	else if (ibuf) {
+		const int channels = ibuf->channels ? ibuf->channels : 4;
+
+		hash = hash_int(hash, ibuf->x);
+		hash = hash_int(hash, ibuf->y);
+		hash = hash_pointer(hash, ibuf->rect_colorspace);
+		if (ibuf->rect_float) {
+			hash = hash_data(hash, ibuf->rect_float, sizeof(float) * channels * ibuf->x * ibuf->y);
+		}
+		if (ibuf->rect) {
+			hash = hash_data(hash, ibuf->rect, sizeof(unsigned int) * ibuf->x * ibuf->y);
+		}
+		if (ibuf->zbuf_float) {
+			hash = hash_data(hash, ibuf->zbuf_float, sizeof(float) * ibuf->x * ibuf->y);
+		}
+	}
+	BKE_image_release_ibuf(image, ibuf, NULL);
+
+	return hash;
+}
+
+/* camera used by the defocus node to convert depth to radius */
+static uint64_t hash_defocus_node(uint64_t hash, bNode *node, ExecutionSystem *system)
+{
+	Scene *scene = node->id ? (Scene *)node->id : system->getContext().getScene();
+	Object *camob = scene ? scene->camera : NULL;
+
+	if (camob && camob->type == OB_CAMERA) {
+		Camera *cam = (Camera *)camob->data;
+
+		hash = hash_data(hash, camob->obmat, sizeof(camob->obmat));
+		hash = hash_int(hash, cam->type);
+		hash = hash_float(hash, cam->clipsta);
+		hash = hash_float(hash, cam->lens);
+		hash = hash_float(hash, cam->ortho_scale);
+		hash = hash_float(hash, cam->sensor_x);
+		hash = hash_float(hash, cam->sensor_y);
+		hash = hash_int(hash, cam->sensor_fit);
+		hash = hash_float(hash, cam->YF_dofdist);
+		if (cam->dof_ob) {
+			hash = hash_data(hash, cam->dof_ob->obmat, sizeof(cam->dof_ob->obmat));
+		}
+	}
+	return hash;
+}
+
+/**
+ * settings of the bNode an operation was created for. returns false when
+ * the result depends on data that cannot be hashed.
+ */
+static bool node_hash(ExecutionSystem *system, bNode *node, uint64_t *r_hash)
+{
+	HashMap::iterator it = g_nodes.find(node);
+	if (it != g_nodes.end()) {
+		*r_hash = it->second.hash;
+		return it->second.valid;
+	}
+
+	ResultCacheEntry entry = {true, HASH_SEED, false, 0.0};
+	uint64_t hash = HASH_SEED;
+	bNodeSocket *sock;
+
+	switch (node->type) {
+		case CMP_NODE_MOVIECLIP:
+		case CMP_NODE_MOVIEDISTORTION:
+		case CMP_NODE_STABILIZE2D:
+		case CMP_NODE_TRACKPOS:
+		case CMP_NODE_PLANETRACKDEFORM:
+		case CMP_NODE_KEYINGSCREEN:
+		case CMP_NODE_MASK:
+		case CMP_NODE_TEXTURE:
+			entry.valid = false;
+			break;
+		default:
+			break;
+	}
+
+	if (entry.valid) {
+		hash = hash_int(hash, node->type);
+		hash = hash_int(hash, node->custom1);
+		hash = hash_int(hash, node->custom2);
+		hash = hash_float(hash, node->custom3);
+		hash = hash_float(hash, node->custom4);
+		hash = hash_pointer(hash, node->id);
+
+		switch (node->type) {
+			case CMP_NODE_CURVE_RGB:
+			case CMP_NODE_CURVE_VEC:
+			case CMP_NODE_TIME:
+			case CMP_NODE_HUECORRECT:
+				hash = hash_curvemapping(hash, (CurveMapping *)node->storage);
+				break;
+			default:
+				hash = hash_memory(hash, node->storage);
+				break;
+		}
+
+		for (sock = (bNodeSocket *)node->inputs.first; sock; sock = sock->next) {
+			hash = hash_memory(hash, sock->default_value);
+		}
+		for (sock = (bNodeSocket *)node->outputs.first; sock; sock = sock->next) {
+			hash = hash_memory(hash, sock->storage);
+		}
+
+		switch (node->type) {
+			case CMP_NODE_R_LAYERS:
+				hash = hash_render_layers_node(hash, node);
+				break;
+			case CMP_NODE_IMAGE:
+				hash = hash_image_node(hash, node);
+				break;
+			case CMP_NODE_DEFOCUS:
+				hash = hash_defocus_node(hash, node, system);
+				break;
+			default:
+				break;
+		}
+	}
+
+	entry.hash = hash;
+	g_nodes[node] = entry;
+
+	*r_hash = entry.hash;
+	return entry.valid;
+}
+
+static bool group_hash(ExecutionSystem *system, ExecutionGroup *group, uint64_t *r_hash);
+
+static bool operation_hash(ExecutionSystem *system, NodeOperation *operation, uint64_t *r_hash)
+{
+	HashMap::iterator it = g_operations.find(operation);
+	if (it != g_operations.end()) {
+		*r_hash = it->second.hash;
+		return it->second.valid;
+	}
+
+	ResultCacheEntry entry = {true, HASH_SEED, false, 0.0};
+	uint64_t hash = HASH_SEED;
+	uint64_t input_hash;
+	unsigned int index;
+
+	hash = hash_string(hash, typeid(*operation).name());
+	hash = hash_int(hash, operation->getWidth());
+	hash = hash_int(hash, operation->getHeight());
+
+	if (operation->isReadBufferOperation()) {
+		MemoryProxy *memoryProxy = ((ReadBufferOperation *)operation)->getMemoryProxy();
+		ExecutionGroup *group = memoryProxy->getExecutor();
+
+		if (group && group_hash(system, group, &input_hash)) {
+			hash = hash_uint64(hash, input_hash);
+		}
+		else {
+			entry.valid = false;
+		}
+	}
+
+	/* constant values, these are also created without a bNode by socket proxies and resolution conversion */
+	if (SetValueOperation *value = dynamic_cast<SetValueOperation *>(operation)) {
+		hash = hash_float(hash, value->getValue());
+	}
+	else if (SetColorOperation *color = dynamic_cast<SetColorOperation *>(operation)) {
+		hash = hash_float(hash, color->getChannel1());
+		hash = hash_float(hash, color->getChannel2());
+		hash = hash_float(hash, color->getChannel3());
+		hash = hash_float(hash, color->getChannel4());
+	}
+	else if (SetVectorOperation *vector = dynamic_cast<SetVectorOperation *>(operation)) {
+		hash = hash_float(hash, vector->getX());
+		hash = hash_float(hash, vector->getY());
+		hash = hash_float(hash, vector->getZ());
+		hash = hash_float(hash, vector->getW());
+	}
+
+	if (operation->getbNode()) {
+		if (node_hash(system, operation->getbNode(), &input_hash)) {
+			hash = hash_uint64(hash, input_hash);
+		}
+		else {
+			entry.valid = false;
+		}
+	}
+
+	for (index = 0; index < operation->getNumberOfInputSockets(); index++) {
+		InputSocket *inputSocket = operation->getInputSocket(index);
+
+		hash = hash_int(hash, inputSocket->getResizeMode());
+		if (inputSocket->isConnected()) {
+			NodeOperation *inputOperation = (NodeOperation *)inputSocket->getConnection()->getFromNode();
+			if (operation_hash(system, inputOperation, &input_hash)) {
+				hash = hash_uint64(hash, input_hash);
+			}
+			else {
+				entry.valid = false;
+			}
+		}
+	}
+
+	entry.hash = hash;
+	g_operations[operation] = entry;
+
+	*r_hash = entry.hash;
+	return entry.valid;
+}
+
+/* settings that are used by all operations */
+static uint64_t context_hash(ExecutionSystem *system)
+{
+	CompositorContext &context = system->getContext();
+	const RenderData *rd = context.getRenderData();
+	uint64_t hash = HASH_SEED;
+
+	hash = hash_int(hash, context.getQuality());
+	hash = hash_int(hash, context.isFastCalculation());
+	hash = hash_int(hash, context.getHasActiveOpenCLDevices());
+	hash = hash_int(hash, context.isHalfFloatBufferEnabled());
+	hash = hash_int(hash, context.getFramenumber());
+	if (rd) {
+		hash = hash_int(hash, rd->size);
+		hash = hash_int(hash, rd->xsch);
+		hash = hash_int(hash, rd->ysch);
+		hash = hash_int(hash, rd->scemode & R_FULL_SAMPLE);
+		hash = hash_int(hash, rd->mode & (R_BORDER | R_CROP));
+		hash = hash_data(hash, &rd->border, sizeof(rd->border));
+	}
+	return hash;
+}
+
+/**
+ * the hash of an ExecutionGroup combines the hashes of its operations, and through its
+ * ReadBufferOperations the hashes of the ExecutionGroups it depends on.
+ */
+static bool group_hash(ExecutionSystem *system, ExecutionGroup *group, uint64_t *r_hash)
+{
+	GroupEntryMap::iterator it = g_groups.find(group);
+	if (it != g_groups.end()) {
+		*r_hash = it->second.hash;
+		return it->second.valid;
+	}
+
+	ResultCacheEntry entry = {false, HASH_SEED, false, 0.0};
+	NodeOperation *operation = group->getOutputNodeOperation();
+	const rcti *border = group->getViewerBorder();
+	uint64_t hash = context_hash(system);
+	uint64_t output_hash;
+
+	if (!group->isOutputExecutionGroup() && operation->isWriteBufferOperation()) {
+		entry.valid = operation_hash(system, operation, &output_hash);
+		hash = hash_uint64(hash, output_hash);
+	}
+
+	hash = hash_int(hash, group->getWidth());
+	hash = hash_int(hash, group->getHeight());
+	hash = hash_data(hash, border, sizeof(*border));
+
+	entry.hash = hash;
+	g_groups[group] = entry;
+
+	*r_hash = entry.hash;
+	return entry.valid;
+}
+
+/* ******** MovieCache ******** */
+
+static unsigned int result_cache_hashhash(const void *key_)
+{
+	const ResultCacheKey *key = (const ResultCacheKey *)key_;
+
+	return (unsigned int)(key->hash ^ (key->hash >> 32));
+}
+
+static int result_cache_hashcmp(const void *a_, const void *b_)
+{
+	const ResultCacheKey *a = (const ResultCacheKey *)a_;
+	const ResultCacheKey *b = (const ResultCacheKey *)b_;
+
+	return (a->hash != b->hash) || (a->width != b->width) || (a->height != b->height);
+}
+
+static MemoryProxy *group_memory_proxy(ExecutionGroup *group)
+{
+	return ((WriteBufferOperation *)group->getOutputNodeOperation())->getMemoryProxy();
+}
+
+static MemoryBuffer *group_buffer(ExecutionGroup *group)
+{
+	MemoryBuffer *buffer = group_memory_proxy(group)->getBuffer();
+
+	if (buffer == NULL || buffer->getWidth() != (int)group->getWidth() || buffer->getHeight() != (int)group->getHeight()) {
+		return NULL;
+	}
+	return buffer;
+}
+
+/* buffers can be stored compact, copy row by row to convert from and to floats */
+static void buffer_to_rect(MemoryBuffer *buffer, float *rect)
+{
+	const int width = buffer->getWidth();
+	for (int y = 0; y < buffer->getHeight(); y++) {
+		buffer->readRow(&rect[y * width * COM_NUMBER_OF_CHANNELS], 0, y, width);
+	}
+}
+
+static void rect_to_buffer(const float *rect, MemoryBuffer *buffer)
+{
+	const int width = buffer->getWidth();
+	for (int y = 0; y < buffer->getHeight(); y++) {
+		buffer->writeRow(&rect[y * width * COM_NUMBER_OF_CHANNELS], 0, y, width);
+	}
+}
+
+/* copy a stored result into the MemoryProxy of the group */
+static bool restore_group(ExecutionGroup *group, uint64_t hash, double *r_time)
+{
+	MemoryBuffer *buffer;
+	ResultCacheKey key;
+	ImBuf *ibuf;
+
+	if (g_cache == NULL) {
+		return false;
+	}
+
+	buffer = group_buffer(group);
+	if (buffer == NULL) {
+		return false;
+	}
+
+	key.hash = hash;
+	key.width = buffer->getWidth();
+	key.height = buffer->getHeight();
+
+	ibuf = IMB_moviecache_get(g_cache, &key);
+	if (ibuf == NULL) {
+		return false;
+	}
+
+	MemoryProxy *memoryProxy = group_memory_proxy(group);
+	memoryProxy->acquire(true);
+	rect_to_buffer(ibuf->rect_float, buffer);
+	memoryProxy->release();
+	IMB_freeImBuf(ibuf);
+
+	StoredMap::iterator it = g_stored.find(hash);
+	*r_time = (it != g_stored.end()) ? it->second.time : 0.0;
+
+	group->setFullyExecuted();
+	return true;
+}
+
+static void restore_groups(ExecutionSystem *system, ExecutionGroup *group, std::set<ExecutionGroup *> &visited)
+{
+	vector<MemoryProxy *> memoryProxies;
+	unsigned int index;
+	uint64_t hash;
+
+	if (!visited.insert(group).second) {
+		return;
+	}
+
+	if (group_hash(system, group, &hash)) {
+		double time;
+		if (restore_group(group, hash, &time)) {
+			ResultCacheEntry &entry = g_groups[group];
+			entry.restored = true;
+			entry.time = time;
+
+			DebugInfo::result_cache_hit(group, time);
+			return;
+		}
+
+		DebugInfo::result_cache_miss(group);
+	}
+
+	group->determineDependingMemoryProxies(&memoryProxies);
+	for (index = 0; index < memoryProxies.size(); index++) {
+		ExecutionGroup *inputGroup = memoryProxies[index]->getExecutor();
+		if (inputGroup) {
+			restore_groups(system, inputGroup, visited);
+		}
+	}
+}
+
+/* time it took to calculate the group and all groups it depends on */
+static void calculation_time(ExecutionGroup *group, std::set<ExecutionGroup *> &visited, double *r_time)
+{
+	vector<MemoryProxy *> memoryProxies;
+	unsigned int index;
+
+	if (!visited.insert(group).second) {
+		return;
+	}
+
+	GroupEntryMap::iterator it = g_groups.find(group);
+	if (it != g_groups.end() && it->second.restored) {
+		*r_time += it->second.time;
+		return;
+	}
+
+	*r_time += group->getExecutionTime();
+
+	group->determineDependingMemoryProxies(&memoryProxies);
+	for (index = 0; index < memoryProxies.size(); index++) {
+		ExecutionGroup *inputGroup = memoryProxies[index]->getExecutor();
+		if (inputGroup) {
+			calculation_time(inputGroup, visited, r_time);
+		}
+	}
+}
+
+static void store_group(ExecutionGroup *group, uint64_t hash)
+{
+	std::set<ExecutionGroup *> visited;
+	MemoryBuffer *buffer;
+	ResultCacheKey key;
+	ResultCacheStored stored;
+	double time = 0.0;
+	ImBuf *ibuf;
+
+	buffer = group_buffer(group);
+	if (buffer == NULL) {
+		return;
+	}
+
+	/* the MemoryBudget throws away buffers that are not read anymore */
+	MemoryProxy *memoryProxy = group_memory_proxy(group);
+	if (memoryProxy->isDiscarded()) {
+		return;
+	}
+
+	calculation_time(group, visited, &time);
+	if (time < COM_RESULT_CACHE_MIN_TIME) {
+		return;
+	}
+
+	key.hash = hash;
+	key.width = buffer->getWidth();
+	key.height = buffer->getHeight();
+
+	ibuf = IMB_allocImBuf(key.width, key.height, 32, IB_rectfloat);
+	if (ibuf == NULL) {
+		return;
+	}
+	if (!memoryProxy->acquire(false)) {
+		/* the MemoryBudget could not read the buffer back from disk */
+		memoryProxy->release();
+		IMB_freeImBuf(ibuf);
+		return;
+	}
+	buffer_to_rect(buffer, ibuf->rect_float);
+	memoryProxy->release();
+
+	if (g_cache == NULL) {
+		g_cache = IMB_moviecache_create("compositor result cache", sizeof(ResultCacheKey), result_cache_hashhash, result_cache_hashcmp);
+	}
+	IMB_moviecache_put(g_cache, &key, ibuf);
+	IMB_freeImBuf(ibuf);
+
+	stored.width = key.width;
+	stored.height = key.height;
+	stored.time = time;
+	g_stored[hash] = stored;
+}
+
+/* forget the calculation times of results that were removed by the cache limiter */
+static void cleanup_stored()
+{
+	StoredMap::iterator it = g_stored.begin();
+
+	while (it != g_stored.end()) {
+		ResultCacheKey key;
+		key.hash = it->first;
+		key.width = it->second.width;
+		key.height = it->second.height;
+
+		if (g_cache == NULL || !IMB_moviecache_has_frame(g_cache, &key)) {
+			g_stored.erase(it++);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+/* ******** ResultCache ******** */
+
+void ResultCache::restoreResults(ExecutionSystem *system)
+{
+	CompositorContext &context = system->getContext();
+	vector<ExecutionGroup *> &groups = system->getExecutionGroups();
+	std::set<ExecutionGroup *> visited;
+	unsigned int index, proxyIndex;
+
+	g_groups.clear();
+	g_operations.clear();
+	g_nodes.clear();
+
+	if (context.isRendering()) {
+		return;
+	}
+
+	for (index = 0; index < groups.size(); index++) {
+		ExecutionGroup *group = groups[index];
+		/* only the high priority outputs are executed during fast calculation */
+		if (context.isFastCalculation() && group->getRenderPriotrity() != COM_PRIORITY_HIGH) {
+			continue;
+		}
+		if (group->isOutputExecutionGroup()) {
+			vector<MemoryProxy *> memoryProxies;
+			group->determineDependingMemoryProxies(&memoryProxies);
+			for (proxyIndex = 0; proxyIndex < memoryProxies.size(); proxyIndex++) {
+				ExecutionGroup *inputGroup = memoryProxies[proxyIndex]->getExecutor();
+				if (inputGroup) {
+					restore_groups(system, inputGroup, visited);
+				}
+			}
+		}
+	}
+}
+
+void ResultCache::storeResults(ExecutionSystem *system)
+{
+	const bNodeTree *bTree = system->getContext().getbNodeTree();
+	bool breaked = bTree->test_break && bTree->test_break(bTree->tbh);
+
+	/* when the execution was cancelled operations can have stopped halfway a chunk */
+	if (!breaked) {
+		GroupEntryMap::iterator it;
+
+		/* reading a buffer that is not in memory makes room for it, which would throw away
+		 * the buffers of groups that are not stored yet, spill them to disk instead */
+		for (it = g_groups.begin(); it != g_groups.end(); ++it) {
+			if (it->second.valid && !it->second.restored && it->first->isFullyExecuted()) {
+				group_memory_proxy(it->first)->setKeepContent(true);
+			}
+		}
+
+		for (it = g_groups.begin(); it != g_groups.end(); ++it) {
+			ExecutionGroup *group = it->first;
+			ResultCacheEntry &entry = it->second;
+
+			if (entry.valid && !entry.restored && group->isFullyExecuted()) {
+				store_group(group, entry.hash);
+				group_memory_proxy(group)->setKeepContent(false);
+			}
+		}
+		cleanup_stored();
+	}
+
+	if (!g_groups.empty()) {
+		DebugInfo::result_cache_finished();
+	}
+
+	g_groups.clear();
+	g_operations.clear();
+	g_nodes.clear();
+}
+
+void ResultCache::free()
+{
+	if (g_cache) {
+		IMB_moviecache_free(g_cache);
+		g_cache = NULL;
+	}
+	g_stored.clear();
+}
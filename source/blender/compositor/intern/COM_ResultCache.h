@@ -0,0 +1,63 @@
+/*
+ * Copyright 2014, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _COM_ResultCache_h
+#define _COM_ResultCache_h
+
+class ExecutionSystem;
+
+/**
+ * @brief the ResultCache keeps the results of ExecutionGroups between executions of the compositor.
+ *
+ * Every time the node tree is edited a new ExecutionSystem is constructed and all ExecutionGroups
+ * are calculated again. The ResultCache stores the MemoryBuffer of the MemoryProxy of every fully
+ * executed (non output) ExecutionGroup, keyed by a hash of the settings of all operations and nodes
+ * that contributed to the result. When the same key is found during a next execution, the buffer is
+ * copied back into the MemoryProxy and the ExecutionGroup and all ExecutionGroups it depends on are
+ * not scheduled anymore.
+ *
+ * The buffers are stored in a MovieCache, the memory used by the cache is limited by the
+ * Memory Cache Limit user preference. Results of nodes that depend on data which cannot be hashed
+ * (movie clips, masks, textures, ...) are never cached. The cache is only used while editing,
+ * not during rendering.
+ *
+ * @ingroup Memory
+ */
+class ResultCache {
+public:
+	/**
+	 * @brief load the results of the ExecutionGroups that are needed by the output ExecutionGroups
+	 * @note needs to be called after the initExecution of the NodeOperations and ExecutionGroups
+	 * @param system the ExecutionSystem that will be executed
+	 */
+	static void restoreResults(ExecutionSystem *system);
+
+	/**
+	 * @brief store the results of the ExecutionGroups that have been calculated
+	 * @note needs to be called before the deinitExecution of the NodeOperations
+	 * @param system the ExecutionSystem that has been executed
+	 */
+	static void storeResults(ExecutionSystem *system);
+
+	/**
+	 * @brief free all cached results
+	 */
+	static void free();
+};
+
+#endif
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2014, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _COM_SIMD_h
+#define _COM_SIMD_h
+
+/**
+ * @brief helpers to process a single RGBA pixel with SSE
+ *
+ * A pixel4f holds the four channels of one pixel. When SSE is not available a plain
+ * float[4] struct is used with the same functions, so operations only need a single
+ * implementation of their executeRow.
+ *
+ * The functions do the same arithmetic per channel as the scalar code, so results
+ * are the same as the results of executePixelSampled.
+ * @ingroup Execution
+ */
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+
+typedef __m128 pixel4f;
+
+static inline pixel4f pixel_load(const float *p) { return _mm_loadu_ps(p); }
+static inline void pixel_store(float *p, const pixel4f a) { _mm_storeu_ps(p, a); }
+static inline pixel4f pixel_set1(const float f) { return _mm_set1_ps(f); }
+
+static inline pixel4f pixel_add(const pixel4f a, const pixel4f b) { return _mm_add_ps(a, b); }
+static inline pixel4f pixel_sub(const pixel4f a, const pixel4f b) { return _mm_sub_ps(a, b); }
+static inline pixel4f pixel_mul(const pixel4f a, const pixel4f b) { return _mm_mul_ps(a, b); }
+static inline pixel4f pixel_div(const pixel4f a, const pixel4f b) { return _mm_div_ps(a, b); }
+
+/* (a < b) ? a : b, b is returned for NaN like the scalar comparisons */
+static inline pixel4f pixel_min(const pixel4f a, const pixel4f b) { return _mm_min_ps(a, b); }
+/* (a > b) ? a : b, b is returned for NaN like the scalar comparisons */
+static inline pixel4f pixel_max(const pixel4f a, const pixel4f b) { return _mm_max_ps(a, b); }
+
+static inline pixel4f pixel_abs(const pixel4f a)
+{
+	return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+}
+
+/* same as CLAMP(a, 0.0f, 1.0f) on every channel */
+static inline pixel4f pixel_clamp01(const pixel4f a)
+{
+	return _mm_min_ps(_mm_set1_ps(1.0f), _mm_max_ps(_mm_setzero_ps(), a));
+}
+
+/* rgb of a, alpha of b */
+static inline pixel4f pixel_with_alpha(const pixel4f a, const pixel4f b)
+{
+	const pixel4f t = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 3, 2, 2));
+	return _mm_shuffle_ps(a, t, _MM_SHUFFLE(2, 0, 1, 0));
+}
+
+static inline pixel4f pixel_splat_x(const pixel4f a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 0, 0)); }
+static inline pixel4f pixel_splat_w(const pixel4f a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)); }
+
+#else  /* __SSE__ */
+
+#include <math.h>
+
+extern "C" {
+#  include "BLI_utildefines.h"
+}
+
+typedef struct pixel4f {
+	float v[4];
+} pixel4f;
+
+static inline pixel4f pixel_load(const float *p)
+{
+	pixel4f r = {{p[0], p[1], p[2], p[3]}};
+	return r;
+}
+static inline void pixel_store(float *p, const pixel4f a)
+{
+	p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3];
+}
+static inline pixel4f pixel_set1(const float f)
+{
+	pixel4f r = {{f, f, f, f}};
+	return r;
+}
+
+#define PIXEL_BINARY_OP(name, expr)                                    \
+	static inline pixel4f name(const pixel4f a, const pixel4f b)       \
+	{                                                                  \
+		pixel4f r;                                                     \
+		for (int i = 0; i < 4; i++) { const float x = a.v[i], y = b.v[i]; r.v[i] = (expr); } \
+		return r;                                                      \
+	}
+
+PIXEL_BINARY_OP(pixel_add, x + y)
+PIXEL_BINARY_OP(pixel_sub, x - y)
+PIXEL_BINARY_OP(pixel_mul, x * y)
+PIXEL_BINARY_OP(pixel_div, x / y)
+PIXEL_BINARY_OP(pixel_min, (x < y) ? x : y)
+PIXEL_BINARY_OP(pixel_max, (x > y) ? x : y)
+
+#undef PIXEL_BINARY_OP
+
+static inline pixel4f pixel_abs(const pixel4f a)
+{
+	pixel4f r = {{fabsf(a.v[0]), fabsf(a.v[1]), fabsf(a.v[2]), fabsf(a.v[3])}};
+	return r;
+}
+
+static inline pixel4f pixel_clamp01(const pixel4f a)
+{
+	pixel4f r = a;
+	for (int i = 0; i < 4; i++) {
+		CLAMP(r.v[i], 0.0f, 1.0f);
+	}
+	return r;
+}
+
+static inline pixel4f pixel_with_alpha(const pixel4f a, const pixel4f b)
+{
+	pixel4f r = {{a.v[0], a.v[1], a.v[2], b.v[3]}};
+	return r;
+}
+
+static inline pixel4f pixel_splat_x(const pixel4f a) { return pixel_set1(a.v[0]); }
+static inline pixel4f pixel_splat_w(const pixel4f a) { return pixel_set1(a.v[3]); }
+
+#endif  /* __SSE__ */
+
+#endif
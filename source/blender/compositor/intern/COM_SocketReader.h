@@ -90,6 +90,23 @@ protected:
 	 */
 	virtual void executePixelFiltered(float output[4], float x, float y, float dx[2], float dy[2], PixelSampler sampler) {}
 
+	/**
+	 * @brief calculate a row of pixels
+	 * @note this method is called for non-complex, when the whole row is needed at once.
+	 * the default implementation calls executePixelSampled for every pixel, operations
+	 * can override it to process the row in a single call.
+	 * @param output is a float[num * COM_NUMBER_OF_CHANNELS] array to store the result,
+	 * value and vector results use the same stride as colors
+	 * @param x the x-coordinate of the first pixel to calculate in image space
+	 * @param y the y-coordinate of the row to calculate in image space
+	 * @param num the number of pixels to calculate, at most COM_ROW_SIZE
+	 */
+	virtual void executeRow(float *output, int x, int y, int num) {
+		for (int i = 0; i < num; i++) {
+			executePixelSampled(&output[i * COM_NUMBER_OF_CHANNELS], x + i, y, COM_PS_NEAREST);
+		}
+	}
+
 public:
 	inline void readSampled(float result[4], float x, float y, PixelSampler sampler) {
 		executePixelSampled(result, x, y, sampler);
@@ -97,6 +114,9 @@ public:
 	inline void read(float result[4], int x, int y, void *chunkData) {
 		executePixel(result, x, y, chunkData);
 	}
+	inline void readRow(float *result, int x, int y, int num) {
+		executeRow(result, x, y, num);
+	}
 	inline void readFiltered(float result[4], float x, float y, float dx[2], float dy[2], PixelSampler sampler) {
 		executePixelFiltered(result, x, y, dx, dy, sampler);
 	}
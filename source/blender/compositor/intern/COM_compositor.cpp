@@ -34,6 +34,7 @@ extern "C" {
 #include "COM_WorkScheduler.h"
 #include "OCL_opencl.h"
 #include "COM_MovieDistortionOperation.h"
+#include "COM_ResultCache.h"
 
 static ThreadMutex s_compositorMutex;
 static bool is_compositorMutex_init = FALSE;
@@ -41,6 +42,7 @@ static bool is_compositorMutex_init = FALSE;
 static void intern_freeCompositorCaches()
 {
 	deintializeDistortionCache();
+	ResultCache::free();
 }
 
 void COM_execute(RenderData *rd, Scene *scene, bNodeTree *editingtree, int rendering,
@@ -98,4 +98,5 @@ void RenderLayersNode::convertToOperations(ExecutionSystem *graph, CompositorCon
 	testSocketConnection(graph, context, 28, new RenderLayersCyclesOperation(SCE_PASS_SUBSURFACE_DIRECT));
 	testSocketConnection(graph, context, 29, new RenderLayersCyclesOperation(SCE_PASS_SUBSURFACE_INDIRECT));
 	testSocketConnection(graph, context, 30, new RenderLayersCyclesOperation(SCE_PASS_SUBSURFACE_COLOR));
+	testSocketConnection(graph, context, 31, new RenderLayersSampleCountOperation());
 }
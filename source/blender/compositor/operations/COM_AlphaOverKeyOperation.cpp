@@ -53,3 +53,33 @@ void AlphaOverKeyOperation::executePixelSampled(float output[4], float x, float
 		output[3] = (mul * inputColor1[3]) + value[0] * inputOverColor[3];
 	}
 }
+
+void AlphaOverKeyOperation::executeRow(float *output, int x, int y, int num)
+{
+	float inputColor1[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputOverColor[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float value[COM_ROW_SIZE];
+
+	readRowInputs(value, inputColor1, inputOverColor, x, y, num, false);
+
+	for (int i = 0; i < num; i++) {
+		const float *color1 = &inputColor1[i * COM_NUMBER_OF_CHANNELS];
+		const float *overColor = &inputOverColor[i * COM_NUMBER_OF_CHANNELS];
+		float *out = &output[i * COM_NUMBER_OF_CHANNELS];
+
+		if (overColor[3] <= 0.0f) {
+			copy_v4_v4(out, color1);
+		}
+		else if (value[i] == 1.0f && overColor[3] >= 1.0f) {
+			copy_v4_v4(out, overColor);
+		}
+		else {
+			float premul = value[i] * overColor[3];
+			const pixel4f mul = pixel_set1(1.0f - premul);
+			/* color is premultiplied by the over alpha, alpha is not */
+			const pixel4f fac = pixel_with_alpha(pixel_set1(premul), pixel_set1(value[i]));
+
+			pixel_store(out, pixel_add(pixel_mul(mul, pixel_load(color1)), pixel_mul(fac, pixel_load(overColor))));
+		}
+	}
+}
@@ -23,6 +23,8 @@
 #include "COM_BokehBlurOperation.h"
 #include "BLI_math.h"
 #include "COM_OpenCLDevice.h"
+#include "COM_FFTConvolution.h"
+#include "MEM_guardedalloc.h"
 
 extern "C" {
 #  include "RE_pipeline.h"
@@ -43,6 +45,8 @@ BokehBlurOperation::BokehBlurOperation() : NodeOperation()
 	this->m_inputProgram = NULL;
 	this->m_inputBokehProgram = NULL;
 	this->m_inputBoundingBoxReader = NULL;
+	this->m_useFFT = false;
+	this->m_fftResult = NULL;
 }
 
 void *BokehBlurOperation::initializeTileData(rcti *rect)
@@ -52,10 +56,51 @@ void *BokehBlurOperation::initializeTileData(rcti *rect)
 		updateSize();
 	}
 	void *buffer = getInputOperation(0)->initializeTileData(NULL);
+	if (this->m_useFFT && this->m_fftResult == NULL) {
+		calculateFFT((MemoryBuffer *)buffer);
+	}
 	unlockMutex();
 	return buffer;
 }
 
+void BokehBlurOperation::calculateFFT(MemoryBuffer *inputBuffer)
+{
+	const int width = this->getWidth();
+	const int height = this->getHeight();
+	rcti *rect = inputBuffer->getRect();
+
+	if (rect->xmin != 0 || rect->ymin != 0 || inputBuffer->getWidth() != width || inputBuffer->getHeight() != height) {
+		/* input does not cover the whole image, use the direct convolution */
+		this->m_useFFT = false;
+		return;
+	}
+
+	const float max_dim = max(width, height);
+	const int pixelSize = this->m_size * max_dim / 100.0f;
+	const int kernelSize = 2 * pixelSize + 1;
+	const float m = this->m_bokehDimension / pixelSize;
+	float *kernel = (float *)MEM_callocN(sizeof(float) * kernelSize * kernelSize * COM_NUMBER_OF_CHANNELS, __func__);
+
+	/* executePixel reads the input at x + dx for dx in [-pixelSize, pixelSize),
+	 * the weight of dx is stored at pixelSize - dx, so the first row and column stay zero */
+	for (int j = 1; j < kernelSize; j++) {
+		const float v = this->m_bokehMidY - (pixelSize - j) * m;
+		for (int i = 1; i < kernelSize; i++) {
+			const float u = this->m_bokehMidX - (pixelSize - i) * m;
+			this->m_inputBokehProgram->readSampled(&kernel[(j * kernelSize + i) * COM_NUMBER_OF_CHANNELS], u, v, COM_PS_NEAREST);
+		}
+	}
+
+	this->m_fftResult = (float *)MEM_mallocN(sizeof(float) * width * height * COM_NUMBER_OF_CHANNELS, __func__);
+	FFTConvolution::convolve(this->m_fftResult, inputBuffer->getBuffer(), width, height,
+	                         kernel, kernelSize, kernelSize, COM_NUMBER_OF_CHANNELS,
+	                         pixelSize, pixelSize, COM_NUMBER_OF_CHANNELS);
+	FFTConvolution::normalize(this->m_fftResult, width, height,
+	                          kernel, kernelSize, kernelSize, COM_NUMBER_OF_CHANNELS,
+	                          pixelSize, pixelSize, COM_NUMBER_OF_CHANNELS);
+	MEM_freeN(kernel);
+}
+
 void BokehBlurOperation::initExecution()
 {
 	initMutex();
@@ -72,6 +117,18 @@ void BokehBlurOperation::initExecution()
 	this->m_bokehMidY = height / 2.0f;
 	this->m_bokehDimension = dimension / 2.0f;
 	QualityStepHelper::initExecution(COM_QH_INCREASE);
+
+	/* large kernels are faster with a FFT convolution of the whole image,
+	 * only possible when the size is known before the input is scheduled */
+	this->m_useFFT = false;
+	this->m_fftResult = NULL;
+	if (this->m_sizeavailable) {
+		const float max_dim = max(this->getWidth(), this->getHeight());
+		const int pixelSize = this->m_size * max_dim / 100.0f;
+		const int samples = (2 * pixelSize + getStep() - 1) / getStep();
+		this->m_useFFT = (pixelSize >= 2) &&
+		                 FFTConvolution::isFasterThanDirect(2 * pixelSize + 1, 2 * pixelSize + 1, samples * samples);
+	}
 }
 
 void BokehBlurOperation::executePixel(float output[4], int x, int y, void *data)
@@ -81,7 +138,10 @@ void BokehBlurOperation::executePixel(float output[4], int x, int y, void *data)
 	float bokeh[4];
 
 	this->m_inputBoundingBoxReader->readSampled(tempBoundingBox, x, y, COM_PS_NEAREST);
-	if (tempBoundingBox[0] > 0.0f) {
+	if (tempBoundingBox[0] > 0.0f && this->m_fftResult) {
+		copy_v4_v4(output, &this->m_fftResult[(y * this->getWidth() + x) * COM_NUMBER_OF_CHANNELS]);
+	}
+	else if (tempBoundingBox[0] > 0.0f) {
 		float multiplier_accum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
 		MemoryBuffer *inputBuffer = (MemoryBuffer *)data;
 		float *buffer = inputBuffer->getBuffer();
@@ -137,6 +197,10 @@ void BokehBlurOperation::executePixel(float output[4], int x, int y, void *data)
 void BokehBlurOperation::deinitExecution()
 {
 	deinitMutex();
+	if (this->m_fftResult) {
+		MEM_freeN(this->m_fftResult);
+		this->m_fftResult = NULL;
+	}
 	this->m_inputProgram = NULL;
 	this->m_inputBokehProgram = NULL;
 	this->m_inputBoundingBoxReader = NULL;
@@ -148,7 +212,13 @@ bool BokehBlurOperation::determineDependingAreaOfInterest(rcti *input, ReadBuffe
 	rcti bokehInput;
 	const float max_dim = max(this->getWidth(), this->getHeight());
 
-	if (this->m_sizeavailable) {
+	if (this->m_useFFT) {
+		newInput.xmin = 0;
+		newInput.ymin = 0;
+		newInput.xmax = this->getWidth();
+		newInput.ymax = this->getHeight();
+	}
+	else if (this->m_sizeavailable) {
 		newInput.xmax = input->xmax + (this->m_size * max_dim / 100.0f);
 		newInput.xmin = input->xmin - (this->m_size * max_dim / 100.0f);
 		newInput.ymax = input->ymax + (this->m_size * max_dim / 100.0f);
@@ -37,6 +37,15 @@ private:
 	float m_bokehMidX;
 	float m_bokehMidY;
 	float m_bokehDimension;
+
+	/**
+	 * @brief the whole image is convolved at once using FFTConvolution, see calculateFFT
+	 * @note m_fftResult is a float RGBA copy of the whole output that is kept until deinitExecution,
+	 * it is allocated next to the buffers of the MemoryBudget and not counted by it
+	 */
+	bool m_useFFT;
+	float *m_fftResult;
+	void calculateFFT(MemoryBuffer *inputBuffer);
 public:
 	BokehBlurOperation();
 
@@ -68,6 +68,28 @@ void ColorBalanceASCCDLOperation::executePixelSampled(float output[4], float x,
 
 }
 
+void ColorBalanceASCCDLOperation::executeRow(float *output, int x, int y, int num)
+{
+	float inputColor[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float value[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	this->m_inputValueOperation->readRow(value, x, y, num);
+	this->m_inputColorOperation->readRow(inputColor, x, y, num);
+
+	for (int i = 0; i < num; i++) {
+		const float *color = &inputColor[i * COM_NUMBER_OF_CHANNELS];
+		float *out = &output[i * COM_NUMBER_OF_CHANNELS];
+		float fac = value[i * COM_NUMBER_OF_CHANNELS];
+		fac = min(1.0f, fac);
+		const float mfac = 1.0f - fac;
+
+		out[0] = mfac * color[0] + fac * colorbalance_cdl(color[0], this->m_offset[0], this->m_power[0], this->m_slope[0]);
+		out[1] = mfac * color[1] + fac * colorbalance_cdl(color[1], this->m_offset[1], this->m_power[1], this->m_slope[1]);
+		out[2] = mfac * color[2] + fac * colorbalance_cdl(color[2], this->m_offset[2], this->m_power[2], this->m_slope[2]);
+		out[3] = color[3];
+	}
+}
+
 void ColorBalanceASCCDLOperation::deinitExecution()
 {
 	this->m_inputValueOperation = NULL;
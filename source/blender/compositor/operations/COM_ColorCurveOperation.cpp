@@ -96,6 +96,46 @@ void ColorCurveOperation::executePixelSampled(float output[4], float x, float y,
 	output[3] = image[3];
 }
 
+void ColorCurveOperation::executeRow(float *output, int x, int y, int num)
+{
+	CurveMapping *cumap = this->m_curveMapping;
+
+	float fac[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float image[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float black[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float white[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	this->m_inputBlackProgram->readRow(black, x, y, num);
+	this->m_inputWhiteProgram->readRow(white, x, y, num);
+	this->m_inputFacProgram->readRow(fac, x, y, num);
+	this->m_inputImageProgram->readRow(image, x, y, num);
+
+	for (int i = 0; i < num; i++) {
+		const int offset = i * COM_NUMBER_OF_CHANNELS;
+		float *out = &output[offset];
+		float bwmul[3];
+
+		/* get our own local bwmul value,
+		 * since we can't be threadsafe and use cumap->bwmul & friends */
+		curvemapping_set_black_white_ex(&black[offset], &white[offset], bwmul);
+
+		if (fac[offset] >= 1.0f) {
+			curvemapping_evaluate_premulRGBF_ex(cumap, out, &image[offset],
+			                                    &black[offset], bwmul);
+		}
+		else if (fac[offset] <= 0.0f) {
+			copy_v3_v3(out, &image[offset]);
+		}
+		else {
+			float col[4];
+			curvemapping_evaluate_premulRGBF_ex(cumap, col, &image[offset],
+			                                    &black[offset], bwmul);
+			interp_v3_v3v3(out, &image[offset], col, fac[offset]);
+		}
+		out[3] = image[offset + 3];
+	}
+}
+
 void ColorCurveOperation::deinitExecution()
 {
 	CurveBaseOperation::deinitExecution();
@@ -152,6 +192,33 @@ void ConstantLevelColorCurveOperation::executePixelSampled(float output[4], floa
 	output[3] = image[3];
 }
 
+void ConstantLevelColorCurveOperation::executeRow(float *output, int x, int y, int num)
+{
+	float fac[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float image[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	this->m_inputFacProgram->readRow(fac, x, y, num);
+	this->m_inputImageProgram->readRow(image, x, y, num);
+
+	for (int i = 0; i < num; i++) {
+		const int offset = i * COM_NUMBER_OF_CHANNELS;
+		float *out = &output[offset];
+
+		if (fac[offset] >= 1.0f) {
+			curvemapping_evaluate_premulRGBF(this->m_curveMapping, out, &image[offset]);
+		}
+		else if (fac[offset] <= 0.0f) {
+			copy_v3_v3(out, &image[offset]);
+		}
+		else {
+			float col[4];
+			curvemapping_evaluate_premulRGBF(this->m_curveMapping, col, &image[offset]);
+			interp_v3_v3v3(out, &image[offset], col, fac[offset]);
+		}
+		out[3] = image[offset + 3];
+	}
+}
+
 void ConstantLevelColorCurveOperation::deinitExecution()
 {
 	CurveBaseOperation::deinitExecution();
@@ -128,7 +128,7 @@ void CompositorOperation::deinitExecution()
 
 void CompositorOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 {
-	float color[8]; // 7 is enough
+	float row[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
 	float *buffer = this->m_outputBuffer;
 	float *zbuffer = this->m_depthBuffer;
 
@@ -184,28 +184,36 @@ void CompositorOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 	}
 #endif
 
+	/* the inputs are calculated a row segment at a time */
 	for (y = y1; y < y2 && (!breaked); y++) {
-		for (x = x1; x < x2 && (!breaked); x++) {
+		for (x = x1; x < x2 && (!breaked); x += COM_ROW_SIZE) {
+			int num = min_ii(COM_ROW_SIZE, x2 - x);
 			int input_x = x + dx, input_y = y + dy;
+			int i;
 
-			this->m_imageInput->readSampled(color, input_x, input_y, COM_PS_NEAREST);
+			this->m_imageInput->readRow(buffer + offset4, input_x, input_y, num);
 			if (this->m_ignoreAlpha) {
-				color[3] = 1.0f;
+				for (i = 0; i < num; i++) {
+					buffer[offset4 + i * COM_NUMBER_OF_CHANNELS + 3] = 1.0f;
+				}
 			}
 			else {
 				if (this->m_alphaInput != NULL) {
-					this->m_alphaInput->readSampled(&(color[3]), input_x, input_y, COM_PS_NEAREST);
+					this->m_alphaInput->readRow(row, input_x, input_y, num);
+					for (i = 0; i < num; i++) {
+						buffer[offset4 + i * COM_NUMBER_OF_CHANNELS + 3] = row[i * COM_NUMBER_OF_CHANNELS];
+					}
 				}
 			}
 
-			copy_v4_v4(buffer + offset4, color);
-
 			if (this->m_depthInput != NULL) {
-				this->m_depthInput->readSampled(color, input_x, input_y, COM_PS_NEAREST);
-				zbuffer[offset] = color[0];
+				this->m_depthInput->readRow(row, input_x, input_y, num);
+				for (i = 0; i < num; i++) {
+					zbuffer[offset + i] = row[i * COM_NUMBER_OF_CHANNELS];
+				}
 			}
-			offset4 += COM_NUMBER_OF_CHANNELS;
-			offset++;
+			offset4 += num * COM_NUMBER_OF_CHANNELS;
+			offset += num;
 			if (isBreaked()) {
 				breaked = true;
 			}
@@ -55,6 +55,18 @@ void ConvertValueToColorOperation::executePixelSampled(float output[4], float x,
 	output[3] = 1.0f;
 }
 
+void ConvertValueToColorOperation::executeRow(float *output, int x, int y, int num)
+{
+	float inputValue[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	const pixel4f one = pixel_set1(1.0f);
+
+	this->m_inputOperation->readRow(inputValue, x, y, num);
+	for (int i = 0; i < num; i++) {
+		const pixel4f value = pixel_splat_x(pixel_load(&inputValue[i * COM_NUMBER_OF_CHANNELS]));
+		pixel_store(&output[i * COM_NUMBER_OF_CHANNELS], pixel_with_alpha(value, one));
+	}
+}
+
 
 /* ******** Color to Value ******** */
 
@@ -71,6 +83,17 @@ void ConvertColorToValueOperation::executePixelSampled(float output[4], float x,
 	output[0] = (inputColor[0] + inputColor[1] + inputColor[2]) / 3.0f;
 }
 
+void ConvertColorToValueOperation::executeRow(float *output, int x, int y, int num)
+{
+	float inputColor[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	this->m_inputOperation->readRow(inputColor, x, y, num);
+	for (int i = 0; i < num; i++) {
+		const float *color = &inputColor[i * COM_NUMBER_OF_CHANNELS];
+		output[i * COM_NUMBER_OF_CHANNELS] = (color[0] + color[1] + color[2]) / 3.0f;
+	}
+}
+
 
 /* ******** Color to BW ******** */
 
@@ -87,6 +110,16 @@ void ConvertColorToBWOperation::executePixelSampled(float output[4], float x, fl
 	output[0] = rgb_to_bw(inputColor);
 }
 
+void ConvertColorToBWOperation::executeRow(float *output, int x, int y, int num)
+{
+	float inputColor[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	this->m_inputOperation->readRow(inputColor, x, y, num);
+	for (int i = 0; i < num; i++) {
+		output[i * COM_NUMBER_OF_CHANNELS] = rgb_to_bw(&inputColor[i * COM_NUMBER_OF_CHANNELS]);
+	}
+}
+
 
 /* ******** Color to Vector ******** */
 
@@ -101,6 +134,11 @@ void ConvertColorToVectorOperation::executePixelSampled(float output[4], float x
 	this->m_inputOperation->readSampled(output, x, y, sampler);
 }
 
+void ConvertColorToVectorOperation::executeRow(float *output, int x, int y, int num)
+{
+	this->m_inputOperation->readRow(output, x, y, num);
+}
+
 
 /* ******** Value to Vector ******** */
 
@@ -120,6 +158,18 @@ void ConvertValueToVectorOperation::executePixelSampled(float output[4], float x
 	output[3] = 0.0f;
 }
 
+void ConvertValueToVectorOperation::executeRow(float *output, int x, int y, int num)
+{
+	float input[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	const pixel4f zero = pixel_set1(0.0f);
+
+	this->m_inputOperation->readRow(input, x, y, num);
+	for (int i = 0; i < num; i++) {
+		const pixel4f value = pixel_splat_x(pixel_load(&input[i * COM_NUMBER_OF_CHANNELS]));
+		pixel_store(&output[i * COM_NUMBER_OF_CHANNELS], pixel_with_alpha(value, zero));
+	}
+}
+
 
 /* ******** Vector to Color ******** */
 
@@ -135,6 +185,14 @@ void ConvertVectorToColorOperation::executePixelSampled(float output[4], float x
 	output[3] = 1.0f;
 }
 
+void ConvertVectorToColorOperation::executeRow(float *output, int x, int y, int num)
+{
+	this->m_inputOperation->readRow(output, x, y, num);
+	for (int i = 0; i < num; i++) {
+		output[i * COM_NUMBER_OF_CHANNELS + 3] = 1.0f;
+	}
+}
+
 
 /* ******** Vector to Value ******** */
 
@@ -151,6 +209,17 @@ void ConvertVectorToValueOperation::executePixelSampled(float output[4], float x
 	output[0] = (input[0] + input[1] + input[2]) / 3.0f;
 }
 
+void ConvertVectorToValueOperation::executeRow(float *output, int x, int y, int num)
+{
+	float input[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	this->m_inputOperation->readRow(input, x, y, num);
+	for (int i = 0; i < num; i++) {
+		const float *vector = &input[i * COM_NUMBER_OF_CHANNELS];
+		output[i * COM_NUMBER_OF_CHANNELS] = (vector[0] + vector[1] + vector[2]) / 3.0f;
+	}
+}
+
 
 /* ******** RGB to YCC ******** */
 
@@ -323,6 +392,28 @@ void ConvertPremulToStraightOperation::executePixelSampled(float output[4], floa
 	output[3] = alpha;
 }
 
+void ConvertPremulToStraightOperation::executeRow(float *output, int x, int y, int num)
+{
+	float inputValue[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	this->m_inputOperation->readRow(inputValue, x, y, num);
+	for (int i = 0; i < num; i++) {
+		const pixel4f color = pixel_load(&inputValue[i * COM_NUMBER_OF_CHANNELS]);
+		const float alpha = inputValue[i * COM_NUMBER_OF_CHANNELS + 3];
+		pixel4f result;
+
+		if (fabsf(alpha) < 1e-5f) {
+			result = pixel_set1(0.0f);
+		}
+		else {
+			result = pixel_mul(color, pixel_set1(1.0f / alpha));
+		}
+
+		/* never touches the alpha */
+		pixel_store(&output[i * COM_NUMBER_OF_CHANNELS], pixel_with_alpha(result, color));
+	}
+}
+
 
 /* ******** Straight to Premul ******** */
 
@@ -346,6 +437,19 @@ void ConvertStraightToPremulOperation::executePixelSampled(float output[4], floa
 	output[3] = alpha;
 }
 
+void ConvertStraightToPremulOperation::executeRow(float *output, int x, int y, int num)
+{
+	float inputValue[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	this->m_inputOperation->readRow(inputValue, x, y, num);
+	for (int i = 0; i < num; i++) {
+		const pixel4f color = pixel_load(&inputValue[i * COM_NUMBER_OF_CHANNELS]);
+
+		/* never touches the alpha */
+		pixel_store(&output[i * COM_NUMBER_OF_CHANNELS], pixel_with_alpha(pixel_mul(color, pixel_splat_w(color)), color));
+	}
+}
+
 
 /* ******** Separate Channels ******** */
 
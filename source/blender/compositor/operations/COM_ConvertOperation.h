@@ -24,6 +24,7 @@
 #define _COM_ConvertOperation_h
 
 #include "COM_NodeOperation.h"
+#include "COM_SIMD.h"
 
 
 class ConvertBaseOperation : public NodeOperation {
@@ -43,6 +44,7 @@ public:
 	ConvertValueToColorOperation();
 	
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int num);
 };
 
 
@@ -51,6 +53,7 @@ public:
 	ConvertColorToValueOperation();
 	
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int num);
 };
 
 
@@ -59,6 +62,7 @@ public:
 	ConvertColorToBWOperation();
 	
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int num);
 };
 
 
@@ -67,6 +71,7 @@ public:
 	ConvertColorToVectorOperation();
 	
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int num);
 };
 
 
@@ -75,6 +80,7 @@ public:
 	ConvertValueToVectorOperation();
 	
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int num);
 };
 
 
@@ -83,6 +89,7 @@ public:
 	ConvertVectorToColorOperation();
 	
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int num);
 };
 
 
@@ -91,6 +98,7 @@ public:
 	ConvertVectorToValueOperation();
 	
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int num);
 };
 
 
@@ -159,6 +167,7 @@ public:
 	ConvertPremulToStraightOperation();
 
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int num);
 };
 
 
@@ -167,6 +176,7 @@ public:
 	ConvertStraightToPremulOperation();
 
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int num);
 };
 
 
@@ -0,0 +1,444 @@
+/*
+ * Copyright 2014, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor:
+ *		Jeroen Bakker
+ *		Monique Dewanchand
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "COM_FFTConvolution.h"
+#include "COM_defines.h"
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#  include "BLI_math.h"
+#  include "BLI_task.h"
+#  include "BLI_utildefines.h"
+}
+
+/**
+ * @brief cost of a transformed value relative to a single sample of a direct convolution,
+ * used to decide when the FFT convolution is faster
+ */
+#define COM_FFT_CONVOLUTION_COST 10.0
+
+/*
+ *  2D Fast Hartley Transform, used for convolution
+ */
+
+typedef float fREAL;
+
+// returns next highest power of 2 of x, as well it's log2 in L2
+static unsigned int nextPow2(unsigned int x, unsigned int *L2)
+{
+	unsigned int pw, x_notpow2 = x & (x - 1);
+	*L2 = 0;
+	while (x >>= 1) ++(*L2);
+	pw = 1 << (*L2);
+	if (x_notpow2) { (*L2)++;  pw <<= 1; }
+	return pw;
+}
+
+//------------------------------------------------------------------------------
+
+// from FXT library by Joerg Arndt, faster in order bitreversal
+// use: r = revbin_upd(r, h) where h = N>>1
+static unsigned int revbin_upd(unsigned int r, unsigned int h)
+{
+	while (!((r ^= h) & h)) h >>= 1;
+	return r;
+}
+//------------------------------------------------------------------------------
+static void FHT(fREAL *data, unsigned int M, unsigned int inverse)
+{
+	double tt, fc, dc, fs, ds, a = M_PI;
+	fREAL t1, t2;
+	int n2, bd, bl, istep, k, len = 1 << M, n = 1;
+
+	int i, j = 0;
+	unsigned int Nh = len >> 1;
+	for (i = 1; i < (len - 1); ++i) {
+		j = revbin_upd(j, Nh);
+		if (j > i) {
+			t1 = data[i];
+			data[i] = data[j];
+			data[j] = t1;
+		}
+	}
+
+	do {
+		fREAL *data_n = &data[n];
+
+		istep = n << 1;
+		for (k = 0; k < len; k += istep) {
+			t1 = data_n[k];
+			data_n[k] = data[k] - t1;
+			data[k] += t1;
+		}
+
+		n2 = n >> 1;
+		if (n > 2) {
+			fc = dc = cos(a);
+			fs = ds = sqrt(1.0 - fc * fc); //sin(a);
+			bd = n - 2;
+			for (bl = 1; bl < n2; bl++) {
+				fREAL *data_nbd = &data_n[bd];
+				fREAL *data_bd = &data[bd];
+				for (k = bl; k < len; k += istep) {
+					t1 = fc * (double)data_n[k] + fs * (double)data_nbd[k];
+					t2 = fs * (double)data_n[k] - fc * (double)data_nbd[k];
+					data_n[k] = data[k] - t1;
+					data_nbd[k] = data_bd[k] - t2;
+					data[k] += t1;
+					data_bd[k] += t2;
+				}
+				tt = fc * dc - fs * ds;
+				fs = fs * dc + fc * ds;
+				fc = tt;
+				bd -= 2;
+			}
+		}
+
+		if (n > 1) {
+			for (k = n2; k < len; k += istep) {
+				t1 = data_n[k];
+				data_n[k] = data[k] - t1;
+				data[k] += t1;
+			}
+		}
+
+		n = istep;
+		a *= 0.5;
+	} while (n < len);
+
+	if (inverse) {
+		fREAL sc = (fREAL)1 / (fREAL)len;
+		for (k = 0; k < len; ++k)
+			data[k] *= sc;
+	}
+}
+//------------------------------------------------------------------------------
+/* 2D Fast Hartley Transform, Mx/My -> log2 of width/height,
+ * nzp -> the row where zero pad data starts,
+ * inverse -> see above */
+static void FHT2D(fREAL *data, unsigned int Mx, unsigned int My,
+                  unsigned int nzp, unsigned int inverse)
+{
+	unsigned int i, j, Nx, Ny, maxy;
+	fREAL t;
+
+	Nx = 1 << Mx;
+	Ny = 1 << My;
+
+	// rows (forward transform skips 0 pad data)
+	maxy = inverse ? Ny : nzp;
+	for (j = 0; j < maxy; ++j)
+		FHT(&data[Nx * j], Mx, inverse);
+
+	// transpose data
+	if (Nx == Ny) {  // square
+		for (j = 0; j < Ny; ++j)
+			for (i = j + 1; i < Nx; ++i) {
+				unsigned int op = i + (j << Mx), np = j + (i << My);
+				t = data[op], data[op] = data[np], data[np] = t;
+			}
+	}
+	else {  // rectangular
+		unsigned int k, Nym = Ny - 1, stm = 1 << (Mx + My);
+		for (i = 0; stm > 0; i++) {
+#define PRED(k) (((k & Nym) << Mx) + (k >> My))
+			for (j = PRED(i); j > i; j = PRED(j)) ;
+			if (j < i) continue;
+			for (k = i, j = PRED(i); j != i; k = j, j = PRED(j), stm--) {
+				t = data[j], data[j] = data[k], data[k] = t;
+			}
+#undef PRED
+			stm--;
+		}
+	}
+	// swap Mx/My & Nx/Ny
+	i = Nx, Nx = Ny, Ny = i;
+	i = Mx, Mx = My, My = i;
+
+	// now columns == transposed rows
+	for (j = 0; j < Ny; ++j)
+		FHT(&data[Nx * j], Mx, inverse);
+
+	// finalize
+	for (j = 0; j <= (Ny >> 1); j++) {
+		unsigned int jm = (Ny - j) & (Ny - 1);
+		unsigned int ji = j << Mx;
+		unsigned int jmi = jm << Mx;
+		for (i = 0; i <= (Nx >> 1); i++) {
+			unsigned int im = (Nx - i) & (Nx - 1);
+			fREAL A = data[ji + i];
+			fREAL B = data[jmi + i];
+			fREAL C = data[ji + im];
+			fREAL D = data[jmi + im];
+			fREAL E = (fREAL)0.5 * ((A + D) - (B + C));
+			data[ji + i] = A - E;
+			data[jmi + i] = B + E;
+			data[ji + im] = C + E;
+			data[jmi + im] = D - E;
+		}
+	}
+
+}
+
+//------------------------------------------------------------------------------
+
+/* 2D convolution calc, d1 *= d2, M/N - > log2 of width/height */
+static void fht_convolve(fREAL *d1, const fREAL *d2, unsigned int M, unsigned int N)
+{
+	fREAL a, b;
+	unsigned int i, j, k, L, mj, mL;
+	unsigned int m = 1 << M, n = 1 << N;
+	unsigned int m2 = 1 << (M - 1), n2 = 1 << (N - 1);
+	unsigned int mn2 = m << (N - 1);
+
+	d1[0] *= d2[0];
+	d1[mn2] *= d2[mn2];
+	d1[m2] *= d2[m2];
+	d1[m2 + mn2] *= d2[m2 + mn2];
+	for (i = 1; i < m2; i++) {
+		k = m - i;
+		a = d1[i] * d2[i] - d1[k] * d2[k];
+		b = d1[k] * d2[i] + d1[i] * d2[k];
+		d1[i] = (b + a) * (fREAL)0.5;
+		d1[k] = (b - a) * (fREAL)0.5;
+		a = d1[i + mn2] * d2[i + mn2] - d1[k + mn2] * d2[k + mn2];
+		b = d1[k + mn2] * d2[i + mn2] + d1[i + mn2] * d2[k + mn2];
+		d1[i + mn2] = (b + a) * (fREAL)0.5;
+		d1[k + mn2] = (b - a) * (fREAL)0.5;
+	}
+	for (j = 1; j < n2; j++) {
+		L = n - j;
+		mj = j << M;
+		mL = L << M;
+		a = d1[mj] * d2[mj] - d1[mL] * d2[mL];
+		b = d1[mL] * d2[mj] + d1[mj] * d2[mL];
+		d1[mj] = (b + a) * (fREAL)0.5;
+		d1[mL] = (b - a) * (fREAL)0.5;
+		a = d1[m2 + mj] * d2[m2 + mj] - d1[m2 + mL] * d2[m2 + mL];
+		b = d1[m2 + mL] * d2[m2 + mj] + d1[m2 + mj] * d2[m2 + mL];
+		d1[m2 + mj] = (b + a) * (fREAL)0.5;
+		d1[m2 + mL] = (b - a) * (fREAL)0.5;
+	}
+	for (i = 1; i < m2; i++) {
+		k = m - i;
+		for (j = 1; j < n2; j++) {
+			L = n - j;
+			mj = j << M;
+			mL = L << M;
+			a = d1[i + mj] * d2[i + mj] - d1[k + mL] * d2[k + mL];
+			b = d1[k + mL] * d2[i + mj] + d1[i + mj] * d2[k + mL];
+			d1[i + mj] = (b + a) * (fREAL)0.5;
+			d1[k + mL] = (b - a) * (fREAL)0.5;
+			a = d1[i + mL] * d2[i + mL] - d1[k + mj] * d2[k + mj];
+			b = d1[k + mj] * d2[i + mL] + d1[i + mL] * d2[k + mj];
+			d1[i + mL] = (b + a) * (fREAL)0.5;
+			d1[k + mj] = (b - a) * (fREAL)0.5;
+		}
+	}
+}
+//------------------------------------------------------------------------------
+
+/* ******** FFT Convolution ******** */
+
+typedef struct ConvolutionData {
+	float *dst;
+	const float *image;
+	int imageWidth, imageHeight;
+	int numberOfChannels;
+	int centerX, centerY;
+	/* FFT pow2 size & log2 */
+	unsigned int w2, h2, log2_w, log2_h;
+	/* size and number of the image blocks */
+	int xbsz, ybsz, nxb, nyb;
+	/* transformed kernel of every kernel channel */
+	fREAL *kernelData;
+	int kernelChannels;
+	/* only rows of blocks with this parity are convolved */
+	int parity;
+} ConvolutionData;
+
+/* convolve one channel of a row of blocks and add the result to dst */
+static void convolve_block_row(void *userdata, void *UNUSED(userdata_chunk), int iter)
+{
+	const ConvolutionData *cd = (const ConvolutionData *)userdata;
+	const int ch = iter % cd->numberOfChannels;
+	const int ybl = (iter / cd->numberOfChannels) * 2 + cd->parity;
+	const unsigned int size = cd->w2 * cd->h2;
+	const fREAL *kernelData = &cd->kernelData[(cd->kernelChannels == 1 ? 0 : ch) * size];
+	fREAL *data = (fREAL *)MEM_mallocN(size * sizeof(fREAL), "FFTConvolution block data");
+	int x, y, xbl;
+
+	for (xbl = 0; xbl < cd->nxb; xbl++) {
+		// image block, channel ch -> data
+		memset(data, 0, size * sizeof(fREAL));
+		for (y = 0; y < cd->ybsz; y++) {
+			const int yy = ybl * cd->ybsz + y;
+			if (yy >= cd->imageHeight) break;
+			fREAL *fp = &data[y * cd->w2];
+			const float *colp = &cd->image[yy * cd->imageWidth * COM_NUMBER_OF_CHANNELS + ch];
+			for (x = 0; x < cd->xbsz; x++) {
+				const int xx = xbl * cd->xbsz + x;
+				if (xx >= cd->imageWidth) break;
+				fp[x] = colp[xx * COM_NUMBER_OF_CHANNELS];
+			}
+		}
+
+		// forward FHT, zero pad data starts after the block
+		FHT2D(data, cd->log2_w, cd->log2_h, cd->ybsz, 0);
+
+		// FHT2D transposed data, row/col now swapped
+		// convolve & inverse FHT
+		fht_convolve(data, kernelData, cd->log2_h, cd->log2_w);
+		FHT2D(data, cd->log2_h, cd->log2_w, 0, 1);
+		// data again transposed, so in order again
+
+		// overlap-add result
+		for (y = 0; y < (int)cd->h2; y++) {
+			const int yy = ybl * cd->ybsz + y - cd->centerY;
+			if ((yy < 0) || (yy >= cd->imageHeight)) continue;
+			const fREAL *fp = &data[y * cd->w2];
+			float *colp = &cd->dst[yy * cd->imageWidth * COM_NUMBER_OF_CHANNELS + ch];
+			for (x = 0; x < (int)cd->w2; x++) {
+				const int xx = xbl * cd->xbsz + x - cd->centerX;
+				if ((xx < 0) || (xx >= cd->imageWidth)) continue;
+				colp[xx * COM_NUMBER_OF_CHANNELS] += fp[x];
+			}
+		}
+	}
+
+	MEM_freeN(data);
+}
+
+void FFTConvolution::convolve(float *dst, const float *image, int imageWidth, int imageHeight,
+                              const float *kernel, int kernelWidth, int kernelHeight, int kernelChannels,
+                              int centerX, int centerY, int numberOfChannels)
+{
+	ConvolutionData cd;
+	unsigned int size;
+	int x, y, ch;
+
+	BLI_assert(kernelChannels == 1 || kernelChannels >= numberOfChannels);
+	BLI_assert(centerX >= 0 && centerX < kernelWidth && centerY >= 0 && centerY < kernelHeight);
+
+	memset(dst, 0, sizeof(float) * imageWidth * imageHeight * COM_NUMBER_OF_CHANNELS);
+
+	// convolution result width & height, FFT pow2 required size & log2
+	cd.w2 = nextPow2(max_ii(2 * kernelWidth - 1, 2), &cd.log2_w);
+	cd.h2 = nextPow2(max_ii(2 * kernelHeight - 1, 2), &cd.log2_h);
+	size = cd.w2 * cd.h2;
+
+	// block add-overlap, a block convolved with the kernel fits in the transform
+	cd.xbsz = (cd.w2 + 1) - kernelWidth;
+	cd.ybsz = (cd.h2 + 1) - kernelHeight;
+	cd.nxb = (imageWidth + cd.xbsz - 1) / cd.xbsz;
+	cd.nyb = (imageHeight + cd.ybsz - 1) / cd.ybsz;
+
+	// only need to calc fht data of the kernel once, re-used for every block
+	cd.kernelData = (fREAL *)MEM_callocN(kernelChannels * size * sizeof(fREAL), "FFTConvolution kernel data");
+	for (ch = 0; ch < kernelChannels; ch++) {
+		fREAL *data = &cd.kernelData[ch * size];
+		for (y = 0; y < kernelHeight; y++) {
+			const float *kp = &kernel[y * kernelWidth * kernelChannels + ch];
+			for (x = 0; x < kernelWidth; x++)
+				data[y * cd.w2 + x] = kp[x * kernelChannels];
+		}
+		FHT2D(data, cd.log2_w, cd.log2_h, kernelHeight, 0);
+	}
+
+	cd.dst = dst;
+	cd.image = image;
+	cd.imageWidth = imageWidth;
+	cd.imageHeight = imageHeight;
+	cd.numberOfChannels = numberOfChannels;
+	cd.centerX = centerX;
+	cd.centerY = centerY;
+	cd.kernelChannels = kernelChannels;
+
+	/* the result of a row of blocks overlaps the next row of blocks (but not the one after),
+	 * so the even rows are done in parallel first, then the odd rows */
+	for (cd.parity = 0; cd.parity < 2; cd.parity++) {
+		const int rows = (cd.nyb - cd.parity + 1) / 2;
+		BLI_task_parallel_range_ex(0, rows * numberOfChannels, &cd, NULL, 0,
+		                           convolve_block_row, NULL, 1, true);
+	}
+
+	MEM_freeN(cd.kernelData);
+}
+
+void FFTConvolution::normalize(float *dst, int imageWidth, int imageHeight,
+                               const float *kernel, int kernelWidth, int kernelHeight, int kernelChannels,
+                               int centerX, int centerY, int numberOfChannels)
+{
+	/* summed area table of the kernel, sat[j][i] is the sum of the weights above and left of (i, j) */
+	const int satWidth = kernelWidth + 1;
+	const int satSize = satWidth * (kernelHeight + 1);
+	double *sat = (double *)MEM_callocN(sizeof(double) * satSize * kernelChannels, "FFTConvolution sat");
+	int x, y, ch;
+
+	for (ch = 0; ch < kernelChannels; ch++) {
+		double *sc = &sat[ch * satSize];
+		for (y = 0; y < kernelHeight; y++) {
+			double rowsum = 0.0;
+			for (x = 0; x < kernelWidth; x++) {
+				rowsum += kernel[(y * kernelWidth + x) * kernelChannels + ch];
+				sc[(y + 1) * satWidth + x + 1] = sc[y * satWidth + x + 1] + rowsum;
+			}
+		}
+	}
+
+	for (y = 0; y < imageHeight; y++) {
+		/* kernel rows that overlapped the image, never empty as the center is always inside */
+		const int j1 = max_ii(0, y + centerY - imageHeight + 1);
+		const int j2 = min_ii(kernelHeight, y + centerY + 1);
+		float *color = &dst[y * imageWidth * COM_NUMBER_OF_CHANNELS];
+
+		for (x = 0; x < imageWidth; x++, color += COM_NUMBER_OF_CHANNELS) {
+			const int i1 = max_ii(0, x + centerX - imageWidth + 1);
+			const int i2 = min_ii(kernelWidth, x + centerX + 1);
+
+			for (ch = 0; ch < numberOfChannels; ch++) {
+				const double *sc = &sat[(kernelChannels == 1 ? 0 : ch) * satSize];
+				const double sum = sc[j2 * satWidth + i2] - sc[j1 * satWidth + i2] -
+				                   sc[j2 * satWidth + i1] + sc[j1 * satWidth + i1];
+				color[ch] = (sum != 0.0) ? (float)(color[ch] / sum) : 0.0f;
+			}
+		}
+	}
+
+	MEM_freeN(sat);
+}
+
+bool FFTConvolution::isFasterThanDirect(int kernelWidth, int kernelHeight, int samplesPerPixel)
+{
+	unsigned int log2_w, log2_h;
+	const unsigned int w2 = nextPow2(max_ii(2 * kernelWidth - 1, 2), &log2_w);
+	const unsigned int h2 = nextPow2(max_ii(2 * kernelHeight - 1, 2), &log2_h);
+	const double blockPixels = (double)((w2 + 1) - kernelWidth) * (double)((h2 + 1) - kernelHeight);
+
+	/* forward and inverse transform of every channel of a block, spread over the pixels of the block */
+	const double cost = COM_FFT_CONVOLUTION_COST * (double)(w2 * h2) * (double)(log2_w + log2_h) / blockPixels;
+
+	return cost < (double)samplesPerPixel;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2014, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _COM_FFTConvolution_h
+#define _COM_FFTConvolution_h
+
+/**
+ * @brief convolution of a full image with a large kernel using the Fast Hartley Transform
+ *
+ * The image is split in blocks, every block is transformed, multiplied with the transformed
+ * kernel and transformed back. The results of the blocks are added together (overlap-add).
+ * The memory used only depends on the size of the kernel, and blocks are convolved in parallel.
+ *
+ * The cost per pixel grows with the logarithm of the kernel size instead of with the kernel
+ * area like a direct convolution, which makes it a lot faster for large blur kernels.
+ *
+ * Images are interleaved RGBA (COM_NUMBER_OF_CHANNELS floats per pixel) without offset.
+ * @ingroup Operation
+ */
+class FFTConvolution {
+public:
+	/**
+	 * @brief convolve the image with the kernel
+	 *
+	 * dst(x, y) = sum of kernel(i, j) * image(x - i + centerX, y - j + centerY),
+	 * pixels outside the image are zero.
+	 *
+	 * @param dst the result, float[imageWidth * imageHeight * COM_NUMBER_OF_CHANNELS].
+	 * channels that are not convolved are set to zero.
+	 * @param image the image to convolve, float[imageWidth * imageHeight * COM_NUMBER_OF_CHANNELS]
+	 * @param kernel float[kernelWidth * kernelHeight * kernelChannels]
+	 * @param kernelChannels 1 to use the same kernel for all channels, otherwise the kernel has
+	 * (at least) a channel for every convolved channel
+	 * @param numberOfChannels the number of channels of the image to convolve, 3 for RGB or 4 for RGBA
+	 */
+	static void convolve(float *dst, const float *image, int imageWidth, int imageHeight,
+	                     const float *kernel, int kernelWidth, int kernelHeight, int kernelChannels,
+	                     int centerX, int centerY, int numberOfChannels);
+
+	/**
+	 * @brief divide the result of convolve by the sum of the kernel weights that overlapped the image
+	 *
+	 * This gives the same result as a direct convolution that skips the pixels outside the
+	 * image and divides by the sum of the weights it used.
+	 * Parameters are the same as passed to convolve.
+	 */
+	static void normalize(float *dst, int imageWidth, int imageHeight,
+	                      const float *kernel, int kernelWidth, int kernelHeight, int kernelChannels,
+	                      int centerX, int centerY, int numberOfChannels);
+
+	/**
+	 * @brief check if the convolution is expected to be faster than a direct convolution
+	 * @param samplesPerPixel the number of kernel samples a direct convolution reads per pixel
+	 */
+	static bool isFasterThanDirect(int kernelWidth, int kernelHeight, int samplesPerPixel);
+};
+
+#endif
@@ -21,6 +21,7 @@
  */
 
 #include "COM_GaussianBokehBlurOperation.h"
+#include "COM_FFTConvolution.h"
 #include "BLI_math.h"
 #include "MEM_guardedalloc.h"
 extern "C" {
@@ -30,6 +31,8 @@ extern "C" {
 GaussianBokehBlurOperation::GaussianBokehBlurOperation() : BlurBaseOperation(COM_DT_COLOR)
 {
 	this->m_gausstab = NULL;
+	this->m_useFFT = false;
+	this->m_fftResult = NULL;
 }
 
 void *GaussianBokehBlurOperation::initializeTileData(rcti *rect)
@@ -39,6 +42,9 @@ void *GaussianBokehBlurOperation::initializeTileData(rcti *rect)
 		updateGauss();
 	}
 	void *buffer = getInputOperation(0)->initializeTileData(NULL);
+	if (this->m_useFFT && this->m_fftResult == NULL) {
+		calculateFFT((MemoryBuffer *)buffer);
+	}
 	unlockMutex();
 	return buffer;
 }
@@ -49,11 +55,45 @@ void GaussianBokehBlurOperation::initExecution()
 
 	initMutex();
 
+	this->m_useFFT = false;
+	this->m_fftResult = NULL;
 	if (this->m_sizeavailable) {
 		updateGauss();
+
+		/* large kernels are faster with a FFT convolution of the whole image */
+		const int step = QualityStepHelper::getStep();
+		const int samplesx = (2 * this->m_radx + step) / step;
+		const int samplesy = (2 * this->m_rady + step) / step;
+		this->m_useFFT = FFTConvolution::isFasterThanDirect(2 * this->m_radx + 1, 2 * this->m_rady + 1,
+		                                                    samplesx * samplesy);
 	}
 }
 
+void GaussianBokehBlurOperation::calculateFFT(MemoryBuffer *inputBuffer)
+{
+	const int width = this->getWidth();
+	const int height = this->getHeight();
+	const int kernelWidth = 2 * this->m_radx + 1;
+	const int kernelHeight = 2 * this->m_rady + 1;
+	rcti *rect = inputBuffer->getRect();
+
+	if (rect->xmin != 0 || rect->ymin != 0 || inputBuffer->getWidth() != width || inputBuffer->getHeight() != height) {
+		/* input does not cover the whole image, use the direct convolution */
+		this->m_useFFT = false;
+		return;
+	}
+
+	/* the filter only depends on the distance to the center, so m_gausstab does not need to be
+	 * mirrored to be used as a convolution kernel */
+	this->m_fftResult = (float *)MEM_mallocN(sizeof(float) * width * height * COM_NUMBER_OF_CHANNELS, __func__);
+	FFTConvolution::convolve(this->m_fftResult, inputBuffer->getBuffer(), width, height,
+	                         this->m_gausstab, kernelWidth, kernelHeight, 1,
+	                         this->m_radx, this->m_rady, COM_NUMBER_OF_CHANNELS);
+	FFTConvolution::normalize(this->m_fftResult, width, height,
+	                          this->m_gausstab, kernelWidth, kernelHeight, 1,
+	                          this->m_radx, this->m_rady, COM_NUMBER_OF_CHANNELS);
+}
+
 void GaussianBokehBlurOperation::updateGauss()
 {
 	if (this->m_gausstab == NULL) {
@@ -116,6 +156,11 @@ void GaussianBokehBlurOperation::updateGauss()
 
 void GaussianBokehBlurOperation::executePixel(float output[4], int x, int y, void *data)
 {
+	if (this->m_fftResult) {
+		copy_v4_v4(output, &this->m_fftResult[(y * this->getWidth() + x) * COM_NUMBER_OF_CHANNELS]);
+		return;
+	}
+
 	float tempColor[4];
 	tempColor[0] = 0;
 	tempColor[1] = 0;
@@ -159,6 +204,10 @@ void GaussianBokehBlurOperation::deinitExecution()
 	BlurBaseOperation::deinitExecution();
 	MEM_freeN(this->m_gausstab);
 	this->m_gausstab = NULL;
+	if (this->m_fftResult) {
+		MEM_freeN(this->m_fftResult);
+		this->m_fftResult = NULL;
+	}
 
 	deinitMutex();
 }
@@ -32,6 +32,15 @@ private:
 	int m_radx, m_rady;
 	void updateGauss();
 
+	/**
+	 * @brief the whole image is convolved at once using FFTConvolution, see calculateFFT
+	 * @note m_fftResult is a float RGBA copy of the whole output that is kept until deinitExecution,
+	 * it is allocated next to the buffers of the MemoryBudget and not counted by it
+	 */
+	bool m_useFFT;
+	float *m_fftResult;
+	void calculateFFT(MemoryBuffer *inputBuffer);
+
 public:
 	GaussianBokehBlurOperation();
 	void initExecution();
@@ -72,6 +72,12 @@ void MathBaseOperation::clampIfNeeded(float *color)
 	}
 }
 
+void MathBaseOperation::readRowInputs(float *value1, float *value2, int x, int y, int num)
+{
+	this->m_inputValue1Operation->readRow(value1, x, y, num);
+	this->m_inputValue2Operation->readRow(value2, x, y, num);
+}
+
 void MathAddOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -85,6 +91,19 @@ void MathAddOperation::executePixelSampled(float output[4], float x, float y, Pi
 	clampIfNeeded(output);
 }
 
+void MathAddOperation::executeRow(float *output, int x, int y, int num)
+{
+	float inputValue1[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputValue2[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	readRowInputs(inputValue1, inputValue2, x, y, num);
+	for (int i = 0; i < num * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		output[i] = inputValue1[i] + inputValue2[i];
+
+		clampIfNeeded(&output[i]);
+	}
+}
+
 void MathSubtractOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -98,6 +117,19 @@ void MathSubtractOperation::executePixelSampled(float output[4], float x, float
 	clampIfNeeded(output);
 }
 
+void MathSubtractOperation::executeRow(float *output, int x, int y, int num)
+{
+	float inputValue1[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputValue2[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	readRowInputs(inputValue1, inputValue2, x, y, num);
+	for (int i = 0; i < num * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		output[i] = inputValue1[i] - inputValue2[i];
+
+		clampIfNeeded(&output[i]);
+	}
+}
+
 void MathMultiplyOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -111,6 +143,19 @@ void MathMultiplyOperation::executePixelSampled(float output[4], float x, float
 	clampIfNeeded(output);
 }
 
+void MathMultiplyOperation::executeRow(float *output, int x, int y, int num)
+{
+	float inputValue1[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputValue2[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	readRowInputs(inputValue1, inputValue2, x, y, num);
+	for (int i = 0; i < num * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		output[i] = inputValue1[i] * inputValue2[i];
+
+		clampIfNeeded(&output[i]);
+	}
+}
+
 void MathDivideOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -127,6 +172,22 @@ void MathDivideOperation::executePixelSampled(float output[4], float x, float y,
 	clampIfNeeded(output);
 }
 
+void MathDivideOperation::executeRow(float *output, int x, int y, int num)
+{
+	float inputValue1[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputValue2[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	readRowInputs(inputValue1, inputValue2, x, y, num);
+	for (int i = 0; i < num * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		if (inputValue2[i] == 0) /* We don't want to divide by zero. */
+			output[i] = 0.0;
+		else
+			output[i] = inputValue1[i] / inputValue2[i];
+
+		clampIfNeeded(&output[i]);
+	}
+}
+
 void MathSineOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -265,6 +326,19 @@ void MathMinimumOperation::executePixelSampled(float output[4], float x, float y
 	clampIfNeeded(output);
 }
 
+void MathMinimumOperation::executeRow(float *output, int x, int y, int num)
+{
+	float inputValue1[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputValue2[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	readRowInputs(inputValue1, inputValue2, x, y, num);
+	for (int i = 0; i < num * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		output[i] = min(inputValue1[i], inputValue2[i]);
+
+		clampIfNeeded(&output[i]);
+	}
+}
+
 void MathMaximumOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -278,6 +352,19 @@ void MathMaximumOperation::executePixelSampled(float output[4], float x, float y
 	clampIfNeeded(output);
 }
 
+void MathMaximumOperation::executeRow(float *output, int x, int y, int num)
+{
+	float inputValue1[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputValue2[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	readRowInputs(inputValue1, inputValue2, x, y, num);
+	for (int i = 0; i < num * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		output[i] = max(inputValue1[i], inputValue2[i]);
+
+		clampIfNeeded(&output[i]);
+	}
+}
+
 void MathRoundOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -69,6 +69,23 @@ void MixBaseOperation::executePixelSampled(float output[4], float x, float y, Pi
 	output[3] = inputColor1[3];
 }
 
+void MixBaseOperation::readRowInputs(float value[COM_ROW_SIZE], float *color1, float *color2, int x, int y, int num,
+                                     bool useAlphaMultiply)
+{
+	float inputValue[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	this->m_inputValueOperation->readRow(inputValue, x, y, num);
+	this->m_inputColor1Operation->readRow(color1, x, y, num);
+	this->m_inputColor2Operation->readRow(color2, x, y, num);
+
+	for (int i = 0; i < num; i++) {
+		value[i] = inputValue[i * COM_NUMBER_OF_CHANNELS];
+		if (useAlphaMultiply) {
+			value[i] *= color2[i * COM_NUMBER_OF_CHANNELS + 3];
+		}
+	}
+}
+
 void MixBaseOperation::determineResolution(unsigned int resolution[2], unsigned int preferredResolution[2])
 {
 	InputSocket *socket;
@@ -129,6 +146,23 @@ void MixAddOperation::executePixelSampled(float output[4], float x, float y, Pix
 	clampIfNeeded(output);
 }
 
+void MixAddOperation::executeRow(float *output, int x, int y, int num)
+{
+	float inputColor1[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputColor2[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputValue[COM_ROW_SIZE];
+
+	readRowInputs(inputValue, inputColor1, inputColor2, x, y, num, this->useValueAlphaMultiply());
+
+	for (int i = 0; i < num; i++) {
+		const pixel4f color1 = pixel_load(&inputColor1[i * COM_NUMBER_OF_CHANNELS]);
+		const pixel4f color2 = pixel_load(&inputColor2[i * COM_NUMBER_OF_CHANNELS]);
+		const pixel4f value = pixel_set1(inputValue[i]);
+		const pixel4f result = pixel_add(color1, pixel_mul(value, color2));
+		pixel_store(&output[i * COM_NUMBER_OF_CHANNELS], clampIfNeeded(pixel_with_alpha(result, color1)));
+	}
+}
+
 /* ******** Mix Blend Operation ******** */
 
 MixBlendOperation::MixBlendOperation() : MixBaseOperation()
@@ -160,6 +194,24 @@ void MixBlendOperation::executePixelSampled(float output[4], float x, float y, P
 	clampIfNeeded(output);
 }
 
+void MixBlendOperation::executeRow(float *output, int x, int y, int num)
+{
+	float inputColor1[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputColor2[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputValue[COM_ROW_SIZE];
+
+	readRowInputs(inputValue, inputColor1, inputColor2, x, y, num, this->useValueAlphaMultiply());
+
+	for (int i = 0; i < num; i++) {
+		const pixel4f color1 = pixel_load(&inputColor1[i * COM_NUMBER_OF_CHANNELS]);
+		const pixel4f color2 = pixel_load(&inputColor2[i * COM_NUMBER_OF_CHANNELS]);
+		const pixel4f value = pixel_set1(inputValue[i]);
+		const pixel4f valuem = pixel_set1(1.0f - inputValue[i]);
+		const pixel4f result = pixel_add(pixel_mul(valuem, color1), pixel_mul(value, color2));
+		pixel_store(&output[i * COM_NUMBER_OF_CHANNELS], clampIfNeeded(pixel_with_alpha(result, color1)));
+	}
+}
+
 /* ******** Mix Burn Operation ******** */
 
 MixBurnOperation::MixBurnOperation() : MixBaseOperation()
@@ -308,6 +360,25 @@ void MixDarkenOperation::executePixelSampled(float output[4], float x, float y,
 	clampIfNeeded(output);
 }
 
+void MixDarkenOperation::executeRow(float *output, int x, int y, int num)
+{
+	float inputColor1[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputColor2[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputValue[COM_ROW_SIZE];
+
+	readRowInputs(inputValue, inputColor1, inputColor2, x, y, num, this->useValueAlphaMultiply());
+
+	for (int i = 0; i < num; i++) {
+		const pixel4f color1 = pixel_load(&inputColor1[i * COM_NUMBER_OF_CHANNELS]);
+		const pixel4f color2 = pixel_load(&inputColor2[i * COM_NUMBER_OF_CHANNELS]);
+		const pixel4f valuem = pixel_set1(1.0f - inputValue[i]);
+		const pixel4f one = pixel_set1(1.0f);
+		const pixel4f tmp = pixel_add(color2, pixel_mul(pixel_sub(one, color2), valuem));
+		const pixel4f result = pixel_min(tmp, color1);
+		pixel_store(&output[i * COM_NUMBER_OF_CHANNELS], clampIfNeeded(pixel_with_alpha(result, color1)));
+	}
+}
+
 /* ******** Mix Difference Operation ******** */
 
 MixDifferenceOperation::MixDifferenceOperation() : MixBaseOperation()
@@ -338,6 +409,24 @@ void MixDifferenceOperation::executePixelSampled(float output[4], float x, float
 	clampIfNeeded(output);
 }
 
+void MixDifferenceOperation::executeRow(float *output, int x, int y, int num)
+{
+	float inputColor1[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputColor2[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputValue[COM_ROW_SIZE];
+
+	readRowInputs(inputValue, inputColor1, inputColor2, x, y, num, this->useValueAlphaMultiply());
+
+	for (int i = 0; i < num; i++) {
+		const pixel4f color1 = pixel_load(&inputColor1[i * COM_NUMBER_OF_CHANNELS]);
+		const pixel4f color2 = pixel_load(&inputColor2[i * COM_NUMBER_OF_CHANNELS]);
+		const pixel4f value = pixel_set1(inputValue[i]);
+		const pixel4f valuem = pixel_set1(1.0f - inputValue[i]);
+		const pixel4f result = pixel_add(pixel_mul(valuem, color1), pixel_mul(value, pixel_abs(pixel_sub(color1, color2))));
+		pixel_store(&output[i * COM_NUMBER_OF_CHANNELS], clampIfNeeded(pixel_with_alpha(result, color1)));
+	}
+}
+
 /* ******** Mix Difference Operation ******** */
 
 MixDivideOperation::MixDivideOperation() : MixBaseOperation()
@@ -562,6 +651,24 @@ void MixLightenOperation::executePixelSampled(float output[4], float x, float y,
 	clampIfNeeded(output);
 }
 
+void MixLightenOperation::executeRow(float *output, int x, int y, int num)
+{
+	float inputColor1[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputColor2[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputValue[COM_ROW_SIZE];
+
+	readRowInputs(inputValue, inputColor1, inputColor2, x, y, num, this->useValueAlphaMultiply());
+
+	for (int i = 0; i < num; i++) {
+		const pixel4f color1 = pixel_load(&inputColor1[i * COM_NUMBER_OF_CHANNELS]);
+		const pixel4f color2 = pixel_load(&inputColor2[i * COM_NUMBER_OF_CHANNELS]);
+		const pixel4f value = pixel_set1(inputValue[i]);
+		const pixel4f tmp = pixel_mul(value, color2);
+		const pixel4f result = pixel_max(tmp, color1);
+		pixel_store(&output[i * COM_NUMBER_OF_CHANNELS], clampIfNeeded(pixel_with_alpha(result, color1)));
+	}
+}
+
 /* ******** Mix Linear Light Operation ******** */
 
 MixLinearLightOperation::MixLinearLightOperation() : MixBaseOperation()
@@ -631,6 +738,24 @@ void MixMultiplyOperation::executePixelSampled(float output[4], float x, float y
 	clampIfNeeded(output);
 }
 
+void MixMultiplyOperation::executeRow(float *output, int x, int y, int num)
+{
+	float inputColor1[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputColor2[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputValue[COM_ROW_SIZE];
+
+	readRowInputs(inputValue, inputColor1, inputColor2, x, y, num, this->useValueAlphaMultiply());
+
+	for (int i = 0; i < num; i++) {
+		const pixel4f color1 = pixel_load(&inputColor1[i * COM_NUMBER_OF_CHANNELS]);
+		const pixel4f color2 = pixel_load(&inputColor2[i * COM_NUMBER_OF_CHANNELS]);
+		const pixel4f value = pixel_set1(inputValue[i]);
+		const pixel4f valuem = pixel_set1(1.0f - inputValue[i]);
+		const pixel4f result = pixel_mul(color1, pixel_add(valuem, pixel_mul(value, color2)));
+		pixel_store(&output[i * COM_NUMBER_OF_CHANNELS], clampIfNeeded(pixel_with_alpha(result, color1)));
+	}
+}
+
 /* ******** Mix Ovelray Operation ******** */
 
 MixOverlayOperation::MixOverlayOperation() : MixBaseOperation()
@@ -748,6 +873,26 @@ void MixScreenOperation::executePixelSampled(float output[4], float x, float y,
 	clampIfNeeded(output);
 }
 
+void MixScreenOperation::executeRow(float *output, int x, int y, int num)
+{
+	float inputColor1[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputColor2[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputValue[COM_ROW_SIZE];
+
+	readRowInputs(inputValue, inputColor1, inputColor2, x, y, num, this->useValueAlphaMultiply());
+
+	for (int i = 0; i < num; i++) {
+		const pixel4f color1 = pixel_load(&inputColor1[i * COM_NUMBER_OF_CHANNELS]);
+		const pixel4f color2 = pixel_load(&inputColor2[i * COM_NUMBER_OF_CHANNELS]);
+		const pixel4f value = pixel_set1(inputValue[i]);
+		const pixel4f valuem = pixel_set1(1.0f - inputValue[i]);
+		const pixel4f one = pixel_set1(1.0f);
+		const pixel4f result = pixel_sub(one, pixel_mul(pixel_add(valuem, pixel_mul(value, pixel_sub(one, color2))),
+		                                                pixel_sub(one, color1)));
+		pixel_store(&output[i * COM_NUMBER_OF_CHANNELS], clampIfNeeded(pixel_with_alpha(result, color1)));
+	}
+}
+
 /* ******** Mix Soft Light Operation ******** */
 
 MixSoftLightOperation::MixSoftLightOperation() : MixBaseOperation()
@@ -814,6 +959,23 @@ void MixSubtractOperation::executePixelSampled(float output[4], float x, float y
 	clampIfNeeded(output);
 }
 
+void MixSubtractOperation::executeRow(float *output, int x, int y, int num)
+{
+	float inputColor1[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputColor2[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputValue[COM_ROW_SIZE];
+
+	readRowInputs(inputValue, inputColor1, inputColor2, x, y, num, this->useValueAlphaMultiply());
+
+	for (int i = 0; i < num; i++) {
+		const pixel4f color1 = pixel_load(&inputColor1[i * COM_NUMBER_OF_CHANNELS]);
+		const pixel4f color2 = pixel_load(&inputColor2[i * COM_NUMBER_OF_CHANNELS]);
+		const pixel4f value = pixel_set1(inputValue[i]);
+		const pixel4f result = pixel_sub(color1, pixel_mul(value, color2));
+		pixel_store(&output[i * COM_NUMBER_OF_CHANNELS], clampIfNeeded(pixel_with_alpha(result, color1)));
+	}
+}
+
 /* ******** Mix Value Operation ******** */
 
 MixValueOperation::MixValueOperation() : MixBaseOperation()
@@ -23,6 +23,7 @@
 #ifndef _COM_MixBaseOperation_h
 #define _COM_MixBaseOperation_h
 #include "COM_NodeOperation.h"
+#include "COM_SIMD.h"
 
 
 /**
@@ -50,6 +51,19 @@ protected:
 			CLAMP(color[3], 0.0f, 1.0f);
 		}
 	}
+
+	inline pixel4f clampIfNeeded(const pixel4f color)
+	{
+		return (m_useClamp) ? pixel_clamp01(color) : color;
+	}
+
+	/**
+	 * @brief read a row of all inputs, used by executeRow
+	 * @param value receives the value input of every pixel,
+	 * multiplied by the alpha of color2 when useAlphaMultiply is set
+	 */
+	void readRowInputs(float value[COM_ROW_SIZE], float *color1, float *color2, int x, int y, int num,
+	                   bool useAlphaMultiply);
 	
 public:
 	/**
@@ -84,12 +98,14 @@ class MixAddOperation : public MixBaseOperation {
 public:
 	MixAddOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int num);
 };
 
 class MixBlendOperation : public MixBaseOperation {
 public:
 	MixBlendOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int num);
 };
 
 class MixBurnOperation : public MixBaseOperation {
@@ -108,12 +124,14 @@ class MixDarkenOperation : public MixBaseOperation {
 public:
 	MixDarkenOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int num);
 };
 
 class MixDifferenceOperation : public MixBaseOperation {
 public:
 	MixDifferenceOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int num);
 };
 
 class MixDivideOperation : public MixBaseOperation {
@@ -144,6 +162,7 @@ class MixLightenOperation : public MixBaseOperation {
 public:
 	MixLightenOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int num);
 };
 
 class MixLinearLightOperation : public MixBaseOperation {
@@ -156,6 +175,7 @@ class MixMultiplyOperation : public MixBaseOperation {
 public:
 	MixMultiplyOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int num);
 };
 
 class MixOverlayOperation : public MixBaseOperation {
@@ -174,6 +194,7 @@ class MixScreenOperation : public MixBaseOperation {
 public:
 	MixScreenOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int num);
 };
 
 class MixSoftLightOperation : public MixBaseOperation {
@@ -186,6 +207,7 @@ class MixSubtractOperation : public MixBaseOperation {
 public:
 	MixSubtractOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int num);
 };
 
 class MixValueOperation : public MixBaseOperation {
@@ -64,7 +64,7 @@ static float *init_buffer(unsigned int width, unsigned int height, DataType data
 static void write_buffer_rect(rcti *rect, const bNodeTree *tree,
                               SocketReader *reader, float *buffer, unsigned int width, DataType datatype)
 {
-	float color[4];
+	float row[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
 	int i, size = get_datatype_size(datatype);
 
 	if (!buffer) return;
@@ -77,13 +77,17 @@ static void write_buffer_rect(rcti *rect, const bNodeTree *tree,
 	int y;
 	bool breaked = false;
 
+	/* the input is calculated a row segment at a time */
 	for (y = y1; y < y2 && (!breaked); y++) {
-		for (x = x1; x < x2 && (!breaked); x++) {
-			reader->readSampled(color, x, y, COM_PS_NEAREST);
+		for (x = x1; x < x2 && (!breaked); x += COM_ROW_SIZE) {
+			int num = min_ii(COM_ROW_SIZE, x2 - x);
+			reader->readRow(row, x, y, num);
 			
-			for (i = 0; i < size; ++i)
-				buffer[offset + i] = color[i];
-			offset += size;
+			for (int j = 0; j < num; j++) {
+				for (i = 0; i < size; ++i)
+					buffer[offset + i] = row[j * COM_NUMBER_OF_CHANNELS + i];
+				offset += size;
+			}
 			
 			if (tree->test_break && tree->test_break(tree->tbh))
 				breaked = true;
@@ -90,21 +90,46 @@ void PreviewOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 {
 	int offset;
 	float color[4];
+	float row[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
 	struct ColormanageProcessor *cm_processor;
 
+	/* unless the preview is much smaller than the input, neighboring pixels read
+	 * neighboring input pixels and the input is calculated a row segment at a time.
+	 * otherwise most pixels of a row segment would be skipped */
+	const bool use_rows = (this->m_divider >= 0.5f);
+	const int row_end = (int)floor((rect->xmax - 1) / this->m_divider) + 1;
+
 	cm_processor = IMB_colormanagement_display_processor_new(this->m_viewSettings, this->m_displaySettings);
 
 	for (int y = rect->ymin; y < rect->ymax; y++) {
 		offset = (y * getWidth() + rect->xmin) * 4;
+		int row_x = 0, row_num = 0;
 		for (int x = rect->xmin; x < rect->xmax; x++) {
 			float rx = floor(x / this->m_divider);
 			float ry = floor(y / this->m_divider);
-	
-			color[0] = 0.0f;
-			color[1] = 0.0f;
-			color[2] = 0.0f;
-			color[3] = 1.0f;
-			this->m_input->readSampled(color, rx, ry, COM_PS_NEAREST);
+
+			if (use_rows) {
+				if (rx < row_x || rx >= row_x + row_num) {
+					row_x = rx;
+					row_num = min_ii(COM_ROW_SIZE, row_end - row_x);
+					for (int i = 0; i < row_num; i++) {
+						float *pixel = &row[i * COM_NUMBER_OF_CHANNELS];
+						pixel[0] = 0.0f;
+						pixel[1] = 0.0f;
+						pixel[2] = 0.0f;
+						pixel[3] = 1.0f;
+					}
+					this->m_input->readRow(row, row_x, ry, row_num);
+				}
+				copy_v4_v4(color, &row[((int)rx - row_x) * COM_NUMBER_OF_CHANNELS]);
+			}
+			else {
+				color[0] = 0.0f;
+				color[1] = 0.0f;
+				color[2] = 0.0f;
+				color[3] = 1.0f;
+				this->m_input->readSampled(color, rx, ry, COM_PS_NEAREST);
+			}
 			IMB_colormanagement_processor_apply_v4(cm_processor, color);
 			F4TOCHAR4(color, this->m_outputBuffer + offset);
 			offset += 4;
@@ -66,6 +66,20 @@ void ReadBufferOperation::executePixelSampled(float output[4], float x, float y,
 	}
 }
 
+void ReadBufferOperation::executeRow(float *output, int x, int y, int num)
+{
+	if (m_single_value) {
+		/* write buffer has a single value stored at (0,0) */
+		m_buffer->read(output, 0, 0);
+		for (int i = 1; i < num; i++) {
+			copy_v4_v4(&output[i * COM_NUMBER_OF_CHANNELS], output);
+		}
+	}
+	else {
+		m_buffer->readRow(output, x, y, num);
+	}
+}
+
 void ReadBufferOperation::executePixelExtend(float output[4], float x, float y, PixelSampler sampler,
                                              MemoryBufferExtend extend_x, MemoryBufferExtend extend_y)
 {
@@ -334,6 +334,13 @@ RenderLayersRefractionOperation::RenderLayersRefractionOperation() : RenderLayer
 	this->addOutputSocket(COM_DT_COLOR);
 }
 
+/* ******** Render Layers Sample Count Operation ******** */
+
+RenderLayersSampleCountOperation::RenderLayersSampleCountOperation() : RenderLayersBaseProg(SCE_PASS_SAMPLE_COUNT, 1)
+{
+	this->addOutputSocket(COM_DT_VALUE);
+}
+
 /* ******** Render Layers Shadow Operation ******** */
 
 RenderLayersShadowOperation::RenderLayersShadowOperation() : RenderLayersBaseProg(SCE_PASS_SHADOW, 3)
@@ -185,6 +185,11 @@ public:
 	RenderLayersRefractionOperation();
 };
 
+class RenderLayersSampleCountOperation : public RenderLayersBaseProg {
+public:
+	RenderLayersSampleCountOperation();
+};
+
 class RenderLayersShadowOperation : public RenderLayersBaseProg {
 public:
 	RenderLayersShadowOperation();
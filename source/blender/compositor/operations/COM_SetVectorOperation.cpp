@@ -36,6 +36,17 @@ void SetVectorOperation::executePixelSampled(float output[4], float x, float y,
 	output[3] = this->m_w;
 }
 
+void SetVectorOperation::executeRow(float *output, int x, int y, int num)
+{
+	for (int i = 0; i < num; i++) {
+		float *out = &output[i * COM_NUMBER_OF_CHANNELS];
+		out[0] = this->m_x;
+		out[1] = this->m_y;
+		out[2] = this->m_z;
+		out[3] = this->m_w;
+	}
+}
+
 void SetVectorOperation::determineResolution(unsigned int resolution[2], unsigned int preferredResolution[2])
 {
 	resolution[0] = preferredResolution[0];
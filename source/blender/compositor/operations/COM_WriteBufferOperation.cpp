@@ -60,7 +60,10 @@ void WriteBufferOperation::deinitExecution()
 void WriteBufferOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 {
 	MemoryBuffer *memoryBuffer = this->m_memoryProxy->getBuffer();
-	float *buffer = memoryBuffer->getBuffer();
+	/* compact buffers are calculated in a row of floats that is converted when stored */
+	const bool compact = memoryBuffer->isCompact();
+	float *buffer = (compact) ? NULL : memoryBuffer->getBuffer();
+	float row[COM_ROW_SIZE * COM_NUMBER_OF_CHANNELS];
 	if (this->m_input->isComplex()) {
 		void *data = this->m_input->initializeTileData(rect);
 		int x1 = rect->xmin;
@@ -71,10 +74,15 @@ void WriteBufferOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 		int y;
 		bool breaked = false;
 		for (y = y1; y < y2 && (!breaked); y++) {
-			int offset4 = (y * memoryBuffer->getWidth() + x1) * COM_NUMBER_OF_CHANNELS;
-			for (x = x1; x < x2; x++) {
-				this->m_input->read(&(buffer[offset4]), x, y, data);
-				offset4 += COM_NUMBER_OF_CHANNELS;
+			for (x = x1; x < x2; x += COM_ROW_SIZE) {
+				int num = min_ii(COM_ROW_SIZE, x2 - x);
+				float *output = (compact) ? row : &buffer[(y * memoryBuffer->getWidth() + x) * COM_NUMBER_OF_CHANNELS];
+				for (int i = 0; i < num; i++) {
+					this->m_input->read(&output[i * COM_NUMBER_OF_CHANNELS], x + i, y, data);
+				}
+				if (compact) {
+					memoryBuffer->writeRow(row, x, y, num);
+				}
 			}
 			if (isBreaked()) {
 				breaked = true;
@@ -96,10 +104,14 @@ void WriteBufferOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 		int y;
 		bool breaked = false;
 		for (y = y1; y < y2 && (!breaked); y++) {
-			int offset4 = (y * memoryBuffer->getWidth() + x1) * COM_NUMBER_OF_CHANNELS;
-			for (x = x1; x < x2; x++) {
-				this->m_input->readSampled(&(buffer[offset4]), x, y, COM_PS_NEAREST);
-				offset4 += COM_NUMBER_OF_CHANNELS;
+			/* non complex operations are calculated a row segment at a time */
+			for (x = x1; x < x2; x += COM_ROW_SIZE) {
+				int num = min_ii(COM_ROW_SIZE, x2 - x);
+				float *output = (compact) ? row : &buffer[(y * memoryBuffer->getWidth() + x) * COM_NUMBER_OF_CHANNELS];
+				this->m_input->readRow(output, x, y, num);
+				if (compact) {
+					memoryBuffer->writeRow(row, x, y, num);
+				}
 			}
 			if (isBreaked()) {
 				breaked = true;
@@ -0,0 +1,247 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/**
+ * Compare FFTConvolution with the direct convolution of BokehBlurOperation
+ * (a kernel per channel) and GaussianBokehBlurOperation (one kernel for all
+ * channels) for a range of kernel radii.
+ *
+ * The direct convolution is timed on a subset of the rows and scaled to the
+ * full image. Also verifies the FFT result matches the direct convolution
+ * summed in double, reports where isFasterThanDirect disagrees with the
+ * measured times, and that no memory is leaked.
+ */
+
+/* To compile run (from this directory):
+ * gcc -O2 -DNDEBUG -I../.. -I../../operations -I../../../blenlib -I../../../makesdna \
+ *     -I../../../../../intern/guardedalloc -I../../../../../intern/atomic \
+ *     fftbench.cpp ../../operations/COM_FFTConvolution.cpp -x c ../../../blenlib/intern/task.c \
+ *     ../../../blenlib/intern/threads.c ../../../blenlib/intern/listbase.c ../../../blenlib/intern/gsqueue.c \
+ *     ../../../blenlib/intern/time.c ../../../../../intern/guardedalloc/intern/mallocn*.c -x none \
+ *     -lstdc++ -lpthread -lm -o fftbench
+ *
+ * Usage: fftbench [width height]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "COM_defines.h"
+#include "COM_FFTConvolution.h"
+
+extern "C" {
+#  include "BLI_math_base.h"
+#  include "BLI_utildefines.h"
+#  include "BLI_threads.h"
+#  include "PIL_time.h"
+}
+
+/* number of rows the direct convolution is timed on */
+#define DIRECT_ROWS 16
+
+/* largest difference to the direct convolution, relative to the largest value of the image */
+#define MAX_ERROR 1e-5f
+
+/* kernel like BokehBlurOperation.calculateFFT makes: a disc with a weight per channel,
+ * the first row and column are zero */
+static float *bokeh_kernel(int radius)
+{
+	const int size = 2 * radius + 1;
+	float *kernel = (float *)MEM_callocN(sizeof(float) * size * size * COM_NUMBER_OF_CHANNELS, __func__);
+
+	for (int j = 1; j < size; j++) {
+		for (int i = 1; i < size; i++) {
+			const int dx = i - radius, dy = j - radius;
+			if (dx * dx + dy * dy <= radius * radius) {
+				for (int c = 0; c < COM_NUMBER_OF_CHANNELS; c++) {
+					kernel[(j * size + i) * COM_NUMBER_OF_CHANNELS + c] = 0.5f + 0.1f * c;
+				}
+			}
+		}
+	}
+	return kernel;
+}
+
+/* kernel like GaussianBokehBlurOperation.updateGauss makes: one weight for all channels */
+static float *gauss_kernel(int radius)
+{
+	const int size = 2 * radius + 1;
+	float *kernel = (float *)MEM_mallocN(sizeof(float) * size * size, __func__);
+	float sum = 0.0f;
+
+	for (int j = 0; j < size; j++) {
+		for (int i = 0; i < size; i++) {
+			const float dx = (float)(i - radius) / radius, dy = (float)(j - radius) / radius;
+			const float w = expf(-3.0f * (dx * dx + dy * dy));
+			kernel[j * size + i] = w;
+			sum += w;
+		}
+	}
+	for (int i = 0; i < size * size; i++) {
+		kernel[i] /= sum;
+	}
+	return kernel;
+}
+
+/* the direct convolution of the operations for row y: pixels outside the image are skipped
+ * and the result is divided by the sum of the weights that were used.
+ * The operations sum in float, the reference for the error sums in double */
+template<typename T>
+static void direct_row(float *dst, const float *image, int width, int height,
+                       const float *kernel, int radius, int kernelChannels, int y)
+{
+	const int size = 2 * radius + 1;
+
+	for (int x = 0; x < width; x++) {
+		T color[4] = {0, 0, 0, 0};
+		T weight[4] = {0, 0, 0, 0};
+		const int miny = max_ii(y - radius, 0), maxy = min_ii(y + radius + 1, height);
+		const int minx = max_ii(x - radius, 0), maxx = min_ii(x + radius + 1, width);
+
+		for (int ny = miny; ny < maxy; ny++) {
+			for (int nx = minx; nx < maxx; nx++) {
+				const float *in = &image[(ny * width + nx) * COM_NUMBER_OF_CHANNELS];
+				const int k = (radius - (ny - y)) * size + (radius - (nx - x));
+				if (kernelChannels == 1) {
+					const float w = kernel[k];
+					for (int c = 0; c < COM_NUMBER_OF_CHANNELS; c++) {
+						color[c] += w * in[c];
+						weight[c] += w;
+					}
+				}
+				else {
+					const float *w = &kernel[k * COM_NUMBER_OF_CHANNELS];
+					for (int c = 0; c < COM_NUMBER_OF_CHANNELS; c++) {
+						color[c] += w[c] * in[c];
+						weight[c] += w[c];
+					}
+				}
+			}
+		}
+
+		for (int c = 0; c < COM_NUMBER_OF_CHANNELS; c++) {
+			dst[x * COM_NUMBER_OF_CHANNELS + c] = (weight[c] != 0) ? (float)(color[c] / weight[c]) : 0.0f;
+		}
+	}
+}
+
+static int bench_radius(const char *name, const float *image, int width, int height,
+                        int radius, int kernelChannels)
+{
+	const int size = 2 * radius + 1;
+	float *kernel = (kernelChannels == 1) ? gauss_kernel(radius) : bokeh_kernel(radius);
+	float *fft = (float *)MEM_mallocN(sizeof(float) * width * height * COM_NUMBER_OF_CHANNELS, __func__);
+	float *row = (float *)MEM_mallocN(sizeof(float) * width * COM_NUMBER_OF_CHANNELS, __func__);
+	double t_fft, t_direct, t;
+	float max_error = 0.0f, max_error_direct = 0.0f;
+	bool faster, predicted;
+	int ok = 1;
+
+	t = PIL_check_seconds_timer();
+	FFTConvolution::convolve(fft, image, width, height, kernel, size, size, kernelChannels,
+	                         radius, radius, COM_NUMBER_OF_CHANNELS);
+	FFTConvolution::normalize(fft, width, height, kernel, size, size, kernelChannels,
+	                          radius, radius, COM_NUMBER_OF_CHANNELS);
+	t_fft = PIL_check_seconds_timer() - t;
+
+	/* rows spread over the image, so rows at the border with less samples are included */
+	t_direct = 0.0;
+	for (int i = 0; i < DIRECT_ROWS; i++) {
+		const int y = (i == DIRECT_ROWS - 1) ? height - 1 : i * height / DIRECT_ROWS;
+
+		t = PIL_check_seconds_timer();
+		direct_row<float>(row, image, width, height, kernel, radius, kernelChannels, y);
+		t_direct += PIL_check_seconds_timer() - t;
+
+		for (int x = 0; x < width * COM_NUMBER_OF_CHANNELS; x++) {
+			max_error_direct = max_ff(max_error_direct, fabsf(fft[y * width * COM_NUMBER_OF_CHANNELS + x] - row[x]));
+		}
+
+		direct_row<double>(row, image, width, height, kernel, radius, kernelChannels, y);
+
+		for (int x = 0; x < width * COM_NUMBER_OF_CHANNELS; x++) {
+			max_error = max_ff(max_error, fabsf(fft[y * width * COM_NUMBER_OF_CHANNELS + x] - row[x]));
+		}
+	}
+	t_direct *= (double)height / DIRECT_ROWS;
+
+	faster = t_fft < t_direct;
+	predicted = FFTConvolution::isFasterThanDirect(size, size, size * size);
+
+	printf("  %-5s radius %3d: fft %7.3fs, direct %8.3fs (estimated), max error %.2e (to float direct %.2e)%s\n",
+	       name, radius, t_fft, t_direct, max_error, max_error_direct,
+	       (faster == predicted) ? "" : (predicted ? " (fft predicted faster)" : " (fft predicted slower)"));
+
+	/* the image values are in [0, 4] */
+	if (max_error > MAX_ERROR * 4.0f) {
+		fprintf(stderr, "|--* %s radius %d: FFT convolution differs from direct convolution\n", name, radius);
+		ok = 0;
+	}
+
+	MEM_freeN(kernel);
+	MEM_freeN(fft);
+	MEM_freeN(row);
+
+	return ok;
+}
+
+int main(int argc, char *argv[])
+{
+	const int width = (argc > 2) ? atoi(argv[1]) : 1024;
+	const int height = (argc > 2) ? atoi(argv[2]) : 768;
+	const int radii[] = {2, 3, 4, 6, 8, 12, 16, 24, 32, 64, 100};
+	float *image = (float *)MEM_mallocN(sizeof(float) * width * height * COM_NUMBER_OF_CHANNELS, __func__);
+	int error_status = 0;
+	unsigned int i;
+
+	BLI_threadapi_init();
+
+	srand(1);
+	for (i = 0; i < (unsigned int)(width * height * COM_NUMBER_OF_CHANNELS); i++) {
+		image[i] = 4.0f * rand() / (float)RAND_MAX;
+	}
+
+	printf("%dx%d, %d threads:\n", width, height, BLI_system_thread_count());
+
+	for (i = 0; i < sizeof(radii) / sizeof(*radii); i++) {
+		if (!bench_radius("bokeh", image, width, height, radii[i], COM_NUMBER_OF_CHANNELS)) {
+			error_status = 1;
+		}
+	}
+	for (i = 0; i < sizeof(radii) / sizeof(*radii); i++) {
+		if (!bench_radius("gauss", image, width, height, radii[i], 1)) {
+			error_status = 1;
+		}
+	}
+
+	MEM_freeN(image);
+
+	BLI_threadapi_exit();
+
+	if (MEM_get_memory_blocks_in_use() != 0) {
+		fprintf(stderr, "|--* Memory blocks not freed\n");
+		error_status = 1;
+	}
+
+	return error_status;
+}
@@ -0,0 +1,241 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/**
+ * Measure the peak memory of the intermediate buffers of a multi-layer
+ * compositing tree, with the buffers stored as float RGBA, in the compact
+ * layout of their data type, and with color buffers as half floats.
+ *
+ * The buffers are those the ExecutionSystem creates for the tree below: a
+ * WriteBufferOperation for every input of a complex operation and for every
+ * output of a complex operation. Buffers read by a complex operation keep
+ * float RGBA in all modes (see ExecutionSystem.determineMemoryProxyStorage),
+ * only the outputs of complex operations that are read pixel by pixel are
+ * stored compact. Without a MemoryBudget all buffers are allocated at the
+ * start of the execution, so the peak is reached when all are allocated.
+ *
+ * Also measures the time to write and read every buffer once, and verifies
+ * the values read back are within the precision of the layout.
+ */
+
+/* To compile run (from this directory):
+ * gcc -O2 -DNDEBUG -D__LITTLE_ENDIAN__ -I../.. -I../../intern -I../../operations -I../../../blenkernel \
+ *     -I../../../blenlib -I../../../makesdna -I../../../render/extern/include \
+ *     -I../../../../../intern/opencl -I../../../../../intern/guardedalloc -I../../../../../intern/atomic \
+ *     memorybench.cpp ../../intern/COM_MemoryBuffer.cpp -x c ../../../blenlib/intern/rct.c \
+ *     ../../../blenlib/intern/time.c ../../../../../intern/guardedalloc/intern/mallocn*.c -x none \
+ *     -lstdc++ -lpthread -lm -o memorybench
+ *
+ * Usage: memorybench [width height]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "COM_MemoryBuffer.h"
+
+extern "C" {
+#  include "PIL_time.h"
+}
+
+/* an intermediate buffer of the tree */
+typedef struct BenchBuffer {
+	const char *name;
+	DataType datatype;
+	/* read by a complex operation, these keep float RGBA */
+	bool readByComplex;
+} BenchBuffer;
+
+/* three render layers: the characters are defocused and motion blurred,
+ * the background is blurred, the effects layer gets glare and its alpha is
+ * dilated for a matte. The results are mixed and alpha overed to the
+ * composite output, these operations read pixel by pixel. */
+static const BenchBuffer tree_buffers[] = {
+	{"characters Image -> Defocus", COM_DT_COLOR, true},
+	{"characters Z -> Defocus, Vector Blur", COM_DT_VALUE, true},
+	{"characters Speed -> Vector Blur", COM_DT_VECTOR, true},
+	{"Defocus -> Vector Blur", COM_DT_COLOR, true},
+	{"Vector Blur -> Alpha Over", COM_DT_COLOR, false},
+	{"background Image -> Blur", COM_DT_COLOR, true},
+	{"Blur -> Alpha Over", COM_DT_COLOR, false},
+	{"effects Image -> Glare", COM_DT_COLOR, true},
+	{"Glare -> Mix", COM_DT_COLOR, false},
+	{"effects Alpha -> Dilate/Erode", COM_DT_VALUE, true},
+	{"Dilate/Erode -> Mix Fac", COM_DT_VALUE, false},
+};
+
+#define NUM_BUFFERS (sizeof(tree_buffers) / sizeof(*tree_buffers))
+
+typedef enum BenchMode {
+	MODE_RGBA,
+	MODE_COMPACT,
+	MODE_HALF,
+} BenchMode;
+
+static const char *mode_names[] = {"float RGBA", "compact", "compact + half"};
+
+/* same decision as ExecutionSystem.determineMemoryProxyStorage */
+static void buffer_layout(const BenchBuffer *buffer, BenchMode mode, unsigned int *r_channels, bool *r_half)
+{
+	*r_channels = COM_NUMBER_OF_CHANNELS;
+	*r_half = false;
+
+	if (mode == MODE_RGBA || buffer->readByComplex) {
+		return;
+	}
+
+	switch (buffer->datatype) {
+		case COM_DT_VALUE:
+			*r_channels = COM_NUM_CHANNELS_VALUE;
+			break;
+		case COM_DT_VECTOR:
+			*r_channels = COM_NUM_CHANNELS_VECTOR;
+			break;
+		case COM_DT_COLOR:
+			*r_channels = COM_NUM_CHANNELS_COLOR;
+			*r_half = (mode == MODE_HALF);
+			break;
+	}
+}
+
+static void fill_row(float *row, int width, int y)
+{
+	for (int x = 0; x < width; x++) {
+		float *color = &row[x * COM_NUMBER_OF_CHANNELS];
+		color[0] = (float)x / width;
+		color[1] = (float)y * 0.01f;
+		color[2] = 100.0f - (float)x * 0.03f;
+		color[3] = 0.5f;
+	}
+}
+
+/* largest error relative to the value, the precision of a half float is 2^-11 */
+static float row_error(const float *a, const float *b, int width, unsigned int channels)
+{
+	float max_error = 0.0f;
+	for (int x = 0; x < width; x++) {
+		for (unsigned int c = 0; c < channels; c++) {
+			float expected = a[x * COM_NUMBER_OF_CHANNELS + c];
+			float error = fabsf(b[x * COM_NUMBER_OF_CHANNELS + c] - expected) / max_ff(fabsf(expected), 1e-3f);
+			max_error = max_ff(max_error, error);
+		}
+	}
+	return max_error;
+}
+
+static int bench_mode(BenchMode mode, int width, int height)
+{
+	MemoryBuffer *buffers[NUM_BUFFERS];
+	float *row = (float *)MEM_mallocN(sizeof(float) * COM_NUMBER_OF_CHANNELS * width, __func__);
+	float *result = (float *)MEM_mallocN(sizeof(float) * COM_NUMBER_OF_CHANNELS * width, __func__);
+	float *output, *depth;
+	float max_error = 0.0f;
+	double t_write = 0.0, t_read = 0.0, t;
+	size_t bytes = 0;
+	rcti rect;
+	unsigned int index;
+	int ok = 1;
+
+	BLI_rcti_init(&rect, 0, width, 0, height);
+
+	MEM_reset_peak_memory();
+
+	/* the composite output is allocated by the CompositorOperation in every mode */
+	output = (float *)MEM_callocN(sizeof(float) * COM_NUMBER_OF_CHANNELS * width * height, "output");
+	depth = (float *)MEM_callocN(sizeof(float) * width * height, "depth");
+
+	for (index = 0; index < NUM_BUFFERS; index++) {
+		unsigned int channels;
+		bool half;
+		buffer_layout(&tree_buffers[index], mode, &channels, &half);
+		buffers[index] = new MemoryBuffer(NULL, 1, &rect, channels, half, true);
+		bytes += buffers[index]->getMemorySize();
+	}
+
+	for (index = 0; index < NUM_BUFFERS; index++) {
+		MemoryBuffer *buffer = buffers[index];
+		for (int y = 0; y < height; y++) {
+			fill_row(row, width, y);
+
+			t = PIL_check_seconds_timer();
+			buffer->writeRow(row, 0, y, width);
+			t_write += PIL_check_seconds_timer() - t;
+
+			t = PIL_check_seconds_timer();
+			buffer->readRow(result, 0, y, width);
+			t_read += PIL_check_seconds_timer() - t;
+
+			max_error = max_ff(max_error, row_error(row, result, width, buffer->getNumberOfChannels()));
+		}
+	}
+
+	printf("  %-15s buffers %7.1f MB, peak %7.1f MB, write %.3fs, read %.3fs, max error %g\n",
+	       mode_names[mode], bytes / (1024.0 * 1024.0), MEM_get_peak_memory() / (1024.0 * 1024.0),
+	       t_write, t_read, max_error);
+
+	/* floats are stored exactly, half floats round to 11 significant bits */
+	if (max_error > ((mode == MODE_HALF) ? 1.0f / 2048.0f : 0.0f)) {
+		fprintf(stderr, "|--* %s buffers don't read back what was written\n", mode_names[mode]);
+		ok = 0;
+	}
+
+	for (index = 0; index < NUM_BUFFERS; index++) {
+		delete buffers[index];
+	}
+	MEM_freeN(output);
+	MEM_freeN(depth);
+	MEM_freeN(row);
+	MEM_freeN(result);
+
+	return ok;
+}
+
+int main(int argc, char *argv[])
+{
+	const int width = (argc > 2) ? atoi(argv[1]) : 1920;
+	const int height = (argc > 2) ? atoi(argv[2]) : 1080;
+	int error_status = 0;
+	unsigned int index, num_complex = 0;
+
+	for (index = 0; index < NUM_BUFFERS; index++) {
+		if (tree_buffers[index].readByComplex) {
+			num_complex++;
+		}
+	}
+
+	printf("%dx%d, %u buffers, %u read by complex operations:\n",
+	       width, height, (unsigned int)NUM_BUFFERS, num_complex);
+
+	if (!bench_mode(MODE_RGBA, width, height) ||
+	    !bench_mode(MODE_COMPACT, width, height) ||
+	    !bench_mode(MODE_HALF, width, height))
+	{
+		error_status = 1;
+	}
+
+	if (MEM_get_memory_blocks_in_use() != 0) {
+		fprintf(stderr, "|--* Memory blocks not freed\n");
+		error_status = 1;
+	}
+
+	return error_status;
+}
@@ -0,0 +1,327 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/**
+ * Drive a MemoryBudget that fits two buffers the way the ExecutionGroups do:
+ * buffers are written, evicted and spilled to disk, read back, thrown away
+ * when their readers are done, kept for the ResultCache, and a failing read
+ * from the spill file is reported.
+ *
+ * Also measures the speed of spilling and reading back full HD buffers, and
+ * verifies no memory is leaked.
+ */
+
+/* To compile run (from this directory):
+ * gcc -O2 -D__LITTLE_ENDIAN__ -I../.. -I../../intern -I../../operations -I../../../blenkernel \
+ *     -I../../../blenlib -I../../../makesdna -I../../../render/extern/include \
+ *     -I../../../../../intern/opencl -I../../../../../intern/guardedalloc -I../../../../../intern/atomic \
+ *     memorybudgetbench.cpp ../../intern/COM_MemoryBudget.cpp ../../intern/COM_MemoryProxy.cpp \
+ *     ../../intern/COM_MemoryBuffer.cpp -x c ../../../blenlib/intern/rct.c ../../../blenlib/intern/threads.c \
+ *     ../../../blenlib/intern/task.c ../../../blenlib/intern/gsqueue.c ../../../blenlib/intern/string.c \
+ *     ../../../blenlib/intern/BLI_dynstr.c ../../../blenlib/intern/listbase.c ../../../blenlib/intern/time.c \
+ *     ../../../../../intern/guardedalloc/intern/mallocn*.c -x none -lstdc++ -lpthread -lm -o memorybudgetbench
+ *
+ * Usage: memorybudgetbench [num_buffers]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <set>
+
+#include <unistd.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "COM_MemoryBudget.h"
+#include "COM_MemoryBuffer.h"
+#include "COM_MemoryProxy.h"
+
+extern "C" {
+#  include "BLI_fileops.h"
+#  include "BLI_path_util.h"
+#  include "BLI_string.h"
+#  include "PIL_time.h"
+}
+
+#define SIZE 256
+
+/* the file functions of blenlib need most of blenlib, the temporary directory is set up
+ * from the user preferences at startup. Use the C library and the system temporary directory */
+extern "C" {
+const char *BLI_temporary_dir(void)
+{
+	return "/tmp/";
+}
+
+FILE *BLI_fopen(const char *filename, const char *mode)
+{
+	return fopen(filename, mode);
+}
+
+int BLI_delete(const char *file, bool UNUSED(dir), bool UNUSED(recursive))
+{
+	return remove(file);
+}
+}
+
+/* the budget only asks the readers of a buffer if they are done, which is decided here */
+static std::set<const ExecutionGroup *> finished_groups;
+
+bool ExecutionGroup::isFullyExecuted() const
+{
+	return finished_groups.find(this) != finished_groups.end();
+}
+
+/* stand ins for ExecutionGroups, only their address is used */
+static char group_storage[2];
+#define GROUP_1 ((ExecutionGroup *)&group_storage[0])
+#define GROUP_2 ((ExecutionGroup *)&group_storage[1])
+
+static int error_status = 0;
+
+#define CHECK(cond, msg) \
+	if (!(cond)) { \
+		fprintf(stderr, "|--* %s\n", msg); \
+		error_status = 1; \
+	} (void)0
+
+static MemoryProxy *proxy_new(MemoryBudget *budget, int size)
+{
+	MemoryProxy *memoryProxy = new MemoryProxy();
+	budget->addMemoryProxy(memoryProxy);
+	memoryProxy->allocate(size, size);
+	return memoryProxy;
+}
+
+static void proxy_free(MemoryProxy *memoryProxy)
+{
+	memoryProxy->free();
+	delete memoryProxy;
+}
+
+/* write a pattern that depends on the seed, like a chunk of the ExecutionGroup that writes the buffer */
+static void proxy_write(MemoryProxy *memoryProxy, int seed)
+{
+	MemoryBuffer *buffer = memoryProxy->getBuffer();
+	const int size = buffer->getWidth();
+
+	memoryProxy->acquire(true);
+	for (int y = 0; y < size; y++) {
+		for (int x = 0; x < size; x++) {
+			const float color[4] = {(float)seed, (float)x, (float)y, (float)(x * y)};
+			buffer->writePixel(x, y, color);
+		}
+	}
+	memoryProxy->release();
+}
+
+/* read the buffer back and compare it with the pattern */
+static bool proxy_read(MemoryProxy *memoryProxy, int seed)
+{
+	MemoryBuffer *buffer = memoryProxy->getBuffer();
+	const int size = buffer->getWidth();
+	bool ok = memoryProxy->acquire(false);
+
+	for (int y = 0; y < size && ok; y++) {
+		for (int x = 0; x < size && ok; x++) {
+			float color[4];
+			buffer->read(color, x, y);
+			ok = (color[0] == seed && color[1] == x && color[2] == y && color[3] == x * y);
+		}
+	}
+	memoryProxy->release();
+	return ok;
+}
+
+static void test_spill()
+{
+	const size_t bufferSize = SIZE * SIZE * COM_NUMBER_OF_CHANNELS * sizeof(float);
+	MemoryBudget *budget = new MemoryBudget(2 * bufferSize);
+	MemoryProxy *a = proxy_new(budget, SIZE);
+	MemoryProxy *b = proxy_new(budget, SIZE);
+	MemoryProxy *c = proxy_new(budget, SIZE);
+	MemoryProxy *d = proxy_new(budget, SIZE);
+	MemoryProxy *e = proxy_new(budget, SIZE);
+
+	budget->initExecution();
+	budget->addReader(a, GROUP_1);
+	budget->addReader(b, GROUP_1);
+	budget->addReader(a, GROUP_2);
+	budget->addReader(c, GROUP_2);
+	budget->addReader(d, GROUP_2);
+	budget->addReader(e, GROUP_2);
+
+	CHECK(!a->getBuffer()->isResident(), "buffer with a budget is allocated before it is used");
+
+	/* the third buffer does not fit, the least recently used is spilled */
+	proxy_write(a, 1);
+	proxy_write(b, 2);
+	proxy_write(c, 3);
+	CHECK(!a->getBuffer()->isResident() && b->getBuffer()->isResident() && c->getBuffer()->isResident(),
+	      "least recently used buffer is not evicted");
+	CHECK(budget->getBytesWritten() == bufferSize, "evicted buffer is not spilled");
+
+	/* reading the spilled buffers back spills the others */
+	CHECK(proxy_read(a, 1), "spilled buffer a reads back wrong");
+	CHECK(proxy_read(c, 3), "buffer c reads back wrong");
+	CHECK(proxy_read(b, 2), "spilled buffer b reads back wrong");
+	CHECK(budget->getBytesRead() == 2 * bufferSize, "spilled buffers are not read back");
+
+	/* buffers that are not read anymore are thrown away before needed ones are spilled */
+	finished_groups.insert(GROUP_1);
+	proxy_write(d, 4);
+	CHECK(b->isDiscarded() && !b->getBuffer()->isResident(), "buffer without readers is not discarded");
+	CHECK(!a->isDiscarded() && !c->isDiscarded(), "buffer with readers is discarded");
+	CHECK(budget->getBytesWritten() == 2 * bufferSize, "discarded buffer is spilled");
+
+	/* the ResultCache keeps buffers after their readers are done */
+	finished_groups.insert(GROUP_2);
+	a->setKeepContent(true);
+	CHECK(proxy_read(a, 1), "kept buffer reads back wrong");
+	CHECK(c->isDiscarded(), "buffer without readers is not discarded");
+	proxy_write(a, 6);
+
+	/* with e in use, only the kept buffer can make room, it has to be spilled */
+	e->acquire(true);
+	CHECK(d->isDiscarded() && !a->isDiscarded(), "kept buffer is discarded");
+	proxy_write(b, 7);
+	e->release();
+	CHECK(!a->getBuffer()->isResident() && !a->isDiscarded() && budget->getBytesWritten() == 3 * bufferSize,
+	      "kept buffer is not spilled");
+	CHECK(!b->isDiscarded(), "written buffer is still discarded");
+	CHECK(proxy_read(a, 6), "kept buffer reads back wrong after spilling");
+	a->setKeepContent(false);
+
+	CHECK(!budget->hasFailed(), "budget failed");
+
+	delete budget;
+	proxy_free(a);
+	proxy_free(b);
+	proxy_free(c);
+	proxy_free(d);
+	proxy_free(e);
+}
+
+/* the spill file is removed by the budget, find it by its name to truncate it */
+static void spill_file_path(char *path, size_t maxlen, MemoryBudget *budget)
+{
+	BLI_snprintf(path, maxlen, "%sblender_compositor_%d_%p.spill", BLI_temporary_dir(), abs(getpid()), (void *)budget);
+}
+
+static void test_read_failure()
+{
+	const size_t bufferSize = SIZE * SIZE * COM_NUMBER_OF_CHANNELS * sizeof(float);
+	MemoryBudget *budget = new MemoryBudget(bufferSize);
+	MemoryProxy *a = proxy_new(budget, SIZE);
+	MemoryProxy *b = proxy_new(budget, SIZE);
+	char path[FILE_MAX];
+
+	budget->initExecution();
+	budget->addReader(a, GROUP_1);
+	budget->addReader(b, GROUP_1);
+	finished_groups.clear();
+
+	proxy_write(a, 1);
+	proxy_write(b, 2);
+	CHECK(budget->getBytesWritten() == bufferSize, "evicted buffer is not spilled");
+
+	spill_file_path(path, sizeof(path), budget);
+	CHECK(truncate(path, 0) == 0, "can't truncate the spill file");
+
+	/* b is in use, so a is read back without writing b to the file first */
+	b->acquire(false);
+	CHECK(!a->acquire(false), "reading a truncated spill file succeeds");
+	a->release();
+	b->release();
+	CHECK(budget->hasFailed() && budget->getErrorMessage()[0], "failed read is not reported");
+
+	delete budget;
+	CHECK(access(path, F_OK) != 0, "spill file is not removed");
+
+	proxy_free(a);
+	proxy_free(b);
+}
+
+/* spill and read back full HD buffers through a budget of two buffers */
+static void bench_spill(int num_buffers)
+{
+	const int width = 1920, height = 1080;
+	MemoryBudget *budget;
+	MemoryProxy **proxies = (MemoryProxy **)MEM_mallocN(sizeof(MemoryProxy *) * num_buffers, __func__);
+	size_t bufferSize;
+	double t_write, t_read, t;
+	rcti rect;
+	int i;
+
+	BLI_rcti_init(&rect, 0, width, 0, height);
+	bufferSize = (size_t)width * height * COM_NUMBER_OF_CHANNELS * sizeof(float);
+	budget = new MemoryBudget(2 * bufferSize);
+
+	for (i = 0; i < num_buffers; i++) {
+		proxies[i] = new MemoryProxy();
+		budget->addMemoryProxy(proxies[i]);
+		proxies[i]->allocate(width, height);
+		budget->addReader(proxies[i], GROUP_1);
+	}
+	budget->initExecution();
+	finished_groups.clear();
+
+	t = PIL_check_seconds_timer();
+	for (i = 0; i < num_buffers; i++) {
+		proxies[i]->acquire(true);
+		memset(proxies[i]->getBuffer()->getStorage(), i, bufferSize);
+		proxies[i]->release();
+	}
+	t_write = PIL_check_seconds_timer() - t;
+
+	t = PIL_check_seconds_timer();
+	for (i = 0; i < num_buffers; i++) {
+		proxies[i]->acquire(false);
+		proxies[i]->release();
+	}
+	t_read = PIL_check_seconds_timer() - t;
+
+	printf("%d buffers of %dx%d, budget of 2 buffers:\n", num_buffers, width, height);
+	printf("  write all %.3fs, read all %.3fs, %.1f MB written, %.1f MB read\n", t_write, t_read,
+	       budget->getBytesWritten() / (1024.0 * 1024.0), budget->getBytesRead() / (1024.0 * 1024.0));
+	CHECK(!budget->hasFailed(), "budget failed");
+
+	delete budget;
+	for (i = 0; i < num_buffers; i++) {
+		proxy_free(proxies[i]);
+	}
+	MEM_freeN(proxies);
+}
+
+int main(int argc, char *argv[])
+{
+	const int num_buffers = (argc > 1) ? atoi(argv[1]) : 8;
+
+	test_spill();
+	test_read_failure();
+	bench_spill(num_buffers);
+
+	if (MEM_get_memory_blocks_in_use() != 0) {
+		fprintf(stderr, "|--* Memory blocks not freed\n");
+		error_status = 1;
+	}
+
+	return error_status;
+}
@@ -0,0 +1,571 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/**
+ * Compare the row based execution of non complex operations (readRow) with
+ * calculating them a pixel at a time (readSampled).
+ *
+ * Every operation with its own executeRow reads buffers with random colors
+ * and values. Its rows must equal the result of executePixelSampled for
+ * every pixel, and both are timed.
+ *
+ * Then a tree like Render Layers -> Color Balance -> Mix -> Composite is
+ * executed chunk by chunk with CompositorOperation.executeRegion, and
+ * compared with reading its inputs a pixel at a time the way the output
+ * operations did before they used readRow. Viewer, Preview and File Output
+ * use the same loop and are not linked here, they need the image and window
+ * manager modules.
+ *
+ * Also verifies that no memory is leaked.
+ */
+
+/* To compile run (from this directory):
+ * gcc -O2 -DNDEBUG -D__LITTLE_ENDIAN__ -D__BLI_STRICT_FLAGS_H__ -I../.. -I../../intern -I../../operations \
+ *     -I../../../blenkernel -I../../../blenlib -I../../../makesdna -I../../../makesrna -I../../../makesrna/intern \
+ *     -I../../../render/extern/include -I../../../render/intern/include -I../../../imbuf \
+ *     -I../../../../../intern/opencl -I../../../../../intern/guardedalloc -I../../../../../intern/atomic \
+ *     rowbench.cpp ../../intern/COM_NodeOperation.cpp ../../intern/COM_NodeBase.cpp ../../intern/COM_Socket.cpp \
+ *     ../../intern/COM_InputSocket.cpp ../../intern/COM_OutputSocket.cpp ../../intern/COM_SocketConnection.cpp \
+ *     ../../intern/COM_SocketReader.cpp ../../intern/COM_MemoryBuffer.cpp ../../intern/COM_MemoryProxy.cpp \
+ *     ../../intern/COM_MemoryBudget.cpp ../../operations/COM_ReadBufferOperation.cpp \
+ *     ../../operations/COM_MixOperation.cpp ../../operations/COM_AlphaOver*Operation.cpp \
+ *     ../../operations/COM_ConvertOperation.cpp ../../operations/COM_MathBaseOperation.cpp \
+ *     ../../operations/COM_ColorBalance*Operation.cpp ../../operations/COM_CompositorOperation.cpp \
+ *     -x c ../../../blenlib/intern/rct.c ../../../blenlib/intern/threads.c ../../../blenlib/intern/task.c \
+ *     ../../../blenlib/intern/gsqueue.c ../../../blenlib/intern/listbase.c ../../../blenlib/intern/string.c \
+ *     ../../../blenlib/intern/BLI_dynstr.c ../../../blenlib/intern/math_base.c ../../../blenlib/intern/math_color.c \
+ *     ../../../blenlib/intern/time.c ../../../../../intern/guardedalloc/intern/mallocn*.c -x none \
+ *     -lstdc++ -lpthread -lm -o rowbench
+ *
+ * Usage: rowbench [width height]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "COM_AlphaOverKeyOperation.h"
+#include "COM_AlphaOverMixedOperation.h"
+#include "COM_AlphaOverPremultiplyOperation.h"
+#include "COM_ColorBalanceASCCDLOperation.h"
+#include "COM_ColorBalanceLGGOperation.h"
+#include "COM_CompositorOperation.h"
+#include "COM_ConvertOperation.h"
+#include "COM_ExecutionGroup.h"
+#include "COM_ExecutionSystem.h"
+#include "COM_MathBaseOperation.h"
+#include "COM_MemoryProxy.h"
+#include "COM_MixOperation.h"
+#include "COM_Node.h"
+#include "COM_ReadBufferOperation.h"
+#include "COM_SocketConnection.h"
+
+extern "C" {
+#  include "BLI_fileops.h"
+#  include "BLI_math_base.h"
+#  include "BLI_path_util.h"
+#  include "BKE_image.h"
+#  include "DNA_node_types.h"
+#  include "RE_pipeline.h"
+#  include "RNA_access.h"
+#  include "rna_internal_types.h"
+#  include "PIL_time.h"
+}
+
+/* chunk size of the tree, the default of the node editor */
+#define CHUNK_SIZE 256
+
+/* inputs of the operations, read from buffers like the outputs of complex operations */
+typedef struct BenchInputs {
+	MemoryProxy proxies[3];
+	ReadBufferOperation reads[3];
+	/* a value in the first channel, colors with alpha */
+	ReadBufferOperation *value, *color1, *color2;
+} BenchInputs;
+
+static int test_break(void *UNUSED(handle))
+{
+	return 0;
+}
+
+static bNodeTree bench_tree;
+
+/* reproducible random numbers in [0, 1) */
+static float random_float(unsigned int *seed)
+{
+	*seed = *seed * 1103515245u + 12345u;
+	return (float)((*seed >> 8) & 0xffffff) / (float)(1 << 24);
+}
+
+static void inputs_init(BenchInputs *inputs, int width, int height)
+{
+	unsigned int resolution[2] = {(unsigned int)width, (unsigned int)height};
+	float *row = (float *)MEM_mallocN(sizeof(float) * COM_NUMBER_OF_CHANNELS * width, __func__);
+	unsigned int seed = 1;
+
+	for (int index = 0; index < 3; index++) {
+		MemoryProxy *proxy = &inputs->proxies[index];
+		ReadBufferOperation *read = &inputs->reads[index];
+
+		proxy->allocate(width, height);
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				float *color = &row[x * COM_NUMBER_OF_CHANNELS];
+				/* colors out of the [0, 1] range for the clamping, exact zeros and ones for divisions */
+				for (int c = 0; c < 3; c++) {
+					color[c] = random_float(&seed) * 1.5f - 0.25f;
+				}
+				color[3] = random_float(&seed);
+				if ((x + y) % 7 == 0) {
+					color[0] = 0.0f;
+					color[3] = 0.0f;
+				}
+				else if ((x + y) % 11 == 0) {
+					color[0] = 1.0f;
+					color[3] = 1.0f;
+				}
+			}
+			proxy->getBuffer()->writeRow(row, 0, y, width);
+		}
+
+		read->setMemoryProxy(proxy);
+		read->setResolution(resolution);
+		read->updateMemoryBuffer();
+	}
+
+	inputs->value = &inputs->reads[0];
+	inputs->color1 = &inputs->reads[1];
+	inputs->color2 = &inputs->reads[2];
+
+	MEM_freeN(row);
+}
+
+static void inputs_free(BenchInputs *inputs)
+{
+	for (int index = 0; index < 3; index++) {
+		inputs->proxies[index].free();
+	}
+}
+
+/* connect like ExecutionSystemHelper.addLink */
+static void connect(vector<SocketConnection *>& connections, NodeOperation *from, NodeOperation *to, int index)
+{
+	SocketConnection *connection = new SocketConnection();
+	connection->setFromSocket(from->getOutputSocket());
+	connection->setToSocket(to->getInputSocket(index));
+	from->getOutputSocket()->addConnection(connection);
+	to->getInputSocket(index)->setConnection(connection);
+	connections.push_back(connection);
+}
+
+static void connections_free(vector<SocketConnection *>& connections)
+{
+	for (unsigned int index = 0; index < connections.size(); index++) {
+		delete connections[index];
+	}
+	connections.clear();
+}
+
+static int datatype_channels(DataType datatype)
+{
+	switch (datatype) {
+		case COM_DT_VALUE:
+			return 1;
+		case COM_DT_VECTOR:
+			return 3;
+		default:
+			return COM_NUMBER_OF_CHANNELS;
+	}
+}
+
+static bool same_value(float a, float b)
+{
+	return (a == b) || (isnan(a) && isnan(b));
+}
+
+/* rows and pixels of the whole image must be the same, returns the number of different channels */
+static int check_operation(const char *name, NodeOperation *operation, BenchInputs *inputs, int width, int height)
+{
+	vector<SocketConnection *> connections;
+	const int num_inputs = operation->getNumberOfInputSockets();
+	ReadBufferOperation *sources[3] = {inputs->value, inputs->color1, inputs->color2};
+	unsigned int resolution[2] = {(unsigned int)width, (unsigned int)height};
+	float *row_image = (float *)MEM_callocN(sizeof(float) * COM_NUMBER_OF_CHANNELS * width * height, "rows");
+	float *pixel_image = (float *)MEM_callocN(sizeof(float) * COM_NUMBER_OF_CHANNELS * width * height, "pixels");
+	int channels = datatype_channels(operation->getOutputSocket()->getDataType());
+	double t_pixel, t_row;
+	int num_different = 0;
+
+	/* operations with a single input read colors, the others take the value first */
+	for (int index = 0; index < num_inputs; index++) {
+		connect(connections, (num_inputs == 1) ? inputs->color1 : sources[index], operation, index);
+	}
+	operation->setbNodeTree(&bench_tree);
+	operation->setResolution(resolution);
+	operation->initExecution();
+
+	t_pixel = PIL_check_seconds_timer();
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			operation->readSampled(&pixel_image[(y * width + x) * COM_NUMBER_OF_CHANNELS], x, y, COM_PS_NEAREST);
+		}
+	}
+	t_pixel = PIL_check_seconds_timer() - t_pixel;
+
+	t_row = PIL_check_seconds_timer();
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x += COM_ROW_SIZE) {
+			operation->readRow(&row_image[(y * width + x) * COM_NUMBER_OF_CHANNELS], x, y, min_ii(COM_ROW_SIZE, width - x));
+		}
+	}
+	t_row = PIL_check_seconds_timer() - t_row;
+
+	for (int index = 0; index < width * height; index++) {
+		for (int c = 0; c < channels; c++) {
+			if (!same_value(row_image[index * COM_NUMBER_OF_CHANNELS + c], pixel_image[index * COM_NUMBER_OF_CHANNELS + c])) {
+				num_different++;
+			}
+		}
+	}
+
+	printf("  %-30s pixels %6.1f Mpixel/s, rows %6.1f Mpixel/s, %4.2fx, %d different\n", name,
+	       width * height / t_pixel * 1e-6, width * height / t_row * 1e-6, t_pixel / t_row, num_different);
+
+	if (num_different) {
+		fprintf(stderr, "|--* %s rows don't match executePixelSampled\n", name);
+	}
+
+	operation->deinitExecution();
+	connections_free(connections);
+	MEM_freeN(row_image);
+	MEM_freeN(pixel_image);
+	delete operation;
+
+	return num_different;
+}
+
+static int check_operations(BenchInputs *inputs, int width, int height)
+{
+	const float lift[3] = {0.9f, 1.0f, 1.1f}, gamma_inv[3] = {1.2f, 1.0f, 0.8f}, gain[3] = {1.1f, 0.9f, 1.0f};
+	float offset[3] = {0.05f, 0.0f, -0.05f}, power[3] = {1.1f, 1.0f, 0.9f}, slope[3] = {0.9f, 1.0f, 1.2f};
+	MixBaseOperation *mix[2][8];
+	MathBaseOperation *math[2][6];
+	int num_different = 0;
+
+	printf("operations, %dx%d:\n", width, height);
+
+	for (int clamp = 0; clamp < 2; clamp++) {
+		mix[clamp][0] = new MixAddOperation();
+		mix[clamp][1] = new MixBlendOperation();
+		mix[clamp][2] = new MixDarkenOperation();
+		mix[clamp][3] = new MixDifferenceOperation();
+		mix[clamp][4] = new MixLightenOperation();
+		mix[clamp][5] = new MixMultiplyOperation();
+		mix[clamp][6] = new MixScreenOperation();
+		mix[clamp][7] = new MixSubtractOperation();
+		for (int index = 0; index < 8; index++) {
+			mix[clamp][index]->setUseClamp(clamp);
+			mix[clamp][index]->setUseValueAlphaMultiply(clamp);
+		}
+
+		math[clamp][0] = new MathAddOperation();
+		math[clamp][1] = new MathSubtractOperation();
+		math[clamp][2] = new MathMultiplyOperation();
+		math[clamp][3] = new MathDivideOperation();
+		math[clamp][4] = new MathMinimumOperation();
+		math[clamp][5] = new MathMaximumOperation();
+		for (int index = 0; index < 6; index++) {
+			math[clamp][index]->setUseClamp(clamp);
+		}
+	}
+
+	static const char *mix_names[8] = {"Add", "Blend", "Darken", "Difference", "Lighten", "Multiply", "Screen", "Subtract"};
+	static const char *math_names[6] = {"Add", "Subtract", "Multiply", "Divide", "Minimum", "Maximum"};
+	char name[64];
+
+	for (int clamp = 0; clamp < 2; clamp++) {
+		for (int index = 0; index < 8; index++) {
+			sprintf(name, "Mix %s%s", mix_names[index], clamp ? " (clamp, alpha)" : "");
+			num_different += check_operation(name, mix[clamp][index], inputs, width, height);
+		}
+	}
+	for (int clamp = 0; clamp < 2; clamp++) {
+		for (int index = 0; index < 6; index++) {
+			sprintf(name, "Math %s%s", math_names[index], clamp ? " (clamp)" : "");
+			num_different += check_operation(name, math[clamp][index], inputs, width, height);
+		}
+	}
+
+	num_different += check_operation("Alpha Over Key", new AlphaOverKeyOperation(), inputs, width, height);
+	AlphaOverMixedOperation *alpha_over_mixed = new AlphaOverMixedOperation();
+	alpha_over_mixed->setX(0.5f);
+	num_different += check_operation("Alpha Over Mixed", alpha_over_mixed, inputs, width, height);
+	num_different += check_operation("Alpha Over Premultiply", new AlphaOverPremultiplyOperation(), inputs, width, height);
+
+	num_different += check_operation("Convert Value To Color", new ConvertValueToColorOperation(), inputs, width, height);
+	num_different += check_operation("Convert Color To Value", new ConvertColorToValueOperation(), inputs, width, height);
+	num_different += check_operation("Convert Color To BW", new ConvertColorToBWOperation(), inputs, width, height);
+	num_different += check_operation("Convert Color To Vector", new ConvertColorToVectorOperation(), inputs, width, height);
+	num_different += check_operation("Convert Value To Vector", new ConvertValueToVectorOperation(), inputs, width, height);
+	num_different += check_operation("Convert Vector To Color", new ConvertVectorToColorOperation(), inputs, width, height);
+	num_different += check_operation("Convert Vector To Value", new ConvertVectorToValueOperation(), inputs, width, height);
+	num_different += check_operation("Convert Premul To Straight", new ConvertPremulToStraightOperation(), inputs, width, height);
+	num_different += check_operation("Convert Straight To Premul", new ConvertStraightToPremulOperation(), inputs, width, height);
+
+	ColorBalanceLGGOperation *lgg = new ColorBalanceLGGOperation();
+	lgg->setLift(lift);
+	lgg->setGammaInv(gamma_inv);
+	lgg->setGain(gain);
+	num_different += check_operation("Color Balance LGG", lgg, inputs, width, height);
+	ColorBalanceASCCDLOperation *asccdl = new ColorBalanceASCCDLOperation();
+	asccdl->setOffset(offset);
+	asccdl->setPower(power);
+	asccdl->setSlope(slope);
+	num_different += check_operation("Color Balance ASC CDL", asccdl, inputs, width, height);
+
+	return num_different;
+}
+
+/* the composite result, handed over by CompositorOperation.deinitExecution */
+static RenderResult bench_result;
+
+/* Image -> Mix Multiply -> Composite, with Color Balance after the image when
+ * use_balance is set. The value buffer is the mix factor, alpha and Z.
+ * returns the number of different channels */
+static int check_tree(BenchInputs *inputs, int width, int height, bool use_balance)
+{
+	const float lift[3] = {0.9f, 1.0f, 1.1f}, gamma_inv[3] = {1.2f, 1.0f, 0.8f}, gain[3] = {1.1f, 0.9f, 1.0f};
+	vector<SocketConnection *> connections;
+	unsigned int resolution[2] = {(unsigned int)width, (unsigned int)height};
+	ColorBalanceLGGOperation balance;
+	MixMultiplyOperation mix;
+	CompositorOperation composite;
+	float *pixel_image = (float *)MEM_mallocN(sizeof(float) * COM_NUMBER_OF_CHANNELS * width * height, "pixels");
+	float *pixel_depth = (float *)MEM_mallocN(sizeof(float) * width * height, "pixel depth");
+	float color[4], value[4];
+	double t_pixel, t_row;
+	int num_different = 0;
+
+	balance.setLift(lift);
+	balance.setGammaInv(gamma_inv);
+	balance.setGain(gain);
+	connect(connections, inputs->value, &balance, 0);
+	connect(connections, inputs->color1, &balance, 1);
+	connect(connections, inputs->value, &mix, 0);
+	connect(connections, use_balance ? (NodeOperation *)&balance : inputs->color1, &mix, 1);
+	connect(connections, inputs->color2, &mix, 2);
+	connect(connections, &mix, &composite, 0);
+	connect(connections, inputs->value, &composite, 1);
+	connect(connections, inputs->value, &composite, 2);
+
+	NodeOperation *operations[3] = {&balance, &mix, &composite};
+	for (int index = 0; index < 3; index++) {
+		operations[index]->setbNodeTree(&bench_tree);
+		operations[index]->setResolution(resolution);
+	}
+	composite.setActive(true);
+	for (int index = 0; index < 3; index++) {
+		operations[index]->initExecution();
+	}
+
+	/* the output operations before they used readRow */
+	t_pixel = PIL_check_seconds_timer();
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			int offset = y * width + x;
+			mix.readSampled(color, x, y, COM_PS_NEAREST);
+			inputs->value->readSampled(&color[3], x, y, COM_PS_NEAREST);
+			copy_v4_v4(&pixel_image[offset * COM_NUMBER_OF_CHANNELS], color);
+			inputs->value->readSampled(value, x, y, COM_PS_NEAREST);
+			pixel_depth[offset] = value[0];
+		}
+	}
+	t_pixel = PIL_check_seconds_timer() - t_pixel;
+
+	t_row = PIL_check_seconds_timer();
+	for (int y = 0; y < height; y += CHUNK_SIZE) {
+		for (int x = 0; x < width; x += CHUNK_SIZE) {
+			rcti rect;
+			BLI_rcti_init(&rect, x, min_ii(x + CHUNK_SIZE, width), y, min_ii(y + CHUNK_SIZE, height));
+			composite.executeRegion(&rect, 0);
+		}
+	}
+	t_row = PIL_check_seconds_timer() - t_row;
+
+	for (int index = 0; index < 3; index++) {
+		operations[index]->deinitExecution();
+	}
+
+	for (int index = 0; index < width * height; index++) {
+		for (int c = 0; c < COM_NUMBER_OF_CHANNELS; c++) {
+			if (!same_value(bench_result.rectf[index * COM_NUMBER_OF_CHANNELS + c], pixel_image[index * COM_NUMBER_OF_CHANNELS + c])) {
+				num_different++;
+			}
+		}
+		if (!same_value(bench_result.rectz[index], pixel_depth[index])) {
+			num_different++;
+		}
+	}
+
+	printf("  %-30s pixels %.3fs, rows %.3fs, %4.2fx, %d different\n",
+	       use_balance ? "Color Balance, Mix" : "Mix", t_pixel, t_row, t_pixel / t_row, num_different);
+
+	if (num_different) {
+		fprintf(stderr, "|--* Composite rows don't match reading pixels\n");
+	}
+
+	connections_free(connections);
+	MEM_freeN(bench_result.rectf);
+	MEM_freeN(bench_result.rectz);
+	bench_result.rectf = NULL;
+	bench_result.rectz = NULL;
+	MEM_freeN(pixel_image);
+	MEM_freeN(pixel_depth);
+
+	return num_different;
+}
+
+int main(int argc, char *argv[])
+{
+	const int width = (argc > 2) ? atoi(argv[1]) : 1920;
+	const int height = (argc > 2) ? atoi(argv[2]) : 1080;
+	BenchInputs *inputs = new BenchInputs();
+	int error_status = 0;
+
+	bench_tree.test_break = test_break;
+
+	inputs_init(inputs, width, height);
+
+	if (check_operations(inputs, width, height) != 0) {
+		error_status = 1;
+	}
+	printf("Composite, %dx%d:\n", width, height);
+	if (check_tree(inputs, width, height, false) != 0 ||
+	    check_tree(inputs, width, height, true) != 0)
+	{
+		error_status = 1;
+	}
+
+	inputs_free(inputs);
+	delete inputs;
+
+	if (MEM_get_memory_blocks_in_use() != 0) {
+		fprintf(stderr, "|--* Memory blocks not freed\n");
+		error_status = 1;
+	}
+
+	return error_status;
+}
+
+/* The operations reference the render, image and RNA modules, the
+ * ExecutionSystem and the MemoryBudget. Only the render result is used
+ * here, to receive the composite, the rest is not reached. */
+
+extern "C" {
+
+const char *BLI_temporary_dir(void)
+{
+	return "/tmp/";
+}
+
+FILE *BLI_fopen(const char *filename, const char *mode)
+{
+	return fopen(filename, mode);
+}
+
+int BLI_delete(const char *file, bool UNUSED(dir), bool UNUSED(recursive))
+{
+	return remove(file);
+}
+
+StructRNA RNA_NodeSocket;
+
+Render *RE_GetRender(const char *UNUSED(name))
+{
+	return NULL;
+}
+
+RenderResult *RE_AcquireResultRead(Render *UNUSED(re))
+{
+	return NULL;
+}
+
+RenderResult *RE_AcquireResultWrite(Render *UNUSED(re))
+{
+	return &bench_result;
+}
+
+void RE_ReleaseResult(Render *UNUSED(re))
+{
+}
+
+void BKE_image_signal(Image *UNUSED(ima), ImageUser *UNUSED(iuser), int UNUSED(signal))
+{
+}
+
+Image *BKE_image_verify_viewer(int UNUSED(type), const char *UNUSED(name))
+{
+	return NULL;
+}
+
+void RNA_pointer_create(ID *UNUSED(id), StructRNA *UNUSED(type), void *UNUSED(data), PointerRNA *UNUSED(r_ptr))
+{
+}
+
+float RNA_float_get(PointerRNA *UNUSED(ptr), const char *UNUSED(name))
+{
+	return 0.0f;
+}
+
+void RNA_float_get_array(PointerRNA *UNUSED(ptr), const char *UNUSED(name), float *UNUSED(values))
+{
+}
+
+}
+
+bool ExecutionGroup::isFullyExecuted() const
+{
+	return false;
+}
+
+void ExecutionSystem::addSocketConnection(SocketConnection *UNUSED(connection))
+{
+}
+
+void ExecutionSystem::removeSocketConnection(SocketConnection *UNUSED(connection))
+{
+}
+
+void Node::addSetValueOperation(ExecutionSystem *UNUSED(graph), InputSocket *UNUSED(inputsocket),
+                                int UNUSED(editorNodeInputSocketIndex))
+{
+}
+
+void Node::addSetColorOperation(ExecutionSystem *UNUSED(graph), InputSocket *UNUSED(inputsocket),
+                                int UNUSED(editorNodeInputSocketIndex))
+{
+}
+
+void Node::addSetVectorOperation(ExecutionSystem *UNUSED(graph), InputSocket *UNUSED(inputsocket),
+                                 int UNUSED(editorNodeInputSocketIndex))
+{
+}
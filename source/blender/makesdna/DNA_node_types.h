@@ -343,7 +343,7 @@ typedef struct bNodeTree {
 	int update;						/* update flags */
 	short is_updating;				/* flag to prevent reentrant update calls */
 	short done;						/* generic temporary flag for recursion check (DFS/BFS) */
-	int pad2;
+	int memory_budget;				/* compositor memory budget for intermediate buffers in MB, 0 is unlimited */
 	
 	int nodetype DNA_DEPRECATED;	/* specific node type this tree is used for */
 
@@ -403,6 +403,7 @@ typedef struct bNodeTree {
 #define NTREE_COM_GROUPNODE_BUFFER	8	/* use groupnode buffers */
 #define NTREE_VIEWER_BORDER			16	/* use a border for viewer nodes */
 #define NTREE_IS_LOCALIZED			32	/* tree is localized copy, free when deleting node groups */
+#define NTREE_COM_HALF_FLOAT_BUFFER	64	/* store intermediate color buffers as half floats */
 
 /* XXX not nice, but needed as a temporary flags
  * for group updates after library linking.
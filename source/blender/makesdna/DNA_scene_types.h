@@ -240,6 +240,7 @@ typedef struct SceneRenderLayer {
 #define SCE_PASS_SUBSURFACE_DIRECT		(1<<28)
 #define SCE_PASS_SUBSURFACE_INDIRECT	(1<<29)
 #define SCE_PASS_SUBSURFACE_COLOR		(1<<30)
+#define SCE_PASS_SAMPLE_COUNT			(1<<31)
 
 /* note, srl->passflag is treestore element 'nr' in outliner, short still... */
 
@@ -7610,6 +7610,20 @@ static void rna_def_composite_nodetree(BlenderRNA *brna)
 	RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_COM_GROUPNODE_BUFFER);
 	RNA_def_property_ui_text(prop, "Buffer Groups", "Enable buffering of group nodes");
 
+	prop = RNA_def_property(srna, "use_half_float_buffer", PROP_BOOLEAN, PROP_NONE);
+	RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_COM_HALF_FLOAT_BUFFER);
+	RNA_def_property_ui_text(prop, "Half Float Buffers", "Store intermediate color results as half floats, "
+	                                                     "uses less memory at the cost of precision (results that are "
+	                                                     "read by filter nodes like blur and defocus keep full floats)");
+
+	prop = RNA_def_property(srna, "memory_budget", PROP_INT, PROP_NONE);
+	RNA_def_property_int_sdna(prop, NULL, "memory_budget");
+	RNA_def_property_range(prop, 0, INT_MAX);
+	RNA_def_property_ui_range(prop, 0, 1048576, 256, -1);
+	RNA_def_property_ui_text(prop, "Memory Budget", "Maximum memory in MB used by intermediate buffers, "
+	                                                "buffers that don't fit are written to a temporary file "
+	                                                "(0 for unlimited)");
+
 	prop = RNA_def_property(srna, "use_two_pass", PROP_BOOLEAN, PROP_NONE);
 	RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_TWO_PASS);
 	RNA_def_property_ui_text(prop, "Two Pass", "Use two pass execution during editing: first calculate fast nodes, "
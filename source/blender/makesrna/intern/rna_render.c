@@ -618,6 +618,7 @@ static void rna_def_render_pass(BlenderRNA *brna)
 		{SCE_PASS_SUBSURFACE_DIRECT, "SUBSURFACE_DIRECT", 0, "Subsurface Direct", ""},
 		{SCE_PASS_SUBSURFACE_INDIRECT, "SUBSURFACE_INDIRECT", 0, "Subsurface Indirect", ""},
 		{SCE_PASS_SUBSURFACE_COLOR, "SUBSURFACE_COLOR", 0, "Subsurface Color", ""},
+		{SCE_PASS_SAMPLE_COUNT, "SAMPLE_COUNT", 0, "Sample Count", ""},
 		{0, NULL, 0, NULL, NULL}
 	};
 	
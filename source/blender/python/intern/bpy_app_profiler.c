@@ -0,0 +1,172 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file blender/python/intern/bpy_app_profiler.c
+ *  \ingroup pythonintern
+ *
+ * This file defines the 'bpy.app.profiler' module, giving access to the
+ * scene update timings recorded by BKE_profiler.
+ */
+
+#include <Python.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+
+#include "BKE_profiler.h"
+
+#include "bpy_app_profiler.h"
+
+PyDoc_STRVAR(bpy_app_profiler_enable_doc,
+".. function:: enable()\n"
+"\n"
+"   Start recording scene update timings.\n"
+);
+static PyObject *bpy_app_profiler_enable(PyObject *UNUSED(self))
+{
+	BKE_profiler_enable(true);
+	Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(bpy_app_profiler_disable_doc,
+".. function:: disable()\n"
+"\n"
+"   Stop recording scene update timings, recorded events are kept.\n"
+);
+static PyObject *bpy_app_profiler_disable(PyObject *UNUSED(self))
+{
+	BKE_profiler_enable(false);
+	Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(bpy_app_profiler_is_enabled_doc,
+".. function:: is_enabled()\n"
+"\n"
+"   :return: True when scene update timings are being recorded.\n"
+"   :rtype: boolean\n"
+);
+static PyObject *bpy_app_profiler_is_enabled(PyObject *UNUSED(self))
+{
+	return PyBool_FromLong(BKE_profiler_is_enabled());
+}
+
+PyDoc_STRVAR(bpy_app_profiler_clear_doc,
+".. function:: clear()\n"
+"\n"
+"   Remove all recorded events.\n"
+);
+static PyObject *bpy_app_profiler_clear(PyObject *UNUSED(self))
+{
+	BKE_profiler_clear();
+	Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(bpy_app_profiler_events_doc,
+".. function:: events()\n"
+"\n"
+"   Return the recorded events, as dictionaries with the keys\n"
+"   ``name``, ``type`` (one of 'FRAME', 'TRANSFORM', 'GEOMETRY', 'POSE', 'MODIFIER',\n"
+"   'CACHE_HIT', 'CACHE_MISS'), ``frame``, ``thread``, ``start``, ``duration`` and ``wait``.\n"
+"   Times are in seconds.\n"
+"\n"
+"   :rtype: list of dicts\n"
+);
+static PyObject *bpy_app_profiler_events(PyObject *UNUSED(self))
+{
+	ProfileEvent *events;
+	PyObject *list;
+	int i, totevent;
+
+	events = BKE_profiler_events_copy(&totevent);
+	list = PyList_New(totevent);
+
+	for (i = 0; i < totevent; i++) {
+		const ProfileEvent *event = &events[i];
+
+		PyList_SET_ITEM(list, i, Py_BuildValue(
+		        "{s:s, s:s, s:i, s:i, s:d, s:d, s:d}",
+		        "name", event->name,
+		        "type", BKE_profiler_event_type_name((eProfileEventType)event->type),
+		        "frame", event->frame,
+		        "thread", event->thread_id,
+		        "start", event->start_time,
+		        "duration", event->duration,
+		        "wait", event->wait_time));
+	}
+
+	if (events) {
+		MEM_freeN(events);
+	}
+
+	return list;
+}
+
+PyDoc_STRVAR(bpy_app_profiler_write_trace_doc,
+".. function:: write_trace(filepath)\n"
+"\n"
+"   Write the recorded events as a Chrome trace, which can be loaded in chrome://tracing.\n"
+"\n"
+"   :arg filepath: The file to write.\n"
+"   :type filepath: string\n"
+);
+static PyObject *bpy_app_profiler_write_trace(PyObject *UNUSED(self), PyObject *args)
+{
+	const char *filepath;
+
+	if (!PyArg_ParseTuple(args, "s:bpy.app.profiler.write_trace", &filepath)) {
+		return NULL;
+	}
+
+	if (!BKE_profiler_write_trace(filepath)) {
+		PyErr_Format(PyExc_IOError, "bpy.app.profiler.write_trace: could not open %R for writing",
+		             PyTuple_GET_ITEM(args, 0));
+		return NULL;
+	}
+
+	Py_RETURN_NONE;
+}
+
+static PyMethodDef bpy_app_profiler_methods[] = {
+	{"enable", (PyCFunction)bpy_app_profiler_enable, METH_NOARGS, bpy_app_profiler_enable_doc},
+	{"disable", (PyCFunction)bpy_app_profiler_disable, METH_NOARGS, bpy_app_profiler_disable_doc},
+	{"is_enabled", (PyCFunction)bpy_app_profiler_is_enabled, METH_NOARGS, bpy_app_profiler_is_enabled_doc},
+	{"clear", (PyCFunction)bpy_app_profiler_clear, METH_NOARGS, bpy_app_profiler_clear_doc},
+	{"events", (PyCFunction)bpy_app_profiler_events, METH_NOARGS, bpy_app_profiler_events_doc},
+	{"write_trace", (PyCFunction)bpy_app_profiler_write_trace, METH_VARARGS, bpy_app_profiler_write_trace_doc},
+	{NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef bpy_app_profiler_module_def = {
+	PyModuleDef_HEAD_INIT,
+	"bpy.app.profiler",  /* m_name */
+	"Timings of object, modifier and point cache evaluation during frame changes.",  /* m_doc */
+	0,  /* m_size */
+	bpy_app_profiler_methods,  /* m_methods */
+	NULL,  /* m_reload */
+	NULL,  /* m_traverse */
+	NULL,  /* m_clear */
+	NULL,  /* m_free */
+};
+
+PyObject *BPY_app_profiler_module(void)
+{
+	return PyModule_Create(&bpy_app_profiler_module_def);
+}
@@ -298,6 +298,10 @@ static const char *get_pass_name(int passtype, int channel)
 		if (channel == 1) return "SubsurfaceCol.G";
 		return "SubsurfaceCol.B";
 	}
+	if (passtype == SCE_PASS_SAMPLE_COUNT) {
+		if (channel == -1) return "SampleCount";
+		return "SampleCount.X";
+	}
 	return "Unknown";
 }
 
@@ -397,6 +401,9 @@ static int passtype_from_name(const char *str)
 	if (strcmp(str, "SubsurfaceCol") == 0)
 		return SCE_PASS_SUBSURFACE_COLOR;
 
+	if (strcmp(str, "SampleCount") == 0)
+		return SCE_PASS_SAMPLE_COUNT;
+
 	return 0;
 }
 
@@ -574,6 +581,8 @@ RenderResult *render_result_new(Render *re, rcti *partrct, int crop, int savebuf
 			render_layer_add_pass(rr, rl, 3, SCE_PASS_SUBSURFACE_INDIRECT);
 		if (srl->passflag  & SCE_PASS_SUBSURFACE_COLOR)
 			render_layer_add_pass(rr, rl, 3, SCE_PASS_SUBSURFACE_COLOR);
+		if (srl->passflag  & SCE_PASS_SAMPLE_COUNT)
+			render_layer_add_pass(rr, rl, 1, SCE_PASS_SAMPLE_COUNT);
 	}
 	/* sss, previewrender and envmap don't do layers, so we make a default one */
 	if (BLI_listbase_is_empty(&rr->layers) && !(layername && layername[0])) {
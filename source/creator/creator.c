@@ -315,6 +315,7 @@ static int print_help(int UNUSED(argc), const char **UNUSED(argv), void *data)
 	BLI_argsPrintArgDoc(ba, "--debug-jobs");
 	BLI_argsPrintArgDoc(ba, "--debug-python");
 	BLI_argsPrintArgDoc(ba, "--debug-depsgraph");
+	BLI_argsPrintArgDoc(ba, "--debug-cycles");
 
 	BLI_argsPrintArgDoc(ba, "--debug-wm");
 	BLI_argsPrintArgDoc(ba, "--debug-all");
@@ -326,6 +327,7 @@ static int print_help(int UNUSED(argc), const char **UNUSED(argv), void *data)
 	printf("\n");
 	printf("Misc Options:\n");
 	BLI_argsPrintArgDoc(ba, "--factory-startup");
+	BLI_argsPrintArgDoc(ba, "--memory-cached");
 	printf("\n");
 	BLI_argsPrintArgDoc(ba, "--env-system-config");
 	BLI_argsPrintArgDoc(ba, "--env-system-datafiles");
@@ -458,6 +460,12 @@ static int debug_mode_memory(int UNUSED(argc), const char **UNUSED(argv), void *
 	return 0;
 }
 
+static int set_memory_cached(int UNUSED(argc), const char **UNUSED(argv), void *UNUSED(data))
+{
+	/* allocator is switched before any allocation, in main() */
+	return 0;
+}
+
 static int set_debug_value(int argc, const char **argv, void *UNUSED(data))
 {
 	if (argc > 1) {
@@ -1417,9 +1425,11 @@ static void setupArguments(bContext *C, bArgs *ba, SYS_SystemHandle *syshandle)
 	BLI_argsAdd(ba, 1, NULL, "--debug-value", "<value>\n\tSet debug value of <value> on startup\n", set_debug_value, NULL);
 	BLI_argsAdd(ba, 1, NULL, "--debug-jobs",  "\n\tEnable time profiling for background jobs.", debug_mode_generic, (void *)G_DEBUG_JOBS);
 	BLI_argsAdd(ba, 1, NULL, "--debug-depsgraph", "\n\tEnable debug messages from dependency graph", debug_mode_generic, (void *)G_DEBUG_DEPSGRAPH);
+	BLI_argsAdd(ba, 1, NULL, "--debug-cycles", "\n\tPrint scene sync and update times and kernel statistics of Cycles renders", debug_mode_generic, (void *)G_DEBUG_CYCLES);
 
 	BLI_argsAdd(ba, 1, NULL, "--verbose", "<verbose>\n\tSet logging verbosity level.", set_verbosity, NULL);
 
+	BLI_argsAdd(ba, 1, NULL, "--memory-cached", "\n\tServe small memory blocks from per-thread caches, faster for heavily threaded workloads", set_memory_cached, NULL);
 	BLI_argsAdd(ba, 1, NULL, "--factory-startup", "\n\tSkip reading the "STRINGIFY (BLENDER_STARTUP_FILE)" in the users home directory", set_factory_startup, NULL);
 
 	/* TODO, add user env vars? */
@@ -1512,18 +1522,29 @@ int main(int argc, const char **argv)
 	 */
 	{
 		int i;
+		bool use_cached_allocator = false;
 		for (i = 0; i < argc; i++) {
 			if (STREQ(argv[i], "--debug") || STREQ(argv[i], "-d") ||
 			    STREQ(argv[i], "--debug-memory"))
 			{
 				printf("Switching to fully guarded memory allocator.\n");
 				MEM_use_guarded_allocator();
+				use_cached_allocator = false;
 				break;
 			}
+			else if (STREQ(argv[i], "--memory-cached")) {
+				use_cached_allocator = true;
+			}
 			else if (STREQ(argv[i], "--")) {
 				break;
 			}
 		}
+
+		/* guarded allocator takes precedence, it's needed for debugging */
+		if (use_cached_allocator) {
+			printf("Switching to thread-cached memory allocator.\n");
+			MEM_use_cached_allocator();
+		}
 	}
 
 #ifdef BUILD_DATE